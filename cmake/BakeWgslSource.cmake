@@ -1,3 +1,32 @@
+# Reads a WGSL file from src/pt, replacing each `#include "<module>.wgsl"` line with the composed
+# contents of the module. A module is included at most once per shader, so modules can include the
+# modules they depend on. The included modules are tracked in the WGSL_INCLUDED_FILES property.
+function(compose_wgsl_source WGSL_FILE OUT_CONTENT)
+    file(READ ${CMAKE_SOURCE_DIR}/src/pt/${WGSL_FILE} CONTENT)
+    string(REGEX MATCHALL "#include \"[A-Za-z0-9_]+\\.wgsl\"" INCLUDE_DIRECTIVES "${CONTENT}")
+
+    foreach(INCLUDE_DIRECTIVE IN LISTS INCLUDE_DIRECTIVES)
+        string(REGEX REPLACE "#include \"(.+)\"" "\\1" INCLUDE_FILE "${INCLUDE_DIRECTIVE}")
+        get_property(INCLUDED_FILES GLOBAL PROPERTY WGSL_INCLUDED_FILES)
+        list(FIND INCLUDED_FILES ${INCLUDE_FILE} INCLUDED_FILE_IDX)
+        set(INCLUDE_CONTENT "")
+        if(INCLUDED_FILE_IDX EQUAL -1)
+            set_property(GLOBAL APPEND PROPERTY WGSL_INCLUDED_FILES ${INCLUDE_FILE})
+            compose_wgsl_source(${INCLUDE_FILE} INCLUDE_CONTENT)
+        endif()
+
+        # Each directive is replaced separately, so that a repeated directive expands to nothing.
+        string(FIND "${CONTENT}" "${INCLUDE_DIRECTIVE}" DIRECTIVE_BEGIN)
+        string(LENGTH "${INCLUDE_DIRECTIVE}" DIRECTIVE_LENGTH)
+        math(EXPR DIRECTIVE_END "${DIRECTIVE_BEGIN} + ${DIRECTIVE_LENGTH}")
+        string(SUBSTRING "${CONTENT}" 0 ${DIRECTIVE_BEGIN} CONTENT_BEFORE)
+        string(SUBSTRING "${CONTENT}" ${DIRECTIVE_END} -1 CONTENT_AFTER)
+        set(CONTENT "${CONTENT_BEFORE}${INCLUDE_CONTENT}${CONTENT_AFTER}")
+    endforeach()
+
+    set(${OUT_CONTENT} "${CONTENT}" PARENT_SCOPE)
+endfunction()
+
 function(bake_wgsl_source OUTPUT_FILE WGSL_FILES_LIST_STR)
     file(WRITE ${OUTPUT_FILE} "// This file is generated by CMake. Do not edit this file!\n\n")
     file(APPEND ${OUTPUT_FILE} "#pragma once\n\n")
@@ -5,7 +34,8 @@ function(bake_wgsl_source OUTPUT_FILE WGSL_FILES_LIST_STR)
     string(REPLACE " " ";" WGSL_FILES ${WGSL_FILES_LIST_STR})
 
     foreach(WGSL_FILE IN LISTS WGSL_FILES)
-        file(READ ${CMAKE_SOURCE_DIR}/src/pt/${WGSL_FILE} WGSL_CONTENT)
+        set_property(GLOBAL PROPERTY WGSL_INCLUDED_FILES "")
+        compose_wgsl_source(${WGSL_FILE} WGSL_CONTENT)
         string(REPLACE ".wgsl" "" VAR_NAME ${WGSL_FILE})
         string(TOUPPER ${VAR_NAME} VAR_NAME)
 
@@ -1,14 +1,22 @@
 #include "bvh.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstddef>
 #include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
 
 namespace nlrs
 {
 namespace
 {
+// SAH costs, relative to the cost of intersecting a triangle.
+constexpr float BVH_TRAVERSAL_COST = 0.5f;
+constexpr float BVH_INTERSECTION_COST = 1.0f;
+
 struct BvhPrimitive
 {
     Aabb        aabb;
@@ -141,8 +149,8 @@ std::size_t buildRecursive(
 
         constexpr std::size_t maxTrianglesInNode = 255;
         constexpr std::size_t numBuckets = 12;
-        constexpr float       traversalCost = 0.5f;
-        constexpr float       intersectionCost = 1.0f;
+        constexpr float       traversalCost = BVH_TRAVERSAL_COST;
+        constexpr float       intersectionCost = BVH_INTERSECTION_COST;
 
         BvhSplitBucket buckets[numBuckets];
 
@@ -258,6 +266,191 @@ std::size_t buildRecursive(
 
     return currentNodeIdx;
 }
+
+// The LBVH's interior nodes are identified by the index of the sorted primitive at either end of
+// their range, as in Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d
+// Trees". Leaf ids follow the interior node ids.
+struct LbvhInteriorNode
+{
+    std::uint32_t leftChild;
+    std::uint32_t rightChild;
+    std::uint32_t rangeFirst;
+    std::uint32_t split;
+    std::uint32_t splitAxis;
+};
+
+// The length of the common prefix of the Morton codes at `i` and `j`, or -1 if `j` is out of range.
+// Duplicate codes are disambiguated by their sorted index.
+int commonPrefixLength(const std::span<const std::uint32_t> mortonCodes, const int i, const int j)
+{
+    if (j < 0 || j >= static_cast<int>(mortonCodes.size()))
+    {
+        return -1;
+    }
+    const std::uint32_t ki = mortonCodes[static_cast<std::size_t>(i)];
+    const std::uint32_t kj = mortonCodes[static_cast<std::size_t>(j)];
+    if (ki == kj)
+    {
+        return 32 + std::countl_zero(static_cast<std::uint32_t>(i ^ j));
+    }
+    return std::countl_zero(ki ^ kj);
+}
+
+LbvhInteriorNode lbvhInteriorNode(const std::span<const std::uint32_t> mortonCodes, const int i)
+{
+    const auto delta = [mortonCodes, i](const int j) -> int {
+        return commonPrefixLength(mortonCodes, i, j);
+    };
+
+    // Determine the direction of the range, and find its other end with an exponential search
+    // followed by a binary search.
+    const int d = delta(i + 1) > delta(i - 1) ? 1 : -1;
+    const int minPrefixLength = delta(i - d);
+    int       maxLength = 2;
+    while (delta(i + maxLength * d) > minPrefixLength)
+    {
+        maxLength *= 2;
+    }
+    int length = 0;
+    for (int t = maxLength / 2; t > 0; t /= 2)
+    {
+        if (delta(i + (length + t) * d) > minPrefixLength)
+        {
+            length += t;
+        }
+    }
+    const int j = i + length * d;
+
+    // Find the split position, where the highest differing bit of the range flips.
+    const int nodePrefixLength = delta(j);
+    int       splitOffset = 0;
+    int       t = length;
+    do
+    {
+        t = (t + 1) / 2;
+        if (delta(i + (splitOffset + t) * d) > nodePrefixLength)
+        {
+            splitOffset += t;
+        }
+    } while (t > 1);
+    const int split = i + splitOffset * d + std::min(d, 0);
+
+    const int leafIdOffset = static_cast<int>(mortonCodes.size()) - 1;
+    const int first = std::min(i, j);
+    const int last = std::max(i, j);
+
+    // The split bit's position within its 3-bit group determines the axis. Splits between
+    // duplicate codes are arbitrary.
+    const int splitBit = 31 - nodePrefixLength;
+
+    return LbvhInteriorNode{
+        .leftChild = static_cast<std::uint32_t>(first == split ? leafIdOffset + split : split),
+        .rightChild =
+            static_cast<std::uint32_t>(last == split + 1 ? leafIdOffset + split + 1 : split + 1),
+        .rangeFirst = static_cast<std::uint32_t>(first),
+        .split = static_cast<std::uint32_t>(split),
+        .splitAxis = nodePrefixLength < 32 ? static_cast<std::uint32_t>(2 - splitBit % 3) : 0u,
+    };
+}
+
+// Emits the subtree of `nodeId` in depth-first order at `nodeIdx`. A subtree over k leaves contains
+// 2k - 1 nodes, so the second child's position follows from the first child's leaf count.
+Aabb emitLbvhNode(
+    const std::span<const LbvhInteriorNode> interiorNodes,
+    const std::span<const std::uint32_t>    sortedTriangleIndices,
+    const std::span<const Positions>        triangles,
+    const std::uint32_t                     nodeId,
+    const std::size_t                       nodeIdx,
+    std::vector<BvhNode>&                   bvhNodes)
+{
+    if (nodeId >= interiorNodes.size())
+    {
+        const std::uint32_t triangleIdx =
+            sortedTriangleIndices[nodeId - static_cast<std::uint32_t>(interiorNodes.size())];
+        const Aabb triangleAabb = aabb(triangles[triangleIdx]);
+        initLeafNode(bvhNodes[nodeIdx], triangleAabb, triangleIdx, 1);
+        return triangleAabb;
+    }
+
+    const LbvhInteriorNode& node = interiorNodes[nodeId];
+    const std::size_t       firstChildLeafCount = node.split - node.rangeFirst + 1;
+    const std::size_t       secondChildIdx = nodeIdx + 2 * firstChildLeafCount;
+    const Aabb              firstChildAabb = emitLbvhNode(
+        interiorNodes, sortedTriangleIndices, triangles, node.leftChild, nodeIdx + 1, bvhNodes);
+    const Aabb secondChildAabb = emitLbvhNode(
+        interiorNodes, sortedTriangleIndices, triangles, node.rightChild, secondChildIdx, bvhNodes);
+    const Aabb nodeAabb = merge(firstChildAabb, secondChildAabb);
+
+    assert(secondChildIdx < std::numeric_limits<std::uint32_t>::max());
+    initInteriorNode(
+        bvhNodes[nodeIdx], node.splitAxis, static_cast<std::uint32_t>(secondChildIdx), nodeAabb);
+
+    return nodeAabb;
+}
+
+bool contains(const Aabb& outer, const Aabb& inner)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (inner.min[axis] < outer.min[axis] || outer.max[axis] < inner.max[axis])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns the index following the subtree at `nodeIdx` in depth-first order, or `nodes.size() + 1`
+// if the subtree is invalid.
+std::size_t validateSubtree(
+    const std::span<const BvhNode> nodes,
+    const std::size_t              nodeIdx,
+    const Aabb&                    parentAabb,
+    std::vector<bool>&             visitedTriangles)
+{
+    const std::size_t invalid = nodes.size() + 1;
+    if (nodeIdx >= nodes.size())
+    {
+        return invalid;
+    }
+
+    const BvhNode& node = nodes[nodeIdx];
+    if (!contains(parentAabb, node.aabb))
+    {
+        return invalid;
+    }
+
+    if (node.triangleCount > 0)
+    {
+        const std::size_t trianglesEnd =
+            static_cast<std::size_t>(node.trianglesOffset) + node.triangleCount;
+        if (trianglesEnd > visitedTriangles.size())
+        {
+            return invalid;
+        }
+        for (std::size_t idx = node.trianglesOffset; idx < trianglesEnd; ++idx)
+        {
+            if (visitedTriangles[idx])
+            {
+                return invalid;
+            }
+            visitedTriangles[idx] = true;
+        }
+        return nodeIdx + 1;
+    }
+
+    if (node.splitAxis > 2)
+    {
+        return invalid;
+    }
+    const std::size_t firstChildEnd =
+        validateSubtree(nodes, nodeIdx + 1, node.aabb, visitedTriangles);
+    if (firstChildEnd != node.secondChildOffset)
+    {
+        return invalid;
+    }
+    return validateSubtree(nodes, node.secondChildOffset, node.aabb, visitedTriangles);
+}
 } // namespace
 
 Bvh buildBvh(std::span<const Positions> triangles)
@@ -289,4 +482,130 @@ Bvh buildBvh(std::span<const Positions> triangles)
         .triangleIndices = std::move(triangleIndices),
     };
 }
+
+Bvh buildLbvh(const std::span<const Positions> triangles)
+{
+    assert(!triangles.empty());
+    assert(triangles.size() < std::numeric_limits<std::int32_t>::max());
+
+    const std::size_t numTriangles = triangles.size();
+
+    Aabb centroidAabb;
+    for (const Positions& tri : triangles)
+    {
+        centroidAabb = merge(centroidAabb, centroid(aabb(tri)));
+    }
+    const glm::vec3 centroidExtent =
+        glm::max(diagonal(centroidAabb), glm::vec3(std::numeric_limits<float>::min()));
+
+    // Sorting the (code, index) pairs matches the stable radix sort of the GPU builder.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> sortedPrimitives;
+    sortedPrimitives.reserve(numTriangles);
+    for (std::size_t idx = 0; idx < numTriangles; ++idx)
+    {
+        const glm::vec3 unitCubePoint =
+            (centroid(aabb(triangles[idx])) - centroidAabb.min) / centroidExtent;
+        sortedPrimitives.emplace_back(mortonCode(unitCubePoint), static_cast<std::uint32_t>(idx));
+    }
+    std::sort(sortedPrimitives.begin(), sortedPrimitives.end());
+
+    std::vector<std::uint32_t> mortonCodes(numTriangles);
+    std::vector<std::uint32_t> sortedTriangleIndices(numTriangles);
+    for (std::size_t idx = 0; idx < numTriangles; ++idx)
+    {
+        mortonCodes[idx] = sortedPrimitives[idx].first;
+        sortedTriangleIndices[idx] = sortedPrimitives[idx].second;
+    }
+
+    std::vector<LbvhInteriorNode> interiorNodes;
+    interiorNodes.reserve(numTriangles - 1);
+    for (std::size_t idx = 0; idx + 1 < numTriangles; ++idx)
+    {
+        interiorNodes.push_back(lbvhInteriorNode(mortonCodes, static_cast<int>(idx)));
+    }
+
+    std::vector<BvhNode> bvhNodes(2 * numTriangles - 1);
+    emitLbvhNode(interiorNodes, sortedTriangleIndices, triangles, 0, 0, bvhNodes);
+
+    std::vector<std::size_t> triangleIndices(numTriangles);
+    std::iota(triangleIndices.begin(), triangleIndices.end(), std::size_t(0));
+
+    return Bvh{
+        .nodes = std::move(bvhNodes),
+        .triangleIndices = std::move(triangleIndices),
+    };
+}
+
+std::uint32_t mortonCode(const glm::vec3& unitCubePoint)
+{
+    // Spreads the lower 10 bits of `v` so that there are two zero bits between each bit.
+    const auto expandBits = [](std::uint32_t v) -> std::uint32_t {
+        v = (v * 0x00010001u) & 0xff0000ffu;
+        v = (v * 0x00000101u) & 0x0f00f00fu;
+        v = (v * 0x00000011u) & 0xc30c30c3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    };
+    const auto quantize = [](const float x) -> std::uint32_t {
+        return std::min(static_cast<std::uint32_t>(std::max(x * 1024.0f, 0.0f)), 1023u);
+    };
+    return (expandBits(quantize(unitCubePoint.x)) << 2) |
+           (expandBits(quantize(unitCubePoint.y)) << 1) | expandBits(quantize(unitCubePoint.z));
+}
+
+float sahCost(const std::span<const BvhNode> nodes)
+{
+    assert(!nodes.empty());
+
+    // The probability of a ray visiting a node, given that it hits the root, is the ratio of their
+    // surface areas.
+    float cost = 0.0f;
+    for (const BvhNode& node : nodes)
+    {
+        const float nodeCost =
+            node.triangleCount > 0
+                ? BVH_INTERSECTION_COST * static_cast<float>(node.triangleCount)
+                : BVH_TRAVERSAL_COST;
+        cost += nodeCost * surfaceArea(node.aabb);
+    }
+    const float rootArea = surfaceArea(nodes[0].aabb);
+    assert(rootArea > 0.0f);
+    return cost / rootArea;
+}
+
+bool isValidBvh(const std::span<const BvhNode> nodes, const std::size_t triangleCount)
+{
+    if (nodes.empty())
+    {
+        return false;
+    }
+    std::vector<bool> visitedTriangles(triangleCount, false);
+    const std::size_t subtreeEnd = validateSubtree(nodes, 0, nodes[0].aabb, visitedTriangles);
+    return subtreeEnd == nodes.size() &&
+           std::all_of(visitedTriangles.begin(), visitedTriangles.end(), [](const bool visited) {
+               return visited;
+           });
+}
+
+std::size_t bvhDepth(const std::span<const BvhNode> nodes)
+{
+    assert(!nodes.empty());
+
+    std::size_t                                      maxDepth = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> nodesToVisit{{0, 0}};
+    while (!nodesToVisit.empty())
+    {
+        const auto [nodeIdx, depth] = nodesToVisit.back();
+        nodesToVisit.pop_back();
+        maxDepth = std::max(maxDepth, depth);
+
+        const BvhNode& node = nodes[nodeIdx];
+        if (node.triangleCount == 0)
+        {
+            nodesToVisit.emplace_back(nodeIdx + 1, depth + 1);
+            nodesToVisit.emplace_back(node.secondChildOffset, depth + 1);
+        }
+    }
+    return maxDepth;
+}
 } // namespace nlrs
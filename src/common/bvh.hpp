@@ -32,6 +32,29 @@ struct Bvh
 
 Bvh buildBvh(std::span<const Positions> triangles);
 
+// Builds a linear BVH (LBVH) by sorting the triangles along a Morton curve, and emitting the
+// hierarchy from the sorted Morton codes. This is the CPU reference of the GPU builder in
+// pt/gpu_bvh_builder.hpp. The leaves contain one triangle each, and point to the triangles in their
+// original order, so `triangleIndices` is the identity.
+Bvh buildLbvh(std::span<const Positions> triangles);
+
+// The 30-bit Morton code of a point in the unit cube, with 10 bits per axis. The x-axis occupies
+// the most significant bit of each 3-bit group.
+std::uint32_t mortonCode(const glm::vec3& unitCubePoint);
+
+// The expected cost of tracing a ray through the BVH according to the surface area heuristic
+// (SAH), relative to the cost of intersecting a single triangle. Uses the same traversal and
+// intersection costs as `buildBvh`.
+float sahCost(std::span<const BvhNode> nodes);
+
+// Checks that the nodes form a binary tree in depth-first order, in which each interior node's
+// first child directly follows it, the children are bounded by their parent, and each triangle is
+// referenced by exactly one leaf.
+bool isValidBvh(std::span<const BvhNode> nodes, std::size_t triangleCount);
+
+// The number of edges on the longest path from the root to a leaf.
+std::size_t bvhDepth(std::span<const BvhNode> nodes);
+
 template<std::copyable T>
 std::vector<T> reorderAttributes(
     const std::span<const T>           attributes,
@@ -0,0 +1,50 @@
+#include "duration_histogram.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace nlrs
+{
+namespace
+{
+float toMs(const std::uint64_t durationNs) { return 0.000001f * static_cast<float>(durationNs); }
+} // namespace
+
+void DurationHistogram::record(const std::uint64_t durationNs) noexcept
+{
+    mDurationsNs[mNextIdx] = durationNs;
+    mNextIdx = (mNextIdx + 1) % CAPACITY;
+    mCount = std::min(mCount + 1, CAPACITY);
+}
+
+DurationHistogram::Summary DurationHistogram::summary() const
+{
+    if (mCount == 0)
+    {
+        return {};
+    }
+
+    // The ring is filled from the start, so the recorded durations are always its first `mCount`
+    // entries.
+    std::array<std::uint64_t, CAPACITY> durations = mDurationsNs;
+    const auto                          begin = durations.begin();
+    const auto                          end = begin + static_cast<std::ptrdiff_t>(mCount);
+
+    const auto [minIt, maxIt] = std::minmax_element(begin, end);
+    const std::uint64_t sum = std::accumulate(begin, end, std::uint64_t(0));
+
+    // Nearest-rank percentile.
+    const std::size_t p95Rank = (95 * mCount + 99) / 100;
+    const auto        p95It = begin + static_cast<std::ptrdiff_t>(p95Rank - 1);
+    const float       minMs = toMs(*minIt);
+    const float       maxMs = toMs(*maxIt);
+    std::nth_element(begin, p95It, end);
+
+    return {
+        .minMs = minMs,
+        .averageMs = toMs(sum) / static_cast<float>(mCount),
+        .p95Ms = toMs(*p95It),
+        .maxMs = maxMs,
+    };
+}
+} // namespace nlrs
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace nlrs
+{
+// Records the most recent durations in a fixed-size ring, and summarizes their distribution. Once
+// the ring is full, each new duration replaces the oldest one.
+class DurationHistogram
+{
+public:
+    static constexpr std::size_t CAPACITY = 128;
+
+    // All durations are zero when no durations have been recorded.
+    struct Summary
+    {
+        float minMs = 0.0f;
+        float averageMs = 0.0f;
+        float p95Ms = 0.0f;
+        float maxMs = 0.0f;
+    };
+
+    void        record(std::uint64_t durationNs) noexcept;
+    Summary     summary() const;
+    std::size_t count() const noexcept { return mCount; }
+
+private:
+    std::array<std::uint64_t, CAPACITY> mDurationsNs = {};
+    std::size_t                         mNextIdx = 0;
+    std::size_t                         mCount = 0;
+};
+} // namespace nlrs
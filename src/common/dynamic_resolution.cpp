@@ -0,0 +1,74 @@
+#include "assert.hpp"
+#include "dynamic_resolution.hpp"
+
+namespace nlrs
+{
+DynamicResolutionController::DynamicResolutionController(
+    const float                  targetFrameMs,
+    const std::span<const float> levelCosts)
+    : mLevelCosts(levelCosts.begin(), levelCosts.end()),
+      mTargetFrameMs(targetFrameMs)
+{
+    NLRS_ASSERT(targetFrameMs > 0.0f);
+    NLRS_ASSERT(!levelCosts.empty());
+    for (const float cost : levelCosts)
+    {
+        NLRS_ASSERT(cost > 0.0f);
+    }
+}
+
+std::optional<DynamicResolutionController::Decision> DynamicResolutionController::record(
+    const std::uint64_t frameDurationNs)
+{
+    if (!isEnabled())
+    {
+        return std::nullopt;
+    }
+
+    if (mSettleFrameCount > 0)
+    {
+        --mSettleFrameCount;
+        return std::nullopt;
+    }
+
+    mWindowDurationNs += frameDurationNs;
+    ++mWindowFrameCount;
+    if (mWindowFrameCount < WINDOW_FRAME_COUNT)
+    {
+        return std::nullopt;
+    }
+
+    const float averageMs =
+        0.000001f * static_cast<float>(mWindowDurationNs) / static_cast<float>(mWindowFrameCount);
+    mWindowDurationNs = 0;
+    mWindowFrameCount = 0;
+
+    std::size_t level = mLevel;
+    if (averageMs > mTargetFrameMs)
+    {
+        if (mLevel + 1 < mLevelCosts.size())
+        {
+            level = mLevel + 1;
+        }
+    }
+    else if (mLevel > 0)
+    {
+        // The frame duration is assumed to scale with the level's cost.
+        const float predictedMs = averageMs * mLevelCosts[mLevel - 1] / mLevelCosts[mLevel];
+        if (predictedMs < RAISE_THRESHOLD * mTargetFrameMs)
+        {
+            level = mLevel - 1;
+        }
+    }
+
+    if (level == mLevel)
+    {
+        return std::nullopt;
+    }
+
+    const Decision decision{mLevel, level, averageMs};
+    mLevel = level;
+    mSettleFrameCount = SETTLE_FRAME_COUNT;
+    return decision;
+}
+} // namespace nlrs
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// Chooses the render resolution which keeps the GPU frame time within a budget. The resolutions
+// are levels ordered from the highest to the lowest, each with its cost relative to the first
+// level, e.g. the fraction of pixels rendered. The frame durations are averaged over a window of
+// frames. The resolution is lowered by a level when the average exceeds the budget, and raised by a
+// level when the duration predicted for the higher level is comfortably within the budget, so that
+// the resolution doesn't oscillate between two levels.
+class DynamicResolutionController
+{
+public:
+    // The frames after a level change are discarded, since the durations are read back a few
+    // frames late and may still belong to the previous level.
+    static constexpr std::uint32_t SETTLE_FRAME_COUNT = 8;
+    static constexpr std::uint32_t WINDOW_FRAME_COUNT = 32;
+    // The resolution is raised when the predicted duration is below this fraction of the budget.
+    static constexpr float RAISE_THRESHOLD = 0.8f;
+
+    struct Decision
+    {
+        std::size_t previousLevel;
+        std::size_t level;
+        float       averageMs;
+    };
+
+    // A default-constructed controller is disabled, and always stays at level zero.
+    DynamicResolutionController() = default;
+    DynamicResolutionController(float targetFrameMs, std::span<const float> levelCosts);
+
+    // Records the GPU duration of a frame rendered at the current level. Returns the decision if
+    // the level changed.
+    std::optional<Decision> record(std::uint64_t frameDurationNs);
+
+    bool        isEnabled() const noexcept { return !mLevelCosts.empty(); }
+    std::size_t level() const noexcept { return mLevel; }
+    float       targetFrameMs() const noexcept { return mTargetFrameMs; }
+
+private:
+    std::vector<float> mLevelCosts;
+    float              mTargetFrameMs = 0.0f;
+    std::size_t        mLevel = 0;
+    std::uint32_t      mSettleFrameCount = SETTLE_FRAME_COUNT;
+    std::uint32_t      mWindowFrameCount = 0;
+    std::uint64_t      mWindowDurationNs = 0;
+};
+} // namespace nlrs
@@ -0,0 +1,160 @@
+#include "assert.hpp"
+#include "gpu_memory.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace nlrs
+{
+namespace
+{
+double toMiB(const std::uint64_t byteSize) { return static_cast<double>(byteSize) / (1 << 20); }
+} // namespace
+
+const char* gpuMemoryCategoryName(const GpuMemoryCategory category) noexcept
+{
+    switch (category)
+    {
+    case GpuMemoryCategory::Geometry:
+        return "geometry";
+    case GpuMemoryCategory::Bvh:
+        return "bvh";
+    case GpuMemoryCategory::Textures:
+        return "textures";
+    case GpuMemoryCategory::Accumulation:
+        return "accumulation";
+    case GpuMemoryCategory::Gbuffer:
+        return "gbuffer";
+    case GpuMemoryCategory::Staging:
+        return "staging";
+    case GpuMemoryCategory::Other:
+        return "other";
+    case GpuMemoryCategory::Count:
+        break;
+    }
+    NLRS_ASSERT(false);
+    return "invalid";
+}
+
+GpuMemoryTracker& GpuMemoryTracker::global()
+{
+    static GpuMemoryTracker tracker;
+    return tracker;
+}
+
+GpuMemoryTracker::AllocationId GpuMemoryTracker::allocate(
+    const std::string_view  label,
+    const GpuMemoryCategory category,
+    const std::uint64_t     byteSize)
+{
+    NLRS_ASSERT(category != GpuMemoryCategory::Count);
+
+    if (mBudget > 0 && mTotal.byteSize + byteSize > mBudget)
+    {
+        std::string categories;
+        for (std::size_t idx = 0; idx < GPU_MEMORY_CATEGORY_COUNT; ++idx)
+        {
+            const Usage& usage = mCategories[idx];
+            if (usage.byteSize > 0)
+            {
+                categories += fmt::format(
+                    "\n  {}: {:.2f} MiB",
+                    gpuMemoryCategoryName(static_cast<GpuMemoryCategory>(idx)),
+                    toMiB(usage.byteSize));
+            }
+        }
+        throw std::runtime_error(fmt::format(
+            "Allocating {:.2f} MiB for \"{}\" ({}) exceeds the GPU memory budget of {:.2f} MiB, "
+            "with {:.2f} MiB in use:{}",
+            toMiB(byteSize),
+            label,
+            gpuMemoryCategoryName(category),
+            toMiB(mBudget),
+            toMiB(mTotal.byteSize),
+            categories));
+    }
+
+    const auto addAllocation = [byteSize](Usage& usage) -> void {
+        usage.byteSize += byteSize;
+        usage.peakByteSize = std::max(usage.peakByteSize, usage.byteSize);
+        ++usage.allocationCount;
+    };
+    addAllocation(mTotal);
+    addAllocation(mCategories[static_cast<std::size_t>(category)]);
+
+    const AllocationId id = mNextId++;
+    mAllocations.emplace(id, Allocation{std::string(label), category, byteSize});
+    return id;
+}
+
+void GpuMemoryTracker::release(const AllocationId id) noexcept
+{
+    const auto it = mAllocations.find(id);
+    if (it == mAllocations.end())
+    {
+        NLRS_ASSERT(id == INVALID_ALLOCATION_ID);
+        return;
+    }
+
+    const Allocation& allocation = it->second;
+    const auto        removeAllocation = [&allocation](Usage& usage) -> void {
+        NLRS_ASSERT(usage.byteSize >= allocation.byteSize);
+        NLRS_ASSERT(usage.allocationCount > 0);
+        usage.byteSize -= allocation.byteSize;
+        --usage.allocationCount;
+    };
+    removeAllocation(mTotal);
+    removeAllocation(mCategories[static_cast<std::size_t>(allocation.category)]);
+    mAllocations.erase(it);
+}
+
+std::vector<GpuMemoryTracker::Allocation> GpuMemoryTracker::largestAllocations(
+    const std::size_t count) const
+{
+    std::vector<Allocation> allocations;
+    allocations.reserve(mAllocations.size());
+    for (const auto& [id, allocation] : mAllocations)
+    {
+        allocations.push_back(allocation);
+    }
+
+    const std::size_t largestCount = std::min(count, allocations.size());
+    std::partial_sort(
+        allocations.begin(),
+        allocations.begin() + static_cast<std::ptrdiff_t>(largestCount),
+        allocations.end(),
+        [](const Allocation& lhs, const Allocation& rhs) -> bool {
+            return lhs.byteSize > rhs.byteSize;
+        });
+    allocations.resize(largestCount);
+    return allocations;
+}
+
+GpuMemoryAllocation::GpuMemoryAllocation(
+    const std::string_view  label,
+    const GpuMemoryCategory category,
+    const std::uint64_t     byteSize)
+    : mId(GpuMemoryTracker::global().allocate(label, category, byteSize))
+{
+}
+
+GpuMemoryAllocation::GpuMemoryAllocation(GpuMemoryAllocation&& other) noexcept
+    : mId(std::exchange(other.mId, GpuMemoryTracker::INVALID_ALLOCATION_ID))
+{
+}
+
+GpuMemoryAllocation& GpuMemoryAllocation::operator=(GpuMemoryAllocation&& other) noexcept
+{
+    if (this != &other)
+    {
+        GpuMemoryTracker::global().release(mId);
+        mId = std::exchange(other.mId, GpuMemoryTracker::INVALID_ALLOCATION_ID);
+    }
+    return *this;
+}
+
+GpuMemoryAllocation::~GpuMemoryAllocation() { GpuMemoryTracker::global().release(mId); }
+} // namespace nlrs
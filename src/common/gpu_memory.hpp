@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace nlrs
+{
+enum class GpuMemoryCategory : std::uint8_t
+{
+    Geometry,
+    Bvh,
+    Textures,
+    Accumulation,
+    Gbuffer,
+    Staging,
+    Other,
+    Count,
+};
+
+inline constexpr std::size_t GPU_MEMORY_CATEGORY_COUNT =
+    static_cast<std::size_t>(GpuMemoryCategory::Count);
+
+const char* gpuMemoryCategoryName(GpuMemoryCategory category) noexcept;
+
+// Records the GPU memory allocated by buffers and textures, by label and category. Allocations
+// which would exceed the budget throw before the GPU resource is created, naming the allocation and
+// the current usage. Not thread-safe, GPU resources are created on the main thread.
+class GpuMemoryTracker
+{
+public:
+    using AllocationId = std::uint64_t;
+
+    // Zero is never returned by `allocate`, and releasing it does nothing.
+    static constexpr AllocationId INVALID_ALLOCATION_ID = 0;
+
+    struct Allocation
+    {
+        std::string       label;
+        GpuMemoryCategory category;
+        std::uint64_t     byteSize;
+    };
+
+    struct Usage
+    {
+        std::uint64_t byteSize = 0;
+        std::uint64_t peakByteSize = 0;
+        std::size_t   allocationCount = 0;
+    };
+
+    GpuMemoryTracker() = default;
+
+    GpuMemoryTracker(const GpuMemoryTracker&) = delete;
+    GpuMemoryTracker& operator=(const GpuMemoryTracker&) = delete;
+
+    // The tracker which the GPU resource wrappers record their allocations in.
+    static GpuMemoryTracker& global();
+
+    // Throws std::runtime_error if the allocation would exceed the budget.
+    AllocationId allocate(std::string_view label, GpuMemoryCategory, std::uint64_t byteSize);
+    void         release(AllocationId) noexcept;
+
+    // A budget of zero bytes disables the budget.
+    void          setBudget(std::uint64_t byteSize) noexcept { mBudget = byteSize; }
+    std::uint64_t budget() const noexcept { return mBudget; }
+
+    const Usage& totalUsage() const noexcept { return mTotal; }
+    const Usage& categoryUsage(GpuMemoryCategory category) const noexcept
+    {
+        return mCategories[static_cast<std::size_t>(category)];
+    }
+    // The `count` largest live allocations, largest first.
+    std::vector<Allocation> largestAllocations(std::size_t count) const;
+
+private:
+    std::unordered_map<AllocationId, Allocation> mAllocations;
+    std::array<Usage, GPU_MEMORY_CATEGORY_COUNT> mCategories = {};
+    Usage                                        mTotal = {};
+    std::uint64_t                                mBudget = 0;
+    AllocationId                                 mNextId = INVALID_ALLOCATION_ID + 1;
+};
+
+// Records an allocation in the global tracker for the lifetime of the object. Owned by the GPU
+// resource wrappers alongside the resource.
+class GpuMemoryAllocation
+{
+public:
+    GpuMemoryAllocation() = default;
+    GpuMemoryAllocation(std::string_view label, GpuMemoryCategory, std::uint64_t byteSize);
+
+    GpuMemoryAllocation(const GpuMemoryAllocation&) = delete;
+    GpuMemoryAllocation& operator=(const GpuMemoryAllocation&) = delete;
+
+    GpuMemoryAllocation(GpuMemoryAllocation&&) noexcept;
+    GpuMemoryAllocation& operator=(GpuMemoryAllocation&&) noexcept;
+
+    ~GpuMemoryAllocation();
+
+private:
+    GpuMemoryTracker::AllocationId mId = GpuMemoryTracker::INVALID_ALLOCATION_ID;
+};
+} // namespace nlrs
@@ -145,12 +145,10 @@ bool rayIntersectBvh(
 {
     const RayAabbIntersector intersector(ray);
 
-    constexpr std::size_t STACK_SIZE = 32;
-
     std::uint32_t nodesVisited = 0;
     std::size_t   toVisitOffset = 0;
     std::size_t   currentNodeIdx = 0;
-    std::size_t   nodesToVisit[STACK_SIZE];
+    std::size_t   nodesToVisit[BVH_STACK_SIZE];
     bool          didIntersect = false;
 
     while (true)
@@ -191,7 +189,7 @@ bool rayIntersectBvh(
                     nodesToVisit[toVisitOffset++] = node.secondChildOffset;
                     currentNodeIdx = currentNodeIdx + 1;
                 }
-                assert(toVisitOffset < STACK_SIZE);
+                assert(toVisitOffset < BVH_STACK_SIZE);
             }
         }
         else
@@ -211,4 +209,126 @@ bool rayIntersectBvh(
 
     return didIntersect;
 }
+
+bool rayIntersectBvhShortStack(
+    const Ray&                       ray,
+    const std::span<const BvhNode>   bvhNodes,
+    const std::span<const Positions> triangles,
+    float                            rayTMax,
+    Intersection&                    intersect,
+    BvhStats*                        stats)
+{
+    const RayAabbIntersector intersector(ray);
+
+    // Each tree level is represented by a bit, with the root level in the most significant bit. A
+    // set bit in the trail means that the node's last child on that level is being visited.
+    constexpr std::uint32_t ROOT_LEVEL = 1u << 31;
+
+    std::uint32_t nodesVisited = 0;
+    std::uint32_t shortStack[BVH_SHORT_STACK_SIZE];
+    std::size_t   stackTop = 0;
+    std::size_t   stackSize = 0;
+    std::uint32_t trail = 0;
+    std::uint32_t level = ROOT_LEVEL;
+    std::uint32_t currentNodeIdx = 0;
+    bool          didIntersect = false;
+
+    // The children are tested before they are visited, so the root is tested up front.
+    if (bvhNodes.empty() || !rayIntersectAabb(intersector, bvhNodes[0].aabb, rayTMax))
+    {
+        if (stats != nullptr)
+        {
+            stats->nodesVisited = 1;
+        }
+        return false;
+    }
+
+    while (true)
+    {
+        ++nodesVisited;
+        const BvhNode& node = bvhNodes[currentNodeIdx];
+
+        if (node.triangleCount > 0)
+        {
+            for (std::size_t idx = 0; idx < node.triangleCount; ++idx)
+            {
+                const Positions& triangle = triangles[node.trianglesOffset + idx];
+                if (rayIntersectTriangle(ray, triangle, rayTMax, intersect))
+                {
+                    rayTMax = intersect.t;
+                    didIntersect = true;
+                }
+            }
+        }
+        else
+        {
+            const bool          secondChildFirst = intersector.dirNeg[node.splitAxis] != 0;
+            const std::uint32_t firstIdx =
+                secondChildFirst ? node.secondChildOffset : currentNodeIdx + 1;
+            const std::uint32_t secondIdx =
+                secondChildFirst ? currentNodeIdx + 1 : node.secondChildOffset;
+            const bool          hitFirst =
+                rayIntersectAabb(intersector, bvhNodes[firstIdx].aabb, rayTMax);
+            const bool          hitSecond =
+                rayIntersectAabb(intersector, bvhNodes[secondIdx].aabb, rayTMax);
+
+            if (hitFirst || hitSecond)
+            {
+                level >>= 1;
+                assert(level != 0);
+                if (hitFirst && hitSecond)
+                {
+                    if ((trail & level) != 0)
+                    {
+                        // The first child was visited before the restart.
+                        currentNodeIdx = secondIdx;
+                    }
+                    else
+                    {
+                        // The oldest entry is overwritten when the short stack is full.
+                        currentNodeIdx = firstIdx;
+                        shortStack[stackTop] = secondIdx;
+                        stackTop = (stackTop + 1) % BVH_SHORT_STACK_SIZE;
+                        stackSize = std::min(stackSize + 1, BVH_SHORT_STACK_SIZE);
+                    }
+                }
+                else
+                {
+                    currentNodeIdx = hitFirst ? firstIdx : secondIdx;
+                    trail |= level;
+                }
+                continue;
+            }
+        }
+
+        // The current subtree is done. Adding the level to the trail moves to the next sibling on
+        // the deepest level which still has one, clearing the bits of the levels below it.
+        trail &= ~(level - 1);
+        trail += level;
+        if ((trail & ROOT_LEVEL) != 0)
+        {
+            break;
+        }
+        level = trail & (~trail + 1);
+
+        if (stackSize > 0)
+        {
+            stackTop = (stackTop + BVH_SHORT_STACK_SIZE - 1) % BVH_SHORT_STACK_SIZE;
+            --stackSize;
+            currentNodeIdx = shortStack[stackTop];
+        }
+        else
+        {
+            currentNodeIdx = 0;
+            level = ROOT_LEVEL;
+        }
+    }
+
+    if (stats != nullptr)
+    {
+        stats->nodesVisited = nodesVisited;
+    }
+
+    return didIntersect;
+}
 } // namespace nlrs
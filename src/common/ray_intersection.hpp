@@ -4,6 +4,7 @@
 
 #include <glm/glm.hpp>
 
+#include <cstddef>
 #include <span>
 
 namespace nlrs
@@ -40,6 +41,12 @@ struct BvhStats
     uint32_t nodesVisited;
 };
 
+// The number of entries in the traversal stack of `rayIntersectBvh`, and of `nodesToVisit` in the
+// shaders.
+inline constexpr std::size_t BVH_STACK_SIZE = 32;
+// The maximum `bvhDepth` supported by the stack traversal. Deeper trees overflow the stack.
+inline constexpr std::size_t BVH_STACK_MAX_DEPTH = BVH_STACK_SIZE - 1;
+
 bool rayIntersectBvh(
     const Ray&                 ray,
     std::span<const BvhNode>   bvhNodes,
@@ -47,4 +54,23 @@ bool rayIntersectBvh(
     float                      rayTMax,
     Intersection&              intersect,
     BvhStats*                  stats = nullptr);
+
+// The number of entries in the short stack of `rayIntersectBvhShortStack`.
+inline constexpr std::size_t BVH_SHORT_STACK_SIZE = 4;
+// The maximum `bvhDepth` supported by `rayIntersectBvhShortStack`.
+inline constexpr std::size_t BVH_SHORT_STACK_MAX_DEPTH = 31;
+
+// A traversal which only keeps the last `BVH_SHORT_STACK_SIZE` nodes to visit in a short stack.
+// When the short stack runs out while nodes remain, the traversal restarts from the root, using a
+// restart trail to skip the subtrees which have already been visited (Laine, "Restart Trail for
+// Stackless BVH Traversal"). The trail has one bit per tree level, which limits the tree depth to
+// `BVH_SHORT_STACK_MAX_DEPTH`. The CPU reference of the short-stack traversal in
+// wavefront_path_tracer.wgsl.
+bool rayIntersectBvhShortStack(
+    const Ray&                 ray,
+    std::span<const BvhNode>   bvhNodes,
+    std::span<const Positions> triangles,
+    float                      rayTMax,
+    Intersection&              intersect,
+    BvhStats*                  stats = nullptr);
 } // namespace nlrs
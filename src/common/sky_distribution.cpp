@@ -0,0 +1,178 @@
+#include "assert.hpp"
+#include "sky_distribution.hpp"
+#include "sky_radiance_lut.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <numbers>
+#include <utility>
+
+namespace nlrs
+{
+namespace
+{
+constexpr float PI = std::numbers::pi_v<float>;
+
+constexpr std::size_t CONDITIONAL_CDF_SIZE = SKY_DISTRIBUTION_WIDTH + 1;
+constexpr std::size_t MARGINAL_CDF_SIZE = SKY_DISTRIBUTION_HEIGHT + 1;
+
+template<typename T>
+std::span<T> funcRow(const std::span<T> distribution, const std::uint32_t row)
+{
+    return distribution.subspan(
+        SKY_DISTRIBUTION_FUNC_OFFSET + row * SKY_DISTRIBUTION_WIDTH, SKY_DISTRIBUTION_WIDTH);
+}
+
+template<typename T>
+std::span<T> conditionalCdf(const std::span<T> distribution, const std::uint32_t row)
+{
+    return distribution.subspan(
+        SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + row * CONDITIONAL_CDF_SIZE, CONDITIONAL_CDF_SIZE);
+}
+
+template<typename T>
+std::span<T> marginalCdf(const std::span<T> distribution)
+{
+    return distribution.subspan(SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET, MARGINAL_CDF_SIZE);
+}
+
+// The probability density with respect to solid angle of the cell at `row` and `col`.
+float cellPdf(
+    const std::span<const float> distribution,
+    const std::uint32_t          row,
+    const std::uint32_t          col,
+    const float                  sinTheta)
+{
+    if (sinTheta <= 0.0f)
+    {
+        return 0.0f;
+    }
+    const float func = funcRow(distribution, row)[col];
+    const float integral = distribution[SKY_DISTRIBUTION_INTEGRAL_OFFSET];
+    // The Jacobian of the mapping from (u, v) to the sphere is 2 * pi^2 * sin(theta).
+    return func / (integral * 2.0f * PI * PI * sinTheta);
+}
+
+float luminance(const glm::vec3& rgb)
+{
+    return 0.2126f * rgb.x + 0.7152f * rgb.y + 0.0722f * rgb.z;
+}
+
+// Fills `cdf`, which has one more entry than `func`, and returns the integral of `func` over
+// [0, 1].
+float buildCdf(const std::span<const float> func, const std::span<float> cdf)
+{
+    NLRS_ASSERT(cdf.size() == func.size() + 1);
+
+    const float n = static_cast<float>(func.size());
+    cdf[0] = 0.0f;
+    for (std::size_t i = 0; i < func.size(); ++i)
+    {
+        cdf[i + 1] = cdf[i] + func[i] / n;
+    }
+
+    const float integral = cdf.back();
+    for (std::size_t i = 1; i < cdf.size(); ++i)
+    {
+        // A zero function is sampled uniformly.
+        cdf[i] = integral > 0.0f ? cdf[i] / integral : static_cast<float>(i) / n;
+    }
+
+    return integral;
+}
+
+// Inverts the piecewise-linear `cdf`. Returns the sampled coordinate in [0, 1) and the index of the
+// sampled segment.
+std::pair<float, std::uint32_t> sampleCdf(const std::span<const float> cdf, const float u)
+{
+    const auto segmentCount = static_cast<std::ptrdiff_t>(cdf.size() - 1);
+    const auto it = std::upper_bound(cdf.begin(), cdf.end(), u);
+    const auto offset = static_cast<std::uint32_t>(
+        std::clamp<std::ptrdiff_t>(std::distance(cdf.begin(), it) - 1, 0, segmentCount - 1));
+
+    const float width = cdf[offset + 1] - cdf[offset];
+    const float du = width > 0.0f ? (u - cdf[offset]) / width : 0.0f;
+    const float x = (static_cast<float>(offset) + du) / static_cast<float>(segmentCount);
+    return {std::min(x, 1.0f - std::numeric_limits<float>::epsilon()), offset};
+}
+} // namespace
+
+std::vector<float> buildSkyDistribution(
+    const std::span<const float> radianceLut,
+    const glm::vec3&             sunDirection)
+{
+    std::vector<float>     distribution(SKY_DISTRIBUTION_FLOAT_COUNT, 0.0f);
+    const std::span<float> distributionSpan(distribution);
+
+    std::vector<float> rowIntegrals(SKY_DISTRIBUTION_HEIGHT);
+    for (std::uint32_t row = 0; row < SKY_DISTRIBUTION_HEIGHT; ++row)
+    {
+        const float theta = PI * (static_cast<float>(row) + 0.5f) / SKY_DISTRIBUTION_HEIGHT;
+        const float sinTheta = std::sin(theta);
+        const float cosTheta = std::cos(theta);
+
+        const std::span<float> func = funcRow(distributionSpan, row);
+        for (std::uint32_t col = 0; col < SKY_DISTRIBUTION_WIDTH; ++col)
+        {
+            const float     u = (static_cast<float>(col) + 0.5f) / SKY_DISTRIBUTION_WIDTH;
+            const float     phi = 2.0f * PI * u;
+            const glm::vec3 direction(sinTheta * std::cos(phi), cosTheta, sinTheta * std::sin(phi));
+            const float     cosGamma = glm::dot(direction, sunDirection);
+            const glm::vec3 radiance = sampleSkyRadianceLut(radianceLut, cosTheta, cosGamma);
+            // The analytic model can dip slightly below zero close to the horizon.
+            func[col] = std::max(luminance(radiance), 0.0f) * sinTheta;
+        }
+
+        rowIntegrals[row] = buildCdf(func, conditionalCdf(distributionSpan, row));
+    }
+
+    const float integral = buildCdf(rowIntegrals, marginalCdf(distributionSpan));
+    NLRS_ASSERT(integral > 0.0f);
+    distribution[SKY_DISTRIBUTION_INTEGRAL_OFFSET] = integral;
+
+    return distribution;
+}
+
+SkyDirectionSample sampleSkyDistribution(
+    const std::span<const float> distribution,
+    const glm::vec2              u)
+{
+    NLRS_ASSERT(distribution.size() == SKY_DISTRIBUTION_FLOAT_COUNT);
+
+    const auto [v, row] = sampleCdf(marginalCdf(distribution), u.y);
+    const auto [w, col] = sampleCdf(conditionalCdf(distribution, row), u.x);
+
+    const float theta = PI * v;
+    const float phi = 2.0f * PI * w;
+    const float sinTheta = std::sin(theta);
+
+    return SkyDirectionSample{
+        .direction = glm::vec3(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi)),
+        .pdf = cellPdf(distribution, row, col, sinTheta)};
+}
+
+float skyDistributionPdf(const std::span<const float> distribution, const glm::vec3& direction)
+{
+    NLRS_ASSERT(distribution.size() == SKY_DISTRIBUTION_FLOAT_COUNT);
+
+    const float cosTheta = std::clamp(direction.y, -1.0f, 1.0f);
+    const float sinTheta = std::sqrt(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+
+    float phi = std::atan2(direction.z, direction.x);
+    if (phi < 0.0f)
+    {
+        phi += 2.0f * PI;
+    }
+    const float u = phi / (2.0f * PI);
+    const float v = std::acos(cosTheta) / PI;
+
+    const std::uint32_t col = std::min(
+        static_cast<std::uint32_t>(u * SKY_DISTRIBUTION_WIDTH), SKY_DISTRIBUTION_WIDTH - 1);
+    const std::uint32_t row = std::min(
+        static_cast<std::uint32_t>(v * SKY_DISTRIBUTION_HEIGHT), SKY_DISTRIBUTION_HEIGHT - 1);
+
+    return cellPdf(distribution, row, col, sinTheta);
+}
+} // namespace nlrs
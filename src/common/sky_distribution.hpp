@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// A piecewise-constant distribution over directions, proportional to the luminance of the sky dome
+// radiance, for importance sampling the sky.
+//
+// The distribution is a `SKY_DISTRIBUTION_WIDTH` x `SKY_DISTRIBUTION_HEIGHT` grid over `(u, v)` in
+// [0, 1]^2, where `phi = 2 * pi * u` is the azimuth and `theta = pi * v` the zenith angle of the
+// direction `(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi))`. The whole sphere is
+// covered, since the sky radiance below the horizon mirrors the radiance above it. Each cell's
+// luminance is weighted by `sin(theta)`, so that the distribution accounts for the solid angle of
+// the cell.
+//
+// The distribution is stored as a flat array of floats, so that it can be uploaded as is:
+// - the cell weights, `SKY_DISTRIBUTION_HEIGHT` rows of `SKY_DISTRIBUTION_WIDTH` floats,
+// - the conditional CDFs, `SKY_DISTRIBUTION_HEIGHT` rows of `SKY_DISTRIBUTION_WIDTH + 1` floats,
+// - the marginal CDF, `SKY_DISTRIBUTION_HEIGHT + 1` floats,
+// - the integral of the cell weights over `(u, v)`, one float.
+//
+// The solar disk is excluded, just like in the sky radiance LUT. The renderers sample it
+// separately.
+
+inline constexpr std::uint32_t SKY_DISTRIBUTION_WIDTH = 128;
+inline constexpr std::uint32_t SKY_DISTRIBUTION_HEIGHT = 64;
+
+inline constexpr std::size_t SKY_DISTRIBUTION_FUNC_OFFSET = 0;
+inline constexpr std::size_t SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET =
+    SKY_DISTRIBUTION_FUNC_OFFSET + SKY_DISTRIBUTION_WIDTH * SKY_DISTRIBUTION_HEIGHT;
+inline constexpr std::size_t SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET =
+    SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET +
+    (SKY_DISTRIBUTION_WIDTH + 1) * SKY_DISTRIBUTION_HEIGHT;
+inline constexpr std::size_t SKY_DISTRIBUTION_INTEGRAL_OFFSET =
+    SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET + SKY_DISTRIBUTION_HEIGHT + 1;
+inline constexpr std::size_t SKY_DISTRIBUTION_FLOAT_COUNT = SKY_DISTRIBUTION_INTEGRAL_OFFSET + 1;
+
+struct SkyDirectionSample
+{
+    glm::vec3 direction;
+    // The probability density with respect to solid angle.
+    float pdf;
+};
+
+// Builds the distribution from the sky radiance LUT, see `bakeSkyRadianceLut`.
+std::vector<float> buildSkyDistribution(
+    std::span<const float> radianceLut,
+    const glm::vec3&       sunDirection);
+
+// Maps the random numbers `u` in [0, 1)^2 to a direction. Matches `sampleSkyDistribution` in the
+// shaders.
+SkyDirectionSample sampleSkyDistribution(std::span<const float> distribution, glm::vec2 u);
+
+// The probability density, with respect to solid angle, of sampling `direction`. Matches
+// `skyDistributionPdf` in the shaders.
+float skyDistributionPdf(std::span<const float> distribution, const glm::vec3& direction);
+} // namespace nlrs
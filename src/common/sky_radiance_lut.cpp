@@ -0,0 +1,108 @@
+#include "assert.hpp"
+#include "sky_radiance_lut.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <thread>
+
+namespace nlrs
+{
+namespace
+{
+// Matches `SOLAR_RADIUS_RADIANS` in hw_skymodel.c.
+constexpr float SOLAR_RADIUS = 0.004450589f;
+
+void bakeRows(
+    const sky_state&       state,
+    const std::uint32_t    rowBegin,
+    const std::uint32_t    rowEnd,
+    const std::span<float> lut)
+{
+    const float maxCoord = static_cast<float>(SKY_RADIANCE_LUT_SIZE - 1);
+
+    std::array<float, SKY_RADIANCE_LUT_SIZE> thetas;
+    for (std::uint32_t col = 0; col < SKY_RADIANCE_LUT_SIZE; ++col)
+    {
+        const float s = static_cast<float>(col) / maxCoord;
+        const float cosTheta = (s * s) * (s * s);
+        thetas[col] = std::acos(cosTheta);
+    }
+
+    std::array<float, SKY_RADIANCE_LUT_SIZE> gammas;
+    for (std::uint32_t row = rowBegin; row < rowEnd; ++row)
+    {
+        const float t = static_cast<float>(row) / maxCoord;
+        const float gamma = 2.0f * std::asin(t);
+        gammas.fill(gamma);
+
+        const auto rowRadiances =
+            lut.subspan(3 * row * SKY_RADIANCE_LUT_SIZE, 3 * SKY_RADIANCE_LUT_SIZE);
+        sky_state_radiance_batch(
+            &state, thetas.data(), gammas.data(), SKY_RADIANCE_LUT_SIZE, rowRadiances.data());
+
+        // Remove the solar disk, which `sky_state_radiance_batch` includes.
+        if (gamma <= SOLAR_RADIUS)
+        {
+            for (std::size_t i = 0; i < rowRadiances.size(); ++i)
+            {
+                rowRadiances[i] -= state.solar_radiances[i % 3];
+            }
+        }
+    }
+}
+} // namespace
+
+std::vector<float> bakeSkyRadianceLut(const sky_state& state)
+{
+    std::vector<float> lut(SKY_RADIANCE_LUT_FLOAT_COUNT);
+
+    const std::uint32_t threadCount =
+        std::clamp(std::thread::hardware_concurrency(), 1u, SKY_RADIANCE_LUT_SIZE);
+    const std::uint32_t rowsPerThread = (SKY_RADIANCE_LUT_SIZE + threadCount - 1) / threadCount;
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (std::uint32_t rowBegin = 0; rowBegin < SKY_RADIANCE_LUT_SIZE; rowBegin += rowsPerThread)
+    {
+        const std::uint32_t rowEnd = std::min(rowBegin + rowsPerThread, SKY_RADIANCE_LUT_SIZE);
+        threads.emplace_back([&state, rowBegin, rowEnd, &lut]() -> void {
+            bakeRows(state, rowBegin, rowEnd, lut);
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    return lut;
+}
+
+glm::vec3 sampleSkyRadianceLut(
+    const std::span<const float> lut,
+    const float                  cosTheta,
+    const float                  cosGamma)
+{
+    NLRS_ASSERT(lut.size() == SKY_RADIANCE_LUT_FLOAT_COUNT);
+
+    const float maxCoord = static_cast<float>(SKY_RADIANCE_LUT_SIZE - 1);
+    const float s = std::sqrt(std::sqrt(std::abs(cosTheta)));
+    const float t = std::sqrt(std::clamp(0.5f * (1.0f - cosGamma), 0.0f, 1.0f));
+    const float x = std::min(s, 1.0f) * maxCoord;
+    const float y = t * maxCoord;
+
+    const std::uint32_t x0 = std::min(static_cast<std::uint32_t>(x), SKY_RADIANCE_LUT_SIZE - 2);
+    const std::uint32_t y0 = std::min(static_cast<std::uint32_t>(y), SKY_RADIANCE_LUT_SIZE - 2);
+    const float         fx = x - static_cast<float>(x0);
+    const float         fy = y - static_cast<float>(y0);
+
+    const auto entry = [lut](const std::uint32_t col, const std::uint32_t row) -> glm::vec3 {
+        const std::size_t idx = 3 * (static_cast<std::size_t>(row) * SKY_RADIANCE_LUT_SIZE + col);
+        return glm::vec3(lut[idx], lut[idx + 1], lut[idx + 2]);
+    };
+
+    const glm::vec3 r0 = glm::mix(entry(x0, y0), entry(x0 + 1, y0), fx);
+    const glm::vec3 r1 = glm::mix(entry(x0, y0 + 1), entry(x0 + 1, y0 + 1), fx);
+    return glm::mix(r0, r1, fy);
+}
+} // namespace nlrs
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <hw-skymodel/hw_skymodel.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// A lookup table of the Hosek-Wilkie sky dome radiance, so that miss rays don't evaluate the
+// analytic model.
+//
+// The table is parametrized by `s = sqrt(sqrt(cosTheta))` and `t = sin(gamma / 2)`, where theta is
+// the view direction's zenith angle and gamma the angle between the view direction and the sun.
+// Both coordinates are computed from dot products without any inverse trigonometric functions,
+// since `sin(gamma / 2) = sqrt((1 - cosGamma) / 2)`. The radiance changes the fastest near the
+// horizon and near the sun: `s` places many entries near the horizon and `t` is close to linear in
+// gamma near the sun. Like the analytic model, the radiance below the horizon mirrors the radiance
+// above it.
+//
+// The solar disk is a step function, which a table can't represent, so it is excluded. Add
+// `sky_state::solar_radiances` when `cosGamma` is within the solar disk.
+
+inline constexpr std::uint32_t SKY_RADIANCE_LUT_SIZE = 64;
+// Three floats, the RGB radiance, per entry. Entries are stored in rows of constant `t`.
+inline constexpr std::size_t SKY_RADIANCE_LUT_FLOAT_COUNT =
+    3 * SKY_RADIANCE_LUT_SIZE * SKY_RADIANCE_LUT_SIZE;
+
+// Evaluates the analytic sky dome radiance at every table entry, in parallel.
+std::vector<float> bakeSkyRadianceLut(const sky_state& state);
+
+// Bilinearly interpolates the table. Matches `skyDomeRadiance` in the shaders.
+glm::vec3 sampleSkyRadianceLut(std::span<const float> lut, float cosTheta, float cosGamma);
+} // namespace nlrs
@@ -4,11 +4,153 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
-#include <iterator>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define NLRS_SWIZZLE_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define NLRS_TARGET_AVX2
+#else
+#define NLRS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
 namespace nlrs
 {
+namespace
+{
+// Below this many pixels, starting threads costs more than the conversion itself.
+constexpr std::size_t PARALLEL_SWIZZLE_MIN_PIXEL_COUNT = 1 << 20;
+
+void swizzleScalar(const std::uint32_t* src, std::uint32_t* dst, const std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const std::uint32_t px = src[i];
+        dst[i] = (px & 0xff00ff00u) | ((px >> 16) & 0xffu) | ((px & 0xffu) << 16);
+    }
+}
+
+#if defined(NLRS_SWIZZLE_X86)
+// SSE2 is part of x86-64, so this kernel is always available. It lacks a byte shuffle, so the red
+// and blue channels are swapped with shifts and masks instead.
+void swizzleSse2(const std::uint32_t* src, std::uint32_t* dst, const std::size_t count)
+{
+    const __m128i ga = _mm_set1_epi32(static_cast<int>(0xff00ff00u));
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i r = _mm_and_si128(_mm_srli_epi32(px, 16), lowByte);
+        const __m128i b = _mm_slli_epi32(_mm_and_si128(px, lowByte), 16);
+        const __m128i result = _mm_or_si128(_mm_and_si128(px, ga), _mm_or_si128(r, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+    }
+    swizzleScalar(src + i, dst + i, count - i);
+}
+
+NLRS_TARGET_AVX2 void swizzleAvx2(
+    const std::uint32_t* src,
+    std::uint32_t*       dst,
+    const std::size_t    count)
+{
+    // The byte shuffle indices are relative to each 128-bit lane. Each 32-bit entry swaps bytes 0
+    // and 2 of a pixel.
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+        _mm_setr_epi32(0x03000102, 0x07040506, 0x0b08090a, 0x0f0c0d0e));
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(px, shuffle));
+    }
+    swizzleSse2(src + i, dst + i, count - i);
+}
+
+bool cpuSupportsAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    // The OS must save the AVX registers on context switches, as well as the CPU supporting AVX.
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+void swizzleRange(const std::uint32_t* src, std::uint32_t* dst, const std::size_t count)
+{
+#if defined(NLRS_SWIZZLE_X86)
+    static const bool hasAvx2 = cpuSupportsAvx2();
+    if (hasAvx2)
+    {
+        swizzleAvx2(src, dst, count);
+    }
+    else
+    {
+        swizzleSse2(src, dst, count);
+    }
+#else
+    swizzleScalar(src, dst, count);
+#endif
+}
+} // namespace
+
+void swizzleRedBlue(const std::span<const std::uint32_t> src, const std::span<std::uint32_t> dst)
+{
+    assert(src.size() == dst.size());
+
+    const std::size_t count = src.size();
+    const std::size_t threadCount = count < PARALLEL_SWIZZLE_MIN_PIXEL_COUNT
+                                        ? 1
+                                        : std::max(std::thread::hardware_concurrency(), 1u);
+    if (threadCount == 1)
+    {
+        swizzleRange(src.data(), dst.data(), count);
+        return;
+    }
+
+    const std::size_t        chunkSize = (count + threadCount - 1) / threadCount;
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (std::size_t begin = chunkSize; begin < count; begin += chunkSize)
+    {
+        const std::size_t chunkCount = std::min(chunkSize, count - begin);
+        threads.emplace_back([src, dst, begin, chunkCount]() -> void {
+            swizzleRange(src.data() + begin, dst.data() + begin, chunkCount);
+        });
+    }
+    swizzleRange(src.data(), dst.data(), std::min(chunkSize, count));
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
 Texture Texture::fromMemory(std::span<const std::uint8_t> data)
 {
     int width;
@@ -16,6 +158,30 @@ Texture Texture::fromMemory(std::span<const std::uint8_t> data)
     int sourceChannels;
 
     const int desiredChannels = 4;
+
+    if (stbi_is_hdr_from_memory(data.data(), static_cast<int>(data.size())) != 0)
+    {
+        float* const floatPtr = stbi_loadf_from_memory(
+            data.data(),
+            static_cast<int>(data.size()),
+            &width,
+            &height,
+            &sourceChannels,
+            desiredChannels);
+        assert(floatPtr != nullptr);
+
+        const auto dimensions =
+            Dimensions{static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height)};
+        Texture texture = fromRgbaFloat(
+            std::span<const float>(
+                floatPtr, static_cast<std::size_t>(width * height * desiredChannels)),
+            dimensions);
+
+        stbi_image_free(floatPtr);
+
+        return texture;
+    }
+
     // NOTE: desired channels results in RGBA output, regardless of number of source channels.
     // Missing values are filled in -- e.g. when sourceChannels is 3, then the texture is opaque. If
     // desiredChannels is 0, then sourceChannels is used as the number of channels.
@@ -30,27 +196,20 @@ Texture Texture::fromMemory(std::span<const std::uint8_t> data)
     assert(sourceChannels == 3 || sourceChannels == 4);
     assert(pixelPtr != nullptr);
 
+    // stb_image allocates its own output, so the swizzle doubles as the copy into the texture's
+    // final allocation.
     const auto numPixels = static_cast<std::size_t>(width * height);
     const auto pixelData =
         std::span<const std::uint32_t>(reinterpret_cast<const std::uint32_t*>(pixelPtr), numPixels);
-    std::vector<BgraPixel> pixels;
-    pixels.reserve(numPixels);
-    std::transform(
-        pixelData.begin(),
-        pixelData.end(),
-        std::back_inserter(pixels),
-        [](const std::uint32_t& px) -> BgraPixel {
-            const std::uint32_t r = px & 0xffu;
-            const std::uint32_t g = (px >> 8) & 0xffu;
-            const std::uint32_t b = (px >> 16) & 0xffu;
-            return b | (g << 8) | (r << 16) | (255 << 24);
-        });
+    std::vector<BgraPixel> pixels(numPixels);
+    swizzleRedBlue(pixelData, pixels);
 
     stbi_image_free(pixelPtr);
 
     return Texture(
         std::move(pixels),
-        Dimensions{static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height)});
+        Dimensions{static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height)},
+        TextureFormat::Bgra8Srgb);
 }
 
 Texture Texture::fromPixel(float r, float g, float b, float a)
@@ -61,6 +220,67 @@ Texture Texture::fromPixel(float r, float g, float b, float a)
     const std::uint32_t a8 = static_cast<std::uint32_t>(a * 255.0f);
 
     return Texture(
-        std::vector<BgraPixel>{b8 | (g8 << 8) | (r8 << 16) | (a8 << 24)}, Dimensions{1, 1});
+        std::vector<BgraPixel>{b8 | (g8 << 8) | (r8 << 16) | (a8 << 24)},
+        Dimensions{1, 1},
+        TextureFormat::Bgra8Unorm);
+}
+
+Texture Texture::fromRgbaFloat(const std::span<const float> rgba, const Dimensions dimensions)
+{
+    const std::size_t numPixels = static_cast<std::size_t>(dimensions.width) * dimensions.height;
+    assert(rgba.size() == 4 * numPixels);
+
+    std::vector<std::uint32_t> words(2 * numPixels);
+    for (std::size_t i = 0; i < numPixels; ++i)
+    {
+        words[2 * i] = glm::packHalf2x16(glm::vec2(rgba[4 * i], rgba[4 * i + 1]));
+        words[2 * i + 1] = glm::packHalf2x16(glm::vec2(rgba[4 * i + 2], rgba[4 * i + 3]));
+    }
+
+    return Texture(std::move(words), dimensions, TextureFormat::Rgba16Float);
+}
+
+const std::array<float, 256>& srgbToLinearLut()
+{
+    static const std::array<float, 256> lut = []() -> std::array<float, 256> {
+        std::array<float, 256> values;
+        for (std::size_t i = 0; i < values.size(); ++i)
+        {
+            const float c = static_cast<float>(i) / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return lut;
+}
+
+glm::vec3 decodeTexel(const TextureFormat format, const std::span<const std::uint32_t> words)
+{
+    assert(words.size() >= texelWordCount(format));
+
+    switch (format)
+    {
+    case TextureFormat::Bgra8Srgb:
+    {
+        const auto& lut = srgbToLinearLut();
+        return glm::vec3(
+            lut[(words[0] >> 16) & 0xffu], lut[(words[0] >> 8) & 0xffu], lut[words[0] & 0xffu]);
+    }
+    case TextureFormat::Bgra8Unorm:
+        return glm::vec3(
+                   static_cast<float>((words[0] >> 16) & 0xffu),
+                   static_cast<float>((words[0] >> 8) & 0xffu),
+                   static_cast<float>(words[0] & 0xffu)) /
+               255.0f;
+    case TextureFormat::Rgba16Float:
+    {
+        const glm::vec2 rg = glm::unpackHalf2x16(words[0]);
+        const glm::vec2 ba = glm::unpackHalf2x16(words[1]);
+        return glm::vec3(rg.x, rg.y, ba.x);
+    }
+    }
+
+    assert(false);
+    return glm::vec3(0.0f);
 }
 } // namespace nlrs
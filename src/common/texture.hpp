@@ -1,11 +1,32 @@
 #pragma once
 
+#include <glm/glm.hpp>
+
+#include <array>
 #include <cstdint>
 #include <span>
 #include <vector>
 
 namespace nlrs
 {
+// The encoding of a texture's texels, which are stored as 32-bit words.
+//
+// `Bgra8Srgb` texels are sRGB encoded, and are decoded with `srgbToLinearLut`. `Bgra8Unorm` texels
+// are already linear. `Rgba16Float` texels are linear half-precision floats, two words per texel,
+// for HDR textures.
+enum class TextureFormat : std::uint32_t
+{
+    Bgra8Srgb = 0,
+    Bgra8Unorm = 1,
+    Rgba16Float = 2,
+};
+
+// The number of 32-bit words each texel occupies.
+inline constexpr std::uint32_t texelWordCount(const TextureFormat format) noexcept
+{
+    return format == TextureFormat::Rgba16Float ? 2 : 1;
+}
+
 class Texture
 {
 public:
@@ -20,9 +41,13 @@ public:
     };
 
     Texture() = default;
-    Texture(std::vector<BgraPixel>&& pixels, Dimensions dimensions)
+    Texture(
+        std::vector<std::uint32_t>&& pixels,
+        Dimensions                   dimensions,
+        TextureFormat                format = TextureFormat::Bgra8Srgb)
         : mPixels(std::move(pixels)),
-          mDimensions(dimensions)
+          mDimensions(dimensions),
+          mFormat(format)
     {
     }
 
@@ -34,15 +59,35 @@ public:
 
     bool operator==(const Texture&) const = default;
 
-    std::span<const BgraPixel> pixels() const noexcept { return mPixels; }
-    Dimensions                 dimensions() const noexcept { return mDimensions; }
+    // The texels in row-major order, `texelWordCount(format())` words per texel.
+    std::span<const std::uint32_t> pixels() const noexcept { return mPixels; }
+    Dimensions                     dimensions() const noexcept { return mDimensions; }
+    TextureFormat                  format() const noexcept { return mFormat; }
 
-    // `data` is expected to be in RGBA or RGB format, with each component 8 bits.
+    // `data` is expected to be an 8-bit RGBA or RGB image, which results in a `Bgra8Srgb` texture,
+    // or a Radiance HDR image, which results in a `Rgba16Float` texture.
     static Texture fromMemory(std::span<const std::uint8_t> data);
+    // Returns a linear `Bgra8Unorm` texture containing a single pixel.
     static Texture fromPixel(float r, float g, float b, float a);
+    // `rgba` contains four linear floats per pixel, in row-major order.
+    static Texture fromRgbaFloat(std::span<const float> rgba, Dimensions dimensions);
 
 private:
-    std::vector<BgraPixel> mPixels;
-    Dimensions             mDimensions;
+    std::vector<std::uint32_t> mPixels;
+    Dimensions                 mDimensions;
+    TextureFormat              mFormat = TextureFormat::Bgra8Srgb;
 };
+
+// Maps each 8-bit sRGB encoded value to its linear value. Uploaded to the GPU alongside the texture
+// descriptors, so that texture lookups don't evaluate the sRGB transfer function per sample.
+const std::array<float, 256>& srgbToLinearLut();
+
+// Decodes a texel of the given format to linear RGB. `words` contains `texelWordCount(format)`
+// words. Matches `decodeTexel` in the shaders.
+glm::vec3 decodeTexel(TextureFormat format, std::span<const std::uint32_t> words);
+
+// Swaps the first and third byte of each 8-bit four-component pixel, converting RGBA to BGRA and
+// vice versa. `src` and `dst` must have the same size, and may refer to the same pixels. Large
+// images are converted in parallel.
+void swizzleRedBlue(std::span<const std::uint32_t> src, std::span<std::uint32_t> dst);
 } // namespace nlrs
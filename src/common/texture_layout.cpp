@@ -0,0 +1,161 @@
+#include "assert.hpp"
+#include "texture_layout.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+namespace nlrs
+{
+std::size_t packedTexelCount(const Texture::Dimensions dimensions, const TextureLayout layout)
+{
+    switch (layout)
+    {
+    case TextureLayout::RowMajor:
+        return static_cast<std::size_t>(dimensions.width) * dimensions.height;
+    case TextureLayout::Tiled:
+    {
+        const std::size_t tilesX = (dimensions.width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        const std::size_t tilesY = (dimensions.height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        return tilesX * tilesY * TEXTURE_TILE_TEXEL_COUNT;
+    }
+    case TextureLayout::Virtual:
+        break;
+    }
+
+    NLRS_ASSERT(false);
+    return 0;
+}
+
+PackedTextures packTextures(
+    const std::span<const Texture> textures,
+    const TextureLayout            layout,
+    const std::size_t              maxPageWordCount)
+{
+    NLRS_ASSERT(layout != TextureLayout::Virtual);
+
+    // First-fit decreasing: place the largest textures first, each into the first page with enough
+    // room left. Only page sizes and texture offsets are computed here, so that each page can be
+    // allocated exactly once.
+
+    const auto packedWordCount = [layout](const Texture& texture) -> std::size_t {
+        return packedTexelCount(texture.dimensions(), layout) * texelWordCount(texture.format());
+    };
+
+    std::vector<std::size_t> textureOrder(textures.size());
+    std::iota(textureOrder.begin(), textureOrder.end(), std::size_t(0));
+    std::stable_sort(
+        textureOrder.begin(),
+        textureOrder.end(),
+        [textures, packedWordCount](const std::size_t lhs, const std::size_t rhs) -> bool {
+            return packedWordCount(textures[lhs]) > packedWordCount(textures[rhs]);
+        });
+
+    std::vector<TextureDescriptor> descriptors(textures.size());
+    std::vector<std::size_t>       pageWordCounts;
+
+    for (const std::size_t textureIdx : textureOrder)
+    {
+        const auto        dimensions = textures[textureIdx].dimensions();
+        const std::size_t wordCount = packedWordCount(textures[textureIdx]);
+        if (wordCount > maxPageWordCount)
+        {
+            throw std::runtime_error(fmt::format(
+                "Texture {} ({}x{}) does not fit in a texture page of {} words.",
+                textureIdx,
+                dimensions.width,
+                dimensions.height,
+                maxPageWordCount));
+        }
+
+        const auto pageIt = std::find_if(
+            pageWordCounts.begin(),
+            pageWordCounts.end(),
+            [wordCount, maxPageWordCount](const std::size_t pageWordCount) -> bool {
+                return pageWordCount + wordCount <= maxPageWordCount;
+            });
+        const std::size_t pageIdx =
+            static_cast<std::size_t>(std::distance(pageWordCounts.begin(), pageIt));
+        if (pageIt == pageWordCounts.end())
+        {
+            pageWordCounts.push_back(0);
+        }
+
+        descriptors[textureIdx] = TextureDescriptor{
+            .width = dimensions.width,
+            .height = dimensions.height,
+            .page = static_cast<std::uint32_t>(pageIdx),
+            .offset = static_cast<std::uint32_t>(pageWordCounts[pageIdx]),
+            .layout = layout,
+            .format = textures[textureIdx].format(),
+        };
+        pageWordCounts[pageIdx] += wordCount;
+    }
+
+    std::vector<std::vector<std::uint32_t>> pages(pageWordCounts.size());
+    for (std::size_t pageIdx = 0; pageIdx < pages.size(); ++pageIdx)
+    {
+        pages[pageIdx].resize(pageWordCounts[pageIdx], 0);
+    }
+
+    for (std::size_t textureIdx = 0; textureIdx < textures.size(); ++textureIdx)
+    {
+        const TextureDescriptor& desc = descriptors[textureIdx];
+        const auto               pixels = textures[textureIdx].pixels();
+        std::uint32_t* const     dst = pages[desc.page].data() + desc.offset;
+
+        if (layout == TextureLayout::RowMajor)
+        {
+            std::memcpy(dst, pixels.data(), pixels.size() * sizeof(std::uint32_t));
+        }
+        else
+        {
+            const std::uint32_t wordsPerTexel = texelWordCount(desc.format);
+            for (std::uint32_t y = 0; y < desc.height; ++y)
+            {
+                const std::size_t rowOffset = static_cast<std::size_t>(y) * desc.width;
+                for (std::uint32_t x = 0; x < desc.width; ++x)
+                {
+                    std::copy_n(
+                        pixels.begin() + (rowOffset + x) * wordsPerTexel,
+                        wordsPerTexel,
+                        dst + texelIndex(desc, x, y) * wordsPerTexel);
+                }
+            }
+        }
+    }
+
+    return PackedTextures{std::move(descriptors), std::move(pages)};
+}
+
+glm::vec3 textureLookup(
+    const TextureDescriptor&                          desc,
+    const std::span<const std::vector<std::uint32_t>> pages,
+    const float                                       u,
+    const float                                       v)
+{
+    NLRS_ASSERT(desc.layout != TextureLayout::Virtual);
+
+    // Same as WGSL's fract, which differs from `nlrs::fract` for negative values.
+    const auto wgslFract = [](const float x) -> float { return x - std::floor(x); };
+
+    const std::uint32_t x = std::min(
+        static_cast<std::uint32_t>(wgslFract(u) * static_cast<float>(desc.width)), desc.width - 1);
+    const std::uint32_t y = std::min(
+        static_cast<std::uint32_t>(wgslFract(v) * static_cast<float>(desc.height)),
+        desc.height - 1);
+
+    NLRS_ASSERT(desc.page < pages.size());
+    const std::span<const std::uint32_t> words = pages[desc.page];
+    const std::uint32_t                  wordsPerTexel = texelWordCount(desc.format);
+    const std::size_t                    idx =
+        static_cast<std::size_t>(desc.offset) + texelIndex(desc, x, y) * wordsPerTexel;
+    NLRS_ASSERT(idx + wordsPerTexel <= words.size());
+    return decodeTexel(desc.format, words.subspan(idx, wordsPerTexel));
+}
+} // namespace nlrs
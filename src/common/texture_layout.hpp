@@ -0,0 +1,97 @@
+#pragma once
+
+#include "texture.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// The order in which a texture's texels are stored in the packed texture buffer.
+//
+// `RowMajor` stores the texels row by row. `Tiled` stores the texture as a row-major grid of
+// `TEXTURE_TILE_SIZE` x `TEXTURE_TILE_SIZE` tiles, with the texels of each tile in Morton (Z-curve)
+// order. Texel fetches from incoherent secondary rays are then much more likely to hit a cache line
+// which already contains vertically adjacent texels. `Virtual` textures are not stored in the
+// texture pages at all, but streamed in tile by tile, see virtual_texture.hpp.
+enum class TextureLayout : std::uint32_t
+{
+    RowMajor = 0,
+    Tiled = 1,
+    Virtual = 2,
+};
+
+inline constexpr std::uint32_t TEXTURE_TILE_SIZE = 8;
+inline constexpr std::uint32_t TEXTURE_TILE_TEXEL_COUNT = TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE;
+
+// Ensure matches layout of `TextureDescriptor` definition in shaders.
+struct TextureDescriptor
+{
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t page;   // index of the texture page containing the texels
+    std::uint32_t offset; // offset of the texture's first word within the page
+    TextureLayout layout;
+    TextureFormat format;
+
+    bool operator==(const TextureDescriptor&) const noexcept = default;
+};
+
+// Textures are binned into pages of 32-bit words, which are uploaded as separate storage buffers.
+// Each page is sized exactly to the textures it contains.
+struct PackedTextures
+{
+    std::vector<TextureDescriptor>          descriptors;
+    std::vector<std::vector<std::uint32_t>> pages;
+};
+
+// The number of texels the texture occupies in the packed texture buffer. Tiled textures are padded
+// to a whole number of tiles.
+std::size_t packedTexelCount(Texture::Dimensions, TextureLayout);
+
+// Texture descriptors are appended in the order of `textures`, so that indices into `textures` can
+// be used to index the descriptor array. The texture data is binned into pages of at most
+// `maxPageWordCount` words, largest textures first. Throws if a single texture does not fit in a
+// page.
+PackedTextures packTextures(
+    std::span<const Texture> textures,
+    TextureLayout            layout,
+    std::size_t              maxPageWordCount);
+
+// Index of texel (x, y) relative to the texture's offset within its page, in texels. Multiply by
+// `texelWordCount` to get the word index. Matches `texelIndex` in the shaders. Not applicable to
+// `TextureLayout::Virtual`.
+inline std::uint32_t texelIndex(
+    const TextureDescriptor& desc,
+    const std::uint32_t      x,
+    const std::uint32_t      y) noexcept
+{
+    if (desc.layout == TextureLayout::Tiled)
+    {
+        // Spread the lower three bits of v so that there is a zero bit between each bit.
+        const auto part1By1 = [](std::uint32_t v) -> std::uint32_t {
+            v &= 0x7u;
+            v = (v | (v << 2)) & 0x33u;
+            v = (v | (v << 1)) & 0x55u;
+            return v;
+        };
+        const std::uint32_t tilesX = (desc.width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+        const std::uint32_t tileIdx = (y / TEXTURE_TILE_SIZE) * tilesX + (x / TEXTURE_TILE_SIZE);
+        return tileIdx * TEXTURE_TILE_TEXEL_COUNT + (part1By1(x) | (part1By1(y) << 1));
+    }
+
+    return y * desc.width + x;
+}
+
+// Nearest-neighbor lookup with repeat addressing, returning linear RGB. Matches `textureLookup` in
+// the shaders.
+glm::vec3 textureLookup(
+    const TextureDescriptor&                    desc,
+    std::span<const std::vector<std::uint32_t>> pages,
+    float                                       u,
+    float                                       v);
+} // namespace nlrs
@@ -0,0 +1,199 @@
+#include "assert.hpp"
+#include "virtual_texture.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace nlrs
+{
+namespace
+{
+std::uint32_t tileCount(const std::uint32_t texelCount)
+{
+    return (texelCount + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE;
+}
+} // namespace
+
+VirtualTextureTable::VirtualTextureTable(const std::span<const Texture> textures)
+    : mDescriptors(),
+      mTileCount(0)
+{
+    mDescriptors.reserve(textures.size());
+    for (const Texture& texture : textures)
+    {
+        if (texelWordCount(texture.format()) != 1)
+        {
+            throw std::runtime_error(fmt::format(
+                "Texture {} has format {}, but virtual texturing only supports 8-bit formats.",
+                mDescriptors.size(),
+                static_cast<std::uint32_t>(texture.format())));
+        }
+
+        const auto dimensions = texture.dimensions();
+        mDescriptors.push_back(TextureDescriptor{
+            .width = dimensions.width,
+            .height = dimensions.height,
+            .page = 0,
+            .offset = mTileCount,
+            .layout = TextureLayout::Virtual,
+            .format = texture.format(),
+        });
+        mTileCount += tileCount(dimensions.width) * tileCount(dimensions.height);
+    }
+}
+
+std::uint32_t VirtualTextureTable::virtualTileIndex(
+    const std::uint32_t textureIdx,
+    const std::uint32_t x,
+    const std::uint32_t y) const noexcept
+{
+    NLRS_ASSERT(textureIdx < mDescriptors.size());
+    const TextureDescriptor& desc = mDescriptors[textureIdx];
+    NLRS_ASSERT(x < desc.width);
+    NLRS_ASSERT(y < desc.height);
+    return desc.offset + (y / VIRTUAL_TILE_SIZE) * tileCount(desc.width) + x / VIRTUAL_TILE_SIZE;
+}
+
+VirtualTileLocation VirtualTextureTable::tileLocation(
+    const std::uint32_t virtualTile) const noexcept
+{
+    NLRS_ASSERT(virtualTile < mTileCount);
+
+    // The first texture whose tile range starts after the virtual tile is one past the texture
+    // containing the tile. Textures with zero tiles are skipped over by upper_bound.
+    const auto it = std::upper_bound(
+        mDescriptors.begin(),
+        mDescriptors.end(),
+        virtualTile,
+        [](const std::uint32_t tile, const TextureDescriptor& desc) -> bool {
+            return tile < desc.offset;
+        });
+    NLRS_ASSERT(it != mDescriptors.begin());
+
+    const TextureDescriptor& desc = *std::prev(it);
+    const std::uint32_t      localTile = virtualTile - desc.offset;
+    const std::uint32_t      tilesX = tileCount(desc.width);
+
+    return VirtualTileLocation{
+        .textureIdx = static_cast<std::uint32_t>(std::distance(mDescriptors.begin(), it) - 1),
+        .tileX = localTile % tilesX,
+        .tileY = localTile / tilesX,
+    };
+}
+
+void copyVirtualTileTexels(
+    const Texture&                      texture,
+    const std::uint32_t                 tileX,
+    const std::uint32_t                 tileY,
+    const std::span<Texture::BgraPixel> dst)
+{
+    NLRS_ASSERT(dst.size() >= VIRTUAL_TILE_TEXEL_COUNT);
+
+    const auto dimensions = texture.dimensions();
+    const auto pixels = texture.pixels();
+    NLRS_ASSERT(tileX < tileCount(dimensions.width));
+    NLRS_ASSERT(tileY < tileCount(dimensions.height));
+
+    for (std::uint32_t i = 0; i < VIRTUAL_TILE_SIZE; ++i)
+    {
+        const std::uint32_t y = std::min(tileY * VIRTUAL_TILE_SIZE + i, dimensions.height - 1);
+        for (std::uint32_t j = 0; j < VIRTUAL_TILE_SIZE; ++j)
+        {
+            const std::uint32_t x = std::min(tileX * VIRTUAL_TILE_SIZE + j, dimensions.width - 1);
+            dst[i * VIRTUAL_TILE_SIZE + j] =
+                pixels[static_cast<std::size_t>(y) * dimensions.width + x];
+        }
+    }
+}
+
+std::vector<std::uint32_t> aggregateTileRequests(const std::span<const std::uint32_t> feedback)
+{
+    std::vector<std::uint32_t> requests;
+    for (std::size_t virtualTile = 0; virtualTile < feedback.size(); ++virtualTile)
+    {
+        if (feedback[virtualTile] != 0)
+        {
+            requests.push_back(static_cast<std::uint32_t>(virtualTile));
+        }
+    }
+    return requests;
+}
+
+VirtualTileCache::VirtualTileCache(
+    const std::uint32_t virtualTileCount,
+    const std::uint32_t physicalTileCount)
+    : mIndirection(virtualTileCount, INVALID_PHYSICAL_TILE),
+      mPhysicalToVirtual(physicalTileCount, INVALID_PHYSICAL_TILE),
+      mLruTiles(),
+      mLruPositions(),
+      mResidentTileCount(0)
+{
+    mLruPositions.reserve(physicalTileCount);
+    for (std::uint32_t physicalTile = 0; physicalTile < physicalTileCount; ++physicalTile)
+    {
+        mLruPositions.push_back(mLruTiles.insert(mLruTiles.end(), physicalTile));
+    }
+}
+
+std::vector<TileUpload> VirtualTileCache::update(
+    const std::span<const std::uint32_t> requestedTiles,
+    const std::size_t                    maxUploadCount)
+{
+    // Touch all resident tiles first, so that the back of the LRU list only contains tiles which
+    // were not requested in this update.
+    std::size_t touchedTileCount = 0;
+    for (const std::uint32_t virtualTile : requestedTiles)
+    {
+        NLRS_ASSERT(virtualTile < mIndirection.size());
+        const std::uint32_t physicalTile = mIndirection[virtualTile];
+        if (physicalTile != INVALID_PHYSICAL_TILE)
+        {
+            mLruTiles.splice(mLruTiles.begin(), mLruTiles, mLruPositions[physicalTile]);
+            ++touchedTileCount;
+        }
+    }
+
+    std::vector<TileUpload> uploads;
+    for (const std::uint32_t virtualTile : requestedTiles)
+    {
+        if (uploads.size() == maxUploadCount || touchedTileCount == mPhysicalToVirtual.size())
+        {
+            break;
+        }
+
+        if (mIndirection[virtualTile] != INVALID_PHYSICAL_TILE)
+        {
+            continue;
+        }
+
+        const std::uint32_t physicalTile = mLruTiles.back();
+        const std::uint32_t evictedTile = mPhysicalToVirtual[physicalTile];
+        if (evictedTile != INVALID_PHYSICAL_TILE)
+        {
+            mIndirection[evictedTile] = INVALID_PHYSICAL_TILE;
+        }
+        else
+        {
+            ++mResidentTileCount;
+        }
+
+        mIndirection[virtualTile] = physicalTile;
+        mPhysicalToVirtual[physicalTile] = virtualTile;
+        mLruTiles.splice(mLruTiles.begin(), mLruTiles, mLruPositions[physicalTile]);
+        ++touchedTileCount;
+
+        uploads.push_back(TileUpload{virtualTile, physicalTile});
+    }
+
+    return uploads;
+}
+
+bool VirtualTileCache::isResident(const std::uint32_t virtualTile) const noexcept
+{
+    NLRS_ASSERT(virtualTile < mIndirection.size());
+    return mIndirection[virtualTile] != INVALID_PHYSICAL_TILE;
+}
+} // namespace nlrs
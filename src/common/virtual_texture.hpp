@@ -0,0 +1,123 @@
+#pragma once
+
+#include "texture.hpp"
+#include "texture_layout.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// Software virtual texturing.
+//
+// Each texture is split into `VIRTUAL_TILE_SIZE` x `VIRTUAL_TILE_SIZE` tiles. The tiles of all
+// textures are numbered contiguously, texture by texture, giving each tile a virtual tile index.
+// Only a fixed number of physical tiles are resident in GPU memory at a time. The indirection table
+// maps virtual tiles to physical tiles. The shader records the virtual tiles it touches in a
+// feedback buffer, which is read back and used to decide which tiles to stream in, and which least
+// recently used tiles to evict.
+
+inline constexpr std::uint32_t VIRTUAL_TILE_SIZE = 64;
+inline constexpr std::uint32_t VIRTUAL_TILE_TEXEL_COUNT = VIRTUAL_TILE_SIZE * VIRTUAL_TILE_SIZE;
+inline constexpr std::uint32_t INVALID_PHYSICAL_TILE = 0xffffffff;
+
+struct VirtualTileLocation
+{
+    std::uint32_t textureIdx;
+    std::uint32_t tileX;
+    std::uint32_t tileY;
+
+    bool operator==(const VirtualTileLocation&) const noexcept = default;
+};
+
+// The virtual tile ranges of a set of textures. The descriptors use `TextureLayout::Virtual`, with
+// `offset` containing the texture's first virtual tile index. Physical tiles hold one word per
+// texel, so the constructor throws for textures with a wider format.
+class VirtualTextureTable
+{
+public:
+    VirtualTextureTable() = default;
+    explicit VirtualTextureTable(std::span<const Texture> textures);
+
+    std::span<const TextureDescriptor> descriptors() const noexcept { return mDescriptors; }
+    std::uint32_t                      virtualTileCount() const noexcept { return mTileCount; }
+
+    // The virtual tile containing texel (x, y) of the texture. Matches `virtualTexel` in the
+    // lighting pass shader.
+    std::uint32_t virtualTileIndex(
+        std::uint32_t textureIdx,
+        std::uint32_t x,
+        std::uint32_t y) const noexcept;
+    // The texture and tile coordinates of a virtual tile.
+    VirtualTileLocation tileLocation(std::uint32_t virtualTile) const noexcept;
+
+private:
+    std::vector<TextureDescriptor> mDescriptors;
+    std::uint32_t                  mTileCount = 0;
+};
+
+// Copies the texels of tile (tileX, tileY) into `dst`, row by row. Texels outside of the texture
+// are clamped to the texture edge.
+void copyVirtualTileTexels(
+    const Texture&                texture,
+    std::uint32_t                 tileX,
+    std::uint32_t                 tileY,
+    std::span<Texture::BgraPixel> dst);
+
+// Returns the sorted virtual tile indices which have a non-zero entry in the feedback buffer.
+std::vector<std::uint32_t> aggregateTileRequests(std::span<const std::uint32_t> feedback);
+
+struct TileUpload
+{
+    std::uint32_t virtualTile;
+    std::uint32_t physicalTile;
+
+    bool operator==(const TileUpload&) const noexcept = default;
+};
+
+// Assigns physical tiles to virtual tiles with least recently used eviction. Does not own any texel
+// data: the caller streams in the tiles returned by `update`.
+class VirtualTileCache
+{
+public:
+    VirtualTileCache() = default;
+    VirtualTileCache(std::uint32_t virtualTileCount, std::uint32_t physicalTileCount);
+
+    // The LRU positions point into the list, so the cache can be moved but not copied.
+    VirtualTileCache(const VirtualTileCache&) = delete;
+    VirtualTileCache& operator=(const VirtualTileCache&) = delete;
+
+    VirtualTileCache(VirtualTileCache&&) = default;
+    VirtualTileCache& operator=(VirtualTileCache&&) = default;
+
+    // Marks the requested tiles as recently used, and assigns physical tiles to at most
+    // `maxUploadCount` of the requested tiles which are not yet resident. Tiles requested in this
+    // update are never evicted by it. Requests which can't be served remain non-resident and should
+    // be requested again.
+    std::vector<TileUpload> update(
+        std::span<const std::uint32_t> requestedTiles,
+        std::size_t                    maxUploadCount);
+
+    // Maps each virtual tile to a physical tile, or `INVALID_PHYSICAL_TILE`.
+    std::span<const std::uint32_t> indirectionTable() const noexcept { return mIndirection; }
+
+    bool          isResident(std::uint32_t virtualTile) const noexcept;
+    std::uint32_t residentTileCount() const noexcept { return mResidentTileCount; }
+    std::uint32_t physicalTileCount() const noexcept
+    {
+        return static_cast<std::uint32_t>(mPhysicalToVirtual.size());
+    }
+
+private:
+    std::vector<std::uint32_t> mIndirection;
+    std::vector<std::uint32_t> mPhysicalToVirtual;
+    // Physical tiles from most recently used (front) to least recently used (back). Free physical
+    // tiles are at the back.
+    std::list<std::uint32_t>                        mLruTiles;
+    std::vector<std::list<std::uint32_t>::iterator> mLruPositions;
+    std::uint32_t                                   mResidentTileCount = 0;
+};
+} // namespace nlrs
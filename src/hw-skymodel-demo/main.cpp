@@ -43,6 +43,13 @@ int main()
     std::vector<std::uint32_t> pixelData;
     pixelData.reserve(WIDTH * HEIGHT);
 
+    // The sky radiance is evaluated a row at a time, so that the batch function can process all
+    // the pixels of the row at once.
+    std::vector<float> thetas(WIDTH);
+    std::vector<float> gammas(WIDTH);
+    std::vector<bool>  insideHemisphere(WIDTH);
+    std::vector<float> radiances(3 * WIDTH);
+
     for (int i = 0; i < HEIGHT; ++i)
     {
         for (int j = 0; j < WIDTH; ++j)
@@ -61,7 +68,9 @@ int main()
 
             const float radiusSqr = x * x + y * y;
 
-            glm::vec4 rgba = glm::vec4(0.0f);
+            insideHemisphere[j] = radiusSqr < 1.0f;
+            thetas[j] = 0.0f;
+            gammas[j] = 0.0f;
 
             if (radiusSqr < 1.0f)
             {
@@ -70,13 +79,22 @@ int main()
                 const glm::vec3 v = glm::normalize(glm::vec3(x, z, -y));
                 const glm::vec3 s = sunDirection;
 
-                // Compute the sky radiance.
-                const float     theta = std::acos(v.y);
-                const float     gamma = std::acos(std::clamp(glm::dot(v, s), -1.0f, 1.0f));
-                const glm::vec3 radiance = glm::vec3(
-                    sky_state_radiance(&skyState, theta, gamma, channel_r),
-                    sky_state_radiance(&skyState, theta, gamma, channel_g),
-                    sky_state_radiance(&skyState, theta, gamma, channel_b));
+                thetas[j] = std::acos(v.y);
+                gammas[j] = std::acos(std::clamp(glm::dot(v, s), -1.0f, 1.0f));
+            }
+        }
+
+        // Compute the sky radiance.
+        sky_state_radiance_batch(&skyState, thetas.data(), gammas.data(), WIDTH, radiances.data());
+
+        for (int j = 0; j < WIDTH; ++j)
+        {
+            glm::vec4 rgba = glm::vec4(0.0f);
+
+            if (insideHemisphere[j])
+            {
+                const glm::vec3 radiance =
+                    glm::vec3(radiances[3 * j], radiances[3 * j + 1], radiances[3 * j + 2]);
 
                 const glm::vec3 color = expose(radiance, 0.1f);
                 rgba = glm::vec4(color, 1.0f);
@@ -9,12 +9,18 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 static const float PI = (float)M_PI;
 static const float SOLAR_RADIUS_RADIANS = 0.004450589f; // 0.255 degrees
 
+// The batch evaluation processes directions in blocks of this size, so that the per-direction
+// terms fit in small arrays on the stack.
+#define BATCH_BLOCK_SIZE 64
+
 static float quintic_9(const float* const data, const float t)
 {
     const float t2 = t * t;
@@ -221,3 +227,130 @@ float sky_state_radiance(
 
     return r * radiance_dist + solar_radiance;
 }
+
+// exp(x) via 2^x = 2^n * 2^f, with n = round(x / ln 2) and f in [-0.5, 0.5]. 2^f is a degree 6
+// Taylor polynomial, with relative error below 3e-7. Results are clamped to [2^-126, 2^126], which
+// is well outside the range of the sky model terms. Branch-free so that loops calling it
+// vectorize.
+static float fast_exp(const float x)
+{
+    const float LOG2_E = 1.44269504f;
+    const float LN_2 = 0.693147181f;
+
+    float t = x * LOG2_E;
+    t = t < -126.0f ? -126.0f : t;
+    t = t > 126.0f ? 126.0f : t;
+
+    // Round to nearest: truncation of t + 0.5 is floor(t + 0.5) for non-negative values, and one
+    // too large for negative values with a fractional part.
+    const float shifted = t + 0.5f;
+    const float truncated = (float)(int32_t)shifted;
+    const float n = truncated - (truncated > shifted ? 1.0f : 0.0f);
+    const float f = (t - n) * LN_2;
+
+    const float poly =
+        1.0f +
+        f * (1.0f +
+             f * (1.0f / 2.0f +
+                  f * (1.0f / 6.0f +
+                       f * (1.0f / 24.0f + f * (1.0f / 120.0f + f * (1.0f / 720.0f))))));
+
+    const int32_t bits = ((int32_t)n + 127) << 23;
+    float         scale;
+    memcpy(&scale, &bits, sizeof(scale));
+
+    return poly * scale;
+}
+
+// cos(x) via cos(x) = -sin(|x| - π/2), with |x| first reduced to [0, π]. The sine is a degree 11
+// Taylor polynomial on [-π/2, π/2], with absolute error below 1e-7. π/2 is subtracted in two parts,
+// so that the result stays accurate near the horizon, where cos(x) approaches zero.
+static float fast_cos(const float x)
+{
+    const float TWO_PI = 2.0f * PI;
+    const float INV_TWO_PI = 1.0f / TWO_PI;
+    const float HALF_PI_HI = 1.57079637f;
+    const float HALF_PI_LO = -4.37113883e-8f; // π/2 - HALF_PI_HI
+
+    const float a = fabsf(x);
+    const float k = (float)(int32_t)(a * INV_TWO_PI + 0.5f);
+    const float y = (fabsf(a - k * TWO_PI) - HALF_PI_HI) - HALF_PI_LO;
+    const float y2 = y * y;
+
+    const float sin_y =
+        y * (1.0f +
+             y2 * (-1.0f / 6.0f +
+                   y2 * (1.0f / 120.0f +
+                         y2 * (-1.0f / 5040.0f +
+                               y2 * (1.0f / 362880.0f + y2 * (-1.0f / 39916800.0f))))));
+
+    return -sin_y;
+}
+
+void sky_state_radiance_batch(
+    const sky_state* const state,
+    const float* const     thetas,
+    const float* const     gammas,
+    const size_t           n,
+    float* const           out_rgb)
+{
+    // Channel-independent terms, stored as separate arrays so that each loop below is a plain
+    // element-wise loop over a block of directions.
+    float gamma[BATCH_BLOCK_SIZE];
+    float cos_gamma[BATCH_BLOCK_SIZE];
+    float cos_gamma_2[BATCH_BLOCK_SIZE];
+    float zenith[BATCH_BLOCK_SIZE];
+    float inv_cos_theta[BATCH_BLOCK_SIZE];
+    float in_solar_disk[BATCH_BLOCK_SIZE];
+
+    for (size_t begin = 0; begin < n; begin += BATCH_BLOCK_SIZE)
+    {
+        const size_t count = n - begin < BATCH_BLOCK_SIZE ? n - begin : BATCH_BLOCK_SIZE;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float g = gammas[begin + i];
+            const float c = fabsf(fast_cos(thetas[begin + i]));
+            gamma[i] = g;
+            cos_gamma[i] = fast_cos(g);
+            cos_gamma_2[i] = cos_gamma[i] * cos_gamma[i];
+            zenith[i] = sqrtf(c);
+            inv_cos_theta[i] = 1.0f / (c + 0.01f);
+            in_solar_disk[i] = g <= SOLAR_RADIUS_RADIANS ? 1.0f : 0.0f;
+        }
+
+        for (size_t channel_idx = 0; channel_idx < 3; ++channel_idx)
+        {
+            const float  r = state->sky_radiances[channel_idx];
+            const float  solar_radiance = state->solar_radiances[channel_idx];
+            const float* p = state->params + (9 * channel_idx);
+            const float  p0 = p[0];
+            const float  p1 = p[1];
+            const float  p2 = p[2];
+            const float  p3 = p[3];
+            const float  p4 = p[4];
+            const float  p5 = p[5];
+            const float  p6 = p[6];
+            const float  p7 = p[7];
+            const float  p8 = p[8];
+
+            const float mie_base = 1.0f + p8 * p8;
+            float* const out = out_rgb + 3 * begin + channel_idx;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float exp_m = fast_exp(p4 * gamma[i]);
+                const float mie_m_lhs = 1.0f + cos_gamma_2[i];
+                // pow(x, 1.5) = x * sqrt(x)
+                const float mie_m_base = mie_base - 2.0f * p8 * cos_gamma[i];
+                const float mie_m_rhs = mie_m_base * sqrtf(mie_m_base);
+                const float mie_m = mie_m_lhs / mie_m_rhs;
+                const float radiance_lhs = 1.0f + p0 * fast_exp(p1 * inv_cos_theta[i]);
+                const float radiance_rhs =
+                    p2 + p3 * exp_m + p5 * cos_gamma_2[i] + p6 * mie_m + p7 * zenith[i];
+
+                out[3 * i] = r * radiance_lhs * radiance_rhs + in_solar_disk[i] * solar_radiance;
+            }
+        }
+    }
+}
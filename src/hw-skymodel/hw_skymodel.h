@@ -1,6 +1,8 @@
 #ifndef HW_SKYMODEL_INCLUDED
 #define HW_SKYMODEL_INCLUDED
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,6 +45,18 @@ typedef enum channel
 
 float sky_state_radiance(const sky_state* state, float theta, float gamma, channel channel);
 
+// Evaluates the radiance of all three channels for `n` directions. `thetas` and `gammas` contain
+// `n` angles each, and `out_rgb` receives `3 * n` floats, interleaved as RGB triplets. Uses fast
+// exp and cos approximations: for a sun above the horizon, the result is within a relative error of
+// 1e-5 of `sky_state_radiance`. With the sun on the horizon, the model cancels to near zero close
+// to the horizon, and both functions lose precision there.
+void sky_state_radiance_batch(
+    const sky_state* state,
+    const float*     thetas,
+    const float*     gammas,
+    size_t           n,
+    float*           out_rgb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,21 +9,93 @@ extern "C" {
 #include <stb_image_write.h>
 
 #include <algorithm>
-#include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdio>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <numbers>
-#include <numeric>
+#include <optional>
+#include <thread>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 inline constexpr double PI = std::numbers::pi_v<double>;
 inline constexpr double PI_2 = PI / 2.0;
 inline constexpr double DEGREES_TO_RADIANS = PI / 180.0;
 
-inline constexpr int WIDTH = 64;
-inline constexpr int HEIGHT = 64;
+inline constexpr int TURBIDITY_COUNT = 10;
+
+// The spectral range of the sky model.
+inline constexpr double MIN_WAVELENGTH = 320.0;
+inline constexpr double MAX_WAVELENGTH = 720.0;
+// The adaptive wavelength mode doesn't split intervals narrower than this.
+inline constexpr double MIN_WAVELENGTH_INTERVAL = 1.0;
+
+struct Options
+{
+    int resolution = 64;
+    // The number of uniformly spaced wavelengths. In adaptive mode, the initial number of
+    // wavelengths, which are then refined.
+    int wavelengthCount = 11;
+    // If set, the wavelengths are refined until the spectral integral is accurate to this relative
+    // tolerance.
+    std::optional<double> adaptiveTolerance = std::nullopt;
+};
+
+static void printHelp()
+{
+    std::printf(
+        "Usage:\n\thw-sunmodel-integrator [--resolution <pixels>] [--wavelengths <count>] "
+        "[--adaptive <tolerance>]\n");
+}
+
+static std::optional<Options> parseOptions(const int argc, char** const argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (i + 1 == argc)
+        {
+            return std::nullopt;
+        }
+
+        const char* const option = argv[i];
+        const char* const value = argv[++i];
+        char*             end = nullptr;
+        if (std::strcmp(option, "--resolution") == 0)
+        {
+            options.resolution = static_cast<int>(std::strtol(value, &end, 10));
+            if (*end != '\0' || options.resolution < 1)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(option, "--wavelengths") == 0)
+        {
+            options.wavelengthCount = static_cast<int>(std::strtol(value, &end, 10));
+            if (*end != '\0' || options.wavelengthCount < 2)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(option, "--adaptive") == 0)
+        {
+            options.adaptiveTolerance = std::strtod(value, &end);
+            if (*end != '\0' || *options.adaptiveTolerance <= 0.0)
+            {
+                return std::nullopt;
+            }
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
 
 static glm::dvec3 expose(const glm::dvec3& x, const double exposure)
 {
@@ -56,8 +128,10 @@ static double cie1931Z(const double wave)
     return 1.217 * std::exp(-0.5 * t1 * t1) + 0.681 * std::exp(-0.5 * t2 * t2);
 }
 
-constexpr std::array<double, 11> wavelengths =
-    {320.0, 360.0, 400.0, 440.0, 480.0, 520.0, 560.0, 600.0, 640.0, 680.0, 720.0};
+static glm::dvec3 cie1931Xyz(const double wave)
+{
+    return glm::dvec3(cie1931X(wave), cie1931Y(wave), cie1931Z(wave));
+}
 
 // Source: http://www.brucelindbloom.com/index.html?Eqn_RGB_XYZ_Matrix.html
 constexpr glm::dmat3x3 xyzToSrgb(
@@ -68,8 +142,218 @@ constexpr glm::dmat3x3 xyzToSrgb(
     // clang-format on
 );
 
-int main()
+// The wavelengths at which the spectrum is sampled, together with each wavelength's quadrature
+// weight premultiplied by the CIE color matching functions. Integrating a spectrum into XYZ
+// tristimulus values is then a single weighted sum.
+struct SpectralQuadrature
+{
+    std::vector<double>     wavelengths;
+    std::vector<glm::dvec3> xyzWeights;
+};
+
+// Integrates over the sorted `wavelengths` using the trapezoidal rule, which for a non-uniform grid
+// weights each wavelength by half the width of its two neighbouring intervals:
+// https://en.wikipedia.org/wiki/Trapezoidal_rule#Non-uniform_grid
+//
+// The weights are scaled by (count - 1) / count. For a uniform grid, this matches the interval
+// width of range / count which the tables in the tree were generated with.
+static SpectralQuadrature makeSpectralQuadrature(std::vector<double> wavelengths)
+{
+    NLRS_ASSERT(wavelengths.size() >= 2);
+    NLRS_ASSERT(std::is_sorted(wavelengths.begin(), wavelengths.end()));
+
+    const double count = static_cast<double>(wavelengths.size());
+    const double scale = (count - 1.0) / count;
+
+    std::vector<glm::dvec3> xyzWeights;
+    xyzWeights.reserve(wavelengths.size());
+    for (std::size_t idx = 0; idx < wavelengths.size(); ++idx)
+    {
+        const double left = idx > 0 ? wavelengths[idx] - wavelengths[idx - 1] : 0.0;
+        const double right =
+            idx + 1 < wavelengths.size() ? wavelengths[idx + 1] - wavelengths[idx] : 0.0;
+        xyzWeights.push_back(scale * 0.5 * (left + right) * cie1931Xyz(wavelengths[idx]));
+    }
+
+    return SpectralQuadrature{std::move(wavelengths), std::move(xyzWeights)};
+}
+
+static std::vector<double> uniformWavelengths(const int count)
+{
+    std::vector<double> wavelengths(static_cast<std::size_t>(count));
+    for (int idx = 0; idx < count; ++idx)
+    {
+        const double t = static_cast<double>(idx) / static_cast<double>(count - 1);
+        wavelengths[static_cast<std::size_t>(idx)] =
+            MIN_WAVELENGTH + t * (MAX_WAVELENGTH - MIN_WAVELENGTH);
+    }
+    return wavelengths;
+}
+
+// Starting from `initialCount` uniformly spaced wavelengths, bisects each interval until the
+// trapezoidal rule estimate of the XYZ integrand at the center of the solar disk changes by less
+// than `tolerance`, relative to the whole integral. The color matching functions and the limb
+// darkening are smooth, so the refinement concentrates where the integrand curves the most.
+static std::vector<double> adaptiveWavelengths(
+    ArHosekSkyModelState* const skyState,
+    const int                   initialCount,
+    const double                tolerance)
+{
+    const auto integrand = [skyState](const double wavelength) -> glm::dvec3 {
+        const double radiance =
+            arhosekskymodel_solar_disk_radiance(skyState, 0.0, 0.0, wavelength);
+        return radiance * cie1931Xyz(wavelength);
+    };
+
+    const std::vector<double> initial = uniformWavelengths(initialCount);
+    const SpectralQuadrature  coarse = makeSpectralQuadrature(initial);
+    glm::dvec3                integral(0.0);
+    for (std::size_t idx = 0; idx < coarse.wavelengths.size(); ++idx)
+    {
+        const double radiance =
+            arhosekskymodel_solar_disk_radiance(skyState, 0.0, 0.0, coarse.wavelengths[idx]);
+        integral += radiance * coarse.xyzWeights[idx];
+    }
+    const double maxError = tolerance * std::max({integral.x, integral.y, integral.z});
+
+    struct Interval
+    {
+        double     begin;
+        double     end;
+        glm::dvec3 fBegin;
+        glm::dvec3 fEnd;
+    };
+
+    std::vector<double>   wavelengths{initial.front()};
+    std::vector<Interval> intervals;
+    for (std::size_t idx = 0; idx + 1 < initial.size(); ++idx)
+    {
+        intervals.push_back(Interval{
+            initial[idx], initial[idx + 1], integrand(initial[idx]), integrand(initial[idx + 1])});
+
+        // Intervals are refined depth first, left half first, so that the wavelengths are appended
+        // in order.
+        while (!intervals.empty())
+        {
+            const Interval interval = intervals.back();
+            intervals.pop_back();
+
+            const double     width = interval.end - interval.begin;
+            const double     mid = 0.5 * (interval.begin + interval.end);
+            const glm::dvec3 fMid = integrand(mid);
+            const glm::dvec3 coarseEstimate = 0.5 * width * (interval.fBegin + interval.fEnd);
+            const glm::dvec3 fineEstimate =
+                0.25 * width * (interval.fBegin + 2.0 * fMid + interval.fEnd);
+            const glm::dvec3 error = glm::abs(fineEstimate - coarseEstimate);
+
+            if (std::max({error.x, error.y, error.z}) > maxError &&
+                width > 2.0 * MIN_WAVELENGTH_INTERVAL)
+            {
+                intervals.push_back(Interval{mid, interval.end, fMid, interval.fEnd});
+                intervals.push_back(Interval{interval.begin, mid, interval.fBegin, fMid});
+            }
+            else
+            {
+                wavelengths.push_back(interval.end);
+            }
+        }
+    }
+
+    return wavelengths;
+}
+
+// The pixel's coordinates in [-1, 1].
+static std::tuple<double, double> pixelCoordinates(const int i, const int j, const int resolution)
+{
+    // coordinates in [0, 1]
+    const double u = static_cast<double>(j) / static_cast<double>(resolution);
+    const double v = static_cast<double>(i) / static_cast<double>(resolution);
+
+    // coordinates in [-1, 1]
+    const double x = 2.0 * u - 1.0;
+    const double y = 1.0 - 2.0 * v; // flip y so that (left, top) is written first
+
+    return std::make_tuple(x, y);
+}
+
+struct SunImage
 {
+    std::vector<std::uint32_t> pixels;
+    std::vector<glm::dvec3>    radiances;
+};
+
+// Integrates the radiance of row `i` of the solar disk image.
+static void integrateRow(
+    ArHosekSkyModelState* const skyState,
+    const SpectralQuadrature&   quadrature,
+    const glm::dvec3&           sunDirection,
+    const int                   resolution,
+    const int                   i,
+    SunImage&                   image)
+{
+    const double exposure = 0.000002;
+
+    std::vector<double> radiances(quadrature.wavelengths.size());
+    for (int j = 0; j < resolution; ++j)
+    {
+        const auto [x, y] = pixelCoordinates(i, j, resolution);
+
+        const double radiusSqr = x * x + y * y;
+
+        glm::dvec4 rgba = glm::vec4(0.0);
+        glm::dvec3 radiance(0.0);
+
+        if (radiusSqr < 1.0f)
+        {
+            // Pixel is inside the hemisphere, compute the ray direction.
+            const double     z = std::sqrt(1.0 - radiusSqr);
+            const glm::dvec3 v = glm::normalize(glm::vec3(x, z, -y));
+            const glm::dvec3 s = sunDirection;
+
+            // Compute the sky radiance.
+
+            const double theta = std::acos(v.y);
+            const double gamma = std::acos(std::clamp(glm::dot(v, s), -1.0, 1.0));
+
+            const double solarDiskRadius = theta / PI_2;
+            for (std::size_t idx = 0; idx < quadrature.wavelengths.size(); ++idx)
+            {
+                radiances[idx] = arhosekskymodel_solar_disk_radiance(
+                    skyState, gamma, solarDiskRadius, quadrature.wavelengths[idx]);
+            }
+
+            glm::dvec3 xyz(0.0);
+            for (std::size_t idx = 0; idx < radiances.size(); ++idx)
+            {
+                xyz += radiances[idx] * quadrature.xyzWeights[idx];
+            }
+
+            radiance = xyzToSrgb * xyz;
+            const glm::dvec3 color = expose(radiance, exposure);
+            rgba = glm::dvec4(glm::pow(color, glm::dvec3(1 / 2.2)), 1.0);
+        }
+
+        const auto r = static_cast<std::uint32_t>(std::min(rgba.r, 1.0) * 255.0);
+        const auto g = static_cast<std::uint32_t>(std::min(rgba.g, 1.0) * 255.0);
+        const auto b = static_cast<std::uint32_t>(std::min(rgba.b, 1.0) * 255.0);
+        const auto a = static_cast<std::uint32_t>(std::min(rgba.a, 1.0) * 255.0);
+
+        const std::size_t pixelIdx = static_cast<std::size_t>(i * resolution + j);
+        image.pixels[pixelIdx] = (a << 24) | (b << 16) | (g << 8) | r;
+        image.radiances[pixelIdx] = radiance;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::optional<Options> options = parseOptions(argc, argv);
+    if (!options)
+    {
+        printHelp();
+        return 0;
+    }
+    const int resolution = options->resolution;
+
     const double     sunZenith = 30.0 * DEGREES_TO_RADIANS;
     const double     sunAzimuth = 0.0 * DEGREES_TO_RADIANS;
     const glm::dvec3 sunDirection = glm::normalize(glm::dvec3(
@@ -81,137 +365,109 @@ int main()
     const double albedo = 1.0;
 
     std::vector<ArHosekSkyModelState*> skyStates;
-    skyStates.reserve(10);
-    for (int i = 1; i <= 10; ++i)
+    skyStates.reserve(TURBIDITY_COUNT);
+    for (int i = 1; i <= TURBIDITY_COUNT; ++i)
     {
         const double turbidity = static_cast<double>(i);
         skyStates.push_back(arhosekskymodelstate_alloc_init(solarElevation, turbidity, albedo));
     }
 
-    std::vector<glm::dvec3> sunSampleMeans;
-    sunSampleMeans.reserve(skyStates.size());
+    // The color matching function weights only depend on the wavelengths, and so are computed
+    // once per turbidity instead of for every pixel.
+    std::vector<SpectralQuadrature> quadratures;
+    quadratures.reserve(skyStates.size());
     for (auto* skyState : skyStates)
     {
-        std::vector<std::uint32_t> pixelData;
-        pixelData.reserve(static_cast<std::size_t>(WIDTH * HEIGHT));
+        std::vector<double> wavelengths =
+            options->adaptiveTolerance
+                ? adaptiveWavelengths(
+                      skyState, options->wavelengthCount, *options->adaptiveTolerance)
+                : uniformWavelengths(options->wavelengthCount);
+        std::fprintf(
+            stderr,
+            "turbidity %.0f: %zu wavelengths\n",
+            skyState->turbidity,
+            wavelengths.size());
+        quadratures.push_back(makeSpectralQuadrature(std::move(wavelengths)));
+    }
+
+    std::vector<SunImage> images(skyStates.size());
+    for (SunImage& image : images)
+    {
+        const auto pixelCount = static_cast<std::size_t>(resolution * resolution);
+        image.pixels.resize(pixelCount);
+        image.radiances.resize(pixelCount);
+    }
 
-        std::vector<glm::dvec3> sunSamples;
-        sunSamples.reserve(static_cast<std::size_t>(WIDTH * HEIGHT));
+    // Rows of all turbidities are integrated in parallel. Each thread takes the next unprocessed
+    // row until all are done.
+    {
+        const std::size_t        rowCount = skyStates.size() * static_cast<std::size_t>(resolution);
+        std::atomic<std::size_t> nextRow = 0;
 
-        for (int i = 0; i < HEIGHT; ++i)
-        {
-            for (int j = 0; j < WIDTH; ++j)
+        const auto worker = [&]() -> void {
+            for (std::size_t row = nextRow++; row < rowCount; row = nextRow++)
             {
-                const auto [x, y] = [](const int i, const int j) -> std::tuple<double, double> {
-                    // coordinates in [0, 1]
-                    const double u = static_cast<double>(j) / static_cast<double>(WIDTH);
-                    const double v = static_cast<double>(i) / static_cast<double>(HEIGHT);
-
-                    // coordinates in [-1, 1]
-                    const double x = 2.0 * u - 1.0;
-                    const double y = 1.0 - 2.0 * v; // flip y so that (left, top) is written first
+                const std::size_t stateIdx = row / static_cast<std::size_t>(resolution);
+                const int         i = static_cast<int>(row % static_cast<std::size_t>(resolution));
+                integrateRow(
+                    skyStates[stateIdx],
+                    quadratures[stateIdx],
+                    sunDirection,
+                    resolution,
+                    i,
+                    images[stateIdx]);
+            }
+        };
 
-                    return std::make_tuple(x, y);
-                }(i, j);
+        const unsigned int       threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
 
-                const double radiusSqr = x * x + y * y;
+    std::vector<glm::dvec3> sunSampleMeans;
+    sunSampleMeans.reserve(skyStates.size());
+    for (std::size_t stateIdx = 0; stateIdx < skyStates.size(); ++stateIdx)
+    {
+        const SunImage& image = images[stateIdx];
 
-                glm::dvec4 rgba = glm::vec4(0.0);
+        const int numChannels = 4;
+        const int strideBytes = resolution * numChannels;
 
-                if (radiusSqr < 1.0f)
+        const auto filenaname =
+            fmt::format("sundisk-turbidity-{}.png", skyStates[stateIdx]->turbidity);
+        NLRS_ASSERT(
+            stbi_write_png(
+                filenaname.c_str(),
+                resolution,
+                resolution,
+                numChannels,
+                image.pixels.data(),
+                strideBytes) != 0);
+
+        glm::dvec3  sunSampleSum(0.0);
+        std::size_t sunSampleCount = 0;
+        for (int i = 0; i < resolution; ++i)
+        {
+            for (int j = 0; j < resolution; ++j)
+            {
+                const auto [x, y] = pixelCoordinates(i, j, resolution);
+                if (x * x + y * y < 1.0f)
                 {
-                    // Pixel is inside the hemisphere, compute the ray direction.
-                    const double     z = std::sqrt(1.0 - radiusSqr);
-                    const glm::dvec3 v = glm::normalize(glm::vec3(x, z, -y));
-                    const glm::dvec3 s = sunDirection;
-
-                    // Compute the sky radiance.
-
-                    [[maybe_unused]] const double theta = std::acos(v.y);
-                    [[maybe_unused]] const double gamma =
-                        std::acos(std::clamp(glm::dot(v, s), -1.0, 1.0));
-
-                    // Integrate XYZ tristimulus values over the visible spectrum using the
-                    // Trapezoidal rule: https://en.wikipedia.org/wiki/Trapezoidal_rule#Uniform_grid
-
-#if 0
-                    const double           exposure = 0.1;
-                    std::array<double, 11> radiances = {};
-                    for (std::size_t idx = 0; idx < wavelengths.size(); ++idx)
-                    {
-                        radiances[idx] =
-                            arhosekskymodel_radiance(skyState, theta, gamma, wavelengths[idx]);
-                    }
-#else
-                    const double           exposure = 0.000002;
-                    std::array<double, 11> radiances = {};
-                    const double           solarDiskRadius = theta / PI_2;
-                    for (std::size_t idx = 0; idx < wavelengths.size(); ++idx)
-                    {
-                        radiances[idx] = arhosekskymodel_solar_disk_radiance(
-                            skyState, gamma, solarDiskRadius, wavelengths[idx]);
-                    }
-#endif
-
-                    constexpr std::size_t backIdx = wavelengths.size() - 1;
-                    constexpr double      deltaWl = (wavelengths[backIdx] - wavelengths[0]) /
-                                               static_cast<double>(wavelengths.size());
-
-                    NLRS_ASSERT(wavelengths.size() == radiances.size());
-                    double xradiance = 0.5 * (cie1931X(wavelengths[0]) * radiances[0] +
-                                              cie1931X(wavelengths[backIdx]) * radiances[backIdx]);
-                    for (std::size_t idx = 1; idx < backIdx; ++idx)
-                    {
-                        xradiance += cie1931X(wavelengths[idx]) * radiances[idx];
-                    }
-                    xradiance *= deltaWl;
-
-                    double yradiance = 0.5 * (cie1931Y(wavelengths[0]) * radiances[0] +
-                                              cie1931Y(wavelengths[backIdx]) * radiances[backIdx]);
-                    for (std::size_t idx = 1; idx < backIdx; ++idx)
-                    {
-                        yradiance += cie1931Y(wavelengths[idx]) * radiances[idx];
-                    }
-                    yradiance *= deltaWl;
-
-                    double zradiance = 0.5 * (cie1931Z(wavelengths[0]) * radiances[0] +
-                                              cie1931Z(wavelengths[backIdx]) * radiances[backIdx]);
-                    for (std::size_t idx = 1; idx < backIdx; ++idx)
-                    {
-                        zradiance += cie1931Z(wavelengths[idx]) * radiances[idx];
-                    }
-                    zradiance *= deltaWl;
-
-                    const glm::dvec3 radiance =
-                        xyzToSrgb * glm::dvec3(xradiance, yradiance, zradiance);
-                    sunSamples.push_back(radiance);
-                    const glm::dvec3 color = expose(radiance, exposure);
-                    rgba = glm::dvec4(glm::pow(color, glm::dvec3(1 / 2.2)), 1.0);
+                    sunSampleSum += image.radiances[static_cast<std::size_t>(i * resolution + j)];
+                    ++sunSampleCount;
                 }
-
-                const auto r = static_cast<std::uint32_t>(std::min(rgba.r, 1.0) * 255.0);
-                const auto g = static_cast<std::uint32_t>(std::min(rgba.g, 1.0) * 255.0);
-                const auto b = static_cast<std::uint32_t>(std::min(rgba.b, 1.0) * 255.0);
-                const auto a = static_cast<std::uint32_t>(std::min(rgba.a, 1.0) * 255.0);
-
-                const std::uint32_t pixel = (a << 24) | (b << 16) | (g << 8) | r;
-                pixelData.push_back(pixel);
             }
         }
-
-        const int numChannels = 4;
-        const int strideBytes = WIDTH * numChannels;
-
-        const auto filenaname = fmt::format("sundisk-turbidity-{}.png", skyState->turbidity);
-        NLRS_ASSERT(
-            stbi_write_png(
-                filenaname.c_str(), WIDTH, HEIGHT, numChannels, pixelData.data(), strideBytes) !=
-            0);
-
-        const glm::dvec3 sunSampleSum =
-            std::accumulate(sunSamples.begin(), sunSamples.end(), glm::dvec3(0.0));
-        const glm::dvec3 sunSampleMean = sunSampleSum / static_cast<double>(sunSamples.size());
-        sunSampleMeans.push_back(sunSampleMean);
+        sunSampleMeans.push_back(sunSampleSum / static_cast<double>(sunSampleCount));
     }
 
     {
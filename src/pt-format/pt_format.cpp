@@ -220,7 +220,9 @@ void deserialize(InputStream& stream, std::vector<T>& data)
 void serialize(OutputStream& stream, const Texture& texture)
 {
     const auto dimensions = texture.dimensions();
+    const auto format = texture.format();
     stream.write(reinterpret_cast<const char*>(&dimensions), sizeof(Texture::Dimensions));
+    stream.write(reinterpret_cast<const char*>(&format), sizeof(TextureFormat));
     serialize(stream, texture.pixels());
 }
 
@@ -230,12 +232,16 @@ void deserialize(InputStream& stream, Texture& texture)
     NLRS_ASSERT(
         stream.read(reinterpret_cast<char*>(&dimensions), sizeof(Texture::Dimensions)) ==
         sizeof(Texture::Dimensions));
-    std::vector<Texture::BgraPixel> pixels;
+    TextureFormat format;
+    NLRS_ASSERT(
+        stream.read(reinterpret_cast<char*>(&format), sizeof(TextureFormat)) ==
+        sizeof(TextureFormat));
+    std::vector<std::uint32_t> pixels;
     deserialize(stream, pixels);
-    texture = Texture{std::move(pixels), dimensions};
+    texture = Texture{std::move(pixels), dimensions, format};
 }
 
-constexpr std::string_view MAGIC_BYTES = "PTFORMAT3";
+constexpr std::string_view MAGIC_BYTES = "PTFORMAT4";
 
 void serialize(OutputStream& stream, const PtFormat& format)
 {
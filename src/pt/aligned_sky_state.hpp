@@ -1,14 +1,23 @@
 #pragma once
 
+#include "gpu_tracked_buffer.hpp"
+#include "gpu_upload_ring.hpp"
+
 #include <common/assert.hpp>
+#include <common/sky_distribution.hpp>
+#include <common/sky_radiance_lut.hpp>
 #include <common/units/angle.hpp>
 
 #include <glm/glm.hpp>
 #include <hw-skymodel/hw_skymodel.h>
+#include <webgpu/webgpu.h>
 
 #include <array>
+#include <cstddef>
 #include <cstring>
 #include <numbers>
+#include <span>
+#include <vector>
 
 namespace nlrs
 {
@@ -22,14 +31,31 @@ struct Sky
     bool operator==(const Sky&) const noexcept = default;
 };
 
-// A 16-byte aligned sky state for the hw-skymodel library. Matches the layout of the following WGSL
-// struct:
+inline sky_state makeSkyState(const Sky& sky)
+{
+    const float sunZenith = Angle::degrees(sky.sunZenithDegrees).asRadians();
+
+    const sky_params skyParams{
+        .elevation = 0.5f * std::numbers::pi_v<float> - sunZenith,
+        .turbidity = sky.turbidity,
+        .albedo = {sky.albedo[0], sky.albedo[1], sky.albedo[2]}};
+
+    sky_state skyState;
+    NLRS_ASSERT(sky_state_new(&skyParams, &skyState) == sky_state_result_success);
+    return skyState;
+}
+
+// A 16-byte aligned sky state for the hw-skymodel library. Together with the sky radiance LUT and
+// the sky distribution which follow it in the sky state buffer, matches the layout of the
+// following WGSL struct:
 //
 // struct SkyState {
 //     params: array<f32, 27>,
 //     skyRadiances: array<f32, 3>,
 //     solarRadiances: array<f32, 3>,
 //     sunDirection: vec3<f32>,
+//     @align(16) radianceLut: array<f32, SKY_RADIANCE_LUT_FLOAT_COUNT>,
+//     skyDistribution: array<f32, SKY_DISTRIBUTION_FLOAT_COUNT>,
 // };
 struct AlignedSkyState
 {
@@ -56,17 +82,78 @@ struct AlignedSkyState
             std::cos(sunZenith),
             -std::sin(sunZenith) * std::sin(sunAzimuth)));
 
-        const sky_params skyParams{
-            .elevation = 0.5f * std::numbers::pi_v<float> - sunZenith,
-            .turbidity = sky.turbidity,
-            .albedo = {sky.albedo[0], sky.albedo[1], sky.albedo[2]}};
-
-        sky_state skyState;
-        NLRS_ASSERT(sky_state_new(&skyParams, &skyState) == sky_state_result_success);
-
+        const sky_state skyState = makeSkyState(sky);
         std::memcpy(params, skyState.params, sizeof(skyState.params));
         std::memcpy(skyRadiances, skyState.sky_radiances, sizeof(skyState.sky_radiances));
         std::memcpy(solarRadiances, skyState.solar_radiances, sizeof(skyState.solar_radiances));
     }
 };
+
+inline constexpr std::size_t SKY_STATE_RADIANCE_LUT_BYTE_OFFSET = sizeof(AlignedSkyState);
+inline constexpr std::size_t SKY_STATE_DISTRIBUTION_BYTE_OFFSET =
+    SKY_STATE_RADIANCE_LUT_BYTE_OFFSET + SKY_RADIANCE_LUT_FLOAT_COUNT * sizeof(float);
+inline constexpr std::size_t SKY_STATE_BUFFER_BYTE_SIZE =
+    SKY_STATE_DISTRIBUTION_BYTE_OFFSET + SKY_DISTRIBUTION_FLOAT_COUNT * sizeof(float);
+
+// The sky state, the sky radiance LUT and the sky distribution of the most recently used sky.
+// Rebuilding them is costly, so the renderers share one cache, and only rebuild them when the sky
+// changes.
+class SkyStateCache
+{
+public:
+    SkyStateCache()
+        : mSky(),
+          mSkyState(mSky),
+          mRadianceLut(bakeSkyRadianceLut(makeSkyState(mSky))),
+          mDistribution(buildSkyDistribution(mRadianceLut, mSkyState.sunDirection))
+    {
+    }
+
+    // Rebuilds the cached state if `sky` differs from the cached sky. Returns true if the state was
+    // rebuilt.
+    bool update(const Sky& sky)
+    {
+        if (sky == mSky)
+        {
+            return false;
+        }
+        mSky = sky;
+        mSkyState = AlignedSkyState(sky);
+        mRadianceLut = bakeSkyRadianceLut(makeSkyState(sky));
+        mDistribution = buildSkyDistribution(mRadianceLut, mSkyState.sunDirection);
+        return true;
+    }
+
+    const AlignedSkyState& skyState() const noexcept { return mSkyState; }
+    std::span<const float> radianceLut() const noexcept { return mRadianceLut; }
+    std::span<const float> distribution() const noexcept { return mDistribution; }
+
+private:
+    Sky                mSky;
+    AlignedSkyState    mSkyState;
+    std::vector<float> mRadianceLut;
+    std::vector<float> mDistribution;
+};
+
+// Writes the sky state, followed by the sky radiance LUT and the sky distribution, to a buffer of
+// `SKY_STATE_BUFFER_BYTE_SIZE` bytes. Returns the number of bytes written.
+inline std::size_t writeSkyState(
+    GpuUploadRing&           uploadRing,
+    const WGPUCommandEncoder encoder,
+    GpuTrackedBuffer&        buffer,
+    const SkyStateCache&     cache)
+{
+    NLRS_ASSERT(buffer.byteSize() == SKY_STATE_BUFFER_BYTE_SIZE);
+    return buffer.write(uploadRing, encoder, cache.skyState()) +
+           buffer.write(
+               uploadRing,
+               encoder,
+               SKY_STATE_RADIANCE_LUT_BYTE_OFFSET,
+               std::as_bytes(cache.radianceLut())) +
+           buffer.write(
+               uploadRing,
+               encoder,
+               SKY_STATE_DISTRIBUTION_BYTE_OFFSET,
+               std::as_bytes(cache.distribution()));
+}
 } // namespace nlrs
@@ -0,0 +1,106 @@
+#include "async_pipeline.hpp"
+#include "webgpu_utils.hpp"
+
+#include <common/assert.hpp>
+
+#include <cstdio>
+#include <utility>
+
+namespace nlrs
+{
+namespace
+{
+void pipelineSafeRelease(const WGPUComputePipeline pipeline) noexcept
+{
+    computePipelineSafeRelease(pipeline);
+}
+
+void pipelineSafeRelease(const WGPURenderPipeline pipeline) noexcept
+{
+    renderPipelineSafeRelease(pipeline);
+}
+
+template<typename State, typename Pipeline>
+void onPipelineCreated(
+    const WGPUCreatePipelineAsyncStatus status,
+    const Pipeline                      pipeline,
+    const char* const                   message,
+    void* const                         userdata)
+{
+    // The callback owns a reference to the state, so that it stays alive if the pipeline is
+    // destroyed while compiling.
+    const std::unique_ptr<std::shared_ptr<State>> state(
+        static_cast<std::shared_ptr<State>*>(userdata));
+    if (status != WGPUCreatePipelineAsyncStatus_Success)
+    {
+        std::fprintf(stderr, "Failed to create pipeline: %s\n", message);
+        (*state)->hasFailed = true;
+        return;
+    }
+    if ((*state)->isOrphaned)
+    {
+        pipelineSafeRelease(pipeline);
+        return;
+    }
+    (*state)->pipeline = pipeline;
+}
+} // namespace
+
+template<typename Pipeline>
+AsyncPipeline<Pipeline>::AsyncPipeline(const WGPUDevice device, const Descriptor& desc)
+    : mState(std::make_shared<State>())
+{
+    NLRS_ASSERT(device != nullptr);
+    if constexpr (std::is_same_v<Pipeline, WGPUComputePipeline>)
+    {
+        wgpuDeviceCreateComputePipelineAsync(
+            device, &desc, onPipelineCreated<State, Pipeline>, new std::shared_ptr<State>(mState));
+    }
+    else
+    {
+        wgpuDeviceCreateRenderPipelineAsync(
+            device, &desc, onPipelineCreated<State, Pipeline>, new std::shared_ptr<State>(mState));
+    }
+}
+
+template<typename Pipeline>
+AsyncPipeline<Pipeline>::AsyncPipeline(AsyncPipeline&& other) noexcept
+{
+    if (this != &other)
+    {
+        mState = std::move(other.mState);
+    }
+}
+
+template<typename Pipeline>
+AsyncPipeline<Pipeline>& AsyncPipeline<Pipeline>::operator=(AsyncPipeline&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        mState = std::move(other.mState);
+    }
+    return *this;
+}
+
+template<typename Pipeline>
+AsyncPipeline<Pipeline>::~AsyncPipeline()
+{
+    release();
+}
+
+template<typename Pipeline>
+void AsyncPipeline<Pipeline>::release() noexcept
+{
+    if (mState)
+    {
+        pipelineSafeRelease(mState->pipeline);
+        mState->pipeline = nullptr;
+        mState->isOrphaned = true;
+        mState.reset();
+    }
+}
+
+template class AsyncPipeline<WGPUComputePipeline>;
+template class AsyncPipeline<WGPURenderPipeline>;
+} // namespace nlrs
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <webgpu/webgpu.h>
+
+#include <memory>
+#include <type_traits>
+
+namespace nlrs
+{
+// A compute or render pipeline which is compiled asynchronously, so that the pipelines of all
+// renderers compile in parallel at startup instead of blocking their constructors one at a time.
+// The pipeline becomes available once the device has been ticked after its compilation.
+template<typename Pipeline>
+class AsyncPipeline
+{
+public:
+    using Descriptor = std::conditional_t<
+        std::is_same_v<Pipeline, WGPUComputePipeline>,
+        WGPUComputePipelineDescriptor,
+        WGPURenderPipelineDescriptor>;
+
+    AsyncPipeline() = default;
+    // Starts compiling the pipeline. The descriptor only needs to outlive the call.
+    AsyncPipeline(WGPUDevice, const Descriptor&);
+
+    AsyncPipeline(const AsyncPipeline&) = delete;
+    AsyncPipeline& operator=(const AsyncPipeline&) = delete;
+
+    AsyncPipeline(AsyncPipeline&&) noexcept;
+    AsyncPipeline& operator=(AsyncPipeline&&) noexcept;
+
+    ~AsyncPipeline();
+
+    // Null while the pipeline is compiling, or if its compilation failed.
+    Pipeline get() const noexcept { return mState ? mState->pipeline : nullptr; }
+    bool     isReady() const noexcept { return get() != nullptr; }
+    // A failed pipeline never becomes ready.
+    bool     hasFailed() const noexcept { return mState && mState->hasFailed; }
+
+private:
+    struct State
+    {
+        Pipeline pipeline = nullptr;
+        bool     hasFailed = false;
+        // Set when the pipeline is destroyed before its compilation has completed.
+        bool     isOrphaned = false;
+    };
+
+    void release() noexcept;
+
+    std::shared_ptr<State> mState;
+};
+
+using AsyncComputePipeline = AsyncPipeline<WGPUComputePipeline>;
+using AsyncRenderPipeline = AsyncPipeline<WGPURenderPipeline>;
+
+extern template class AsyncPipeline<WGPUComputePipeline>;
+extern template class AsyncPipeline<WGPURenderPipeline>;
+} // namespace nlrs
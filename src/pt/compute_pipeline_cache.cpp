@@ -0,0 +1,111 @@
+#include "compute_pipeline_cache.hpp"
+#include "webgpu_utils.hpp"
+
+#include <common/assert.hpp>
+
+#include <utility>
+
+namespace nlrs
+{
+ComputePipelineCache::ComputePipelineCache(
+    const WGPUDevice                         device,
+    const WGPUPipelineLayout                 layout,
+    const WGPUShaderModule                   module,
+    const char* const                        entryPoint,
+    const std::span<const WGPUConstantEntry> baseConstants,
+    const std::span<const char* const>       specializationKeys)
+    : mDevice(device),
+      mLayout(layout),
+      mModule(module),
+      mEntryPoint(entryPoint),
+      mBaseConstants(baseConstants.begin(), baseConstants.end()),
+      mSpecializationKeys(specializationKeys.begin(), specializationKeys.end()),
+      mEntries()
+{
+    NLRS_ASSERT(mDevice != nullptr);
+    NLRS_ASSERT(mLayout != nullptr);
+    NLRS_ASSERT(mModule != nullptr);
+}
+
+ComputePipelineCache::ComputePipelineCache(ComputePipelineCache&& other) noexcept
+{
+    if (this != &other)
+    {
+        mDevice = std::exchange(other.mDevice, nullptr);
+        mLayout = std::exchange(other.mLayout, nullptr);
+        mModule = std::exchange(other.mModule, nullptr);
+        mEntryPoint = std::exchange(other.mEntryPoint, nullptr);
+        mBaseConstants = std::move(other.mBaseConstants);
+        mSpecializationKeys = std::move(other.mSpecializationKeys);
+        mEntries = std::move(other.mEntries);
+    }
+}
+
+ComputePipelineCache& ComputePipelineCache::operator=(ComputePipelineCache&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        mDevice = std::exchange(other.mDevice, nullptr);
+        mLayout = std::exchange(other.mLayout, nullptr);
+        mModule = std::exchange(other.mModule, nullptr);
+        mEntryPoint = std::exchange(other.mEntryPoint, nullptr);
+        mBaseConstants = std::move(other.mBaseConstants);
+        mSpecializationKeys = std::move(other.mSpecializationKeys);
+        mEntries = std::move(other.mEntries);
+    }
+    return *this;
+}
+
+ComputePipelineCache::~ComputePipelineCache() { release(); }
+
+WGPUComputePipeline ComputePipelineCache::pipeline(
+    const std::span<const double> specializationValues)
+{
+    NLRS_ASSERT(mDevice != nullptr);
+    NLRS_ASSERT(specializationValues.size() == mSpecializationKeys.size());
+
+    std::vector<double> key(specializationValues.begin(), specializationValues.end());
+    const auto it = mEntries.find(key);
+    if (it != mEntries.end())
+    {
+        return it->second.get();
+    }
+
+    std::vector<WGPUConstantEntry> constants = mBaseConstants;
+    for (std::size_t i = 0; i < mSpecializationKeys.size(); ++i)
+    {
+        constants.push_back(WGPUConstantEntry{
+            .nextInChain = nullptr,
+            .key = mSpecializationKeys[i],
+            .value = specializationValues[i],
+        });
+    }
+
+    const WGPUComputePipelineDescriptor pipelineDesc{
+        .nextInChain = nullptr,
+        .label = mEntryPoint,
+        .layout = mLayout,
+        .compute =
+            WGPUProgrammableStageDescriptor{
+                .nextInChain = nullptr,
+                .module = mModule,
+                .entryPoint = mEntryPoint,
+                .constantCount = constants.size(),
+                .constants = constants.data(),
+            },
+    };
+
+    mEntries.emplace(std::move(key), AsyncComputePipeline(mDevice, pipelineDesc));
+    return nullptr;
+}
+
+void ComputePipelineCache::release() noexcept
+{
+    mEntries.clear();
+    pipelineLayoutSafeRelease(mLayout);
+    mLayout = nullptr;
+    shaderModuleSafeRelease(mModule);
+    mModule = nullptr;
+}
+} // namespace nlrs
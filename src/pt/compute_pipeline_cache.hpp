@@ -0,0 +1,56 @@
+#pragma once
+
+#include "async_pipeline.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <map>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// Specializes a compute shader entry point by setting its pipeline-overridable constants, and
+// caches the pipelines by the values of the specialization constants. The pipelines are compiled
+// asynchronously, see `AsyncPipeline`.
+class ComputePipelineCache
+{
+public:
+    ComputePipelineCache() = default;
+
+    // Takes ownership of `layout` and `module`. The `baseConstants` are set in every pipeline,
+    // e.g. the workgroup size. `specializationKeys` are the names of the override constants which
+    // vary between the pipelines.
+    ComputePipelineCache(
+        WGPUDevice                         device,
+        WGPUPipelineLayout                 layout,
+        WGPUShaderModule                   module,
+        const char*                        entryPoint,
+        std::span<const WGPUConstantEntry> baseConstants,
+        std::span<const char* const>       specializationKeys);
+
+    ComputePipelineCache(const ComputePipelineCache&) = delete;
+    ComputePipelineCache& operator=(const ComputePipelineCache&) = delete;
+
+    ComputePipelineCache(ComputePipelineCache&&) noexcept;
+    ComputePipelineCache& operator=(ComputePipelineCache&&) noexcept;
+
+    ~ComputePipelineCache();
+
+    // Returns the pipeline specialized with `specializationValues`, which match the
+    // `specializationKeys` in order. Returns null while the pipeline is compiling, and starts
+    // compiling it if it hasn't been requested before.
+    WGPUComputePipeline pipeline(std::span<const double> specializationValues);
+
+private:
+    void release() noexcept;
+
+    WGPUDevice                                          mDevice = nullptr;
+    WGPUPipelineLayout                                  mLayout = nullptr;
+    WGPUShaderModule                                    mModule = nullptr;
+    const char*                                         mEntryPoint = nullptr;
+    std::vector<WGPUConstantEntry>                      mBaseConstants;
+    std::vector<const char*>                            mSpecializationKeys;
+    std::map<std::vector<double>, AsyncComputePipeline> mEntries;
+};
+} // namespace nlrs
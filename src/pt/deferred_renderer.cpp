@@ -13,7 +13,9 @@
 #include <algorithm>
 #include <array>
 #include <bit>
-#include <numeric>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
 
 namespace nlrs
 {
@@ -22,6 +24,8 @@ namespace
 const WGPUTextureFormat DEPTH_TEXTURE_FORMAT = WGPUTextureFormat_Depth32Float;
 const WGPUTextureFormat ALBEDO_TEXTURE_FORMAT = WGPUTextureFormat_BGRA8Unorm;
 const WGPUTextureFormat NORMAL_TEXTURE_FORMAT = WGPUTextureFormat_RGBA16Float;
+// The combined texel size of the depth, albedo and normal textures.
+constexpr std::uint64_t GBUFFER_TEXEL_BYTE_SIZE = 4 + 4 + 8;
 
 struct TimestampsLayout
 {
@@ -29,13 +33,42 @@ struct TimestampsLayout
     std::uint64_t gbufferPassEnd;
     std::uint64_t lightingPassStart;
     std::uint64_t lightingPassEnd;
+    std::uint64_t denoisePassStart;
+    std::uint64_t denoisePassEnd;
     std::uint64_t resolvePassStart;
     std::uint64_t resolvePassEnd;
 
-    static constexpr std::uint32_t QUERY_COUNT = 6;
+    static constexpr std::uint32_t QUERY_COUNT = 8;
     static constexpr std::size_t   MEMBER_SIZE = sizeof(std::uint64_t);
 };
 
+// The lighting resolutions which the dynamic resolution steps through, from the highest to the
+// lowest, and the fraction of pixels traced at each.
+constexpr std::array<LightingResolution, 3> DYNAMIC_LIGHTING_RESOLUTIONS{
+    LightingResolution::Full,
+    LightingResolution::Checkerboard,
+    LightingResolution::Half};
+constexpr std::array<float, 3> DYNAMIC_LIGHTING_RESOLUTION_COSTS{1.0f, 0.5f, 0.25f};
+
+// Bounds the per-frame cost of streaming virtual texture tiles to 1 MiB.
+constexpr std::size_t MAX_VIRTUAL_TILE_UPLOADS_PER_FRAME = 64;
+
+WGPUTextureFormat gpuTextureFormat(const TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::Bgra8Srgb:
+        return WGPUTextureFormat_BGRA8UnormSrgb;
+    case TextureFormat::Bgra8Unorm:
+        return WGPUTextureFormat_BGRA8Unorm;
+    case TextureFormat::Rgba16Float:
+        return WGPUTextureFormat_RGBA16Float;
+    }
+
+    NLRS_ASSERT(false);
+    return WGPUTextureFormat_Undefined;
+}
+
 WGPUTexture createGbufferTexture(
     const WGPUDevice            device,
     const char* const           label,
@@ -76,8 +109,30 @@ WGPUTextureView createGbufferTextureView(
     };
     return wgpuTextureCreateView(texture, &desc);
 }
+
+struct MapResult
+{
+    WGPUBufferMapAsyncStatus status = WGPUBufferMapAsyncStatus_Unknown;
+    bool                     done = false;
+};
 } // namespace
 
+const char* lightingResolutionName(const LightingResolution lightingResolution)
+{
+    switch (lightingResolution)
+    {
+    case LightingResolution::Full:
+        return "full";
+    case LightingResolution::Half:
+        return "half";
+    case LightingResolution::Checkerboard:
+        return "checkerboard";
+    }
+
+    NLRS_ASSERT(false);
+    return "";
+}
+
 DeferredRenderer::DeferredRenderer(
     const GpuContext&                 gpuContext,
     const DeferredRendererDescriptor& rendererDesc)
@@ -91,25 +146,33 @@ DeferredRenderer::DeferredRenderer(
           gpuContext.device,
           "Deferred renderer :: sample buffer",
           GpuBufferUsages{GpuBufferUsage::Storage},
-          3 * sizeof(float) * area(rendererDesc.maxFramebufferSize)),
-      mQuerySet(nullptr),
-      mQueryBuffer(
-          gpuContext.device,
-          "Deferred renderer query buffer",
-          {GpuBufferUsage::QueryResolve, GpuBufferUsage::CopySrc},
-          sizeof(TimestampsLayout)),
-      mTimestampsBuffer(
-          gpuContext.device,
-          "Deferred renderer timestamp buffer",
-          {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
-          sizeof(TimestampsLayout)),
+          3 * sizeof(float) * area(rendererDesc.maxFramebufferSize),
+          GpuMemoryCategory::Accumulation),
+      mTimestamps(gpuContext.device, "Deferred renderer timestamps", TimestampsLayout::QUERY_COUNT),
+      mUploadRing(gpuContext.device),
       mGbufferPass(gpuContext, rendererDesc),
       mDebugPass(),
       mLightingPass(),
+      mDenoisePass(),
       mResolvePass(),
-      mGbufferPassDurationsNs(),
-      mLightingPassDurationsNs(),
-      mFrameCount(0)
+      mGbufferPassDurations(),
+      mLightingPassDurations(),
+      mDenoisePassDurations(),
+      mResolvePassDurations(),
+      mRenderCpuDurations(),
+      mFrameCount(0),
+      mPreviousViewProjectionMat(1.0f),
+      mGbufferAllocation(
+          "Gbuffer textures",
+          GpuMemoryCategory::Gbuffer,
+          GBUFFER_TEXEL_BYTE_SIZE * area(rendererDesc.framebufferSize)),
+      mDynamicResolution(
+          rendererDesc.targetFrameMs > 0.0f
+              ? DynamicResolutionController(
+                    rendererDesc.targetFrameMs,
+                    DYNAMIC_LIGHTING_RESOLUTION_COSTS)
+              : DynamicResolutionController()),
+      mLightingResolution(LightingResolution::Full)
 {
     {
         const std::array<WGPUTextureFormat, 1> depthFormats{
@@ -169,15 +232,6 @@ DeferredRenderer::DeferredRenderer(
         mNormalTexture, "Gbuffer normal texture view", NORMAL_TEXTURE_FORMAT);
     NLRS_ASSERT(mNormalTextureView != nullptr);
 
-    {
-        const WGPUQuerySetDescriptor querySetDesc{
-            .nextInChain = nullptr,
-            .label = "Deferred renderer query set",
-            .type = WGPUQueryType_Timestamp,
-            .count = TimestampsLayout::QUERY_COUNT};
-        mQuerySet = wgpuDeviceCreateQuerySet(gpuContext.device, &querySetDesc);
-    }
-
     mDebugPass = DebugPass{
         gpuContext,
         mAlbedoTextureView,
@@ -193,14 +247,24 @@ DeferredRenderer::DeferredRenderer(
         rendererDesc.sceneBvhNodes,
         rendererDesc.scenePositionAttributes,
         rendererDesc.sceneVertexAttributes,
-        rendererDesc.sceneBaseColorTextures};
-    mResolvePass = ResolvePass{gpuContext, mSampleBuffer, rendererDesc};
+        rendererDesc.sceneBaseColorTextures,
+        rendererDesc.textureLayout,
+        rendererDesc.virtualTexturePhysicalTileCount,
+        rendererDesc.skyStateCache,
+        rendererDesc.numBounces};
+    mDenoisePass = DenoisePass{
+        gpuContext,
+        mAlbedoTextureView,
+        mNormalTextureView,
+        mDepthTextureView,
+        mSampleBuffer,
+        rendererDesc};
+    mResolvePass = ResolvePass{
+        gpuContext, mNormalTextureView, mDepthTextureView, mSampleBuffer, rendererDesc};
 }
 
 DeferredRenderer::~DeferredRenderer()
 {
-    querySetSafeRelease(mQuerySet);
-    mQuerySet = nullptr;
     textureViewSafeRelease(mNormalTextureView);
     mNormalTextureView = nullptr;
     textureSafeRelease(mNormalTexture);
@@ -232,17 +296,23 @@ DeferredRenderer::DeferredRenderer(DeferredRenderer&& other)
         mNormalTextureView = other.mNormalTextureView;
         other.mNormalTextureView = nullptr;
         mSampleBuffer = std::move(other.mSampleBuffer);
-        mQuerySet = other.mQuerySet;
-        other.mQuerySet = nullptr;
-        mQueryBuffer = std::move(other.mQueryBuffer);
-        mTimestampsBuffer = std::move(other.mTimestampsBuffer);
+        mTimestamps = std::move(other.mTimestamps);
+        mUploadRing = std::move(other.mUploadRing);
         mGbufferPass = std::move(other.mGbufferPass);
         mDebugPass = std::move(other.mDebugPass);
         mLightingPass = std::move(other.mLightingPass);
+        mDenoisePass = std::move(other.mDenoisePass);
         mResolvePass = std::move(other.mResolvePass);
-        mGbufferPassDurationsNs = std::move(other.mGbufferPassDurationsNs);
-        mLightingPassDurationsNs = std::move(other.mLightingPassDurationsNs);
+        mGbufferPassDurations = other.mGbufferPassDurations;
+        mLightingPassDurations = other.mLightingPassDurations;
+        mDenoisePassDurations = other.mDenoisePassDurations;
+        mResolvePassDurations = other.mResolvePassDurations;
+        mRenderCpuDurations = other.mRenderCpuDurations;
         mFrameCount = other.mFrameCount;
+        mPreviousViewProjectionMat = other.mPreviousViewProjectionMat;
+        mGbufferAllocation = std::move(other.mGbufferAllocation);
+        mDynamicResolution = std::move(other.mDynamicResolution);
+        mLightingResolution = other.mLightingResolution;
     }
 }
 
@@ -269,32 +339,62 @@ DeferredRenderer& DeferredRenderer::operator=(DeferredRenderer&& other)
         mNormalTextureView = other.mNormalTextureView;
         other.mNormalTextureView = nullptr;
         mSampleBuffer = std::move(other.mSampleBuffer);
-        querySetSafeRelease(mQuerySet);
-        mQuerySet = other.mQuerySet;
-        other.mQuerySet = nullptr;
-        mQueryBuffer = std::move(other.mQueryBuffer);
-        mTimestampsBuffer = std::move(other.mTimestampsBuffer);
+        mTimestamps = std::move(other.mTimestamps);
+        mUploadRing = std::move(other.mUploadRing);
         mGbufferPass = std::move(other.mGbufferPass);
         mDebugPass = std::move(other.mDebugPass);
         mLightingPass = std::move(other.mLightingPass);
+        mDenoisePass = std::move(other.mDenoisePass);
         mResolvePass = std::move(other.mResolvePass);
-        mGbufferPassDurationsNs = std::move(other.mGbufferPassDurationsNs);
-        mLightingPassDurationsNs = std::move(other.mLightingPassDurationsNs);
+        mGbufferPassDurations = other.mGbufferPassDurations;
+        mLightingPassDurations = other.mLightingPassDurations;
+        mDenoisePassDurations = other.mDenoisePassDurations;
+        mResolvePassDurations = other.mResolvePassDurations;
+        mRenderCpuDurations = other.mRenderCpuDurations;
         mFrameCount = other.mFrameCount;
+        mPreviousViewProjectionMat = other.mPreviousViewProjectionMat;
+        mGbufferAllocation = std::move(other.mGbufferAllocation);
+        mDynamicResolution = std::move(other.mDynamicResolution);
+        mLightingResolution = other.mLightingResolution;
     }
     return *this;
 }
 
+bool DeferredRenderer::isReady() const
+{
+    return mGbufferPass.isReady() && mLightingPass.isReady() && mDenoisePass.isReady() &&
+           mResolvePass.isReady();
+}
+
+bool DeferredRenderer::isDebugReady() const
+{
+    return mGbufferPass.isReady() && mDebugPass.isReady();
+}
+
+bool DeferredRenderer::hasFailed() const
+{
+    return mGbufferPass.hasFailed() || mLightingPass.hasFailed() || mDenoisePass.hasFailed() ||
+           mResolvePass.hasFailed();
+}
+
+bool DeferredRenderer::hasDebugFailed() const
+{
+    return mGbufferPass.hasFailed() || mDebugPass.hasFailed();
+}
+
 void DeferredRenderer::render(
     const GpuContext&       gpuContext,
     const RenderDescriptor& renderDesc,
-    Gui&                    gui)
+    Gui*                    gui)
 {
-    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
-    do
-    {
-        wgpuDeviceTick(gpuContext.device);
-    } while (wgpuBufferGetMapState(mTimestampsBuffer.ptr()) != WGPUBufferMapState_Unmapped);
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations. The timestamps of
+    // earlier frames are consumed as their readbacks complete, without waiting for them.
+    wgpuDeviceTick(gpuContext.device);
+    NLRS_ASSERT(isReady());
+
+    const auto cpuBegin = std::chrono::steady_clock::now();
+
+    recordTimestamps();
 
     const WGPUCommandEncoder encoder = [&gpuContext]() {
         const WGPUCommandEncoderDescriptor cmdEncoderDesc{
@@ -313,75 +413,94 @@ void DeferredRenderer::render(
         jitterMat[3][1] = (j.y - 0.5f) / framebufferSize.y;
         return jitterMat;
     }();
+    const glm::mat4 viewProjectionMat = jitterMat * renderDesc.viewReverseZProjectionMatrix;
+    const glm::mat4 inverseViewProjectionMat = glm::inverse(viewProjectionMat);
+
+    mLightingResolution = mDynamicResolution.isEnabled()
+                              ? DYNAMIC_LIGHTING_RESOLUTIONS[mDynamicResolution.level()]
+                              : renderDesc.lightingResolution;
 
     // GBuffer pass
 
     wgpuCommandEncoderWriteTimestamp(
         encoder,
-        mQuerySet,
+        mTimestamps.querySet(),
         offsetof(TimestampsLayout, gbufferPassStart) / TimestampsLayout::MEMBER_SIZE);
     mGbufferPass.render(
-        gpuContext,
-        jitterMat * renderDesc.viewReverseZProjectionMatrix,
+        mUploadRing,
+        viewProjectionMat,
         encoder,
         mDepthTextureView,
         mAlbedoTextureView,
         mNormalTextureView);
     wgpuCommandEncoderWriteTimestamp(
         encoder,
-        mQuerySet,
+        mTimestamps.querySet(),
         offsetof(TimestampsLayout, gbufferPassEnd) / TimestampsLayout::MEMBER_SIZE);
 
     // Lighting pass
 
     wgpuCommandEncoderWriteTimestamp(
         encoder,
-        mQuerySet,
+        mTimestamps.querySet(),
         offsetof(TimestampsLayout, lightingPassStart) / TimestampsLayout::MEMBER_SIZE);
-    {
-        const glm::mat4 inverseViewProjectionMat =
-            glm::inverse(jitterMat * renderDesc.viewReverseZProjectionMatrix);
-        mLightingPass.render(
-            gpuContext,
-            encoder,
-            inverseViewProjectionMat,
-            renderDesc.cameraPosition,
-            framebufferSize,
-            renderDesc.sky,
-            frameCount);
-    }
+    mLightingPass.render(
+        mUploadRing,
+        encoder,
+        inverseViewProjectionMat,
+        renderDesc.cameraPosition,
+        framebufferSize,
+        renderDesc.sky,
+        frameCount,
+        mLightingResolution);
     wgpuCommandEncoderWriteTimestamp(
         encoder,
-        mQuerySet,
+        mTimestamps.querySet(),
         offsetof(TimestampsLayout, lightingPassEnd) / TimestampsLayout::MEMBER_SIZE);
 
+    // Denoise pass
+
+    wgpuCommandEncoderWriteTimestamp(
+        encoder,
+        mTimestamps.querySet(),
+        offsetof(TimestampsLayout, denoisePassStart) / TimestampsLayout::MEMBER_SIZE);
+    mDenoisePass.render(
+        mUploadRing,
+        encoder,
+        inverseViewProjectionMat,
+        mPreviousViewProjectionMat,
+        framebufferSize,
+        frameCount);
+    wgpuCommandEncoderWriteTimestamp(
+        encoder,
+        mTimestamps.querySet(),
+        offsetof(TimestampsLayout, denoisePassEnd) / TimestampsLayout::MEMBER_SIZE);
+
     // Resolve pass
 
     wgpuCommandEncoderWriteTimestamp(
         encoder,
-        mQuerySet,
+        mTimestamps.querySet(),
         offsetof(TimestampsLayout, resolvePassStart) / TimestampsLayout::MEMBER_SIZE);
-    {
-        mResolvePass.render(
-            gpuContext,
-            encoder,
-            renderDesc.targetTextureView,
-            framebufferSize,
-            renderDesc.exposure,
-            frameCount,
-            gui);
-    }
+    mResolvePass.render(
+        mUploadRing,
+        encoder,
+        renderDesc.targetTextureView,
+        inverseViewProjectionMat,
+        mPreviousViewProjectionMat,
+        framebufferSize,
+        renderDesc.exposure,
+        frameCount,
+        gui);
+    mPreviousViewProjectionMat = viewProjectionMat;
     wgpuCommandEncoderWriteTimestamp(
         encoder,
-        mQuerySet,
+        mTimestamps.querySet(),
         offsetof(TimestampsLayout, resolvePassEnd) / TimestampsLayout::MEMBER_SIZE);
 
     // Resolve timestamp queries
 
-    wgpuCommandEncoderResolveQuerySet(
-        encoder, mQuerySet, 0, TimestampsLayout::QUERY_COUNT, mQueryBuffer.ptr(), 0);
-    wgpuCommandEncoderCopyBufferToBuffer(
-        encoder, mQueryBuffer.ptr(), 0, mTimestampsBuffer.ptr(), 0, sizeof(TimestampsLayout));
+    mTimestamps.resolve(encoder);
 
     const WGPUCommandBuffer cmdBuffer = [encoder]() {
         const WGPUCommandBufferDescriptor cmdBufferDesc{
@@ -390,61 +509,63 @@ void DeferredRenderer::render(
         };
         return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
     }();
-    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+    mUploadRing.submit(gpuContext.queue, cmdBuffer);
+    mTimestamps.readback();
 
-    wgpuBufferMapAsync(
-        mTimestampsBuffer.ptr(),
-        WGPUMapMode_Read,
-        0,
-        sizeof(TimestampsLayout),
-        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
-            if (status == WGPUBufferMapAsyncStatus_Success)
-            {
-                NLRS_ASSERT(userdata != nullptr);
-                DeferredRenderer& renderer = *static_cast<DeferredRenderer*>(userdata);
-                GpuBuffer&        timestampBuffer = renderer.mTimestampsBuffer;
-                const void* const bufferData = wgpuBufferGetConstMappedRange(
-                    timestampBuffer.ptr(), 0, sizeof(TimestampsLayout));
-                NLRS_ASSERT(bufferData != nullptr);
-
-                const TimestampsLayout& timestamps =
-                    *static_cast<const TimestampsLayout*>(bufferData);
-
-                auto&      gbufferDurations = renderer.mGbufferPassDurationsNs;
-                const auto gbufferDuration =
-                    timestamps.gbufferPassEnd - timestamps.gbufferPassStart;
-                gbufferDurations.push_back(gbufferDuration);
-                if (gbufferDurations.size() > 30)
-                {
-                    gbufferDurations.pop_front();
-                }
-
-                auto&      lightingDurations = renderer.mLightingPassDurationsNs;
-                const auto lightingDuration =
-                    timestamps.lightingPassEnd - timestamps.lightingPassStart;
-                lightingDurations.push_back(lightingDuration);
-                if (lightingDurations.size() > 30)
-                {
-                    lightingDurations.pop_front();
-                }
-
-                auto&      resolveDurations = renderer.mResolvePassDurationsNs;
-                const auto resolveDuration =
-                    timestamps.resolvePassEnd - timestamps.resolvePassStart;
-                resolveDurations.push_back(resolveDuration);
-                if (resolveDurations.size() > 30)
-                {
-                    resolveDurations.pop_front();
-                }
-
-                wgpuBufferUnmap(timestampBuffer.ptr());
-            }
-            else
-            {
-                std::fprintf(stderr, "Failed to map timestamps buffer\n");
-            }
-        },
-        this);
+    mLightingPass.readbackVirtualTileFeedback();
+
+    {
+        const auto cpuDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - cpuBegin);
+        mRenderCpuDurations.record(static_cast<std::uint64_t>(cpuDuration.count()));
+    }
+}
+
+void DeferredRenderer::waitForTimestamps(const GpuContext& gpuContext)
+{
+    while (mTimestamps.hasPendingReadbacks())
+    {
+        wgpuDeviceTick(gpuContext.device);
+    }
+    recordTimestamps();
+}
+
+void DeferredRenderer::recordTimestamps()
+{
+    mTimestamps.consume([this](
+                            const std::span<const std::uint64_t> timestamps,
+                            std::uint64_t /* frameTag */) -> void {
+        const auto timestamp = [timestamps](const std::size_t memberOffset) -> std::uint64_t {
+            return timestamps[memberOffset / TimestampsLayout::MEMBER_SIZE];
+        };
+        mGbufferPassDurations.record(
+            timestamp(offsetof(TimestampsLayout, gbufferPassEnd)) -
+            timestamp(offsetof(TimestampsLayout, gbufferPassStart)));
+        mLightingPassDurations.record(
+            timestamp(offsetof(TimestampsLayout, lightingPassEnd)) -
+            timestamp(offsetof(TimestampsLayout, lightingPassStart)));
+        mDenoisePassDurations.record(
+            timestamp(offsetof(TimestampsLayout, denoisePassEnd)) -
+            timestamp(offsetof(TimestampsLayout, denoisePassStart)));
+        mResolvePassDurations.record(
+            timestamp(offsetof(TimestampsLayout, resolvePassEnd)) -
+            timestamp(offsetof(TimestampsLayout, resolvePassStart)));
+
+        const std::uint64_t frameDuration =
+            timestamp(offsetof(TimestampsLayout, resolvePassEnd)) -
+            timestamp(offsetof(TimestampsLayout, gbufferPassStart));
+        if (const auto decision = mDynamicResolution.record(frameDuration))
+        {
+            std::fprintf(
+                stderr,
+                "Dynamic resolution: %.2f ms average frame time (%.2f ms budget), lighting "
+                "resolution %s -> %s\n",
+                decision->averageMs,
+                mDynamicResolution.targetFrameMs(),
+                lightingResolutionName(DYNAMIC_LIGHTING_RESOLUTIONS[decision->previousLevel]),
+                lightingResolutionName(DYNAMIC_LIGHTING_RESOLUTIONS[decision->level]));
+        }
+    });
 }
 
 void DeferredRenderer::renderDebug(
@@ -452,9 +573,10 @@ void DeferredRenderer::renderDebug(
     const glm::mat4&      viewProjectionMat,
     const Extent2f&       framebufferSize,
     const WGPUTextureView textureView,
-    Gui&                  gui)
+    Gui*                  gui)
 {
     wgpuDeviceTick(gpuContext.device);
+    NLRS_ASSERT(isDebugReady());
 
     const WGPUCommandEncoder encoder = [&gpuContext]() {
         const WGPUCommandEncoderDescriptor cmdEncoderDesc{
@@ -465,14 +587,14 @@ void DeferredRenderer::renderDebug(
     }();
 
     mGbufferPass.render(
-        gpuContext,
+        mUploadRing,
         viewProjectionMat,
         encoder,
         mDepthTextureView,
         mAlbedoTextureView,
         mNormalTextureView);
 
-    mDebugPass.render(gpuContext, encoder, textureView, framebufferSize, gui);
+    mDebugPass.render(mUploadRing, encoder, textureView, framebufferSize, gui);
 
     const WGPUCommandBuffer cmdBuffer = [encoder]() {
         const WGPUCommandBufferDescriptor cmdBufferDesc{
@@ -481,7 +603,7 @@ void DeferredRenderer::renderDebug(
         };
         return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
     }();
-    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+    mUploadRing.submit(gpuContext.queue, cmdBuffer);
 }
 
 void DeferredRenderer::resize(const GpuContext& gpuContext, const Extent2u& newSize)
@@ -502,6 +624,10 @@ void DeferredRenderer::resize(const GpuContext& gpuContext, const Extent2u& newS
     mDepthTextureView = nullptr;
     mDepthTexture = nullptr;
 
+    mGbufferAllocation = GpuMemoryAllocation{};
+    mGbufferAllocation = GpuMemoryAllocation(
+        "Gbuffer textures", GpuMemoryCategory::Gbuffer, GBUFFER_TEXEL_BYTE_SIZE * area(newSize));
+
     {
         const std::array<WGPUTextureFormat, 1> depthFormats{
             DEPTH_TEXTURE_FORMAT,
@@ -562,6 +688,8 @@ void DeferredRenderer::resize(const GpuContext& gpuContext, const Extent2u& newS
 
     mDebugPass.resize(gpuContext, mAlbedoTextureView, mNormalTextureView, mDepthTextureView);
     mLightingPass.resize(gpuContext, mAlbedoTextureView, mNormalTextureView, mDepthTextureView);
+    mDenoisePass.resize(gpuContext, mAlbedoTextureView, mNormalTextureView, mDepthTextureView);
+    mResolvePass.resize(gpuContext, mNormalTextureView, mDepthTextureView);
 
     invalidateTemporalAccumulation();
 }
@@ -577,7 +705,11 @@ DeferredRenderer::GbufferPass::GbufferPass(
               std::back_inserter(buffers),
               [&gpuContext](const std::span<const glm::vec4> vertices) -> GpuBuffer {
                   return GpuBuffer(
-                      gpuContext.device, "Mesh Vertex Buffer", GpuBufferUsage::Vertex, vertices);
+                      gpuContext.device,
+                      "Mesh Vertex Buffer",
+                      GpuBufferUsage::Vertex,
+                      vertices,
+                      GpuMemoryCategory::Geometry);
               });
           return buffers;
       }()),
@@ -589,7 +721,11 @@ DeferredRenderer::GbufferPass::GbufferPass(
               std::back_inserter(buffers),
               [&gpuContext](const std::span<const glm::vec4> normals) -> GpuBuffer {
                   return GpuBuffer{
-                      gpuContext.device, "Mesh normal buffer", GpuBufferUsage::Vertex, normals};
+                      gpuContext.device,
+                      "Mesh normal buffer",
+                      GpuBufferUsage::Vertex,
+                      normals,
+                      GpuMemoryCategory::Geometry};
               });
           return buffers;
       }()),
@@ -601,7 +737,11 @@ DeferredRenderer::GbufferPass::GbufferPass(
               std::back_inserter(buffers),
               [&gpuContext](const std::span<const glm::vec2> texCoords) {
                   return GpuBuffer(
-                      gpuContext.device, "Mesh TexCoord Buffer", GpuBufferUsage::Vertex, texCoords);
+                      gpuContext.device,
+                      "Mesh TexCoord Buffer",
+                      GpuBufferUsage::Vertex,
+                      texCoords,
+                      GpuMemoryCategory::Geometry);
               });
           return buffers;
       }()),
@@ -614,7 +754,11 @@ DeferredRenderer::GbufferPass::GbufferPass(
               [&gpuContext](const std::span<const std::uint32_t> indices) {
                   return IndexBuffer{
                       .buffer = GpuBuffer(
-                          gpuContext.device, "Mesh Index Buffer", GpuBufferUsage::Index, indices),
+                          gpuContext.device,
+                          "Mesh Index Buffer",
+                          GpuBufferUsage::Index,
+                          indices,
+                          GpuMemoryCategory::Geometry),
                       .count = static_cast<std::uint32_t>(indices.size()),
                       .format = WGPUIndexFormat_Uint32,
                   };
@@ -637,8 +781,13 @@ DeferredRenderer::GbufferPass::GbufferPass(
               rendererDesc.sceneBaseColorTextures.end(),
               std::back_inserter(textures),
               [&gpuContext](const Texture& texture) -> GpuTexture {
+                  const std::size_t numTextureBytes =
+                      texture.pixels().size() * sizeof(std::uint32_t);
+                  GpuMemoryAllocation allocation(
+                      "Mesh texture", GpuMemoryCategory::Textures, numTextureBytes);
+
                   const auto                  dimensions = texture.dimensions();
-                  const WGPUTextureFormat     TEXTURE_FORMAT = WGPUTextureFormat_BGRA8Unorm;
+                  const WGPUTextureFormat     TEXTURE_FORMAT = gpuTextureFormat(texture.format());
                   const WGPUTextureDescriptor textureDesc{
                       .nextInChain = nullptr,
                       .label = "Mesh texture",
@@ -677,16 +826,15 @@ DeferredRenderer::GbufferPass::GbufferPass(
                   const WGPUTextureDataLayout sourceDataLayout{
                       .nextInChain = nullptr,
                       .offset = 0,
-                      .bytesPerRow =
-                          static_cast<std::uint32_t>(dimensions.width * sizeof(Texture::BgraPixel)),
+                      .bytesPerRow = static_cast<std::uint32_t>(
+                          dimensions.width * texelWordCount(texture.format()) *
+                          sizeof(std::uint32_t)),
                       .rowsPerImage = dimensions.height,
                   };
                   const WGPUExtent3D writeSize{
                       .width = dimensions.width,
                       .height = dimensions.height,
                       .depthOrArrayLayers = 1};
-                  const std::size_t numPixelBytes = sizeof(Texture::BgraPixel);
-                  const std::size_t numTextureBytes = texture.pixels().size() * numPixelBytes;
                   wgpuQueueWriteTexture(
                       gpuContext.queue,
                       &imageDestination,
@@ -698,6 +846,7 @@ DeferredRenderer::GbufferPass::GbufferPass(
                   return GpuTexture{
                       .texture = gpuTexture,
                       .view = view,
+                      .allocation = std::move(allocation),
                   };
               });
           return textures;
@@ -711,7 +860,7 @@ DeferredRenderer::GbufferPass::GbufferPass(
           sizeof(Uniforms)),
       mUniformBindGroup(),
       mSamplerBindGroup(),
-      mPipeline(nullptr)
+      mPipeline()
 {
     const GpuBindGroupLayout uniformBindGroupLayout{
         gpuContext.device,
@@ -946,7 +1095,7 @@ DeferredRenderer::GbufferPass::GbufferPass(
             .fragment = &fragmentState,
         };
 
-        mPipeline = wgpuDeviceCreateRenderPipeline(gpuContext.device, &pipelineDesc);
+        mPipeline = AsyncRenderPipeline(gpuContext.device, pipelineDesc);
 
         wgpuPipelineLayoutRelease(pipelineLayout);
     }
@@ -958,8 +1107,6 @@ DeferredRenderer::GbufferPass::GbufferPass(
 
 DeferredRenderer::GbufferPass::~GbufferPass()
 {
-    renderPipelineSafeRelease(mPipeline);
-    mPipeline = nullptr;
     samplerSafeRelease(mBaseColorSampler);
     mBaseColorSampler = nullptr;
     for (const auto& texture : mBaseColorTextures)
@@ -986,8 +1133,7 @@ DeferredRenderer::GbufferPass::GbufferPass(GbufferPass&& other) noexcept
         mUniformBuffer = std::move(other.mUniformBuffer);
         mUniformBindGroup = std::move(other.mUniformBindGroup);
         mSamplerBindGroup = std::move(other.mSamplerBindGroup);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mPipeline = std::move(other.mPipeline);
     }
 }
 
@@ -1008,15 +1154,13 @@ DeferredRenderer::GbufferPass& DeferredRenderer::GbufferPass::operator=(
         mUniformBuffer = std::move(other.mUniformBuffer);
         mUniformBindGroup = std::move(other.mUniformBindGroup);
         mSamplerBindGroup = std::move(other.mSamplerBindGroup);
-        renderPipelineSafeRelease(mPipeline);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mPipeline = std::move(other.mPipeline);
     }
     return *this;
 }
 
 void DeferredRenderer::GbufferPass::render(
-    const GpuContext&        gpuContext,
+    GpuUploadRing&           uploadRing,
     const glm::mat4&         viewReverseZProjectionMatrix,
     const WGPUCommandEncoder cmdEncoder,
     const WGPUTextureView    depthTextureView,
@@ -1024,7 +1168,7 @@ void DeferredRenderer::GbufferPass::render(
     const WGPUTextureView    normalTextureView)
 {
     const Uniforms uniforms{viewReverseZProjectionMatrix};
-    wgpuQueueWriteBuffer(gpuContext.queue, mUniformBuffer.ptr(), 0, &uniforms, sizeof(Uniforms));
+    uploadRing.write(cmdEncoder, mUniformBuffer.ptr(), uniforms);
 
     const WGPURenderPassEncoder renderPassEncoder = [cmdEncoder,
                                                      depthTextureView,
@@ -1075,7 +1219,7 @@ void DeferredRenderer::GbufferPass::render(
         return wgpuCommandEncoderBeginRenderPass(cmdEncoder, &renderPassDesc);
     }();
 
-    wgpuRenderPassEncoderSetPipeline(renderPassEncoder, mPipeline);
+    wgpuRenderPassEncoderSetPipeline(renderPassEncoder, mPipeline.get());
     wgpuRenderPassEncoderSetBindGroup(renderPassEncoder, 0, mUniformBindGroup.ptr(), 0, nullptr);
     wgpuRenderPassEncoderSetBindGroup(renderPassEncoder, 1, mSamplerBindGroup.ptr(), 0, nullptr);
 
@@ -1126,7 +1270,7 @@ DeferredRenderer::DebugPass::DebugPass(
       mUniformBindGroup{},
       mGbufferBindGroupLayout{},
       mGbufferBindGroup{},
-      mPipeline(nullptr)
+      mPipeline()
 {
     {
         const auto uniformData = Extent2f{framebufferSize};
@@ -1287,18 +1431,12 @@ DeferredRenderer::DebugPass::DebugPass(
             .fragment = &fragmentState,
         };
 
-        mPipeline = wgpuDeviceCreateRenderPipeline(gpuContext.device, &pipelineDesc);
+        mPipeline = AsyncRenderPipeline(gpuContext.device, pipelineDesc);
 
         wgpuPipelineLayoutRelease(pipelineLayout);
     }
 }
 
-DeferredRenderer::DebugPass::~DebugPass()
-{
-    renderPipelineSafeRelease(mPipeline);
-    mPipeline = nullptr;
-}
-
 DeferredRenderer::DebugPass::DebugPass(DebugPass&& other) noexcept
 {
     if (this != &other)
@@ -1308,8 +1446,7 @@ DeferredRenderer::DebugPass::DebugPass(DebugPass&& other) noexcept
         mUniformBindGroup = std::move(other.mUniformBindGroup);
         mGbufferBindGroupLayout = std::move(other.mGbufferBindGroupLayout);
         mGbufferBindGroup = std::move(other.mGbufferBindGroup);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mPipeline = std::move(other.mPipeline);
     }
 }
 
@@ -1322,22 +1459,19 @@ DeferredRenderer::DebugPass& DeferredRenderer::DebugPass::operator=(DebugPass&&
         mUniformBindGroup = std::move(other.mUniformBindGroup);
         mGbufferBindGroupLayout = std::move(other.mGbufferBindGroupLayout);
         mGbufferBindGroup = std::move(other.mGbufferBindGroup);
-        renderPipelineSafeRelease(mPipeline);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mPipeline = std::move(other.mPipeline);
     }
     return *this;
 }
 
 void DeferredRenderer::DebugPass::render(
-    const GpuContext&        gpuContext,
+    GpuUploadRing&           uploadRing,
     const WGPUCommandEncoder cmdEncoder,
     const WGPUTextureView    textureView,
     const Extent2f&          framebufferSize,
-    Gui&                     gui)
+    Gui*                     gui)
 {
-    wgpuQueueWriteBuffer(
-        gpuContext.queue, mUniformBuffer.ptr(), 0, &framebufferSize.x, sizeof(Extent2f));
+    uploadRing.write(cmdEncoder, mUniformBuffer.ptr(), framebufferSize);
 
     const WGPURenderPassEncoder renderPass = [cmdEncoder, textureView]() -> WGPURenderPassEncoder {
         const WGPURenderPassColorAttachment colorAttachment{
@@ -1364,14 +1498,17 @@ void DeferredRenderer::DebugPass::render(
     }();
     NLRS_ASSERT(renderPass != nullptr);
 
-    wgpuRenderPassEncoderSetPipeline(renderPass, mPipeline);
+    wgpuRenderPassEncoderSetPipeline(renderPass, mPipeline.get());
     wgpuRenderPassEncoderSetBindGroup(renderPass, 0, mUniformBindGroup.ptr(), 0, nullptr);
     wgpuRenderPassEncoderSetBindGroup(renderPass, 1, mGbufferBindGroup.ptr(), 0, nullptr);
     wgpuRenderPassEncoderSetVertexBuffer(
         renderPass, 0, mVertexBuffer.ptr(), 0, mVertexBuffer.byteSize());
     wgpuRenderPassEncoderDraw(renderPass, 6, 1, 0, 0);
 
-    gui.render(renderPass);
+    if (gui)
+    {
+        gui->render(renderPass);
+    }
 
     wgpuRenderPassEncoderEnd(renderPass);
 }
@@ -1401,13 +1538,17 @@ DeferredRenderer::LightingPass::LightingPass(
     std::span<const BvhNode>           sceneBvhNodes,
     std::span<const PositionAttribute> scenePositionAttributes,
     std::span<const VertexAttributes>  sceneVertexAttributes,
-    std::span<const Texture>           sceneBaseColorTextures)
-    : mCurrentSky{},
+    std::span<const Texture>           sceneBaseColorTextures,
+    const TextureLayout                textureLayout,
+    const std::uint32_t                virtualTexturePhysicalTileCount,
+    std::shared_ptr<SkyStateCache>     skyStateCache,
+    const std::uint32_t                numBounces)
+    : mSkyStateCache{std::move(skyStateCache)},
       mSkyStateBuffer{
           gpuContext.device,
           "Sky state buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          sizeof(AlignedSkyState)},
+          SKY_STATE_BUFFER_BYTE_SIZE},
       mUniformBuffer{
           gpuContext.device,
           "Sky uniform buffer",
@@ -1420,19 +1561,22 @@ DeferredRenderer::LightingPass::LightingPass(
           gpuContext.device,
           "BVH node buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          std::span<const BvhNode>(sceneBvhNodes)},
+          std::span<const BvhNode>(sceneBvhNodes),
+          GpuMemoryCategory::Bvh},
       mPositionAttributesBuffer{
           gpuContext.device,
           "Position attribute buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          std::span<const PositionAttribute>(scenePositionAttributes)},
+          std::span<const PositionAttribute>(scenePositionAttributes),
+          GpuMemoryCategory::Geometry},
       mVertexAttributesBuffer{
           gpuContext.device,
           "Vertex attribute buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          std::span<const VertexAttributes>(sceneVertexAttributes)},
+          std::span<const VertexAttributes>(sceneVertexAttributes),
+          GpuMemoryCategory::Geometry},
       mTextureDescriptorBuffer{},
-      mTextureBuffer{},
+      mTexturePageBuffers{},
       mBlueNoiseBuffer{[&gpuContext]() -> GpuBuffer {
           std::span<const std::uint8_t> blueNoise(blueNoiseValues, sizeof(blueNoiseValues));
           std::vector<std::uint32_t>    bufferData;
@@ -1448,17 +1592,25 @@ DeferredRenderer::LightingPass::LightingPass(
               gpuContext.device,
               "blue noise buffer",
               {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-              std::span<const std::uint32_t>(bufferData)};
+              std::span<const std::uint32_t>(bufferData),
+              GpuMemoryCategory::Textures};
       }()},
       mBvhBindGroup{},
       mSampleBindGroup{},
-      mPipeline(nullptr)
+      mPipeline(),
+      mReconstructPipeline(),
+      mVirtualTextureTable{},
+      mVirtualTileCache{},
+      mVirtualTextureSources{},
+      mVirtualTileFeedback(std::make_shared<VirtualTileFeedback>()),
+      mVirtualTileTexels{},
+      mVirtualTileFeedbackBuffer{},
+      mVirtualTileFeedbackReadbackBuffer{},
+      mVirtualTileIndirectionBuffer{},
+      mVirtualTilePoolBuffer{},
+      mVirtualTileFeedbackCopied(false)
 {
-    {
-        const AlignedSkyState skyState{mCurrentSky};
-        wgpuQueueWriteBuffer(
-            gpuContext.queue, mSkyStateBuffer.ptr(), 0, &skyState, sizeof(AlignedSkyState));
-    }
+    NLRS_ASSERT(mSkyStateCache != nullptr);
 
     const GpuBindGroupLayout uniformBindGroupLayout{
         gpuContext.device,
@@ -1491,103 +1643,213 @@ DeferredRenderer::LightingPass::LightingPass(
             textureBindGroupEntry(2, depthTextureView)}};
 
     {
-        struct TextureDescriptor
-        {
-            std::uint32_t width, height, offset;
-        };
-        // Ensure matches layout of `TextureDescriptor` definition in shader.
-        std::vector<TextureDescriptor> textureDescriptors;
-        textureDescriptors.reserve(sceneBaseColorTextures.size());
-
-        std::vector<Texture::BgraPixel> textureData;
-        textureData.reserve((2 << 28) / sizeof(Texture::BgraPixel));
-
-        // Texture descriptors and texture data need to appended in the order of
-        // sceneBaseColorTextures. The vertex attribute's `textureIdx` indexes into that array, and
-        // we want to use the same indices to index into the texture descriptor array.
+        // Texture descriptors are packed in the order of sceneBaseColorTextures. The vertex
+        // attribute's `textureIdx` indexes into that array, and we want to use the same indices to
+        // index into the texture descriptor array.
+        const std::size_t maxPageWordCount =
+            static_cast<std::size_t>(std::min(
+                TEXTURE_PAGE_MAX_BYTE_SIZE, REQUIRED_LIMITS.maxStorageBufferBindingSize)) /
+            sizeof(std::uint32_t);
+        const PackedTextures packedTextures = [&]() -> PackedTextures {
+            if (virtualTexturePhysicalTileCount > 0)
+            {
+                // Virtual textures are streamed into the tile pool instead of the texture pages.
+                mVirtualTextureTable = VirtualTextureTable(sceneBaseColorTextures);
+                const auto descriptors = mVirtualTextureTable.descriptors();
+                return PackedTextures{{descriptors.begin(), descriptors.end()}, {}};
+            }
+            return packTextures(sceneBaseColorTextures, textureLayout, maxPageWordCount);
+        }();
 
-        for (const Texture& baseColorTexture : sceneBaseColorTextures)
         {
-            const auto dimensions = baseColorTexture.dimensions();
-            const auto pixels = baseColorTexture.pixels();
-
-            const std::uint32_t width = dimensions.width;
-            const std::uint32_t height = dimensions.height;
-            const std::uint32_t offset = static_cast<std::uint32_t>(textureData.size());
-
-            textureData.resize(textureData.size() + pixels.size());
-            std::memcpy(
-                textureData.data() + offset,
-                pixels.data(),
-                pixels.size() * sizeof(Texture::BgraPixel));
-
-            textureDescriptors.push_back({width, height, offset});
+            // The sRGB lookup table precedes the descriptors, see `TextureTable` in the shader. The
+            // buffer always has room for one descriptor, as the runtime-sized array can't be empty.
+            const std::span<const float> srgbToLinear = srgbToLinearLut();
+            const std::size_t            descriptorByteSize =
+                packedTextures.descriptors.size() * sizeof(TextureDescriptor);
+            const std::size_t            bufferByteSize =
+                srgbToLinear.size_bytes() + std::max(descriptorByteSize, sizeof(TextureDescriptor));
+            mTextureDescriptorBuffer = GpuBuffer(
+                gpuContext.device,
+                "texture descriptor buffer",
+                {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+                bufferByteSize,
+                GpuMemoryCategory::Textures);
+            wgpuQueueWriteBuffer(
+                gpuContext.queue,
+                mTextureDescriptorBuffer.ptr(),
+                0,
+                srgbToLinear.data(),
+                srgbToLinear.size_bytes());
+            if (descriptorByteSize > 0)
+            {
+                wgpuQueueWriteBuffer(
+                    gpuContext.queue,
+                    mTextureDescriptorBuffer.ptr(),
+                    srgbToLinear.size_bytes(),
+                    packedTextures.descriptors.data(),
+                    descriptorByteSize);
+            }
         }
 
-        mTextureDescriptorBuffer = GpuBuffer(
-            gpuContext.device,
-            "texture descriptor buffer",
-            {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-            std::span<const TextureDescriptor>(textureDescriptors));
-
-        const std::size_t textureDataNumBytes = textureData.size() * sizeof(Texture::BgraPixel);
-        const std::size_t maxStorageBufferBindingSize =
-            static_cast<std::size_t>(REQUIRED_LIMITS.maxStorageBufferBindingSize);
-        if (textureDataNumBytes > maxStorageBufferBindingSize)
+        if (packedTextures.pages.size() > TEXTURE_PAGE_COUNT)
         {
             throw std::runtime_error(fmt::format(
-                "Texture buffer size ({}) exceeds "
-                "maxStorageBufferBindingSize ({}).",
-                textureDataNumBytes,
-                maxStorageBufferBindingSize));
+                "Texture data requires {} texture pages of at most {} bytes, but only {} pages "
+                "are available.",
+                packedTextures.pages.size(),
+                maxPageWordCount * sizeof(std::uint32_t),
+                TEXTURE_PAGE_COUNT));
         }
 
-        mTextureBuffer = GpuBuffer(
-            gpuContext.device,
-            "texture buffer",
-            {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-            std::span<const Texture::BgraPixel>(textureData));
+        for (std::size_t pageIdx = 0; pageIdx < TEXTURE_PAGE_COUNT; ++pageIdx)
+        {
+            // Unused pages are still bound, so they get a placeholder texel.
+            const std::uint32_t                  placeholderTexel = 0;
+            const std::span<const std::uint32_t> texels =
+                pageIdx < packedTextures.pages.size()
+                    ? std::span<const std::uint32_t>(packedTextures.pages[pageIdx])
+                    : std::span<const std::uint32_t>(&placeholderTexel, 1);
+            mTexturePageBuffers[pageIdx] = GpuBuffer(
+                gpuContext.device,
+                "texture page buffer",
+                {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+                texels,
+                GpuMemoryCategory::Textures);
+        }
     }
 
     const GpuBindGroupLayout bvhBindGroupLayout{
         gpuContext.device,
         "Scene bind group layout",
-        std::array<WGPUBindGroupLayoutEntry, 7>{
+        std::array<WGPUBindGroupLayoutEntry, 10>{
             mSkyStateBuffer.bindGroupLayoutEntry(
-                0, WGPUShaderStage_Compute, sizeof(AlignedSkyState)),
+                0, WGPUShaderStage_Compute, SKY_STATE_BUFFER_BYTE_SIZE),
             mBvhNodeBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
             mPositionAttributesBuffer.bindGroupLayoutEntry(2, WGPUShaderStage_Compute),
             mVertexAttributesBuffer.bindGroupLayoutEntry(3, WGPUShaderStage_Compute),
             mTextureDescriptorBuffer.bindGroupLayoutEntry(4, WGPUShaderStage_Compute),
-            mTextureBuffer.bindGroupLayoutEntry(5, WGPUShaderStage_Compute),
-            mBlueNoiseBuffer.bindGroupLayoutEntry(6, WGPUShaderStage_Compute),
+            mBlueNoiseBuffer.bindGroupLayoutEntry(5, WGPUShaderStage_Compute),
+            mTexturePageBuffers[0].bindGroupLayoutEntry(6, WGPUShaderStage_Compute),
+            mTexturePageBuffers[1].bindGroupLayoutEntry(7, WGPUShaderStage_Compute),
+            mTexturePageBuffers[2].bindGroupLayoutEntry(8, WGPUShaderStage_Compute),
+            mTexturePageBuffers[3].bindGroupLayoutEntry(9, WGPUShaderStage_Compute),
         }};
 
     mBvhBindGroup = GpuBindGroup{
         gpuContext.device,
         "Lighting pass BVH bind group",
         bvhBindGroupLayout.ptr(),
-        std::array<WGPUBindGroupEntry, 7>{
+        std::array<WGPUBindGroupEntry, 10>{
             mSkyStateBuffer.bindGroupEntry(0),
             mBvhNodeBuffer.bindGroupEntry(1),
             mPositionAttributesBuffer.bindGroupEntry(2),
             mVertexAttributesBuffer.bindGroupEntry(3),
             mTextureDescriptorBuffer.bindGroupEntry(4),
-            mTextureBuffer.bindGroupEntry(5),
-            mBlueNoiseBuffer.bindGroupEntry(6),
+            mBlueNoiseBuffer.bindGroupEntry(5),
+            mTexturePageBuffers[0].bindGroupEntry(6),
+            mTexturePageBuffers[1].bindGroupEntry(7),
+            mTexturePageBuffers[2].bindGroupEntry(8),
+            mTexturePageBuffers[3].bindGroupEntry(9),
         }};
 
+    if (virtualTexturePhysicalTileCount > 0)
+    {
+        const std::size_t poolByteSize = static_cast<std::size_t>(virtualTexturePhysicalTileCount) *
+                                         VIRTUAL_TILE_TEXEL_COUNT * sizeof(Texture::BgraPixel);
+        if (poolByteSize > TEXTURE_PAGE_MAX_BYTE_SIZE)
+        {
+            throw std::runtime_error(fmt::format(
+                "Virtual texture tile pool size ({}) exceeds the maximum texture page size ({}).",
+                poolByteSize,
+                TEXTURE_PAGE_MAX_BYTE_SIZE));
+        }
+
+        const std::uint32_t virtualTileCount = mVirtualTextureTable.virtualTileCount();
+        mVirtualTileCache = VirtualTileCache(virtualTileCount, virtualTexturePhysicalTileCount);
+
+        // The scene's textures don't outlive the renderer descriptor, so keep a host copy to
+        // stream tiles from.
+        mVirtualTextureSources.reserve(sceneBaseColorTextures.size());
+        for (const Texture& texture : sceneBaseColorTextures)
+        {
+            const auto pixels = texture.pixels();
+            mVirtualTextureSources.emplace_back(
+                std::vector<std::uint32_t>(pixels.begin(), pixels.end()),
+                texture.dimensions(),
+                texture.format());
+        }
+
+        const std::size_t feedbackByteSize =
+            std::max(virtualTileCount, 1u) * sizeof(std::uint32_t);
+        mVirtualTileFeedbackBuffer = GpuBuffer{
+            gpuContext.device,
+            "Virtual tile feedback buffer",
+            {GpuBufferUsage::Storage, GpuBufferUsage::CopySrc, GpuBufferUsage::CopyDst},
+            feedbackByteSize,
+            GpuMemoryCategory::Textures};
+        mVirtualTileFeedbackReadbackBuffer = GpuBuffer{
+            gpuContext.device,
+            "Virtual tile feedback readback buffer",
+            {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
+            feedbackByteSize,
+            GpuMemoryCategory::Staging};
+        mVirtualTileIndirectionBuffer = virtualTileCount > 0
+            ? GpuBuffer{
+                  gpuContext.device,
+                  "Virtual tile indirection buffer",
+                  {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+                  mVirtualTileCache.indirectionTable(),
+                  GpuMemoryCategory::Textures}
+            : GpuBuffer{
+                  gpuContext.device,
+                  "Virtual tile indirection buffer",
+                  {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+                  sizeof(std::uint32_t)};
+        mVirtualTilePoolBuffer = GpuBuffer{
+            gpuContext.device,
+            "Virtual tile pool buffer",
+            {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+            poolByteSize,
+            GpuMemoryCategory::Textures};
+    }
+    else
+    {
+        mVirtualTileFeedbackBuffer = GpuBuffer{
+            gpuContext.device,
+            "Virtual tile feedback buffer",
+            GpuBufferUsage::Storage,
+            sizeof(std::uint32_t)};
+        mVirtualTileIndirectionBuffer = GpuBuffer{
+            gpuContext.device,
+            "Virtual tile indirection buffer",
+            GpuBufferUsage::ReadOnlyStorage,
+            sizeof(std::uint32_t)};
+        mVirtualTilePoolBuffer = GpuBuffer{
+            gpuContext.device,
+            "Virtual tile pool buffer",
+            GpuBufferUsage::ReadOnlyStorage,
+            sizeof(std::uint32_t)};
+    }
+
     const GpuBindGroupLayout sampleBindGroupLayout{
         gpuContext.device,
         "Lighting pass accumulation bind group layout",
-        std::array<WGPUBindGroupLayoutEntry, 1>{
-            sampleBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute)}};
+        std::array<WGPUBindGroupLayoutEntry, 4>{
+            sampleBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute),
+            mVirtualTileFeedbackBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
+            mVirtualTileIndirectionBuffer.bindGroupLayoutEntry(2, WGPUShaderStage_Compute),
+            mVirtualTilePoolBuffer.bindGroupLayoutEntry(3, WGPUShaderStage_Compute)}};
 
     mSampleBindGroup = GpuBindGroup{
         gpuContext.device,
         "Lighting pass accumulation bind group",
         sampleBindGroupLayout.ptr(),
-        sampleBuffer.bindGroupEntry(0)};
+        std::array<WGPUBindGroupEntry, 4>{
+            sampleBuffer.bindGroupEntry(0),
+            mVirtualTileFeedbackBuffer.bindGroupEntry(1),
+            mVirtualTileIndirectionBuffer.bindGroupEntry(2),
+            mVirtualTilePoolBuffer.bindGroupEntry(3)}};
 
     {
         // Pipeline layout
@@ -1627,12 +1889,18 @@ DeferredRenderer::LightingPass::LightingPass(
         const WGPUPipelineLayout pipelineLayout =
             wgpuDeviceCreatePipelineLayout(gpuContext.device, &pipelineLayoutDesc);
 
+        const WGPUConstantEntry numBouncesConstant{
+            .nextInChain = nullptr,
+            .key = "NUM_BOUNCES",
+            .value = static_cast<double>(numBounces),
+        };
+
         const WGPUProgrammableStageDescriptor computeStageDesc{
             .nextInChain = nullptr,
             .module = shaderModule,
             .entryPoint = "main",
-            .constantCount = 0,
-            .constants = nullptr,
+            .constantCount = 1,
+            .constants = &numBouncesConstant,
         };
 
         const WGPUComputePipelineDescriptor pipelineDesc{
@@ -1642,22 +1910,32 @@ DeferredRenderer::LightingPass::LightingPass(
             .compute = computeStageDesc,
         };
 
-        mPipeline = wgpuDeviceCreateComputePipeline(gpuContext.device, &pipelineDesc);
+        mPipeline = AsyncComputePipeline(gpuContext.device, pipelineDesc);
+
+        const WGPUComputePipelineDescriptor reconstructPipelineDesc{
+            .nextInChain = nullptr,
+            .label = "Lighting pass reconstruct pipeline",
+            .layout = pipelineLayout,
+            .compute =
+                WGPUProgrammableStageDescriptor{
+                    .nextInChain = nullptr,
+                    .module = shaderModule,
+                    .entryPoint = "reconstruct",
+                    .constantCount = 0,
+                    .constants = nullptr,
+                },
+        };
+
+        mReconstructPipeline = AsyncComputePipeline(gpuContext.device, reconstructPipelineDesc);
         wgpuPipelineLayoutRelease(pipelineLayout);
     }
 }
 
-DeferredRenderer::LightingPass::~LightingPass()
-{
-    computePipelineSafeRelease(mPipeline);
-    mPipeline = nullptr;
-}
-
 DeferredRenderer::LightingPass::LightingPass(LightingPass&& other) noexcept
 {
     if (this != &other)
     {
-        mCurrentSky = other.mCurrentSky;
+        mSkyStateCache = std::move(other.mSkyStateCache);
         mSkyStateBuffer = std::move(other.mSkyStateBuffer);
         mUniformBuffer = std::move(other.mUniformBuffer);
         mUniformBindGroup = std::move(other.mUniformBindGroup);
@@ -1667,12 +1945,22 @@ DeferredRenderer::LightingPass::LightingPass(LightingPass&& other) noexcept
         mPositionAttributesBuffer = std::move(other.mPositionAttributesBuffer);
         mVertexAttributesBuffer = std::move(other.mVertexAttributesBuffer);
         mTextureDescriptorBuffer = std::move(other.mTextureDescriptorBuffer);
-        mTextureBuffer = std::move(other.mTextureBuffer);
+        mTexturePageBuffers = std::move(other.mTexturePageBuffers);
         mBlueNoiseBuffer = std::move(other.mBlueNoiseBuffer);
         mBvhBindGroup = std::move(other.mBvhBindGroup);
         mSampleBindGroup = std::move(other.mSampleBindGroup);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mPipeline = std::move(other.mPipeline);
+        mReconstructPipeline = std::move(other.mReconstructPipeline);
+        mVirtualTextureTable = std::move(other.mVirtualTextureTable);
+        mVirtualTileCache = std::move(other.mVirtualTileCache);
+        mVirtualTextureSources = std::move(other.mVirtualTextureSources);
+        mVirtualTileFeedback = std::move(other.mVirtualTileFeedback);
+        mVirtualTileTexels = std::move(other.mVirtualTileTexels);
+        mVirtualTileFeedbackBuffer = std::move(other.mVirtualTileFeedbackBuffer);
+        mVirtualTileFeedbackReadbackBuffer = std::move(other.mVirtualTileFeedbackReadbackBuffer);
+        mVirtualTileIndirectionBuffer = std::move(other.mVirtualTileIndirectionBuffer);
+        mVirtualTilePoolBuffer = std::move(other.mVirtualTilePoolBuffer);
+        mVirtualTileFeedbackCopied = other.mVirtualTileFeedbackCopied;
     }
 }
 
@@ -1681,7 +1969,8 @@ DeferredRenderer::LightingPass& DeferredRenderer::LightingPass::operator=(
 {
     if (this != &other)
     {
-        mCurrentSky = other.mCurrentSky;
+        releaseVirtualTileFeedback();
+        mSkyStateCache = std::move(other.mSkyStateCache);
         mSkyStateBuffer = std::move(other.mSkyStateBuffer);
         mUniformBuffer = std::move(other.mUniformBuffer);
         mUniformBindGroup = std::move(other.mUniformBindGroup);
@@ -1691,33 +1980,51 @@ DeferredRenderer::LightingPass& DeferredRenderer::LightingPass::operator=(
         mPositionAttributesBuffer = std::move(other.mPositionAttributesBuffer);
         mVertexAttributesBuffer = std::move(other.mVertexAttributesBuffer);
         mTextureDescriptorBuffer = std::move(other.mTextureDescriptorBuffer);
-        mTextureBuffer = std::move(other.mTextureBuffer);
+        mTexturePageBuffers = std::move(other.mTexturePageBuffers);
         mBlueNoiseBuffer = std::move(other.mBlueNoiseBuffer);
         mBvhBindGroup = std::move(other.mBvhBindGroup);
         mSampleBindGroup = std::move(other.mSampleBindGroup);
-        computePipelineSafeRelease(mPipeline);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mPipeline = std::move(other.mPipeline);
+        mReconstructPipeline = std::move(other.mReconstructPipeline);
+        mVirtualTextureTable = std::move(other.mVirtualTextureTable);
+        mVirtualTileCache = std::move(other.mVirtualTileCache);
+        mVirtualTextureSources = std::move(other.mVirtualTextureSources);
+        mVirtualTileFeedback = std::move(other.mVirtualTileFeedback);
+        mVirtualTileTexels = std::move(other.mVirtualTileTexels);
+        mVirtualTileFeedbackBuffer = std::move(other.mVirtualTileFeedbackBuffer);
+        mVirtualTileFeedbackReadbackBuffer = std::move(other.mVirtualTileFeedbackReadbackBuffer);
+        mVirtualTileIndirectionBuffer = std::move(other.mVirtualTileIndirectionBuffer);
+        mVirtualTilePoolBuffer = std::move(other.mVirtualTilePoolBuffer);
+        mVirtualTileFeedbackCopied = other.mVirtualTileFeedbackCopied;
     }
     return *this;
 }
 
+DeferredRenderer::LightingPass::~LightingPass() { releaseVirtualTileFeedback(); }
+
+void DeferredRenderer::LightingPass::releaseVirtualTileFeedback() noexcept
+{
+    // Destroying the readback buffer aborts a pending map request, and the orphaned feedback stops
+    // the callback from touching the buffer.
+    if (mVirtualTileFeedback)
+    {
+        mVirtualTileFeedback->isOrphaned = true;
+        mVirtualTileFeedback.reset();
+    }
+}
+
 void DeferredRenderer::LightingPass::render(
-    const GpuContext&        gpuContext,
+    GpuUploadRing&           uploadRing,
     const WGPUCommandEncoder cmdEncoder,
     const glm::mat4&         inverseViewReverseZProjectionMatrix,
     const glm::vec3&         cameraPosition,
     const Extent2f&          fbsize,
     const Sky&               sky,
-    const std::uint32_t      frameCount)
+    const std::uint32_t      frameCount,
+    const LightingResolution lightingResolution)
 {
-    if (mCurrentSky != sky)
-    {
-        mCurrentSky = sky;
-        const AlignedSkyState skyState{sky};
-        wgpuQueueWriteBuffer(
-            gpuContext.queue, mSkyStateBuffer.ptr(), 0, &skyState, sizeof(AlignedSkyState));
-    }
+    mSkyStateCache->update(sky);
+    writeSkyState(uploadRing, cmdEncoder, mSkyStateBuffer, *mSkyStateCache);
 
     {
         const Uniforms uniforms{
@@ -1725,9 +2032,15 @@ void DeferredRenderer::LightingPass::render(
             glm::vec4(cameraPosition, 1.f),
             glm::vec2(fbsize.x, fbsize.y),
             frameCount,
-            0};
-        wgpuQueueWriteBuffer(
-            gpuContext.queue, mUniformBuffer.ptr(), 0, &uniforms, sizeof(Uniforms));
+            static_cast<std::uint32_t>(lightingResolution)};
+        uploadRing.write(cmdEncoder, mUniformBuffer.ptr(), uniforms);
+    }
+
+    if (virtualTexturingEnabled())
+    {
+        streamVirtualTiles(uploadRing, cmdEncoder);
+        wgpuCommandEncoderClearBuffer(
+            cmdEncoder, mVirtualTileFeedbackBuffer.ptr(), 0, mVirtualTileFeedbackBuffer.byteSize());
     }
 
     const WGPUComputePassEncoder computePass = [cmdEncoder]() -> WGPUComputePassEncoder {
@@ -1740,17 +2053,140 @@ void DeferredRenderer::LightingPass::render(
     }();
     NLRS_ASSERT(computePass != nullptr);
 
-    wgpuComputePassEncoderSetPipeline(computePass, mPipeline);
+    wgpuComputePassEncoderSetPipeline(computePass, mPipeline.get());
     wgpuComputePassEncoderSetBindGroup(computePass, 0, mSampleBindGroup.ptr(), 0, nullptr);
     wgpuComputePassEncoderSetBindGroup(computePass, 1, mUniformBindGroup.ptr(), 0, nullptr);
     wgpuComputePassEncoderSetBindGroup(computePass, 2, mGbufferBindGroup.ptr(), 0, nullptr);
     wgpuComputePassEncoderSetBindGroup(computePass, 3, mBvhBindGroup.ptr(), 0, nullptr);
 
-    const std::uint32_t workgroupCountX = static_cast<std::uint32_t>(0.5f + fbsize.x / 8.f);
-    const std::uint32_t workgroupCountY = static_cast<std::uint32_t>(0.5f + fbsize.y / 8.f);
-    wgpuComputePassEncoderDispatchWorkgroups(computePass, workgroupCountX, workgroupCountY, 1);
+    // One invocation per traced pixel. The workgroup counts are rounded up, so that the last
+    // traced row and column are covered when the traced extent isn't a multiple of the workgroup.
+    const Extent2u fullSize = Extent2u(fbsize);
+    const Extent2u tracedSize = [fullSize, lightingResolution]() -> Extent2u {
+        switch (lightingResolution)
+        {
+        case LightingResolution::Full:
+            return fullSize;
+        case LightingResolution::Half:
+            return Extent2u((fullSize.x + 1) / 2, (fullSize.y + 1) / 2);
+        case LightingResolution::Checkerboard:
+            return Extent2u((fullSize.x + 1) / 2, fullSize.y);
+        }
+        NLRS_ASSERT(false);
+        return fullSize;
+    }();
+    wgpuComputePassEncoderDispatchWorkgroups(
+        computePass, (tracedSize.x + 7) / 8, (tracedSize.y + 7) / 8, 1);
+
+    if (lightingResolution != LightingResolution::Full)
+    {
+        wgpuComputePassEncoderSetPipeline(computePass, mReconstructPipeline.get());
+        wgpuComputePassEncoderDispatchWorkgroups(
+            computePass, (fullSize.x + 7) / 8, (fullSize.y + 7) / 8, 1);
+    }
 
     wgpuComputePassEncoderEnd(computePass);
+
+    // Feedback is recorded every frame, but only copied for readback when the previous readback
+    // has completed.
+    if (virtualTexturingEnabled() &&
+        wgpuBufferGetMapState(mVirtualTileFeedbackReadbackBuffer.ptr()) ==
+            WGPUBufferMapState_Unmapped)
+    {
+        wgpuCommandEncoderCopyBufferToBuffer(
+            cmdEncoder,
+            mVirtualTileFeedbackBuffer.ptr(),
+            0,
+            mVirtualTileFeedbackReadbackBuffer.ptr(),
+            0,
+            mVirtualTileFeedbackBuffer.byteSize());
+        mVirtualTileFeedbackCopied = true;
+    }
+}
+
+void DeferredRenderer::LightingPass::readbackVirtualTileFeedback()
+{
+    if (!mVirtualTileFeedbackCopied)
+    {
+        return;
+    }
+    mVirtualTileFeedbackCopied = false;
+
+    wgpuBufferMapAsync(
+        mVirtualTileFeedbackReadbackBuffer.ptr(),
+        WGPUMapMode_Read,
+        0,
+        mVirtualTileFeedbackReadbackBuffer.byteSize(),
+        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+            const std::unique_ptr<VirtualTileFeedbackMapRequest> request(
+                static_cast<VirtualTileFeedbackMapRequest*>(userdata));
+            VirtualTileFeedback& feedback = *request->feedback;
+            // The map is aborted when the readback buffer is destroyed, e.g. on shutdown.
+            if (feedback.isOrphaned ||
+                status == WGPUBufferMapAsyncStatus_DestroyedBeforeCallback ||
+                status == WGPUBufferMapAsyncStatus_UnmappedBeforeCallback)
+            {
+                return;
+            }
+            if (status != WGPUBufferMapAsyncStatus_Success)
+            {
+                std::fprintf(stderr, "Failed to map virtual tile feedback buffer\n");
+                return;
+            }
+
+            const void* const bufferData =
+                wgpuBufferGetConstMappedRange(request->readbackBuffer, 0, request->byteSize);
+            NLRS_ASSERT(bufferData != nullptr);
+            feedback.requests = aggregateTileRequests(std::span<const std::uint32_t>(
+                static_cast<const std::uint32_t*>(bufferData), request->virtualTileCount));
+            wgpuBufferUnmap(request->readbackBuffer);
+        },
+        new VirtualTileFeedbackMapRequest{
+            mVirtualTileFeedback,
+            mVirtualTileFeedbackReadbackBuffer.ptr(),
+            mVirtualTileFeedbackReadbackBuffer.byteSize(),
+            mVirtualTextureTable.virtualTileCount()});
+}
+
+void DeferredRenderer::LightingPass::streamVirtualTiles(
+    GpuUploadRing&           uploadRing,
+    const WGPUCommandEncoder cmdEncoder)
+{
+    std::vector<std::uint32_t>& requests = mVirtualTileFeedback->requests;
+    if (requests.empty())
+    {
+        return;
+    }
+
+    const std::vector<TileUpload> uploads =
+        mVirtualTileCache.update(requests, MAX_VIRTUAL_TILE_UPLOADS_PER_FRAME);
+    requests.clear();
+    if (uploads.empty())
+    {
+        return;
+    }
+
+    mVirtualTileTexels.resize(VIRTUAL_TILE_TEXEL_COUNT);
+    for (const TileUpload& upload : uploads)
+    {
+        const VirtualTileLocation location = mVirtualTextureTable.tileLocation(upload.virtualTile);
+        copyVirtualTileTexels(
+            mVirtualTextureSources[location.textureIdx],
+            location.tileX,
+            location.tileY,
+            mVirtualTileTexels);
+
+        const std::size_t tileByteSize = VIRTUAL_TILE_TEXEL_COUNT * sizeof(Texture::BgraPixel);
+        uploadRing.write(
+            cmdEncoder,
+            mVirtualTilePoolBuffer.ptr(),
+            upload.physicalTile * tileByteSize,
+            std::as_bytes(std::span<const Texture::BgraPixel>(mVirtualTileTexels)));
+    }
+
+    const std::span<const std::uint32_t> indirection = mVirtualTileCache.indirectionTable();
+    uploadRing.write(
+        cmdEncoder, mVirtualTileIndirectionBuffer.ptr(), 0, std::as_bytes(indirection));
 }
 
 void DeferredRenderer::LightingPass::resize(
@@ -1769,8 +2205,338 @@ void DeferredRenderer::LightingPass::resize(
             textureBindGroupEntry(2, depthTextureView)}};
 }
 
+DeferredRenderer::DenoisePass::DenoisePass(
+    const GpuContext&                 gpuContext,
+    const WGPUTextureView             albedoTextureView,
+    const WGPUTextureView             normalTextureView,
+    const WGPUTextureView             depthTextureView,
+    const GpuBuffer&                  sampleBuffer,
+    const DeferredRendererDescriptor& rendererDesc)
+    : mUniformBuffer{
+          gpuContext.device,
+          "Denoise pass uniform buffer",
+          {GpuBufferUsage::Uniform, GpuBufferUsage::CopyDst},
+          sizeof(Uniforms)},
+      mUniformBindGroup{},
+      mIlluminationHistoryBuffers{},
+      mMomentsHistoryBuffers{},
+      mHistoryBindGroups{},
+      mFilterBuffers{},
+      mFilterBindGroups{},
+      mGbufferBindGroupLayout{},
+      mGbufferBindGroup{},
+      mTemporalAccumulationPipeline{},
+      mVarianceEstimationPipeline{},
+      mAtrousPipelines{}
+{
+    for (std::size_t idx = 0; idx < 2; ++idx)
+    {
+        mIlluminationHistoryBuffers[idx] = GpuBuffer{
+            gpuContext.device,
+            "Deferred renderer :: illumination history buffer",
+            GpuBufferUsages{GpuBufferUsage::Storage},
+            sizeof(glm::vec4) * area(rendererDesc.maxFramebufferSize),
+            GpuMemoryCategory::Accumulation};
+        // The moments, depth and packed normal of each pixel.
+        mMomentsHistoryBuffers[idx] = GpuBuffer{
+            gpuContext.device,
+            "Deferred renderer :: moments history buffer",
+            GpuBufferUsages{GpuBufferUsage::Storage},
+            sizeof(glm::vec4) * area(rendererDesc.maxFramebufferSize),
+            GpuMemoryCategory::Accumulation};
+        mFilterBuffers[idx] = GpuBuffer{
+            gpuContext.device,
+            "Deferred renderer :: denoise filter buffer",
+            GpuBufferUsages{GpuBufferUsage::Storage},
+            sizeof(glm::vec4) * area(rendererDesc.maxFramebufferSize),
+            GpuMemoryCategory::Accumulation};
+    }
+
+    const GpuBindGroupLayout uniformBindGroupLayout{
+        gpuContext.device,
+        "Denoise pass uniform bind group layout",
+        mUniformBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute, sizeof(Uniforms))};
+
+    mUniformBindGroup = GpuBindGroup{
+        gpuContext.device,
+        "Denoise pass uniform bind group",
+        uniformBindGroupLayout.ptr(),
+        mUniformBuffer.bindGroupEntry(0)};
+
+    const GpuBindGroupLayout historyBindGroupLayout{
+        gpuContext.device,
+        "Denoise pass history bind group layout",
+        std::array<WGPUBindGroupLayoutEntry, 5>{
+            sampleBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute),
+            mIlluminationHistoryBuffers[0].bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
+            mMomentsHistoryBuffers[0].bindGroupLayoutEntry(2, WGPUShaderStage_Compute),
+            mIlluminationHistoryBuffers[1].bindGroupLayoutEntry(3, WGPUShaderStage_Compute),
+            mMomentsHistoryBuffers[1].bindGroupLayoutEntry(4, WGPUShaderStage_Compute)}};
+
+    // Even frames write to the first history buffers, and odd frames to the second ones.
+    for (std::size_t idx = 0; idx < 2; ++idx)
+    {
+        const std::size_t previousIdx = 1 - idx;
+        mHistoryBindGroups[idx] = GpuBindGroup{
+            gpuContext.device,
+            "Denoise pass history bind group",
+            historyBindGroupLayout.ptr(),
+            std::array<WGPUBindGroupEntry, 5>{
+                sampleBuffer.bindGroupEntry(0),
+                mIlluminationHistoryBuffers[previousIdx].bindGroupEntry(1),
+                mMomentsHistoryBuffers[previousIdx].bindGroupEntry(2),
+                mIlluminationHistoryBuffers[idx].bindGroupEntry(3),
+                mMomentsHistoryBuffers[idx].bindGroupEntry(4)}};
+    }
+
+    const GpuBindGroupLayout filterBindGroupLayout{
+        gpuContext.device,
+        "Denoise pass filter bind group layout",
+        std::array<WGPUBindGroupLayoutEntry, 2>{
+            mFilterBuffers[0].bindGroupLayoutEntry(0, WGPUShaderStage_Compute),
+            mFilterBuffers[1].bindGroupLayoutEntry(1, WGPUShaderStage_Compute)}};
+
+    // The first bind group reads from the first filter buffer and writes to the second one, and the
+    // second bind group the other way around.
+    for (std::size_t idx = 0; idx < 2; ++idx)
+    {
+        mFilterBindGroups[idx] = GpuBindGroup{
+            gpuContext.device,
+            "Denoise pass filter bind group",
+            filterBindGroupLayout.ptr(),
+            std::array<WGPUBindGroupEntry, 2>{
+                mFilterBuffers[idx].bindGroupEntry(0),
+                mFilterBuffers[1 - idx].bindGroupEntry(1)}};
+    }
+
+    mGbufferBindGroupLayout = GpuBindGroupLayout{
+        gpuContext.device,
+        "Denoise pass gbuffer bind group layout",
+        std::array<WGPUBindGroupLayoutEntry, 3>{
+            textureBindGroupLayoutEntry(
+                0, WGPUTextureSampleType_UnfilterableFloat, WGPUShaderStage_Compute),
+            textureBindGroupLayoutEntry(
+                1, WGPUTextureSampleType_UnfilterableFloat, WGPUShaderStage_Compute),
+            textureBindGroupLayoutEntry(2, WGPUTextureSampleType_Depth, WGPUShaderStage_Compute)}};
+
+    resize(gpuContext, albedoTextureView, normalTextureView, depthTextureView);
+
+    {
+        const WGPUShaderModule shaderModule = [&gpuContext]() -> WGPUShaderModule {
+            const WGPUShaderModuleWGSLDescriptor wgslDesc = {
+                .chain =
+                    WGPUChainedStruct{
+                        .next = nullptr,
+                        .sType = WGPUSType_ShaderModuleWGSLDescriptor,
+                    },
+                .code = DEFERRED_RENDERER_DENOISE_PASS_SOURCE,
+            };
+
+            const WGPUShaderModuleDescriptor moduleDesc{
+                .nextInChain = &wgslDesc.chain,
+                .label = "Denoise pass shader",
+            };
+
+            return wgpuDeviceCreateShaderModule(gpuContext.device, &moduleDesc);
+        }();
+        NLRS_ASSERT(shaderModule != nullptr);
+
+        // All kernels share the pipeline layout, so that the bind groups are only set once.
+        const WGPUBindGroupLayout bindGroupLayouts[] = {
+            uniformBindGroupLayout.ptr(),
+            historyBindGroupLayout.ptr(),
+            filterBindGroupLayout.ptr(),
+            mGbufferBindGroupLayout.ptr()};
+
+        const WGPUPipelineLayoutDescriptor pipelineLayoutDesc{
+            .nextInChain = nullptr,
+            .label = "Denoise pass pipeline layout",
+            .bindGroupLayoutCount = std::size(bindGroupLayouts),
+            .bindGroupLayouts = bindGroupLayouts,
+        };
+
+        const WGPUPipelineLayout pipelineLayout =
+            wgpuDeviceCreatePipelineLayout(gpuContext.device, &pipelineLayoutDesc);
+
+        const auto createPipeline =
+            [&gpuContext, pipelineLayout, shaderModule](
+                const char* const                        entryPoint,
+                const std::span<const WGPUConstantEntry> constants) -> AsyncComputePipeline {
+            const WGPUComputePipelineDescriptor pipelineDesc{
+                .nextInChain = nullptr,
+                .label = entryPoint,
+                .layout = pipelineLayout,
+                .compute =
+                    WGPUProgrammableStageDescriptor{
+                        .nextInChain = nullptr,
+                        .module = shaderModule,
+                        .entryPoint = entryPoint,
+                        .constantCount = constants.size(),
+                        .constants = constants.data(),
+                    },
+            };
+            return AsyncComputePipeline(gpuContext.device, pipelineDesc);
+        };
+
+        mTemporalAccumulationPipeline = createPipeline("temporalAccumulation", {});
+        mVarianceEstimationPipeline = createPipeline("estimateVariance", {});
+        for (std::size_t iteration = 0; iteration < ATROUS_ITERATION_COUNT; ++iteration)
+        {
+            const std::array<WGPUConstantEntry, 2> constants{
+                WGPUConstantEntry{
+                    .nextInChain = nullptr,
+                    .key = "STEP_SIZE",
+                    .value = static_cast<double>(1u << iteration),
+                },
+                WGPUConstantEntry{
+                    .nextInChain = nullptr,
+                    .key = "IS_LAST_ITERATION",
+                    .value = iteration + 1 == ATROUS_ITERATION_COUNT ? 1.0 : 0.0,
+                }};
+            mAtrousPipelines[iteration] = createPipeline("atrous", constants);
+        }
+
+        wgpuPipelineLayoutRelease(pipelineLayout);
+        wgpuShaderModuleRelease(shaderModule);
+    }
+}
+
+DeferredRenderer::DenoisePass::DenoisePass(DenoisePass&& other) noexcept
+{
+    if (this != &other)
+    {
+        mUniformBuffer = std::move(other.mUniformBuffer);
+        mUniformBindGroup = std::move(other.mUniformBindGroup);
+        mIlluminationHistoryBuffers = std::move(other.mIlluminationHistoryBuffers);
+        mMomentsHistoryBuffers = std::move(other.mMomentsHistoryBuffers);
+        mHistoryBindGroups = std::move(other.mHistoryBindGroups);
+        mFilterBuffers = std::move(other.mFilterBuffers);
+        mFilterBindGroups = std::move(other.mFilterBindGroups);
+        mGbufferBindGroupLayout = std::move(other.mGbufferBindGroupLayout);
+        mGbufferBindGroup = std::move(other.mGbufferBindGroup);
+        mTemporalAccumulationPipeline = std::move(other.mTemporalAccumulationPipeline);
+        mVarianceEstimationPipeline = std::move(other.mVarianceEstimationPipeline);
+        mAtrousPipelines = std::move(other.mAtrousPipelines);
+    }
+}
+
+DeferredRenderer::DenoisePass& DeferredRenderer::DenoisePass::operator=(
+    DenoisePass&& other) noexcept
+{
+    if (this != &other)
+    {
+        mUniformBuffer = std::move(other.mUniformBuffer);
+        mUniformBindGroup = std::move(other.mUniformBindGroup);
+        mIlluminationHistoryBuffers = std::move(other.mIlluminationHistoryBuffers);
+        mMomentsHistoryBuffers = std::move(other.mMomentsHistoryBuffers);
+        mHistoryBindGroups = std::move(other.mHistoryBindGroups);
+        mFilterBuffers = std::move(other.mFilterBuffers);
+        mFilterBindGroups = std::move(other.mFilterBindGroups);
+        mGbufferBindGroupLayout = std::move(other.mGbufferBindGroupLayout);
+        mGbufferBindGroup = std::move(other.mGbufferBindGroup);
+        mTemporalAccumulationPipeline = std::move(other.mTemporalAccumulationPipeline);
+        mVarianceEstimationPipeline = std::move(other.mVarianceEstimationPipeline);
+        mAtrousPipelines = std::move(other.mAtrousPipelines);
+    }
+    return *this;
+}
+
+bool DeferredRenderer::DenoisePass::isReady() const noexcept
+{
+    return mTemporalAccumulationPipeline.isReady() && mVarianceEstimationPipeline.isReady() &&
+           std::all_of(
+               mAtrousPipelines.begin(),
+               mAtrousPipelines.end(),
+               [](const AsyncComputePipeline& pipeline) -> bool { return pipeline.isReady(); });
+}
+
+bool DeferredRenderer::DenoisePass::hasFailed() const noexcept
+{
+    return mTemporalAccumulationPipeline.hasFailed() || mVarianceEstimationPipeline.hasFailed() ||
+           std::any_of(
+               mAtrousPipelines.begin(),
+               mAtrousPipelines.end(),
+               [](const AsyncComputePipeline& pipeline) -> bool { return pipeline.hasFailed(); });
+}
+
+void DeferredRenderer::DenoisePass::render(
+    GpuUploadRing&           uploadRing,
+    const WGPUCommandEncoder cmdEncoder,
+    const glm::mat4&         inverseViewProjectionMat,
+    const glm::mat4&         previousViewProjectionMat,
+    const Extent2f&          fbsize,
+    const std::uint32_t      frameCount)
+{
+    {
+        const Uniforms uniforms{
+            inverseViewProjectionMat,
+            previousViewProjectionMat,
+            glm::vec2(fbsize.x, fbsize.y),
+            frameCount,
+            0};
+        uploadRing.write(cmdEncoder, mUniformBuffer.ptr(), uniforms);
+    }
+
+    const WGPUComputePassEncoder computePass = [cmdEncoder]() -> WGPUComputePassEncoder {
+        const WGPUComputePassDescriptor computePassDesc{
+            .nextInChain = nullptr,
+            .label = "Denoise pass compute pass descriptor",
+            .timestampWrites = nullptr,
+        };
+        return wgpuCommandEncoderBeginComputePass(cmdEncoder, &computePassDesc);
+    }();
+    NLRS_ASSERT(computePass != nullptr);
+
+    // The workgroup counts are rounded up, so that every pixel is filtered and the filter's taps
+    // never read texels which no kernel has written.
+    const Extent2u      size = Extent2u(fbsize);
+    const std::uint32_t workgroupCountX = (size.x + 7) / 8;
+    const std::uint32_t workgroupCountY = (size.y + 7) / 8;
+
+    wgpuComputePassEncoderSetBindGroup(computePass, 0, mUniformBindGroup.ptr(), 0, nullptr);
+    wgpuComputePassEncoderSetBindGroup(
+        computePass, 1, mHistoryBindGroups[frameCount % 2].ptr(), 0, nullptr);
+    wgpuComputePassEncoderSetBindGroup(computePass, 3, mGbufferBindGroup.ptr(), 0, nullptr);
+
+    // The variance estimate is written to the first filter buffer, which the first à-trous
+    // iteration reads from.
+    wgpuComputePassEncoderSetBindGroup(computePass, 2, mFilterBindGroups[1].ptr(), 0, nullptr);
+    wgpuComputePassEncoderSetPipeline(computePass, mTemporalAccumulationPipeline.get());
+    wgpuComputePassEncoderDispatchWorkgroups(computePass, workgroupCountX, workgroupCountY, 1);
+    wgpuComputePassEncoderSetPipeline(computePass, mVarianceEstimationPipeline.get());
+    wgpuComputePassEncoderDispatchWorkgroups(computePass, workgroupCountX, workgroupCountY, 1);
+
+    for (std::size_t iteration = 0; iteration < ATROUS_ITERATION_COUNT; ++iteration)
+    {
+        wgpuComputePassEncoderSetBindGroup(
+            computePass, 2, mFilterBindGroups[iteration % 2].ptr(), 0, nullptr);
+        wgpuComputePassEncoderSetPipeline(computePass, mAtrousPipelines[iteration].get());
+        wgpuComputePassEncoderDispatchWorkgroups(computePass, workgroupCountX, workgroupCountY, 1);
+    }
+
+    wgpuComputePassEncoderEnd(computePass);
+}
+
+void DeferredRenderer::DenoisePass::resize(
+    const GpuContext&     gpuContext,
+    const WGPUTextureView albedoTextureView,
+    const WGPUTextureView normalTextureView,
+    const WGPUTextureView depthTextureView)
+{
+    mGbufferBindGroup = GpuBindGroup{
+        gpuContext.device,
+        "Denoise pass gbuffer bind group",
+        mGbufferBindGroupLayout.ptr(),
+        std::array<WGPUBindGroupEntry, 3>{
+            textureBindGroupEntry(0, albedoTextureView),
+            textureBindGroupEntry(1, normalTextureView),
+            textureBindGroupEntry(2, depthTextureView)}};
+}
+
 DeferredRenderer::ResolvePass::ResolvePass(
     const GpuContext&                 gpuContext,
+    const WGPUTextureView             normalTextureView,
+    const WGPUTextureView             depthTextureView,
     const GpuBuffer&                  sampleBuffer,
     const DeferredRendererDescriptor& rendererDesc)
     : mVertexBuffer{gpuContext.device, "Resolve pass vertex buffer", {GpuBufferUsage::Vertex, GpuBufferUsage::CopyDst}, std::span<const float[2]>(quadVertexData)},
@@ -1780,14 +2546,29 @@ DeferredRenderer::ResolvePass::ResolvePass(
           {GpuBufferUsage::Uniform, GpuBufferUsage::CopyDst},
           sizeof(Uniforms)},
       mUniformBindGroup{},
-      mAccumulationBuffer{
-          gpuContext.device,
-          "Deferred renderer :: accumulation buffer",
-          GpuBufferUsages{GpuBufferUsage::Storage},
-          3 * sizeof(float) * area(rendererDesc.maxFramebufferSize)},
-      mTaaBindGroup{},
-      mPipeline(nullptr)
+      mColorHistoryBuffers{},
+      mGeometryHistoryBuffers{},
+      mTaaBindGroups{},
+      mGbufferBindGroupLayout{},
+      mGbufferBindGroup{},
+      mPipeline()
 {
+    for (std::size_t idx = 0; idx < 2; ++idx)
+    {
+        mColorHistoryBuffers[idx] = GpuBuffer{
+            gpuContext.device,
+            "Deferred renderer :: color history buffer",
+            GpuBufferUsages{GpuBufferUsage::Storage, GpuBufferUsage::CopySrc},
+            sizeof(glm::vec4) * area(rendererDesc.maxFramebufferSize),
+            GpuMemoryCategory::Accumulation};
+        mGeometryHistoryBuffers[idx] = GpuBuffer{
+            gpuContext.device,
+            "Deferred renderer :: geometry history buffer",
+            GpuBufferUsages{GpuBufferUsage::Storage},
+            sizeof(std::uint32_t[2]) * area(rendererDesc.maxFramebufferSize),
+            GpuMemoryCategory::Accumulation};
+    }
+
     const GpuBindGroupLayout uniformBindGroupLayout{
         gpuContext.device,
         "TAA uniform bind group layout",
@@ -1802,22 +2583,50 @@ DeferredRenderer::ResolvePass::ResolvePass(
     const GpuBindGroupLayout taaBindGroupLayout{
         gpuContext.device,
         "TAA bind group layout",
-        std::array<WGPUBindGroupLayoutEntry, 2>{
+        std::array<WGPUBindGroupLayoutEntry, 5>{
             sampleBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Fragment),
-            mAccumulationBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Fragment)}};
+            mColorHistoryBuffers[0].bindGroupLayoutEntry(1, WGPUShaderStage_Fragment),
+            mGeometryHistoryBuffers[0].bindGroupLayoutEntry(2, WGPUShaderStage_Fragment),
+            mColorHistoryBuffers[1].bindGroupLayoutEntry(3, WGPUShaderStage_Fragment),
+            mGeometryHistoryBuffers[1].bindGroupLayoutEntry(4, WGPUShaderStage_Fragment)}};
 
-    mTaaBindGroup = GpuBindGroup{
+    // Even frames write to the first history buffers, and odd frames to the second ones.
+    for (std::size_t idx = 0; idx < 2; ++idx)
+    {
+        const std::size_t previousIdx = 1 - idx;
+        mTaaBindGroups[idx] = GpuBindGroup{
+            gpuContext.device,
+            "TAA bind group",
+            taaBindGroupLayout.ptr(),
+            std::array<WGPUBindGroupEntry, 5>{
+                sampleBuffer.bindGroupEntry(0),
+                mColorHistoryBuffers[previousIdx].bindGroupEntry(1),
+                mGeometryHistoryBuffers[previousIdx].bindGroupEntry(2),
+                mColorHistoryBuffers[idx].bindGroupEntry(3),
+                mGeometryHistoryBuffers[idx].bindGroupEntry(4)}};
+    }
+
+    mGbufferBindGroupLayout = GpuBindGroupLayout{
         gpuContext.device,
-        "TAA bind group",
-        taaBindGroupLayout.ptr(),
+        "Resolve pass gbuffer bind group layout",
+        std::array<WGPUBindGroupLayoutEntry, 2>{
+            textureBindGroupLayoutEntry(
+                0, WGPUTextureSampleType_UnfilterableFloat, WGPUShaderStage_Fragment),
+            textureBindGroupLayoutEntry(1, WGPUTextureSampleType_Depth, WGPUShaderStage_Fragment)}};
+
+    mGbufferBindGroup = GpuBindGroup{
+        gpuContext.device,
+        "Resolve pass gbuffer bind group",
+        mGbufferBindGroupLayout.ptr(),
         std::array<WGPUBindGroupEntry, 2>{
-            sampleBuffer.bindGroupEntry(0), mAccumulationBuffer.bindGroupEntry(1)}};
+            textureBindGroupEntry(0, normalTextureView),
+            textureBindGroupEntry(1, depthTextureView)}};
 
     {
         // Pipeline layout
 
         const WGPUBindGroupLayout bindGroupLayouts[] = {
-            uniformBindGroupLayout.ptr(), taaBindGroupLayout.ptr()};
+            uniformBindGroupLayout.ptr(), taaBindGroupLayout.ptr(), mGbufferBindGroupLayout.ptr()};
 
         const WGPUPipelineLayoutDescriptor pipelineLayoutDesc{
             .nextInChain = nullptr,
@@ -1933,17 +2742,11 @@ DeferredRenderer::ResolvePass::ResolvePass(
             .fragment = &fragmentState,
         };
 
-        mPipeline = wgpuDeviceCreateRenderPipeline(gpuContext.device, &pipelineDesc);
+        mPipeline = AsyncRenderPipeline(gpuContext.device, pipelineDesc);
         wgpuPipelineLayoutRelease(pipelineLayout);
     }
 }
 
-DeferredRenderer::ResolvePass::~ResolvePass()
-{
-    renderPipelineSafeRelease(mPipeline);
-    mPipeline = nullptr;
-}
-
 DeferredRenderer::ResolvePass::ResolvePass(ResolvePass&& other) noexcept
 {
     if (this != &other)
@@ -1951,10 +2754,12 @@ DeferredRenderer::ResolvePass::ResolvePass(ResolvePass&& other) noexcept
         mVertexBuffer = std::move(other.mVertexBuffer);
         mUniformBuffer = std::move(other.mUniformBuffer);
         mUniformBindGroup = std::move(other.mUniformBindGroup);
-        mAccumulationBuffer = std::move(other.mAccumulationBuffer);
-        mTaaBindGroup = std::move(other.mTaaBindGroup);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mColorHistoryBuffers = std::move(other.mColorHistoryBuffers);
+        mGeometryHistoryBuffers = std::move(other.mGeometryHistoryBuffers);
+        mTaaBindGroups = std::move(other.mTaaBindGroups);
+        mGbufferBindGroupLayout = std::move(other.mGbufferBindGroupLayout);
+        mGbufferBindGroup = std::move(other.mGbufferBindGroup);
+        mPipeline = std::move(other.mPipeline);
     }
 }
 
@@ -1966,28 +2771,35 @@ DeferredRenderer::ResolvePass& DeferredRenderer::ResolvePass::operator=(
         mVertexBuffer = std::move(other.mVertexBuffer);
         mUniformBuffer = std::move(other.mUniformBuffer);
         mUniformBindGroup = std::move(other.mUniformBindGroup);
-        mAccumulationBuffer = std::move(other.mAccumulationBuffer);
-        mTaaBindGroup = std::move(other.mTaaBindGroup);
-        renderPipelineSafeRelease(mPipeline);
-        mPipeline = other.mPipeline;
-        other.mPipeline = nullptr;
+        mColorHistoryBuffers = std::move(other.mColorHistoryBuffers);
+        mGeometryHistoryBuffers = std::move(other.mGeometryHistoryBuffers);
+        mTaaBindGroups = std::move(other.mTaaBindGroups);
+        mGbufferBindGroupLayout = std::move(other.mGbufferBindGroupLayout);
+        mGbufferBindGroup = std::move(other.mGbufferBindGroup);
+        mPipeline = std::move(other.mPipeline);
     }
     return *this;
 }
 
 void DeferredRenderer::ResolvePass::render(
-    const GpuContext&        gpuContext,
+    GpuUploadRing&           uploadRing,
     const WGPUCommandEncoder cmdEncoder,
     WGPUTextureView          targetTextureView,
+    const glm::mat4&         inverseViewProjectionMat,
+    const glm::mat4&         previousViewProjectionMat,
     const Extent2f&          fbsize,
     const float              exposure,
     const std::uint32_t      frameCount,
-    Gui&                     gui)
+    Gui*                     gui)
 {
     {
-        const Uniforms uniforms{glm::vec2(fbsize.x, fbsize.y), exposure, frameCount};
-        wgpuQueueWriteBuffer(
-            gpuContext.queue, mUniformBuffer.ptr(), 0, &uniforms, sizeof(Uniforms));
+        const Uniforms uniforms{
+            inverseViewProjectionMat,
+            previousViewProjectionMat,
+            glm::vec2(fbsize.x, fbsize.y),
+            exposure,
+            frameCount};
+        uploadRing.write(cmdEncoder, mUniformBuffer.ptr(), uniforms);
     }
 
     const WGPURenderPassEncoder renderPass = [cmdEncoder,
@@ -2016,46 +2828,138 @@ void DeferredRenderer::ResolvePass::render(
     }();
     NLRS_ASSERT(renderPass != nullptr);
 
-    wgpuRenderPassEncoderSetPipeline(renderPass, mPipeline);
+    wgpuRenderPassEncoderSetPipeline(renderPass, mPipeline.get());
     wgpuRenderPassEncoderSetBindGroup(renderPass, 0, mUniformBindGroup.ptr(), 0, nullptr);
-    wgpuRenderPassEncoderSetBindGroup(renderPass, 1, mTaaBindGroup.ptr(), 0, nullptr);
+    wgpuRenderPassEncoderSetBindGroup(
+        renderPass, 1, mTaaBindGroups[frameCount % 2].ptr(), 0, nullptr);
+    wgpuRenderPassEncoderSetBindGroup(renderPass, 2, mGbufferBindGroup.ptr(), 0, nullptr);
     wgpuRenderPassEncoderSetVertexBuffer(
         renderPass, 0, mVertexBuffer.ptr(), 0, mVertexBuffer.byteSize());
     wgpuRenderPassEncoderDraw(renderPass, 6, 1, 0, 0);
 
-    gui.render(renderPass);
+    if (gui)
+    {
+        gui->render(renderPass);
+    }
 
     wgpuRenderPassEncoderEnd(renderPass);
 }
 
-DeferredRenderer::PerfStats DeferredRenderer::getPerfStats() const
+std::vector<glm::vec3> DeferredRenderer::ResolvePass::readColorHistory(
+    const GpuContext&   gpuContext,
+    const Extent2u&     framebufferSize,
+    const std::uint32_t frameCount) const
 {
-    NLRS_ASSERT(mGbufferPassDurationsNs.size() == mLightingPassDurationsNs.size());
+    const GpuBuffer&  colorHistoryBuffer = mColorHistoryBuffers[frameCount % 2];
+    const std::size_t byteSize = sizeof(glm::vec4) * area(framebufferSize);
+    NLRS_ASSERT(colorHistoryBuffer.byteSize() >= byteSize);
+
+    const GpuBuffer readbackBuffer(
+        gpuContext.device,
+        "Deferred renderer :: color history readback buffer",
+        {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
+        byteSize);
+
+    const WGPUCommandEncoder encoder = [&gpuContext]() {
+        const WGPUCommandEncoderDescriptor cmdEncoderDesc{
+            .nextInChain = nullptr,
+            .label = "Color history readback command encoder",
+        };
+        return wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
+    }();
+    wgpuCommandEncoderCopyBufferToBuffer(
+        encoder, colorHistoryBuffer.ptr(), 0, readbackBuffer.ptr(), 0, byteSize);
+    const WGPUCommandBuffer cmdBuffer = [encoder]() {
+        const WGPUCommandBufferDescriptor cmdBufferDesc{
+            .nextInChain = nullptr,
+            .label = "Color history readback command buffer",
+        };
+        return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    }();
+    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+
+    MapResult mapResult;
+    wgpuBufferMapAsync(
+        readbackBuffer.ptr(),
+        WGPUMapMode_Read,
+        0,
+        byteSize,
+        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+            NLRS_ASSERT(userdata != nullptr);
+            MapResult& result = *static_cast<MapResult*>(userdata);
+            result.status = status;
+            result.done = true;
+        },
+        &mapResult);
 
-    if (mGbufferPassDurationsNs.empty())
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
+    while (!mapResult.done)
     {
-        return {};
+        wgpuDeviceTick(gpuContext.device);
     }
 
+    if (mapResult.status != WGPUBufferMapAsyncStatus_Success)
+    {
+        throw std::runtime_error("Failed to map color history readback buffer.");
+    }
+
+    const glm::vec4* const history = static_cast<const glm::vec4*>(
+        wgpuBufferGetConstMappedRange(readbackBuffer.ptr(), 0, byteSize));
+    NLRS_ASSERT(history != nullptr);
+
+    // The alpha channel holds the history length.
+    std::vector<glm::vec3> radiance(area(framebufferSize));
+    std::transform(
+        history, history + radiance.size(), radiance.begin(), [](const glm::vec4& color) {
+            return glm::vec3(color);
+        });
+    wgpuBufferUnmap(readbackBuffer.ptr());
+
+    return radiance;
+}
+
+void DeferredRenderer::ResolvePass::resize(
+    const GpuContext&     gpuContext,
+    const WGPUTextureView normalTextureView,
+    const WGPUTextureView depthTextureView)
+{
+    mGbufferBindGroup = GpuBindGroup{
+        gpuContext.device,
+        "Resolve pass gbuffer bind group",
+        mGbufferBindGroupLayout.ptr(),
+        std::array<WGPUBindGroupEntry, 2>{
+            textureBindGroupEntry(0, normalTextureView),
+            textureBindGroupEntry(1, depthTextureView)}};
+}
+
+DeferredRenderer::PerfStats DeferredRenderer::getPerfStats() const
+{
     return {
-        0.000001f *
-            static_cast<float>(std::accumulate(
-                mGbufferPassDurationsNs.begin(), mGbufferPassDurationsNs.end(), 0ll)) /
-            mGbufferPassDurationsNs.size(),
-        0.000001f *
-            static_cast<float>(std::accumulate(
-                mLightingPassDurationsNs.begin(), mLightingPassDurationsNs.end(), 0ll)) /
-            mLightingPassDurationsNs.size(),
-        0.000001f *
-            static_cast<float>(std::accumulate(
-                mResolvePassDurationsNs.begin(), mResolvePassDurationsNs.end(), 0ll)) /
-            mResolvePassDurationsNs.size()};
+        .gbufferPassDurations = mGbufferPassDurations.summary(),
+        .lightingPassDurations = mLightingPassDurations.summary(),
+        .denoisePassDurations = mDenoisePassDurations.summary(),
+        .resolvePassDurations = mResolvePassDurations.summary(),
+        .renderCpuDurations = mRenderCpuDurations.summary(),
+        .averageUploadByteSize = mUploadRing.averageUploadByteSize(),
+        .lightingResolution = mLightingResolution,
+        .isDynamicResolution = mDynamicResolution.isEnabled(),
+    };
+}
+
+std::vector<glm::vec3> DeferredRenderer::readRadiance(
+    const GpuContext& gpuContext,
+    const Extent2u&   framebufferSize) const
+{
+    NLRS_ASSERT(mFrameCount > 0);
+    return mResolvePass.readColorHistory(gpuContext, framebufferSize, mFrameCount - 1);
 }
 
 void DeferredRenderer::invalidateTemporalAccumulation()
 {
-    // In the first frame of the accumulation sequence, we are forced to write the lighting pass
-    // sample straight to the accumulation buffer. This effectively resets the accumulation.
+    // In the first frame of the accumulation sequence, the denoise and resolve passes ignore their
+    // history and write the current sample straight to it. This effectively resets the
+    // accumulation.
+    // Camera motion doesn't reset the accumulation, since the history is reprojected instead.
     mFrameCount = 0;
 }
 } // namespace nlrs
@@ -1,22 +1,32 @@
 #pragma once
 
 #include "aligned_sky_state.hpp"
+#include "async_pipeline.hpp"
 #include "gpu_bind_group.hpp"
 #include "gpu_bind_group_layout.hpp"
 #include "gpu_buffer.hpp"
+#include "gpu_limits.hpp"
+#include "gpu_timestamp_ring.hpp"
+#include "gpu_tracked_buffer.hpp"
+#include "gpu_upload_ring.hpp"
 
 #include <common/bvh.hpp>
+#include <common/duration_histogram.hpp>
+#include <common/dynamic_resolution.hpp>
 #include <common/extent.hpp>
 #include <common/texture.hpp>
+#include <common/texture_layout.hpp>
+#include <common/virtual_texture.hpp>
 #include <pt-format/vertex_attributes.hpp>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <webgpu/webgpu.h>
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <memory>
 #include <span>
 #include <vector>
 
@@ -39,16 +49,41 @@ struct DeferredRendererDescriptor
     std::span<const BvhNode>           sceneBvhNodes;
     std::span<const PositionAttribute> scenePositionAttributes;
     std::span<const VertexAttributes>  sceneVertexAttributes;
+    TextureLayout                      textureLayout = TextureLayout::Tiled;
+    // When non-zero, the lighting pass streams base color textures on demand into a pool of this
+    // many virtual texture tiles, instead of uploading all texture data up front.
+    std::uint32_t                  virtualTexturePhysicalTileCount = 0;
+    std::shared_ptr<SkyStateCache> skyStateCache;
+    // The lighting pass's bounce count, which its pipeline is specialized for.
+    std::uint32_t                  numBounces = 2;
+    // When non-zero, the lighting resolution is chosen dynamically to keep the GPU frame time
+    // within this budget, overriding RenderDescriptor::lightingResolution.
+    float                          targetFrameMs = 0.0f;
 };
 
+// The resolution at which the lighting pass traces paths. At half resolution, one pixel of each 2x2
+// block is traced per frame, and in the checkerboard pattern every other pixel. The traced pixels
+// shift every frame, and the remaining pixels are reconstructed from the traced pixels around them,
+// weighted by their G-buffer depth and normals.
+enum class LightingResolution : std::uint32_t
+{
+    Full = 0,
+    Half = 1,
+    Checkerboard = 2,
+};
+
+// The name of the lighting resolution, as in the `--lighting-resolution` option.
+const char* lightingResolutionName(LightingResolution);
+
 struct RenderDescriptor
 {
-    glm::mat4       viewReverseZProjectionMatrix;
-    glm::vec3       cameraPosition;
-    Sky             sky;
-    Extent2u        framebufferSize;
-    float           exposure;
-    WGPUTextureView targetTextureView;
+    glm::mat4          viewReverseZProjectionMatrix;
+    glm::vec3          cameraPosition;
+    Sky                sky;
+    Extent2u           framebufferSize;
+    float              exposure;
+    WGPUTextureView    targetTextureView;
+    LightingResolution lightingResolution = LightingResolution::Full;
 };
 
 class DeferredRenderer
@@ -56,9 +91,19 @@ class DeferredRenderer
 public:
     struct PerfStats
     {
-        float averageGbufferPassDurationsMs = 0.0f;
-        float averageLightingPassDurationsMs = 0.0f;
-        float averageResolvePassDurationsMs = 0.0f;
+        // The GPU pass durations of the most recent frames whose timestamps have been read back.
+        DurationHistogram::Summary gbufferPassDurations;
+        DurationHistogram::Summary lightingPassDurations;
+        DurationHistogram::Summary denoisePassDurations;
+        DurationHistogram::Summary resolvePassDurations;
+        // The CPU time spent in `render`.
+        DurationHistogram::Summary renderCpuDurations;
+        // The bytes uploaded per frame through the upload ring.
+        float                      averageUploadByteSize = 0.0f;
+        // The lighting resolution of the most recent frame. With dynamic resolution, it is chosen
+        // by the renderer instead of RenderDescriptor::lightingResolution.
+        LightingResolution         lightingResolution = LightingResolution::Full;
+        bool                       isDynamicResolution = false;
     };
 
     DeferredRenderer(const GpuContext&, const DeferredRendererDescriptor&);
@@ -70,11 +115,27 @@ public:
     DeferredRenderer(DeferredRenderer&&);
     DeferredRenderer& operator=(DeferredRenderer&&);
 
-    void render(const GpuContext&, const RenderDescriptor&, Gui&);
-    void renderDebug(const GpuContext&, const glm::mat4&, const Extent2f&, WGPUTextureView, Gui&);
+    // The pass pipelines are compiled asynchronously. `render` and `renderDebug` must not be called
+    // until their passes are ready, which requires ticking the device. If a pipeline fails to
+    // compile, its passes never become ready.
+    bool isReady() const;
+    bool isDebugReady() const;
+    bool hasFailed() const;
+    bool hasDebugFailed() const;
+
+    // The GUI is drawn on top of the image, unless `gui` is null, e.g. when rendering headless.
+    void render(const GpuContext&, const RenderDescriptor&, Gui*);
+    void renderDebug(const GpuContext&, const glm::mat4&, const Extent2f&, WGPUTextureView, Gui*);
     void resize(const GpuContext&, const Extent2u&);
 
     PerfStats getPerfStats() const;
+    // Blocks until the timestamps of the submitted frames have been read back, e.g. before
+    // reporting the pass durations of a headless run.
+    void      waitForTimestamps(const GpuContext&);
+    // Copies the resolved HDR history of the most recent frame back from GPU memory as linear
+    // radiance, before exposure and tonemapping. `framebufferSize` must match the size of the
+    // rendered frame. The rows are ordered top to bottom. Blocks until the copy has completed.
+    std::vector<glm::vec3> readRadiance(const GpuContext&, const Extent2u& framebufferSize) const;
 
 private:
     struct IndexBuffer
@@ -86,8 +147,9 @@ private:
 
     struct GpuTexture
     {
-        WGPUTexture     texture;
-        WGPUTextureView view;
+        WGPUTexture         texture;
+        WGPUTextureView     view;
+        GpuMemoryAllocation allocation;
     };
 
     struct GbufferPass
@@ -104,7 +166,7 @@ private:
         GpuBuffer                 mUniformBuffer{};
         GpuBindGroup              mUniformBindGroup{};
         GpuBindGroup              mSamplerBindGroup{};
-        WGPURenderPipeline        mPipeline = nullptr;
+        AsyncRenderPipeline       mPipeline{};
 
         struct Uniforms
         {
@@ -122,8 +184,11 @@ private:
         GbufferPass(GbufferPass&&) noexcept;
         GbufferPass& operator=(GbufferPass&&) noexcept;
 
+        bool isReady() const noexcept { return mPipeline.isReady(); }
+        bool hasFailed() const noexcept { return mPipeline.hasFailed(); }
+
         void render(
-            const GpuContext&  gpuContext,
+            GpuUploadRing&     uploadRing,
             const glm::mat4&   viewProjectionMat,
             WGPUCommandEncoder cmdEncoder,
             WGPUTextureView    depthTextureView,
@@ -134,12 +199,12 @@ private:
     struct DebugPass
     {
     private:
-        GpuBuffer          mVertexBuffer = GpuBuffer{};
-        GpuBuffer          mUniformBuffer = GpuBuffer{};
-        GpuBindGroup       mUniformBindGroup = GpuBindGroup{};
-        GpuBindGroupLayout mGbufferBindGroupLayout = GpuBindGroupLayout{};
-        GpuBindGroup       mGbufferBindGroup = GpuBindGroup{};
-        WGPURenderPipeline mPipeline = nullptr;
+        GpuBuffer           mVertexBuffer = GpuBuffer{};
+        GpuBuffer           mUniformBuffer = GpuBuffer{};
+        GpuBindGroup        mUniformBindGroup = GpuBindGroup{};
+        GpuBindGroupLayout  mGbufferBindGroupLayout = GpuBindGroupLayout{};
+        GpuBindGroup        mGbufferBindGroup = GpuBindGroup{};
+        AsyncRenderPipeline mPipeline = AsyncRenderPipeline{};
 
     public:
         DebugPass() = default;
@@ -149,7 +214,7 @@ private:
             WGPUTextureView   normalTextureView,
             WGPUTextureView   depthTextureView,
             const Extent2u&   framebufferSize);
-        ~DebugPass();
+        ~DebugPass() = default;
 
         DebugPass(const DebugPass&) = delete;
         DebugPass& operator=(const DebugPass&) = delete;
@@ -157,12 +222,15 @@ private:
         DebugPass(DebugPass&&) noexcept;
         DebugPass& operator=(DebugPass&&) noexcept;
 
+        bool isReady() const noexcept { return mPipeline.isReady(); }
+        bool hasFailed() const noexcept { return mPipeline.hasFailed(); }
+
         void render(
-            const GpuContext&  gpuContext,
+            GpuUploadRing&     uploadRing,
             WGPUCommandEncoder encoder,
             WGPUTextureView    textureView,
             const Extent2f&    framebufferSize,
-            Gui&               gui);
+            Gui*               gui);
         void resize(
             const GpuContext&,
             WGPUTextureView albedoTextureView,
@@ -173,21 +241,52 @@ private:
     struct LightingPass
     {
     private:
-        Sky                 mCurrentSky = Sky{};
-        GpuBuffer           mSkyStateBuffer = GpuBuffer{};
-        GpuBuffer           mUniformBuffer = GpuBuffer{};
-        GpuBindGroup        mUniformBindGroup = GpuBindGroup{};
-        GpuBindGroupLayout  mGbufferBindGroupLayout = GpuBindGroupLayout{};
-        GpuBindGroup        mGbufferBindGroup = GpuBindGroup{};
-        GpuBuffer           mBvhNodeBuffer = GpuBuffer{};
-        GpuBuffer           mPositionAttributesBuffer = GpuBuffer{};
-        GpuBuffer           mVertexAttributesBuffer = GpuBuffer{};
-        GpuBuffer           mTextureDescriptorBuffer = GpuBuffer{};
-        GpuBuffer           mTextureBuffer = GpuBuffer{};
-        GpuBuffer           mBlueNoiseBuffer = GpuBuffer{};
-        GpuBindGroup        mBvhBindGroup = GpuBindGroup{};
-        GpuBindGroup        mSampleBindGroup = GpuBindGroup{};
-        WGPUComputePipeline mPipeline = nullptr;
+        // The tile requests aggregated from the feedback readback. Shared with the map callback,
+        // which may complete after the pass has been moved or destroyed.
+        struct VirtualTileFeedback
+        {
+            std::vector<std::uint32_t> requests;
+            bool                       isOrphaned = false;
+        };
+
+        struct VirtualTileFeedbackMapRequest
+        {
+            std::shared_ptr<VirtualTileFeedback> feedback;
+            WGPUBuffer                           readbackBuffer;
+            std::size_t                          byteSize;
+            std::uint32_t                        virtualTileCount;
+        };
+
+        std::shared_ptr<SkyStateCache>            mSkyStateCache = nullptr;
+        GpuTrackedBuffer                          mSkyStateBuffer = GpuTrackedBuffer{};
+        GpuBuffer                                 mUniformBuffer = GpuBuffer{};
+        GpuBindGroup                              mUniformBindGroup = GpuBindGroup{};
+        GpuBindGroupLayout                        mGbufferBindGroupLayout = GpuBindGroupLayout{};
+        GpuBindGroup                              mGbufferBindGroup = GpuBindGroup{};
+        GpuBuffer                                 mBvhNodeBuffer = GpuBuffer{};
+        GpuBuffer                                 mPositionAttributesBuffer = GpuBuffer{};
+        GpuBuffer                                 mVertexAttributesBuffer = GpuBuffer{};
+        GpuBuffer                                 mTextureDescriptorBuffer = GpuBuffer{};
+        std::array<GpuBuffer, TEXTURE_PAGE_COUNT> mTexturePageBuffers = {};
+        GpuBuffer                                 mBlueNoiseBuffer = GpuBuffer{};
+        GpuBindGroup                              mBvhBindGroup = GpuBindGroup{};
+        GpuBindGroup                              mSampleBindGroup = GpuBindGroup{};
+        AsyncComputePipeline                      mPipeline = AsyncComputePipeline{};
+        // Fills in the pixels which were not traced at reduced lighting resolutions.
+        AsyncComputePipeline                      mReconstructPipeline = AsyncComputePipeline{};
+
+        // Virtual texturing, only used when the pass was created with physical tiles. Otherwise
+        // the buffers are placeholders.
+        VirtualTextureTable                  mVirtualTextureTable = VirtualTextureTable{};
+        VirtualTileCache                     mVirtualTileCache = VirtualTileCache{};
+        std::vector<Texture>                 mVirtualTextureSources = {};
+        std::shared_ptr<VirtualTileFeedback> mVirtualTileFeedback = nullptr;
+        std::vector<Texture::BgraPixel>      mVirtualTileTexels = {};
+        GpuBuffer                            mVirtualTileFeedbackBuffer = GpuBuffer{};
+        GpuBuffer                            mVirtualTileFeedbackReadbackBuffer = GpuBuffer{};
+        GpuBuffer                            mVirtualTileIndirectionBuffer = GpuBuffer{};
+        GpuBuffer                            mVirtualTilePoolBuffer = GpuBuffer{};
+        bool                                 mVirtualTileFeedbackCopied = false;
 
         struct Uniforms
         {
@@ -195,9 +294,13 @@ private:
             glm::vec4     cameraPosition;
             glm::vec2     framebufferSize;
             std::uint32_t frameCount;
-            std::uint32_t _padding;
+            std::uint32_t lightingResolution;
         };
 
+        bool virtualTexturingEnabled() const { return mVirtualTileCache.physicalTileCount() > 0; }
+        void releaseVirtualTileFeedback() noexcept;
+        void streamVirtualTiles(GpuUploadRing&, WGPUCommandEncoder);
+
     public:
         LightingPass() = default;
         LightingPass(
@@ -209,7 +312,11 @@ private:
             std::span<const BvhNode>           bvhNodes,
             std::span<const PositionAttribute> positionAttributes,
             std::span<const VertexAttributes>  vertexAttributes,
-            std::span<const Texture>           baseColorTextures);
+            std::span<const Texture>           baseColorTextures,
+            TextureLayout                      textureLayout,
+            std::uint32_t                      virtualTexturePhysicalTileCount,
+            std::shared_ptr<SkyStateCache>     skyStateCache,
+            std::uint32_t                      numBounces);
         ~LightingPass();
 
         LightingPass(const LightingPass&) = delete;
@@ -218,13 +325,95 @@ private:
         LightingPass(LightingPass&&) noexcept;
         LightingPass& operator=(LightingPass&&) noexcept;
 
+        bool isReady() const noexcept
+        {
+            return mPipeline.isReady() && mReconstructPipeline.isReady();
+        }
+        bool hasFailed() const noexcept
+        {
+            return mPipeline.hasFailed() || mReconstructPipeline.hasFailed();
+        }
+
         void render(
-            const GpuContext&  gpuContext,
+            GpuUploadRing&     uploadRing,
             WGPUCommandEncoder cmdEncoder,
             const glm::mat4&   inverseViewProjection,
             const glm::vec3&   cameraPosition,
             const Extent2f&    framebufferSize,
             const Sky&         sky,
+            std::uint32_t      frameCount,
+            LightingResolution lightingResolution);
+        // Maps the virtual tile feedback recorded by `render`. Must be called after the command
+        // buffer containing the pass has been submitted.
+        void readbackVirtualTileFeedback();
+        void resize(
+            const GpuContext&,
+            WGPUTextureView albedoTextureView,
+            WGPUTextureView normalTextureView,
+            WGPUTextureView depthTextureView);
+    };
+
+    // Filters the lighting pass samples in place with spatiotemporal variance-guided filtering
+    // (SVGF). The illumination is demodulated by the albedo and accumulated over time together with
+    // the moments of its luminance. The variance estimated from the moments guides a series of
+    // edge-aware à-trous wavelet iterations, whose taps spread further apart every iteration.
+    struct DenoisePass
+    {
+    private:
+        static constexpr std::size_t ATROUS_ITERATION_COUNT = 5;
+
+        GpuBuffer                   mUniformBuffer = GpuBuffer{};
+        GpuBindGroup                mUniformBindGroup = GpuBindGroup{};
+        // The history is double-buffered, like the resolve pass history.
+        std::array<GpuBuffer, 2>    mIlluminationHistoryBuffers = {};
+        std::array<GpuBuffer, 2>    mMomentsHistoryBuffers = {};
+        std::array<GpuBindGroup, 2> mHistoryBindGroups = {};
+        // The à-trous iterations alternate between reading and writing the filter buffers.
+        std::array<GpuBuffer, 2>    mFilterBuffers = {};
+        std::array<GpuBindGroup, 2> mFilterBindGroups = {};
+        GpuBindGroupLayout          mGbufferBindGroupLayout = GpuBindGroupLayout{};
+        GpuBindGroup                mGbufferBindGroup = GpuBindGroup{};
+        AsyncComputePipeline        mTemporalAccumulationPipeline = AsyncComputePipeline{};
+        AsyncComputePipeline        mVarianceEstimationPipeline = AsyncComputePipeline{};
+
+        // Each iteration's pipeline is specialized for its step size.
+        std::array<AsyncComputePipeline, ATROUS_ITERATION_COUNT> mAtrousPipelines = {};
+
+        struct Uniforms
+        {
+            glm::mat4     inverseViewReverseZProjectionMat;
+            glm::mat4     previousViewReverseZProjectionMat;
+            glm::vec2     framebufferSize;
+            std::uint32_t frameCount;
+            std::uint32_t _padding;
+        };
+
+    public:
+        DenoisePass() = default;
+        DenoisePass(
+            const GpuContext&                 gpuContext,
+            WGPUTextureView                   albedoTextureView,
+            WGPUTextureView                   normalTextureView,
+            WGPUTextureView                   depthTextureView,
+            const GpuBuffer&                  sampleBuffer,
+            const DeferredRendererDescriptor& desc);
+        ~DenoisePass() = default;
+
+        DenoisePass(const DenoisePass&) = delete;
+        DenoisePass& operator=(const DenoisePass&) = delete;
+
+        DenoisePass(DenoisePass&&) noexcept;
+        DenoisePass& operator=(DenoisePass&&) noexcept;
+
+        bool isReady() const noexcept;
+        bool hasFailed() const noexcept;
+
+        void render(
+            GpuUploadRing&     uploadRing,
+            WGPUCommandEncoder cmdEncoder,
+            const glm::mat4&   inverseViewProjectionMat,
+            const glm::mat4&   previousViewProjectionMat,
+            const Extent2f&    framebufferSize,
             std::uint32_t      frameCount);
         void resize(
             const GpuContext&,
@@ -236,15 +425,22 @@ private:
     struct ResolvePass
     {
     private:
-        GpuBuffer          mVertexBuffer = GpuBuffer{};
-        GpuBuffer          mUniformBuffer = GpuBuffer{};
-        GpuBindGroup       mUniformBindGroup = GpuBindGroup{};
-        GpuBuffer          mAccumulationBuffer = GpuBuffer{};
-        GpuBindGroup       mTaaBindGroup = GpuBindGroup{};
-        WGPURenderPipeline mPipeline = nullptr;
+        GpuBuffer                   mVertexBuffer = GpuBuffer{};
+        GpuBuffer                   mUniformBuffer = GpuBuffer{};
+        GpuBindGroup                mUniformBindGroup = GpuBindGroup{};
+        // The history is double-buffered, since each frame resamples the previous frame's history
+        // at reprojected positions while writing its own.
+        std::array<GpuBuffer, 2>    mColorHistoryBuffers = {};
+        std::array<GpuBuffer, 2>    mGeometryHistoryBuffers = {};
+        std::array<GpuBindGroup, 2> mTaaBindGroups = {};
+        GpuBindGroupLayout          mGbufferBindGroupLayout = GpuBindGroupLayout{};
+        GpuBindGroup                mGbufferBindGroup = GpuBindGroup{};
+        AsyncRenderPipeline         mPipeline = AsyncRenderPipeline{};
 
         struct Uniforms
         {
+            glm::mat4     inverseViewReverseZProjectionMat;
+            glm::mat4     previousViewReverseZProjectionMat;
             glm::vec2     framebufferSize;
             float         exposure;
             std::uint32_t frameCount;
@@ -254,9 +450,11 @@ private:
         ResolvePass() = default;
         ResolvePass(
             const GpuContext&                 gpuContext,
+            WGPUTextureView                   normalTextureView,
+            WGPUTextureView                   depthTextureView,
             const GpuBuffer&                  sampleBuffer,
             const DeferredRendererDescriptor& desc);
-        ~ResolvePass();
+        ~ResolvePass() = default;
 
         ResolvePass(const ResolvePass&) = delete;
         ResolvePass& operator=(const ResolvePass&) = delete;
@@ -264,17 +462,32 @@ private:
         ResolvePass(ResolvePass&&) noexcept;
         ResolvePass& operator=(ResolvePass&&) noexcept;
 
+        bool isReady() const noexcept { return mPipeline.isReady(); }
+        bool hasFailed() const noexcept { return mPipeline.hasFailed(); }
+
+        // Reprojects the history with the view-projection matrix of the previous frame, and blends
+        // the current samples into it.
         void render(
-            const GpuContext&  gpuContext,
+            GpuUploadRing&     uploadRing,
             WGPUCommandEncoder cmdEncoder,
             WGPUTextureView    targetTextureView,
+            const glm::mat4&   inverseViewProjectionMat,
+            const glm::mat4&   previousViewProjectionMat,
             const Extent2f&    framebufferSize,
             float              exposure,
             std::uint32_t      frameCount,
-            Gui&               gui);
+            Gui*               gui);
+        void resize(
+            const GpuContext&,
+            WGPUTextureView normalTextureView,
+            WGPUTextureView depthTextureView);
+        // Copies back the resolved color history written by the frame `frameCount`.
+        std::vector<glm::vec3> readColorHistory(
+            const GpuContext&, const Extent2u& framebufferSize, std::uint32_t frameCount) const;
     };
 
     void invalidateTemporalAccumulation();
+    void recordTimestamps();
 
     WGPUTexture               mDepthTexture;
     WGPUTextureView           mDepthTextureView;
@@ -283,16 +496,25 @@ private:
     WGPUTexture               mNormalTexture;
     WGPUTextureView           mNormalTextureView;
     GpuBuffer                 mSampleBuffer;
-    WGPUQuerySet              mQuerySet;
-    GpuBuffer                 mQueryBuffer;
-    GpuBuffer                 mTimestampsBuffer;
+    GpuTimestampRing          mTimestamps;
+    GpuUploadRing             mUploadRing;
     GbufferPass               mGbufferPass;
     DebugPass                 mDebugPass;
     LightingPass              mLightingPass;
+    DenoisePass               mDenoisePass;
     ResolvePass               mResolvePass;
-    std::deque<std::uint64_t> mGbufferPassDurationsNs;
-    std::deque<std::uint64_t> mLightingPassDurationsNs;
-    std::deque<std::uint64_t> mResolvePassDurationsNs;
+    DurationHistogram         mGbufferPassDurations;
+    DurationHistogram         mLightingPassDurations;
+    DurationHistogram         mDenoisePassDurations;
+    DurationHistogram         mResolvePassDurations;
+    DurationHistogram         mRenderCpuDurations;
     std::uint32_t             mFrameCount;
+    // The jittered view-projection matrix of the previous frame, for reprojecting the history.
+    glm::mat4                 mPreviousViewProjectionMat;
+    GpuMemoryAllocation       mGbufferAllocation;
+
+    // Chooses the lighting resolution when the renderer has a frame time budget.
+    DynamicResolutionController mDynamicResolution;
+    LightingResolution          mLightingResolution;
 };
 } // namespace nlrs
@@ -0,0 +1,327 @@
+#include "reprojection.wgsl"
+
+// Spatiotemporal variance-guided filtering (SVGF) of the lighting pass samples. The kernels are
+// dispatched in order: `temporalAccumulation`, `estimateVariance`, and one `atrous` iteration per
+// step size. The last iteration writes the filtered samples back to the sample buffer.
+
+struct Uniforms {
+    inverseViewReverseZProjectionMat: mat4x4f,
+    previousViewReverseZProjectionMat: mat4x4f,
+    framebufferSize: vec2f,
+    frameCount: u32,
+    _padding: u32,
+}
+
+struct MomentsHistory {
+    // The first and second moments of the illumination's luminance.
+    moments: vec2f,
+    depth: f32,
+    // The octahedral-encoded normal.
+    normal: u32,
+}
+
+// The illumination is blended with its history by the inverse of the history length, until the
+// blend factor reaches this minimum. The short history keeps the filtered illumination responsive
+// to lighting changes, since the resolve pass accumulates the denoised samples further.
+const MIN_BLEND_FACTOR = 0.2f;
+const MAX_HISTORY_LENGTH = 32f;
+// The variance is estimated spatially until the moments have been accumulated for this many
+// frames.
+const MIN_MOMENTS_HISTORY_LENGTH = 4f;
+// Edge-stopping function parameters. The depth weight halves at a relative depth difference of
+// this fraction per pixel of distance, and the luminance weight is scaled by the standard
+// deviation of the luminance.
+const RELATIVE_DEPTH_SIGMA = 0.05f;
+const NORMAL_EXPONENT = 128f;
+const LUMINANCE_SIGMA = 4f;
+// Albedo is clamped when demodulating, so that black surfaces don't divide by zero.
+const MIN_ALBEDO = 0.001f;
+
+// The distance between the taps of the à-trous iteration, which doubles every iteration.
+override STEP_SIZE: u32 = 1u;
+override IS_LAST_ITERATION: bool = false;
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+
+// The history buffers are swapped every frame. The illumination history contains the demodulated
+// illumination and the history length in frames.
+@group(1) @binding(0) var<storage, read_write> sampleBuffer: array<array<f32, 3>>;
+@group(1) @binding(1) var<storage, read_write> previousIlluminationHistory: array<vec4f>;
+@group(1) @binding(2) var<storage, read_write> previousMomentsHistory: array<MomentsHistory>;
+@group(1) @binding(3) var<storage, read_write> illuminationHistory: array<vec4f>;
+@group(1) @binding(4) var<storage, read_write> momentsHistory: array<MomentsHistory>;
+
+// The filter buffers contain the illumination and its variance. The à-trous iterations swap them.
+@group(2) @binding(0) var<storage, read_write> filterInput: array<vec4f>;
+@group(2) @binding(1) var<storage, read_write> filterOutput: array<vec4f>;
+
+@group(3) @binding(0) var gbufferAlbedo: texture_2d<f32>;
+@group(3) @binding(1) var gbufferNormal: texture_2d<f32>;
+@group(3) @binding(2) var gbufferDepth: texture_depth_2d;
+
+@compute @workgroup_size(8, 8)
+fn temporalAccumulation(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let pos = globalInvocationId.xy;
+    if any(pos >= vec2u(uniforms.framebufferSize)) {
+        return;
+    }
+
+    let idx = pixelIdx(vec2i(pos));
+    let sample: array<f32, 3> = sampleBuffer[idx];
+    let color = vec3f(sample[0], sample[1], sample[2]);
+    let depth = textureLoad(gbufferDepth, pos, 0);
+    let normal = loadNormal(vec2i(pos), depth);
+
+    // The sky is not filtered, and is passed through as is.
+    var illumination = color;
+    if depth > 0f {
+        illumination = color / max(textureLoad(gbufferAlbedo, pos, 0).rgb, vec3f(MIN_ALBEDO));
+    }
+    let sampleLuminance = luminance(illumination);
+
+    // The history is ignored in the first frame of the accumulation sequence.
+    var history = vec4f(0f);
+    var historyMoments = vec2f(0f);
+    if uniforms.frameCount > 0u && depth > 0f {
+        let uv = (vec2f(pos) + vec2f(0.5f)) / uniforms.framebufferSize;
+        let previous = reprojectToPreviousFrame(
+            uv,
+            depth,
+            uniforms.inverseViewReverseZProjectionMat,
+            uniforms.previousViewReverseZProjectionMat
+        );
+        if previous.w > 0f {
+            let samplePos = previous.xy * uniforms.framebufferSize - vec2f(0.5f);
+            let basePos = floor(samplePos);
+            let f = samplePos - basePos;
+
+            var weightSum = 0f;
+            for (var i = 0u; i < 4u; i++) {
+                let offset = vec2f(f32(i & 1u), f32(i >> 1u));
+                let tapPos = vec2i(basePos + offset);
+                if !isInside(tapPos) {
+                    continue;
+                }
+                let tapIdx = pixelIdx(tapPos);
+                let tapMoments = previousMomentsHistory[tapIdx];
+                let tapNormal = octDecode(unpack2x16snorm(tapMoments.normal));
+                if !isSameSurface(depth, previous.z, normal, tapMoments.depth, tapNormal) {
+                    continue;
+                }
+                let weight = mix(1f - f.x, f.x, offset.x) * mix(1f - f.y, f.y, offset.y);
+                history += weight * previousIlluminationHistory[tapIdx];
+                historyMoments += weight * tapMoments.moments;
+                weightSum += weight;
+            }
+
+            // The history length is scaled down by the weight of the rejected taps.
+            if weightSum >= 0.01f {
+                history = vec4f(history.rgb / weightSum, history.w);
+                historyMoments /= weightSum;
+            } else {
+                history = vec4f(0f);
+                historyMoments = vec2f(0f);
+            }
+        }
+    }
+
+    let historyLength = min(history.w + 1f, MAX_HISTORY_LENGTH);
+    let blendFactor = max(1f / historyLength, MIN_BLEND_FACTOR);
+    let moments = vec2f(sampleLuminance, sampleLuminance * sampleLuminance);
+
+    illuminationHistory[idx] = vec4f(mix(history.rgb, illumination, blendFactor), historyLength);
+    momentsHistory[idx] = MomentsHistory(
+        mix(historyMoments, moments, blendFactor),
+        depth,
+        pack2x16snorm(octEncode(normal))
+    );
+}
+
+@compute @workgroup_size(8, 8)
+fn estimateVariance(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let pos = vec2i(globalInvocationId.xy);
+    if !isInside(pos) {
+        return;
+    }
+
+    let idx = pixelIdx(pos);
+    let illumination = illuminationHistory[idx];
+    let center = momentsHistory[idx];
+    if center.depth == 0f || illumination.w >= MIN_MOMENTS_HISTORY_LENGTH {
+        let variance = max(center.moments.y - center.moments.x * center.moments.x, 0f);
+        filterOutput[idx] = vec4f(illumination.rgb, variance);
+        return;
+    }
+
+    // Too few moments have been accumulated to estimate the variance temporally, e.g. where
+    // surfaces were disoccluded. The moments are estimated from the surrounding 7x7 pixels instead.
+    let normal = octDecode(unpack2x16snorm(center.normal));
+    var illuminationSum = vec3f(0f);
+    var momentsSum = vec2f(0f);
+    var weightSum = 0f;
+    for (var y = -3; y <= 3; y++) {
+        for (var x = -3; x <= 3; x++) {
+            let tapPos = pos + vec2i(x, y);
+            if !isInside(tapPos) {
+                continue;
+            }
+            let tapIdx = pixelIdx(tapPos);
+            let tap = momentsHistory[tapIdx];
+            let weight = geometryWeight(
+                center.depth,
+                normal,
+                tap.depth,
+                octDecode(unpack2x16snorm(tap.normal)),
+                length(vec2f(f32(x), f32(y)))
+            );
+            illuminationSum += weight * illuminationHistory[tapIdx].rgb;
+            momentsSum += weight * tap.moments;
+            weightSum += weight;
+        }
+    }
+
+    // The center pixel's weight is one, so the weight sum is never zero. The variance is boosted
+    // while the history is short, so that the à-trous iterations filter more aggressively.
+    let moments = momentsSum / weightSum;
+    let variance = max(moments.y - moments.x * moments.x, 0f) *
+        (MIN_MOMENTS_HISTORY_LENGTH / illumination.w);
+    filterOutput[idx] = vec4f(illuminationSum / weightSum, variance);
+}
+
+@compute @workgroup_size(8, 8)
+fn atrous(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let pos = vec2i(globalInvocationId.xy);
+    if !isInside(pos) {
+        return;
+    }
+
+    let idx = pixelIdx(pos);
+    let center = filterInput[idx];
+    let depth = textureLoad(gbufferDepth, pos, 0);
+    if depth == 0f {
+        // The sky's sample is left untouched.
+        filterOutput[idx] = center;
+        return;
+    }
+
+    let normal = loadNormal(pos, depth);
+    let centerLuminance = luminance(center.rgb);
+    let luminanceDenominator = LUMINANCE_SIGMA * sqrt(prefilteredVariance(pos)) + 1e-6f;
+
+    var illuminationSum = vec3f(0f);
+    var varianceSum = 0f;
+    var weightSum = 0f;
+    for (var y = -2; y <= 2; y++) {
+        for (var x = -2; x <= 2; x++) {
+            let offset = vec2i(x, y) * i32(STEP_SIZE);
+            let tapPos = pos + offset;
+            if !isInside(tapPos) {
+                continue;
+            }
+            let tap = filterInput[pixelIdx(tapPos)];
+            let tapDepth = textureLoad(gbufferDepth, tapPos, 0);
+            let tapNormal = loadNormal(tapPos, tapDepth);
+            let weight = b3SplineWeight(x) * b3SplineWeight(y) *
+                geometryWeight(depth, normal, tapDepth, tapNormal, length(vec2f(offset))) *
+                exp(-abs(centerLuminance - luminance(tap.rgb)) / luminanceDenominator);
+            illuminationSum += weight * tap.rgb;
+            varianceSum += weight * weight * tap.a;
+            weightSum += weight;
+        }
+    }
+
+    // The center tap's weight is never zero.
+    let filtered = vec4f(illuminationSum / weightSum, varianceSum / (weightSum * weightSum));
+    filterOutput[idx] = filtered;
+
+    // The first iteration's output is fed back to the history, so that the next frame accumulates
+    // filtered illumination.
+    if STEP_SIZE == 1u {
+        illuminationHistory[idx] = vec4f(filtered.rgb, illuminationHistory[idx].w);
+    }
+
+    if IS_LAST_ITERATION {
+        let albedo = max(textureLoad(gbufferAlbedo, pos, 0).rgb, vec3f(MIN_ALBEDO));
+        let color = filtered.rgb * albedo;
+        sampleBuffer[idx] = array<f32, 3>(color.r, color.g, color.b);
+    }
+}
+
+// Blurs the variance with a 3x3 Gaussian kernel, which makes the luminance weights of the à-trous
+// iteration robust to the noise in the variance estimate.
+@must_use
+fn prefilteredVariance(pos: vec2i) -> f32 {
+    var varianceSum = 0f;
+    var weightSum = 0f;
+    for (var y = -1; y <= 1; y++) {
+        for (var x = -1; x <= 1; x++) {
+            let tapPos = pos + vec2i(x, y);
+            if !isInside(tapPos) {
+                continue;
+            }
+            let weight = select(0.25f, 0.5f, x == 0) * select(0.25f, 0.5f, y == 0);
+            varianceSum += weight * filterInput[pixelIdx(tapPos)].a;
+            weightSum += weight;
+        }
+    }
+    return varianceSum / weightSum;
+}
+
+// The edge-stopping weight of a tap at the given distance in pixels, based on its depth and normal.
+// The sky doesn't contribute to surfaces.
+@must_use
+fn geometryWeight(
+    depth: f32,
+    normal: vec3f,
+    tapDepth: f32,
+    tapNormal: vec3f,
+    distance: f32
+) -> f32 {
+    if tapDepth == 0f {
+        return 0f;
+    }
+    let relativeDepthDifference = abs(depth - tapDepth) / max(depth, tapDepth);
+    let depthWeight = exp2(-relativeDepthDifference / (RELATIVE_DEPTH_SIGMA * distance + 1e-6f));
+    let normalWeight = pow(max(dot(normal, tapNormal), 0f), NORMAL_EXPONENT);
+    return depthWeight * normalWeight;
+}
+
+// The 1D weights of the 5-tap B3 spline kernel.
+@must_use
+fn b3SplineWeight(offset: i32) -> f32 {
+    switch abs(offset) {
+        case 0: {
+            return 3f / 8f;
+        }
+        case 1: {
+            return 1f / 4f;
+        }
+        default: {
+            return 1f / 16f;
+        }
+    }
+}
+
+// A depth of zero is the sky, which has no normal.
+@must_use
+fn loadNormal(pos: vec2i, depth: f32) -> vec3f {
+    if depth == 0f {
+        return vec3f(0f, 0f, 1f);
+    }
+    return normalize(2f * textureLoad(gbufferNormal, pos, 0).xyz - vec3f(1f));
+}
+
+@must_use
+fn luminance(color: vec3f) -> f32 {
+    return dot(color, vec3f(0.2126f, 0.7152f, 0.0722f));
+}
+
+@must_use
+fn isInside(pos: vec2i) -> bool {
+    return all(pos >= vec2i(0)) && all(pos < vec2i(uniforms.framebufferSize));
+}
+
+@must_use
+fn pixelIdx(pos: vec2i) -> u32 {
+    return u32(pos.y) * u32(uniforms.framebufferSize.x) + u32(pos.x);
+}
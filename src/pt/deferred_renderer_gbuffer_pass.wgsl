@@ -35,7 +35,8 @@ struct GbufferOutput {
 
 @fragment
 fn fsMain(in: VertexOutput) -> GbufferOutput {
-    let linearAlbedo = pow(textureSample(texture, textureSampler, in.texCoord).xyz, vec3(2.2f));
+    // sRGB textures use an sRGB texture format, so the sampled albedo is always linear.
+    let linearAlbedo = textureSample(texture, textureSampler, in.texCoord).xyz;
     let encodedNormal = 0.5f * in.normal.xyz + vec3f(0.5f);
     return GbufferOutput(vec4(linearAlbedo, 1f), vec4(encodedNormal, 1f));
 }
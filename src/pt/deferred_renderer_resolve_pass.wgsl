@@ -1,3 +1,5 @@
+#include "reprojection.wgsl"
+
 struct VertexInput {
     @location(0) position: vec2f,
 }
@@ -18,17 +20,30 @@ fn vsMain(in: VertexInput) -> VertexOutput {
 }
 
 struct Uniforms {
+    inverseViewReverseZProjectionMat: mat4x4f,
+    previousViewReverseZProjectionMat: mat4x4f,
     framebufferSize: vec2f,
     exposure: f32,
     frameCount: u32,
 }
 
-// TODO: consider merging these into one bind group
+// The blend factor of the current sample is the inverse of the history length, until the history
+// reaches this length. Bounds the blur accumulated by resampling the history under motion.
+const MAX_HISTORY_LENGTH = 64f;
 
 @group(0) @binding(0) var<uniform> uniforms: Uniforms;
 
+// The history buffers are swapped every frame. The color history contains the accumulated color
+// and the history length in frames, and the geometry history contains the reverse-z depth and the
+// octahedral-encoded normal of the pixel.
 @group(1) @binding(0) var<storage, read_write> sampleBuffer: array<array<f32, 3>>;
-@group(1) @binding(1) var<storage, read_write> accumulationBuffer: array<array<f32, 3>>;
+@group(1) @binding(1) var<storage, read_write> previousColorHistory: array<vec4f>;
+@group(1) @binding(2) var<storage, read_write> previousGeometryHistory: array<vec2u>;
+@group(1) @binding(3) var<storage, read_write> colorHistory: array<vec4f>;
+@group(1) @binding(4) var<storage, read_write> geometryHistory: array<vec2u>;
+
+@group(2) @binding(0) var gbufferNormal: texture_2d<f32>;
+@group(2) @binding(1) var gbufferDepth: texture_depth_2d;
 
 @fragment
 fn fsMain(in: VertexOutput) -> @location(0) vec4f {
@@ -37,22 +52,75 @@ fn fsMain(in: VertexOutput) -> @location(0) vec4f {
     let sampleBufferIdx = textureIdx.y * u32(uniforms.framebufferSize.x) + textureIdx.x;
     let sample: array<f32, 3> = sampleBuffer[sampleBufferIdx];
     let currentColor = vec3f(sample[0], sample[1], sample[2]);
-    var color = vec3f(0f);
-    if uniforms.frameCount == 0u {
-        accumulationBuffer[sampleBufferIdx] = sample;
-        color = currentColor;
-    } else {
-        let previousSample: array<f32, 3> = accumulationBuffer[sampleBufferIdx];
-        let previousColor = vec3f(previousSample[0], previousSample[1], previousSample[2]);
-        color = 0.1 * currentColor + 0.9 * previousColor;
-        accumulationBuffer[sampleBufferIdx] = array<f32, 3>(color.r, color.g, color.b);
+
+    // A depth of zero is the sky, which has no normal.
+    let depth = textureLoad(gbufferDepth, textureIdx, 0);
+    var normal = vec3f(0f, 0f, 1f);
+    if depth > 0f {
+        normal = normalize(2f * textureLoad(gbufferNormal, textureIdx, 0).xyz - vec3f(1f));
+    }
+
+    // The history is ignored in the first frame of the accumulation sequence.
+    var history = vec4f(0f);
+    if uniforms.frameCount > 0u {
+        history = reprojectHistory(uv, depth, normal);
     }
+    let historyLength = min(history.w + 1f, MAX_HISTORY_LENGTH);
+    let color = mix(history.rgb, currentColor, 1f / historyLength);
+
+    colorHistory[sampleBufferIdx] = vec4f(color, historyLength);
+    geometryHistory[sampleBufferIdx] = vec2u(bitcast<u32>(depth), pack2x16snorm(octEncode(normal)));
 
     let rgb = acesFilmic(uniforms.exposure * color);
     let srgb = pow(rgb, vec3(1f / 2.2f));
     return vec4(srgb, 1f);
 }
 
+// Resamples the previous frame's color history where the pixel's surface was in the previous
+// frame. The bilinear taps which belong to a different surface are rejected, and the history
+// length is scaled down by the weight of the rejected taps. Returns zero if all taps are rejected.
+@must_use
+fn reprojectHistory(uv: vec2f, depth: f32, normal: vec3f) -> vec4f {
+    let previous = reprojectToPreviousFrame(
+        uv,
+        depth,
+        uniforms.inverseViewReverseZProjectionMat,
+        uniforms.previousViewReverseZProjectionMat
+    );
+    if previous.w == 0f {
+        return vec4f(0f);
+    }
+
+    let samplePos = previous.xy * uniforms.framebufferSize - vec2f(0.5f);
+    let basePos = floor(samplePos);
+    let f = samplePos - basePos;
+
+    var colorSum = vec4f(0f);
+    var weightSum = 0f;
+    for (var i = 0u; i < 4u; i++) {
+        let offset = vec2f(f32(i & 1u), f32(i >> 1u));
+        let pos = basePos + offset;
+        if any(pos < vec2f(0f)) || any(pos >= uniforms.framebufferSize) {
+            continue;
+        }
+        let idx = u32(pos.y) * u32(uniforms.framebufferSize.x) + u32(pos.x);
+        let geometry = previousGeometryHistory[idx];
+        let historyDepth = bitcast<f32>(geometry.x);
+        let historyNormal = octDecode(unpack2x16snorm(geometry.y));
+        if !isSameSurface(depth, previous.z, normal, historyDepth, historyNormal) {
+            continue;
+        }
+        let weight = mix(1f - f.x, f.x, offset.x) * mix(1f - f.y, f.y, offset.y);
+        colorSum += weight * previousColorHistory[idx];
+        weightSum += weight;
+    }
+
+    if weightSum < 0.01f {
+        return vec4f(0f);
+    }
+    return vec4f(colorSum.rgb / weightSum, colorSum.w);
+}
+
 @must_use
 fn acesFilmic(x: vec3f) -> vec3f {
     let a = 2.51f;
@@ -36,6 +36,8 @@ public:
     inline Angle&           vfov() { return mVfov; }
     inline float&           aperture() { return mAperture; }
     inline float&           focusDistance() { return mFocusDistance; }
+    // Updated from the window by `update`. Set it directly when there is no window.
+    inline Extent2i&        windowSize() { return mWindowSize; }
     inline const glm::vec3& position() const { return mPosition; }
     inline Angle            yaw() const { return mYaw; }
     inline Angle            pitch() const { return mPitch; }
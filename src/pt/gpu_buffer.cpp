@@ -4,15 +4,6 @@ namespace nlrs
 {
 namespace
 {
-void bufferSafeRelease(WGPUBuffer buffer)
-{
-    if (buffer)
-    {
-        wgpuBufferDestroy(buffer);
-        wgpuBufferRelease(buffer);
-    }
-}
-
 inline WGPUBufferBindingType gpuBufferUsageToWGPUBufferBindingType(const GpuBufferUsages usages)
 {
     if (usages.has(GpuBufferUsage::Storage))
@@ -41,6 +32,7 @@ GpuBuffer::GpuBuffer(GpuBuffer&& other) noexcept
         mBuffer = other.mBuffer;
         mByteSize = other.mByteSize;
         mUsage = other.mUsage;
+        mAllocation = std::move(other.mAllocation);
 
         other.mBuffer = nullptr;
         other.mByteSize = 0;
@@ -57,6 +49,7 @@ GpuBuffer& GpuBuffer::operator=(GpuBuffer&& other) noexcept
         mBuffer = other.mBuffer;
         mByteSize = other.mByteSize;
         mUsage = other.mUsage;
+        mAllocation = std::move(other.mAllocation);
 
         other.mBuffer = nullptr;
         other.mByteSize = 0;
@@ -66,13 +59,15 @@ GpuBuffer& GpuBuffer::operator=(GpuBuffer&& other) noexcept
 }
 
 GpuBuffer::GpuBuffer(
-    const WGPUDevice      device,
-    const char* const     label,
-    const GpuBufferUsages usages,
-    const std::size_t     byteSize)
+    const WGPUDevice        device,
+    const char* const       label,
+    const GpuBufferUsages   usages,
+    const std::size_t       byteSize,
+    const GpuMemoryCategory category)
     : mBuffer(nullptr),
       mByteSize(byteSize),
-      mUsage(usages)
+      mUsage(usages),
+      mAllocation(label, category, byteSize)
 {
     NLRS_ASSERT(device != nullptr);
     NLRS_ASSERT(mByteSize % 16 == 0 || !mUsage.has(GpuBufferUsage::Uniform));
@@ -4,6 +4,7 @@
 
 #include <common/assert.hpp>
 #include <common/bit_flags.hpp>
+#include <common/gpu_memory.hpp>
 
 #include <fmt/core.h>
 #include <webgpu/webgpu.h>
@@ -46,10 +47,22 @@ public:
     GpuBuffer(GpuBuffer&&) noexcept;
     GpuBuffer& operator=(GpuBuffer&&) noexcept;
 
-    GpuBuffer(WGPUDevice device, const char* label, GpuBufferUsages usage, std::size_t byteSize);
+    // The buffer's memory is recorded in the global GpuMemoryTracker under `category`. Throws if the
+    // buffer would exceed the tracker's budget.
+    GpuBuffer(
+        WGPUDevice        device,
+        const char*       label,
+        GpuBufferUsages   usage,
+        std::size_t       byteSize,
+        GpuMemoryCategory category = GpuMemoryCategory::Other);
 
     template<typename T>
-    GpuBuffer(WGPUDevice device, const char* label, GpuBufferUsages usage, std::span<const T> data);
+    GpuBuffer(
+        WGPUDevice         device,
+        const char*        label,
+        GpuBufferUsages    usage,
+        std::span<const T> data,
+        GpuMemoryCategory  category = GpuMemoryCategory::Other);
 
     ~GpuBuffer();
 
@@ -75,9 +88,10 @@ public:
     WGPUBindGroupEntry bindGroupEntry(std::uint32_t bindingIndex) const;
 
 private:
-    WGPUBuffer      mBuffer = nullptr;
-    std::size_t     mByteSize = 0;
-    GpuBufferUsages mUsage = GpuBufferUsages::none();
+    WGPUBuffer          mBuffer = nullptr;
+    std::size_t         mByteSize = 0;
+    GpuBufferUsages     mUsage = GpuBufferUsages::none();
+    GpuMemoryAllocation mAllocation = GpuMemoryAllocation{};
 };
 
 inline WGPUBufferUsageFlags gpuBufferUsageToWGPUBufferUsage(const GpuBufferUsages usages) noexcept
@@ -137,10 +151,12 @@ GpuBuffer::GpuBuffer(
     const WGPUDevice         device,
     const char* const        label,
     const GpuBufferUsages    usages,
-    const std::span<const T> data)
+    const std::span<const T> data,
+    const GpuMemoryCategory  category)
     : mBuffer(nullptr),
       mByteSize(sizeof(T) * data.size()),
-      mUsage(usages)
+      mUsage(usages),
+      mAllocation(label, category, sizeof(T) * data.size())
 {
     NLRS_ASSERT(device != nullptr);
     NLRS_ASSERT(mByteSize % 16 == 0 || !mUsage.has(GpuBufferUsage::Uniform));
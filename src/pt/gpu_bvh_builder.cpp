@@ -0,0 +1,592 @@
+#include "gpu_bvh_builder.hpp"
+#include "gpu_context.hpp"
+#include "gpu_limits.hpp"
+#include "shader_source.hpp"
+#include "webgpu_utils.hpp"
+
+#include <common/assert.hpp>
+#include <common/extent.hpp>
+#include <pt-format/vertex_attributes.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace nlrs
+{
+namespace
+{
+// Match `WORKGROUP_SIZE` in gpu_bvh_builder.wgsl and radix_sort.wgsl.
+constexpr std::uint32_t BVH_BUILDER_WORKGROUP_SIZE = 64;
+constexpr std::uint32_t RADIX_SORT_WORKGROUP_SIZE = 256;
+constexpr std::uint32_t RADIX_DIGIT_COUNT = 256;
+constexpr std::uint32_t RADIX_BITS_PER_PASS = 8;
+
+// The byte sizes of `InteriorNode` and `AtomicAabb` in gpu_bvh_builder.wgsl.
+constexpr std::size_t INTERIOR_NODE_BYTE_SIZE = sizeof(std::uint32_t[5]);
+constexpr std::size_t ATOMIC_AABB_BYTE_SIZE = sizeof(std::uint32_t[6]);
+
+// Matches `BuildParams` in gpu_bvh_builder.wgsl.
+struct BuildParamsLayout
+{
+    std::uint32_t triangleCount;
+    std::uint32_t padding[3];
+};
+
+// Matches `SortParams` in radix_sort.wgsl.
+struct SortParamsLayout
+{
+    std::uint32_t keyCount;
+    std::uint32_t shift;
+    std::uint32_t tileCount;
+    std::uint32_t padding;
+};
+
+struct MapResult
+{
+    WGPUBufferMapAsyncStatus status = WGPUBufferMapAsyncStatus_Unknown;
+    bool                     done = false;
+};
+
+// Matches `invocationIdx` in gpu_bvh_builder.wgsl and the tile index in radix_sort.wgsl. The
+// kernels are dispatched as a 2D grid, so that large meshes stay within the per-dimension
+// workgroup count limit.
+Extent2u dispatchSize(const std::uint32_t invocationCount, const std::uint32_t workgroupSize)
+{
+    const std::uint32_t workgroupCount = (invocationCount + workgroupSize - 1) / workgroupSize;
+    return Extent2u(
+        std::min(workgroupCount, MAX_COMPUTE_WORKGROUPS_PER_DIMENSION),
+        (workgroupCount + MAX_COMPUTE_WORKGROUPS_PER_DIMENSION - 1) /
+            MAX_COMPUTE_WORKGROUPS_PER_DIMENSION);
+}
+
+std::uint32_t tileCount(const std::uint32_t keyCount)
+{
+    return (keyCount + RADIX_SORT_WORKGROUP_SIZE - 1) / RADIX_SORT_WORKGROUP_SIZE;
+}
+
+void dispatch(
+    const WGPUComputePassEncoder computePass,
+    const std::uint32_t          invocationCount,
+    const std::uint32_t          workgroupSize)
+{
+    const Extent2u workgroupCount = dispatchSize(invocationCount, workgroupSize);
+    wgpuComputePassEncoderDispatchWorkgroups(
+        computePass, workgroupCount.x, workgroupCount.y, 1);
+}
+} // namespace
+
+GpuBvhBuilder::GpuBvhBuilder(const GpuContext& gpuContext, const std::uint32_t maxTriangleCount)
+    : mBuildParamsBuffer(
+          gpuContext.device,
+          "bvh builder params buffer",
+          {GpuBufferUsage::Uniform, GpuBufferUsage::CopyDst},
+          sizeof(BuildParamsLayout)),
+      mSortParamsBuffers(),
+      mKeyBuffers(),
+      mValueBuffers(),
+      mDigitCountBuffer(),
+      mInteriorNodeBuffer(),
+      mParentIdBuffer(),
+      mNodeBoundsBuffer(),
+      mFitCounterBuffer(),
+      mSceneBoundsBuffer(
+          gpuContext.device,
+          "bvh builder scene bounds buffer",
+          {GpuBufferUsage::Storage, GpuBufferUsage::CopyDst},
+          ATOMIC_AABB_BYTE_SIZE),
+      mBuildBindGroupLayout(),
+      mSortBindGroups(),
+      mSceneBoundsPipeline(nullptr),
+      mMortonCodesPipeline(nullptr),
+      mCountDigitsPipeline(nullptr),
+      mScanDigitCountsPipeline(nullptr),
+      mScatterPipeline(nullptr),
+      mHierarchyPipeline(nullptr),
+      mFitBoundsPipeline(nullptr),
+      mEmitNodesPipeline(nullptr),
+      mMaxTriangleCount(maxTriangleCount)
+{
+    NLRS_ASSERT(maxTriangleCount > 0);
+
+    const std::uint64_t maxNodeByteSize =
+        static_cast<std::uint64_t>(nodeCount(maxTriangleCount)) * sizeof(BvhNode);
+    if (maxNodeByteSize > REQUIRED_LIMITS.maxStorageBufferBindingSize)
+    {
+        throw std::runtime_error(fmt::format(
+            "The BVH over {} triangles requires {} bytes, which exceeds the storage buffer binding "
+            "size limit of {} bytes.",
+            maxTriangleCount,
+            maxNodeByteSize,
+            REQUIRED_LIMITS.maxStorageBufferBindingSize));
+    }
+
+    {
+        // Buffers
+
+        const std::size_t keyByteSize = sizeof(std::uint32_t) * maxTriangleCount;
+        // A single triangle has no interior nodes, but the runtime-sized arrays can't be empty.
+        const std::size_t interiorNodeCount = std::max(maxTriangleCount - 1, 1u);
+        const std::size_t nodeIdCount = nodeCount(maxTriangleCount);
+
+        for (GpuBuffer& buffer : mSortParamsBuffers)
+        {
+            buffer = GpuBuffer(
+                gpuContext.device,
+                "radix sort params buffer",
+                {GpuBufferUsage::Uniform, GpuBufferUsage::CopyDst},
+                sizeof(SortParamsLayout));
+        }
+        for (std::size_t idx = 0; idx < 2; ++idx)
+        {
+            mKeyBuffers[idx] = GpuBuffer(
+                gpuContext.device,
+                "radix sort key buffer",
+                GpuBufferUsage::Storage,
+                keyByteSize,
+                GpuMemoryCategory::Bvh);
+            mValueBuffers[idx] = GpuBuffer(
+                gpuContext.device,
+                "radix sort value buffer",
+                GpuBufferUsage::Storage,
+                keyByteSize,
+                GpuMemoryCategory::Bvh);
+        }
+        mDigitCountBuffer = GpuBuffer(
+            gpuContext.device,
+            "radix sort digit count buffer",
+            GpuBufferUsage::Storage,
+            sizeof(std::uint32_t) * RADIX_DIGIT_COUNT * tileCount(maxTriangleCount),
+            GpuMemoryCategory::Bvh);
+        mInteriorNodeBuffer = GpuBuffer(
+            gpuContext.device,
+            "bvh builder interior node buffer",
+            GpuBufferUsage::Storage,
+            INTERIOR_NODE_BYTE_SIZE * interiorNodeCount,
+            GpuMemoryCategory::Bvh);
+        mParentIdBuffer = GpuBuffer(
+            gpuContext.device,
+            "bvh builder parent id buffer",
+            GpuBufferUsage::Storage,
+            sizeof(std::uint32_t) * nodeIdCount,
+            GpuMemoryCategory::Bvh);
+        mNodeBoundsBuffer = GpuBuffer(
+            gpuContext.device,
+            "bvh builder node bounds buffer",
+            {GpuBufferUsage::Storage, GpuBufferUsage::CopyDst},
+            ATOMIC_AABB_BYTE_SIZE * nodeIdCount,
+            GpuMemoryCategory::Bvh);
+        mFitCounterBuffer = GpuBuffer(
+            gpuContext.device,
+            "bvh builder fit counter buffer",
+            {GpuBufferUsage::Storage, GpuBufferUsage::CopyDst},
+            sizeof(std::uint32_t) * interiorNodeCount,
+            GpuMemoryCategory::Bvh);
+    }
+
+    // build bind group layout
+
+    {
+        std::array<WGPUBindGroupLayoutEntry, 10> buildBindGroupLayoutEntries{
+            bufferBindGroupLayoutEntry(
+                0, WGPUShaderStage_Compute, WGPUBufferBindingType_Uniform, 0),
+            bufferBindGroupLayoutEntry(
+                1, WGPUShaderStage_Compute, WGPUBufferBindingType_ReadOnlyStorage, 0),
+        };
+        for (std::uint32_t bindingIdx = 2; bindingIdx < buildBindGroupLayoutEntries.size();
+             ++bindingIdx)
+        {
+            buildBindGroupLayoutEntries[bindingIdx] = bufferBindGroupLayoutEntry(
+                bindingIdx, WGPUShaderStage_Compute, WGPUBufferBindingType_Storage, 0);
+        }
+        mBuildBindGroupLayout = GpuBindGroupLayout{
+            gpuContext.device, "Bvh builder bind group layout", buildBindGroupLayoutEntries};
+    }
+
+    // sort bind group layout
+
+    const std::array<WGPUBindGroupLayoutEntry, 6> sortBindGroupLayoutEntries{
+        bufferBindGroupLayoutEntry(0, WGPUShaderStage_Compute, WGPUBufferBindingType_Uniform, 0),
+        bufferBindGroupLayoutEntry(
+            1, WGPUShaderStage_Compute, WGPUBufferBindingType_ReadOnlyStorage, 0),
+        bufferBindGroupLayoutEntry(
+            2, WGPUShaderStage_Compute, WGPUBufferBindingType_ReadOnlyStorage, 0),
+        bufferBindGroupLayoutEntry(3, WGPUShaderStage_Compute, WGPUBufferBindingType_Storage, 0),
+        bufferBindGroupLayoutEntry(4, WGPUShaderStage_Compute, WGPUBufferBindingType_Storage, 0),
+        bufferBindGroupLayoutEntry(5, WGPUShaderStage_Compute, WGPUBufferBindingType_Storage, 0),
+    };
+    const GpuBindGroupLayout sortBindGroupLayout{
+        gpuContext.device, "Radix sort bind group layout", sortBindGroupLayoutEntries};
+
+    // sort bind groups
+
+    // The passes ping-pong between the key and value buffers. There is an even number of passes, so
+    // the sorted keys and values end up back in the first buffers, which the build bind group uses.
+    static_assert(SORT_PASS_COUNT % 2 == 0);
+    static_assert(SORT_PASS_COUNT * RADIX_BITS_PER_PASS == 32);
+    for (std::size_t passIdx = 0; passIdx < SORT_PASS_COUNT; ++passIdx)
+    {
+        const std::size_t                       srcIdx = passIdx % 2;
+        const std::size_t                       dstIdx = (passIdx + 1) % 2;
+        const std::array<WGPUBindGroupEntry, 6> sortBindGroupEntries{
+            mSortParamsBuffers[passIdx].bindGroupEntry(0),
+            mKeyBuffers[srcIdx].bindGroupEntry(1),
+            mValueBuffers[srcIdx].bindGroupEntry(2),
+            mKeyBuffers[dstIdx].bindGroupEntry(3),
+            mValueBuffers[dstIdx].bindGroupEntry(4),
+            mDigitCountBuffer.bindGroupEntry(5),
+        };
+        mSortBindGroups[passIdx] = GpuBindGroup{
+            gpuContext.device,
+            "Radix sort bind group",
+            sortBindGroupLayout.ptr(),
+            sortBindGroupEntries};
+    }
+
+    // pipelines
+
+    {
+        const auto createShaderModule = [&gpuContext](
+                                            const char* const code,
+                                            const char* const label) -> WGPUShaderModule {
+            const WGPUShaderModuleWGSLDescriptor shaderCodeDesc = {
+                .chain =
+                    WGPUChainedStruct{
+                        .next = nullptr,
+                        .sType = WGPUSType_ShaderModuleWGSLDescriptor,
+                    },
+                .code = code,
+            };
+            const WGPUShaderModuleDescriptor shaderDesc{
+                .nextInChain = &shaderCodeDesc.chain,
+                .label = label,
+            };
+            return wgpuDeviceCreateShaderModule(gpuContext.device, &shaderDesc);
+        };
+
+        const WGPUShaderModule buildShaderModule =
+            createShaderModule(GPU_BVH_BUILDER_SOURCE, "Bvh builder shader module");
+        const WGPUShaderModule sortShaderModule =
+            createShaderModule(RADIX_SORT_SOURCE, "Radix sort shader module");
+
+        const auto createPipelineLayout =
+            [&gpuContext](
+                const WGPUBindGroupLayout bindGroupLayout,
+                const char* const         label) -> WGPUPipelineLayout {
+            const WGPUPipelineLayoutDescriptor pipelineLayoutDesc{
+                .nextInChain = nullptr,
+                .label = label,
+                .bindGroupLayoutCount = 1,
+                .bindGroupLayouts = &bindGroupLayout,
+            };
+            return wgpuDeviceCreatePipelineLayout(gpuContext.device, &pipelineLayoutDesc);
+        };
+
+        const WGPUPipelineLayout buildPipelineLayout =
+            createPipelineLayout(mBuildBindGroupLayout.ptr(), "Bvh builder pipeline layout");
+        const WGPUPipelineLayout sortPipelineLayout =
+            createPipelineLayout(sortBindGroupLayout.ptr(), "Radix sort pipeline layout");
+
+        const auto createPipeline = [&gpuContext](
+                                        const WGPUPipelineLayout layout,
+                                        const WGPUShaderModule   module,
+                                        const char* const entryPoint) -> WGPUComputePipeline {
+            const WGPUComputePipelineDescriptor pipelineDesc{
+                .nextInChain = nullptr,
+                .label = entryPoint,
+                .layout = layout,
+                .compute =
+                    WGPUProgrammableStageDescriptor{
+                        .nextInChain = nullptr,
+                        .module = module,
+                        .entryPoint = entryPoint,
+                        .constantCount = 0,
+                        .constants = nullptr,
+                    },
+            };
+            return wgpuDeviceCreateComputePipeline(gpuContext.device, &pipelineDesc);
+        };
+
+        mSceneBoundsPipeline =
+            createPipeline(buildPipelineLayout, buildShaderModule, "computeSceneBounds");
+        mMortonCodesPipeline =
+            createPipeline(buildPipelineLayout, buildShaderModule, "computeMortonCodes");
+        mCountDigitsPipeline = createPipeline(sortPipelineLayout, sortShaderModule, "countDigits");
+        mScanDigitCountsPipeline =
+            createPipeline(sortPipelineLayout, sortShaderModule, "scanDigitCounts");
+        mScatterPipeline = createPipeline(sortPipelineLayout, sortShaderModule, "scatter");
+        mHierarchyPipeline =
+            createPipeline(buildPipelineLayout, buildShaderModule, "emitHierarchy");
+        mFitBoundsPipeline = createPipeline(buildPipelineLayout, buildShaderModule, "fitBounds");
+        mEmitNodesPipeline = createPipeline(buildPipelineLayout, buildShaderModule, "emitNodes");
+
+        wgpuPipelineLayoutRelease(sortPipelineLayout);
+        wgpuPipelineLayoutRelease(buildPipelineLayout);
+        wgpuShaderModuleRelease(sortShaderModule);
+        wgpuShaderModuleRelease(buildShaderModule);
+    }
+}
+
+GpuBvhBuilder::GpuBvhBuilder(GpuBvhBuilder&& other)
+{
+    if (this != &other)
+    {
+        mBuildParamsBuffer = std::move(other.mBuildParamsBuffer);
+        mSortParamsBuffers = std::move(other.mSortParamsBuffers);
+        mKeyBuffers = std::move(other.mKeyBuffers);
+        mValueBuffers = std::move(other.mValueBuffers);
+        mDigitCountBuffer = std::move(other.mDigitCountBuffer);
+        mInteriorNodeBuffer = std::move(other.mInteriorNodeBuffer);
+        mParentIdBuffer = std::move(other.mParentIdBuffer);
+        mNodeBoundsBuffer = std::move(other.mNodeBoundsBuffer);
+        mFitCounterBuffer = std::move(other.mFitCounterBuffer);
+        mSceneBoundsBuffer = std::move(other.mSceneBoundsBuffer);
+        mBuildBindGroupLayout = std::move(other.mBuildBindGroupLayout);
+        mSortBindGroups = std::move(other.mSortBindGroups);
+        mSceneBoundsPipeline = std::exchange(other.mSceneBoundsPipeline, nullptr);
+        mMortonCodesPipeline = std::exchange(other.mMortonCodesPipeline, nullptr);
+        mCountDigitsPipeline = std::exchange(other.mCountDigitsPipeline, nullptr);
+        mScanDigitCountsPipeline = std::exchange(other.mScanDigitCountsPipeline, nullptr);
+        mScatterPipeline = std::exchange(other.mScatterPipeline, nullptr);
+        mHierarchyPipeline = std::exchange(other.mHierarchyPipeline, nullptr);
+        mFitBoundsPipeline = std::exchange(other.mFitBoundsPipeline, nullptr);
+        mEmitNodesPipeline = std::exchange(other.mEmitNodesPipeline, nullptr);
+        mMaxTriangleCount = other.mMaxTriangleCount;
+    }
+}
+
+GpuBvhBuilder& GpuBvhBuilder::operator=(GpuBvhBuilder&& other)
+{
+    if (this != &other)
+    {
+        mBuildParamsBuffer = std::move(other.mBuildParamsBuffer);
+        mSortParamsBuffers = std::move(other.mSortParamsBuffers);
+        mKeyBuffers = std::move(other.mKeyBuffers);
+        mValueBuffers = std::move(other.mValueBuffers);
+        mDigitCountBuffer = std::move(other.mDigitCountBuffer);
+        mInteriorNodeBuffer = std::move(other.mInteriorNodeBuffer);
+        mParentIdBuffer = std::move(other.mParentIdBuffer);
+        mNodeBoundsBuffer = std::move(other.mNodeBoundsBuffer);
+        mFitCounterBuffer = std::move(other.mFitCounterBuffer);
+        mSceneBoundsBuffer = std::move(other.mSceneBoundsBuffer);
+        mBuildBindGroupLayout = std::move(other.mBuildBindGroupLayout);
+        mSortBindGroups = std::move(other.mSortBindGroups);
+        std::swap(mSceneBoundsPipeline, other.mSceneBoundsPipeline);
+        std::swap(mMortonCodesPipeline, other.mMortonCodesPipeline);
+        std::swap(mCountDigitsPipeline, other.mCountDigitsPipeline);
+        std::swap(mScanDigitCountsPipeline, other.mScanDigitCountsPipeline);
+        std::swap(mScatterPipeline, other.mScatterPipeline);
+        std::swap(mHierarchyPipeline, other.mHierarchyPipeline);
+        std::swap(mFitBoundsPipeline, other.mFitBoundsPipeline);
+        std::swap(mEmitNodesPipeline, other.mEmitNodesPipeline);
+        mMaxTriangleCount = other.mMaxTriangleCount;
+    }
+    return *this;
+}
+
+GpuBvhBuilder::~GpuBvhBuilder()
+{
+    for (const WGPUComputePipeline pipeline :
+         {mSceneBoundsPipeline,
+          mMortonCodesPipeline,
+          mCountDigitsPipeline,
+          mScanDigitCountsPipeline,
+          mScatterPipeline,
+          mHierarchyPipeline,
+          mFitBoundsPipeline,
+          mEmitNodesPipeline})
+    {
+        computePipelineSafeRelease(pipeline);
+    }
+}
+
+std::size_t GpuBvhBuilder::nodeCount(const std::uint32_t triangleCount)
+{
+    NLRS_ASSERT(triangleCount > 0);
+    return 2 * static_cast<std::size_t>(triangleCount) - 1;
+}
+
+void GpuBvhBuilder::build(
+    const GpuContext&   gpuContext,
+    const GpuBuffer&    positionAttributes,
+    const std::uint32_t triangleCount,
+    const GpuBuffer&    bvhNodes)
+{
+    NLRS_ASSERT(triangleCount > 0 && triangleCount <= mMaxTriangleCount);
+    NLRS_ASSERT(positionAttributes.byteSize() >= sizeof(PositionAttribute) * triangleCount);
+    NLRS_ASSERT(bvhNodes.byteSize() >= sizeof(BvhNode) * nodeCount(triangleCount));
+
+    {
+        const BuildParamsLayout buildParams{triangleCount, {0, 0, 0}};
+        wgpuQueueWriteBuffer(
+            gpuContext.queue, mBuildParamsBuffer.ptr(), 0, &buildParams, sizeof(BuildParamsLayout));
+    }
+    for (std::uint32_t passIdx = 0; passIdx < SORT_PASS_COUNT; ++passIdx)
+    {
+        const SortParamsLayout sortParams{
+            triangleCount, passIdx * RADIX_BITS_PER_PASS, tileCount(triangleCount), 0};
+        wgpuQueueWriteBuffer(
+            gpuContext.queue,
+            mSortParamsBuffers[passIdx].ptr(),
+            0,
+            &sortParams,
+            sizeof(SortParamsLayout));
+    }
+
+    const std::array<WGPUBindGroupEntry, 10> buildBindGroupEntries{
+        mBuildParamsBuffer.bindGroupEntry(0),
+        positionAttributes.bindGroupEntry(1),
+        mKeyBuffers[0].bindGroupEntry(2),
+        mValueBuffers[0].bindGroupEntry(3),
+        mInteriorNodeBuffer.bindGroupEntry(4),
+        mParentIdBuffer.bindGroupEntry(5),
+        mNodeBoundsBuffer.bindGroupEntry(6),
+        mFitCounterBuffer.bindGroupEntry(7),
+        mSceneBoundsBuffer.bindGroupEntry(8),
+        bvhNodes.bindGroupEntry(9),
+    };
+    const GpuBindGroup buildBindGroup{
+        gpuContext.device,
+        "Bvh builder bind group",
+        mBuildBindGroupLayout.ptr(),
+        buildBindGroupEntries};
+
+    const WGPUCommandEncoder encoder = [&gpuContext]() {
+        const WGPUCommandEncoderDescriptor cmdEncoderDesc{
+            .nextInChain = nullptr,
+            .label = "Bvh builder command encoder",
+        };
+        return wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
+    }();
+
+    // The atomic bounds and counters are zeroed, which is the empty state.
+    wgpuCommandEncoderClearBuffer(encoder, mNodeBoundsBuffer.ptr(), 0, WGPU_WHOLE_SIZE);
+    wgpuCommandEncoderClearBuffer(encoder, mFitCounterBuffer.ptr(), 0, WGPU_WHOLE_SIZE);
+    wgpuCommandEncoderClearBuffer(encoder, mSceneBoundsBuffer.ptr(), 0, WGPU_WHOLE_SIZE);
+
+    {
+        const WGPUComputePassEncoder computePass = [encoder]() -> WGPUComputePassEncoder {
+            const WGPUComputePassDescriptor computePassDesc{
+                .nextInChain = nullptr,
+                .label = "Bvh builder compute pass",
+                .timestampWrites = nullptr,
+            };
+            return wgpuCommandEncoderBeginComputePass(encoder, &computePassDesc);
+        }();
+
+        wgpuComputePassEncoderSetBindGroup(computePass, 0, buildBindGroup.ptr(), 0, nullptr);
+        wgpuComputePassEncoderSetPipeline(computePass, mSceneBoundsPipeline);
+        dispatch(computePass, triangleCount, BVH_BUILDER_WORKGROUP_SIZE);
+        wgpuComputePassEncoderSetPipeline(computePass, mMortonCodesPipeline);
+        dispatch(computePass, triangleCount, BVH_BUILDER_WORKGROUP_SIZE);
+
+        for (std::size_t passIdx = 0; passIdx < SORT_PASS_COUNT; ++passIdx)
+        {
+            wgpuComputePassEncoderSetBindGroup(
+                computePass, 0, mSortBindGroups[passIdx].ptr(), 0, nullptr);
+            wgpuComputePassEncoderSetPipeline(computePass, mCountDigitsPipeline);
+            dispatch(computePass, triangleCount, RADIX_SORT_WORKGROUP_SIZE);
+            wgpuComputePassEncoderSetPipeline(computePass, mScanDigitCountsPipeline);
+            wgpuComputePassEncoderDispatchWorkgroups(computePass, 1, 1, 1);
+            wgpuComputePassEncoderSetPipeline(computePass, mScatterPipeline);
+            dispatch(computePass, triangleCount, RADIX_SORT_WORKGROUP_SIZE);
+        }
+
+        wgpuComputePassEncoderSetBindGroup(computePass, 0, buildBindGroup.ptr(), 0, nullptr);
+        if (triangleCount > 1)
+        {
+            wgpuComputePassEncoderSetPipeline(computePass, mHierarchyPipeline);
+            dispatch(computePass, triangleCount - 1, BVH_BUILDER_WORKGROUP_SIZE);
+        }
+        wgpuComputePassEncoderSetPipeline(computePass, mFitBoundsPipeline);
+        dispatch(computePass, triangleCount, BVH_BUILDER_WORKGROUP_SIZE);
+        wgpuComputePassEncoderSetPipeline(computePass, mEmitNodesPipeline);
+        dispatch(
+            computePass,
+            static_cast<std::uint32_t>(nodeCount(triangleCount)),
+            BVH_BUILDER_WORKGROUP_SIZE);
+
+        wgpuComputePassEncoderEnd(computePass);
+    }
+
+    const WGPUCommandBuffer cmdBuffer = [encoder]() {
+        const WGPUCommandBufferDescriptor cmdBufferDesc{
+            .nextInChain = nullptr,
+            .label = "Bvh builder command buffer",
+        };
+        return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    }();
+    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+}
+
+std::vector<BvhNode> readBvhNodes(
+    const GpuContext& gpuContext,
+    const GpuBuffer&  bvhNodes,
+    const std::size_t nodeCount)
+{
+    NLRS_ASSERT(nodeCount > 0);
+    const std::size_t byteSize = sizeof(BvhNode) * nodeCount;
+    NLRS_ASSERT(bvhNodes.byteSize() >= byteSize);
+
+    const GpuBuffer readbackBuffer(
+        gpuContext.device,
+        "bvh node readback buffer",
+        {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
+        byteSize);
+
+    const WGPUCommandEncoder encoder = [&gpuContext]() {
+        const WGPUCommandEncoderDescriptor cmdEncoderDesc{
+            .nextInChain = nullptr,
+            .label = "Bvh node readback command encoder",
+        };
+        return wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
+    }();
+    wgpuCommandEncoderCopyBufferToBuffer(
+        encoder, bvhNodes.ptr(), 0, readbackBuffer.ptr(), 0, byteSize);
+    const WGPUCommandBuffer cmdBuffer = [encoder]() {
+        const WGPUCommandBufferDescriptor cmdBufferDesc{
+            .nextInChain = nullptr,
+            .label = "Bvh node readback command buffer",
+        };
+        return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    }();
+    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+
+    MapResult mapResult;
+    wgpuBufferMapAsync(
+        readbackBuffer.ptr(),
+        WGPUMapMode_Read,
+        0,
+        byteSize,
+        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+            NLRS_ASSERT(userdata != nullptr);
+            MapResult& result = *static_cast<MapResult*>(userdata);
+            result.status = status;
+            result.done = true;
+        },
+        &mapResult);
+
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
+    while (!mapResult.done)
+    {
+        wgpuDeviceTick(gpuContext.device);
+    }
+
+    if (mapResult.status != WGPUBufferMapAsyncStatus_Success)
+    {
+        throw std::runtime_error("Failed to map bvh node readback buffer.");
+    }
+
+    const void* const mappedData =
+        wgpuBufferGetConstMappedRange(readbackBuffer.ptr(), 0, byteSize);
+    NLRS_ASSERT(mappedData != nullptr);
+    std::vector<BvhNode> nodes(nodeCount);
+    std::memcpy(nodes.data(), mappedData, byteSize);
+    wgpuBufferUnmap(readbackBuffer.ptr());
+
+    return nodes;
+}
+} // namespace nlrs
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "gpu_bind_group.hpp"
+#include "gpu_bind_group_layout.hpp"
+#include "gpu_buffer.hpp"
+
+#include <common/bvh.hpp>
+
+#include <webgpu/webgpu.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nlrs
+{
+struct GpuContext;
+
+// Builds a linear BVH (LBVH) over triangles which are already in GPU memory, using compute
+// kernels: Morton codes of the triangle centroids, a radix sort of the codes, Karras's hierarchy
+// emission, and a bottom-up bounds fit with atomics. The nodes are written in the same
+// depth-first `BvhNode` layout as `buildBvh`, with one triangle per leaf. See `buildLbvh` for the
+// CPU reference.
+//
+// The leaves refer to the triangles in their original order, so the triangle attributes don't need
+// to be reordered.
+//
+// Triangles whose centroids share a Morton code are split by their index, so a tree over many such
+// triangles can be deeper than `BVH_STACK_MAX_DEPTH`. Check the depth of the built tree with
+// `bvhDepth` before traversing it with the stack traversal.
+class GpuBvhBuilder
+{
+public:
+    GpuBvhBuilder(const GpuContext&, std::uint32_t maxTriangleCount);
+
+    GpuBvhBuilder(const GpuBvhBuilder&) = delete;
+    GpuBvhBuilder& operator=(const GpuBvhBuilder&) = delete;
+
+    GpuBvhBuilder(GpuBvhBuilder&&);
+    GpuBvhBuilder& operator=(GpuBvhBuilder&&);
+
+    ~GpuBvhBuilder();
+
+    // The number of nodes of the BVH over `triangleCount` triangles.
+    static std::size_t nodeCount(std::uint32_t triangleCount);
+
+    // Submits the build of the BVH over the first `triangleCount` triangles of
+    // `positionAttributes`, an array of `PositionAttribute`. `bvhNodes` must be a storage buffer
+    // with room for `nodeCount(triangleCount)` nodes. Work submitted afterwards sees the built BVH.
+    void build(
+        const GpuContext& gpuContext,
+        const GpuBuffer&  positionAttributes,
+        std::uint32_t     triangleCount,
+        const GpuBuffer&  bvhNodes);
+
+private:
+    static constexpr std::size_t SORT_PASS_COUNT = 4;
+
+    GpuBuffer                                 mBuildParamsBuffer;
+    std::array<GpuBuffer, SORT_PASS_COUNT>    mSortParamsBuffers;
+    std::array<GpuBuffer, 2>                  mKeyBuffers;
+    std::array<GpuBuffer, 2>                  mValueBuffers;
+    GpuBuffer                                 mDigitCountBuffer;
+    GpuBuffer                                 mInteriorNodeBuffer;
+    GpuBuffer                                 mParentIdBuffer;
+    GpuBuffer                                 mNodeBoundsBuffer;
+    GpuBuffer                                 mFitCounterBuffer;
+    GpuBuffer                                 mSceneBoundsBuffer;
+    GpuBindGroupLayout                        mBuildBindGroupLayout;
+    std::array<GpuBindGroup, SORT_PASS_COUNT> mSortBindGroups;
+    WGPUComputePipeline                       mSceneBoundsPipeline;
+    WGPUComputePipeline                       mMortonCodesPipeline;
+    WGPUComputePipeline                       mCountDigitsPipeline;
+    WGPUComputePipeline                       mScanDigitCountsPipeline;
+    WGPUComputePipeline                       mScatterPipeline;
+    WGPUComputePipeline                       mHierarchyPipeline;
+    WGPUComputePipeline                       mFitBoundsPipeline;
+    WGPUComputePipeline                       mEmitNodesPipeline;
+    std::uint32_t                             mMaxTriangleCount;
+};
+
+// Copies the nodes back from `bvhNodes`, e.g. for validating the GPU builder. The buffer must have
+// the CopySrc usage. Blocks until the copy has completed.
+std::vector<BvhNode> readBvhNodes(
+    const GpuContext& gpuContext,
+    const GpuBuffer&  bvhNodes,
+    std::size_t       nodeCount);
+} // namespace nlrs
@@ -0,0 +1,342 @@
+// build bind group
+@group(0) @binding(0) var<uniform> buildParams: BuildParams;
+@group(0) @binding(1) var<storage, read> positionAttributes: array<Positions>;
+@group(0) @binding(2) var<storage, read_write> mortonCodes: array<u32>;
+@group(0) @binding(3) var<storage, read_write> triangleIndices: array<u32>;
+@group(0) @binding(4) var<storage, read_write> interiorNodes: array<InteriorNode>;
+@group(0) @binding(5) var<storage, read_write> parentIds: array<u32>;
+@group(0) @binding(6) var<storage, read_write> nodeBounds: array<AtomicAabb>;
+@group(0) @binding(7) var<storage, read_write> fitCounters: array<atomic<u32>>;
+@group(0) @binding(8) var<storage, read_write> sceneBounds: AtomicAabb;
+@group(0) @binding(9) var<storage, read_write> bvhNodes: array<BvhNode>;
+
+// The kernels of the LBVH builder, see `buildLbvh` in common/bvh.hpp for the CPU reference. The
+// renderer dispatches them in order, sorting the Morton codes and triangle indices with the kernels
+// in radix_sort.wgsl between `computeMortonCodes` and `emitHierarchy`.
+//
+// Node ids identify interior nodes by the index of the sorted triangle at either end of their
+// range, as in Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d
+// Trees". The ids of the leaves follow the interior nodes, so that the root always has id 0.
+
+// Matches `BVH_BUILDER_WORKGROUP_SIZE` in gpu_bvh_builder.cpp.
+const WORKGROUP_SIZE = 64u;
+const INVALID_NODE_ID = 0xffffffffu;
+const LEAF_SPLIT_AXIS = 0xffffffffu;
+const FLT_MIN = 1.17549435e-38f;
+
+struct BuildParams {
+    triangleCount: u32,
+    pad0: u32,
+    pad1: u32,
+    pad2: u32,
+}
+
+struct Positions {
+    p0: vec3f,
+    p1: vec3f,
+    p2: vec3f,
+}
+
+struct Aabb {
+    min: vec3f,
+    max: vec3f,
+}
+
+struct BvhNode {
+    aabb: Aabb,
+    trianglesOffset: u32,
+    secondChildOffset: u32,
+    triangleCount: u32,
+    splitAxis: u32,
+}
+
+struct InteriorNode {
+    leftChild: u32,
+    rightChild: u32,
+    rangeFirst: u32,
+    split: u32,
+    splitAxis: u32,
+}
+
+// Bounds which are merged with atomicMax, using `orderedBits`. The minimums are stored
+// complemented, so that zeroed bounds are empty.
+struct AtomicAabb {
+    minBits: array<atomic<u32>, 3>,
+    maxBits: array<atomic<u32>, 3>,
+}
+
+var<workgroup> workgroupCentroidBounds: AtomicAabb;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn computeSceneBounds(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    // The centroids are merged in workgroup memory first, which is zero-initialized, to reduce
+    // contention on the scene bounds.
+    let triangleIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if triangleIdx < buildParams.triangleCount {
+        let centroid = triangleCentroid(triangleIdx);
+        for (var axis = 0u; axis < 3u; axis += 1u) {
+            atomicMax(&workgroupCentroidBounds.minBits[axis], ~orderedBits(centroid[axis]));
+            atomicMax(&workgroupCentroidBounds.maxBits[axis], orderedBits(centroid[axis]));
+        }
+    }
+    workgroupBarrier();
+
+    if localIdx < 3u {
+        let axis = localIdx;
+        atomicMax(&sceneBounds.minBits[axis], atomicLoad(&workgroupCentroidBounds.minBits[axis]));
+        atomicMax(&sceneBounds.maxBits[axis], atomicLoad(&workgroupCentroidBounds.maxBits[axis]));
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn computeMortonCodes(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let triangleIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if triangleIdx >= buildParams.triangleCount {
+        return;
+    }
+
+    if triangleIdx == 0u {
+        parentIds[0] = INVALID_NODE_ID;
+    }
+
+    var boundsMin: vec3f;
+    var boundsMax: vec3f;
+    for (var axis = 0u; axis < 3u; axis += 1u) {
+        boundsMin[axis] = fromOrderedBits(~atomicLoad(&sceneBounds.minBits[axis]));
+        boundsMax[axis] = fromOrderedBits(atomicLoad(&sceneBounds.maxBits[axis]));
+    }
+    let extent = max(boundsMax - boundsMin, vec3f(FLT_MIN));
+    let unitCubePoint = (triangleCentroid(triangleIdx) - boundsMin) / extent;
+
+    mortonCodes[triangleIdx] = mortonCode(unitCubePoint);
+    triangleIndices[triangleIdx] = triangleIdx;
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn emitHierarchy(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let nodeId = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if nodeId + 1u >= buildParams.triangleCount {
+        return;
+    }
+
+    let i = i32(nodeId);
+
+    // Determine the direction of the range, and find its other end with an exponential search
+    // followed by a binary search.
+    let d = select(-1, 1, commonPrefixLength(i, i + 1) > commonPrefixLength(i, i - 1));
+    let minPrefixLength = commonPrefixLength(i, i - d);
+    var maxLength = 2;
+    while commonPrefixLength(i, i + maxLength * d) > minPrefixLength {
+        maxLength *= 2;
+    }
+    var rangeLength = 0;
+    for (var stride = maxLength / 2; stride > 0; stride /= 2) {
+        if commonPrefixLength(i, i + (rangeLength + stride) * d) > minPrefixLength {
+            rangeLength += stride;
+        }
+    }
+    let j = i + rangeLength * d;
+
+    // Find the split position, where the highest differing bit of the range flips.
+    let nodePrefixLength = commonPrefixLength(i, j);
+    var splitOffset = 0;
+    var stride = rangeLength;
+    loop {
+        stride = (stride + 1) / 2;
+        if commonPrefixLength(i, i + (splitOffset + stride) * d) > nodePrefixLength {
+            splitOffset += stride;
+        }
+        if stride <= 1 {
+            break;
+        }
+    }
+    let split = u32(i + splitOffset * d + min(d, 0));
+
+    let leafIdOffset = buildParams.triangleCount - 1u;
+    let first = u32(min(i, j));
+    let last = u32(max(i, j));
+    let leftChild = select(split, leafIdOffset + split, first == split);
+    let rightChild = select(split + 1u, leafIdOffset + split + 1u, last == split + 1u);
+
+    // The split bit's position within its 3-bit group determines the axis. Splits between
+    // duplicate codes are arbitrary.
+    var splitAxis = 0u;
+    if nodePrefixLength < 32 {
+        splitAxis = 2u - u32(31 - nodePrefixLength) % 3u;
+    }
+
+    interiorNodes[nodeId] = InteriorNode(leftChild, rightChild, first, split, splitAxis);
+    parentIds[leftChild] = nodeId;
+    parentIds[rightChild] = nodeId;
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn fitBounds(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let leafIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if leafIdx >= buildParams.triangleCount {
+        return;
+    }
+
+    var nodeId = buildParams.triangleCount - 1u + leafIdx;
+    var bounds = triangleAabb(triangleIndices[leafIdx]);
+    mergeNodeBounds(nodeId, bounds);
+
+    // Walk towards the root. The first child to reach a parent terminates, and the second child
+    // continues with the bounds of both children merged into the parent.
+    loop {
+        let parentId = parentIds[nodeId];
+        if parentId == INVALID_NODE_ID {
+            break;
+        }
+        mergeNodeBounds(parentId, bounds);
+        if atomicAdd(&fitCounters[parentId], 1u) == 0u {
+            break;
+        }
+        bounds = loadNodeBounds(parentId);
+        nodeId = parentId;
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn emitNodes(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let nodeId = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    let leafIdOffset = buildParams.triangleCount - 1u;
+    if nodeId >= leafIdOffset + buildParams.triangleCount {
+        return;
+    }
+
+    // The node's depth-first index is found by walking towards the root. A first child directly
+    // follows its parent. A subtree over k leaves contains 2k - 1 nodes, so a second child follows
+    // its parent by twice the leaf count of the first child.
+    var nodeIdx = 0u;
+    var childId = nodeId;
+    loop {
+        let parentId = parentIds[childId];
+        if parentId == INVALID_NODE_ID {
+            break;
+        }
+        let parent = interiorNodes[parentId];
+        if parent.leftChild == childId {
+            nodeIdx += 1u;
+        } else {
+            nodeIdx += firstChildNodeCount(parent) + 1u;
+        }
+        childId = parentId;
+    }
+
+    let bounds = loadNodeBounds(nodeId);
+    if nodeId < leafIdOffset {
+        let node = interiorNodes[nodeId];
+        let secondChildOffset = nodeIdx + firstChildNodeCount(node) + 1u;
+        bvhNodes[nodeIdx] = BvhNode(bounds, 0u, secondChildOffset, 0u, node.splitAxis);
+    } else {
+        let triangleIdx = triangleIndices[nodeId - leafIdOffset];
+        bvhNodes[nodeIdx] = BvhNode(bounds, triangleIdx, 0u, 1u, LEAF_SPLIT_AXIS);
+    }
+}
+
+@must_use
+fn invocationIdx(workgroupId: vec3u, numWorkgroups: vec3u, localIdx: u32) -> u32 {
+    return (workgroupId.y * numWorkgroups.x + workgroupId.x) * WORKGROUP_SIZE + localIdx;
+}
+
+@must_use
+fn firstChildNodeCount(node: InteriorNode) -> u32 {
+    return 2u * (node.split - node.rangeFirst + 1u) - 1u;
+}
+
+// The length of the common prefix of the sorted Morton codes at `i` and `j`, or -1 if `j` is out of
+// range. Duplicate codes are disambiguated by their index.
+@must_use
+fn commonPrefixLength(i: i32, j: i32) -> i32 {
+    if j < 0 || j >= i32(buildParams.triangleCount) {
+        return -1;
+    }
+    let ki = mortonCodes[i];
+    let kj = mortonCodes[j];
+    if ki == kj {
+        return 32 + i32(countLeadingZeros(u32(i ^ j)));
+    }
+    return i32(countLeadingZeros(ki ^ kj));
+}
+
+// The 30-bit Morton code of a point in the unit cube, with the x-axis in the most significant bit
+// of each 3-bit group.
+@must_use
+fn mortonCode(unitCubePoint: vec3f) -> u32 {
+    let quantized = vec3u(clamp(unitCubePoint * 1024f, vec3f(0f), vec3f(1023f)));
+    return (expandBits(quantized.x) << 2u) | (expandBits(quantized.y) << 1u) |
+        expandBits(quantized.z);
+}
+
+// Spreads the lower 10 bits of `v` so that there are two zero bits between each bit.
+@must_use
+fn expandBits(v: u32) -> u32 {
+    var x = (v * 0x00010001u) & 0xff0000ffu;
+    x = (x * 0x00000101u) & 0x0f00f00fu;
+    x = (x * 0x00000011u) & 0xc30c30c3u;
+    x = (x * 0x00000005u) & 0x49249249u;
+    return x;
+}
+
+@must_use
+fn triangleAabb(triangleIdx: u32) -> Aabb {
+    let tri = positionAttributes[triangleIdx];
+    return Aabb(min(min(tri.p0, tri.p1), tri.p2), max(max(tri.p0, tri.p1), tri.p2));
+}
+
+@must_use
+fn triangleCentroid(triangleIdx: u32) -> vec3f {
+    let aabb = triangleAabb(triangleIdx);
+    return 0.5f * (aabb.min + aabb.max);
+}
+
+fn mergeNodeBounds(nodeId: u32, bounds: Aabb) {
+    for (var axis = 0u; axis < 3u; axis += 1u) {
+        atomicMax(&nodeBounds[nodeId].minBits[axis], ~orderedBits(bounds.min[axis]));
+        atomicMax(&nodeBounds[nodeId].maxBits[axis], orderedBits(bounds.max[axis]));
+    }
+}
+
+@must_use
+fn loadNodeBounds(nodeId: u32) -> Aabb {
+    var bounds: Aabb;
+    for (var axis = 0u; axis < 3u; axis += 1u) {
+        bounds.min[axis] = fromOrderedBits(~atomicLoad(&nodeBounds[nodeId].minBits[axis]));
+        bounds.max[axis] = fromOrderedBits(atomicLoad(&nodeBounds[nodeId].maxBits[axis]));
+    }
+    return bounds;
+}
+
+// Maps a float to an unsigned integer of the same order: positive floats get their sign bit set,
+// and negative floats are complemented.
+@must_use
+fn orderedBits(x: f32) -> u32 {
+    let bits = bitcast<u32>(x);
+    return select(bits | 0x80000000u, ~bits, (bits & 0x80000000u) != 0u);
+}
+
+@must_use
+fn fromOrderedBits(ordered: u32) -> f32 {
+    return bitcast<f32>(select(~ordered, ordered & 0x7fffffffu, (ordered & 0x80000000u) != 0u));
+}
@@ -1,4 +1,5 @@
 #include "gpu_context.hpp"
+#include "pipeline_disk_cache.hpp"
 
 #include <GLFW/glfw3.h>
 
@@ -122,11 +123,20 @@ void queueSafeRelease(const WGPUQueue queue)
 }
 } // namespace
 
-GpuContext::GpuContext(const WGPURequiredLimits& requiredLimits)
+GpuContext::GpuContext(
+    const WGPURequiredLimits& requiredLimits,
+    const bool                forceFallbackAdapter,
+    const char* const         pipelineCacheDirectory)
     : instance(nullptr),
       device(nullptr),
-      queue(nullptr)
+      queue(nullptr),
+      pipelineCache(nullptr)
 {
+    if (pipelineCacheDirectory)
+    {
+        pipelineCache = std::make_unique<PipelineDiskCache>(pipelineCacheDirectory);
+    }
+
     instance = []() -> WGPUInstance {
         // GPU timers are an unsafe API and are disabled by default due to exposing client
         // information. E.g. `ValidationTest::SetUp()` in
@@ -156,8 +166,10 @@ GpuContext::GpuContext(const WGPURequiredLimits& requiredLimits)
         throw std::runtime_error("Failed to create WGPUInstance instance.");
     }
 
-    const WGPUAdapter adapter = [this]() -> WGPUAdapter {
-        const WGPURequestAdapterOptions adapterOptions = {};
+    const WGPUAdapter adapter = [this, forceFallbackAdapter]() -> WGPUAdapter {
+        const WGPURequestAdapterOptions adapterOptions = {
+            .forceFallbackAdapter = forceFallbackAdapter,
+        };
         WGPUAdapter                     adapter = nullptr;
 
         auto onAdapterResponse = [](WGPURequestAdapterStatus status,
@@ -186,13 +198,25 @@ GpuContext::GpuContext(const WGPURequiredLimits& requiredLimits)
         throw std::runtime_error("Failed to create WGPUAdapter instance.");
     }
 
-    device = [adapter, &requiredLimits]() -> WGPUDevice {
+    device = [this, adapter, &requiredLimits]() -> WGPUDevice {
         const std::array<WGPUFeatureName, 1> requiredFeatures{
             WGPUFeatureName_TimestampQuery,
         };
 
+        const WGPUDawnCacheDeviceDescriptor cacheDesc{
+            .chain =
+                WGPUChainedStruct{
+                    .next = nullptr,
+                    .sType = WGPUSType_DawnCacheDeviceDescriptor,
+                },
+            .isolationKey = "pt",
+            .loadDataFunction = PipelineDiskCache::loadData,
+            .storeDataFunction = PipelineDiskCache::storeData,
+            .functionUserdata = pipelineCache.get(),
+        };
+
         const WGPUDeviceDescriptor deviceDesc{
-            .nextInChain = nullptr,
+            .nextInChain = pipelineCache ? &cacheDesc.chain : nullptr,
             .label = "Device",
             .requiredFeatureCount = requiredFeatures.size(),
             .requiredFeatures = requiredFeatures.data(),
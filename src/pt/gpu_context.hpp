@@ -4,17 +4,29 @@
 
 #include <webgpu/webgpu.h>
 
+#include <memory>
+
 struct GLFWwindow;
 
 namespace nlrs
 {
+class PipelineDiskCache;
+
 struct GpuContext
 {
     WGPUInstance instance;
     WGPUDevice   device;
     WGPUQueue    queue;
+    // Outlives the device, which calls into it.
+    std::unique_ptr<PipelineDiskCache> pipelineCache;
 
-    GpuContext(const WGPURequiredLimits&);
+    // When `forceFallbackAdapter` is set, a CPU adapter such as SwiftShader is requested, e.g. for
+    // headless rendering on machines without a GPU. When `pipelineCacheDirectory` is set, the
+    // device caches compiled pipelines in it, see `PipelineDiskCache`.
+    GpuContext(
+        const WGPURequiredLimits&,
+        bool        forceFallbackAdapter = false,
+        const char* pipelineCacheDirectory = nullptr);
     ~GpuContext();
 };
 } // namespace nlrs
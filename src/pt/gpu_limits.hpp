@@ -1,7 +1,21 @@
 #pragma once
 
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+
 namespace nlrs
 {
+// Textures are packed into multiple storage buffers, or pages, to stay under the storage buffer
+// binding size limit. Ensure matches the number of `texturePage` bindings in the shaders.
+constexpr std::uint32_t TEXTURE_PAGE_COUNT = 4;
+// Dawn's effective storage buffer binding size limit, see notes/storage_buffer_binding_size.md.
+constexpr std::uint64_t TEXTURE_PAGE_MAX_BYTE_SIZE = 1 << 28;
+
+// `REQUIRED_LIMITS` leaves the compute limits at the WebGPU defaults.
+constexpr std::uint32_t MAX_COMPUTE_INVOCATIONS_PER_WORKGROUP = 256;
+constexpr std::uint32_t MAX_COMPUTE_WORKGROUPS_PER_DIMENSION = 65535;
+
 constexpr WGPULimits REQUIRED_LIMITS{
     .maxTextureDimension1D = 0,
     .maxTextureDimension2D = 0,
@@ -9,12 +23,12 @@ constexpr WGPULimits REQUIRED_LIMITS{
     .maxTextureArrayLayers = 0,
     .maxBindGroups = 4,
     .maxBindGroupsPlusVertexBuffers = 0,
-    .maxBindingsPerBindGroup = 8,
+    .maxBindingsPerBindGroup = 10,
     .maxDynamicUniformBuffersPerPipelineLayout = 0,
     .maxDynamicStorageBuffersPerPipelineLayout = 0,
     .maxSampledTexturesPerShaderStage = 0,
     .maxSamplersPerShaderStage = 0,
-    .maxStorageBuffersPerShaderStage = 8,
+    .maxStorageBuffersPerShaderStage = 14,
     .maxStorageTexturesPerShaderStage = 0,
     .maxUniformBuffersPerShaderStage = 1,
     .maxUniformBufferBindingSize = 1 << 10,
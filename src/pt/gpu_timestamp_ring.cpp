@@ -0,0 +1,183 @@
+#include "gpu_timestamp_ring.hpp"
+#include "webgpu_utils.hpp"
+
+#include <common/assert.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace nlrs
+{
+GpuTimestampRing::GpuTimestampRing(
+    const WGPUDevice    device,
+    const char* const   label,
+    const std::uint32_t queryCount)
+    : mQuerySet(nullptr),
+      mQueryBuffer(
+          device,
+          label,
+          {GpuBufferUsage::QueryResolve, GpuBufferUsage::CopySrc},
+          sizeof(std::uint64_t) * queryCount),
+      mState(std::make_shared<State>()),
+      mQueryCount(queryCount),
+      mResolvedIdx(READBACK_BUFFER_COUNT)
+{
+    NLRS_ASSERT(device != nullptr);
+    NLRS_ASSERT(queryCount > 0);
+
+    for (ReadbackBuffer& readbackBuffer : mState->readbackBuffers)
+    {
+        readbackBuffer.buffer = GpuBuffer(
+            device,
+            label,
+            {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
+            sizeof(std::uint64_t) * queryCount,
+            GpuMemoryCategory::Staging);
+        readbackBuffer.timestamps.resize(queryCount, 0);
+    }
+
+    const WGPUQuerySetDescriptor querySetDesc{
+        .nextInChain = nullptr,
+        .label = label,
+        .type = WGPUQueryType_Timestamp,
+        .count = queryCount};
+    mQuerySet = wgpuDeviceCreateQuerySet(device, &querySetDesc);
+    if (!mQuerySet)
+    {
+        throw std::runtime_error(fmt::format("Failed to create query set \"{}\".", label));
+    }
+}
+
+GpuTimestampRing::GpuTimestampRing(GpuTimestampRing&& other) noexcept
+{
+    if (this != &other)
+    {
+        mQuerySet = std::exchange(other.mQuerySet, nullptr);
+        mQueryBuffer = std::move(other.mQueryBuffer);
+        mState = std::move(other.mState);
+        mQueryCount = std::exchange(other.mQueryCount, 0);
+        mResolvedIdx = std::exchange(other.mResolvedIdx, READBACK_BUFFER_COUNT);
+    }
+}
+
+GpuTimestampRing& GpuTimestampRing::operator=(GpuTimestampRing&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        mQuerySet = std::exchange(other.mQuerySet, nullptr);
+        mQueryBuffer = std::move(other.mQueryBuffer);
+        mState = std::move(other.mState);
+        mQueryCount = std::exchange(other.mQueryCount, 0);
+        mResolvedIdx = std::exchange(other.mResolvedIdx, READBACK_BUFFER_COUNT);
+    }
+    return *this;
+}
+
+GpuTimestampRing::~GpuTimestampRing() { release(); }
+
+void GpuTimestampRing::resolve(const WGPUCommandEncoder encoder, const std::uint64_t frameTag)
+{
+    NLRS_ASSERT(mState != nullptr);
+    NLRS_ASSERT(mResolvedIdx == READBACK_BUFFER_COUNT);
+
+    std::array<ReadbackBuffer, READBACK_BUFFER_COUNT>& readbackBuffers = mState->readbackBuffers;
+
+    const auto freeIt =
+        std::find_if(readbackBuffers.begin(), readbackBuffers.end(), [](const auto& readback) {
+            return readback.state == ReadbackState::Free;
+        });
+    if (freeIt == readbackBuffers.end())
+    {
+        return;
+    }
+
+    const std::size_t byteSize = sizeof(std::uint64_t) * mQueryCount;
+    wgpuCommandEncoderResolveQuerySet(encoder, mQuerySet, 0, mQueryCount, mQueryBuffer.ptr(), 0);
+    wgpuCommandEncoderCopyBufferToBuffer(
+        encoder, mQueryBuffer.ptr(), 0, freeIt->buffer.ptr(), 0, byteSize);
+    freeIt->frameTag = frameTag;
+    freeIt->state = ReadbackState::Resolved;
+    mResolvedIdx = static_cast<std::size_t>(std::distance(readbackBuffers.begin(), freeIt));
+}
+
+void GpuTimestampRing::readback()
+{
+    NLRS_ASSERT(mState != nullptr);
+
+    if (mResolvedIdx == READBACK_BUFFER_COUNT)
+    {
+        return;
+    }
+
+    ReadbackBuffer& readbackBuffer = mState->readbackBuffers[mResolvedIdx];
+    NLRS_ASSERT(readbackBuffer.state == ReadbackState::Resolved);
+    readbackBuffer.state = ReadbackState::Pending;
+    wgpuBufferMapAsync(
+        readbackBuffer.buffer.ptr(),
+        WGPUMapMode_Read,
+        0,
+        readbackBuffer.buffer.byteSize(),
+        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+            const std::unique_ptr<MapRequest> request(static_cast<MapRequest*>(userdata));
+            State& state = *request->state;
+            if (state.isOrphaned)
+            {
+                return;
+            }
+            ReadbackBuffer& readbackBuffer = state.readbackBuffers[request->readbackIdx];
+            if (status != WGPUBufferMapAsyncStatus_Success)
+            {
+                std::fprintf(stderr, "Failed to map timestamp readback buffer\n");
+                readbackBuffer.state = ReadbackState::Free;
+                return;
+            }
+            const WGPUBuffer  buffer = readbackBuffer.buffer.ptr();
+            const std::size_t byteSize = readbackBuffer.buffer.byteSize();
+            const void* const bufferData = wgpuBufferGetConstMappedRange(buffer, 0, byteSize);
+            NLRS_ASSERT(bufferData != nullptr);
+            std::memcpy(readbackBuffer.timestamps.data(), bufferData, byteSize);
+            wgpuBufferUnmap(buffer);
+            readbackBuffer.state = ReadbackState::Ready;
+        },
+        new MapRequest{mState, mResolvedIdx});
+    mResolvedIdx = READBACK_BUFFER_COUNT;
+}
+
+bool GpuTimestampRing::hasPendingReadbacks() const noexcept
+{
+    if (!mState)
+    {
+        return false;
+    }
+    return std::any_of(
+        mState->readbackBuffers.begin(),
+        mState->readbackBuffers.end(),
+        [](const ReadbackBuffer& readbackBuffer) -> bool {
+            return readbackBuffer.state == ReadbackState::Resolved ||
+                   readbackBuffer.state == ReadbackState::Pending;
+        });
+}
+
+void GpuTimestampRing::release() noexcept
+{
+    querySetSafeRelease(mQuerySet);
+    mQuerySet = nullptr;
+    if (mState)
+    {
+        // Destroying a buffer aborts its pending map request, and the orphaned state stops the
+        // callback from touching the buffer.
+        mState->isOrphaned = true;
+        for (ReadbackBuffer& readbackBuffer : mState->readbackBuffers)
+        {
+            readbackBuffer.buffer = GpuBuffer{};
+        }
+        mState.reset();
+    }
+}
+} // namespace nlrs
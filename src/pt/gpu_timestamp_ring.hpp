@@ -0,0 +1,112 @@
+#pragma once
+
+#include "gpu_buffer.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// Reads timestamp queries back to the CPU without waiting on the GPU. Each frame's queries are
+// resolved and copied to one of several readback buffers, which are mapped asynchronously. The
+// timestamps are consumed whenever their readback has completed, typically a few frames later.
+class GpuTimestampRing
+{
+public:
+    // Frames are not timed when all readback buffers are still in flight.
+    static constexpr std::size_t READBACK_BUFFER_COUNT = 4;
+
+    GpuTimestampRing() = default;
+    GpuTimestampRing(WGPUDevice device, const char* label, std::uint32_t queryCount);
+
+    GpuTimestampRing(const GpuTimestampRing&) = delete;
+    GpuTimestampRing& operator=(const GpuTimestampRing&) = delete;
+
+    GpuTimestampRing(GpuTimestampRing&&) noexcept;
+    GpuTimestampRing& operator=(GpuTimestampRing&&) noexcept;
+
+    ~GpuTimestampRing();
+
+    // The query set which the frame's timestamps are written to. The queue executes the frames in
+    // order, so the frames share the query set.
+    WGPUQuerySet querySet() const noexcept { return mQuerySet; }
+
+    // Encodes resolving the frame's queries to a free readback buffer, after the last timestamp has
+    // been written. The frame tag is passed back with the frame's timestamps, e.g. to tell which
+    // state the frame was rendered in.
+    void resolve(WGPUCommandEncoder encoder, std::uint64_t frameTag = 0);
+    // Starts mapping the readback buffer of the frame last passed to `resolve`. Called once the
+    // frame's command buffer has been submitted.
+    void readback();
+
+    // Calls `f` with the timestamps and the tag of each frame whose readback has completed since
+    // the last call. The completed readbacks are delivered by ticking the device.
+    template<typename F>
+    void consume(F&& f)
+    {
+        if (!mState)
+        {
+            return;
+        }
+        for (ReadbackBuffer& readbackBuffer : mState->readbackBuffers)
+        {
+            if (readbackBuffer.state == ReadbackState::Ready)
+            {
+                f(std::span<const std::uint64_t>(readbackBuffer.timestamps),
+                  readbackBuffer.frameTag);
+                readbackBuffer.state = ReadbackState::Free;
+            }
+        }
+    }
+
+    // True while a frame's readback has not completed yet.
+    bool hasPendingReadbacks() const noexcept;
+
+private:
+    enum class ReadbackState
+    {
+        Free,
+        // Resolved to by the current frame, and not yet mapped.
+        Resolved,
+        // Waiting to be mapped.
+        Pending,
+        // Mapped and copied to `timestamps`, waiting to be consumed.
+        Ready,
+    };
+
+    struct ReadbackBuffer
+    {
+        GpuBuffer                  buffer;
+        std::vector<std::uint64_t> timestamps;
+        std::uint64_t              frameTag = 0;
+        ReadbackState              state = ReadbackState::Free;
+    };
+
+    // Shared with the map callbacks, which may complete after the ring has been destroyed.
+    struct State
+    {
+        std::array<ReadbackBuffer, READBACK_BUFFER_COUNT> readbackBuffers;
+        bool                                              isOrphaned = false;
+    };
+
+    struct MapRequest
+    {
+        std::shared_ptr<State> state;
+        std::size_t            readbackIdx;
+    };
+
+    void release() noexcept;
+
+    WGPUQuerySet           mQuerySet = nullptr;
+    GpuBuffer              mQueryBuffer;
+    std::shared_ptr<State> mState;
+    std::uint32_t          mQueryCount = 0;
+    std::size_t            mResolvedIdx = READBACK_BUFFER_COUNT;
+};
+} // namespace nlrs
@@ -0,0 +1,38 @@
+#include "gpu_tracked_buffer.hpp"
+
+#include <algorithm>
+
+namespace nlrs
+{
+GpuTrackedBuffer::GpuTrackedBuffer(
+    const WGPUDevice      device,
+    const char* const     label,
+    const GpuBufferUsages usages,
+    const std::size_t     byteSize)
+    : mBuffer(device, label, usages, byteSize),
+      mContents(byteSize, std::byte{0})
+{
+    NLRS_ASSERT(usages.has(GpuBufferUsage::CopyDst));
+}
+
+std::size_t GpuTrackedBuffer::write(
+    GpuUploadRing&                   uploadRing,
+    const WGPUCommandEncoder         encoder,
+    const std::size_t                byteOffset,
+    const std::span<const std::byte> data)
+{
+    NLRS_ASSERT(byteOffset + data.size() <= mContents.size());
+    NLRS_ASSERT(byteOffset % 4 == 0);
+    NLRS_ASSERT(data.size() % 4 == 0);
+
+    const auto contents = std::span<std::byte>(mContents).subspan(byteOffset, data.size());
+    if (std::equal(data.begin(), data.end(), contents.begin()))
+    {
+        return 0;
+    }
+
+    std::copy(data.begin(), data.end(), contents.begin());
+    uploadRing.write(encoder, mBuffer.ptr(), byteOffset, data);
+    return data.size();
+}
+} // namespace nlrs
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "gpu_buffer.hpp"
+#include "gpu_upload_ring.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// A GpuBuffer which keeps a CPU-side copy of its contents, so that writes which would not change
+// the contents can be skipped. Intended for small uniform and storage buffers which are written
+// every frame, but often with the same data.
+class GpuTrackedBuffer
+{
+public:
+    GpuTrackedBuffer() = default;
+
+    GpuTrackedBuffer(const GpuTrackedBuffer&) = delete;
+    GpuTrackedBuffer& operator=(const GpuTrackedBuffer&) = delete;
+
+    GpuTrackedBuffer(GpuTrackedBuffer&&) noexcept = default;
+    GpuTrackedBuffer& operator=(GpuTrackedBuffer&&) noexcept = default;
+
+    GpuTrackedBuffer(
+        WGPUDevice      device,
+        const char*     label,
+        GpuBufferUsages usage,
+        std::size_t     byteSize);
+
+    // Writes `data` to the buffer at `byteOffset` through the upload ring, unless the buffer
+    // already contains the same bytes at that offset. Returns the number of bytes written, which is
+    // zero for a skipped write.
+    std::size_t write(
+        GpuUploadRing&             uploadRing,
+        WGPUCommandEncoder         encoder,
+        std::size_t                byteOffset,
+        std::span<const std::byte> data);
+
+    template<typename T>
+    std::size_t write(
+        GpuUploadRing&           uploadRing,
+        const WGPUCommandEncoder encoder,
+        const T&                 value)
+    {
+        return write(uploadRing, encoder, 0, std::as_bytes(std::span<const T, 1>(&value, 1)));
+    }
+
+    // Raw access
+
+    inline WGPUBuffer  ptr() const noexcept { return mBuffer.ptr(); }
+    inline std::size_t byteSize() const noexcept { return mBuffer.byteSize(); }
+
+    // Bind group and layout
+
+    inline WGPUBindGroupLayoutEntry bindGroupLayoutEntry(
+        const std::uint32_t        bindingIndex,
+        const WGPUShaderStageFlags visibility,
+        const std::size_t          minBindingSize = 0) const
+    {
+        return mBuffer.bindGroupLayoutEntry(bindingIndex, visibility, minBindingSize);
+    }
+    inline WGPUBindGroupEntry bindGroupEntry(const std::uint32_t bindingIndex) const
+    {
+        return mBuffer.bindGroupEntry(bindingIndex);
+    }
+
+private:
+    GpuBuffer mBuffer;
+    // WebGPU zero-initializes new buffers, and so the copy starts out zeroed as well.
+    std::vector<std::byte> mContents;
+};
+} // namespace nlrs
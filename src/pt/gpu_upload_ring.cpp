@@ -0,0 +1,277 @@
+#include "gpu_upload_ring.hpp"
+#include "webgpu_utils.hpp"
+
+#include <common/assert.hpp>
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace nlrs
+{
+namespace
+{
+// Sub-allocations are aligned for `wgpuCommandEncoderCopyBufferToBuffer`, which requires offsets
+// to be multiples of 4, and for the 16-byte alignment of uniform data.
+constexpr std::size_t UPLOAD_ALIGNMENT = 16;
+
+std::size_t alignUp(const std::size_t value, const std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+GpuUploadRing::GpuUploadRing(const WGPUDevice device, const std::size_t chunkByteSize)
+    : mState(std::make_shared<State>()),
+      mChunkByteSize(alignUp(chunkByteSize, UPLOAD_ALIGNMENT)),
+      mFrameStagingIndices(),
+      mFrameUploadByteSize(0),
+      mUploadByteSizes()
+{
+    NLRS_ASSERT(device != nullptr);
+    NLRS_ASSERT(chunkByteSize > 0);
+    mState->device = device;
+}
+
+GpuUploadRing::GpuUploadRing(GpuUploadRing&& other) noexcept
+{
+    if (this != &other)
+    {
+        mState = std::move(other.mState);
+        mChunkByteSize = other.mChunkByteSize;
+        mFrameStagingIndices = std::move(other.mFrameStagingIndices);
+        mFrameUploadByteSize = std::exchange(other.mFrameUploadByteSize, 0);
+        mUploadByteSizes = std::move(other.mUploadByteSizes);
+    }
+}
+
+GpuUploadRing& GpuUploadRing::operator=(GpuUploadRing&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        mState = std::move(other.mState);
+        mChunkByteSize = other.mChunkByteSize;
+        mFrameStagingIndices = std::move(other.mFrameStagingIndices);
+        mFrameUploadByteSize = std::exchange(other.mFrameUploadByteSize, 0);
+        mUploadByteSizes = std::move(other.mUploadByteSizes);
+    }
+    return *this;
+}
+
+GpuUploadRing::~GpuUploadRing() { release(); }
+
+void GpuUploadRing::write(
+    const WGPUCommandEncoder         encoder,
+    const WGPUBuffer                 dst,
+    const std::size_t                dstOffset,
+    const std::span<const std::byte> data)
+{
+    NLRS_ASSERT(mState != nullptr);
+    NLRS_ASSERT(dstOffset % 4 == 0);
+    NLRS_ASSERT(data.size() % 4 == 0);
+
+    if (data.empty())
+    {
+        return;
+    }
+
+    WGPUBuffer       stagingBuffer = nullptr;
+    std::size_t      stagingOffset = 0;
+    std::byte* const stagingData = allocate(data.size(), stagingBuffer, stagingOffset);
+    std::memcpy(stagingData, data.data(), data.size());
+    wgpuCommandEncoderCopyBufferToBuffer(
+        encoder, stagingBuffer, stagingOffset, dst, dstOffset, data.size());
+    mFrameUploadByteSize += data.size();
+}
+
+void GpuUploadRing::submit(const WGPUQueue queue, const WGPUCommandBuffer cmdBuffer)
+{
+    NLRS_ASSERT(mState != nullptr);
+
+    for (const std::size_t stagingIdx : mFrameStagingIndices)
+    {
+        StagingBuffer& staging = mState->stagingBuffers[stagingIdx];
+        wgpuBufferUnmap(staging.buffer);
+        staging.mappedData = nullptr;
+        staging.state = StagingState::Pending;
+    }
+
+    wgpuQueueSubmit(queue, 1, &cmdBuffer);
+
+    // The map requests complete once the GPU has finished the copies from the staging buffers.
+    for (const std::size_t stagingIdx : mFrameStagingIndices)
+    {
+        const StagingBuffer& staging = mState->stagingBuffers[stagingIdx];
+        wgpuBufferMapAsync(
+            staging.buffer,
+            WGPUMapMode_Write,
+            0,
+            staging.byteSize,
+            [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+                const std::unique_ptr<MapRequest> request(static_cast<MapRequest*>(userdata));
+                State& state = *request->state;
+                if (state.isOrphaned)
+                {
+                    return;
+                }
+                StagingBuffer& staging = state.stagingBuffers[request->stagingIdx];
+                if (status != WGPUBufferMapAsyncStatus_Success)
+                {
+                    std::fprintf(stderr, "Failed to map upload staging buffer\n");
+                    staging.state = StagingState::Failed;
+                    return;
+                }
+                staging.mappedData = static_cast<std::byte*>(
+                    wgpuBufferGetMappedRange(staging.buffer, 0, staging.byteSize));
+                staging.offset = 0;
+                staging.state = StagingState::Free;
+            },
+            new MapRequest{mState, stagingIdx});
+    }
+    mFrameStagingIndices.clear();
+
+    mUploadByteSizes.push_back(mFrameUploadByteSize);
+    if (mUploadByteSizes.size() > 30)
+    {
+        mUploadByteSizes.pop_front();
+    }
+    mFrameUploadByteSize = 0;
+}
+
+float GpuUploadRing::averageUploadByteSize() const
+{
+    if (mUploadByteSizes.empty())
+    {
+        return 0.0f;
+    }
+
+    const std::uint64_t sum =
+        std::accumulate(mUploadByteSizes.begin(), mUploadByteSizes.end(), std::uint64_t(0));
+    return static_cast<float>(sum) / mUploadByteSizes.size();
+}
+
+std::size_t GpuUploadRing::stagingByteSize() const
+{
+    if (!mState)
+    {
+        return 0;
+    }
+
+    std::size_t byteSize = 0;
+    for (const StagingBuffer& staging : mState->stagingBuffers)
+    {
+        byteSize += staging.byteSize;
+    }
+    return byteSize;
+}
+
+std::byte* GpuUploadRing::allocate(
+    const std::size_t byteSize,
+    WGPUBuffer&       stagingBuffer,
+    std::size_t&      offset)
+{
+    std::vector<StagingBuffer>& stagingBuffers = mState->stagingBuffers;
+
+    const auto allocateFrom = [byteSize, &stagingBuffer, &offset](
+                                  StagingBuffer& staging) -> std::byte* {
+        NLRS_ASSERT(staging.mappedData != nullptr);
+        offset = staging.offset;
+        staging.offset = alignUp(staging.offset + byteSize, UPLOAD_ALIGNMENT);
+        stagingBuffer = staging.buffer;
+        return staging.mappedData + offset;
+    };
+
+    // The frame's staging buffers are filled in order, so only the most recent one has room.
+    if (!mFrameStagingIndices.empty())
+    {
+        StagingBuffer& staging = stagingBuffers[mFrameStagingIndices.back()];
+        if (staging.offset + byteSize <= staging.byteSize)
+        {
+            return allocateFrom(staging);
+        }
+    }
+
+    const auto freeIt = std::find_if(
+        stagingBuffers.begin(), stagingBuffers.end(), [byteSize](const StagingBuffer& staging) {
+            return staging.state == StagingState::Free && staging.byteSize >= byteSize;
+        });
+    if (freeIt != stagingBuffers.end())
+    {
+        freeIt->state = StagingState::Current;
+        mFrameStagingIndices.push_back(
+            static_cast<std::size_t>(std::distance(stagingBuffers.begin(), freeIt)));
+        return allocateFrom(*freeIt);
+    }
+
+    const std::size_t   stagingByteSize = std::max(mChunkByteSize, alignUp(byteSize, 4));
+    GpuMemoryAllocation allocation(
+        "Upload staging buffer", GpuMemoryCategory::Staging, stagingByteSize);
+
+    const WGPUBufferDescriptor bufferDesc{
+        .nextInChain = nullptr,
+        .label = "Upload staging buffer",
+        .usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
+        .size = stagingByteSize,
+        .mappedAtCreation = true,
+    };
+    const WGPUBuffer buffer = wgpuDeviceCreateBuffer(mState->device, &bufferDesc);
+    if (!buffer)
+    {
+        throw std::runtime_error(
+            fmt::format("Failed to create upload staging buffer, bytesize: {}.", stagingByteSize));
+    }
+    StagingBuffer staging{
+        .buffer = buffer,
+        .byteSize = stagingByteSize,
+        .offset = 0,
+        .mappedData =
+            static_cast<std::byte*>(wgpuBufferGetMappedRange(buffer, 0, stagingByteSize)),
+        .state = StagingState::Current,
+        .allocation = std::move(allocation),
+    };
+
+    // A staging buffer which failed to map is replaced, so that failures don't grow the ring. The
+    // map requests refer to staging buffers by index, so the slot is kept.
+    const auto failedIt =
+        std::find_if(stagingBuffers.begin(), stagingBuffers.end(), [](const StagingBuffer& s) {
+            return s.state == StagingState::Failed;
+        });
+    std::size_t stagingIdx = stagingBuffers.size();
+    if (failedIt != stagingBuffers.end())
+    {
+        bufferSafeRelease(failedIt->buffer);
+        *failedIt = std::move(staging);
+        stagingIdx = static_cast<std::size_t>(std::distance(stagingBuffers.begin(), failedIt));
+    }
+    else
+    {
+        stagingBuffers.push_back(std::move(staging));
+    }
+    mFrameStagingIndices.push_back(stagingIdx);
+    return allocateFrom(stagingBuffers[stagingIdx]);
+}
+
+void GpuUploadRing::release() noexcept
+{
+    if (mState)
+    {
+        // Destroying a buffer aborts its pending map request, and the orphaned state stops the
+        // callback from touching the buffer.
+        mState->isOrphaned = true;
+        for (StagingBuffer& staging : mState->stagingBuffers)
+        {
+            bufferSafeRelease(staging.buffer);
+            staging.buffer = nullptr;
+        }
+        // Pending map callbacks keep the state alive, but the memory is released here.
+        mState->stagingBuffers.clear();
+        mState.reset();
+    }
+}
+} // namespace nlrs
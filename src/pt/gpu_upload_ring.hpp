@@ -0,0 +1,109 @@
+#pragma once
+
+#include <common/gpu_memory.hpp>
+
+#include <webgpu/webgpu.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace nlrs
+{
+// Uploads per-frame data, e.g. uniforms and streamed texture tiles, through a reused set of mapped
+// MapWrite|CopySrc staging buffers instead of queue writes. Each frame's uploads are sub-allocated
+// linearly from the staging buffers, and copied to their destinations by copy commands in the
+// frame's command encoder. A staging buffer is reused once it has been mapped again, which only
+// completes after the GPU has finished the frame's copies.
+class GpuUploadRing
+{
+public:
+    // The byte size of a staging buffer. Larger uploads get a staging buffer of their own size.
+    static constexpr std::size_t DEFAULT_CHUNK_BYTE_SIZE = 1 << 20;
+
+    GpuUploadRing() = default;
+    explicit GpuUploadRing(WGPUDevice device, std::size_t chunkByteSize = DEFAULT_CHUNK_BYTE_SIZE);
+
+    GpuUploadRing(const GpuUploadRing&) = delete;
+    GpuUploadRing& operator=(const GpuUploadRing&) = delete;
+
+    GpuUploadRing(GpuUploadRing&&) noexcept;
+    GpuUploadRing& operator=(GpuUploadRing&&) noexcept;
+
+    ~GpuUploadRing();
+
+    // Copies `data` to staging memory, and encodes a copy of it to `dst` at `dstOffset`. The copy
+    // must be encoded outside of passes, and before the commands which read `dst`. The byte offset
+    // and the size must be multiples of 4.
+    void write(
+        WGPUCommandEncoder         encoder,
+        WGPUBuffer                 dst,
+        std::size_t                dstOffset,
+        std::span<const std::byte> data);
+
+    template<typename T>
+    void write(const WGPUCommandEncoder encoder, const WGPUBuffer dst, const T& value)
+    {
+        write(encoder, dst, 0, std::as_bytes(std::span<const T, 1>(&value, 1)));
+    }
+
+    // Unmaps the frame's staging buffers, submits `cmdBuffer`, and starts mapping the staging
+    // buffers again for reuse. Replaces `wgpuQueueSubmit` for command buffers which contain
+    // uploads.
+    void submit(WGPUQueue queue, WGPUCommandBuffer cmdBuffer);
+
+    // The average number of bytes uploaded per frame over the most recent frames.
+    float       averageUploadByteSize() const;
+    // The total byte size of the staging buffers.
+    std::size_t stagingByteSize() const;
+
+private:
+    enum class StagingState
+    {
+        // Mapped, and not used by the current frame.
+        Free,
+        // Mapped, and used by the current frame.
+        Current,
+        // Waiting to be mapped again after a submit.
+        Pending,
+        // Mapping failed. The buffer is released, and its slot reused for the next new buffer.
+        Failed,
+    };
+
+    struct StagingBuffer
+    {
+        WGPUBuffer          buffer = nullptr;
+        std::size_t         byteSize = 0;
+        std::size_t         offset = 0;
+        std::byte*          mappedData = nullptr;
+        StagingState        state = StagingState::Free;
+        GpuMemoryAllocation allocation = GpuMemoryAllocation{};
+    };
+
+    // Shared with the map callbacks, which may complete after the ring has been destroyed.
+    struct State
+    {
+        WGPUDevice                 device = nullptr;
+        std::vector<StagingBuffer> stagingBuffers;
+        bool                       isOrphaned = false;
+    };
+
+    struct MapRequest
+    {
+        std::shared_ptr<State> state;
+        std::size_t            stagingIdx;
+    };
+
+    std::byte* allocate(std::size_t byteSize, WGPUBuffer& stagingBuffer, std::size_t& offset);
+    void       release() noexcept;
+
+    std::shared_ptr<State>    mState;
+    std::size_t               mChunkByteSize = DEFAULT_CHUNK_BYTE_SIZE;
+    std::vector<std::size_t>  mFrameStagingIndices;
+    std::size_t               mFrameUploadByteSize = 0;
+    std::deque<std::uint64_t> mUploadByteSizes;
+};
+} // namespace nlrs
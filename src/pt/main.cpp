@@ -3,38 +3,74 @@
 #include "gpu_limits.hpp"
 #include "gui.hpp"
 #include "deferred_renderer.hpp"
+#include "offscreen_render_target.hpp"
 #include "reference_path_tracer.hpp"
 #include "window.hpp"
 
 #include <common/assert.hpp>
 #include <common/bvh.hpp>
+#include <common/duration_histogram.hpp>
 #include <common/file_stream.hpp>
+#include <common/gpu_memory.hpp>
 #include <common/ray_intersection.hpp>
 #include <common/triangle_attributes.hpp>
 #include <pt-format/vertex_attributes.hpp>
 #include <pt-format/pt_format.hpp>
 
 #include <fmt/core.h>
+#include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
 #include <imgui.h>
+#include <stb_image_write.h>
 #include <webgpu/webgpu.h>
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 inline constexpr int defaultWindowWidth = 640;
 inline constexpr int defaultWindowHeight = 480;
+// The path tracer's compute workgroup tile.
+inline constexpr nlrs::Extent2u defaultWorkgroupSize = nlrs::Extent2u(8, 8);
+// 16 MiB of resident texture tiles when virtual texturing is enabled.
+inline constexpr std::uint32_t virtualTexturePhysicalTileCount = 1024;
 
-void printHelp() { std::printf("Usage:\n\tpt <input_pt_file>\n"); }
+void printHelp()
+{
+    std::printf(
+        "Usage:\n"
+        "\tpt [--virtual-textures] [--integrator <megakernel|wavefront>]\n"
+        "\t   [--bvh-builder <offline|gpu>] [--validate-bvh] [--traversal <stack|short-stack>]\n"
+        "\t   [--pipeline-cache <directory>] [--gpu-memory-budget <MiB>]\n"
+        "\t   [--lighting-resolution <full|half|checkerboard>] [--frame-time-budget <ms>]\n"
+        "\t   <input_pt_file>\n"
+        "\tpt --headless <output.png|output.pfm> [--renderer <path-tracer|deferred>]\n"
+        "\t   [--frames <count>] [--samples <count>] [--size <width> <height>]\n"
+        "\t   [--workgroup-size <x> <y>] [--fallback-adapter] [--virtual-textures]\n"
+        "\t   [--integrator <megakernel|wavefront>] [--bvh-builder <offline|gpu>]\n"
+        "\t   [--validate-bvh] [--traversal <stack|short-stack>]\n"
+        "\t   [--pipeline-cache <directory>] [--gpu-memory-budget <MiB>]\n"
+        "\t   [--lighting-resolution <full|half|checkerboard>] [--frame-time-budget <ms>]\n"
+        "\t   <input_pt_file>\n");
+}
 
 enum RendererType
 {
@@ -43,6 +79,251 @@ enum RendererType
     RendererType_Debug,
 };
 
+struct HeadlessOptions
+{
+    const char* outputPath = nullptr;
+    int         rendererType = RendererType_PathTracer;
+    // When unset, as many frames as there are samples per pixel are rendered. The path tracer stops
+    // early once all samples have been accumulated.
+    std::optional<std::uint32_t> frameCount;
+    std::uint32_t                numSamplesPerPixel = 64;
+    nlrs::Extent2u framebufferSize = nlrs::Extent2u(defaultWindowWidth, defaultWindowHeight);
+    nlrs::Extent2u workgroupSize = defaultWorkgroupSize;
+    bool           useFallbackAdapter = false;
+};
+
+struct Options
+{
+    const char*                    ptFilePath = nullptr;
+    bool                           useVirtualTextures = false;
+    nlrs::Integrator               integrator = nlrs::Integrator::Megakernel;
+    nlrs::BvhBuilder               bvhBuilder = nlrs::BvhBuilder::Offline;
+    // Compares the path tracer's BVH against the offline BVH before rendering.
+    bool                           validateBvh = false;
+    nlrs::Traversal                traversal = nlrs::Traversal::Stack;
+    // Compiled pipelines are cached in this directory across runs.
+    const char*                    pipelineCacheDirectory = nullptr;
+    // GPU resource creation fails once the tracked allocations would exceed the budget. Zero
+    // disables the budget.
+    std::uint32_t                  gpuMemoryBudgetMiB = 0;
+    // The deferred renderer's initial lighting resolution, which the GUI can change.
+    nlrs::LightingResolution       lightingResolution = nlrs::LightingResolution::Full;
+    // The renderers scale their resolution to keep the GPU frame time within the budget. Zero
+    // disables dynamic resolution.
+    std::uint32_t                  frameTimeBudgetMs = 0;
+    std::optional<HeadlessOptions> headless;
+};
+
+std::optional<std::uint32_t> parsePositiveInt(const char* const str)
+{
+    char*               end = nullptr;
+    const unsigned long value = std::strtoul(str, &end, 10);
+    if (end == str || *end != '\0' || value == 0 || value > UINT32_MAX)
+    {
+        return std::nullopt;
+    }
+    return static_cast<std::uint32_t>(value);
+}
+
+std::optional<Options> parseOptions(const int argc, char** const argv)
+{
+    Options         options;
+    HeadlessOptions headless;
+    bool            isHeadless = false;
+    bool            hasHeadlessArgs = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* const arg = argv[i];
+        const bool        hasValue = i + 1 < argc;
+        if (std::strcmp(arg, "--virtual-textures") == 0)
+        {
+            options.useVirtualTextures = true;
+        }
+        else if (std::strcmp(arg, "--integrator") == 0 && hasValue)
+        {
+            const char* const integrator = argv[++i];
+            if (std::strcmp(integrator, "megakernel") == 0)
+            {
+                options.integrator = nlrs::Integrator::Megakernel;
+            }
+            else if (std::strcmp(integrator, "wavefront") == 0)
+            {
+                options.integrator = nlrs::Integrator::Wavefront;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(arg, "--bvh-builder") == 0 && hasValue)
+        {
+            const char* const bvhBuilder = argv[++i];
+            if (std::strcmp(bvhBuilder, "offline") == 0)
+            {
+                options.bvhBuilder = nlrs::BvhBuilder::Offline;
+            }
+            else if (std::strcmp(bvhBuilder, "gpu") == 0)
+            {
+                options.bvhBuilder = nlrs::BvhBuilder::Gpu;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(arg, "--validate-bvh") == 0)
+        {
+            options.validateBvh = true;
+        }
+        else if (std::strcmp(arg, "--traversal") == 0 && hasValue)
+        {
+            const char* const traversal = argv[++i];
+            if (std::strcmp(traversal, "stack") == 0)
+            {
+                options.traversal = nlrs::Traversal::Stack;
+            }
+            else if (std::strcmp(traversal, "short-stack") == 0)
+            {
+                options.traversal = nlrs::Traversal::ShortStack;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(arg, "--pipeline-cache") == 0 && hasValue)
+        {
+            options.pipelineCacheDirectory = argv[++i];
+        }
+        else if (std::strcmp(arg, "--gpu-memory-budget") == 0 && hasValue)
+        {
+            const auto budget = parsePositiveInt(argv[++i]);
+            if (!budget)
+            {
+                return std::nullopt;
+            }
+            options.gpuMemoryBudgetMiB = *budget;
+        }
+        else if (std::strcmp(arg, "--lighting-resolution") == 0 && hasValue)
+        {
+            const char* const lightingResolution = argv[++i];
+            if (std::strcmp(lightingResolution, "full") == 0)
+            {
+                options.lightingResolution = nlrs::LightingResolution::Full;
+            }
+            else if (std::strcmp(lightingResolution, "half") == 0)
+            {
+                options.lightingResolution = nlrs::LightingResolution::Half;
+            }
+            else if (std::strcmp(lightingResolution, "checkerboard") == 0)
+            {
+                options.lightingResolution = nlrs::LightingResolution::Checkerboard;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(arg, "--frame-time-budget") == 0 && hasValue)
+        {
+            const auto budget = parsePositiveInt(argv[++i]);
+            if (!budget)
+            {
+                return std::nullopt;
+            }
+            options.frameTimeBudgetMs = *budget;
+        }
+        else if (std::strcmp(arg, "--headless") == 0 && hasValue)
+        {
+            isHeadless = true;
+            headless.outputPath = argv[++i];
+        }
+        else if (std::strcmp(arg, "--renderer") == 0 && hasValue)
+        {
+            hasHeadlessArgs = true;
+            const char* const renderer = argv[++i];
+            if (std::strcmp(renderer, "path-tracer") == 0)
+            {
+                headless.rendererType = RendererType_PathTracer;
+            }
+            else if (std::strcmp(renderer, "deferred") == 0)
+            {
+                headless.rendererType = RendererType_Deferred;
+            }
+            else
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+        {
+            hasHeadlessArgs = true;
+            headless.frameCount = parsePositiveInt(argv[++i]);
+            if (!headless.frameCount)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (std::strcmp(arg, "--samples") == 0 && hasValue)
+        {
+            hasHeadlessArgs = true;
+            const auto samples = parsePositiveInt(argv[++i]);
+            if (!samples)
+            {
+                return std::nullopt;
+            }
+            headless.numSamplesPerPixel = *samples;
+        }
+        else if (std::strcmp(arg, "--size") == 0 && i + 2 < argc)
+        {
+            hasHeadlessArgs = true;
+            const auto width = parsePositiveInt(argv[++i]);
+            const auto height = parsePositiveInt(argv[++i]);
+            if (!width || !height)
+            {
+                return std::nullopt;
+            }
+            headless.framebufferSize = nlrs::Extent2u(*width, *height);
+        }
+        else if (std::strcmp(arg, "--workgroup-size") == 0 && i + 2 < argc)
+        {
+            hasHeadlessArgs = true;
+            const auto x = parsePositiveInt(argv[++i]);
+            const auto y = parsePositiveInt(argv[++i]);
+            if (!x || !y)
+            {
+                return std::nullopt;
+            }
+            headless.workgroupSize = nlrs::Extent2u(*x, *y);
+        }
+        else if (std::strcmp(arg, "--fallback-adapter") == 0)
+        {
+            hasHeadlessArgs = true;
+            headless.useFallbackAdapter = true;
+        }
+        else if (i == argc - 1 && arg[0] != '-')
+        {
+            options.ptFilePath = arg;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+
+    if (!options.ptFilePath || (hasHeadlessArgs && !isHeadless))
+    {
+        return std::nullopt;
+    }
+    if (isHeadless)
+    {
+        options.headless = headless;
+    }
+
+    return options;
+}
+
 struct UiState
 {
     int   rendererType = RendererType_Deferred;
@@ -50,6 +331,7 @@ struct UiState
     // sampling
     int numSamplesPerPixel = 64;
     int numBounces = 2;
+    int lightingResolution = static_cast<int>(nlrs::LightingResolution::Full);
     // sky
     float                sunZenithDegrees = 30.0f;
     float                sunAzimuthDegrees = 0.0f;
@@ -68,6 +350,33 @@ struct AppState
     bool                         focusPressed = false;
 };
 
+// Startup milestones, in milliseconds since the start of `main`.
+struct StartupTimes
+{
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    float                                 renderersCreatedMs = 0.0f;
+    // When the pipelines of the first displayed renderer finished compiling.
+    std::optional<float>                  pipelinesReadyMs;
+    std::optional<float>                  firstFrameMs;
+
+    float elapsedMs() const
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin)
+            .count();
+    }
+
+    void print() const
+    {
+        fmt::print(
+            stderr,
+            "Startup: renderers created in {:.1f} ms, pipelines ready in {:.1f} ms, first frame "
+            "in {:.1f} ms\n",
+            renderersCreatedMs,
+            pipelinesReadyMs.value_or(0.0f),
+            firstFrameMs.value_or(0.0f));
+    }
+};
+
 nlrs::Extent2i largestMonitorResolution()
 {
     int           monitorCount;
@@ -101,17 +410,504 @@ nlrs::Extent2i largestMonitorResolution()
     return maxResolution;
 }
 
+using Renderers = std::tuple<AppState, nlrs::ReferencePathTracer, nlrs::DeferredRenderer>;
+
+Renderers loadRenderers(
+    const nlrs::GpuContext& gpuContext,
+    const char* const       ptFilePath,
+    const nlrs::Extent2u    framebufferSize,
+    const nlrs::Extent2i    maxFramebufferSize,
+    const nlrs::Extent2u    workgroupSize,
+    const nlrs::Integrator  integrator,
+    const nlrs::BvhBuilder  bvhBuilder,
+    const bool              validateBvh,
+    const nlrs::Traversal   traversal,
+    const bool              useVirtualTextures,
+    const std::uint32_t     frameTimeBudgetMs)
+{
+    nlrs::PtFormat ptFormat;
+    {
+        const fs::path path = ptFilePath;
+        if (!fs::exists(path))
+        {
+            fmt::print(stderr, "File {} does not exist\n", path.string());
+            std::exit(1);
+        }
+        nlrs::InputFileStream file(ptFilePath);
+        nlrs::deserialize(file, ptFormat);
+    }
+
+    const auto skyStateCache = std::make_shared<nlrs::SkyStateCache>();
+
+    const nlrs::RendererDescriptor rendererDesc{
+        nlrs::RenderParameters{
+            framebufferSize,
+            nlrs::FlyCameraController{}.getCamera(),
+            nlrs::SamplingParams(),
+            nlrs::Sky(),
+            1.0f},
+        maxFramebufferSize,
+        nlrs::TextureLayout::Tiled,
+        skyStateCache,
+        workgroupSize,
+        integrator,
+        bvhBuilder,
+        traversal,
+        static_cast<float>(frameTimeBudgetMs),
+    };
+
+    nlrs::Scene scene{
+        .bvhNodes = ptFormat.bvhNodes,
+        .positionAttributes = ptFormat.trianglePositionAttributes,
+        .vertexAttributes = ptFormat.triangleVertexAttributes,
+        .baseColorTextures = ptFormat.baseColorTextures,
+    };
+
+    nlrs::ReferencePathTracer referenceRenderer{rendererDesc, gpuContext, std::move(scene)};
+
+    if (validateBvh)
+    {
+        const std::vector<nlrs::BvhNode> bvhNodes = referenceRenderer.readBvhNodes(gpuContext);
+        const std::size_t                triangleCount = ptFormat.trianglePositionAttributes.size();
+        if (!nlrs::isValidBvh(bvhNodes, triangleCount))
+        {
+            throw std::runtime_error("The path tracer's BVH failed validation.");
+        }
+        // The SAH cost relative to the offline BVH measures the quality of the GPU builder.
+        const float offlineCost = nlrs::sahCost(ptFormat.bvhNodes);
+        const float cost = nlrs::sahCost(bvhNodes);
+        fmt::print(
+            stderr,
+            "BVH is valid: {} nodes, SAH cost {:.2f} ({:.2f}x the offline BVH)\n",
+            bvhNodes.size(),
+            cost,
+            cost / offlineCost);
+    }
+
+    nlrs::DeferredRenderer deferredRenderer{
+        gpuContext,
+        nlrs::DeferredRendererDescriptor{
+            .framebufferSize = framebufferSize,
+            .maxFramebufferSize = nlrs::Extent2u(maxFramebufferSize),
+            .modelPositions = ptFormat.modelVertexPositions,
+            .modelNormals = ptFormat.modelVertexNormals,
+            .modelTexCoords = ptFormat.modelVertexTexCoords,
+            .modelIndices = ptFormat.modelVertexIndices,
+            .modelBaseColorTextureIndices = ptFormat.modelBaseColorTextureIndices,
+            .sceneBaseColorTextures = ptFormat.baseColorTextures,
+            .sceneBvhNodes = ptFormat.bvhNodes,
+            .scenePositionAttributes = ptFormat.trianglePositionAttributes,
+            .sceneVertexAttributes = ptFormat.triangleVertexAttributes,
+            .textureLayout = nlrs::TextureLayout::Tiled,
+            .virtualTexturePhysicalTileCount =
+                useVirtualTextures ? virtualTexturePhysicalTileCount : 0,
+            .skyStateCache = skyStateCache,
+            .targetFrameMs = static_cast<float>(frameTimeBudgetMs)}};
+
+    AppState app{
+        .cameraController{},
+        .bvhNodes = std::move(ptFormat.bvhNodes),
+        .positions = std::move(ptFormat.bvhPositionAttributes),
+        .ui = UiState{},
+        .focusPressed = false,
+    };
+
+    return std::make_tuple(
+        std::move(app), std::move(referenceRenderer), std::move(deferredRenderer));
+}
+
+nlrs::Sky skyParameters(const UiState& ui)
+{
+    return nlrs::Sky{
+        ui.skyTurbidity,
+        ui.skyAlbedo,
+        ui.sunZenithDegrees,
+        ui.sunAzimuthDegrees,
+    };
+}
+
+float exposure(const UiState& ui)
+{
+    NLRS_ASSERT(ui.exposureStops >= 0);
+    return 1.0f / std::exp2(static_cast<float>(ui.exposureStops));
+}
+
+nlrs::RenderParameters referenceRenderParameters(
+    const AppState&      appState,
+    const nlrs::Extent2u framebufferSize)
+{
+    return nlrs::RenderParameters{
+        framebufferSize,
+        appState.cameraController.getCamera(),
+        nlrs::SamplingParams{
+            static_cast<std::uint32_t>(appState.ui.numSamplesPerPixel),
+            static_cast<std::uint32_t>(appState.ui.numBounces),
+        },
+        skyParameters(appState.ui),
+        exposure(appState.ui)};
+}
+
+nlrs::RenderDescriptor deferredRenderDescriptor(
+    const AppState&       appState,
+    const nlrs::Extent2u  framebufferSize,
+    const WGPUTextureView targetTextureView)
+{
+    return nlrs::RenderDescriptor{
+        appState.cameraController.viewReverseZProjectionMatrix(),
+        appState.cameraController.position(),
+        skyParameters(appState.ui),
+        framebufferSize,
+        exposure(appState.ui),
+        targetTextureView,
+        static_cast<nlrs::LightingResolution>(appState.ui.lightingResolution),
+    };
+}
+
+// The renderers compile their pipelines asynchronously, and can't render until they are ready.
+bool isRendererReady(
+    const int                        rendererType,
+    const nlrs::ReferencePathTracer& referenceRenderer,
+    const nlrs::DeferredRenderer&    deferredRenderer)
+{
+    switch (rendererType)
+    {
+    case RendererType_PathTracer:
+        return referenceRenderer.isReady();
+    case RendererType_Deferred:
+        return deferredRenderer.isReady();
+    case RendererType_Debug:
+        return deferredRenderer.isDebugReady();
+    }
+    NLRS_ASSERT(false);
+    return false;
+}
+
+// A renderer whose pipelines failed to compile never becomes ready.
+bool hasRendererFailed(
+    const int                        rendererType,
+    const nlrs::ReferencePathTracer& referenceRenderer,
+    const nlrs::DeferredRenderer&    deferredRenderer)
+{
+    switch (rendererType)
+    {
+    case RendererType_PathTracer:
+        return referenceRenderer.hasFailed();
+    case RendererType_Deferred:
+        return deferredRenderer.hasFailed();
+    case RendererType_Debug:
+        return deferredRenderer.hasDebugFailed();
+    }
+    NLRS_ASSERT(false);
+    return false;
+}
+
+// Clears the target and draws the GUI, while the renderer's pipelines are compiling.
+void renderPlaceholderFrame(
+    const nlrs::GpuContext& gpuContext,
+    const WGPUTextureView   targetTextureView,
+    nlrs::Gui&              gui)
+{
+    const WGPUCommandEncoderDescriptor cmdEncoderDesc{
+        .nextInChain = nullptr,
+        .label = "Placeholder frame command encoder",
+    };
+    const WGPUCommandEncoder encoder =
+        wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
+
+    const WGPURenderPassColorAttachment colorAttachment{
+        .nextInChain = nullptr,
+        .view = targetTextureView,
+        .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
+        .resolveTarget = nullptr,
+        .loadOp = WGPULoadOp_Clear,
+        .storeOp = WGPUStoreOp_Store,
+        .clearValue = WGPUColor{0.0, 0.0, 0.0, 1.0},
+    };
+    const WGPURenderPassDescriptor renderPassDesc{
+        .nextInChain = nullptr,
+        .label = "Placeholder frame render pass",
+        .colorAttachmentCount = 1,
+        .colorAttachments = &colorAttachment,
+        .depthStencilAttachment = nullptr,
+        .occlusionQuerySet = nullptr,
+        .timestampWrites = nullptr,
+    };
+    const WGPURenderPassEncoder renderPass =
+        wgpuCommandEncoderBeginRenderPass(encoder, &renderPassDesc);
+    gui.render(renderPass);
+    wgpuRenderPassEncoderEnd(renderPass);
+
+    const WGPUCommandBufferDescriptor cmdBufferDesc{
+        .nextInChain = nullptr,
+        .label = "Placeholder frame command buffer",
+    };
+    const WGPUCommandBuffer cmdBuffer = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+
+    wgpuCommandBufferRelease(cmdBuffer);
+    wgpuRenderPassEncoderRelease(renderPass);
+    wgpuCommandEncoderRelease(encoder);
+}
+
+std::string durationsJson(const nlrs::DurationHistogram::Summary& durations)
+{
+    return fmt::format(
+        "{{\"minMs\": {:.3f}, \"averageMs\": {:.3f}, \"p95Ms\": {:.3f}, \"maxMs\": {:.3f}}}",
+        durations.minMs,
+        durations.averageMs,
+        durations.p95Ms,
+        durations.maxMs);
+}
+
+void durationsText(const char* const name, const nlrs::DurationHistogram::Summary& durations)
+{
+    ImGui::Text(
+        "%s: %.2f ms (p95 %.2f ms, %.2f-%.2f ms)",
+        name,
+        durations.averageMs,
+        durations.p95Ms,
+        durations.minMs,
+        durations.maxMs);
+}
+
+// The tracked GPU memory usage as a JSON object, byte sizes per category.
+std::string gpuMemoryJson()
+{
+    const nlrs::GpuMemoryTracker& tracker = nlrs::GpuMemoryTracker::global();
+    std::string                   categories;
+    for (std::size_t idx = 0; idx < nlrs::GPU_MEMORY_CATEGORY_COUNT; ++idx)
+    {
+        const auto category = static_cast<nlrs::GpuMemoryCategory>(idx);
+        const auto usage = tracker.categoryUsage(category);
+        categories += fmt::format(
+            "{}\"{}\": {{\"bytes\": {}, \"peakBytes\": {}}}",
+            idx == 0 ? "" : ", ",
+            nlrs::gpuMemoryCategoryName(category),
+            usage.byteSize,
+            usage.peakByteSize);
+    }
+    return fmt::format(
+        "{{\"bytes\": {}, \"peakBytes\": {}, \"budgetBytes\": {}, \"categories\": {{{}}}}}",
+        tracker.totalUsage().byteSize,
+        tracker.totalUsage().peakByteSize,
+        tracker.budget(),
+        categories);
+}
+
+bool hasExtension(const char* const path, const char* const extension)
+{
+    return fs::path(path).extension() == extension;
+}
+
+// Writes the linear radiance, ordered top to bottom, as a little-endian PFM.
+void writePfm(
+    const char* const          path,
+    const nlrs::Extent2u       size,
+    std::span<const glm::vec3> radiance)
+{
+    NLRS_ASSERT(radiance.size() == nlrs::area(size));
+    std::FILE* const file = std::fopen(path, "wb");
+    if (!file)
+    {
+        throw std::runtime_error(fmt::format("Failed to open {} for writing.", path));
+    }
+
+    fmt::print(file, "PF\n{} {}\n-1.0\n", size.x, size.y);
+    // PFM rows are stored bottom to top.
+    for (std::uint32_t y = size.y; y-- > 0;)
+    {
+        std::fwrite(&radiance[std::size_t(y) * size.x], sizeof(glm::vec3), size.x, file);
+    }
+
+    std::fclose(file);
+}
+
+int renderHeadless(
+    const nlrs::GpuContext&    gpuContext,
+    const HeadlessOptions&     options,
+    const nlrs::Integrator     integrator,
+    AppState&                  appState,
+    nlrs::ReferencePathTracer& referenceRenderer,
+    nlrs::DeferredRenderer&    deferredRenderer,
+    StartupTimes&              startupTimes)
+{
+    if (!hasExtension(options.outputPath, ".png") && !hasExtension(options.outputPath, ".pfm"))
+    {
+        fmt::print(stderr, "Output file {} must be a .png or .pfm file\n", options.outputPath);
+        return 1;
+    }
+
+    nlrs::OffscreenRenderTarget renderTarget(gpuContext, options.framebufferSize);
+    const nlrs::Extent2u        framebufferSize = renderTarget.size();
+
+    appState.ui.numSamplesPerPixel = static_cast<int>(options.numSamplesPerPixel);
+    appState.cameraController.windowSize() = nlrs::Extent2i(framebufferSize);
+    const std::uint32_t maxFrameCount = options.frameCount.value_or(options.numSamplesPerPixel);
+
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
+    while (!isRendererReady(options.rendererType, referenceRenderer, deferredRenderer))
+    {
+        if (hasRendererFailed(options.rendererType, referenceRenderer, deferredRenderer))
+        {
+            throw std::runtime_error("Failed to compile the renderer's pipelines.");
+        }
+        wgpuDeviceTick(gpuContext.device);
+    }
+    startupTimes.pipelinesReadyMs = startupTimes.elapsedMs();
+
+    const auto    begin = std::chrono::steady_clock::now();
+    std::uint32_t frameCount = 0;
+    if (options.rendererType == RendererType_PathTracer)
+    {
+        referenceRenderer.setRenderParameters(referenceRenderParameters(appState, framebufferSize));
+        while (frameCount < maxFrameCount && referenceRenderer.renderProgressPercentage() < 100.0f)
+        {
+            referenceRenderer.render(gpuContext, renderTarget.textureView(), nullptr);
+            if (frameCount == 0)
+            {
+                startupTimes.firstFrameMs = startupTimes.elapsedMs();
+            }
+            ++frameCount;
+        }
+    }
+    else
+    {
+        const nlrs::RenderDescriptor renderDesc =
+            deferredRenderDescriptor(appState, framebufferSize, renderTarget.textureView());
+        for (; frameCount < maxFrameCount; ++frameCount)
+        {
+            deferredRenderer.render(gpuContext, renderDesc, nullptr);
+            if (frameCount == 0)
+            {
+                startupTimes.firstFrameMs = startupTimes.elapsedMs();
+            }
+        }
+    }
+    startupTimes.print();
+
+    const std::vector<std::uint8_t> pixels = renderTarget.readPixels(gpuContext);
+    const auto                      totalDuration =
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin);
+
+    if (hasExtension(options.outputPath, ".png"))
+    {
+        const int width = static_cast<int>(framebufferSize.x);
+        const int height = static_cast<int>(framebufferSize.y);
+        if (stbi_write_png(options.outputPath, width, height, 4, pixels.data(), 4 * width) == 0)
+        {
+            throw std::runtime_error(fmt::format("Failed to write {}.", options.outputPath));
+        }
+    }
+    else
+    {
+        // The PFM stores the HDR image, instead of the tonemapped display image.
+        const std::vector<glm::vec3> radiance =
+            options.rendererType == RendererType_PathTracer
+                ? referenceRenderer.readRadiance(gpuContext)
+                : deferredRenderer.readRadiance(gpuContext, framebufferSize);
+        writePfm(options.outputPath, framebufferSize, radiance);
+    }
+
+    // The pass durations are summarized over the most recent frames, see the renderers.
+    if (options.rendererType == RendererType_PathTracer)
+    {
+        referenceRenderer.waitForTimestamps(gpuContext);
+        fmt::print(
+            "{{\"renderer\": \"path-tracer\", \"integrator\": \"{}\", \"width\": {}, "
+            "\"height\": {}, \"frames\": {}, \"totalMs\": {:.3f}, \"timeToFirstFrameMs\": {:.3f}, "
+            "\"renderCpuMs\": {:.3f}, \"uploadBytesPerFrame\": {:.0f}, \"renderScale\": {:.3f}, "
+            "\"passes\": {{\"pathTrace\": {}, \"blit\": {}}}, \"gpuMemory\": {}}}\n",
+            integrator == nlrs::Integrator::Wavefront ? "wavefront" : "megakernel",
+            framebufferSize.x,
+            framebufferSize.y,
+            frameCount,
+            totalDuration.count(),
+            startupTimes.firstFrameMs.value_or(0.0f),
+            referenceRenderer.renderCpuDurations().averageMs,
+            referenceRenderer.averageUploadByteSize(),
+            referenceRenderer.renderScale(),
+            durationsJson(referenceRenderer.pathTracePassDurations()),
+            durationsJson(referenceRenderer.blitPassDurations()),
+            gpuMemoryJson());
+    }
+    else
+    {
+        deferredRenderer.waitForTimestamps(gpuContext);
+        const auto perfStats = deferredRenderer.getPerfStats();
+        fmt::print(
+            "{{\"renderer\": \"deferred\", \"width\": {}, \"height\": {}, \"frames\": {}, "
+            "\"totalMs\": {:.3f}, \"timeToFirstFrameMs\": {:.3f}, \"renderCpuMs\": {:.3f}, "
+            "\"uploadBytesPerFrame\": {:.0f}, \"lightingResolution\": \"{}\", "
+            "\"passes\": {{\"gbuffer\": {}, \"lighting\": {}, \"denoise\": {}, \"resolve\": {}}}, "
+            "\"gpuMemory\": {}}}\n",
+            framebufferSize.x,
+            framebufferSize.y,
+            frameCount,
+            totalDuration.count(),
+            startupTimes.firstFrameMs.value_or(0.0f),
+            perfStats.renderCpuDurations.averageMs,
+            perfStats.averageUploadByteSize,
+            nlrs::lightingResolutionName(perfStats.lightingResolution),
+            durationsJson(perfStats.gbufferPassDurations),
+            durationsJson(perfStats.lightingPassDurations),
+            durationsJson(perfStats.denoisePassDurations),
+            durationsJson(perfStats.resolvePassDurations),
+            gpuMemoryJson());
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 try
 {
-    if (argc != 2)
+    StartupTimes startupTimes;
+
+    const std::optional<Options> options = parseOptions(argc, argv);
+    if (!options)
     {
         printHelp();
         return 0;
     }
 
+    nlrs::GpuMemoryTracker::global().setBudget(
+        static_cast<std::uint64_t>(options->gpuMemoryBudgetMiB) << 20);
+
+    if (options->headless)
+    {
+        const HeadlessOptions& headless = *options->headless;
+        nlrs::GpuContext       gpuContext{
+            WGPURequiredLimits{.nextInChain = nullptr, .limits = nlrs::REQUIRED_LIMITS},
+            headless.useFallbackAdapter,
+            options->pipelineCacheDirectory};
+        auto [appState, referenceRenderer, deferredRenderer] = loadRenderers(
+            gpuContext,
+            options->ptFilePath,
+            headless.framebufferSize,
+            nlrs::Extent2i(headless.framebufferSize),
+            headless.workgroupSize,
+            options->integrator,
+            options->bvhBuilder,
+            options->validateBvh,
+            options->traversal,
+            options->useVirtualTextures,
+            options->frameTimeBudgetMs);
+        appState.ui.lightingResolution = static_cast<int>(options->lightingResolution);
+        startupTimes.renderersCreatedMs = startupTimes.elapsedMs();
+        return renderHeadless(
+            gpuContext,
+            headless,
+            options->integrator,
+            appState,
+            referenceRenderer,
+            deferredRenderer,
+            startupTimes);
+    }
+
     nlrs::GpuContext gpuContext{
-        WGPURequiredLimits{.nextInChain = nullptr, .limits = nlrs::REQUIRED_LIMITS}};
+        WGPURequiredLimits{.nextInChain = nullptr, .limits = nlrs::REQUIRED_LIMITS},
+        false,
+        options->pipelineCacheDirectory};
     nlrs::Window window = [&gpuContext]() -> nlrs::Window {
         const nlrs::WindowDescriptor windowDesc{
             .windowSize = nlrs::Extent2i{defaultWindowWidth, defaultWindowHeight},
@@ -121,67 +917,22 @@ try
     }();
 
     nlrs::Gui gui(window.ptr(), gpuContext);
-    auto [appState, referenceRenderer, deferredRenderer] = [&gpuContext, &window, argv]()
-        -> std::tuple<AppState, nlrs::ReferencePathTracer, nlrs::DeferredRenderer> {
-        nlrs::PtFormat ptFormat;
-        {
-            const fs::path path = argv[1];
-            if (!fs::exists(path))
-            {
-                fmt::print(stderr, "File {} does not exist\n", path.string());
-                std::exit(1);
-            }
-            nlrs::InputFileStream file(argv[1]);
-            nlrs::deserialize(file, ptFormat);
-        }
-
-        const nlrs::Extent2i largestResolution = largestMonitorResolution();
-
-        const nlrs::RendererDescriptor rendererDesc{
-            nlrs::RenderParameters{
-                nlrs::Extent2u(window.resolution()),
-                nlrs::FlyCameraController{}.getCamera(),
-                nlrs::SamplingParams(),
-                nlrs::Sky(),
-                1.0f},
-            largestResolution,
-        };
-
-        nlrs::Scene scene{
-            .bvhNodes = ptFormat.bvhNodes,
-            .positionAttributes = ptFormat.trianglePositionAttributes,
-            .vertexAttributes = ptFormat.triangleVertexAttributes,
-            .baseColorTextures = ptFormat.baseColorTextures,
-        };
-
-        nlrs::ReferencePathTracer referenceRenderer{rendererDesc, gpuContext, std::move(scene)};
-
-        nlrs::DeferredRenderer deferredRenderer{
-            gpuContext,
-            nlrs::DeferredRendererDescriptor{
-                .framebufferSize = nlrs::Extent2u(window.resolution()),
-                .maxFramebufferSize = nlrs::Extent2u(largestResolution),
-                .modelPositions = ptFormat.modelVertexPositions,
-                .modelNormals = ptFormat.modelVertexNormals,
-                .modelTexCoords = ptFormat.modelVertexTexCoords,
-                .modelIndices = ptFormat.modelVertexIndices,
-                .modelBaseColorTextureIndices = ptFormat.modelBaseColorTextureIndices,
-                .sceneBaseColorTextures = ptFormat.baseColorTextures,
-                .sceneBvhNodes = ptFormat.bvhNodes,
-                .scenePositionAttributes = ptFormat.trianglePositionAttributes,
-                .sceneVertexAttributes = ptFormat.triangleVertexAttributes}};
-
-        AppState app{
-            .cameraController{},
-            .bvhNodes = std::move(ptFormat.bvhNodes),
-            .positions = std::move(ptFormat.bvhPositionAttributes),
-            .ui = UiState{},
-            .focusPressed = false,
-        };
-
-        return std::make_tuple(
-            std::move(app), std::move(referenceRenderer), std::move(deferredRenderer));
-    }();
+    auto [appState, referenceRenderer, deferredRenderer] = loadRenderers(
+        gpuContext,
+        options->ptFilePath,
+        nlrs::Extent2u(window.resolution()),
+        largestMonitorResolution(),
+        defaultWorkgroupSize,
+        options->integrator,
+        options->bvhBuilder,
+        options->validateBvh,
+        options->traversal,
+        options->useVirtualTextures,
+        options->frameTimeBudgetMs);
+    // The bounce counts of the GUI's radio buttons.
+    referenceRenderer.specializeBounceCounts(std::array<std::uint32_t, 3>{2, 4, 8});
+    appState.ui.lightingResolution = static_cast<int>(options->lightingResolution);
+    startupTimes.renderersCreatedMs = startupTimes.elapsedMs();
 
     auto onNewFrame = [&gui]() -> void { gui.beginFrame(); };
 
@@ -240,6 +991,15 @@ try
             ImGui::RadioButton("deferred", &appState.ui.rendererType, RendererType_Deferred);
             ImGui::SameLine();
             ImGui::RadioButton("debug", &appState.ui.rendererType, RendererType_Debug);
+            if (hasRendererFailed(appState.ui.rendererType, referenceRenderer, deferredRenderer))
+            {
+                ImGui::Text("failed to compile pipelines, see the log");
+            }
+            else if (!isRendererReady(
+                         appState.ui.rendererType, referenceRenderer, deferredRenderer))
+            {
+                ImGui::Text("compiling pipelines...");
+            }
             ImGui::Separator();
 
             ImGui::Text("Perf stats");
@@ -248,30 +1008,30 @@ try
                 {
                 case RendererType_PathTracer:
                 {
-                    const float renderAverageMs = referenceRenderer.averageRenderpassDurationMs();
                     const float progressPercentage = referenceRenderer.renderProgressPercentage();
+                    durationsText("path trace pass", referenceRenderer.pathTracePassDurations());
+                    durationsText("blit pass", referenceRenderer.blitPassDurations());
+                    durationsText("render cpu", referenceRenderer.renderCpuDurations());
                     ImGui::Text(
-                        "render pass: %.2f ms (%.1f FPS)",
-                        renderAverageMs,
-                        1000.0f / renderAverageMs);
+                        "uploads: %.1f KiB/frame",
+                        referenceRenderer.averageUploadByteSize() / 1024.0f);
                     ImGui::Text("render progress: %.2f %%", progressPercentage);
+                    ImGui::Text("render scale: %.1f %%", 100.0f * referenceRenderer.renderScale());
                     break;
                 }
                 case RendererType_Deferred:
                 {
                     const auto perfStats = deferredRenderer.getPerfStats();
+                    durationsText("gbuffer pass", perfStats.gbufferPassDurations);
+                    durationsText("lighting pass", perfStats.lightingPassDurations);
+                    durationsText("denoise pass", perfStats.denoisePassDurations);
+                    durationsText("resolve pass", perfStats.resolvePassDurations);
+                    durationsText("render cpu", perfStats.renderCpuDurations);
                     ImGui::Text(
-                        "gbuffer pass: %.2f ms (%.1f FPS)",
-                        perfStats.averageGbufferPassDurationsMs,
-                        1000.0f / perfStats.averageGbufferPassDurationsMs);
-                    ImGui::Text(
-                        "lighting pass: %.2f ms (%.1f FPS)",
-                        perfStats.averageLightingPassDurationsMs,
-                        1000.0f / perfStats.averageLightingPassDurationsMs);
+                        "uploads: %.1f KiB/frame", perfStats.averageUploadByteSize / 1024.0f);
                     ImGui::Text(
-                        "resolve pass: %.2f ms (%.1f FPS)",
-                        perfStats.averageResolvePassDurationsMs,
-                        1000.0f / perfStats.averageResolvePassDurationsMs);
+                        "lighting resolution: %s",
+                        nlrs::lightingResolutionName(perfStats.lightingResolution));
                     break;
                 }
                 default:
@@ -281,6 +1041,34 @@ try
 
             ImGui::Separator();
 
+            ImGui::Text("GPU memory");
+            {
+                const nlrs::GpuMemoryTracker& tracker = nlrs::GpuMemoryTracker::global();
+                const auto toMiB = [](const std::uint64_t byteSize) -> float {
+                    return static_cast<float>(byteSize) / static_cast<float>(1 << 20);
+                };
+                ImGui::Text(
+                    "total: %.1f MiB (peak %.1f MiB)",
+                    toMiB(tracker.totalUsage().byteSize),
+                    toMiB(tracker.totalUsage().peakByteSize));
+                if (tracker.budget() > 0)
+                {
+                    ImGui::Text("budget: %.1f MiB", toMiB(tracker.budget()));
+                }
+                for (std::size_t idx = 0; idx < nlrs::GPU_MEMORY_CATEGORY_COUNT; ++idx)
+                {
+                    const auto category = static_cast<nlrs::GpuMemoryCategory>(idx);
+                    const auto usage = tracker.categoryUsage(category);
+                    ImGui::Text(
+                        "%s: %.1f MiB (peak %.1f MiB)",
+                        nlrs::gpuMemoryCategoryName(category),
+                        toMiB(usage.byteSize),
+                        toMiB(usage.peakByteSize));
+                }
+            }
+
+            ImGui::Separator();
+
             ImGui::Text("Parameters");
 
             ImGui::Text("num samples:");
@@ -299,6 +1087,31 @@ try
             ImGui::SameLine();
             ImGui::RadioButton("8", &appState.ui.numBounces, 8);
 
+            // With a frame time budget, the deferred renderer chooses the lighting resolution, so
+            // the buttons are disabled and show the renderer's choice.
+            {
+                const auto perfStats = deferredRenderer.getPerfStats();
+                const bool isDynamic = perfStats.isDynamicResolution;
+                int        dynamicLightingResolution =
+                    static_cast<int>(perfStats.lightingResolution);
+                int* const lightingResolution =
+                    isDynamic ? &dynamicLightingResolution : &appState.ui.lightingResolution;
+                ImGui::Text("lighting resolution%s:", isDynamic ? " (dynamic)" : "");
+                ImGui::BeginDisabled(isDynamic);
+                ImGui::SameLine();
+                ImGui::RadioButton(
+                    "full", lightingResolution, static_cast<int>(nlrs::LightingResolution::Full));
+                ImGui::SameLine();
+                ImGui::RadioButton(
+                    "half", lightingResolution, static_cast<int>(nlrs::LightingResolution::Half));
+                ImGui::SameLine();
+                ImGui::RadioButton(
+                    "checkerboard",
+                    lightingResolution,
+                    static_cast<int>(nlrs::LightingResolution::Checkerboard));
+                ImGui::EndDisabled();
+            }
+
             ImGui::SliderFloat("sun zenith", &appState.ui.sunZenithDegrees, 0.0f, 90.0f, "%.2f");
             ImGui::SliderFloat("sun azimuth", &appState.ui.sunAzimuthDegrees, 0.0f, 360.0f, "%.2f");
             ImGui::SliderFloat("sky turbidity", &appState.ui.skyTurbidity, 1.0f, 10.0f, "%.2f");
@@ -338,8 +1151,12 @@ try
         }
     };
 
-    auto onRender = [&appState, &gpuContext, &gui, &referenceRenderer, &deferredRenderer](
-                        GLFWwindow* windowPtr, WGPUSwapChain swapChain) -> void {
+    auto onRender = [&appState,
+                     &gpuContext,
+                     &gui,
+                     &referenceRenderer,
+                     &deferredRenderer,
+                     &startupTimes](GLFWwindow* windowPtr, WGPUSwapChain swapChain) -> void {
         const WGPUTextureView targetTextureView = wgpuSwapChainGetCurrentTextureView(swapChain);
         if (!targetTextureView)
         {
@@ -348,49 +1165,35 @@ try
             return;
         }
 
+        // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
+        wgpuDeviceTick(gpuContext.device);
+        if (!isRendererReady(appState.ui.rendererType, referenceRenderer, deferredRenderer))
+        {
+            renderPlaceholderFrame(gpuContext, targetTextureView, gui);
+            wgpuTextureViewRelease(targetTextureView);
+            return;
+        }
+        if (!startupTimes.pipelinesReadyMs)
+        {
+            startupTimes.pipelinesReadyMs = startupTimes.elapsedMs();
+        }
+
         nlrs::Extent2i windowResolution;
         glfwGetFramebufferSize(windowPtr, &windowResolution.x, &windowResolution.y);
-        NLRS_ASSERT(appState.ui.exposureStops >= 0);
-        const nlrs::RenderParameters renderParams{
-            nlrs::Extent2u(windowResolution),
-            appState.cameraController.getCamera(),
-            nlrs::SamplingParams{
-                static_cast<std::uint32_t>(appState.ui.numSamplesPerPixel),
-                static_cast<std::uint32_t>(appState.ui.numBounces),
-            },
-            nlrs::Sky{
-                appState.ui.skyTurbidity,
-                appState.ui.skyAlbedo,
-                appState.ui.sunZenithDegrees,
-                appState.ui.sunAzimuthDegrees,
-            },
-            1.0f / std::exp2(static_cast<float>(appState.ui.exposureStops))};
-        referenceRenderer.setRenderParameters(renderParams);
+        const nlrs::Extent2u framebufferSize(windowResolution);
+        referenceRenderer.setRenderParameters(referenceRenderParameters(appState, framebufferSize));
 
         switch (appState.ui.rendererType)
         {
         case RendererType_PathTracer:
-            referenceRenderer.render(gpuContext, targetTextureView, gui);
+            referenceRenderer.render(gpuContext, targetTextureView, &gui);
             break;
         case RendererType_Deferred:
-        {
-            NLRS_ASSERT(appState.ui.exposureStops >= 0);
-            const nlrs::RenderDescriptor renderDesc{
-                appState.cameraController.viewReverseZProjectionMatrix(),
-                appState.cameraController.position(),
-                nlrs::Sky{
-                    appState.ui.skyTurbidity,
-                    appState.ui.skyAlbedo,
-                    appState.ui.sunZenithDegrees,
-                    appState.ui.sunAzimuthDegrees,
-                },
-                nlrs::Extent2u(windowResolution),
-                1.0f / std::exp2(static_cast<float>(appState.ui.exposureStops)),
-                targetTextureView,
-            };
-            deferredRenderer.render(gpuContext, renderDesc, gui);
+            deferredRenderer.render(
+                gpuContext,
+                deferredRenderDescriptor(appState, framebufferSize, targetTextureView),
+                &gui);
             break;
-        }
         case RendererType_Debug:
         {
             deferredRenderer.renderDebug(
@@ -398,12 +1201,18 @@ try
                 appState.cameraController.viewReverseZProjectionMatrix(),
                 nlrs::Extent2f(windowResolution),
                 targetTextureView,
-                gui);
+                &gui);
             break;
         }
         }
 
         wgpuTextureViewRelease(targetTextureView);
+
+        if (!startupTimes.firstFrameMs)
+        {
+            startupTimes.firstFrameMs = startupTimes.elapsedMs();
+            startupTimes.print();
+        }
     };
 
     auto onResize = [&gpuContext, &deferredRenderer](const nlrs::FramebufferSize newSize) -> void {
@@ -0,0 +1,187 @@
+#include "gpu_context.hpp"
+#include "offscreen_render_target.hpp"
+#include "webgpu_utils.hpp"
+#include "window.hpp"
+
+#include <common/assert.hpp>
+
+#include <cstddef>
+#include <stdexcept>
+
+namespace nlrs
+{
+namespace
+{
+constexpr std::uint32_t BYTES_PER_PIXEL = 4;
+constexpr std::uint32_t COPY_BYTES_PER_ROW_ALIGNMENT = 256;
+
+std::uint32_t paddedBytesPerRow(const std::uint32_t width)
+{
+    const std::uint32_t bytesPerRow = width * BYTES_PER_PIXEL;
+    return (bytesPerRow + COPY_BYTES_PER_ROW_ALIGNMENT - 1) / COPY_BYTES_PER_ROW_ALIGNMENT *
+           COPY_BYTES_PER_ROW_ALIGNMENT;
+}
+
+struct MapResult
+{
+    WGPUBufferMapAsyncStatus status = WGPUBufferMapAsyncStatus_Unknown;
+    bool                     done = false;
+};
+} // namespace
+
+OffscreenRenderTarget::OffscreenRenderTarget(const GpuContext& gpuContext, const Extent2u& size)
+    : mTexture(nullptr),
+      mTextureView(nullptr),
+      mTextureAllocation(
+          "Offscreen render target",
+          GpuMemoryCategory::Other,
+          std::uint64_t(BYTES_PER_PIXEL) * size.x * size.y),
+      mReadbackBuffer(),
+      mSize(size),
+      mPaddedBytesPerRow(paddedBytesPerRow(size.x))
+{
+    NLRS_ASSERT(size.x > 0 && size.y > 0);
+
+    constexpr WGPUTextureFormat format = Window::SWAP_CHAIN_FORMAT;
+
+    const WGPUTextureDescriptor textureDesc{
+        .nextInChain = nullptr,
+        .label = "Offscreen render target",
+        .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+        .dimension = WGPUTextureDimension_2D,
+        .size = {size.x, size.y, 1},
+        .format = format,
+        .mipLevelCount = 1,
+        .sampleCount = 1,
+        .viewFormatCount = 1,
+        .viewFormats = &format,
+    };
+    mTexture = wgpuDeviceCreateTexture(gpuContext.device, &textureDesc);
+    if (!mTexture)
+    {
+        throw std::runtime_error("Failed to create offscreen render target texture.");
+    }
+
+    const WGPUTextureViewDescriptor viewDesc{
+        .nextInChain = nullptr,
+        .label = "Offscreen render target view",
+        .format = format,
+        .dimension = WGPUTextureViewDimension_2D,
+        .baseMipLevel = 0,
+        .mipLevelCount = 1,
+        .baseArrayLayer = 0,
+        .arrayLayerCount = 1,
+        .aspect = WGPUTextureAspect_All,
+    };
+    mTextureView = wgpuTextureCreateView(mTexture, &viewDesc);
+    NLRS_ASSERT(mTextureView != nullptr);
+
+    mReadbackBuffer = GpuBuffer(
+        gpuContext.device,
+        "Offscreen render target readback buffer",
+        {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
+        static_cast<std::size_t>(mPaddedBytesPerRow) * size.y,
+        GpuMemoryCategory::Staging);
+}
+
+OffscreenRenderTarget::~OffscreenRenderTarget()
+{
+    textureViewSafeRelease(mTextureView);
+    mTextureView = nullptr;
+    textureSafeRelease(mTexture);
+    mTexture = nullptr;
+}
+
+std::vector<std::uint8_t> OffscreenRenderTarget::readPixels(const GpuContext& gpuContext)
+{
+    const WGPUCommandEncoder encoder = [&gpuContext]() {
+        const WGPUCommandEncoderDescriptor cmdEncoderDesc{
+            .nextInChain = nullptr,
+            .label = "Offscreen readback command encoder",
+        };
+        return wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
+    }();
+
+    {
+        const WGPUImageCopyTexture source{
+            .nextInChain = nullptr,
+            .texture = mTexture,
+            .mipLevel = 0,
+            .origin = {0, 0, 0},
+            .aspect = WGPUTextureAspect_All,
+        };
+        const WGPUImageCopyBuffer destination{
+            .nextInChain = nullptr,
+            .layout =
+                WGPUTextureDataLayout{
+                    .nextInChain = nullptr,
+                    .offset = 0,
+                    .bytesPerRow = mPaddedBytesPerRow,
+                    .rowsPerImage = mSize.y,
+                },
+            .buffer = mReadbackBuffer.ptr(),
+        };
+        const WGPUExtent3D copySize{.width = mSize.x, .height = mSize.y, .depthOrArrayLayers = 1};
+        wgpuCommandEncoderCopyTextureToBuffer(encoder, &source, &destination, &copySize);
+    }
+
+    const WGPUCommandBuffer cmdBuffer = [encoder]() {
+        const WGPUCommandBufferDescriptor cmdBufferDesc{
+            .nextInChain = nullptr,
+            .label = "Offscreen readback command buffer",
+        };
+        return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    }();
+    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+
+    MapResult mapResult;
+    wgpuBufferMapAsync(
+        mReadbackBuffer.ptr(),
+        WGPUMapMode_Read,
+        0,
+        mReadbackBuffer.byteSize(),
+        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+            NLRS_ASSERT(userdata != nullptr);
+            MapResult& result = *static_cast<MapResult*>(userdata);
+            result.status = status;
+            result.done = true;
+        },
+        &mapResult);
+
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
+    while (!mapResult.done)
+    {
+        wgpuDeviceTick(gpuContext.device);
+    }
+
+    if (mapResult.status != WGPUBufferMapAsyncStatus_Success)
+    {
+        throw std::runtime_error("Failed to map offscreen render target readback buffer.");
+    }
+
+    const auto* const mappedData = static_cast<const std::uint8_t*>(
+        wgpuBufferGetConstMappedRange(mReadbackBuffer.ptr(), 0, mReadbackBuffer.byteSize()));
+    NLRS_ASSERT(mappedData != nullptr);
+
+    static_assert(Window::SWAP_CHAIN_FORMAT == WGPUTextureFormat_BGRA8Unorm);
+    std::vector<std::uint8_t> pixels(std::size_t(mSize.x) * mSize.y * BYTES_PER_PIXEL);
+    for (std::uint32_t y = 0; y < mSize.y; ++y)
+    {
+        const std::uint8_t* const srcRow = mappedData + std::size_t(y) * mPaddedBytesPerRow;
+        std::uint8_t* const dstRow = pixels.data() + std::size_t(y) * mSize.x * BYTES_PER_PIXEL;
+        for (std::uint32_t x = 0; x < mSize.x; ++x)
+        {
+            const std::uint8_t* const src = srcRow + x * BYTES_PER_PIXEL;
+            std::uint8_t* const       dst = dstRow + x * BYTES_PER_PIXEL;
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = src[3];
+        }
+    }
+
+    wgpuBufferUnmap(mReadbackBuffer.ptr());
+
+    return pixels;
+}
+} // namespace nlrs
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "gpu_buffer.hpp"
+
+#include <common/extent.hpp>
+
+#include <webgpu/webgpu.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace nlrs
+{
+struct GpuContext;
+
+// A render target for rendering without a window or swap chain. The target has the swap chain
+// format, so that the renderers' pipelines can draw into it as is.
+class OffscreenRenderTarget
+{
+public:
+    OffscreenRenderTarget(const GpuContext&, const Extent2u& size);
+    ~OffscreenRenderTarget();
+
+    OffscreenRenderTarget(const OffscreenRenderTarget&) = delete;
+    OffscreenRenderTarget& operator=(const OffscreenRenderTarget&) = delete;
+
+    OffscreenRenderTarget(OffscreenRenderTarget&&) = delete;
+    OffscreenRenderTarget& operator=(OffscreenRenderTarget&&) = delete;
+
+    WGPUTextureView textureView() const { return mTextureView; }
+    const Extent2u& size() const { return mSize; }
+
+    // Copies the target to a mapped buffer and blocks until the copy has completed. Returns tightly
+    // packed RGBA8 pixels, top row first.
+    std::vector<std::uint8_t> readPixels(const GpuContext&);
+
+private:
+    WGPUTexture         mTexture;
+    WGPUTextureView     mTextureView;
+    GpuMemoryAllocation mTextureAllocation;
+    GpuBuffer           mReadbackBuffer;
+    Extent2u            mSize;
+    // Texture to buffer copies require the rows to be aligned to 256 bytes.
+    std::uint32_t mPaddedBytesPerRow;
+};
+} // namespace nlrs
@@ -0,0 +1,134 @@
+#include "pipeline_disk_cache.hpp"
+
+#include <common/assert.hpp>
+
+#include <fmt/core.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace nlrs
+{
+namespace
+{
+// FNV-1a. Hash collisions are detected by storing the full key in the entry.
+std::uint64_t hashKey(const void* const key, const std::size_t keySize)
+{
+    const auto*   bytes = static_cast<const unsigned char*>(key);
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (std::size_t i = 0; i < keySize; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+} // namespace
+
+PipelineDiskCache::PipelineDiskCache(std::filesystem::path directory)
+    : mDirectory(std::move(directory)),
+      mMutex()
+{
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    if (error)
+    {
+        throw std::runtime_error(fmt::format(
+            "Failed to create pipeline cache directory {}: {}",
+            mDirectory.string(),
+            error.message()));
+    }
+}
+
+// An entry is stored as the key size, the key, and the blob.
+std::size_t PipelineDiskCache::loadData(
+    const void* const key,
+    const std::size_t keySize,
+    void* const       value,
+    const std::size_t valueSize,
+    void* const       userdata)
+{
+    NLRS_ASSERT(userdata != nullptr);
+    PipelineDiskCache&                cache = *static_cast<PipelineDiskCache*>(userdata);
+    const std::lock_guard<std::mutex> lock(cache.mMutex);
+
+    std::ifstream file(cache.entryPath(key, keySize), std::ios::binary);
+    if (!file)
+    {
+        return 0;
+    }
+    const std::vector<char> entry{
+        std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    std::uint64_t entryKeySize = 0;
+    if (entry.size() < sizeof(entryKeySize))
+    {
+        return 0;
+    }
+    std::memcpy(&entryKeySize, entry.data(), sizeof(entryKeySize));
+    const std::size_t blobOffset = sizeof(entryKeySize) + keySize;
+    if (entryKeySize != keySize || entry.size() < blobOffset ||
+        std::memcmp(entry.data() + sizeof(entryKeySize), key, keySize) != 0)
+    {
+        return 0;
+    }
+
+    const std::size_t blobSize = entry.size() - blobOffset;
+    if (value != nullptr && valueSize >= blobSize)
+    {
+        std::memcpy(value, entry.data() + blobOffset, blobSize);
+    }
+    return blobSize;
+}
+
+void PipelineDiskCache::storeData(
+    const void* const key,
+    const std::size_t keySize,
+    const void* const value,
+    const std::size_t valueSize,
+    void* const       userdata)
+{
+    NLRS_ASSERT(userdata != nullptr);
+    PipelineDiskCache&                cache = *static_cast<PipelineDiskCache*>(userdata);
+    const std::lock_guard<std::mutex> lock(cache.mMutex);
+
+    // The entry is written to a temporary file first, so that a partially written entry is never
+    // loaded, e.g. if the process exits while writing.
+    const std::filesystem::path path = cache.entryPath(key, keySize);
+    std::filesystem::path       tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::fprintf(stderr, "Failed to write pipeline cache entry %s\n", path.c_str());
+            return;
+        }
+        const std::uint64_t entryKeySize = keySize;
+        file.write(reinterpret_cast<const char*>(&entryKeySize), sizeof(entryKeySize));
+        file.write(static_cast<const char*>(key), static_cast<std::streamsize>(keySize));
+        file.write(static_cast<const char*>(value), static_cast<std::streamsize>(valueSize));
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error)
+    {
+        std::fprintf(stderr, "Failed to write pipeline cache entry %s\n", path.c_str());
+    }
+}
+
+std::filesystem::path PipelineDiskCache::entryPath(
+    const void* const key,
+    const std::size_t keySize) const
+{
+    return mDirectory / fmt::format("{:016x}.bin", hashKey(key, keySize));
+}
+} // namespace nlrs
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+
+namespace nlrs
+{
+// Stores the blobs which Dawn caches while compiling pipelines, e.g. the backend shader binaries,
+// as files in a directory, so that later runs skip most of the shader compilation. The cache is
+// installed by chaining a `WGPUDawnCacheDeviceDescriptor` with `loadData` and `storeData` into the
+// device descriptor. Dawn may call them from its worker threads.
+class PipelineDiskCache
+{
+public:
+    explicit PipelineDiskCache(std::filesystem::path directory);
+
+    PipelineDiskCache(const PipelineDiskCache&) = delete;
+    PipelineDiskCache& operator=(const PipelineDiskCache&) = delete;
+
+    // Returns the size of the blob stored for `key`, or zero if there is none. The blob is only
+    // copied to `value` if `valueSize` is large enough to hold it.
+    static std::size_t loadData(
+        const void* key,
+        std::size_t keySize,
+        void*       value,
+        std::size_t valueSize,
+        void*       userdata);
+    static void storeData(
+        const void* key,
+        std::size_t keySize,
+        const void* value,
+        std::size_t valueSize,
+        void*       userdata);
+
+private:
+    std::filesystem::path entryPath(const void* key, std::size_t keySize) const;
+
+    std::filesystem::path mDirectory;
+    std::mutex            mMutex;
+};
+} // namespace nlrs
@@ -0,0 +1,130 @@
+// sort pass bind group
+@group(0) @binding(0) var<uniform> sortParams: SortParams;
+@group(0) @binding(1) var<storage, read> keysIn: array<u32>;
+@group(0) @binding(2) var<storage, read> valuesIn: array<u32>;
+@group(0) @binding(3) var<storage, read_write> keysOut: array<u32>;
+@group(0) @binding(4) var<storage, read_write> valuesOut: array<u32>;
+@group(0) @binding(5) var<storage, read_write> digitCounts: array<u32>;
+
+// A least significant digit radix sort of u32 keys and values, which sorts 8 bits per pass. Each
+// workgroup sorts a tile of WORKGROUP_SIZE keys. A pass counts the digits of each tile, scans the
+// counts in digit-major order to find each tile's output offset for each digit, and scatters the
+// keys. The scatter preserves the order of equal digits, so that the passes compose into a stable
+// sort.
+
+// Matches `RADIX_SORT_WORKGROUP_SIZE` in gpu_bvh_builder.cpp. There is one digit bin per
+// invocation.
+const WORKGROUP_SIZE = 256u;
+const RADIX_MASK = 0xffu;
+const NO_DIGIT = 0xffffffffu;
+
+struct SortParams {
+    keyCount: u32,
+    shift: u32,
+    tileCount: u32,
+    pad: u32,
+}
+
+var<workgroup> tileDigitCounts: array<atomic<u32>, WORKGROUP_SIZE>;
+var<workgroup> tileDigits: array<u32, WORKGROUP_SIZE>;
+var<workgroup> tileDigitOffsets: array<u32, WORKGROUP_SIZE>;
+var<workgroup> chunkSums: array<u32, WORKGROUP_SIZE>;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn countDigits(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let tileIdx = workgroupId.x + workgroupId.y * numWorkgroups.x;
+    if tileIdx >= sortParams.tileCount {
+        return;
+    }
+
+    // Workgroup memory is zero-initialized.
+    let keyIdx = tileIdx * WORKGROUP_SIZE + localIdx;
+    if keyIdx < sortParams.keyCount {
+        atomicAdd(&tileDigitCounts[keyDigit(keysIn[keyIdx])], 1u);
+    }
+    workgroupBarrier();
+
+    let digitCount = atomicLoad(&tileDigitCounts[localIdx]);
+    digitCounts[localIdx * sortParams.tileCount + tileIdx] = digitCount;
+}
+
+// Replaces the digit counts with their exclusive prefix sum. A single workgroup scans all counts:
+// each invocation sums a contiguous chunk of counts, the chunk sums are scanned in workgroup
+// memory, and each invocation then scans its own chunk.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scanDigitCounts(@builtin(local_invocation_index) localIdx: u32) {
+    let countCount = WORKGROUP_SIZE * sortParams.tileCount;
+    let chunkSize = (countCount + WORKGROUP_SIZE - 1u) / WORKGROUP_SIZE;
+    let chunkBegin = min(localIdx * chunkSize, countCount);
+    let chunkEnd = min(chunkBegin + chunkSize, countCount);
+
+    var chunkSum = 0u;
+    for (var idx = chunkBegin; idx < chunkEnd; idx += 1u) {
+        chunkSum += digitCounts[idx];
+    }
+    chunkSums[localIdx] = chunkSum;
+    workgroupBarrier();
+
+    // Hillis-Steele inclusive scan of the chunk sums.
+    for (var offset = 1u; offset < WORKGROUP_SIZE; offset *= 2u) {
+        var sum = chunkSums[localIdx];
+        if localIdx >= offset {
+            sum += chunkSums[localIdx - offset];
+        }
+        workgroupBarrier();
+        chunkSums[localIdx] = sum;
+        workgroupBarrier();
+    }
+
+    var prefix = chunkSums[localIdx] - chunkSum;
+    for (var idx = chunkBegin; idx < chunkEnd; idx += 1u) {
+        let count = digitCounts[idx];
+        digitCounts[idx] = prefix;
+        prefix += count;
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scatter(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let tileIdx = workgroupId.x + workgroupId.y * numWorkgroups.x;
+    if tileIdx >= sortParams.tileCount {
+        return;
+    }
+
+    let keyIdx = tileIdx * WORKGROUP_SIZE + localIdx;
+    let isKey = keyIdx < sortParams.keyCount;
+    var key = 0u;
+    var digit = NO_DIGIT;
+    if isKey {
+        key = keysIn[keyIdx];
+        digit = keyDigit(key);
+    }
+    tileDigits[localIdx] = digit;
+    tileDigitOffsets[localIdx] = digitCounts[localIdx * sortParams.tileCount + tileIdx];
+    workgroupBarrier();
+
+    if isKey {
+        // Ranking the key among the equal digits which precede it in the tile keeps the sort
+        // stable.
+        var rank = 0u;
+        for (var idx = 0u; idx < localIdx; idx += 1u) {
+            rank += select(0u, 1u, tileDigits[idx] == digit);
+        }
+        let dstIdx = tileDigitOffsets[digit] + rank;
+        keysOut[dstIdx] = key;
+        valuesOut[dstIdx] = valuesIn[keyIdx];
+    }
+}
+
+@must_use
+fn keyDigit(key: u32) -> u32 {
+    return (key >> sortParams.shift) & RADIX_MASK;
+}
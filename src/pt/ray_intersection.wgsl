@@ -0,0 +1,219 @@
+// Ray-primitive intersection and BVH visibility queries. The including shader declares the
+// `bvhNodes` and `positionAttributes` bindings.
+
+const T_MIN = 0.001f;
+// The maximum ray extent. Specializing it lets the compiler fold it into the traversal.
+override T_MAX: f32 = 10000f;
+
+struct Ray {
+    origin: vec3f,
+    direction: vec3f
+}
+
+struct Aabb {
+    min: vec3f,
+    max: vec3f,
+}
+
+struct BvhNode {
+    aabb: Aabb,
+    trianglesOffset: u32,
+    secondChildOffset: u32,
+    triangleCount: u32,
+    splitAxis: u32,
+}
+
+struct Positions {
+    p0: vec3f,
+    p1: vec3f,
+    p2: vec3f,
+}
+
+struct VertexAttributes {
+    n0: vec3f,
+    n1: vec3f,
+    n2: vec3f,
+
+    uv0: vec2f,
+    uv1: vec2f,
+    uv2: vec2f,
+
+    textureDescriptorIdx: u32,
+}
+
+struct Intersection {
+    p: vec3f,
+    n: vec3f,
+    uv: vec2f,
+    textureDescriptorIdx: u32,
+}
+
+struct TriangleHit {
+    p: vec3f,
+    b: vec3f,
+    t: f32,
+}
+
+// Returns 1.0 if no forward intersections, 0.0 otherwise.
+@must_use
+fn shadowRay(ray: Ray, rayTMax: f32) -> f32 {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, rayTMax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    // TODO: trihit not actually used. A different code path could be used?
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, rayTMax, &trihit) {
+                        return 0f;
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return 1f;
+}
+
+struct RayAabbIntersector {
+    origin: vec3f,
+    invDir: vec3f,
+    dirNeg: vec3u,
+}
+
+@must_use
+fn rayAabbIntersector(ray: Ray) -> RayAabbIntersector {
+    let invDirection = vec3f(1f / ray.direction.x, 1f / ray.direction.y, 1f / ray.direction.z);
+    return RayAabbIntersector(
+        ray.origin,
+        invDirection,
+        vec3u(select(0u, 1u, (invDirection.x < 0f)), select(0u, 1u, (invDirection.y < 0f)), select(0u, 1u, (invDirection.z < 0f)))
+    );
+}
+
+@must_use
+fn rayIntersectAabb(intersector: RayAabbIntersector, aabb: Aabb, rayTMax: f32) -> bool {
+    let bounds: array<vec3f, 2> = array(aabb.min, aabb.max);
+
+    var tmin: f32 = (bounds[intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+    var tmax: f32 = (bounds[1u - intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+
+    let tymin: f32 = (bounds[intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+    let tymax: f32 = (bounds[1 - intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+
+    if (tmin > tymax) || (tymin > tmax) {
+        return false;
+    }
+
+    tmin = max(tymin, tmin);
+    tmax = min(tymax, tmax);
+
+    let tzmin: f32 = (bounds[intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+    let tzmax: f32 = (bounds[1 - intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+
+    if (tmin > tzmax) || (tzmin > tmax) {
+        return false;
+    }
+
+    tmin = max(tzmin, tmin);
+    tmax = min(tzmax, tmax);
+
+    return (tmin < rayTMax) && (tmax > 0.0);
+}
+
+@must_use
+fn rayIntersectTriangle(ray: Ray, tri: Positions, tmax: f32, hit: ptr<function, TriangleHit>) -> bool {
+    // Mäller-Trumbore algorithm
+    // https://en.wikipedia.org/wiki/Möller–Trumbore_intersection_algorithm
+    let e1 = tri.p1 - tri.p0;
+    let e2 = tri.p2 - tri.p0;
+
+    let h = cross(ray.direction, e2);
+    let det = dot(e1, h);
+
+    if det > -EPSILON && det < EPSILON {
+        return false;
+    }
+
+    let invDet = 1.0f / det;
+    let s = ray.origin - tri.p0;
+    let u = invDet * dot(s, h);
+
+    if u < 0.0f || u > 1.0f {
+        return false;
+    }
+
+    let q = cross(s, e1);
+    let v = invDet * dot(ray.direction, q);
+
+    if v < 0.0f || u + v > 1.0f {
+        return false;
+    }
+
+    let t = invDet * dot(e2, q);
+
+    if t > EPSILON && t < tmax {
+        // https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection.html
+        // e1 = v1 - v0
+        // e2 = v2 - v0
+        // -> p = v0 + u * e1 + v * e2
+        let p = tri.p0 + u * e1 + v * e2;
+        let n = normalize(cross(e1, e2));
+        let b = vec3f(1f - u - v, u, v);
+        *hit = TriangleHit(offsetRay(p, n), b, t);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+const ORIGIN = 1f / 32f;
+const FLOAT_SCALE = 1f / 65536f;
+const INT_SCALE = 256f;
+
+@must_use
+fn offsetRay(p: vec3f, n: vec3f) -> vec3f {
+    // Source: A Fast and Robust Method for Avoiding Self-Intersection, Ray Tracing Gems
+    let offset = vec3i(i32(INT_SCALE * n.x), i32(INT_SCALE * n.y), i32(INT_SCALE * n.z));
+    // Offset added straight into the mantissa bits to ensure the offset is scale-invariant,
+    // except for when close to the origin, where we use FLOAT_SCALE as a small epsilon.
+    let po = vec3f(
+        bitcast<f32>(bitcast<i32>(p.x) + select(offset.x, -offset.x, (p.x < 0))),
+        bitcast<f32>(bitcast<i32>(p.y) + select(offset.y, -offset.y, (p.y < 0))),
+        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0)))
+    );
+
+    return vec3f(
+        select(po.x, p.x + FLOAT_SCALE * n.x, (abs(p.x) < ORIGIN)),
+        select(po.y, p.y + FLOAT_SCALE * n.y, (abs(p.y) < ORIGIN)),
+        select(po.z, p.z + FLOAT_SCALE * n.z, (abs(p.z) < ORIGIN))
+    );
+}
@@ -1,5 +1,6 @@
 #include "blue_noise.h"
 #include "gpu_bind_group_layout.hpp"
+#include "gpu_bvh_builder.hpp"
 #include "gpu_context.hpp"
 #include "gpu_limits.hpp"
 #include "gui.hpp"
@@ -10,6 +11,8 @@
 
 #include <common/bvh.hpp>
 #include <common/gltf_model.hpp>
+#include <common/ray_intersection.hpp>
+#include <common/texture_layout.hpp>
 
 #include <fmt/core.h>
 #include <glm/glm.hpp>
@@ -18,12 +21,12 @@
 #include <algorithm>
 #include <bit>
 #include <cassert>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
-#include <cstring>
 #include <cstdio>
-#include <deque>
+#include <cstring>
 #include <numbers>
-#include <numeric>
 #include <span>
 #include <stdexcept>
 #include <utility>
@@ -32,6 +35,12 @@ namespace nlrs
 {
 namespace
 {
+struct MapResult
+{
+    WGPUBufferMapAsyncStatus status = WGPUBufferMapAsyncStatus_Unknown;
+    bool                     done = false;
+};
+
 struct FrameDataLayout
 {
     Extent2u      dimensions;
@@ -121,11 +130,73 @@ struct RenderParamsLayout
 
 struct TimestampsLayout
 {
-    std::uint64_t renderPassBegin;
-    std::uint64_t renderPassEnd;
+    std::uint64_t pathTracePassBegin;
+    std::uint64_t pathTracePassEnd;
+    std::uint64_t blitPassBegin;
+    std::uint64_t blitPassEnd;
+
+    static constexpr std::uint32_t MEMBER_SIZE = sizeof(std::uint64_t);
+    static constexpr std::uint32_t QUERY_COUNT = 4;
+};
+
+// Matches `QueueState` in wavefront_path_tracer.wgsl.
+struct QueueStateLayout
+{
+    std::uint32_t bounce;
+    std::uint32_t extendCount;
+    std::uint32_t shadeCount;
+    std::uint32_t missCount;
+    std::uint32_t nextExtendCount;
+    std::uint32_t extendFetchCount;
+    std::uint32_t shadowFetchCount;
+};
 
-    static constexpr std::uint32_t QUERY_COUNT = 2;
+// The indirect dispatch arguments written by wavefront_queue.wgsl.
+enum WavefrontDispatch : std::uint32_t
+{
+    WavefrontDispatch_Extend,
+    WavefrontDispatch_Shade,
+    WavefrontDispatch_Miss,
+    WavefrontDispatch_Count,
 };
+
+constexpr std::uint64_t WAVEFRONT_DISPATCH_ARGS_BYTE_SIZE = sizeof(std::uint32_t[3]);
+// See the `PATH_*` and `QUEUE_*` constants in wavefront_path_tracer.wgsl.
+constexpr std::uint64_t PATH_STATE_REGION_COUNT = 7;
+constexpr std::uint64_t WAVEFRONT_QUEUE_COUNT = 4;
+
+// The number of invocations of the persistent-threads kernels, which is enough to fill the GPU.
+constexpr std::uint32_t PERSISTENT_INVOCATION_COUNT = 1 << 16;
+
+// Matches `dispatchSize` in wavefront_queue.wgsl. One-dimensional kernels are dispatched as a 2D
+// grid, so that large framebuffers stay within the per-dimension workgroup count limit.
+Extent2u wavefrontDispatchSize(
+    const std::uint32_t invocationCount,
+    const std::uint32_t workgroupSize)
+{
+    const std::uint32_t workgroupCount = (invocationCount + workgroupSize - 1) / workgroupSize;
+    return Extent2u(
+        std::min(workgroupCount, MAX_COMPUTE_WORKGROUPS_PER_DIMENSION),
+        (workgroupCount + MAX_COMPUTE_WORKGROUPS_PER_DIMENSION - 1) /
+            MAX_COMPUTE_WORKGROUPS_PER_DIMENSION);
+}
+
+// The render scales which the dynamic resolution steps through, from the highest to the lowest,
+// and the fraction of pixels rendered at each.
+constexpr std::array<float, 5> DYNAMIC_RENDER_SCALES{1.0f, 0.875f, 0.75f, 0.625f, 0.5f};
+constexpr std::array<float, 5> DYNAMIC_RENDER_SCALE_COSTS{
+    1.0f,
+    0.875f * 0.875f,
+    0.75f * 0.75f,
+    0.625f * 0.625f,
+    0.5f * 0.5f};
+
+Extent2u scaledFramebufferSize(const Extent2u framebufferSize, const float scale)
+{
+    return Extent2u(
+        std::max(1u, static_cast<std::uint32_t>(scale * static_cast<float>(framebufferSize.x))),
+        std::max(1u, static_cast<std::uint32_t>(scale * static_cast<float>(framebufferSize.y))));
+}
 } // namespace
 
 ReferencePathTracer::ReferencePathTracer(
@@ -146,25 +217,42 @@ ReferencePathTracer::ReferencePathTracer(
           gpuContext.device,
           "sky state buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          sizeof(AlignedSkyState)),
+          SKY_STATE_BUFFER_BYTE_SIZE),
+      mUploadRing(gpuContext.device),
       mRenderParamsBindGroup(),
-      mBvhNodeBuffer(
-          gpuContext.device,
-          "bvh nodes buffer",
-          {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          std::span<const BvhNode>(scene.bvhNodes)),
+      mBvhNodeBuffer([&rendererDesc, &gpuContext, &scene]() -> GpuBuffer {
+          if (rendererDesc.bvhBuilder == BvhBuilder::Gpu)
+          {
+              // The nodes are written by the GPU builder in the constructor body.
+              return GpuBuffer{
+                  gpuContext.device,
+                  "bvh nodes buffer",
+                  {GpuBufferUsage::Storage, GpuBufferUsage::CopySrc},
+                  sizeof(BvhNode) * GpuBvhBuilder::nodeCount(static_cast<std::uint32_t>(
+                                        scene.positionAttributes.size())),
+                  GpuMemoryCategory::Bvh};
+          }
+          return GpuBuffer{
+              gpuContext.device,
+              "bvh nodes buffer",
+              {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst, GpuBufferUsage::CopySrc},
+              std::span<const BvhNode>(scene.bvhNodes),
+              GpuMemoryCategory::Bvh};
+      }()),
       mPositionAttributesBuffer(
           gpuContext.device,
           "position attributes buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          std::span<const PositionAttribute>(scene.positionAttributes)),
+          std::span<const PositionAttribute>(scene.positionAttributes),
+          GpuMemoryCategory::Geometry),
       mVertexAttributesBuffer(
           gpuContext.device,
           "vertex attributes buffer",
           {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-          std::span<const VertexAttributes>(scene.vertexAttributes)),
+          std::span<const VertexAttributes>(scene.vertexAttributes),
+          GpuMemoryCategory::Geometry),
       mTextureDescriptorBuffer(),
-      mTextureBuffer(),
+      mTexturePageBuffers(),
       mBlueNoiseBuffer([&gpuContext]() -> GpuBuffer {
           std::span<const std::uint8_t> blueNoise(blueNoiseValues, sizeof(blueNoiseValues));
           std::vector<std::uint32_t>    bufferData;
@@ -180,173 +268,254 @@ ReferencePathTracer::ReferencePathTracer(
               gpuContext.device,
               "blue noise buffer",
               {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-              std::span<const std::uint32_t>(bufferData)};
+              std::span<const std::uint32_t>(bufferData),
+              GpuMemoryCategory::Textures};
       }()),
       mSceneBindGroup(),
       mImageBuffer(
           gpuContext.device,
           "image buffer",
-          GpuBufferUsage::Storage,
-          sizeof(float[4]) * rendererDesc.maxFramebufferSize.x * rendererDesc.maxFramebufferSize.y),
+          {GpuBufferUsage::Storage, GpuBufferUsage::CopySrc},
+          sizeof(float[4]) * rendererDesc.maxFramebufferSize.x * rendererDesc.maxFramebufferSize.y,
+          GpuMemoryCategory::Accumulation),
       mImageBindGroup(),
-      mQuerySet(nullptr),
-      mQueryBuffer(
-          gpuContext.device,
-          "render pass query buffer",
-          {GpuBufferUsage::QueryResolve, GpuBufferUsage::CopySrc},
-          sizeof(TimestampsLayout)),
-      mTimestampBuffer(
-          gpuContext.device,
-          "render pass timestamp buffer",
-          {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
-          sizeof(TimestampsLayout)),
-      mRenderPipeline(nullptr),
+      mQueueStateBuffer(),
+      mQueueBuffer(),
+      mPathStateBuffer(),
+      mDispatchArgsBuffer(),
+      mWavefrontBindGroup(),
+      mQueueBindGroup(),
+      mBlitRenderParamsBindGroup(),
+      mBlitImageBindGroup(),
+      mTimestamps(gpuContext.device, "Render pass timestamps", TimestampsLayout::QUERY_COUNT),
+      mPathTracePipeline(),
+      mPathTracePipelines(),
+      mWavefrontPipelines(),
+      mBlitPipeline(),
       mCurrentRenderParams(rendererDesc.renderParams),
+      mTargetFramebufferSize(rendererDesc.renderParams.framebufferSize),
+      mDynamicResolution(
+          rendererDesc.targetFrameMs > 0.0f
+              ? DynamicResolutionController(rendererDesc.targetFrameMs, DYNAMIC_RENDER_SCALE_COSTS)
+              : DynamicResolutionController()),
+      mSkyStateCache(rendererDesc.skyStateCache),
+      mWorkgroupSize(rendererDesc.workgroupSize),
+      mIntegrator(rendererDesc.integrator),
+      mTraversal(rendererDesc.traversal),
       mFrameCount(0),
       mAccumulatedSampleCount(0),
-      mRenderPassDurationsNs()
+      mAccumulationCount(1),
+      mPathTracePassDurations(),
+      mBlitPassDurations(),
+      mRenderCpuDurations()
 {
+    assert(mSkyStateCache);
+    assert(mWorkgroupSize.x > 0 && mWorkgroupSize.y > 0);
+    if (mWorkgroupSize.x * mWorkgroupSize.y > MAX_COMPUTE_INVOCATIONS_PER_WORKGROUP)
+    {
+        throw std::runtime_error(fmt::format(
+            "Workgroup size {}x{} exceeds the limit of {} invocations per workgroup.",
+            mWorkgroupSize.x,
+            mWorkgroupSize.y,
+            MAX_COMPUTE_INVOCATIONS_PER_WORKGROUP));
+    }
+    if (mTraversal == Traversal::ShortStack)
     {
-        struct TextureDescriptor
+        if (mIntegrator != Integrator::Wavefront)
         {
-            std::uint32_t width, height, offset;
-        };
-        // Ensure matches layout of `TextureDescriptor` definition in shader.
-        std::vector<TextureDescriptor> textureDescriptors;
-        textureDescriptors.reserve(scene.baseColorTextures.size());
+            throw std::runtime_error(
+                "The short-stack traversal requires the wavefront integrator.");
+        }
+        // The depth of the GPU builder's tree is only known after the build.
+        if (rendererDesc.bvhBuilder != BvhBuilder::Offline)
+        {
+            throw std::runtime_error("The short-stack traversal requires the offline BVH builder.");
+        }
+        const std::size_t depth = bvhDepth(scene.bvhNodes);
+        if (depth > BVH_SHORT_STACK_MAX_DEPTH)
+        {
+            throw std::runtime_error(fmt::format(
+                "BVH depth {} exceeds the short-stack traversal's limit of {}.",
+                depth,
+                BVH_SHORT_STACK_MAX_DEPTH));
+        }
+    }
 
-        std::vector<Texture::BgraPixel> textureData;
-        textureData.reserve((2 << 28) / sizeof(Texture::BgraPixel));
+    if (mIntegrator == Integrator::Wavefront)
+    {
+        // The wavefront integrator keeps the state of one path per pixel.
+        const std::uint64_t maxPathCount =
+            static_cast<std::uint64_t>(rendererDesc.maxFramebufferSize.x) *
+            static_cast<std::uint64_t>(rendererDesc.maxFramebufferSize.y);
+        const std::uint64_t pathStateByteSize =
+            PATH_STATE_REGION_COUNT * sizeof(float[4]) * maxPathCount;
+        if (pathStateByteSize > REQUIRED_LIMITS.maxStorageBufferBindingSize)
+        {
+            throw std::runtime_error(fmt::format(
+                "The wavefront path state of {} paths requires {} bytes, which exceeds the storage "
+                "buffer binding size limit of {} bytes.",
+                maxPathCount,
+                pathStateByteSize,
+                REQUIRED_LIMITS.maxStorageBufferBindingSize));
+        }
+
+        mQueueStateBuffer = GpuBuffer(
+            gpuContext.device,
+            "wavefront queue state buffer",
+            GpuBufferUsage::Storage,
+            sizeof(QueueStateLayout),
+            GpuMemoryCategory::Accumulation);
+        mQueueBuffer = GpuBuffer(
+            gpuContext.device,
+            "wavefront queue buffer",
+            GpuBufferUsage::Storage,
+            WAVEFRONT_QUEUE_COUNT * sizeof(std::uint32_t) * maxPathCount,
+            GpuMemoryCategory::Accumulation);
+        mPathStateBuffer = GpuBuffer(
+            gpuContext.device,
+            "wavefront path state buffer",
+            GpuBufferUsage::Storage,
+            pathStateByteSize,
+            GpuMemoryCategory::Accumulation);
+        mDispatchArgsBuffer = GpuBuffer(
+            gpuContext.device,
+            "wavefront dispatch args buffer",
+            {GpuBufferUsage::Storage, GpuBufferUsage::Indirect},
+            WavefrontDispatch_Count * WAVEFRONT_DISPATCH_ARGS_BYTE_SIZE,
+            GpuMemoryCategory::Accumulation);
+    }
+
+    if (rendererDesc.bvhBuilder == BvhBuilder::Gpu)
+    {
+        // The builder's scratch buffers are only needed for the duration of the build. The
+        // submitted work keeps them alive after the builder is destroyed.
+        const auto    triangleCount = static_cast<std::uint32_t>(scene.positionAttributes.size());
+        GpuBvhBuilder bvhBuilder(gpuContext, triangleCount);
+        bvhBuilder.build(gpuContext, mPositionAttributesBuffer, triangleCount, mBvhNodeBuffer);
+
+        // Duplicate Morton codes are split by their triangle index, which can grow the tree deeper
+        // than the traversal stack. Such a tree is replaced by the offline BVH.
+        const std::size_t depth = bvhDepth(nlrs::readBvhNodes(
+            gpuContext, mBvhNodeBuffer, GpuBvhBuilder::nodeCount(triangleCount)));
+        if (depth > BVH_STACK_MAX_DEPTH)
+        {
+            std::fprintf(
+                stderr,
+                "GPU BVH depth %zu exceeds the traversal stack's limit of %zu, using the offline "
+                "BVH instead\n",
+                depth,
+                BVH_STACK_MAX_DEPTH);
+            mBvhNodeBuffer = GpuBuffer{
+                gpuContext.device,
+                "bvh nodes buffer",
+                {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst, GpuBufferUsage::CopySrc},
+                std::span<const BvhNode>(scene.bvhNodes),
+                GpuMemoryCategory::Bvh};
+        }
+    }
 
-        // Texture descriptors and texture data need to appended in the order of the model's
-        // baseColorTextures. The model's baseColorTextureIndices index into that array, and we want
-        // to use the same indices to index into the texture descriptor array.
+    {
+        // The model's baseColorTextureIndices index into the baseColorTextures array. Texture
+        // descriptors are packed in the same order, so the same indices can be used to index into
+        // the texture descriptor array.
         //
         // Summary:
         // baseColorTextureIndices -> baseColorTextures becomes
         // textureDescriptorIndices -> textureDescriptor -> textureData lookup
+        const std::size_t maxPageWordCount =
+            static_cast<std::size_t>(std::min(
+                TEXTURE_PAGE_MAX_BYTE_SIZE, REQUIRED_LIMITS.maxStorageBufferBindingSize)) /
+            sizeof(std::uint32_t);
+        const PackedTextures packedTextures =
+            packTextures(scene.baseColorTextures, rendererDesc.textureLayout, maxPageWordCount);
 
-        for (const Texture& baseColorTexture : scene.baseColorTextures)
         {
-            const auto dimensions = baseColorTexture.dimensions();
-            const auto pixels = baseColorTexture.pixels();
-
-            const std::uint32_t width = dimensions.width;
-            const std::uint32_t height = dimensions.height;
-            const std::uint32_t offset = static_cast<std::uint32_t>(textureData.size());
-
-            textureData.resize(textureData.size() + pixels.size());
-            std::memcpy(
-                textureData.data() + offset,
-                pixels.data(),
-                pixels.size() * sizeof(Texture::BgraPixel));
-
-            textureDescriptors.push_back({width, height, offset});
+            // The sRGB lookup table precedes the descriptors, see `TextureTable` in the shader. The
+            // buffer always has room for one descriptor, as the runtime-sized array can't be empty.
+            const std::span<const float> srgbToLinear = srgbToLinearLut();
+            const std::size_t            descriptorByteSize =
+                packedTextures.descriptors.size() * sizeof(TextureDescriptor);
+            const std::size_t            bufferByteSize =
+                srgbToLinear.size_bytes() + std::max(descriptorByteSize, sizeof(TextureDescriptor));
+            mTextureDescriptorBuffer = GpuBuffer(
+                gpuContext.device,
+                "texture descriptor buffer",
+                {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+                bufferByteSize,
+                GpuMemoryCategory::Textures);
+            wgpuQueueWriteBuffer(
+                gpuContext.queue,
+                mTextureDescriptorBuffer.ptr(),
+                0,
+                srgbToLinear.data(),
+                srgbToLinear.size_bytes());
+            if (descriptorByteSize > 0)
+            {
+                wgpuQueueWriteBuffer(
+                    gpuContext.queue,
+                    mTextureDescriptorBuffer.ptr(),
+                    srgbToLinear.size_bytes(),
+                    packedTextures.descriptors.data(),
+                    descriptorByteSize);
+            }
         }
 
-        mTextureDescriptorBuffer = GpuBuffer(
-            gpuContext.device,
-            "texture descriptor buffer",
-            {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-            std::span<const TextureDescriptor>(textureDescriptors));
-
-        const std::size_t textureDataNumBytes = textureData.size() * sizeof(Texture::BgraPixel);
-        const std::size_t maxStorageBufferBindingSize =
-            static_cast<std::size_t>(REQUIRED_LIMITS.maxStorageBufferBindingSize);
-        if (textureDataNumBytes > maxStorageBufferBindingSize)
+        if (packedTextures.pages.size() > TEXTURE_PAGE_COUNT)
         {
             throw std::runtime_error(fmt::format(
-                "Texture buffer size ({}) exceeds "
-                "maxStorageBufferBindingSize ({}).",
-                textureDataNumBytes,
-                maxStorageBufferBindingSize));
+                "Texture data requires {} texture pages of at most {} bytes, but only {} pages "
+                "are available.",
+                packedTextures.pages.size(),
+                maxPageWordCount * sizeof(std::uint32_t),
+                TEXTURE_PAGE_COUNT));
         }
 
-        mTextureBuffer = GpuBuffer(
-            gpuContext.device,
-            "texture buffer",
-            {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
-            std::span<const Texture::BgraPixel>(textureData));
+        for (std::size_t pageIdx = 0; pageIdx < TEXTURE_PAGE_COUNT; ++pageIdx)
+        {
+            // Unused pages are still bound, so they get a placeholder texel.
+            const std::uint32_t                  placeholderTexel = 0;
+            const std::span<const std::uint32_t> texels =
+                pageIdx < packedTextures.pages.size()
+                    ? std::span<const std::uint32_t>(packedTextures.pages[pageIdx])
+                    : std::span<const std::uint32_t>(&placeholderTexel, 1);
+            mTexturePageBuffers[pageIdx] = GpuBuffer(
+                gpuContext.device,
+                "texture page buffer",
+                {GpuBufferUsage::ReadOnlyStorage, GpuBufferUsage::CopyDst},
+                texels,
+                GpuMemoryCategory::Textures);
+        }
     }
 
     {
-        // Blend state for color target
-
-        const WGPUBlendState blendState{
-            .color =
-                WGPUBlendComponent{
-                    .operation = WGPUBlendOperation_Add,
-                    .srcFactor = WGPUBlendFactor_One,
-                    .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
-                },
-            .alpha =
-                WGPUBlendComponent{
-                    .operation = WGPUBlendOperation_Add,
-                    .srcFactor = WGPUBlendFactor_Zero,
-                    .dstFactor = WGPUBlendFactor_One,
-                },
-        };
-
-        // Color target information for fragment state
-
-        const WGPUColorTargetState colorTarget{
-            .nextInChain = nullptr,
-            .format = Window::SWAP_CHAIN_FORMAT,
-            .blend = &blendState,
-            // We could write to only some of the color channels.
-            .writeMask = WGPUColorWriteMask_All,
-        };
-
         // Shader modules
 
-        const WGPUShaderModuleWGSLDescriptor shaderCodeDesc = {
-            .chain =
-                WGPUChainedStruct{
-                    .next = nullptr,
-                    .sType = WGPUSType_ShaderModuleWGSLDescriptor,
-                },
-            .code = REFERENCE_PATH_TRACER_SOURCE,
-        };
-
-        const WGPUShaderModuleDescriptor shaderDesc{
-            .nextInChain = &shaderCodeDesc.chain,
-            .label = "Shader module",
-        };
-
-        const WGPUShaderModule shaderModule =
-            wgpuDeviceCreateShaderModule(gpuContext.device, &shaderDesc);
-
-        const WGPUFragmentState fragmentState{
-            .nextInChain = nullptr,
-            .module = shaderModule,
-            .entryPoint = "fsMain",
-            .constantCount = 0,
-            .constants = nullptr,
-            .targetCount = 1,
-            .targets = &colorTarget,
+        const auto createShaderModule = [&gpuContext](
+                                            const char* const code,
+                                            const char* const label) -> WGPUShaderModule {
+            const WGPUShaderModuleWGSLDescriptor shaderCodeDesc = {
+                .chain =
+                    WGPUChainedStruct{
+                        .next = nullptr,
+                        .sType = WGPUSType_ShaderModuleWGSLDescriptor,
+                    },
+                .code = code,
+            };
+            const WGPUShaderModuleDescriptor shaderDesc{
+                .nextInChain = &shaderCodeDesc.chain,
+                .label = label,
+            };
+            return wgpuDeviceCreateShaderModule(gpuContext.device, &shaderDesc);
         };
 
-        // Vertex layout
-
-        const std::array<WGPUVertexAttribute, 1> vertexAttributes{WGPUVertexAttribute{
-            // position
-            .format = WGPUVertexFormat_Float32x2,
-            .offset = 0,
-            .shaderLocation = 0,
-        }};
-
-        const WGPUVertexBufferLayout vertexBufferLayout{
-            .arrayStride = sizeof(float[2]),
-            .stepMode = WGPUVertexStepMode_Vertex,
-            .attributeCount = vertexAttributes.size(),
-            .attributes = vertexAttributes.data(),
-        };
+        const WGPUShaderModule blitShaderModule =
+            createShaderModule(REFERENCE_PATH_TRACER_BLIT_SOURCE, "Blit shader module");
 
         // renderParams group layout
 
         const std::array<WGPUBindGroupLayoutEntry, 2> renderParamsBindGroupLayoutEntries{
-            mRenderParamsBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Fragment),
-            mSkyStateBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Fragment),
+            mRenderParamsBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute),
+            mSkyStateBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
         };
         const GpuBindGroupLayout renderParamsBindGroupLayout{
             gpuContext.device,
@@ -355,13 +524,18 @@ ReferencePathTracer::ReferencePathTracer(
 
         // scene bind group layout
 
-        const std::array<WGPUBindGroupLayoutEntry, 6> sceneBindGroupLayoutEntries{
-            mBvhNodeBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Fragment),
-            mPositionAttributesBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Fragment),
-            mVertexAttributesBuffer.bindGroupLayoutEntry(2, WGPUShaderStage_Fragment),
-            mTextureDescriptorBuffer.bindGroupLayoutEntry(3, WGPUShaderStage_Fragment),
-            mTextureBuffer.bindGroupLayoutEntry(4, WGPUShaderStage_Fragment),
-            mBlueNoiseBuffer.bindGroupLayoutEntry(5, WGPUShaderStage_Fragment),
+        const std::array<WGPUBindGroupLayoutEntry, 9> sceneBindGroupLayoutEntries{
+            // The GPU builder writes the nodes, so the buffer doesn't have the read-only usage.
+            bufferBindGroupLayoutEntry(
+                0, WGPUShaderStage_Compute, WGPUBufferBindingType_ReadOnlyStorage, 0),
+            mPositionAttributesBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
+            mVertexAttributesBuffer.bindGroupLayoutEntry(2, WGPUShaderStage_Compute),
+            mTextureDescriptorBuffer.bindGroupLayoutEntry(3, WGPUShaderStage_Compute),
+            mBlueNoiseBuffer.bindGroupLayoutEntry(4, WGPUShaderStage_Compute),
+            mTexturePageBuffers[0].bindGroupLayoutEntry(5, WGPUShaderStage_Compute),
+            mTexturePageBuffers[1].bindGroupLayoutEntry(6, WGPUShaderStage_Compute),
+            mTexturePageBuffers[2].bindGroupLayoutEntry(7, WGPUShaderStage_Compute),
+            mTexturePageBuffers[3].bindGroupLayoutEntry(8, WGPUShaderStage_Compute),
         };
         const GpuBindGroupLayout sceneBindGroupLayout{
             gpuContext.device, "Scene bind group layout", sceneBindGroupLayoutEntries};
@@ -371,24 +545,20 @@ ReferencePathTracer::ReferencePathTracer(
         const GpuBindGroupLayout imageBindGroupLayout{
             gpuContext.device,
             "Image bind group layout",
-            mImageBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Fragment)};
+            mImageBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute)};
 
-        // pipeline layout
+        // blit bind group layouts
 
-        const std::array<WGPUBindGroupLayout, 3> bindGroupLayouts{
-            renderParamsBindGroupLayout.ptr(),
-            sceneBindGroupLayout.ptr(),
-            imageBindGroupLayout.ptr(),
-        };
+        const GpuBindGroupLayout blitRenderParamsBindGroupLayout{
+            gpuContext.device,
+            "Blit RenderParams bind group layout",
+            mRenderParamsBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Fragment)};
 
-        const WGPUPipelineLayoutDescriptor pipelineLayoutDesc{
-            .nextInChain = nullptr,
-            .label = "Pipeline layout",
-            .bindGroupLayoutCount = bindGroupLayouts.size(),
-            .bindGroupLayouts = bindGroupLayouts.data(),
-        };
-        const WGPUPipelineLayout pipelineLayout =
-            wgpuDeviceCreatePipelineLayout(gpuContext.device, &pipelineLayoutDesc);
+        const GpuBindGroupLayout blitImageBindGroupLayout{
+            gpuContext.device,
+            "Blit image bind group layout",
+            bufferBindGroupLayoutEntry(
+                0, WGPUShaderStage_Fragment, WGPUBufferBindingType_ReadOnlyStorage, 0)};
 
         // renderParams bind group
 
@@ -404,13 +574,16 @@ ReferencePathTracer::ReferencePathTracer(
 
         // scene bind group
 
-        const std::array<WGPUBindGroupEntry, 6> sceneBindGroupEntries{
+        const std::array<WGPUBindGroupEntry, 9> sceneBindGroupEntries{
             mBvhNodeBuffer.bindGroupEntry(0),
             mPositionAttributesBuffer.bindGroupEntry(1),
             mVertexAttributesBuffer.bindGroupEntry(2),
             mTextureDescriptorBuffer.bindGroupEntry(3),
-            mTextureBuffer.bindGroupEntry(4),
-            mBlueNoiseBuffer.bindGroupEntry(5),
+            mBlueNoiseBuffer.bindGroupEntry(4),
+            mTexturePageBuffers[0].bindGroupEntry(5),
+            mTexturePageBuffers[1].bindGroupEntry(6),
+            mTexturePageBuffers[2].bindGroupEntry(7),
+            mTexturePageBuffers[3].bindGroupEntry(8),
         };
         mSceneBindGroup = GpuBindGroup{
             gpuContext.device,
@@ -426,57 +599,295 @@ ReferencePathTracer::ReferencePathTracer(
             imageBindGroupLayout.ptr(),
             mImageBuffer.bindGroupEntry(0)};
 
-        // pipeline
+        // blit bind groups
 
-        const WGPURenderPipelineDescriptor pipelineDesc{
-            .nextInChain = nullptr,
-            .label = "Render pipeline",
-            .layout = pipelineLayout,
-            .vertex =
-                WGPUVertexState{
+        mBlitRenderParamsBindGroup = GpuBindGroup{
+            gpuContext.device,
+            "Blit RenderParams bind group",
+            blitRenderParamsBindGroupLayout.ptr(),
+            mRenderParamsBuffer.bindGroupEntry(0)};
+
+        mBlitImageBindGroup = GpuBindGroup{
+            gpuContext.device,
+            "Blit image bind group",
+            blitImageBindGroupLayout.ptr(),
+            mImageBuffer.bindGroupEntry(0)};
+
+        // path trace pipeline
+
+        if (mIntegrator == Integrator::Megakernel)
+        {
+            const WGPUShaderModule pathTraceShaderModule =
+                createShaderModule(REFERENCE_PATH_TRACER_SOURCE, "Path trace shader module");
+
+            const std::array<WGPUBindGroupLayout, 3> bindGroupLayouts{
+                renderParamsBindGroupLayout.ptr(),
+                sceneBindGroupLayout.ptr(),
+                imageBindGroupLayout.ptr(),
+            };
+
+            const WGPUPipelineLayoutDescriptor pipelineLayoutDesc{
+                .nextInChain = nullptr,
+                .label = "Path trace pipeline layout",
+                .bindGroupLayoutCount = bindGroupLayouts.size(),
+                .bindGroupLayouts = bindGroupLayouts.data(),
+            };
+            const WGPUPipelineLayout pipelineLayout =
+                wgpuDeviceCreatePipelineLayout(gpuContext.device, &pipelineLayoutDesc);
+
+            const std::array<WGPUConstantEntry, 2> workgroupSizeConstants{
+                WGPUConstantEntry{
                     .nextInChain = nullptr,
-                    .module = shaderModule,
-                    .entryPoint = "vsMain",
-                    .constantCount = 0,
-                    .constants = nullptr,
-                    .bufferCount = 1,
-                    .buffers = &vertexBufferLayout,
+                    .key = "WORKGROUP_SIZE_X",
+                    .value = static_cast<double>(mWorkgroupSize.x),
                 },
-            // NOTE: the primitive assembly config, defines how the primitive assembly and
-            // rasterization stages are configured.
-            .primitive =
-                WGPUPrimitiveState{
+                WGPUConstantEntry{
                     .nextInChain = nullptr,
-                    .topology = WGPUPrimitiveTopology_TriangleList,
-                    .stripIndexFormat = WGPUIndexFormat_Undefined,
-                    .frontFace = WGPUFrontFace_CCW,
-                    .cullMode = WGPUCullMode_Back,
+                    .key = "WORKGROUP_SIZE_Y",
+                    .value = static_cast<double>(mWorkgroupSize.y),
                 },
-            .depthStencil = nullptr,
-            .multisample =
-                WGPUMultisampleState{
+            };
+
+            const WGPUComputePipelineDescriptor pipelineDesc{
+                .nextInChain = nullptr,
+                .label = "Path trace pipeline",
+                .layout = pipelineLayout,
+                .compute =
+                    WGPUProgrammableStageDescriptor{
+                        .nextInChain = nullptr,
+                        .module = pathTraceShaderModule,
+                        .entryPoint = "main",
+                        .constantCount = workgroupSizeConstants.size(),
+                        .constants = workgroupSizeConstants.data(),
+                    },
+            };
+
+            mPathTracePipeline = AsyncComputePipeline(gpuContext.device, pipelineDesc);
+
+            // The cache takes ownership of the layout and the module.
+            const std::array<const char*, 1> specializationKeys{"NUM_BOUNCES"};
+            mPathTracePipelines = ComputePipelineCache(
+                gpuContext.device,
+                pipelineLayout,
+                pathTraceShaderModule,
+                "main",
+                workgroupSizeConstants,
+                specializationKeys);
+            specializeBounceCounts(std::span(&mCurrentRenderParams.samplingParams.numBounces, 1));
+        }
+
+        // wavefront pipelines
+
+        if (mIntegrator == Integrator::Wavefront)
+        {
+            const WGPUShaderModule wavefrontShaderModule = createShaderModule(
+                WAVEFRONT_PATH_TRACER_SOURCE, "Wavefront path tracer shader module");
+            const WGPUShaderModule queueShaderModule =
+                createShaderModule(WAVEFRONT_QUEUE_SOURCE, "Wavefront queue shader module");
+
+            const std::array<WGPUBindGroupLayoutEntry, 3> wavefrontBindGroupLayoutEntries{
+                mQueueStateBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute),
+                mQueueBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
+                mPathStateBuffer.bindGroupLayoutEntry(2, WGPUShaderStage_Compute),
+            };
+            const GpuBindGroupLayout wavefrontBindGroupLayout{
+                gpuContext.device, "Wavefront bind group layout", wavefrontBindGroupLayoutEntries};
+
+            const std::array<WGPUBindGroupLayoutEntry, 2> queueBindGroupLayoutEntries{
+                mQueueStateBuffer.bindGroupLayoutEntry(0, WGPUShaderStage_Compute),
+                mDispatchArgsBuffer.bindGroupLayoutEntry(1, WGPUShaderStage_Compute),
+            };
+            const GpuBindGroupLayout queueBindGroupLayout{
+                gpuContext.device,
+                "Wavefront queue bind group layout",
+                queueBindGroupLayoutEntries};
+
+            const std::array<WGPUBindGroupEntry, 3> wavefrontBindGroupEntries{
+                mQueueStateBuffer.bindGroupEntry(0),
+                mQueueBuffer.bindGroupEntry(1),
+                mPathStateBuffer.bindGroupEntry(2),
+            };
+            mWavefrontBindGroup = GpuBindGroup{
+                gpuContext.device,
+                "Wavefront bind group",
+                wavefrontBindGroupLayout.ptr(),
+                wavefrontBindGroupEntries};
+
+            const std::array<WGPUBindGroupEntry, 2> queueBindGroupEntries{
+                mQueueStateBuffer.bindGroupEntry(0),
+                mDispatchArgsBuffer.bindGroupEntry(1),
+            };
+            mQueueBindGroup = GpuBindGroup{
+                gpuContext.device,
+                "Wavefront queue bind group",
+                queueBindGroupLayout.ptr(),
+                queueBindGroupEntries};
+
+            const std::array<WGPUBindGroupLayout, 4> kernelBindGroupLayouts{
+                renderParamsBindGroupLayout.ptr(),
+                sceneBindGroupLayout.ptr(),
+                imageBindGroupLayout.ptr(),
+                wavefrontBindGroupLayout.ptr(),
+            };
+            const WGPUPipelineLayoutDescriptor kernelPipelineLayoutDesc{
+                .nextInChain = nullptr,
+                .label = "Wavefront kernel pipeline layout",
+                .bindGroupLayoutCount = kernelBindGroupLayouts.size(),
+                .bindGroupLayouts = kernelBindGroupLayouts.data(),
+            };
+            const WGPUPipelineLayout kernelPipelineLayout =
+                wgpuDeviceCreatePipelineLayout(gpuContext.device, &kernelPipelineLayoutDesc);
+
+            const WGPUBindGroupLayout          queueBindGroupLayoutPtr = queueBindGroupLayout.ptr();
+            const WGPUPipelineLayoutDescriptor queuePipelineLayoutDesc{
+                .nextInChain = nullptr,
+                .label = "Wavefront queue pipeline layout",
+                .bindGroupLayoutCount = 1,
+                .bindGroupLayouts = &queueBindGroupLayoutPtr,
+            };
+            const WGPUPipelineLayout queuePipelineLayout =
+                wgpuDeviceCreatePipelineLayout(gpuContext.device, &queuePipelineLayoutDesc);
+
+            const WGPUConstantEntry workgroupSizeConstant{
+                .nextInChain = nullptr,
+                .key = "WORKGROUP_SIZE",
+                .value = static_cast<double>(mWorkgroupSize.x * mWorkgroupSize.y),
+            };
+
+            const auto createPipeline = [&gpuContext, &workgroupSizeConstant](
+                                            const WGPUPipelineLayout layout,
+                                            const WGPUShaderModule   module,
+                                            const char* const entryPoint) -> AsyncComputePipeline {
+                const WGPUComputePipelineDescriptor pipelineDesc{
                     .nextInChain = nullptr,
-                    .count = 1,
-                    .mask = ~0u,
-                    .alphaToCoverageEnabled = false,
-                },
-            // NOTE: the fragment state is a potentially null value.
-            .fragment = &fragmentState,
-        };
+                    .label = entryPoint,
+                    .layout = layout,
+                    .compute =
+                        WGPUProgrammableStageDescriptor{
+                            .nextInChain = nullptr,
+                            .module = module,
+                            .entryPoint = entryPoint,
+                            .constantCount = 1,
+                            .constants = &workgroupSizeConstant,
+                        },
+                };
+                return AsyncComputePipeline(gpuContext.device, pipelineDesc);
+            };
+
+            const bool useShortStack = mTraversal == Traversal::ShortStack;
+            mWavefrontPipelines = WavefrontPipelines{
+                .generate = createPipeline(kernelPipelineLayout, wavefrontShaderModule, "generate"),
+                .extend = createPipeline(
+                    kernelPipelineLayout,
+                    wavefrontShaderModule,
+                    useShortStack ? "extendPersistent" : "extend"),
+                .miss = createPipeline(kernelPipelineLayout, wavefrontShaderModule, "miss"),
+                .shade = createPipeline(kernelPipelineLayout, wavefrontShaderModule, "shade"),
+                .shadow = createPipeline(
+                    kernelPipelineLayout,
+                    wavefrontShaderModule,
+                    useShortStack ? "shadowPersistent" : "shadow"),
+                .accumulate =
+                    createPipeline(kernelPipelineLayout, wavefrontShaderModule, "accumulate"),
+                .beginBounce =
+                    createPipeline(queuePipelineLayout, queueShaderModule, "beginBounce"),
+                .prepareShade =
+                    createPipeline(queuePipelineLayout, queueShaderModule, "prepareShade"),
+            };
 
-        mRenderPipeline = wgpuDeviceCreateRenderPipeline(gpuContext.device, &pipelineDesc);
+            wgpuPipelineLayoutRelease(queuePipelineLayout);
+            wgpuPipelineLayoutRelease(kernelPipelineLayout);
+            wgpuShaderModuleRelease(queueShaderModule);
+            wgpuShaderModuleRelease(wavefrontShaderModule);
+        }
 
-        wgpuPipelineLayoutRelease(pipelineLayout);
-    }
+        // blit pipeline
 
-    // Timestamp query sets
-    {
-        const WGPUQuerySetDescriptor querySetDesc{
-            .nextInChain = nullptr,
-            .label = "renderpass timestamp query set",
-            .type = WGPUQueryType_Timestamp,
-            .count = TimestampsLayout::QUERY_COUNT};
-        mQuerySet = wgpuDeviceCreateQuerySet(gpuContext.device, &querySetDesc);
+        {
+            const std::array<WGPUBindGroupLayout, 2> bindGroupLayouts{
+                blitRenderParamsBindGroupLayout.ptr(),
+                blitImageBindGroupLayout.ptr(),
+            };
+
+            const WGPUPipelineLayoutDescriptor pipelineLayoutDesc{
+                .nextInChain = nullptr,
+                .label = "Blit pipeline layout",
+                .bindGroupLayoutCount = bindGroupLayouts.size(),
+                .bindGroupLayouts = bindGroupLayouts.data(),
+            };
+            const WGPUPipelineLayout pipelineLayout =
+                wgpuDeviceCreatePipelineLayout(gpuContext.device, &pipelineLayoutDesc);
+
+            const WGPUColorTargetState colorTarget{
+                .nextInChain = nullptr,
+                .format = Window::SWAP_CHAIN_FORMAT,
+                .blend = nullptr,
+                .writeMask = WGPUColorWriteMask_All,
+            };
+
+            const WGPUFragmentState fragmentState{
+                .nextInChain = nullptr,
+                .module = blitShaderModule,
+                .entryPoint = "fsMain",
+                .constantCount = 0,
+                .constants = nullptr,
+                .targetCount = 1,
+                .targets = &colorTarget,
+            };
+
+            const std::array<WGPUVertexAttribute, 1> vertexAttributes{WGPUVertexAttribute{
+                // position
+                .format = WGPUVertexFormat_Float32x2,
+                .offset = 0,
+                .shaderLocation = 0,
+            }};
+
+            const WGPUVertexBufferLayout vertexBufferLayout{
+                .arrayStride = sizeof(float[2]),
+                .stepMode = WGPUVertexStepMode_Vertex,
+                .attributeCount = vertexAttributes.size(),
+                .attributes = vertexAttributes.data(),
+            };
+
+            const WGPURenderPipelineDescriptor pipelineDesc{
+                .nextInChain = nullptr,
+                .label = "Blit pipeline",
+                .layout = pipelineLayout,
+                .vertex =
+                    WGPUVertexState{
+                        .nextInChain = nullptr,
+                        .module = blitShaderModule,
+                        .entryPoint = "vsMain",
+                        .constantCount = 0,
+                        .constants = nullptr,
+                        .bufferCount = 1,
+                        .buffers = &vertexBufferLayout,
+                    },
+                .primitive =
+                    WGPUPrimitiveState{
+                        .nextInChain = nullptr,
+                        .topology = WGPUPrimitiveTopology_TriangleList,
+                        .stripIndexFormat = WGPUIndexFormat_Undefined,
+                        .frontFace = WGPUFrontFace_CCW,
+                        .cullMode = WGPUCullMode_Back,
+                    },
+                .depthStencil = nullptr,
+                .multisample =
+                    WGPUMultisampleState{
+                        .nextInChain = nullptr,
+                        .count = 1,
+                        .mask = ~0u,
+                        .alphaToCoverageEnabled = false,
+                    },
+                .fragment = &fragmentState,
+            };
+
+            mBlitPipeline = AsyncRenderPipeline(gpuContext.device, pipelineDesc);
+
+            wgpuPipelineLayoutRelease(pipelineLayout);
+        }
+
+        wgpuShaderModuleRelease(blitShaderModule);
     }
 }
 
@@ -487,28 +898,45 @@ ReferencePathTracer::ReferencePathTracer(ReferencePathTracer&& other)
         mVertexBuffer = std::move(other.mVertexBuffer);
         mRenderParamsBuffer = std::move(other.mRenderParamsBuffer);
         mSkyStateBuffer = std::move(other.mSkyStateBuffer);
+        mUploadRing = std::move(other.mUploadRing);
         mRenderParamsBindGroup = std::move(other.mRenderParamsBindGroup);
         mBvhNodeBuffer = std::move(other.mBvhNodeBuffer);
         mPositionAttributesBuffer = std::move(other.mPositionAttributesBuffer);
         mVertexAttributesBuffer = std::move(other.mVertexAttributesBuffer);
         mTextureDescriptorBuffer = std::move(other.mTextureDescriptorBuffer);
-        mTextureBuffer = std::move(other.mTextureBuffer);
+        mTexturePageBuffers = std::move(other.mTexturePageBuffers);
         mBlueNoiseBuffer = std::move(other.mBlueNoiseBuffer);
         mSceneBindGroup = std::move(other.mSceneBindGroup);
         mImageBuffer = std::move(other.mImageBuffer);
         mImageBindGroup = std::move(other.mImageBindGroup);
-        mQuerySet = other.mQuerySet;
-        other.mQuerySet = nullptr;
-        mQueryBuffer = std::move(other.mQueryBuffer);
-        mTimestampBuffer = std::move(other.mTimestampBuffer);
-        mRenderPipeline = other.mRenderPipeline;
-        other.mRenderPipeline = nullptr;
+        mQueueStateBuffer = std::move(other.mQueueStateBuffer);
+        mQueueBuffer = std::move(other.mQueueBuffer);
+        mPathStateBuffer = std::move(other.mPathStateBuffer);
+        mDispatchArgsBuffer = std::move(other.mDispatchArgsBuffer);
+        mWavefrontBindGroup = std::move(other.mWavefrontBindGroup);
+        mQueueBindGroup = std::move(other.mQueueBindGroup);
+        mBlitRenderParamsBindGroup = std::move(other.mBlitRenderParamsBindGroup);
+        mBlitImageBindGroup = std::move(other.mBlitImageBindGroup);
+        mTimestamps = std::move(other.mTimestamps);
+        mPathTracePipeline = std::move(other.mPathTracePipeline);
+        mPathTracePipelines = std::move(other.mPathTracePipelines);
+        mWavefrontPipelines = std::move(other.mWavefrontPipelines);
+        mBlitPipeline = std::move(other.mBlitPipeline);
 
         mCurrentRenderParams = other.mCurrentRenderParams;
+        mTargetFramebufferSize = other.mTargetFramebufferSize;
+        mDynamicResolution = std::move(other.mDynamicResolution);
+        mSkyStateCache = std::move(other.mSkyStateCache);
+        mWorkgroupSize = other.mWorkgroupSize;
+        mIntegrator = other.mIntegrator;
+        mTraversal = other.mTraversal;
         mFrameCount = other.mFrameCount;
         mAccumulatedSampleCount = other.mAccumulatedSampleCount;
+        mAccumulationCount = other.mAccumulationCount;
 
-        mRenderPassDurationsNs = std::move(other.mRenderPassDurationsNs);
+        mPathTracePassDurations = other.mPathTracePassDurations;
+        mBlitPassDurations = other.mBlitPassDurations;
+        mRenderCpuDurations = other.mRenderCpuDurations;
     }
 }
 
@@ -519,81 +947,116 @@ ReferencePathTracer& ReferencePathTracer::operator=(ReferencePathTracer&& other)
         mVertexBuffer = std::move(other.mVertexBuffer);
         mRenderParamsBuffer = std::move(other.mRenderParamsBuffer);
         mSkyStateBuffer = std::move(other.mSkyStateBuffer);
+        mUploadRing = std::move(other.mUploadRing);
         mRenderParamsBindGroup = std::move(other.mRenderParamsBindGroup);
         mBvhNodeBuffer = std::move(other.mBvhNodeBuffer);
         mPositionAttributesBuffer = std::move(other.mPositionAttributesBuffer);
         mVertexAttributesBuffer = std::move(other.mVertexAttributesBuffer);
         mTextureDescriptorBuffer = std::move(other.mTextureDescriptorBuffer);
-        mTextureBuffer = std::move(other.mTextureBuffer);
+        mTexturePageBuffers = std::move(other.mTexturePageBuffers);
         mBlueNoiseBuffer = std::move(other.mBlueNoiseBuffer);
         mSceneBindGroup = std::move(other.mSceneBindGroup);
         mImageBuffer = std::move(other.mImageBuffer);
         mImageBindGroup = std::move(other.mImageBindGroup);
-        mQuerySet = other.mQuerySet;
-        other.mQuerySet = nullptr;
-        mQueryBuffer = std::move(other.mQueryBuffer);
-        mTimestampBuffer = std::move(other.mTimestampBuffer);
-        mRenderPipeline = other.mRenderPipeline;
-        other.mRenderPipeline = nullptr;
+        mQueueStateBuffer = std::move(other.mQueueStateBuffer);
+        mQueueBuffer = std::move(other.mQueueBuffer);
+        mPathStateBuffer = std::move(other.mPathStateBuffer);
+        mDispatchArgsBuffer = std::move(other.mDispatchArgsBuffer);
+        mWavefrontBindGroup = std::move(other.mWavefrontBindGroup);
+        mQueueBindGroup = std::move(other.mQueueBindGroup);
+        mBlitRenderParamsBindGroup = std::move(other.mBlitRenderParamsBindGroup);
+        mBlitImageBindGroup = std::move(other.mBlitImageBindGroup);
+        mTimestamps = std::move(other.mTimestamps);
+        mPathTracePipeline = std::move(other.mPathTracePipeline);
+        mPathTracePipelines = std::move(other.mPathTracePipelines);
+        mWavefrontPipelines = std::move(other.mWavefrontPipelines);
+        mBlitPipeline = std::move(other.mBlitPipeline);
 
         mCurrentRenderParams = other.mCurrentRenderParams;
+        mTargetFramebufferSize = other.mTargetFramebufferSize;
+        mDynamicResolution = std::move(other.mDynamicResolution);
+        mSkyStateCache = std::move(other.mSkyStateCache);
+        mWorkgroupSize = other.mWorkgroupSize;
+        mIntegrator = other.mIntegrator;
+        mTraversal = other.mTraversal;
         mFrameCount = other.mFrameCount;
         mAccumulatedSampleCount = other.mAccumulatedSampleCount;
+        mAccumulationCount = other.mAccumulationCount;
 
-        mRenderPassDurationsNs = std::move(other.mRenderPassDurationsNs);
+        mPathTracePassDurations = other.mPathTracePassDurations;
+        mBlitPassDurations = other.mBlitPassDurations;
+        mRenderCpuDurations = other.mRenderCpuDurations;
     }
     return *this;
 }
 
-ReferencePathTracer::~ReferencePathTracer()
+ReferencePathTracer::~ReferencePathTracer() = default;
+
+bool ReferencePathTracer::isReady() const
+{
+    if (!mBlitPipeline.isReady())
+    {
+        return false;
+    }
+    return mIntegrator == Integrator::Wavefront ? mWavefrontPipelines.isReady()
+                                                : mPathTracePipeline.isReady();
+}
+
+bool ReferencePathTracer::hasFailed() const
 {
-    renderPipelineSafeRelease(mRenderPipeline);
-    mRenderPipeline = nullptr;
-    querySetSafeRelease(mQuerySet);
-    mQuerySet = nullptr;
+    if (mBlitPipeline.hasFailed())
+    {
+        return true;
+    }
+    return mIntegrator == Integrator::Wavefront ? mWavefrontPipelines.hasFailed()
+                                                : mPathTracePipeline.hasFailed();
 }
 
 void ReferencePathTracer::setRenderParameters(const RenderParameters& renderParams)
 {
-    if (mCurrentRenderParams != renderParams)
+    // The image is rendered at the dynamic resolution's scale of the framebuffer size, and the
+    // blit pass stretches it over the target. The image buffer is sized for the max framebuffer
+    // size, so the scaled image fits without reallocating it.
+    RenderParameters scaledRenderParams = renderParams;
+    scaledRenderParams.framebufferSize = scaledFramebufferSize(
+        renderParams.framebufferSize, DYNAMIC_RENDER_SCALES[mDynamicResolution.level()]);
+    mTargetFramebufferSize = renderParams.framebufferSize;
+    if (mCurrentRenderParams != scaledRenderParams)
     {
-        mCurrentRenderParams = renderParams;
+        mCurrentRenderParams = scaledRenderParams;
         mAccumulatedSampleCount = 0; // reset the temporal accumulation
+        ++mAccumulationCount;
+    }
+}
+
+void ReferencePathTracer::specializeBounceCounts(const std::span<const std::uint32_t> numBounces)
+{
+    if (mIntegrator != Integrator::Megakernel)
+    {
+        return;
+    }
+    for (const std::uint32_t bounceCount : numBounces)
+    {
+        const std::array<double, 1> specializationValues{static_cast<double>(bounceCount)};
+        mPathTracePipelines.pipeline(specializationValues);
     }
 }
 
 void ReferencePathTracer::render(
     const GpuContext&     gpuContext,
     const WGPUTextureView textureView,
-    Gui&                  gui)
+    Gui*                  gui)
 {
-    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
-    do
-    {
-        wgpuDeviceTick(gpuContext.device);
-    } while (wgpuBufferGetMapState(mTimestampBuffer.ptr()) != WGPUBufferMapState_Unmapped);
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations. The timestamps of
+    // earlier frames are consumed as their readbacks complete, without waiting for them.
+    wgpuDeviceTick(gpuContext.device);
+    assert(isReady());
 
-    {
-        assert(mAccumulatedSampleCount <= mCurrentRenderParams.samplingParams.numSamplesPerPixel);
-        const RenderParamsLayout renderParamsLayout{
-            mCurrentRenderParams.framebufferSize,
-            mFrameCount++,
-            mCurrentRenderParams,
-            mAccumulatedSampleCount,
-            mCurrentRenderParams.exposure};
-        wgpuQueueWriteBuffer(
-            gpuContext.queue,
-            mRenderParamsBuffer.ptr(),
-            0,
-            &renderParamsLayout,
-            sizeof(RenderParamsLayout));
-        mAccumulatedSampleCount = std::min(
-            mAccumulatedSampleCount + 1, mCurrentRenderParams.samplingParams.numSamplesPerPixel);
-        const AlignedSkyState skyState{mCurrentRenderParams.sky};
-        wgpuQueueWriteBuffer(
-            gpuContext.queue, mSkyStateBuffer.ptr(), 0, &skyState, sizeof(AlignedSkyState));
-    }
+    const auto cpuBegin = std::chrono::steady_clock::now();
+
+    recordTimestamps();
 
+    // The per-frame uploads are encoded as copies ahead of the passes.
     const WGPUCommandEncoder encoder = [&gpuContext]() {
         const WGPUCommandEncoderDescriptor cmdEncoderDesc{
             .nextInChain = nullptr,
@@ -602,7 +1065,87 @@ void ReferencePathTracer::render(
         return wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
     }();
 
-    wgpuCommandEncoderWriteTimestamp(encoder, mQuerySet, 0);
+    const bool isAccumulating =
+        mAccumulatedSampleCount < mCurrentRenderParams.samplingParams.numSamplesPerPixel;
+    {
+        const std::uint32_t numSamplesPerPixel =
+            mCurrentRenderParams.samplingParams.numSamplesPerPixel;
+        assert(mAccumulatedSampleCount <= numSamplesPerPixel);
+        // The frame count only seeds the sampling, so it is kept constant once the image has
+        // converged. The render params then stay the same and are no longer uploaded.
+        const RenderParamsLayout renderParamsLayout{
+            mCurrentRenderParams.framebufferSize,
+            mFrameCount,
+            mCurrentRenderParams,
+            mAccumulatedSampleCount,
+            mCurrentRenderParams.exposure};
+        mRenderParamsBuffer.write(mUploadRing, encoder, renderParamsLayout);
+        if (isAccumulating)
+        {
+            ++mFrameCount;
+            ++mAccumulatedSampleCount;
+        }
+    }
+
+    mSkyStateCache->update(mCurrentRenderParams.sky);
+    writeSkyState(mUploadRing, encoder, mSkyStateBuffer, *mSkyStateCache);
+
+    wgpuCommandEncoderWriteTimestamp(
+        encoder,
+        mTimestamps.querySet(),
+        offsetof(TimestampsLayout, pathTracePassBegin) / TimestampsLayout::MEMBER_SIZE);
+    {
+        const WGPUComputePassEncoder computePass = [encoder]() -> WGPUComputePassEncoder {
+            const WGPUComputePassDescriptor computePassDesc{
+                .nextInChain = nullptr,
+                .label = "Path trace compute pass",
+                .timestampWrites = nullptr,
+            };
+            return wgpuCommandEncoderBeginComputePass(encoder, &computePassDesc);
+        }();
+
+        if (mIntegrator == Integrator::Wavefront)
+        {
+            // The wavefront kernels have nothing to do once the image has converged, unlike the
+            // megakernel which checks the sample count itself.
+            if (isAccumulating)
+            {
+                encodeWavefrontPasses(computePass);
+            }
+        }
+        else
+        {
+            const std::array<double, 1> specializationValues{
+                static_cast<double>(mCurrentRenderParams.samplingParams.numBounces)};
+            const WGPUComputePipeline specializedPipeline =
+                mPathTracePipelines.pipeline(specializationValues);
+            wgpuComputePassEncoderSetPipeline(
+                computePass, specializedPipeline ? specializedPipeline : mPathTracePipeline.get());
+            wgpuComputePassEncoderSetBindGroup(
+                computePass, 0, mRenderParamsBindGroup.ptr(), 0, nullptr);
+            wgpuComputePassEncoderSetBindGroup(computePass, 1, mSceneBindGroup.ptr(), 0, nullptr);
+            wgpuComputePassEncoderSetBindGroup(computePass, 2, mImageBindGroup.ptr(), 0, nullptr);
+
+            const Extent2u&     framebufferSize = mCurrentRenderParams.framebufferSize;
+            const std::uint32_t workgroupCountX =
+                (framebufferSize.x + mWorkgroupSize.x - 1) / mWorkgroupSize.x;
+            const std::uint32_t workgroupCountY =
+                (framebufferSize.y + mWorkgroupSize.y - 1) / mWorkgroupSize.y;
+            wgpuComputePassEncoderDispatchWorkgroups(
+                computePass, workgroupCountX, workgroupCountY, 1);
+        }
+
+        wgpuComputePassEncoderEnd(computePass);
+    }
+    wgpuCommandEncoderWriteTimestamp(
+        encoder,
+        mTimestamps.querySet(),
+        offsetof(TimestampsLayout, pathTracePassEnd) / TimestampsLayout::MEMBER_SIZE);
+
+    wgpuCommandEncoderWriteTimestamp(
+        encoder,
+        mTimestamps.querySet(),
+        offsetof(TimestampsLayout, blitPassBegin) / TimestampsLayout::MEMBER_SIZE);
     {
         const WGPURenderPassEncoder renderPassEncoder = [encoder,
                                                          textureView]() -> WGPURenderPassEncoder {
@@ -620,7 +1163,7 @@ void ReferencePathTracer::render(
 
             const WGPURenderPassDescriptor renderPassDesc = {
                 .nextInChain = nullptr,
-                .label = "Render pass encoder",
+                .label = "Blit render pass encoder",
                 .colorAttachmentCount = 1,
                 .colorAttachments = &renderPassColorAttachment,
                 .depthStencilAttachment = nullptr,
@@ -632,28 +1175,29 @@ void ReferencePathTracer::render(
         }();
 
         {
-            wgpuRenderPassEncoderSetPipeline(renderPassEncoder, mRenderPipeline);
+            wgpuRenderPassEncoderSetPipeline(renderPassEncoder, mBlitPipeline.get());
             wgpuRenderPassEncoderSetBindGroup(
-                renderPassEncoder, 0, mRenderParamsBindGroup.ptr(), 0, nullptr);
+                renderPassEncoder, 0, mBlitRenderParamsBindGroup.ptr(), 0, nullptr);
             wgpuRenderPassEncoderSetBindGroup(
-                renderPassEncoder, 1, mSceneBindGroup.ptr(), 0, nullptr);
-            wgpuRenderPassEncoderSetBindGroup(
-                renderPassEncoder, 2, mImageBindGroup.ptr(), 0, nullptr);
+                renderPassEncoder, 1, mBlitImageBindGroup.ptr(), 0, nullptr);
             wgpuRenderPassEncoderSetVertexBuffer(
                 renderPassEncoder, 0, mVertexBuffer.ptr(), 0, mVertexBuffer.byteSize());
             wgpuRenderPassEncoderDraw(renderPassEncoder, 6, 1, 0, 0);
         }
 
-        gui.render(renderPassEncoder);
+        if (gui)
+        {
+            gui->render(renderPassEncoder);
+        }
 
         wgpuRenderPassEncoderEnd(renderPassEncoder);
     }
-    wgpuCommandEncoderWriteTimestamp(encoder, mQuerySet, 1);
+    wgpuCommandEncoderWriteTimestamp(
+        encoder,
+        mTimestamps.querySet(),
+        offsetof(TimestampsLayout, blitPassEnd) / TimestampsLayout::MEMBER_SIZE);
 
-    wgpuCommandEncoderResolveQuerySet(
-        encoder, mQuerySet, 0, TimestampsLayout::QUERY_COUNT, mQueryBuffer.ptr(), 0);
-    wgpuCommandEncoderCopyBufferToBuffer(
-        encoder, mQueryBuffer.ptr(), 0, mTimestampBuffer.ptr(), 0, sizeof(TimestampsLayout));
+    mTimestamps.resolve(encoder, isAccumulating ? mAccumulationCount : 0);
 
     const WGPUCommandBuffer cmdBuffer = [encoder]() {
         const WGPUCommandBufferDescriptor cmdBufferDesc{
@@ -662,57 +1206,176 @@ void ReferencePathTracer::render(
         };
         return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
     }();
-    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+    mUploadRing.submit(gpuContext.queue, cmdBuffer);
+    mTimestamps.readback();
 
-    // Map query timers
-    wgpuBufferMapAsync(
-        mTimestampBuffer.ptr(),
-        WGPUMapMode_Read,
-        0,
-        sizeof(TimestampsLayout),
-        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
-            if (status == WGPUBufferMapAsyncStatus_Success)
-            {
-                assert(userdata);
-                ReferencePathTracer& renderer = *static_cast<ReferencePathTracer*>(userdata);
-                GpuBuffer&           timestampBuffer = renderer.mTimestampBuffer;
-                const void*          bufferData = wgpuBufferGetConstMappedRange(
-                    timestampBuffer.ptr(), 0, sizeof(TimestampsLayout));
-                assert(bufferData);
-
-                const TimestampsLayout* const timestamps =
-                    reinterpret_cast<const TimestampsLayout*>(bufferData);
-
-                std::deque<std::uint64_t>& renderPassDurations = renderer.mRenderPassDurationsNs;
-                const std::uint64_t        renderPassDelta =
-                    timestamps->renderPassEnd - timestamps->renderPassBegin;
-
-                renderPassDurations.push_back(renderPassDelta);
-                if (renderPassDurations.size() > 30)
-                {
-                    renderPassDurations.pop_front();
-                }
-
-                wgpuBufferUnmap(timestampBuffer.ptr());
-            }
-            else
-            {
-                std::fprintf(stderr, "Failed to map query buffer\n");
-            }
-        },
-        this);
+    {
+        const auto cpuDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - cpuBegin);
+        mRenderCpuDurations.record(static_cast<std::uint64_t>(cpuDuration.count()));
+    }
+}
+
+void ReferencePathTracer::waitForTimestamps(const GpuContext& gpuContext)
+{
+    while (mTimestamps.hasPendingReadbacks())
+    {
+        wgpuDeviceTick(gpuContext.device);
+    }
+    recordTimestamps();
+}
+
+void ReferencePathTracer::recordTimestamps()
+{
+    mTimestamps.consume([this](
+                            const std::span<const std::uint64_t> timestamps,
+                            const std::uint64_t                  frameTag) -> void {
+        const auto timestamp = [timestamps](const std::size_t memberOffset) -> std::uint64_t {
+            return timestamps[memberOffset / TimestampsLayout::MEMBER_SIZE];
+        };
+        mPathTracePassDurations.record(
+            timestamp(offsetof(TimestampsLayout, pathTracePassEnd)) -
+            timestamp(offsetof(TimestampsLayout, pathTracePassBegin)));
+        mBlitPassDurations.record(
+            timestamp(offsetof(TimestampsLayout, blitPassEnd)) -
+            timestamp(offsetof(TimestampsLayout, blitPassBegin)));
+
+        // The timestamps arrive a few frames late, so only the frames which accumulated samples
+        // into the current accumulation are measured. Converged frames only blit the image, and
+        // changing the resolution once the image has converged would throw it away.
+        const bool isAccumulating =
+            mAccumulatedSampleCount < mCurrentRenderParams.samplingParams.numSamplesPerPixel;
+        if (frameTag != mAccumulationCount || !isAccumulating)
+        {
+            return;
+        }
+        const std::uint64_t frameDuration =
+            timestamp(offsetof(TimestampsLayout, blitPassEnd)) -
+            timestamp(offsetof(TimestampsLayout, pathTracePassBegin));
+        if (const auto decision = mDynamicResolution.record(frameDuration))
+        {
+            std::fprintf(
+                stderr,
+                "Dynamic resolution: %.2f ms average frame time (%.2f ms budget), render scale "
+                "%.3f -> %.3f\n",
+                decision->averageMs,
+                mDynamicResolution.targetFrameMs(),
+                DYNAMIC_RENDER_SCALES[decision->previousLevel],
+                DYNAMIC_RENDER_SCALES[decision->level]);
+            mCurrentRenderParams.framebufferSize = scaledFramebufferSize(
+                mTargetFramebufferSize, DYNAMIC_RENDER_SCALES[decision->level]);
+            mAccumulatedSampleCount = 0; // reset the temporal accumulation
+            ++mAccumulationCount;
+        }
+    });
 }
 
-float ReferencePathTracer::averageRenderpassDurationMs() const
+void ReferencePathTracer::encodeWavefrontPasses(const WGPUComputePassEncoder computePass) const
 {
-    if (mRenderPassDurationsNs.empty())
+    const auto setKernel = [this, computePass](const AsyncComputePipeline& pipeline) -> void {
+        wgpuComputePassEncoderSetPipeline(computePass, pipeline.get());
+        wgpuComputePassEncoderSetBindGroup(
+            computePass, 0, mRenderParamsBindGroup.ptr(), 0, nullptr);
+        wgpuComputePassEncoderSetBindGroup(computePass, 1, mSceneBindGroup.ptr(), 0, nullptr);
+        wgpuComputePassEncoderSetBindGroup(computePass, 2, mImageBindGroup.ptr(), 0, nullptr);
+        wgpuComputePassEncoderSetBindGroup(computePass, 3, mWavefrontBindGroup.ptr(), 0, nullptr);
+    };
+    const auto dispatchQueueKernel = [this, computePass](
+                                         const AsyncComputePipeline& pipeline) -> void {
+        wgpuComputePassEncoderSetPipeline(computePass, pipeline.get());
+        wgpuComputePassEncoderSetBindGroup(computePass, 0, mQueueBindGroup.ptr(), 0, nullptr);
+        wgpuComputePassEncoderDispatchWorkgroups(computePass, 1, 1, 1);
+    };
+    const auto dispatchIndirect = [this, computePass](const WavefrontDispatch dispatch) -> void {
+        wgpuComputePassEncoderDispatchWorkgroupsIndirect(
+            computePass,
+            mDispatchArgsBuffer.ptr(),
+            dispatch * WAVEFRONT_DISPATCH_ARGS_BYTE_SIZE);
+    };
+    // The persistent-threads kernels fetch their work from the queues, so the traversal kernels are
+    // dispatched with a fixed number of workgroups instead.
+    const auto dispatchTraversal = [this, computePass, &dispatchIndirect](
+                                       const WavefrontDispatch dispatch) -> void {
+        if (mTraversal == Traversal::ShortStack)
+        {
+            wgpuComputePassEncoderDispatchWorkgroups(
+                computePass,
+                PERSISTENT_INVOCATION_COUNT / (mWorkgroupSize.x * mWorkgroupSize.y),
+                1,
+                1);
+        }
+        else
+        {
+            dispatchIndirect(dispatch);
+        }
+    };
+
+    const Extent2u& framebufferSize = mCurrentRenderParams.framebufferSize;
+    const Extent2u  pixelDispatchSize = wavefrontDispatchSize(
+        framebufferSize.x * framebufferSize.y, mWorkgroupSize.x * mWorkgroupSize.y);
+
+    setKernel(mWavefrontPipelines.generate);
+    wgpuComputePassEncoderDispatchWorkgroups(
+        computePass, pixelDispatchSize.x, pixelDispatchSize.y, 1);
+
+    // The bounce loop is unrolled on the CPU. Bounces after all paths have terminated dispatch
+    // zero workgroups.
+    for (std::uint32_t bounce = 1; bounce <= mCurrentRenderParams.samplingParams.numBounces;
+         ++bounce)
     {
-        return 0.0f;
+        dispatchQueueKernel(mWavefrontPipelines.beginBounce);
+
+        setKernel(mWavefrontPipelines.extend);
+        dispatchTraversal(WavefrontDispatch_Extend);
+
+        dispatchQueueKernel(mWavefrontPipelines.prepareShade);
+
+        setKernel(mWavefrontPipelines.miss);
+        dispatchIndirect(WavefrontDispatch_Miss);
+        setKernel(mWavefrontPipelines.shade);
+        dispatchIndirect(WavefrontDispatch_Shade);
+        // The shadow rays of the shaded paths.
+        setKernel(mWavefrontPipelines.shadow);
+        dispatchTraversal(WavefrontDispatch_Shade);
     }
 
-    const std::uint64_t sum = std::accumulate(
-        mRenderPassDurationsNs.begin(), mRenderPassDurationsNs.end(), std::uint64_t(0));
-    return 0.000001f * static_cast<float>(sum) / mRenderPassDurationsNs.size();
+    setKernel(mWavefrontPipelines.accumulate);
+    wgpuComputePassEncoderDispatchWorkgroups(
+        computePass, pixelDispatchSize.x, pixelDispatchSize.y, 1);
+}
+
+bool ReferencePathTracer::WavefrontPipelines::isReady() const noexcept
+{
+    return generate.isReady() && extend.isReady() && miss.isReady() && shade.isReady() &&
+           shadow.isReady() && accumulate.isReady() && beginBounce.isReady() &&
+           prepareShade.isReady();
+}
+
+bool ReferencePathTracer::WavefrontPipelines::hasFailed() const noexcept
+{
+    return generate.hasFailed() || extend.hasFailed() || miss.hasFailed() || shade.hasFailed() ||
+           shadow.hasFailed() || accumulate.hasFailed() || beginBounce.hasFailed() ||
+           prepareShade.hasFailed();
+}
+
+DurationHistogram::Summary ReferencePathTracer::pathTracePassDurations() const
+{
+    return mPathTracePassDurations.summary();
+}
+
+DurationHistogram::Summary ReferencePathTracer::blitPassDurations() const
+{
+    return mBlitPassDurations.summary();
+}
+
+DurationHistogram::Summary ReferencePathTracer::renderCpuDurations() const
+{
+    return mRenderCpuDurations.summary();
+}
+
+float ReferencePathTracer::averageUploadByteSize() const
+{
+    return mUploadRing.averageUploadByteSize();
 }
 
 float ReferencePathTracer::renderProgressPercentage() const
@@ -720,4 +1383,93 @@ float ReferencePathTracer::renderProgressPercentage() const
     return 100.0f * static_cast<float>(mAccumulatedSampleCount) /
            static_cast<float>(mCurrentRenderParams.samplingParams.numSamplesPerPixel);
 }
+
+float ReferencePathTracer::renderScale() const
+{
+    return DYNAMIC_RENDER_SCALES[mDynamicResolution.level()];
+}
+
+std::vector<BvhNode> ReferencePathTracer::readBvhNodes(const GpuContext& gpuContext) const
+{
+    return nlrs::readBvhNodes(
+        gpuContext, mBvhNodeBuffer, mBvhNodeBuffer.byteSize() / sizeof(BvhNode));
+}
+
+std::vector<glm::vec3> ReferencePathTracer::readRadiance(const GpuContext& gpuContext) const
+{
+    const Extent2u    renderSize = mCurrentRenderParams.framebufferSize;
+    const std::size_t byteSize = sizeof(glm::vec4) * area(renderSize);
+    NLRS_ASSERT(mImageBuffer.byteSize() >= byteSize);
+
+    const GpuBuffer readbackBuffer(
+        gpuContext.device,
+        "image readback buffer",
+        {GpuBufferUsage::CopyDst, GpuBufferUsage::MapRead},
+        byteSize);
+
+    const WGPUCommandEncoder encoder = [&gpuContext]() {
+        const WGPUCommandEncoderDescriptor cmdEncoderDesc{
+            .nextInChain = nullptr,
+            .label = "Image readback command encoder",
+        };
+        return wgpuDeviceCreateCommandEncoder(gpuContext.device, &cmdEncoderDesc);
+    }();
+    wgpuCommandEncoderCopyBufferToBuffer(
+        encoder, mImageBuffer.ptr(), 0, readbackBuffer.ptr(), 0, byteSize);
+    const WGPUCommandBuffer cmdBuffer = [encoder]() {
+        const WGPUCommandBufferDescriptor cmdBufferDesc{
+            .nextInChain = nullptr,
+            .label = "Image readback command buffer",
+        };
+        return wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    }();
+    wgpuQueueSubmit(gpuContext.queue, 1, &cmdBuffer);
+
+    MapResult mapResult;
+    wgpuBufferMapAsync(
+        readbackBuffer.ptr(),
+        WGPUMapMode_Read,
+        0,
+        byteSize,
+        [](const WGPUBufferMapAsyncStatus status, void* const userdata) -> void {
+            NLRS_ASSERT(userdata != nullptr);
+            MapResult& result = *static_cast<MapResult*>(userdata);
+            result.status = status;
+            result.done = true;
+        },
+        &mapResult);
+
+    // Non-standard Dawn way to ensure that Dawn ticks pending async operations.
+    while (!mapResult.done)
+    {
+        wgpuDeviceTick(gpuContext.device);
+    }
+
+    if (mapResult.status != WGPUBufferMapAsyncStatus_Success)
+    {
+        throw std::runtime_error("Failed to map image readback buffer.");
+    }
+
+    const glm::vec4* const sums = static_cast<const glm::vec4*>(
+        wgpuBufferGetConstMappedRange(readbackBuffer.ptr(), 0, byteSize));
+    NLRS_ASSERT(sums != nullptr);
+
+    // The image buffer holds the sum of the accumulated samples, at the dynamic render scale. Like
+    // the blit pass, the sums are averaged and the render size is upscaled to the target size.
+    const float            sampleCount = static_cast<float>(std::max(mAccumulatedSampleCount, 1u));
+    std::vector<glm::vec3> radiance(area(mTargetFramebufferSize));
+    for (std::uint32_t y = 0; y < mTargetFramebufferSize.y; ++y)
+    {
+        const std::uint32_t sy = y * renderSize.y / mTargetFramebufferSize.y;
+        for (std::uint32_t x = 0; x < mTargetFramebufferSize.x; ++x)
+        {
+            const std::uint32_t sx = x * renderSize.x / mTargetFramebufferSize.x;
+            radiance[y * mTargetFramebufferSize.x + x] =
+                glm::vec3(sums[sy * renderSize.x + sx]) / sampleCount;
+        }
+    }
+    wgpuBufferUnmap(readbackBuffer.ptr());
+
+    return radiance;
+}
 } // namespace nlrs
@@ -1,21 +1,32 @@
 #pragma once
 
 #include "aligned_sky_state.hpp"
+#include "async_pipeline.hpp"
+#include "compute_pipeline_cache.hpp"
 #include "gpu_bind_group.hpp"
 #include "gpu_buffer.hpp"
+#include "gpu_limits.hpp"
+#include "gpu_timestamp_ring.hpp"
+#include "gpu_tracked_buffer.hpp"
+#include "gpu_upload_ring.hpp"
 
 #include <common/bvh.hpp>
 #include <common/camera.hpp>
+#include <common/duration_histogram.hpp>
+#include <common/dynamic_resolution.hpp>
 #include <common/extent.hpp>
 #include <common/texture.hpp>
+#include <common/texture_layout.hpp>
 #include <pt-format/vertex_attributes.hpp>
 
+#include <glm/glm.hpp>
 #include <webgpu/webgpu.h>
 
 #include <array>
 #include <cstdint>
-#include <deque>
+#include <memory>
 #include <span>
+#include <vector>
 
 namespace nlrs
 {
@@ -50,10 +61,48 @@ struct Scene
     std::span<const Texture>           baseColorTextures;
 };
 
+// The megakernel traces each path to completion in a single compute kernel. The wavefront
+// integrator splits the bounce loop into separate kernels, which only process the live paths.
+enum class Integrator
+{
+    Megakernel,
+    Wavefront,
+};
+
+// The offline builder uploads the SAH BVH from the pt file. The GPU builder builds an LBVH over the
+// triangles in GPU memory instead, see `GpuBvhBuilder`. An LBVH which is too deep for the traversal
+// stack is replaced by the offline BVH.
+enum class BvhBuilder
+{
+    Offline,
+    Gpu,
+};
+
+// The stack traversal keeps a full stack of nodes to visit per invocation. The short-stack
+// traversal keeps a few entries per invocation in workgroup memory, and restarts from the root when
+// they run out. It runs in persistent threads, which fetch batches of rays until the queue is
+// empty. Only the wavefront integrator supports the short-stack traversal.
+enum class Traversal
+{
+    Stack,
+    ShortStack,
+};
+
 struct RendererDescriptor
 {
-    RenderParameters renderParams;
-    Extent2i         maxFramebufferSize;
+    RenderParameters               renderParams;
+    Extent2i                       maxFramebufferSize;
+    TextureLayout                  textureLayout = TextureLayout::Tiled;
+    std::shared_ptr<SkyStateCache> skyStateCache;
+    // The 2D workgroup tile of the path tracing compute pass. The wavefront kernels are 1D, and
+    // use workgroups of the same number of invocations.
+    Extent2u   workgroupSize = Extent2u(8, 8);
+    Integrator integrator = Integrator::Megakernel;
+    BvhBuilder bvhBuilder = BvhBuilder::Offline;
+    Traversal  traversal = Traversal::Stack;
+    // When non-zero, the image is rendered at a dynamically scaled resolution which keeps the GPU
+    // frame time within this budget while accumulating samples.
+    float      targetFrameMs = 0.0f;
 };
 
 class ReferencePathTracer
@@ -69,35 +118,105 @@ public:
 
     ~ReferencePathTracer();
 
-    void setRenderParameters(const RenderParameters&);
-    void render(const GpuContext&, WGPUTextureView, Gui&);
+    // The pipelines are compiled asynchronously. `render` must not be called until they are ready,
+    // which requires ticking the device. If a pipeline fails to compile, the renderer never becomes
+    // ready.
+    bool isReady() const;
+    bool hasFailed() const;
 
-    float averageRenderpassDurationMs() const;
+    void setRenderParameters(const RenderParameters&);
+    // Starts compiling the megakernel pipelines specialized for `numBounces`, e.g. for the bounce
+    // counts which can be selected in the GUI. Until a specialized pipeline has compiled, a generic
+    // pipeline reads the bounce count from the render params.
+    void specializeBounceCounts(std::span<const std::uint32_t> numBounces);
+    // The GUI is drawn on top of the image, unless `gui` is null, e.g. when rendering headless.
+    void render(const GpuContext&, WGPUTextureView, Gui*);
+
+    // The GPU pass durations of the most recent frames whose timestamps have been read back.
+    DurationHistogram::Summary pathTracePassDurations() const;
+    DurationHistogram::Summary blitPassDurations() const;
+    // The CPU time spent in `render`.
+    DurationHistogram::Summary renderCpuDurations() const;
+    // The bytes uploaded per frame through the upload ring.
+    float averageUploadByteSize() const;
     float renderProgressPercentage() const;
+    // The fraction of the framebuffer's width and height which is rendered. Dynamic resolution
+    // lowers it to keep the frame time within the budget.
+    float renderScale() const;
+    // Blocks until the timestamps of the submitted frames have been read back, e.g. before
+    // reporting the pass durations of a headless run.
+    void  waitForTimestamps(const GpuContext&);
+
+    // Copies the BVH nodes back from GPU memory, e.g. to validate the GPU builder. Blocks until the
+    // copy has completed.
+    std::vector<BvhNode> readBvhNodes(const GpuContext&) const;
+    // Copies the accumulated image back from GPU memory as linear radiance, before exposure and
+    // tonemapping. The rows are ordered top to bottom. Blocks until the copy has completed.
+    std::vector<glm::vec3> readRadiance(const GpuContext&) const;
 
 private:
-    GpuBuffer          mVertexBuffer;
-    GpuBuffer          mRenderParamsBuffer;
-    GpuBuffer          mSkyStateBuffer;
-    GpuBindGroup       mRenderParamsBindGroup;
-    GpuBuffer          mBvhNodeBuffer;
-    GpuBuffer          mPositionAttributesBuffer;
-    GpuBuffer          mVertexAttributesBuffer;
-    GpuBuffer          mTextureDescriptorBuffer;
-    GpuBuffer          mTextureBuffer;
-    GpuBuffer          mBlueNoiseBuffer;
-    GpuBindGroup       mSceneBindGroup;
-    GpuBuffer          mImageBuffer;
-    GpuBindGroup       mImageBindGroup;
-    WGPUQuerySet       mQuerySet;
-    GpuBuffer          mQueryBuffer;
-    GpuBuffer          mTimestampBuffer;
-    WGPURenderPipeline mRenderPipeline;
-
-    RenderParameters mCurrentRenderParams;
-    std::uint32_t    mFrameCount;
-    std::uint32_t    mAccumulatedSampleCount;
-
-    std::deque<std::uint64_t> mRenderPassDurationsNs;
+    void encodeWavefrontPasses(WGPUComputePassEncoder) const;
+    void recordTimestamps();
+
+    struct WavefrontPipelines
+    {
+        AsyncComputePipeline generate;
+        AsyncComputePipeline extend;
+        AsyncComputePipeline miss;
+        AsyncComputePipeline shade;
+        AsyncComputePipeline shadow;
+        AsyncComputePipeline accumulate;
+        AsyncComputePipeline beginBounce;
+        AsyncComputePipeline prepareShade;
+
+        bool isReady() const noexcept;
+        bool hasFailed() const noexcept;
+    };
+
+    GpuBuffer                                 mVertexBuffer;
+    GpuTrackedBuffer                          mRenderParamsBuffer;
+    GpuTrackedBuffer                          mSkyStateBuffer;
+    GpuUploadRing                             mUploadRing;
+    GpuBindGroup                              mRenderParamsBindGroup;
+    GpuBuffer                                 mBvhNodeBuffer;
+    GpuBuffer                                 mPositionAttributesBuffer;
+    GpuBuffer                                 mVertexAttributesBuffer;
+    GpuBuffer                                 mTextureDescriptorBuffer;
+    std::array<GpuBuffer, TEXTURE_PAGE_COUNT> mTexturePageBuffers;
+    GpuBuffer                                 mBlueNoiseBuffer;
+    GpuBindGroup                              mSceneBindGroup;
+    GpuBuffer                                 mImageBuffer;
+    GpuBindGroup                              mImageBindGroup;
+    GpuBuffer                                 mQueueStateBuffer;
+    GpuBuffer                                 mQueueBuffer;
+    GpuBuffer                                 mPathStateBuffer;
+    GpuBuffer                                 mDispatchArgsBuffer;
+    GpuBindGroup                              mWavefrontBindGroup;
+    GpuBindGroup                              mQueueBindGroup;
+    GpuBindGroup                              mBlitRenderParamsBindGroup;
+    GpuBindGroup                              mBlitImageBindGroup;
+    GpuTimestampRing                          mTimestamps;
+    AsyncComputePipeline                      mPathTracePipeline;
+    ComputePipelineCache                      mPathTracePipelines;
+    WavefrontPipelines                        mWavefrontPipelines;
+    AsyncRenderPipeline                       mBlitPipeline;
+
+    RenderParameters               mCurrentRenderParams;
+    // The framebuffer size of the render params before the dynamic resolution's scale is applied.
+    Extent2u                       mTargetFramebufferSize;
+    DynamicResolutionController    mDynamicResolution;
+    std::shared_ptr<SkyStateCache> mSkyStateCache;
+    Extent2u                       mWorkgroupSize;
+    Integrator                     mIntegrator;
+    Traversal                      mTraversal;
+    std::uint32_t                  mFrameCount;
+    std::uint32_t                  mAccumulatedSampleCount;
+    // Counts the accumulations, starting from one. The timestamps of each frame are tagged with
+    // the frame's accumulation, or with zero if the image had already converged.
+    std::uint32_t                  mAccumulationCount;
+
+    DurationHistogram mPathTracePassDurations;
+    DurationHistogram mBlitPassDurations;
+    DurationHistogram mRenderCpuDurations;
 };
 } // namespace nlrs
@@ -0,0 +1,77 @@
+struct VertexInput {
+    @location(0) position: vec2f,
+}
+
+struct VertexOutput {
+    @builtin(position) position: vec4f,
+    @location(0) texCoord: vec2f,
+}
+
+@vertex
+fn vsMain(in: VertexInput) -> VertexOutput {
+    let uv = 0.5 * in.position + vec2f(0.5);
+    var out: VertexOutput;
+    out.position = vec4f(in.position, 0.0, 1.0);
+    out.texCoord = vec2f(uv.x, 1.0 - uv.y);
+    return out;
+}
+
+// render params bind group
+@group(0) @binding(0) var<uniform> renderParams: RenderParams;
+
+// image bind group
+@group(1) @binding(0) var<storage, read> imageBuffer: array<vec3f>;
+
+@fragment
+fn fsMain(in: VertexOutput) -> @location(0) vec4f {
+    let dimensions = renderParams.frameData.dimensions;
+    let coord = vec2u(u32(in.texCoord.x * f32(dimensions.x)), u32(in.texCoord.y * f32(dimensions.y)));
+    let idx = coord.y * dimensions.x + coord.x;
+
+    // The path tracing pass has already added this frame's sample, unless the image has converged.
+    let samplingState = renderParams.samplingState;
+    let sampleCount = min(samplingState.accumulatedSampleCount + 1u, samplingState.numSamplesPerPixel);
+    let estimator = imageBuffer[idx] / f32(sampleCount);
+
+    let rgb = acesFilmic(renderParams.exposure * estimator);
+    let srgb = pow(rgb, vec3(1.0 / 2.2));
+    return vec4f(srgb, 1f);
+}
+
+struct RenderParams {
+  frameData: FrameData,
+  camera: Camera,
+  samplingState: SamplingState,
+  @align(16) exposure: f32,
+}
+
+struct FrameData {
+    dimensions: vec2u,
+    frameCount: u32,
+}
+
+struct Camera {
+    origin: vec3f,
+    lowerLeftCorner: vec3f,
+    horizontal: vec3f,
+    vertical: vec3f,
+    up: vec3f,
+    right: vec3f,
+    lensRadius: f32,
+}
+
+struct SamplingState {
+    numSamplesPerPixel: u32,
+    numBounces: u32,
+    accumulatedSampleCount: u32,
+}
+
+@must_use
+fn acesFilmic(x: vec3f) -> vec3f {
+    let a = 2.51f;
+    let b = 0.03f;
+    let c = 2.43f;
+    let d = 0.59f;
+    let e = 0.14f;
+    return saturate((x * (a * x + b)) / (x * (c * x + d) + e));
+}
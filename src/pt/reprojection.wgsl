@@ -0,0 +1,72 @@
+// Reprojection of the current frame's surfaces into the previous frame, and the surface comparisons
+// used to reject mismatching history.
+
+// History is rejected if the reprojected depth differs by more than this fraction, or if the
+// cosine of the angle between the normals is below the normal tolerance.
+const DEPTH_TOLERANCE = 0.1f;
+const NORMAL_TOLERANCE = 0.9f;
+
+// Reprojects the surface at the uv and reverse-z depth of the current frame into the previous
+// frame. Returns the previous frame's uv and reverse-z depth, and a w of zero if the surface was
+// behind the previous frame's camera.
+@must_use
+fn reprojectToPreviousFrame(
+    uv: vec2f,
+    depth: f32,
+    inverseViewProjectionMat: mat4x4f,
+    previousViewProjectionMat: mat4x4f
+) -> vec4f {
+    // The homogeneous position is reprojected without dividing by w, so that the sky's points at
+    // infinity reproject as directions.
+    let ndc = vec4f(2f * vec2f(uv.x, 1f - uv.y) - vec2f(1f), depth, 1f);
+    let world = inverseViewProjectionMat * ndc;
+    let previousClip = previousViewProjectionMat * world;
+    if previousClip.w <= 0f {
+        return vec4f(0f);
+    }
+    let previousNdc = previousClip.xyz / previousClip.w;
+    let previousUv = vec2f(0.5f * previousNdc.x + 0.5f, 0.5f - 0.5f * previousNdc.y);
+    return vec4f(previousUv, previousNdc.z, 1f);
+}
+
+// Compares the history with the surface, given the surface's depth in the current frame and its
+// reprojected depth in the previous frame. The relative difference of reverse-z depths equals the
+// relative difference of view depths.
+@must_use
+fn isSameSurface(
+    depth: f32,
+    reprojectedDepth: f32,
+    normal: vec3f,
+    historyDepth: f32,
+    historyNormal: vec3f
+) -> bool {
+    if depth == 0f || historyDepth == 0f {
+        return depth == historyDepth;
+    }
+    let depthDifference = abs(reprojectedDepth - historyDepth);
+    return depthDifference <= DEPTH_TOLERANCE * max(reprojectedDepth, historyDepth) &&
+        dot(normal, historyNormal) >= NORMAL_TOLERANCE;
+}
+
+@must_use
+fn octEncode(n: vec3f) -> vec2f {
+    let p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    if n.z >= 0f {
+        return p;
+    }
+    return (vec2f(1f) - abs(p.yx)) * signNotZero(p);
+}
+
+@must_use
+fn octDecode(e: vec2f) -> vec3f {
+    var n = vec3f(e, 1f - abs(e.x) - abs(e.y));
+    if n.z < 0f {
+        n = vec3f((vec2f(1f) - abs(n.yx)) * signNotZero(n.xy), n.z);
+    }
+    return normalize(n);
+}
+
+@must_use
+fn signNotZero(v: vec2f) -> vec2f {
+    return select(vec2f(-1f), vec2f(1f), v >= vec2f(0f));
+}
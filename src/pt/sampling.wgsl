@@ -0,0 +1,86 @@
+// Shared sampling routines. The including shader declares the `blueNoise` binding.
+
+const EPSILON = 0.00001f;
+
+const PI = 3.1415927f;
+const FRAC_1_PI = 0.31830987f;
+const FRAC_PI_2 = 1.5707964f;
+
+const ONE_MINUS_EPSILON = 0.99999994f;
+
+struct BlueNoise {
+    width: u32,
+    height: u32,
+    data: array<vec2f>,
+}
+
+@must_use
+fn animatedBlueNoise(coord: vec2u, frameIdx: u32, totalSampleCount: u32) -> vec2f {
+    let idx = (coord.y % blueNoise.height) * blueNoise.width + (coord.x % blueNoise.width);
+    let blueNoise = blueNoise.data[idx];
+    // 2-dimensional golden ratio additive recurrence sequence
+    // https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
+    let n = frameIdx % totalSampleCount;
+    let a1 = 0.7548776662466927f;
+    let a2 = 0.5698402909980532f;
+    let r2Seq = fract(vec2(
+        a1 * f32(n),
+        a2 * f32(n)
+    ));
+    return fract(blueNoise + r2Seq);
+}
+
+// The power heuristic with an exponent of two, for combining light and BSDF samples.
+@must_use
+fn powerHeuristic(pdf: f32, otherPdf: f32) -> f32 {
+    let a = pdf * pdf;
+    let b = otherPdf * otherPdf;
+    return select(0f, a / (a + b), a > 0f);
+}
+
+@must_use
+fn pixarOnb(n: vec3f) -> mat3x3f {
+    // https://www.jcgt.org/published/0006/01/01/paper-lowres.pdf
+    let s = select(-1f, 1f, n.z >= 0f);
+    let a = -1f / (s + n.z);
+    let b = n.x * n.y * a;
+    let u = vec3(1f + s * n.x * n.x * a, s * b, -s * n.x);
+    let v = vec3(b, s + n.y * n.y * a, -n.y);
+
+    return mat3x3(u, v, n);
+}
+
+// `u` is a random number in [0, 1].
+@must_use
+fn directionInCone(u: vec2f, cosThetaMax: f32) -> vec3f {
+    let cosTheta = 1f - u.x * (1f - cosThetaMax);
+    let sinTheta = sqrt(1f - cosTheta * cosTheta);
+    let phi = 2f * PI * u.y;
+
+    let x = cos(phi) * sinTheta;
+    let y = sin(phi) * sinTheta;
+    let z = cosTheta;
+
+    return vec3(x, y, z);
+}
+
+// `u` is a random number in [0, 1].
+@must_use
+fn directionInCosineWeightedHemisphere(u: vec2f) -> vec3f {
+    let phi = 2f * PI * u.y;
+    let sinTheta = sqrt(1f - u.x);
+
+    let x = cos(phi) * sinTheta;
+    let y = sin(phi) * sinTheta;
+    let z = sqrt(u.x);
+
+    return vec3(x, y, z);
+}
+
+// `u` is a random number in [0, 1]
+@must_use
+fn pointInUnitDisk(u: vec2f) -> vec2f {
+    let r = sqrt(u.x);
+    let theta = 2f * PI * u.y;
+    return vec2(r * cos(theta), r * sin(theta));
+}
@@ -0,0 +1,65 @@
+// Closest-hit BVH traversal, which interpolates the vertex attributes at the hit. The including
+// shader declares the `bvhNodes`, `positionAttributes`, and `vertexAttributes` bindings.
+
+#include "ray_intersection.wgsl"
+
+@must_use
+fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, Intersection>) -> bool {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, tmax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                        tmax = trihit.t;
+                        didIntersect = true;
+
+                        let b = trihit.b;
+                        let triangleIdx = node.trianglesOffset + idx;
+                        let vert = vertexAttributes[triangleIdx];
+
+                        let p = trihit.p;
+                        let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
+                        let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
+                        let textureDescriptorIdx = vertexAttributes[triangleIdx].textureDescriptorIdx;
+
+                        *hit = Intersection(p, n, uv, textureDescriptorIdx);
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return didIntersect;
+}
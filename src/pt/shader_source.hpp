@@ -4,125 +4,21 @@
 
 namespace nlrs
 {
-const char* const REFERENCE_PATH_TRACER_SOURCE = R"(struct VertexInput {
-    @location(0) position: vec2f,
-}
-
-struct VertexOutput {
-    @builtin(position) position: vec4f,
-    @location(0) texCoord: vec2f,
-}
-
-@vertex
-fn vsMain(in: VertexInput) -> VertexOutput {
-    let uv = 0.5 * in.position + vec2f(0.5);
-    var out: VertexOutput;
-    out.position = vec4f(in.position, 0.0, 1.0);
-    out.texCoord = vec2f(uv.x, 1.0 - uv.y);
-    return out;
-}
-
-// render params bind group
-@group(0) @binding(0) var<uniform> renderParams: RenderParams;
-@group(0) @binding(1) var<storage, read> skyState: SkyState;
-
-// scene bind group
-@group(1) @binding(0) var<storage, read> bvhNodes: array<BvhNode>;
-@group(1) @binding(1) var<storage, read> positionAttributes: array<Positions>;
-@group(1) @binding(2) var<storage, read> vertexAttributes: array<VertexAttributes>;
-@group(1) @binding(3) var<storage, read> textureDescriptors: array<TextureDescriptor>;
-@group(1) @binding(4) var<storage, read> textures: array<u32>;
-@group(1) @binding(5) var<storage, read> blueNoise: BlueNoise;
-
-// image bind group
-@group(2) @binding(0) var<storage, read_write> imageBuffer: array<vec3f>;
-
-@fragment
-fn fsMain(in: VertexOutput) -> @location(0) vec4f {
-    let u = in.texCoord.x;
-    let v = in.texCoord.y;
-
-    let dimensions = renderParams.frameData.dimensions;
-    let frameCount = renderParams.frameData.frameCount;
-
-    let coord = vec2u(u32(u * f32(dimensions.x)), u32(v * f32(dimensions.y)));
-    let idx = coord.y * dimensions.x + coord.x;
-
-    var accumulatedSampleCount = renderParams.samplingState.accumulatedSampleCount;
-
-    if accumulatedSampleCount == 0u {
-        imageBuffer[idx] = vec3(0f);
-    }
-
-    if accumulatedSampleCount < renderParams.samplingState.numSamplesPerPixel {
-        let blueNoise = animatedBlueNoise(coord, renderParams.frameData.frameCount, renderParams.samplingState.numSamplesPerPixel);
-        let jitter = blueNoise / vec2f(dimensions);
-        let primaryRay = generateCameraRay(blueNoise, renderParams.camera, u + jitter.x, (1.0 - v) + jitter.y);
-        imageBuffer[idx] += rayColor(blueNoise, primaryRay, coord);
-        accumulatedSampleCount += 1u;
-    }
-
-    let estimator = imageBuffer[idx] / f32(accumulatedSampleCount);
+const char* const REFERENCE_PATH_TRACER_SOURCE = R"(// Closest-hit BVH traversal, which interpolates the vertex attributes at the hit. The including
+// shader declares the `bvhNodes`, `positionAttributes`, and `vertexAttributes` bindings.
 
-    let rgb = acesFilmic(renderParams.exposure * estimator);
-    let srgb = pow(rgb, vec3(1.0 / 2.2));
-    return vec4f(srgb, 1f);
-}
-
-const EPSILON = 0.00001f;
-
-const PI = 3.1415927f;
-const FRAC_1_PI = 0.31830987f;
-const FRAC_PI_2 = 1.5707964f;
+// Ray-primitive intersection and BVH visibility queries. The including shader declares the
+// `bvhNodes` and `positionAttributes` bindings.
 
 const T_MIN = 0.001f;
-const T_MAX = 10000f;
-
-const CHANNEL_R = 0u;
-const CHANNEL_G = 1u;
-const CHANNEL_B = 2u;
-
-const DEGREES_TO_RADIANS = PI / 180f;
-const TERRESTRIAL_SOLAR_RADIUS = 0.255f * DEGREES_TO_RADIANS;
-
-const SOLAR_COS_THETA_MAX = cos(TERRESTRIAL_SOLAR_RADIUS);
-const SOLAR_INV_PDF = 2f * PI * (1f - SOLAR_COS_THETA_MAX);
-
-struct RenderParams {
-  frameData: FrameData,
-  camera: Camera,
-  samplingState: SamplingState,
-  @align(16) exposure: f32,
-}
-
-struct FrameData {
-    dimensions: vec2u,
-    frameCount: u32,
-}
+// The maximum ray extent. Specializing it lets the compiler fold it into the traversal.
+override T_MAX: f32 = 10000f;
 
-struct Camera {
+struct Ray {
     origin: vec3f,
-    lowerLeftCorner: vec3f,
-    horizontal: vec3f,
-    vertical: vec3f,
-    up: vec3f,
-    right: vec3f,
-    lensRadius: f32,
-}
-
-struct SamplingState {
-    numSamplesPerPixel: u32,
-    numBounces: u32,
-    accumulatedSampleCount: u32,
+    direction: vec3f
 }
 
-struct SkyState {
-    params: array<f32, 27>,
-    skyRadiances: array<f32, 3>,
-    solarRadiances: array<f32, 3>,
-    sunDirection: vec3<f32>,
-};
-
 struct Aabb {
     min: vec3f,
     max: vec3f,
@@ -154,11 +50,6 @@ struct VertexAttributes {
     textureDescriptorIdx: u32,
 }
 
-struct Ray {
-    origin: vec3f,
-    direction: vec3f
-}
-
 struct Intersection {
     p: vec3f,
     n: vec3f,
@@ -172,158 +63,6 @@ struct TriangleHit {
     t: f32,
 }
 
-struct Scatter {
-    wi: vec3f,
-    throughput: vec3f,
-}
-
-struct BlueNoise {
-    width: u32,
-    height: u32,
-    data: array<vec2f>,
-}
-
-@must_use
-fn rayColor(blueNoise: vec2f, primaryRay: Ray, coord: vec2u) -> vec3f {
-    var ray = primaryRay;
-    var radiance = vec3(0f);
-    var throughput = vec3(1f);
-
-    var bounce = 1u;
-    let numBounces = renderParams.samplingState.numBounces;
-    loop {
-        var hit: Intersection;
-        if rayIntersectBvh(ray, T_MAX, &hit) {
-            let albedo = evalTexture(hit.textureDescriptorIdx, hit.uv);
-            let p = hit.p;
-
-            let lightDirection = sampleSolarDiskDirection(blueNoise, SOLAR_COS_THETA_MAX, skyState.sunDirection);
-            let lightIntensity = vec3(
-                skyState.solarRadiances[CHANNEL_R],
-                skyState.solarRadiances[CHANNEL_G],
-                skyState.solarRadiances[CHANNEL_B]
-            );
-            let brdf = albedo * FRAC_1_PI;
-            let reflectance = brdf * dot(hit.n, lightDirection);
-            let lightVisibility = shadowRay(Ray(p, lightDirection), T_MAX);
-            radiance += throughput * lightIntensity * reflectance * lightVisibility * SOLAR_INV_PDF;
-
-            if bounce == numBounces {
-                break;
-            }
-
-            let scatter = evalImplicitLambertian(blueNoise, hit.n, albedo);
-            ray = Ray(p, scatter.wi);
-            throughput *= scatter.throughput;
-        } else {
-            let v = ray.direction;
-            let s = skyState.sunDirection;
-
-            let theta = acos(v.y);
-            let gamma = acos(clamp(dot(v, s), -1f, 1f));
-
-            let skyRadiance = vec3f(
-                skyRadiance(theta, gamma, CHANNEL_R),
-                skyRadiance(theta, gamma, CHANNEL_G),
-                skyRadiance(theta, gamma, CHANNEL_B)
-            );
-
-            radiance += throughput * skyRadiance;
-
-            break;
-        }
-
-        bounce += 1u;
-    }
-
-    return radiance;
-}
-
-@must_use
-fn generateCameraRay(noise: vec2f, camera: Camera, u: f32, v: f32) -> Ray {
-    let randomPointInLens = camera.lensRadius * pointInUnitDisk(noise);
-    let lensOffset = randomPointInLens.x * camera.right + randomPointInLens.y * camera.up;
-
-    let origin = camera.origin + lensOffset;
-    let direction = normalize(camera.lowerLeftCorner + u * camera.horizontal + v * camera.vertical - origin);
-
-    return Ray(origin, direction);
-}
-
-@must_use
-fn skyRadiance(theta: f32, gamma: f32, channel: u32) -> f32 {
-    let r = skyState.skyRadiances[channel];
-    let idx = 9u * channel;
-    let p0 = skyState.params[idx + 0u];
-    let p1 = skyState.params[idx + 1u];
-    let p2 = skyState.params[idx + 2u];
-    let p3 = skyState.params[idx + 3u];
-    let p4 = skyState.params[idx + 4u];
-    let p5 = skyState.params[idx + 5u];
-    let p6 = skyState.params[idx + 6u];
-    let p7 = skyState.params[idx + 7u];
-    let p8 = skyState.params[idx + 8u];
-
-    let cosGamma = cos(gamma);
-    let cosGamma2 = cosGamma * cosGamma;
-    let cosTheta = abs(cos(theta));
-
-    let expM = exp(p4 * gamma);
-    let rayM = cosGamma2;
-    let mieMLhs = 1.0 + cosGamma2;
-    let mieMRhs = pow(1.0 + p8 * p8 - 2.0 * p8 * cosGamma, 1.5f);
-    let mieM = mieMLhs / mieMRhs;
-    let zenith = sqrt(cosTheta);
-    let radianceLhs = 1.0 + p0 * exp(p1 / (cosTheta + 0.01));
-    let radianceRhs = p2 + p3 * expM + p5 * rayM + p6 * mieM + p7 * zenith;
-    let radianceDist = radianceLhs * radianceRhs;
-    return r * radianceDist;
-}
-
-@must_use
-fn acesFilmic(x: vec3f) -> vec3f {
-    let a = 2.51f;
-    let b = 0.03f;
-    let c = 2.43f;
-    let d = 0.59f;
-    let e = 0.14f;
-    return saturate((x * (a * x + b)) / (x * (c * x + d) + e));
-}
-
-@must_use
-fn sampleSolarDiskDirection(u: vec2f, cosThetaMax: f32, sunDirection: vec3f) -> vec3f {
-    let v = directionInCone(u, cosThetaMax);
-    let onb = pixarOnb(sunDirection);
-    return onb * v;
-}
-
-@must_use
-fn evalImplicitLambertian(blueNoise: vec2f, n: vec3f, albedo: vec3f) -> Scatter {
-    let v = directionInCosineWeightedHemisphere(blueNoise);
-    let onb = pixarOnb(n);
-    let wi = onb * v;
-
-    return Scatter(wi, albedo);
-}
-
-@must_use
-fn evalTexture(textureDescriptorIdx: u32, uv: vec2f) -> vec3f {
-    let textureDesc = textureDescriptors[textureDescriptorIdx];
-    return textureLookup(textureDesc, uv);
-}
-
-@must_use
-fn pixarOnb(n: vec3f) -> mat3x3f {
-    // https://www.jcgt.org/published/0006/01/01/paper-lowres.pdf
-    let s = select(-1f, 1f, n.z >= 0f);
-    let a = -1f / (s + n.z);
-    let b = n.x * n.y * a;
-    let u = vec3(1f + s * n.x * n.x * a, s * b, -s * n.x);
-    let v = vec3(b, s + n.y * n.y * a, -n.y);
-
-    return mat3x3(u, v, n);
-}
-
 // Returns 1.0 if no forward intersections, 0.0 otherwise.
 @must_use
 fn shadowRay(ray: Ray, rayTMax: f32) -> f32 {
@@ -373,86 +112,25 @@ fn shadowRay(ray: Ray, rayTMax: f32) -> f32 {
     return 1f;
 }
 
+struct RayAabbIntersector {
+    origin: vec3f,
+    invDir: vec3f,
+    dirNeg: vec3u,
+}
+
 @must_use
-fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, Intersection>) -> bool {
-    let intersector = rayAabbIntersector(ray);
-    var toVisitOffset = 0u;
-    var currentNodeIdx = 0u;
-    var nodesToVisit: array<u32, 32u>;
-    var didIntersect: bool = false;
-    var tmax = rayTMax;
+fn rayAabbIntersector(ray: Ray) -> RayAabbIntersector {
+    let invDirection = vec3f(1f / ray.direction.x, 1f / ray.direction.y, 1f / ray.direction.z);
+    return RayAabbIntersector(
+        ray.origin,
+        invDirection,
+        vec3u(select(0u, 1u, (invDirection.x < 0f)), select(0u, 1u, (invDirection.y < 0f)), select(0u, 1u, (invDirection.z < 0f)))
+    );
+}
 
-    loop {
-        let node: BvhNode = bvhNodes[currentNodeIdx];
-
-        if rayIntersectAabb(intersector, node.aabb, tmax) {
-            if node.triangleCount > 0u {
-                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
-                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
-                    var trihit: TriangleHit;
-                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
-                        tmax = trihit.t;
-                        didIntersect = true;
-
-                        let b = trihit.b;
-                        let triangleIdx = node.trianglesOffset + idx;
-                        let vert = vertexAttributes[triangleIdx];
-
-                        let p = trihit.p;
-                        let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
-                        let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
-                        let textureDescriptorIdx = vertexAttributes[triangleIdx].textureDescriptorIdx;
-
-                        *hit = Intersection(p, n, uv, textureDescriptorIdx);
-                    }
-                }
-                if toVisitOffset == 0u {
-                    break;
-                }
-                toVisitOffset -= 1u;
-                currentNodeIdx = nodesToVisit[toVisitOffset];
-            } else {
-                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
-                if intersector.dirNeg[node.splitAxis] == 1u {
-                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
-                    currentNodeIdx = node.secondChildOffset;
-                } else {
-                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
-                    currentNodeIdx = currentNodeIdx + 1u;
-                }
-                toVisitOffset += 1u;
-            }
-        } else {
-            if toVisitOffset == 0u {
-                break;
-            }
-            toVisitOffset -= 1u;
-            currentNodeIdx = nodesToVisit[toVisitOffset];
-        }
-    }
-
-    return didIntersect;
-}
-
-struct RayAabbIntersector {
-    origin: vec3f,
-    invDir: vec3f,
-    dirNeg: vec3u,
-}
-
-@must_use
-fn rayAabbIntersector(ray: Ray) -> RayAabbIntersector {
-    let invDirection = vec3f(1f / ray.direction.x, 1f / ray.direction.y, 1f / ray.direction.z);
-    return RayAabbIntersector(
-        ray.origin,
-        invDirection,
-        vec3u(select(0u, 1u, (invDirection.x < 0f)), select(0u, 1u, (invDirection.y < 0f)), select(0u, 1u, (invDirection.z < 0f)))
-    );
-}
-
-@must_use
-fn rayIntersectAabb(intersector: RayAabbIntersector, aabb: Aabb, rayTMax: f32) -> bool {
-    let bounds: array<vec3f, 2> = array(aabb.min, aabb.max);
+@must_use
+fn rayIntersectAabb(intersector: RayAabbIntersector, aabb: Aabb, rayTMax: f32) -> bool {
+    let bounds: array<vec3f, 2> = array(aabb.min, aabb.max);
 
     var tmin: f32 = (bounds[intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
     var tmax: f32 = (bounds[1u - intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
@@ -539,8 +217,7 @@ fn offsetRay(p: vec3f, n: vec3f) -> vec3f {
     let po = vec3f(
         bitcast<f32>(bitcast<i32>(p.x) + select(offset.x, -offset.x, (p.x < 0))),
         bitcast<f32>(bitcast<i32>(p.y) + select(offset.y, -offset.y, (p.y < 0))),
-)"
-R"(        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0)))
+        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0)))
     );
 
     return vec3f(
@@ -550,25 +227,121 @@ R"(        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0
     );
 }
 
-struct TextureDescriptor {
+
+@must_use
+fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, Intersection>) -> bool {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, tmax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                        tmax = trihit.t;
+                        didIntersect = true;
+
+                        let b = trihit.b;
+                        let triangleIdx = node.trianglesOffset + idx;
+                        let vert = vertexAttributes[triangleIdx];
+
+                        let p = trihit.p;
+                        let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
+                        let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
+                        let textureDescriptorIdx = vertexAttributes[triangleIdx].textureDescriptorIdx;
+
+                        *hit = Intersection(p, n, uv, textureDescriptorIdx);
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return didIntersect;
+}
+
+// The sky model: the radiance LUT, the sky sampling distribution, and the solar disk. The including
+// shader declares the `skyState` binding.
+
+// Shared sampling routines. The including shader declares the `blueNoise` binding.
+
+const EPSILON = 0.00001f;
+
+const PI = 3.1415927f;
+const FRAC_1_PI = 0.31830987f;
+const FRAC_PI_2 = 1.5707964f;
+
+const ONE_MINUS_EPSILON = 0.99999994f;
+
+struct BlueNoise {
     width: u32,
     height: u32,
-    offset: u32,
+    data: array<vec2f>,
 }
 
 @must_use
-fn textureLookup(desc: TextureDescriptor, uv: vec2f) -> vec3f {
-    let u = fract(uv.x);
-    let v = fract(uv.y);
+fn animatedBlueNoise(coord: vec2u, frameIdx: u32, totalSampleCount: u32) -> vec2f {
+    let idx = (coord.y % blueNoise.height) * blueNoise.width + (coord.x % blueNoise.width);
+    let blueNoise = blueNoise.data[idx];
+    // 2-dimensional golden ratio additive recurrence sequence
+    // https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
+    let n = frameIdx % totalSampleCount;
+    let a1 = 0.7548776662466927f;
+    let a2 = 0.5698402909980532f;
+    let r2Seq = fract(vec2(
+        a1 * f32(n),
+        a2 * f32(n)
+    ));
+    return fract(blueNoise + r2Seq);
+}
+
+// The power heuristic with an exponent of two, for combining light and BSDF samples.
+@must_use
+fn powerHeuristic(pdf: f32, otherPdf: f32) -> f32 {
+    let a = pdf * pdf;
+    let b = otherPdf * otherPdf;
+    return select(0f, a / (a + b), a > 0f);
+}
 
-    let j = u32(u * f32(desc.width));
-    let i = u32(v * f32(desc.height));
-    let idx = i * desc.width + j;
+@must_use
+fn pixarOnb(n: vec3f) -> mat3x3f {
+    // https://www.jcgt.org/published/0006/01/01/paper-lowres.pdf
+    let s = select(-1f, 1f, n.z >= 0f);
+    let a = -1f / (s + n.z);
+    let b = n.x * n.y * a;
+    let u = vec3(1f + s * n.x * n.x * a, s * b, -s * n.x);
+    let v = vec3(b, s + n.y * n.y * a, -n.y);
 
-    let bgra = textures[desc.offset + idx];
-    let srgb = vec3(f32((bgra >> 16u) & 0xffu), f32((bgra >> 8u) & 0xffu), f32(bgra & 0xffu)) / 255f;
-    let linearRgb = pow(srgb, vec3(2.2f));
-    return linearRgb;
+    return mat3x3(u, v, n);
 }
 
 // `u` is a random number in [0, 1].
@@ -606,190 +379,2987 @@ fn pointInUnitDisk(u: vec2f) -> vec2f {
     return vec2(r * cos(theta), r * sin(theta));
 }
 
+
+const CHANNEL_R = 0u;
+const CHANNEL_G = 1u;
+const CHANNEL_B = 2u;
+
+const DEGREES_TO_RADIANS = PI / 180f;
+const TERRESTRIAL_SOLAR_RADIUS = 0.255f * DEGREES_TO_RADIANS;
+
+const SOLAR_COS_THETA_MAX = cos(TERRESTRIAL_SOLAR_RADIUS);
+const SOLAR_INV_PDF = 2f * PI * (1f - SOLAR_COS_THETA_MAX);
+
+const SKY_RADIANCE_LUT_SIZE = 64u;
+const SKY_RADIANCE_LUT_FLOAT_COUNT = 3u * SKY_RADIANCE_LUT_SIZE * SKY_RADIANCE_LUT_SIZE;
+
+const SKY_DISTRIBUTION_WIDTH = 128u;
+const SKY_DISTRIBUTION_HEIGHT = 64u;
+const SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET = SKY_DISTRIBUTION_WIDTH * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + (SKY_DISTRIBUTION_WIDTH + 1u) * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_INTEGRAL_OFFSET = SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET + SKY_DISTRIBUTION_HEIGHT + 1u;
+const SKY_DISTRIBUTION_FLOAT_COUNT = SKY_DISTRIBUTION_INTEGRAL_OFFSET + 1u;
+
+// Rotates the blue noise used for the sun and BSDF samples, so that sky samples are decorrelated
+// from them.
+const SKY_SAMPLE_NOISE_OFFSET = vec2f(0.5f, 0.5f);
+
+struct SkyState {
+    params: array<f32, 27>,
+    skyRadiances: array<f32, 3>,
+    solarRadiances: array<f32, 3>,
+    sunDirection: vec3<f32>,
+    @align(16) radianceLut: array<f32, SKY_RADIANCE_LUT_FLOAT_COUNT>,
+    skyDistribution: array<f32, SKY_DISTRIBUTION_FLOAT_COUNT>,
+};
+
+// The sky dome radiance in direction `v`, without the solar disk.
 @must_use
-fn animatedBlueNoise(coord: vec2u, frameIdx: u32, totalSampleCount: u32) -> vec2f {
-    let idx = (coord.y % blueNoise.height) * blueNoise.width + (coord.x % blueNoise.width);
-    let blueNoise = blueNoise.data[idx];
-    // 2-dimensional golden ratio additive recurrence sequence
-    // https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
-    let n = frameIdx % totalSampleCount;
-    let a1 = 0.7548776662466927f;
-    let a2 = 0.5698402909980532f;
-    let r2Seq = fract(vec2(
-        a1 * f32(n),
-        a2 * f32(n)
-    ));
-    return fract(blueNoise + r2Seq);
+fn skyRadiance(v: vec3f) -> vec3f {
+    return skyDomeRadiance(v.y, dot(v, skyState.sunDirection));
 }
-)";
 
-const char* const DEFERRED_RENDERER_GBUFFER_PASS_SOURCE = R"(struct Uniforms {
-    viewReverseZProjectionMat: mat4x4f
+// Bilinearly interpolates the sky radiance LUT. Matches `sampleSkyRadianceLut` in
+// sky_radiance_lut.cpp.
+@must_use
+fn skyDomeRadiance(cosTheta: f32, cosGamma: f32) -> vec3f {
+    let maxCoord = f32(SKY_RADIANCE_LUT_SIZE - 1u);
+    let s = sqrt(sqrt(abs(cosTheta)));
+    let t = sqrt(clamp(0.5f * (1f - cosGamma), 0f, 1f));
+    let x = min(s, 1f) * maxCoord;
+    let y = t * maxCoord;
+
+    let x0 = min(u32(x), SKY_RADIANCE_LUT_SIZE - 2u);
+    let y0 = min(u32(y), SKY_RADIANCE_LUT_SIZE - 2u);
+    let fx = x - f32(x0);
+    let fy = y - f32(y0);
+
+    let r0 = mix(skyRadianceLutEntry(x0, y0), skyRadianceLutEntry(x0 + 1u, y0), fx);
+    let r1 = mix(skyRadianceLutEntry(x0, y0 + 1u), skyRadianceLutEntry(x0 + 1u, y0 + 1u), fx);
+    return mix(r0, r1, fy);
 }
 
-@group(0) @binding(0) var<uniform> uniforms: Uniforms;
-
-struct VertexInput {
-    @location(0) position: vec4f,
-    @location(1) normal: vec4f,
-    @location(2) texCoord: vec2f,
+@must_use
+fn skyRadianceLutEntry(col: u32, row: u32) -> vec3f {
+    let idx = 3u * (row * SKY_RADIANCE_LUT_SIZE + col);
+    return vec3(skyState.radianceLut[idx], skyState.radianceLut[idx + 1u], skyState.radianceLut[idx + 2u]);
 }
 
-struct VertexOutput {
-    @builtin(position) position: vec4f,
-    @location(0) normal: vec4f,
-    @location(1) texCoord: vec2f,
+struct SkySample {
+    direction: vec3f,
+    pdf: f32,
 }
 
-@vertex
-fn vsMain(in: VertexInput) -> VertexOutput {
-    var out: VertexOutput;
-    out.position = uniforms.viewReverseZProjectionMat * in.position;
-    out.normal = in.normal;
-    out.texCoord = in.texCoord;
-    return out;
+struct CdfSample {
+    x: f32,
+    offset: u32,
 }
 
-@group(1) @binding(0) var textureSampler: sampler;
-@group(2) @binding(0) var texture: texture_2d<f32>;
+// Matches `sampleSkyDistribution` in common/sky_distribution.cpp.
+@must_use
+fn sampleSkyDistribution(u: vec2f) -> SkySample {
+    let row = sampleSkyDistributionCdf(SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET, SKY_DISTRIBUTION_HEIGHT, u.y);
+    let conditionalCdfOffset = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + row.offset * (SKY_DISTRIBUTION_WIDTH + 1u);
+    let col = sampleSkyDistributionCdf(conditionalCdfOffset, SKY_DISTRIBUTION_WIDTH, u.x);
 
-struct GbufferOutput {
-    @location(0) albedo: vec4<f32>,
-    @location(1) normal: vec4<f32>,
-}
+    let theta = PI * row.x;
+    let phi = 2f * PI * col.x;
+    let sinTheta = sin(theta);
+    let direction = vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
 
-@fragment
-fn fsMain(in: VertexOutput) -> GbufferOutput {
-    let linearAlbedo = pow(textureSample(texture, textureSampler, in.texCoord).xyz, vec3(2.2f));
-    let encodedNormal = 0.5f * in.normal.xyz + vec3f(0.5f);
-    return GbufferOutput(vec4(linearAlbedo, 1f), vec4(encodedNormal, 1f));
+    return SkySample(direction, skyDistributionCellPdf(row.offset, col.offset, sinTheta));
 }
-)";
 
-const char* const DEFERRED_RENDERER_DEBUG_PASS_SOURCE = R"(struct VertexInput {
-    @location(0) position: vec2f,
-}
+// Matches `skyDistributionPdf` in common/sky_distribution.cpp.
+@must_use
+fn skyDistributionPdf(direction: vec3f) -> f32 {
+    let cosTheta = clamp(direction.y, -1f, 1f);
+    let sinTheta = sqrt(max(1f - cosTheta * cosTheta, 0f));
 
-struct VertexOutput {
-    @builtin(position) position: vec4f,
-    @location(0) texCoord: vec2f,
-}
+    var phi = atan2(direction.z, direction.x);
+    if phi < 0f {
+        phi += 2f * PI;
+    }
+    let u = phi / (2f * PI);
+    let v = acos(cosTheta) / PI;
 
-@vertex
-fn vsMain(in: VertexInput) -> VertexOutput {
-    let uv = 0.5 * in.position + vec2f(0.5);
-    var out: VertexOutput;
-    out.position = vec4f(in.position, 0.0, 1.0);
-    out.texCoord = vec2f(uv.x, 1.0 - uv.y);
+    let col = min(u32(u * f32(SKY_DISTRIBUTION_WIDTH)), SKY_DISTRIBUTION_WIDTH - 1u);
+    let row = min(u32(v * f32(SKY_DISTRIBUTION_HEIGHT)), SKY_DISTRIBUTION_HEIGHT - 1u);
 
-    return out;
+    return skyDistributionCellPdf(row, col, sinTheta);
 }
 
-@group(0) @binding(0) var<uniform> framebufferSize: vec2f;
-@group(1) @binding(0) var gbufferAlbedo: texture_2d<f32>;
-@group(1) @binding(1) var gbufferNormal: texture_2d<f32>;
-@group(1) @binding(2) var gbufferDepth: texture_depth_2d;
+@must_use
+fn skyDistributionCellPdf(row: u32, col: u32, sinTheta: f32) -> f32 {
+    if sinTheta <= 0f {
+        return 0f;
+    }
+    let cellWeight = skyState.skyDistribution[row * SKY_DISTRIBUTION_WIDTH + col];
+    let integral = skyState.skyDistribution[SKY_DISTRIBUTION_INTEGRAL_OFFSET];
+    // The Jacobian of the mapping from (u, v) to the sphere is 2 * pi^2 * sin(theta).
+    return cellWeight / (integral * 2f * PI * PI * sinTheta);
+}
+
+// Inverts the piecewise-linear CDF of `segmentCount` segments at `cdfOffset`.
+@must_use
+fn sampleSkyDistributionCdf(cdfOffset: u32, segmentCount: u32, u: f32) -> CdfSample {
+    // Binary search for the last entry which is less than or equal to `u`.
+    var lo = 0u;
+    var hi = segmentCount;
+    while lo + )"
+R"(1u < hi {
+        let mid = (lo + hi) / 2u;
+        if skyState.skyDistribution[cdfOffset + mid] <= u {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    let cdf0 = skyState.skyDistribution[cdfOffset + lo];
+    let cdf1 = skyState.skyDistribution[cdfOffset + lo + 1u];
+    let width = cdf1 - cdf0;
+    let du = select(0f, (u - cdf0) / width, width > 0f);
+    return CdfSample(min((f32(lo) + du) / f32(segmentCount), ONE_MINUS_EPSILON), lo);
+}
+
+@must_use
+fn sampleSolarDiskDirection(u: vec2f, cosThetaMax: f32, sunDirection: vec3f) -> vec3f {
+    let v = directionInCone(u, cosThetaMax);
+    let onb = pixarOnb(sunDirection);
+    return onb * v;
+}
+
+// Texture lookups from the texture pages. The including shader declares the `textures` and
+// `texturePage0` to `texturePage3` bindings, and defines `textureLookup`.
+
+struct TextureDescriptor {
+    width: u32,
+    height: u32,
+    page: u32,
+    offset: u32,
+    layout: u32,
+    format: u32,
+}
+
+// Matches the texture descriptor buffer written by the renderer.
+struct TextureTable {
+    srgbToLinear: array<f32, 256>,
+    descriptors: array<TextureDescriptor>,
+}
+
+const TEXTURE_FORMAT_BGRA8_SRGB = 0u;
+const TEXTURE_FORMAT_RGBA16_FLOAT = 2u;
+
+const TEXTURE_LAYOUT_TILED = 1u;
+const TEXTURE_TILE_SIZE = 8u;
+
+@must_use
+fn evalTexture(textureDescriptorIdx: u32, uv: vec2f) -> vec3f {
+    let textureDesc = textures.descriptors[textureDescriptorIdx];
+    return textureLookup(textureDesc, uv);
+}
+
+// Matches `decodeTexel` in common/texture.hpp. `word1` is only used by two-word formats.
+@must_use
+fn decodeTexel(format: u32, word0: u32, word1: u32) -> vec3f {
+    if format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        return vec3(unpack2x16float(word0), unpack2x16float(word1).x);
+    }
+    if format == TEXTURE_FORMAT_BGRA8_SRGB {
+        return vec3(
+            textures.srgbToLinear[(word0 >> 16u) & 0xffu],
+            textures.srgbToLinear[(word0 >> 8u) & 0xffu],
+            textures.srgbToLinear[word0 & 0xffu]
+        );
+    }
+    return unpack4x8unorm(word0).zyx;
+}
+
+@must_use
+fn texelWordCount(format: u32) -> u32 {
+    return select(1u, 2u, format == TEXTURE_FORMAT_RGBA16_FLOAT);
+}
+
+@must_use
+fn textureTexel(page: u32, idx: u32) -> u32 {
+    // Storage buffers can't be indexed dynamically, so the page is selected by branching.
+    switch page {
+        case 0u: { return texturePage0[idx]; }
+        case 1u: { return texturePage1[idx]; }
+        case 2u: { return texturePage2[idx]; }
+        default: { return texturePage3[idx]; }
+    }
+}
+
+// Matches `texelIndex` in common/texture_layout.hpp.
+@must_use
+fn texelIndex(desc: TextureDescriptor, x: u32, y: u32) -> u32 {
+    if desc.layout == TEXTURE_LAYOUT_TILED {
+        let tilesX = (desc.width + TEXTURE_TILE_SIZE - 1u) / TEXTURE_TILE_SIZE;
+        let tileIdx = (y / TEXTURE_TILE_SIZE) * tilesX + (x / TEXTURE_TILE_SIZE);
+        let tileTexelIdx = part1By1(x) | (part1By1(y) << 1u);
+        return tileIdx * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + tileTexelIdx;
+    }
+
+    return y * desc.width + x;
+}
+
+// Spread the lower three bits of `v` so that there is a zero bit between each bit.
+@must_use
+fn part1By1(v: u32) -> u32 {
+    var x = v & 0x7u;
+    x = (x | (x << 2u)) & 0x33u;
+    x = (x | (x << 1u)) & 0x55u;
+    return x;
+}
+
+
+// render params bind group
+@group(0) @binding(0) var<uniform> renderParams: RenderParams;
+@group(0) @binding(1) var<storage, read> skyState: SkyState;
+
+// scene bind group
+@group(1) @binding(0) var<storage, read> bvhNodes: array<BvhNode>;
+@group(1) @binding(1) var<storage, read> positionAttributes: array<Positions>;
+@group(1) @binding(2) var<storage, read> vertexAttributes: array<VertexAttributes>;
+@group(1) @binding(3) var<storage, read> textures: TextureTable;
+@group(1) @binding(4) var<storage, read> blueNoise: BlueNoise;
+@group(1) @binding(5) var<storage, read> texturePage0: array<u32>;
+@group(1) @binding(6) var<storage, read> texturePage1: array<u32>;
+@group(1) @binding(7) var<storage, read> texturePage2: array<u32>;
+@group(1) @binding(8) var<storage, read> texturePage3: array<u32>;
+
+// image bind group
+@group(2) @binding(0) var<storage, read_write> imageBuffer: array<vec3f>;
+
+// The 2D workgroup tile of the path tracing pass, overridden by the renderer.
+override WORKGROUP_SIZE_X: u32 = 8u;
+override WORKGROUP_SIZE_Y: u32 = 8u;
+// The number of bounces the pipeline is specialized for, which lets the compiler unroll the bounce
+// loop. Zero reads the number of bounces from the sampling state instead.
+override NUM_BOUNCES: u32 = 0u;
+
+@compute @workgroup_size(WORKGROUP_SIZE_X, WORKGROUP_SIZE_Y)
+fn main(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let dimensions = renderParams.frameData.dimensions;
+    let coord = globalInvocationId.xy;
+    if coord.x >= dimensions.x || coord.y >= dimensions.y {
+        return;
+    }
+
+    let idx = coord.y * dimensions.x + coord.x;
+    let accumulatedSampleCount = renderParams.samplingState.accumulatedSampleCount;
+
+    if accumulatedSampleCount == 0u {
+        imageBuffer[idx] = vec3(0f);
+    }
+
+    if accumulatedSampleCount < renderParams.samplingState.numSamplesPerPixel {
+        let u = (f32(coord.x) + 0.5f) / f32(dimensions.x);
+        let v = (f32(coord.y) + 0.5f) / f32(dimensions.y);
+        let blueNoise = animatedBlueNoise(coord, renderParams.frameData.frameCount, renderParams.samplingState.numSamplesPerPixel);
+        let jitter = blueNoise / vec2f(dimensions);
+        let primaryRay = generateCameraRay(blueNoise, renderParams.camera, u + jitter.x, (1.0 - v) + jitter.y);
+        imageBuffer[idx] += rayColor(blueNoise, primaryRay, coord);
+    }
+}
+
+struct RenderParams {
+  frameData: FrameData,
+  camera: Camera,
+  samplingState: SamplingState,
+  @align(16) exposure: f32,
+}
+
+struct FrameData {
+    dimensions: vec2u,
+    frameCount: u32,
+}
+
+struct Camera {
+    origin: vec3f,
+    lowerLeftCorner: vec3f,
+    horizontal: vec3f,
+    vertical: vec3f,
+    up: vec3f,
+    right: vec3f,
+    lensRadius: f32,
+}
+
+struct SamplingState {
+    numSamplesPerPixel: u32,
+    numBounces: u32,
+    accumulatedSampleCount: u32,
+}
+
+struct Scatter {
+    wi: vec3f,
+    throughput: vec3f,
+}
+
+@must_use
+fn rayColor(blueNoise: vec2f, primaryRay: Ray, coord: vec2u) -> vec3f {
+    var ray = primaryRay;
+    var radiance = vec3(0f);
+    var throughput = vec3(1f);
+    // The pdf of the BSDF sample which generated `ray`, used to weight sky radiance with MIS.
+    var bsdfPdf = 0f;
+
+    var bounce = 1u;
+    let numBounces = select(renderParams.samplingState.numBounces, NUM_BOUNCES, NUM_BOUNCES != 0u);
+    loop {
+        var hit: Intersection;
+        if rayIntersectBvh(ray, T_MAX, &hit) {
+            let albedo = evalTexture(hit.textureDescriptorIdx, hit.uv);
+            let p = hit.p;
+
+            let lightDirection = sampleSolarDiskDirection(blueNoise, SOLAR_COS_THETA_MAX, skyState.sunDirection);
+            let lightIntensity = vec3(
+                skyState.solarRadiances[CHANNEL_R],
+                skyState.solarRadiances[CHANNEL_G],
+                skyState.solarRadiances[CHANNEL_B]
+            );
+            let brdf = albedo * FRAC_1_PI;
+            let reflectance = brdf * dot(hit.n, lightDirection);
+            let lightVisibility = shadowRay(Ray(p, lightDirection), T_MAX);
+            radiance += throughput * lightIntensity * reflectance * lightVisibility * SOLAR_INV_PDF;
+
+            // Sky light sample. On the last bounce, there is no BSDF sample to share the sky with.
+            let skySample = sampleSkyDistribution(fract(blueNoise + SKY_SAMPLE_NOISE_OFFSET));
+            let skyCosTheta = dot(hit.n, skySample.direction);
+            if skyCosTheta > 0f && skySample.pdf > 0f {
+                let skyVisibility = shadowRay(Ray(p, skySample.direction), T_MAX);
+                let misWeight = select(powerHeuristic(skySample.pdf, skyCosTheta * FRAC_1_PI), 1f, bounce == numBounces);
+                let skyReflectance = brdf * skyCosTheta;
+                radiance += throughput * skyRadiance(skySample.direction) * skyReflectance * skyVisibility * misWeight / skySample.pdf;
+            }
+
+            if bounce == numBounces {
+                break;
+            }
+
+            let scatter = evalImplicitLambertian(blueNoise, hit.n, albedo);
+            ray = Ray(p, scatter.wi);
+            throughput *= scatter.throughput;
+            bsdfPdf = dot(hit.n, scatter.wi) * FRAC_1_PI;
+        } else {
+            // Camera rays which miss the scene see the sky directly, and are not weighted.
+            let misWeight = select(powerHeuristic(bsdfPdf, skyDistributionPdf(ray.direction)), 1f, bounce == 1u);
+            radiance += throughput * skyRadiance(ray.direction) * misWeight;
+
+            break;
+        }
+
+        bounce += 1u;
+    }
+
+    return radiance;
+}
+
+@must_use
+fn generateCameraRay(noise: vec2f, camera: Camera, u: f32, v: f32) -> Ray {
+    let randomPointInLens = camera.lensRadius * pointInUnitDisk(noise);
+    let lensOffset = randomPointInLens.x * camera.right + randomPointInLens.y * camera.up;
+
+    let origin = camera.origin + lensOffset;
+    let direction = normalize(camera.lowerLeftCorner + u * camera.horizontal + v * camera.vertical - origin);
+
+    return Ray(origin, direction);
+}
+
+@must_use
+fn evalImplicitLambertian(blueNoise: vec2f, n: vec3f, albedo: vec3f) -> Scatter {
+    let v = directionInCosineWeightedHemisphere(blueNoise);
+    let onb = pixarOnb(n);
+    let wi = onb * v;
+
+    return Scatter(wi, albedo);
+}
+
+@must_use
+fn textureLookup(desc: TextureDescriptor, uv: vec2f) -> vec3f {
+    let u = fract(uv.x);
+    let v = fract(uv.y);
+
+    let x = min(u32(u * f32(desc.width)), desc.width - 1u);
+    let y = min(u32(v * f32(desc.height)), desc.height - 1u);
+
+    let idx = desc.offset + texelIndex(desc, x, y) * texelWordCount(desc.format);
+    let word0 = textureTexel(desc.page, idx);
+    var word1 = 0u;
+    if desc.format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        word1 = textureTexel(desc.page, idx + 1u);
+    }
+    return decodeTexel(desc.format, word0, word1);
+}
+)";
+
+const char* const REFERENCE_PATH_TRACER_BLIT_SOURCE = R"(struct VertexInput {
+    @location(0) position: vec2f,
+}
+
+struct VertexOutput {
+    @builtin(position) position: vec4f,
+    @location(0) texCoord: vec2f,
+}
+
+@vertex
+fn vsMain(in: VertexInput) -> VertexOutput {
+    let uv = 0.5 * in.position + vec2f(0.5);
+    var out: VertexOutput;
+    out.position = vec4f(in.position, 0.0, 1.0);
+    out.texCoord = vec2f(uv.x, 1.0 - uv.y);
+    return out;
+}
+
+// render params bind group
+@group(0) @binding(0) var<uniform> renderParams: RenderParams;
+
+// image bind group
+@group(1) @binding(0) var<storage, read> imageBuffer: array<vec3f>;
 
 @fragment
 fn fsMain(in: VertexOutput) -> @location(0) vec4f {
-    let c = in.texCoord;
-    let idx = vec2u(floor(c * framebufferSize));
-    var rgb = vec3f(0f);
-    if c.x < 0.333 {
-        rgb = textureLoad(gbufferAlbedo, idx, 0).rgb;
-    } else if c.x < 0.666 {
-        rgb = textureLoad(gbufferNormal, idx, 0).rgb;
-    } else {
-        let d = textureLoad(gbufferDepth, idx, 0);
-        let x = d;
-        let a = 0.1;
-        rgb = vec3((1.0 + a) * x / (x + vec3(a)));
-    }
+    let dimensions = renderParams.frameData.dimensions;
+    let coord = vec2u(u32(in.texCoord.x * f32(dimensions.x)), u32(in.texCoord.y * f32(dimensions.y)));
+    let idx = coord.y * dimensions.x + coord.x;
+
+    // The path tracing pass has already added this frame's sample, unless the image has converged.
+    let samplingState = renderParams.samplingState;
+    let sampleCount = min(samplingState.accumulatedSampleCount + 1u, samplingState.numSamplesPerPixel);
+    let estimator = imageBuffer[idx] / f32(sampleCount);
+
+    let rgb = acesFilmic(renderParams.exposure * estimator);
     let srgb = pow(rgb, vec3(1.0 / 2.2));
-    return vec4(srgb, 1.0);
+    return vec4f(srgb, 1f);
 }
-)";
 
-const char* const DEFERRED_RENDERER_LIGHTING_PASS_SOURCE = R"(struct SkyState {
+struct RenderParams {
+  frameData: FrameData,
+  camera: Camera,
+  samplingState: SamplingState,
+  @align(16) exposure: f32,
+}
+
+struct FrameData {
+    dimensions: vec2u,
+    frameCount: u32,
+}
+
+struct Camera {
+    origin: vec3f,
+    lowerLeftCorner: vec3f,
+    horizontal: vec3f,
+    vertical: vec3f,
+    up: vec3f,
+    right: vec3f,
+    lensRadius: f32,
+}
+
+struct SamplingState {
+    numSamplesPerPixel: u32,
+    numBounces: u32,
+    accumulatedSampleCount: u32,
+}
+
+@must_use
+fn acesFilmic(x: vec3f) -> vec3f {
+    let a = 2.51f;
+    let b = 0.03f;
+    let c = 2.43f;
+    let d = 0.59f;
+    let e = 0.14f;
+    return saturate((x * (a * x + b)) / (x * (c * x + d) + e));
+}
+)";
+
+const char* const WAVEFRONT_PATH_TRACER_SOURCE = R"(// Ray-primitive intersection and BVH visibility queries. The including shader declares the
+// `bvhNodes` and `positionAttributes` bindings.
+
+const T_MIN = 0.001f;
+// The maximum ray extent. Specializing it lets the compiler fold it into the traversal.
+override T_MAX: f32 = 10000f;
+
+struct Ray {
+    origin: vec3f,
+    direction: vec3f
+}
+
+struct Aabb {
+    min: vec3f,
+    max: vec3f,
+}
+
+struct BvhNode {
+    aabb: Aabb,
+    trianglesOffset: u32,
+    secondChildOffset: u32,
+    triangleCount: u32,
+    splitAxis: u32,
+}
+
+struct Positions {
+    p0: vec3f,
+    p1: vec3f,
+    p2: vec3f,
+}
+
+struct VertexAttributes {
+    n0: vec3f,
+    n1: vec3f,
+    n2: vec3f,
+
+    uv0: vec2f,
+    uv1: vec2f,
+    uv2: vec2f,
+
+    textureDescriptorIdx: u32,
+}
+
+struct Intersection {
+    p: vec3f,
+    n: vec3f,
+    uv: vec2f,
+    textureDescriptorIdx: u32,
+}
+
+struct TriangleHit {
+    p: vec3f,
+    b: vec3f,
+    t: f32,
+}
+
+// Returns 1.0 if no forward intersections, 0.0 otherwise.
+@must_use
+fn shadowRay(ray: Ray, rayTMax: f32) -> f32 {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, rayTMax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    // TODO: trihit not actually used. A different code path could be used?
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, rayTMax, &trihit) {
+                        return 0f;
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return 1f;
+}
+
+struct RayAabbIntersector {
+    origin: vec3f,
+    invDir: vec3f,
+    dirNeg: vec3u,
+}
+
+@must_use
+fn rayAabbIntersector(ray: Ray) -> RayAabbIntersector {
+    let invDirection = vec3f(1f / ray.direction.x, 1f / ray.direction.y, 1f / ray.direction.z);
+    return RayAabbIntersector(
+        ray.origin,
+        invDirection,
+        vec3u(select(0u, 1u, (invDirection.x < 0f)), select(0u, 1u, (invDirection.y < 0f)), select(0u, 1u, (invDirection.z < 0f)))
+    );
+}
+
+@must_use
+fn rayIntersectAabb(intersector: RayAabbIntersector, aabb: Aabb, rayTMax: f32) -> bool {
+    let bounds: array<vec3f, 2> = array(aabb.min, aabb.max);
+
+    var tmin: f32 = (bounds[intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+    var tmax: f32 = (bounds[1u - intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+
+    let tymin: f32 = (bounds[intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+    let tymax: f32 = (bounds[1 - intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+
+    if (tmin > tymax) || (tymin > tmax) {
+        return false;
+    }
+
+    tmin = max(tymin, tmin);
+    tmax = min(tymax, tmax);
+
+    let tzmin: f32 = (bounds[intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+    let tzmax: f32 = (bounds[1 - intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+
+    if (tmin > tzmax) || (tzmin > tmax) {
+        return false;
+    }
+
+    tmin = max(tzmin, tmin);
+    tmax = min(tzmax, tmax);
+
+    return (tmin < rayTMax) && (tmax > 0.0);
+}
+
+@must_use
+fn rayIntersectTriangle(ray: Ray, tri: Positions, tmax: f32, hit: ptr<function, TriangleHit>) -> bool {
+    // Mäller-Trumbore algorithm
+    // https://en.wikipedia.org/wiki/Möller–Trumbore_intersection_algorithm
+    let e1 = tri.p1 - tri.p0;
+    let e2 = tri.p2 - tri.p0;
+
+    let h = cross(ray.direction, e2);
+    let det = dot(e1, h);
+
+    if det > -EPSILON && det < EPSILON {
+        return false;
+    }
+
+    let invDet = 1.0f / det;
+    let s = ray.origin - tri.p0;
+    let u = invDet * dot(s, h);
+
+    if u < 0.0f || u > 1.0f {
+        return false;
+    }
+
+    let q = cross(s, e1);
+    let v = invDet * dot(ray.direction, q);
+
+    if v < 0.0f || u + v > 1.0f {
+        return false;
+    }
+
+    let t = invDet * dot(e2, q);
+
+    if t > EPSILON && t < tmax {
+        // https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection.html
+        // e1 = v1 - v0
+        // e2 = v2 - v0
+        // -> p = v0 + u * e1 + v * e2
+        let p = tri.p0 + u * e1 + v * e2;
+        let n = normalize(cross(e1, e2));
+        let b = vec3f(1f - u - v, u, v);
+        *hit = TriangleHit(offsetRay(p, n), b, t);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+const ORIGIN = 1f / 32f;
+const FLOAT_SCALE = 1f / 65536f;
+const INT_SCALE = 256f;
+
+@must_use
+fn offsetRay(p: vec3f, n: vec3f) -> vec3f {
+    // Source: A Fast and Robust Method for Avoiding Self-Intersection, Ray Tracing Gems
+    let offset = vec3i(i32(INT_SCALE * n.x), i32(INT_SCALE * n.y), i32(INT_SCALE * n.z));
+    // Offset added straight into the mantissa bits to ensure the offset is scale-invariant,
+    // except for when close to the origin, where we use FLOAT_SCALE as a small epsilon.
+    let po = vec3f(
+        bitcast<f32>(bitcast<i32>(p.x) + select(offset.x, -offset.x, (p.x < 0))),
+        bitcast<f32>(bitcast<i32>(p.y) + select(offset.y, -offset.y, (p.y < 0))),
+        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0)))
+    );
+
+    return vec3f(
+        select(po.x, p.x + FLOAT_SCALE * n.x, (abs(p.x) < ORIGIN)),
+        select(po.y, p.y + FLOAT_SCALE * n.y, (abs(p.y) < ORIGIN)),
+        select(po.z, p.z + FLOAT_SCALE * n.z, (abs(p.z) < ORIGIN))
+    );
+}
+
+// The sky model: the radiance LUT, the sky sampling distribution, and the solar disk. The including
+// shader declares the `skyState` binding.
+
+// Shared sampling routines. The including shader declares the `blueNoise` binding.
+
+const EPSILON = 0.00001f;
+
+const PI = 3.1415927f;
+const FRAC_1_PI = 0.31830987f;
+const FRAC_PI_2 = 1.5707964f;
+
+const ONE_MINUS_EPSILON = 0.99999994f;
+
+struct BlueNoise {
+    width: u32,
+    height: u32,
+    data: array<vec2f>,
+}
+
+@must_use
+fn animatedBlueNoise(coord: vec2u, frameIdx: u32, totalSampleCount: u32) -> vec2f {
+    let idx = (coord.y % blueNoise.height) * blueNoise.width + (coord.x % blueNoise.width);
+    let blueNoise = blueNoise.data[idx];
+    // 2-dimensional golden ratio additive recurrence sequence
+    // https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
+    let n = frameIdx % totalSampleCount;
+    let a1 = 0.7548776662466927f;
+    let a2 = 0.5698402909980532f;
+    let r2Seq = fract(vec2(
+        a1 * f32(n),
+        a2 * f32(n)
+    ));
+    return fract(blueNoise + r2Seq);
+}
+
+// The power heuristic with an exponent of two, for combining light and BSDF samples.
+@must_use
+fn powerHeuristic(pdf: f32, otherPdf: f32) -> f32 {
+    let a = pdf * pdf;
+    let b = otherPdf * otherPdf;
+    return select(0f, a / (a + b), a > 0f);
+}
+
+@must_use
+fn pixarOnb(n: vec3f) -> mat3x3f {
+    // https://www.jcgt.org/published/0006/01/01/paper-lowres.pdf
+    let s = select(-1f, 1f, n.z >= 0f);
+    let a = -1f / (s + n.z);
+    let b = n.x * n.y * a;
+    let u = vec3(1f + s * n.x * n.x * a, s * b, -s * n.x);
+    let v = vec3(b, s + n.y * n.y * a, -n.y);
+
+    return mat3x3(u, v, n);
+}
+
+// `u` is a random number in [0, 1].
+@must_use
+fn directionInCone(u: vec2f, cosThetaMax: f32) -> vec3f {
+    let cosTheta = 1f - u.x * (1f - cosThetaMax);
+    let sinTheta = sqrt(1f - cosTheta * cosTheta);
+    let phi = 2f * PI * u.y;
+
+    let x = cos(phi) * sinTheta;
+    let y = sin(phi) * sinTheta;
+    let z = cosTheta;
+
+    return vec3(x, y, z);
+}
+
+// `u` is a random number in [0, 1].
+@must_use
+fn directionInCosineWeightedHemisphere(u: vec2f) -> vec3f {
+    let phi = 2f * PI * u.y;
+    let sinTheta = sqrt(1f - u.x);
+
+    let x = cos(phi) * sinTheta;
+    let y = sin(phi) * sinTheta;
+    let z = sqrt(u.x);
+
+    return vec3(x, y, z);
+}
+
+// `u` is a random number in [0, 1]
+@must_use
+fn pointInUnitDisk(u: vec2f) -> vec2f {
+    let r = sqrt(u.x);
+    let theta = 2f * PI * u.y;
+    return vec2(r * cos(theta), r * sin(theta));
+}
+
+
+const CHANNEL_R = 0u;
+const CHANNEL_G = 1u;
+const CHANNEL_B = 2u;
+
+const DEGREES_TO_RADIANS = PI / 180f;
+const TERRESTRIAL_SOLAR_RADIUS = 0.255f * DEGREES_TO_RADIANS;
+
+const SOLAR_COS_THETA_MAX = cos(TERRESTRIAL_SOLAR_RADIUS);
+const SOLAR_INV_PDF = 2f * PI * (1f - SOLAR_COS_THETA_MAX);
+
+const SKY_RADIANCE_LUT_SIZE = 64u;
+const SKY_RADIANCE_LUT_FLOAT_COUNT = 3u * SKY_RADIANCE_LUT_SIZE * SKY_RADIANCE_LUT_SIZE;
+
+const SKY_DISTRIBUTION_WIDTH = 128u;
+const SKY_DISTRIBUTION_HEIGHT = 64u;
+const SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET = SKY_DISTRIBUTION_WIDTH * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + (SKY_DISTRIBUTION_WIDTH + 1u) * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_INTEGRAL_OFFSET = SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET + SKY_DISTRIBUTION_HEIGHT + 1u;
+const SKY_DISTRIBUTION_FLOAT_COUNT = SKY_DISTRIBUTION_INTEGRAL_OFFSET + 1u;
+
+// Rotates the blue noise used for the sun and BSDF samples, so that sky samples are decorrelated
+// from them.
+const SKY_SAMPLE_NOISE_OFFSET = vec2f(0.5f, 0.5f);
+
+struct SkyState {
+    params: array<f32, 27>,
+    skyRadiances: array<f32, 3>,
+    solarRadiances: array<f32, 3>,
+    sunDirection: vec3<f32>,
+    @align(16) radianceLut: array<f32, SKY_RADIANCE_LUT_FLOAT_COUNT>,
+    skyDistribution: array<f32, SKY_DISTRIBUTION_FLOAT_COUNT>,
+};
+
+// The sky dome radiance in direction `v`, without the solar disk.
+@must_use
+fn skyRadiance(v: vec3f) -> vec3f {
+    return skyDomeRadiance(v.y, dot(v, skyState.sunDirection));
+}
+
+// Bilinearly interpolates the sky radiance LUT. Matches `sampleSkyRadianceLut` in
+// sky_radiance_lut.cpp.
+@must_use
+fn skyDomeRadiance(cosTheta: f32, cosGamma: f32) -> vec3f {
+    let maxCoord = f32(SKY_RADIANCE_LUT_SIZE - 1u);
+    let s = sqrt(sqrt(abs(cosTheta)));
+    let t = sqrt(clamp(0.5f * (1f - cosGamma), 0f, 1f));
+    let x = min(s, 1f) * maxCoord;
+    let y = t * maxCoord;
+
+    let x0 = min(u32(x), SKY_RADIANCE_LUT_SIZE - 2u);
+    let y0 = min(u32(y), SKY_RADIANCE_LUT_SIZE - 2u);
+    let fx = x - f32(x0);
+    let fy = y - f32(y0);
+
+    let r0 = mix(skyRadianceLutEntry(x0, y0), skyRadianceLutEntry(x0 + 1u, y0), fx);
+    let r1 = mix(skyRadianceLutEntry(x0, y0 + 1u), skyRadianceLutEntry(x0 + 1u, y0 + 1u), fx);
+    return mix(r0, r1, fy);
+}
+
+@must_use
+fn skyRadianceLutEntry(col: u32, row: u32) -> vec3f {
+    let idx = 3u * (row * SKY_RADIANCE_LUT_SIZE + col);
+    return vec3(skyState.radianceLut[idx], skyState.radianceLut[idx + 1u], skyState.radianceLut[idx + 2u]);
+}
+
+struct SkySample {
+    direction: vec3f,
+    pdf: f32,
+}
+
+struct CdfSample {
+    x: f32,
+    offset: u32,
+}
+
+// Matches `sampleSkyDistribution` in common/sky_distribution.cpp.
+@must_use
+fn sampleSkyDistribution(u: vec2f) -> SkySample {
+    let row = sampleSkyDistributionCdf(SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET, SKY_DISTRIBUTION_HEIGHT, u.y);
+    let conditionalCdfOffset = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + row.offset * (SKY_DISTRIBUTION_WIDTH + 1u);
+    let col = sampleSkyDistributionCdf(conditionalCdfOffset, SKY_DISTRIBUTION_WIDTH, u.x);
+
+    let theta = PI * row.x;
+    let phi = 2f * PI * col.x;
+    let sinTheta = sin(theta);
+    let direction = vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
+
+    return SkySample(direction, skyDistributionCellPdf(row.offset, col.offset, sinTheta));
+}
+
+// Matches `skyDistributionPdf` in common/sky_distribution.cpp.
+@must_use
+fn skyDistributionPdf(direction: vec3f) -> f32 {
+    let cosTheta = clamp(direction.y, -1f, 1f);
+    let sinTheta = sqrt(max(1f - cosTheta * cosTheta, 0f));
+
+    var phi = atan2(direction.z, direction.x);
+    if phi < 0f {
+        phi += 2f * PI;
+    }
+    let u = phi / (2f * PI);
+    let v = acos(cosTheta) / PI;
+
+    let col = min(u32(u * f32(SKY_DISTRIBUTION_WIDTH)), SKY_DISTRIBUTION_WIDTH - 1u);
+    let row = min(u32(v * f32(SKY_DISTRIBUTION_HEIGHT)), SKY_DISTRIBUTION_HEIGHT - 1u);
+
+    return skyDistributionCellPdf(row, col, sinTheta);
+}
+
+@must_use
+fn skyDistributionCellPdf(row: u32, col: u32, sinTheta: f32) -> f32 {
+    if sinTheta <= 0f {
+        return 0f;
+    }
+    let cellWeight = skyState.skyDistribution[row * SKY_DISTRIBUTION_WIDTH + col];
+    let integral = skyState.skyDistribution[SKY_DISTRIBUTION_INTEGRAL_OFFSET];
+    // The Jacobian of the mapping from (u, v) to the sphere is 2 * pi^2 * sin(theta).
+    return cellWeight / (integral * 2f * PI * PI * sinTheta);
+}
+
+// Inverts the piecewise-linear CDF of `segmentCount` segments at `cdfOffset`.
+@must_use
+fn sampleSkyDistributionCdf(cdfOffset: u32, segmentCount: u32, u: f32) -> CdfSample {
+    // Binary search for the last entry which is less than or equal to `u`.
+    var lo = 0u;
+    var hi = segmentCount;
+    while lo + 1u < hi {
+        let mid = (lo + hi) / 2u;
+        if skyState.skyDistribution[cdfOffset + mid] <= u {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    let cdf0 = skyState.skyDistribution[cdfOffset + lo];
+    let cdf1 = skyState.skyDistribution[cdfOffset + lo + 1u];
+    let width = cdf1 - cdf0;
+    let du = select(0f, (u - cdf0) / width, width > 0f);
+    return CdfSample(min((f32(lo) + du) / f32(segmentCount), ONE_MINUS_EPSILON), lo);
+}
+
+@must_use
+fn sampleSolarDiskDirection(u: vec2f, cosThetaMax: f32, sunDirection: vec3f) -> vec3f {
+    let v = directionInCone(u, cosThetaMax);
+    let onb = pixarOnb(sunDirection);
+    return onb * v;
+}
+
+// Texture lookups from the texture pages. The including shader declares the `textures` and
+// `texturePage0` to `texturePage3` bindings, and defines `textureLookup`.
+
+struct TextureDescriptor {
+    width: u32,
+    height: u32,
+    page: u32,
+    offset: u32,
+    layout: u32,
+    format: u32,
+}
+
+// Matches the texture descriptor buffer written by the renderer.
+struct TextureTable {
+    srgbToLinear: array<f32, 256>,
+    descriptors: array<TextureDescriptor>,
+}
+
+const TEXTURE_FORMAT_BGRA8_SRGB = 0u;
+const TEXTURE_FORMAT_RGBA16_FLOAT = 2u;
+
+const TEXTURE_LAYOUT_TILED = 1u;
+const TEXTURE_TILE_SIZE = 8u;
+
+@must_use
+fn evalTexture(textureDescriptorIdx: u32, uv: vec2f) -> vec3f {
+    let textureDesc = textures.descriptors[textureDescriptorIdx];
+    return textureLookup(textureDesc, uv);
+}
+
+// Matches `decodeTexel` in common/texture.hpp. `word1` is only used by two-word formats.
+@must_use
+fn decodeTexel(format: u32, word0: u32, word1: u32) -> vec3f {
+    if format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        return vec3(unpack2x16float(word0), unpack2x16float(word1).x);
+    }
+    if format == TEXTURE_FORMAT_BGRA8_SRGB {
+        return vec3(
+            textures.srgbToLinear[(word0 >> 16u) & 0xffu],
+            textures.srgbToLinear[(word0 >> 8u) & 0xffu],
+            textures.srgbToLinear[word0 & 0xffu]
+        );
+    }
+    return unpack4x8unorm(word0).zyx;
+}
+
+@must_use
+fn texelWordCount(format: u32) -> u32 {
+    return select(1u, 2u, format == TEXTURE_FORMAT_RGBA16_FLOAT);
+}
+
+@must_use
+fn textureTexel(page: u32, idx: u32) -> u32 {
+    // Storage buffers can't be indexed dynamically, so the page is selected by branching.
+    switch page {
+        case 0u: { return texturePage0[idx]; }
+        case 1u: { return texturePage1[idx]; }
+        case 2u: { return texturePage2[idx]; }
+        default: { return texturePage3[idx]; }
+    }
+}
+
+// Matches `texelIndex` in common/texture_layout.hpp.
+@must_use
+)"
+R"(fn texelIndex(desc: TextureDescriptor, x: u32, y: u32) -> u32 {
+    if desc.layout == TEXTURE_LAYOUT_TILED {
+        let tilesX = (desc.width + TEXTURE_TILE_SIZE - 1u) / TEXTURE_TILE_SIZE;
+        let tileIdx = (y / TEXTURE_TILE_SIZE) * tilesX + (x / TEXTURE_TILE_SIZE);
+        let tileTexelIdx = part1By1(x) | (part1By1(y) << 1u);
+        return tileIdx * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + tileTexelIdx;
+    }
+
+    return y * desc.width + x;
+}
+
+// Spread the lower three bits of `v` so that there is a zero bit between each bit.
+@must_use
+fn part1By1(v: u32) -> u32 {
+    var x = v & 0x7u;
+    x = (x | (x << 2u)) & 0x33u;
+    x = (x | (x << 1u)) & 0x55u;
+    return x;
+}
+
+
+// render params bind group
+@group(0) @binding(0) var<uniform> renderParams: RenderParams;
+@group(0) @binding(1) var<storage, read> skyState: SkyState;
+
+// scene bind group
+@group(1) @binding(0) var<storage, read> bvhNodes: array<BvhNode>;
+@group(1) @binding(1) var<storage, read> positionAttributes: array<Positions>;
+@group(1) @binding(2) var<storage, read> vertexAttributes: array<VertexAttributes>;
+@group(1) @binding(3) var<storage, read> textures: TextureTable;
+@group(1) @binding(4) var<storage, read> blueNoise: BlueNoise;
+@group(1) @binding(5) var<storage, read> texturePage0: array<u32>;
+@group(1) @binding(6) var<storage, read> texturePage1: array<u32>;
+@group(1) @binding(7) var<storage, read> texturePage2: array<u32>;
+@group(1) @binding(8) var<storage, read> texturePage3: array<u32>;
+
+// image bind group
+@group(2) @binding(0) var<storage, read_write> imageBuffer: array<vec3f>;
+
+// wavefront bind group
+@group(3) @binding(0) var<storage, read_write> queueState: QueueState;
+@group(3) @binding(1) var<storage, read_write> queues: array<u32>;
+@group(3) @binding(2) var<storage, read_write> pathState: array<vec4f>;
+
+// The wavefront integrator traces one path per pixel. The path index is the pixel index, so each
+// path owns its path state and the per-pixel blue noise can be recomputed in any kernel. A bounce
+// runs the `extend`, `miss`, `shade` and `shadow` kernels over compacted queues of path indices,
+// which are dispatched indirectly from the queue counts, see wavefront_queue.wgsl.
+//
+// The `extendPersistent` and `shadowPersistent` kernels are the persistent-threads variants of
+// `extend` and `shadow`, which the renderer uses with the short-stack traversal instead.
+
+// The workgroup size of the kernels, overridden by the renderer.
+override WORKGROUP_SIZE: u32 = 64u;
+
+// Matches the C++ `QueueStateLayout`. `bounce` and `extendCount` are only written by the queue
+// kernels, in between the dispatches which read them.
+struct QueueState {
+    bounce: u32,
+    extendCount: u32,
+    shadeCount: atomic<u32>,
+    missCount: atomic<u32>,
+    nextExtendCount: atomic<u32>,
+    extendFetchCount: atomic<u32>,
+    shadowFetchCount: atomic<u32>,
+}
+
+// The path state is stored as a structure of arrays, with one region of `pathCount()` entries per
+// member.
+const PATH_ORIGIN = 0u;        // xyz: ray origin, w: pdf of the BSDF sample which generated the ray
+const PATH_DIRECTION = 1u;     // xyz: ray direction
+const PATH_THROUGHPUT = 2u;    // xyz: path throughput
+const PATH_RADIANCE = 3u;      // xyz: radiance accumulated by the path
+const PATH_HIT = 4u;           // xy: barycentrics, z: ray t, w: triangle index bits
+const PATH_SUN_RADIANCE = 5u;  // xyz: the sun sample's contribution, if unoccluded
+const PATH_SKY_RADIANCE = 6u;  // xyz: the sky sample's contribution, if unoccluded
+
+// The queues are stored back to back. The extend queue is double-buffered, since `shade` writes
+// the next bounce's queue while the current one is being read.
+const QUEUE_EXTEND_EVEN = 0u;
+const QUEUE_EXTEND_ODD = 1u;
+const QUEUE_SHADE = 2u;
+const QUEUE_MISS = 3u;
+
+// Matches `BVH_SHORT_STACK_SIZE` in common/ray_intersection.hpp.
+const SHORT_STACK_SIZE = 4u;
+// The level of the root node in the restart trail, see `rayIntersectBvhShortStack`.
+const ROOT_LEVEL = 0x80000000u;
+const NO_BATCH = 0xffffffffu;
+
+// The short stacks of the invocations are interleaved, so that neighbouring invocations access
+// neighbouring words.
+var<workgroup> shortStacks: array<u32, SHORT_STACK_SIZE * WORKGROUP_SIZE>;
+var<workgroup> workgroupBatchBegin: u32;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn generate(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let pathIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    let numPaths = pathCount();
+    if pathIdx == 0u {
+        // Every path is extended on the first bounce.
+        queueState.bounce = 0u;
+        atomicStore(&queueState.nextExtendCount, numPaths);
+    }
+    if pathIdx >= numPaths {
+        return;
+    }
+
+    let dimensions = renderParams.frameData.dimensions;
+    let coord = pathCoord(pathIdx);
+    let u = (f32(coord.x) + 0.5f) / f32(dimensions.x);
+    let v = (f32(coord.y) + 0.5f) / f32(dimensions.y);
+    let blueNoise = pathBlueNoise(pathIdx);
+    let jitter = blueNoise / vec2f(dimensions);
+    let primaryRay = generateCameraRay(blueNoise, renderParams.camera, u + jitter.x, (1.0 - v) + jitter.y);
+
+    pathState[pathStateIdx(PATH_ORIGIN, pathIdx)] = vec4(primaryRay.origin, 0f);
+    pathState[pathStateIdx(PATH_DIRECTION, pathIdx)] = vec4(primaryRay.direction, 0f);
+    pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)] = vec4(1f);
+    pathState[pathStateIdx(PATH_RADIANCE, pathIdx)] = vec4(0f);
+    queues[extendQueueOffset(1u) + pathIdx] = pathIdx;
+}
+
+// Finds the closest hit of each path in the extend queue, and sorts the paths into the shade and
+// miss queues.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn extend(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= queueState.extendCount {
+        return;
+    }
+
+    let pathIdx = queues[extendQueueOffset(queueState.bounce) + queueIdx];
+    var hit: PathHit;
+    let didIntersect = rayIntersectBvh(pathRay(pathIdx), T_MAX, &hit);
+    queueExtendedPath(pathIdx, didIntersect, hit);
+}
+
+// A fixed number of workgroups is dispatched, which fetch batches of paths from the extend queue
+// until it is empty. The paths are traced with the short-stack traversal.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn extendPersistent(@builtin(local_invocation_index) localIdx: u32) {
+    loop {
+        // The previous batch begin must have been read by every invocation before it is replaced.
+        workgroupBarrier();
+        if localIdx == 0u {
+            let batchBegin = atomicAdd(&queueState.extendFetchCount, WORKGROUP_SIZE);
+            workgroupBatchBegin = select(NO_BATCH, batchBegin, batchBegin < queueState.extendCount);
+        }
+        let batchBegin = workgroupUniformLoad(&workgroupBatchBegin);
+        if batchBegin == NO_BATCH {
+            break;
+        }
+
+        let queueIdx = batchBegin + localIdx;
+        if queueIdx < queueState.extendCount {
+            let pathIdx = queues[extendQueueOffset(queueState.bounce) + queueIdx];
+            var hit: PathHit;
+            let didIntersect = rayIntersectBvhShortStack(pathRay(pathIdx), T_MAX, localIdx, &hit);
+            queueExtendedPath(pathIdx, didIntersect, hit);
+        }
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn miss(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= atomicLoad(&queueState.missCount) {
+        return;
+    }
+
+    let pathIdx = queues[queueOffset(QUEUE_MISS) + queueIdx];
+    let bsdfPdf = pathState[pathStateIdx(PATH_ORIGIN, pathIdx)].w;
+    let direction = pathState[pathStateIdx(PATH_DIRECTION, pathIdx)].xyz;
+    let throughput = pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)].xyz;
+
+    // Camera rays which miss the scene see the sky directly, and are not weighted.
+    let misWeight = select(powerHeuristic(bsdfPdf, skyDistributionPdf(direction)), 1f, queueState.bounce == 1u);
+    addPathRadiance(pathIdx, throughput * skyRadiance(direction) * misWeight);
+}
+
+// Samples the sun and the sky at each hit, leaving the visibility tests to `shadow`, and scatters
+// the paths which have bounces left into the next extend queue.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn shade(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= atomicLoad(&queueState.shadeCount) {
+        return;
+    }
+
+    let pathIdx = queues[queueOffset(QUEUE_SHADE) + queueIdx];
+    let bounce = queueState.bounce;
+    let numBounces = renderParams.samplingState.numBounces;
+    let hit = pathIntersection(pathState[pathStateIdx(PATH_HIT, pathIdx)]);
+    let throughput = pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)].xyz;
+    let blueNoise = pathBlueNoise(pathIdx);
+    let albedo = evalTexture(hit.textureDescriptorIdx, hit.uv);
+    let brdf = albedo * FRAC_1_PI;
+
+    let lightDirection = sampleSolarDiskDirection(blueNoise, SOLAR_COS_THETA_MAX, skyState.sunDirection);
+    let lightIntensity = vec3(
+        skyState.solarRadiances[CHANNEL_R],
+        skyState.solarRadiances[CHANNEL_G],
+        skyState.solarRadiances[CHANNEL_B]
+    );
+    let reflectance = brdf * dot(hit.n, lightDirection);
+    let sunRadiance = throughput * lightIntensity * reflectance * SOLAR_INV_PDF;
+    pathState[pathStateIdx(PATH_SUN_RADIANCE, pathIdx)] = vec4(sunRadiance, 0f);
+
+    // Sky light sample. On the last bounce, there is no BSDF sample to share the sky with.
+    var skySampleRadiance = vec3(0f);
+    let skySample = sampleSkyDistribution(fract(blueNoise + SKY_SAMPLE_NOISE_OFFSET));
+    let skyCosTheta = dot(hit.n, skySample.direction);
+    if skyCosTheta > 0f && skySample.pdf > 0f {
+        let misWeight = select(powerHeuristic(skySample.pdf, skyCosTheta * FRAC_1_PI), 1f, bounce == numBounces);
+        let skyReflectance = brdf * skyCosTheta;
+        skySampleRadiance = throughput * skyRadiance(skySample.direction) * skyReflectance * misWeight / skySample.pdf;
+    }
+    pathState[pathStateIdx(PATH_SKY_RADIANCE, pathIdx)] = vec4(skySampleRadiance, 0f);
+
+    // The shadow rays start from the path origin, so it is moved to the hit even on the last bounce.
+    if bounce == numBounces {
+        pathState[pathStateIdx(PATH_ORIGIN, pathIdx)] = vec4(hit.p, 0f);
+        return;
+    }
+
+    let scatter = evalImplicitLambertian(blueNoise, hit.n, albedo);
+    let bsdfPdf = dot(hit.n, scatter.wi) * FRAC_1_PI;
+    pathState[pathStateIdx(PATH_ORIGIN, pathIdx)] = vec4(hit.p, bsdfPdf);
+    pathState[pathStateIdx(PATH_DIRECTION, pathIdx)] = vec4(scatter.wi, 0f);
+    pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)] = vec4(throughput * scatter.throughput, 0f);
+
+    let extendIdx = atomicAdd(&queueState.nextExtendCount, 1u);
+    queues[extendQueueOffset(bounce + 1u) + extendIdx] = pathIdx;
+}
+
+// Traces the shadow rays of the paths shaded this bounce. The light sample directions are
+// recomputed from the path's blue noise instead of being stored in the path state.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn shadow(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= atomicLoad(&queueState.shadeCount) {
+        return;
+    }
+
+    let pathIdx = queues[queueOffset(QUEUE_SHADE) + queueIdx];
+    traceShadowRays(pathIdx, false, localIdx);
+}
+
+// The persistent-threads variant of `shadow`, see `extendPersistent`.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn shadowPersistent(@builtin(local_invocation_index) localIdx: u32) {
+    loop {
+        workgroupBarrier();
+        if localIdx == 0u {
+            let batchBegin = atomicAdd(&queueState.shadowFetchCount, WORKGROUP_SIZE);
+            let shadeCount = atomicLoad(&queueState.shadeCount);
+            workgroupBatchBegin = select(NO_BATCH, batchBegin, batchBegin < shadeCount);
+        }
+        let batchBegin = workgroupUniformLoad(&workgroupBatchBegin);
+        if batchBegin == NO_BATCH {
+            break;
+        }
+
+        let queueIdx = batchBegin + localIdx;
+        if queueIdx < atomicLoad(&queueState.shadeCount) {
+            let pathIdx = queues[queueOffset(QUEUE_SHADE) + queueIdx];
+            traceShadowRays(pathIdx, true, localIdx);
+        }
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn accumulate(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let pathIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if pathIdx >= pathCount() {
+        return;
+    }
+
+    let radiance = pathState[pathStateIdx(PATH_RADIANCE, pathIdx)].xyz;
+    if renderParams.samplingState.accumulatedSampleCount == 0u {
+        imageBuffer[pathIdx] = radiance;
+    } else {
+        imageBuffer[pathIdx] += radiance;
+    }
+}
+
+// Large queues are dispatched as a 2D grid of workgroups, see `dispatchSize` in
+// wavefront_queue.wgsl.
+@must_use
+fn invocationIdx(workgroupId: vec3u, numWorkgroups: vec3u, localIdx: u32) -> u32 {
+    return (workgroupId.y * numWorkgroups.x + workgroupId.x) * WORKGROUP_SIZE + localIdx;
+}
+
+@must_use
+fn pathCount() -> u32 {
+    let dimensions = renderParams.frameData.dimensions;
+    return dimensions.x * dimensions.y;
+}
+
+@must_use
+fn pathStateIdx(region: u32, pathIdx: u32) -> u32 {
+    return region * pathCount() + pathIdx;
+}
+
+@must_use
+fn queueOffset(queue: u32) -> u32 {
+    return queue * pathCount();
+}
+
+// The queue of paths which are extended on `bounce`.
+@must_use
+fn extendQueueOffset(bounce: u32) -> u32 {
+    return queueOffset(select(QUEUE_EXTEND_EVEN, QUEUE_EXTEND_ODD, bounce % 2u == 1u));
+}
+
+@must_use
+fn pathCoord(pathIdx: u32) -> vec2u {
+    let width = renderParams.frameData.dimensions.x;
+    return vec2u(pathIdx % width, pathIdx / width);
+}
+
+@must_use
+fn pathBlueNoise(pathIdx: u32) -> vec2f {
+    let samplingState = renderParams.samplingState;
+    return animatedBlueNoise(pathCoord(pathIdx), renderParams.frameData.frameCount, samplingState.numSamplesPerPixel);
+}
+
+@must_use
+fn pathRay(pathIdx: u32) -> Ray {
+    let origin = pathState[pathStateIdx(PATH_ORIGIN, pathIdx)];
+    let direction = pathState[pathStateIdx(PATH_DIRECTION, pathIdx)];
+    return Ray(origin.xyz, direction.xyz);
+}
+
+// Sorts an extended path into the shade or miss queue.
+fn queueExtendedPath(pathIdx: u32, didIntersect: bool, hit: PathHit) {
+    if didIntersect {
+        pathState[pathStateIdx(PATH_HIT, pathIdx)] = vec4(hit.b, hit.t, bitcast<f32>(hit.triangleIdx));
+        let shadeIdx = atomicAdd(&queueState.shadeCount, 1u);
+        queues[queueOffset(QUEUE_SHADE) + shadeIdx] = pathIdx;
+    } else {
+        let missIdx = atomicAdd(&queueState.missCount, 1u);
+        queues[queueOffset(QUEUE_MISS) + missIdx] = pathIdx;
+    }
+}
+
+fn traceShadowRays(pathIdx: u32, useShortStack: bool, localIdx: u32) {
+    let p = pathState[pathStateIdx(PATH_ORIGIN, pathIdx)].xyz;
+    let blueNoise = pathBlueNoise(pathIdx);
+
+    let lightDirection = sampleSolarDiskDirection(blueNoise, SOLAR_COS_THETA_MAX, skyState.sunDirection);
+    let sunRadiance = pathState[pathStateIdx(PATH_SUN_RADIANCE, pathIdx)].xyz;
+    var radiance = sunRadiance * visibility(Ray(p, lightDirection), useShortStack, localIdx);
+
+    let skySampleRadiance = pathState[pathStateIdx(PATH_SKY_RADIANCE, pathIdx)].xyz;
+    if any(skySampleRadiance != vec3(0f)) {
+        let skySample = sampleSkyDistribution(fract(blueNoise + SKY_SAMPLE_NOISE_OFFSET));
+        radiance += skySampleRadiance * visibility(Ray(p, skySample.direction), useShortStack, localIdx);
+    }
+
+    addPathRadiance(pathIdx, radiance);
+}
+
+@must_use
+fn visibility(ray: Ray, useShortStack: bool, localIdx: u32) -> f32 {
+    if useShortStack {
+        return shadowRayShortStack(ray, T_MAX, localIdx);
+    }
+    return shadowRay(ray, T_MAX);
+}
+
+fn addPathRadiance(pathIdx: u32, radiance: vec3f) {
+    let idx = pathStateIdx(PATH_RADIANCE, pathI)"
+R"(dx);
+    pathState[idx] = vec4(pathState[idx].xyz + radiance, 0f);
+}
+
+// Reconstructs the surface intersection from the barycentrics and triangle index stored by `extend`.
+@must_use
+fn pathIntersection(hit: vec4f) -> Intersection {
+    let triangleIdx = bitcast<u32>(hit.w);
+    let b = vec3f(1f - hit.x - hit.y, hit.x, hit.y);
+    let tri = positionAttributes[triangleIdx];
+    let e1 = tri.p1 - tri.p0;
+    let e2 = tri.p2 - tri.p0;
+    let p = tri.p0 + b[1] * e1 + b[2] * e2;
+    let faceNormal = normalize(cross(e1, e2));
+
+    let vert = vertexAttributes[triangleIdx];
+    let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
+    let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
+
+    return Intersection(offsetRay(p, faceNormal), n, uv, vert.textureDescriptorIdx);
+}
+
+struct RenderParams {
+  frameData: FrameData,
+  camera: Camera,
+  samplingState: SamplingState,
+  @align(16) exposure: f32,
+}
+
+struct FrameData {
+    dimensions: vec2u,
+    frameCount: u32,
+}
+
+struct Camera {
+    origin: vec3f,
+    lowerLeftCorner: vec3f,
+    horizontal: vec3f,
+    vertical: vec3f,
+    up: vec3f,
+    right: vec3f,
+    lensRadius: f32,
+}
+
+struct SamplingState {
+    numSamplesPerPixel: u32,
+    numBounces: u32,
+    accumulatedSampleCount: u32,
+}
+
+struct PathHit {
+    b: vec2f,
+    t: f32,
+    triangleIdx: u32,
+}
+
+struct Scatter {
+    wi: vec3f,
+    throughput: vec3f,
+}
+
+@must_use
+fn generateCameraRay(noise: vec2f, camera: Camera, u: f32, v: f32) -> Ray {
+    let randomPointInLens = camera.lensRadius * pointInUnitDisk(noise);
+    let lensOffset = randomPointInLens.x * camera.right + randomPointInLens.y * camera.up;
+
+    let origin = camera.origin + lensOffset;
+    let direction = normalize(camera.lowerLeftCorner + u * camera.horizontal + v * camera.vertical - origin);
+
+    return Ray(origin, direction);
+}
+
+@must_use
+fn evalImplicitLambertian(blueNoise: vec2f, n: vec3f, albedo: vec3f) -> Scatter {
+    let v = directionInCosineWeightedHemisphere(blueNoise);
+    let onb = pixarOnb(n);
+    let wi = onb * v;
+
+    return Scatter(wi, albedo);
+}
+
+// The closest hit of a path, stored in the path state for `shade`.
+@must_use
+fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, PathHit>) -> bool {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, tmax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                        tmax = trihit.t;
+                        didIntersect = true;
+                        *hit = PathHit(trihit.b.yz, trihit.t, node.trianglesOffset + idx);
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return didIntersect;
+}
+
+// The short-stack traversal with a restart trail, see `rayIntersectBvhShortStack` in
+// common/ray_intersection.cpp for the CPU reference. The children are tested before they are
+// visited, so that the trail can record whether both children of a node need to be visited.
+struct ShortStackTraversal {
+    intersector: RayAabbIntersector,
+    localIdx: u32,
+    stackTop: u32,
+    stackSize: u32,
+    trail: u32,
+    level: u32,
+    nodeIdx: u32,
+}
+
+@must_use
+fn shortStackTraversal(ray: Ray, localIdx: u32) -> ShortStackTraversal {
+    return ShortStackTraversal(rayAabbIntersector(ray), localIdx, 0u, 0u, 0u, ROOT_LEVEL, 0u);
+}
+
+// Moves to the child nodes of the current interior node which intersect the ray. Returns false if
+// neither child intersects the ray.
+@must_use
+fn shortStackDescend(traversal: ptr<function, ShortStackTraversal>, node: BvhNode, rayTMax: f32) -> bool {
+    let secondChildFirst = (*traversal).intersector.dirNeg[node.splitAxis] == 1u;
+    let firstIdx = select((*traversal).nodeIdx + 1u, node.secondChildOffset, secondChildFirst);
+    let secondIdx = select(node.secondChildOffset, (*traversal).nodeIdx + 1u, secondChildFirst);
+    let hitFirst = rayIntersectAabb((*traversal).intersector, bvhNodes[firstIdx].aabb, rayTMax);
+    let hitSecond = rayIntersectAabb((*traversal).intersector, bvhNodes[secondIdx].aabb, rayTMax);
+    // The trail can't represent deeper trees. Skipping the children terminates the traversal
+    // instead of looping forever.
+    if !(hitFirst || hitSecond) || (*traversal).level == 1u {
+        return false;
+    }
+
+    (*traversal).level >>= 1u;
+    if hitFirst && hitSecond {
+        if ((*traversal).trail & (*traversal).level) != 0u {
+            // The first child was visited before the restart.
+            (*traversal).nodeIdx = secondIdx;
+        } else {
+            // The oldest entry is overwritten when the short stack is full.
+            (*traversal).nodeIdx = firstIdx;
+            shortStacks[(*traversal).stackTop * WORKGROUP_SIZE + (*traversal).localIdx] = secondIdx;
+            (*traversal).stackTop = ((*traversal).stackTop + 1u) % SHORT_STACK_SIZE;
+            (*traversal).stackSize = min((*traversal).stackSize + 1u, SHORT_STACK_SIZE);
+        }
+    } else {
+        (*traversal).nodeIdx = select(secondIdx, firstIdx, hitFirst);
+        (*traversal).trail |= (*traversal).level;
+    }
+    return true;
+}
+
+// Moves to the next node after the current subtree, popping it from the short stack or restarting
+// from the root. Returns false once the traversal is done.
+@must_use
+fn shortStackPop(traversal: ptr<function, ShortStackTraversal>) -> bool {
+    // Adding the level to the trail moves to the next sibling on the deepest level which still has
+    // one, clearing the bits of the levels below it.
+    let trail = ((*traversal).trail & ~((*traversal).level - 1u)) + (*traversal).level;
+    if (trail & ROOT_LEVEL) != 0u {
+        return false;
+    }
+    (*traversal).trail = trail;
+    (*traversal).level = trail & (~trail + 1u);
+
+    if (*traversal).stackSize > 0u {
+        (*traversal).stackTop = ((*traversal).stackTop + SHORT_STACK_SIZE - 1u) % SHORT_STACK_SIZE;
+        (*traversal).stackSize -= 1u;
+        (*traversal).nodeIdx = shortStacks[(*traversal).stackTop * WORKGROUP_SIZE + (*traversal).localIdx];
+    } else {
+        (*traversal).nodeIdx = 0u;
+        (*traversal).level = ROOT_LEVEL;
+    }
+    return true;
+}
+
+// Returns 1.0 if no forward intersections, 0.0 otherwise.
+@must_use
+fn shadowRayShortStack(ray: Ray, rayTMax: f32, localIdx: u32) -> f32 {
+    var traversal = shortStackTraversal(ray, localIdx);
+    if !rayIntersectAabb(traversal.intersector, bvhNodes[0].aabb, rayTMax) {
+        return 1f;
+    }
+
+    loop {
+        let node: BvhNode = bvhNodes[traversal.nodeIdx];
+
+        if node.triangleCount > 0u {
+            for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                var trihit: TriangleHit;
+                if rayIntersectTriangle(ray, triangle, rayTMax, &trihit) {
+                    return 0f;
+                }
+            }
+        } else if shortStackDescend(&traversal, node, rayTMax) {
+            continue;
+        }
+
+        if !shortStackPop(&traversal) {
+            break;
+        }
+    }
+
+    return 1f;
+}
+
+@must_use
+fn rayIntersectBvhShortStack(ray: Ray, rayTMax: f32, localIdx: u32, hit: ptr<function, PathHit>) -> bool {
+    var traversal = shortStackTraversal(ray, localIdx);
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+    if !rayIntersectAabb(traversal.intersector, bvhNodes[0].aabb, tmax) {
+        return false;
+    }
+
+    loop {
+        let node: BvhNode = bvhNodes[traversal.nodeIdx];
+
+        if node.triangleCount > 0u {
+            for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                var trihit: TriangleHit;
+                if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                    tmax = trihit.t;
+                    didIntersect = true;
+                    *hit = PathHit(trihit.b.yz, trihit.t, node.trianglesOffset + idx);
+                }
+            }
+        } else if shortStackDescend(&traversal, node, tmax) {
+            continue;
+        }
+
+        if !shortStackPop(&traversal) {
+            break;
+        }
+    }
+
+    return didIntersect;
+}
+
+@must_use
+fn textureLookup(desc: TextureDescriptor, uv: vec2f) -> vec3f {
+    let u = fract(uv.x);
+    let v = fract(uv.y);
+
+    let x = min(u32(u * f32(desc.width)), desc.width - 1u);
+    let y = min(u32(v * f32(desc.height)), desc.height - 1u);
+
+    let idx = desc.offset + texelIndex(desc, x, y) * texelWordCount(desc.format);
+    let word0 = textureTexel(desc.page, idx);
+    var word1 = 0u;
+    if desc.format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        word1 = textureTexel(desc.page, idx + 1u);
+    }
+    return decodeTexel(desc.format, word0, word1);
+}
+)";
+
+const char* const WAVEFRONT_QUEUE_SOURCE = R"(// queue bind group
+@group(0) @binding(0) var<storage, read_write> queueState: QueueState;
+@group(0) @binding(1) var<storage, read_write> dispatchArgs: array<DispatchArgs>;
+
+// The bookkeeping kernels of the wavefront integrator. They run as a single invocation in between
+// the kernels in wavefront_path_tracer.wgsl, turning the queue counts into indirect dispatch
+// arguments. The dispatch arguments live in a separate buffer, since a buffer can't be used both as
+// a writable storage buffer and as an indirect buffer by the same dispatch.
+
+// The workgroup size of the kernels in wavefront_path_tracer.wgsl, overridden by the renderer.
+override WORKGROUP_SIZE: u32 = 64u;
+
+// Matches `maxComputeWorkgroupsPerDimension` in the WebGPU default limits.
+const MAX_WORKGROUPS_PER_DIMENSION = 65535u;
+
+// Matches `WavefrontDispatch` in reference_path_tracer.cpp.
+const DISPATCH_EXTEND = 0u;
+const DISPATCH_SHADE = 1u;
+const DISPATCH_MISS = 2u;
+
+// The atomic counters of `QueueState` in wavefront_path_tracer.wgsl are plain integers here, since
+// the kernels run as a single invocation.
+struct QueueState {
+    bounce: u32,
+    extendCount: u32,
+    shadeCount: u32,
+    missCount: u32,
+    nextExtendCount: u32,
+    extendFetchCount: u32,
+    shadowFetchCount: u32,
+}
+
+struct DispatchArgs {
+    x: u32,
+    y: u32,
+    z: u32,
+}
+
+// Makes the paths scattered by the previous bounce the current extend queue, and clears the
+// queues which the bounce fills.
+@compute @workgroup_size(1)
+fn beginBounce() {
+    queueState.bounce += 1u;
+    queueState.extendCount = queueState.nextExtendCount;
+    queueState.shadeCount = 0u;
+    queueState.missCount = 0u;
+    queueState.nextExtendCount = 0u;
+    queueState.extendFetchCount = 0u;
+    queueState.shadowFetchCount = 0u;
+    dispatchArgs[DISPATCH_EXTEND] = dispatchSize(queueState.extendCount);
+}
+
+// Runs after `extend` has filled the shade and miss queues.
+@compute @workgroup_size(1)
+fn prepareShade() {
+    dispatchArgs[DISPATCH_SHADE] = dispatchSize(queueState.shadeCount);
+    dispatchArgs[DISPATCH_MISS] = dispatchSize(queueState.missCount);
+}
+
+// Matches `wavefrontDispatchSize` in reference_path_tracer.cpp.
+@must_use
+fn dispatchSize(invocationCount: u32) -> DispatchArgs {
+    let workgroupCount = (invocationCount + WORKGROUP_SIZE - 1u) / WORKGROUP_SIZE;
+    let x = min(workgroupCount, MAX_WORKGROUPS_PER_DIMENSION);
+    let y = (workgroupCount + MAX_WORKGROUPS_PER_DIMENSION - 1u) / MAX_WORKGROUPS_PER_DIMENSION;
+    return DispatchArgs(x, y, 1u);
+}
+)";
+
+const char* const GPU_BVH_BUILDER_SOURCE = R"(// build bind group
+@group(0) @binding(0) var<uniform> buildParams: BuildParams;
+@group(0) @binding(1) var<storage, read> positionAttributes: array<Positions>;
+@group(0) @binding(2) var<storage, read_write> mortonCodes: array<u32>;
+@group(0) @binding(3) var<storage, read_write> triangleIndices: array<u32>;
+@group(0) @binding(4) var<storage, read_write> interiorNodes: array<InteriorNode>;
+@group(0) @binding(5) var<storage, read_write> parentIds: array<u32>;
+@group(0) @binding(6) var<storage, read_write> nodeBounds: array<AtomicAabb>;
+@group(0) @binding(7) var<storage, read_write> fitCounters: array<atomic<u32>>;
+@group(0) @binding(8) var<storage, read_write> sceneBounds: AtomicAabb;
+@group(0) @binding(9) var<storage, read_write> bvhNodes: array<BvhNode>;
+
+// The kernels of the LBVH builder, see `buildLbvh` in common/bvh.hpp for the CPU reference. The
+// renderer dispatches them in order, sorting the Morton codes and triangle indices with the kernels
+// in radix_sort.wgsl between `computeMortonCodes` and `emitHierarchy`.
+//
+// Node ids identify interior nodes by the index of the sorted triangle at either end of their
+// range, as in Karras, "Maximizing Parallelism in the Construction of BVHs, Octrees, and k-d
+// Trees". The ids of the leaves follow the interior nodes, so that the root always has id 0.
+
+// Matches `BVH_BUILDER_WORKGROUP_SIZE` in gpu_bvh_builder.cpp.
+const WORKGROUP_SIZE = 64u;
+const INVALID_NODE_ID = 0xffffffffu;
+const LEAF_SPLIT_AXIS = 0xffffffffu;
+const FLT_MIN = 1.17549435e-38f;
+
+struct BuildParams {
+    triangleCount: u32,
+    pad0: u32,
+    pad1: u32,
+    pad2: u32,
+}
+
+struct Positions {
+    p0: vec3f,
+    p1: vec3f,
+    p2: vec3f,
+}
+
+struct Aabb {
+    min: vec3f,
+    max: vec3f,
+}
+
+struct BvhNode {
+    aabb: Aabb,
+    trianglesOffset: u32,
+    secondChildOffset: u32,
+    triangleCount: u32,
+    splitAxis: u32,
+}
+
+struct InteriorNode {
+    leftChild: u32,
+    rightChild: u32,
+    rangeFirst: u32,
+    split: u32,
+    splitAxis: u32,
+}
+
+// Bounds which are merged with atomicMax, using `orderedBits`. The minimums are stored
+// complemented, so that zeroed bounds are empty.
+struct AtomicAabb {
+    minBits: array<atomic<u32>, 3>,
+    maxBits: array<atomic<u32>, 3>,
+}
+
+var<workgroup> workgroupCentroidBounds: AtomicAabb;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn computeSceneBounds(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    // The centroids are merged in workgroup memory first, which is zero-initialized, to reduce
+    // contention on the scene bounds.
+    let triangleIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if triangleIdx < buildParams.triangleCount {
+        let centroid = triangleCentroid(triangleIdx);
+        for (var axis = 0u; axis < 3u; axis += 1u) {
+            atomicMax(&workgroupCentroidBounds.minBits[axis], ~orderedBits(centroid[axis]));
+            atomicMax(&workgroupCentroidBounds.maxBits[axis], orderedBits(centroid[axis]));
+        }
+    }
+    workgroupBarrier();
+
+    if localIdx < 3u {
+        let axis = localIdx;
+        atomicMax(&sceneBounds.minBits[axis], atomicLoad(&workgroupCentroidBounds.minBits[axis]));
+        atomicMax(&sceneBounds.maxBits[axis], atomicLoad(&workgroupCentroidBounds.maxBits[axis]));
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn computeMortonCodes(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let triangleIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if triangleIdx >= buildParams.triangleCount {
+        return;
+    }
+
+    if triangleIdx == 0u {
+        parentIds[0] = INVALID_NODE_ID;
+    }
+
+    var boundsMin: vec3f;
+    var boundsMax: vec3f;
+    for (var axis = 0u; axis < 3u; axis += 1u) {
+        boundsMin[axis] = fromOrderedBits(~atomicLoad(&sceneBounds.minBits[axis]));
+        boundsMax[axis] = fromOrderedBits(atomicLoad(&sceneBounds.maxBits[axis]));
+    }
+    let extent = max(boundsMax - boundsMin, vec3f(FLT_MIN));
+    let unitCubePoint = (triangleCentroid(triangleIdx) - boundsMin) / extent;
+
+    mortonCodes[triangleIdx] = mortonCode(unitCubePoint);
+    triangleIndices[triangleIdx] = triangleIdx;
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn emitHierarchy(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let nodeId = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if nodeId + 1u >= buildParams.triangleCount {
+        return;
+    }
+
+    let i = i32(nodeId);
+
+    // Determine the direction of the range, and find its other end with an exponential search
+    // followed by a binary search.
+    let d = select(-1, 1, commonPrefixLength(i, i + 1) > commonPrefixLength(i, i - 1));
+    let minPrefixLength = commonPrefixLength(i, i - d);
+    var maxLength = 2;
+    while commonPrefixLength(i, i + maxLength * d) > minPrefixLength {
+        maxLength *= 2;
+    }
+    var rangeLength = 0;
+    for (var stride = maxLength / 2; stride > 0; stride /= 2) {
+        if commonPrefixLength(i, i + (rangeLength + stride) * d) > minPrefixLength {
+            rangeLength += stride;
+        }
+    }
+    let j = i + rangeLength * d;
+
+    // Find the split position, where the highest differing bit of the range flips.
+    let nodePrefixLength = commonPrefixLength(i, j);
+    var splitOffset = 0;
+    var stride = rangeLength;
+    loop {
+        stride = (stride + 1) / 2;
+        if commonPrefixLength(i, i + (splitOffset + stride) * d) > nodePrefixLength {
+            splitOffset += stride;
+        }
+        if stride <= 1 {
+            break;
+        }
+    }
+    let split = u32(i + splitOffset * d + min(d, 0));
+
+    let leafIdOffset = buildParams.triangleCount - 1u;
+    let first = u32(min(i, j));
+    let last = u32(max(i, j));
+    let leftChild = select(split, leafIdOffset + split, first == split);
+    let rightChild = select(split + 1u, leafIdOffset + split + 1u, last == split + 1u);
+
+    // The split bit's position within its 3-bit group determines the axis. Splits between
+    // duplicate codes are arbitrary.
+    var splitAxis = 0u;
+    if nodePrefixLength < 32 {
+        splitAxis = 2u - u32(31 - nodePrefixLength) % 3u;
+    }
+
+    interiorNodes[nodeId] = InteriorNode(leftChild, rightChild, first, split, splitAxis);
+    parentIds[leftChild] = nodeId;
+    parentIds[rightChild] = nodeId;
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn fitBounds(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let leafIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if leafIdx >= buildParams.triangleCount {
+        return;
+    }
+
+    var nodeId = buildParams.triangleCount - 1u + leafIdx;
+    var bounds = triangleAabb(triangleIndices[leafIdx]);
+    mergeNodeBounds(nodeId, bounds);
+
+    // Walk towards the root. The first child to reach a parent terminates, and the second child
+    // continues with the bounds of both children merged into the parent.
+    loop {
+        let parentId = parentIds[nodeId];
+        if parentId == INVALID_NODE_ID {
+            break;
+        }
+        mergeNodeBounds(parentId, bounds);
+        if atomicAdd(&fitCounters[parentId], 1u) == 0u {
+            break;
+        }
+        bounds = loadNodeBounds(parentId);
+        nodeId = parentId;
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn emitNodes(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let nodeId = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    let leafIdOffset = buildParams.triangleCount - 1u;
+    if nodeId >= leafIdOffset + buildParams.triangleCount {
+        return;
+    }
+
+    // The node's depth-first index is found by walking towards the root. A first child directly
+    // follows its parent. A subtree over k leaves contains 2k - 1 nodes, so a second child follows
+    // its parent by twice the leaf count of the first child.
+    var nodeIdx = 0u;
+    var childId = nodeId;
+    loop {
+        let parentId = parentIds[childId];
+        if parentId == INVALID_NODE_ID {
+            break;
+        }
+        let parent = interiorNodes[parentId];
+        if parent.leftChild == childId {
+            nodeIdx += 1u;
+        } else {
+            nodeIdx += firstChildNodeCount(parent) + 1u;
+        }
+        childId = parentId;
+    }
+
+    let bounds = loadNodeBounds(nodeId);
+    if nodeId < leafIdOffset {
+        let node = interiorNodes[nodeId];
+        let secondChildOffset = nodeIdx + firstChildNodeCount(node) + 1u;
+        bvhNodes[nodeIdx] = BvhNode(bounds, 0u, secondChildOffset, 0u, node.splitAxis);
+    } else {
+        let triangleIdx = triangleIndices[nodeId - leafIdOffset];
+        bvhNodes[nodeIdx] = BvhNode(bounds, triangleIdx, 0u, 1u, LEAF_SPLIT_AXIS);
+    }
+}
+
+@must_use
+fn invocationIdx(workgroupId: vec3u, numWorkgroups: vec3u, localIdx: u32) -> u32 {
+    return (workgroupId.y * numWorkgroups.x + workgroupId.x) * WORKGROUP_SIZE + localIdx;
+}
+
+@must_use
+fn firstChildNodeCount(node: InteriorNode) -> u32 {
+    return 2u * (node.split - node.rangeFirst + 1u) - 1u;
+}
+
+// The length of the common prefix of the sorted Morton codes at `i` and `j`, or -1 if `j` is out of
+// range. Duplicate codes are disambiguated by their index.
+@must_use
+fn commonPrefixLength(i: i32, j: i32) -> i32 {
+    if j < 0 || j >= i32(buildParams.triangleCount) {
+        return -1;
+    }
+    let ki = mortonCodes[i];
+    let kj = mortonCodes[j];
+    if ki == kj {
+        return 32 + i32(countLeadingZeros(u32(i ^ j)));
+    }
+    return i32(countLeadingZeros(ki ^ kj));
+}
+
+// The 30-bit Morton code of a point in the unit cube, with the x-axis in the most significant bit
+// of each 3-bit group.
+@must_use
+fn mortonCode(unitCubePoint: vec3f) -> u32 {
+    let quantized = vec3u(clamp(unitCubePoint * 1024f, vec3f(0f), vec3f(1023f)));
+    return (expandBits(quantized.x) << 2u) | (expandBits(quantized.y) << 1u) |
+        expandBits(quantized.z);
+}
+
+// Spreads the lower 10 bits of `v` so that there are two zero bits between each bit.
+@must_use
+fn expandBits(v: u32) -> u32 {
+    var x = (v * 0x00010001u) & 0xff0000ffu;
+    x = (x * 0x00000101u) & 0x0f00f00fu;
+    x = (x * 0x00000011u) & 0xc30c30c3u;
+    x = (x * 0x00000005u) & 0x49249249u;
+    return x;
+}
+
+@must_use
+fn triangleAabb(triangleIdx: u32) -> Aabb {
+    let tri = positionAttributes[triangleIdx];
+    return Aabb(min(min(tri.p0, tri.p1), tri.p2), max(max(tri.p0, tri.p1), tri.p2));
+}
+
+@must_use
+fn triangleCentroid(triangleIdx: u32) -> vec3f {
+    let aabb = triangleAabb(triangleIdx);
+    return 0.5f * (aabb.min + aabb.max);
+}
+
+fn mergeNodeBounds(nodeId: u32, bounds: Aabb) {
+    for (var axis = 0u; axis < 3u; axis += 1u) {
+        atomicMax(&nodeBounds[nodeId].minBits[axis], ~orderedBits(bounds.min[axis]));
+        atomicMax(&nodeBounds[nodeId].maxBits[axis], orderedBits(bounds.max[axis]));
+    }
+}
+
+@must_use
+fn loadNodeBounds(nodeId: u32) -> Aabb {
+    var bounds: Aabb;
+    for (var axis = 0u; axis < 3u; axis += 1u) {
+        bounds.min[axis] = fromOrderedBits(~atomicLoad(&nodeBounds[nodeId].minBits[axis]));
+        bounds.max[axis] = fromOrderedBits(atomicLoad(&nodeBounds[nodeId].maxBits[axis]));
+    }
+    return bounds;
+}
+
+// Maps a float to an unsigned integer of the same order: positive floats get their sign bit set,
+// and negative floats are complemented.
+@must_use
+fn orderedBits(x: f32) -> u32 {
+    let bits = bitcast<u32>(x);
+    return select(bits | 0x80000000u, ~bits, (bits & 0x80000000u) != 0u);
+}
+
+@must_use
+fn fromOrderedBits(ordered: u32) -> f32 {
+    return bitcast<f32>(select(~ordered, ordered & 0x7fffffffu, (ordered & 0x80000000u) != 0u));
+}
+)";
+
+const char* const RADIX_SORT_SOURCE = R"(// sort pass bind group
+@group(0) @binding(0) var<uniform> sortParams: SortParams;
+@group(0) @binding(1) var<storage, read> keysIn: array<u32>;
+@group(0) @binding(2) var<storage, read> valuesIn: array<u32>;
+@group(0) @binding(3) var<storage, read_write> keysOut: array<u32>;
+@group(0) @binding(4) var<storage, read_write> valuesOut: array<u32>;
+@group(0) @binding(5) var<storage, read_write> digitCounts: array<u32>;
+
+// A least significant digit radix sort of u32 keys and values, which sorts 8 bits per pass. Each
+// workgroup sorts a tile of WORKGROUP_SIZE keys. A pass counts the digits of each tile, scans the
+// counts in digit-major order to find each tile's output offset for each digit, and scatters the
+// keys. The scatter preserves the order of equal digits, so that the passes compose into a stable
+// sort.
+
+// Matches `RADIX_SORT_WORKGROUP_SIZE` in gpu_bvh_builder.cpp. There is one digit bin per
+// invocation.
+const WORKGROUP_SIZE = 256u;
+const RADIX_MASK = 0xffu;
+const NO_DIGIT = 0xffffffffu;
+
+struct SortParams {
+    keyCount: u32,
+    shift: u32,
+    tileCount: u32,
+    pad: u32,
+}
+
+var<workgroup> tileDigitCounts: array<atomic<u32>, WORKGROUP_SIZE>;
+var<workgroup> tileDigits: array<u32, WORKGROUP_SIZE>;
+var<workgroup> tileDigitOffsets: array<u32, WORKGROUP_SIZE>;
+var<workgroup> chunkSums: array<u32, WORKGROUP_SIZE>;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn countDigits(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let tileIdx = workgroupId.x + workgroupId.y * numWorkgroups.x;
+    if tileIdx >= sortParams.tileCount {
+        return;
+    }
+
+    // Workgroup memory is zero-initialized.
+    let keyIdx = tileIdx * WORKGROUP_SIZE + localIdx;
+    if keyIdx < sortParams.keyCount {
+        atomicAdd(&tileDigitCounts[keyDigit(keysIn[keyIdx])], 1u);
+    }
+    workgroupBarrier();
+
+    let digitCount = atomicLoad(&tileDigitCounts[localIdx]);
+    digitCounts[localIdx * sortParams.tileCount + tileIdx] = digitCount;
+}
+
+// Replaces the digit counts with their exclusive prefix sum. A single workgroup scans all counts:
+// each invocation sums a contiguous chunk of counts, the chunk sums are scanned in workgroup
+// memory, and each invocation then scans its own chunk.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scanDigitCounts(@builtin(local_invocation_index) localIdx: u32) {
+    let countCount = WORKGROUP_SIZE * sortParams.tileCount;
+    let chunkSize = (countCount + WORKGROUP_SIZE - 1u) / WORKGROUP_SIZE;
+    let chunkBegin = min(localIdx * chunkSize, countCount);
+    let chunkEnd = min(chunkBegin + chunkSize, countCount);
+
+    var chunkSum = 0u;
+    for (var idx = chunkBegin; idx < chunkEnd; idx += 1u) {
+        chunkSum += digitCounts[idx];
+    }
+    chunkSums[localIdx] = chunkSum;
+    workgroupBarrier();
+
+    // Hillis-Steele inclusive scan of the chunk sums.
+    for (var offset = 1u; offset < WORKGROUP_SIZE; offset *= 2u) {
+        var sum = chunkSums[localIdx];
+        if localIdx >= offset {
+            sum += chunkSums[localIdx - offset];
+        }
+        workgroupBarrier();
+        chunkSums[localIdx] = sum;
+        workgroupBarrier();
+    }
+
+    var prefix = chunkSums[localIdx] - chunkSum;
+    for (var idx = chunkBegin; idx < chunkEnd; idx += 1u) {
+        let count = digitCounts[idx];
+        digitCounts[idx] = prefix;
+        prefix += count;
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn scatter(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32,
+) {
+    let tileIdx = workgroupId.x + workgroupId.y * numWorkgroups.x;
+    if tileIdx >= sortParams.tileCount {
+        return;
+    }
+
+    let keyIdx = tileIdx * WORKGROUP_SIZE + localIdx;
+    let isKey = keyIdx < sortParams.keyCount;
+    var key = 0u;
+    var digit = NO_DIGIT;
+    if isKey {
+        key = keysIn[keyIdx];
+        digit = keyDigit(key);
+    }
+    tileDigits[localIdx] = digit;
+    tileDigitOffsets[localIdx] = digitCounts[localIdx * sortParams.tileCount + tileIdx];
+    workgroupBarrier();
+
+    if isKey {
+        // Ranking the key among the equal digits which precede it in the tile keeps the sort
+        // stable.
+        var rank = 0u;
+        for (var idx = 0u; idx < localIdx; idx += 1u) {
+            rank += select(0u, 1u, tileDigits[idx] == digit);
+        }
+        let dstIdx = tileDigitOffsets[digit] + rank;
+        keysOut[dstIdx] = key;
+        valuesOut[dstIdx] = valuesIn[keyIdx];
+    }
+}
+
+@must_use
+fn keyDigit(key: u32) -> u32 {
+    return (key >> sortParams.shift) & RADIX_MASK;
+}
+)";
+
+const char* const DEFERRED_RENDERER_GBUFFER_PASS_SOURCE = R"(struct Uniforms {
+    viewReverseZProjectionMat: mat4x4f
+}
+
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
+
+struct VertexInput {
+    @location(0) position: vec4f,
+    @location(1) normal: vec4f,
+    @location(2) texCoord: vec2f,
+}
+
+struct VertexOutput {
+    @builtin(position) position: vec4f,
+    @location(0) normal: vec4f,
+    @location(1) texCoord: vec2f,
+}
+
+@vertex
+fn vsMain(in: VertexInput) -> VertexOutput {
+    var out: VertexOutput;
+    out.position = uniforms.viewReverseZProjectionMat * in.position;
+    out.normal = in.normal;
+    out.texCoord = in.texCoord;
+    return out;
+}
+
+@group(1) @binding(0) var textureSampler: sampler;
+@group(2) @binding(0) var texture: texture_2d<f32>;
+
+struct GbufferOutput {
+    @location(0) albedo: vec4<f32>,
+    @location(1) normal: vec4<f32>,
+}
+
+@fragment
+fn fsMain(in: VertexOutput) -> GbufferOutput {
+    // sRGB textures use an sRGB texture format, so the sampled albedo is always linear.
+    let linearAlbedo = textureSample(texture, textureSampler, in.texCoord).xyz;
+    let encodedNormal = 0.5f * in.normal.xyz + vec3f(0.5f);
+    return GbufferOutput(vec4(linearAlbedo, 1f), vec4(encodedNormal, 1f));
+}
+)";
+
+const char* const DEFERRED_RENDERER_DEBUG_PASS_SOURCE = R"(struct VertexInput {
+    @location(0) position: vec2f,
+}
+
+struct VertexOutput {
+    @builtin(position) position: vec4f,
+    @location(0) texCoord: vec2f,
+}
+
+@vertex
+fn vsMain(in: VertexInput) -> VertexOutput {
+    let uv = 0.5 * in.position + vec2f(0.5);
+    var out: VertexOutput;
+    out.position = vec4f(in.position, 0.0, 1.0);
+    out.texCoord = vec2f(uv.x, 1.0 - uv.y);
+
+    return out;
+}
+
+@group(0) @binding(0) var<uniform> framebufferSize: vec2f;
+@group(1) @binding(0) var gbufferAlbedo: texture_2d<f32>;
+@group(1) @binding(1) var gbufferNormal: texture_2d<f32>;
+@group(1) @binding(2) var gbufferDepth: texture_depth_2d;
+
+@fragment
+fn fsMain(in: VertexOutput) -> @location(0) vec4f {
+    let c = in.texCoord;
+    let idx = vec2u(floor(c * framebufferSize));
+    var rgb = vec3f(0f);
+    if c.x < 0.333 {
+        rgb = textureLoad(gbufferAlbedo, idx, 0).rgb;
+    } else if c.x < 0.666 {
+        rgb = textureLoad(gbufferNormal, idx, 0).rgb;
+    } else {
+        let d = textureLoad(gbufferDepth, idx, 0);
+        let x = d;
+        let a = 0.1;
+        rgb = vec3((1.0 + a) * x / (x + vec3(a)));
+    }
+    let srgb = pow(rgb, vec3(1.0 / 2.2));
+    return vec4(srgb, 1.0);
+}
+)";
+
+const char* const DEFERRED_RENDERER_LIGHTING_PASS_SOURCE = R"(// Closest-hit BVH traversal, which interpolates the vertex attributes at the hit. The including
+// shader declares the `bvhNodes`, `positionAttributes`, and `vertexAttributes` bindings.
+
+// Ray-primitive intersection and BVH visibility queries. The including shader declares the
+// `bvhNodes` and `positionAttributes` bindings.
+
+const T_MIN = 0.001f;
+// The maximum ray extent. Specializing it lets the compiler fold it into the traversal.
+override T_MAX: f32 = 10000f;
+
+struct Ray {
+    origin: vec3f,
+    direction: vec3f
+}
+
+struct Aabb {
+    min: vec3f,
+    max: vec3f,
+}
+
+struct BvhNode {
+    aabb: Aabb,
+    trianglesOffset: u32,
+    secondChildOffset: u32,
+    triangleCount: u32,
+    splitAxis: u32,
+}
+
+struct Positions {
+    p0: vec3f,
+    p1: vec3f,
+    p2: vec3f,
+}
+
+struct VertexAttributes {
+    n0: vec3f,
+    n1: vec3f,
+    n2: vec3f,
+
+    uv0: vec2f,
+    uv1: vec2f,
+    uv2: vec2f,
+
+    textureDescriptorIdx: u32,
+}
+
+struct Intersection {
+    p: vec3f,
+    n: vec3f,
+    uv: vec2f,
+    textureDescriptorIdx: u32,
+}
+
+struct TriangleHit {
+    p: vec3f,
+    b: vec3f,
+    t: f32,
+}
+
+// Returns 1.0 if no forward intersections, 0.0 otherwise.
+@must_use
+fn shadowRay(ray: Ray, rayTMax: f32) -> f32 {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, rayTMax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    // TODO: trihit not actually used. A different code path could be used?
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, rayTMax, &trihit) {
+                        return 0f;
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return 1f;
+}
+
+struct RayAabbIntersector {
+    origin: vec3f,
+    invDir: vec3f,
+    dirNeg: vec3u,
+}
+
+@must_use
+fn rayAabbIntersector(ray: Ray) -> RayAabbIntersector {
+    let invDirection = vec3f(1f / ray.direction.x, 1f / ray.direction.y, 1f / ray.direction.z);
+    return RayAabbIntersector(
+        ray.origin,
+        invDirection,
+        vec3u(select(0u, 1u, (invDirection.x < 0f)), select(0u, 1u, (invDirection.y < 0f)), select(0u, 1u, (invDirection.z < 0f)))
+    );
+}
+
+@must_use
+fn rayIntersectAabb(intersector: RayAabbIntersector, aabb: Aabb, rayTMax: f32) -> bool {
+    let bounds: array<vec3f, 2> = array(aabb.min, aabb.max);
+
+    var tmin: f32 = (bounds[intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+    var tmax: f32 = (bounds[1u - intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+
+    let tymin: f32 = (bounds[intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+    let tymax: f32 = (bounds[1 - intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+
+    if (tmin > tymax) || (tymin > tmax) {
+        return false;
+    }
+
+    tmin = max(tymin, tmin);
+    tmax = min(tymax, tmax);
+
+    let tzmin: f32 = (bounds[intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+    let tzmax: f32 = (bounds[1 - intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+
+    if (tmin > tzmax) || (tzmin > tmax) {
+        return false;
+    }
+
+    tmin = max(tzmin, tmin);
+    tmax = min(tzmax, tmax);
+
+    return (tmin < rayTMax) && (tmax > 0.0);
+}
+
+@must_use
+fn rayIntersectTriangle(ray: Ray, tri: Positions, tmax: f32, hit: ptr<function, TriangleHit>) -> bool {
+    // Mäller-Trumbore algorithm
+    // https://en.wikipedia.org/wiki/Möller–Trumbore_intersection_algorithm
+    let e1 = tri.p1 - tri.p0;
+    let e2 = tri.p2 - tri.p0;
+
+    let h = cross(ray.direction, e2);
+    let det = dot(e1, h);
+
+    if det > -EPSILON && det < EPSILON {
+        return false;
+    }
+
+    let invDet = 1.0f / det;
+    let s = ray.origin - tri.p0;
+    let u = invDet * dot(s, h);
+
+    if u < 0.0f || u > 1.0f {
+        return false;
+    }
+
+    let q = cross(s, e1);
+    let v = invDet * dot(ray.direction, q);
+
+    if v < 0.0f || u + v > 1.0f {
+        return false;
+    }
+
+    let t = invDet * dot(e2, q);
+
+    if t > EPSILON && t < tmax {
+        // https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection.html
+        // e1 = v1 - v0
+        // e2 = v2 - v0
+        // -> p = v0 + u * e1 + v * e2
+        let p = tri.p0 + u * e1 + v * e2;
+        let n = normalize(cross(e1, e2));
+        let b = vec3f(1f - u - v, u, v);
+        *hit = TriangleHit(offsetRay(p, n), b, t);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+const ORIGIN = 1f / 32f;
+const FLOAT_SCALE = 1f / 65536f;
+const INT_SCALE = 256f;
+
+@must_use
+fn offsetRay(p: vec3f, n: vec3f) -> vec3f {
+    // Source: A Fast and Robust Method for Avoiding Self-Intersection, Ray Tracing Gems
+    let offset = vec3i(i32(INT_SCALE * n.x), i32(INT_SCALE * n.y), i32(INT_SCALE * n.z));
+    // Offset added straight into the mantissa bits to ensure the offset is scale-invariant,
+    // except for when close to the origin, where we use FLOAT_SCALE as a small epsilon.
+    let po = vec3f(
+        bitcast<f32>(bitcast<i32>(p.x) + select(offset.x, -offset.x, (p.x < 0))),
+        bitcast<f32>(bitcast<i32>(p.y) + select(offset.y, -offset.y, (p.y < 0))),
+        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0)))
+    );
+
+    return vec3f(
+        select(po.x, p.x + FLOAT_SCALE * n.x, (abs(p.x) < ORIGIN)),
+        select(po.y, p.y + FLOAT_SCALE * n.y, (abs(p.y) < ORIGIN)),
+        select(po.z, p.z + FLOAT_SCALE * n.z, (abs(p.z) < ORIGIN))
+    );
+}
+
+
+@must_use
+fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, Intersection>) -> bool {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, tmax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                        tmax = trihit.t;
+                        didIntersect = true;
+
+                        let b = trihit.b;
+                        let triangleIdx = node.trianglesOffset + idx;
+                        let vert = vertexAttributes[triangleIdx];
+
+                        let p = trihit.p;
+                        let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
+                        let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
+                        let textureDescriptorIdx = vertexAttributes[triangleIdx].textureDescriptorIdx;
+
+                        *hit = Intersection(p, n, uv, textureDescriptorIdx);
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return didIntersect;
+}
+
+// The sky model: the radiance LUT, the sky sampling distribution, and the solar disk. The including
+// shader declares the `skyState` binding.
+
+// Shared sampling routines. The including shader declares the `blueNoise` binding.
+
+const EPSILON = 0.00001f;
+
+const PI = 3.1415927f;
+const FRAC_1_PI = 0.31830987f;
+const FRAC_PI_2 = 1.5707964f;
+
+const ONE_MINUS_EPSILON = 0.99999994f;
+
+struct BlueNoise {
+    width: u32,
+    height: u32,
+    data: array<vec2f>,
+}
+
+@must_use
+fn animatedBlueNoise(coord: vec2u, frameIdx: u32, totalSampleCount: u32) -> vec2f {
+    let idx = (coord.y % blueNoise.height) * blueNoise.width + (coord.x % blueNoise.width);
+    let blueNoise = blueNoise.data[idx];
+    // 2-dimensional golden ratio additive recurrence sequence
+    // https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
+    let n = frameIdx % totalSampleCount;
+    let a1 = 0.7548776662466927f;
+    let a2 = 0.5698402909980532f;
+    let r2Seq = fract(vec2(
+        a1 * f32(n),
+        a2 * f32(n)
+    ));
+    return fract(blueNoise + r2Seq);
+}
+
+// The power heuristic with an exponent of two, for combining light and BSDF samples.
+@must_use
+fn powerHeuristic(pdf: f32, otherPdf: f32) -> f32 {
+    let a = pdf * pdf;
+    let b = otherPdf * otherPdf;
+    return select(0f, a / (a + b), a > 0f);
+}
+
+@must_use
+fn pixarOnb(n: vec3f) -> mat3x3f {
+    // https://www.jcgt.org/published/0006/01/01/paper-lowres.pdf
+    let s = select(-1f, 1f, n.z >= 0f);
+    let a = -1f / (s + n.z);
+    let b = n.x * n.y * a;
+    let u = vec3(1f + s * n.x * n.x * a, s * b, -s * n.x);
+    let v = vec3(b, s + n.y * n.y * a, -n.y);
+
+    return mat3x3(u, v, n);
+}
+
+// `u` is a random number in [0, 1].
+@must_use
+fn directionInCone(u: vec2f, cosThetaMax: f32) -> vec3f {
+    let cosTheta = 1f - u.x * (1f - cosThetaMax);
+    let sinTheta = sqrt(1f - cosTheta * cosTheta);
+    let phi = 2f * PI * u.y;
+
+    let x = cos(phi) * sinTheta;
+    let y = sin(phi) * sinTheta;
+    let z = cosTheta;
+
+    return vec3(x, y, z);
+}
+
+// `u` is a random number in [0, 1].
+@must_use
+fn directionInCosineWeightedHemisphere(u: vec2f) -> vec3f {
+    let phi = 2f * PI * u.y;
+    let sinTheta = sqrt(1f - u.x);
+
+    let x = cos(phi) * sinTheta;
+    let y = sin(phi) * sinTheta;
+    let z = sqrt(u.x);
+
+    return vec3(x, y, z);
+}
+
+// `u` is a random number in [0, 1]
+@must_use
+fn pointInUnitDisk(u: vec2f) -> vec2f {
+    let r = sqrt(u.x);
+    let theta = 2f * PI * u.y;
+    return vec2(r * cos(theta), r * sin(theta));
+}
+
+
+const CHANNEL_R = 0u;
+const CHANNEL_G = 1u;
+const CHANNEL_B = 2u;
+
+const DEGREES_TO_RADIANS = PI / 180f;
+const TERRESTRIAL_SOLAR_RADIUS = 0.255f * DEGREES_TO_RADIANS;
+
+const SOLAR_COS_THETA_MAX = cos(TERRESTRIAL_SOLAR_RADIUS);
+const SOLAR_INV_PDF = 2f * PI * (1f - SOLAR_COS_THETA_MAX);
+
+const SKY_RADIANCE_LUT_SIZE = 64u;
+const SKY_RADIANCE_LUT_FLOAT_COUNT = 3u * SKY_RADIANCE_LUT_SIZE * SKY_RADIANCE_LUT_SIZE;
+
+const SKY_DISTRIBUTION_WIDTH = 128u;
+const SKY_DISTRIBUTION_HEIGHT = 64u;
+const SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET = SKY_DISTRIBUTION_WIDTH * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + (SKY_DISTRIBUTION_WIDTH + 1u) * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_INTEGRAL_OFFSET = SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET + SKY_DISTRIBUTION_HEIGHT + 1u;
+const SKY_DISTRIBUTION_FLOAT_COUNT = SKY_DISTRIBUTION_INTEGRAL_OFFSET + 1u;
+
+// Rotates the blue noise used for the sun and BSDF samples, so that sky samples are decorrelated
+// from them.
+const SKY_SAMPLE_NOISE_OFFSET = vec2f(0.5f, 0.5f);
+
+struct SkyState {
     params: array<f32, 27>,
     skyRadiances: array<f32, 3>,
     solarRadiances: array<f32, 3>,
     sunDirection: vec3<f32>,
+    @align(16) radianceLut: array<f32, SKY_RADIANCE_LUT_FLOAT_COUNT>,
+    skyDistribution: array<f32, SKY_DISTRIBUTION_FLOAT_COUNT>,
 };
 
-struct Uniforms {
-    inverseViewReverseZProjectionMat: mat4x4f,
-    cameraEye: vec4f,
-    framebufferSize: vec2f,
-    frameCount: u32,
+// The sky dome radiance in direction `v`, without the solar disk.
+@must_use
+fn skyRadiance(v: vec3f) -> vec3f {
+    return skyDomeRadiance(v.y, dot(v, skyState.sunDirection));
 }
 
-struct Aabb {
-    min: vec3f,
-    max: vec3f,
+// Bilinearly interpolates the sky radiance LUT. Matches `sampleSkyRadianceLut` in
+// sky_radiance_lut.cpp.
+@must_use
+fn skyDomeRadiance(cosTheta: f32, cosGamma: f32) -> vec3f {
+    let maxCoord = f32(SKY_RADIANCE_LUT_SIZE - 1u);
+    let s = sqrt(sqrt(abs(cosTheta)));
+    let t = sqrt(clamp(0.5f * (1f - cosGamma), 0f, 1f));
+    let x = min(s, 1f) * maxCoord;
+    let y = t * maxCoord;
+
+    let x0 = min(u32(x), SKY_RADIANCE_LUT_SIZE - 2u);
+    let y0 = min(u32(y), SKY_RADIANCE_LUT_SIZE - 2u);
+    let fx = x - f32(x0);
+    let fy = y - f32(y0);
+
+    let r0 = mix(skyRadianceLutEntry(x0, y0), skyRadianceLutEntry(x0 + 1u, y0), fx);
+    let r1 = mix(skyRadianceLutEntry(x0, y0 + 1u), skyRadianceLutEntry(x0 + 1u, y0 + 1u), fx);
+    return mix(r0, r1, fy);
 }
 
-struct BvhNode {
-    aabb: Aabb,
-    trianglesOffset: u32,
-    secondChildOffset: u32,
-    triangleCount: u32,
-    splitAxis: u32,
+@must_use
+fn skyRadianceLutEntry(col: u32, row: u32) -> vec3f {
+    let idx = 3u * (row * SKY_RADIANCE_LUT_SIZE + col);
+    return vec3(skyState.radianceLut[idx], skyState.radianceLut[idx + 1u], skyState.radianceLut[idx + 2u]);
 }
 
-struct Positions {
-    p0: vec3f,
-    p1: vec3f,
-    p2: vec3f,
+struct SkySample {
+    direction: vec3f,
+    pdf: f32,
 }
 
-struct VertexAttributes {
-    n0: vec3f,
-    n1: vec3f,
-    n2: vec3f,
+struct CdfSample {
+    x: f32,
+    offset: u32,
+}
 
-    uv0: vec2f,
-    uv1: vec2f,
-    uv2: vec2f,
+// Matches `sampleSkyDistribution` in common/sky_distribution.cpp.
+@must_use
+fn sampleSkyDistribution(u: vec2f) -> SkySample {
+    let row = sampleSkyDistributionCdf(SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET, SKY_DISTRIBUTION_HEIGHT, u.y);
+    let conditionalCdfOffset = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + row.offset * (SKY_DISTRIBUTION_WIDTH + 1u);
+    let col = sampleSkyDistributionCdf(conditionalCdfOffset, SKY_DISTRIBUTION_WIDTH, u.x);
 
-    textureDescriptorIdx: u32,
+    let theta = PI * row.x;
+    let phi = 2f * PI * col.x;
+    let sinTheta = sin(theta);
+    let direction = vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
+
+    return SkySample(direction, skyDistributionCellPdf(row.offset, col.offset, sinTheta));
+}
+
+// Matches `skyDistributionPdf` in common/sky_distribution.cpp.
+@must_use
+fn skyDistributionPdf(direction: vec3f) -> f32 {
+    let cosTheta = clamp(direction.y, -1f, 1f);
+    let sinTheta = sqrt(max(1f - cosTheta * cosTheta, 0f));
+
+    var phi = atan2(direction.z, direction.x);
+    if phi < 0f {
+        phi += 2f * PI;
+    }
+    let u = phi / (2f * PI);
+    let v = acos(cosTheta) / PI;
+
+    let col = min(u32(u * f32(SKY_DISTRIBUTION_WIDTH)), SKY_DISTRIBUTION_WIDTH - 1u);
+    let row = min(u32(v * f32(SKY_DISTRIBUTION_HEIGHT)), SKY_DISTRIBUTION_HEIGHT - 1u);
+
+    return skyDistributionCellPdf(row, col, sinTheta);
+}
+
+@must_use
+fn skyDistributionCellPdf(row: u32, col: u32, sinTheta: f32) -> f32 {
+    if sinTheta <= 0f {
+        return 0f;
+    }
+    let cellWeight = skyState.skyDistribution[row * SKY_DISTRIBUTION_WIDTH + col];
+    let integral = skyState.skyDistribution[SKY_DISTRIBUTION_INTEGRAL_OFFSET];
+    // The Jacobian of the mapping from (u, v) to the sphere is 2 * pi^2 * sin(theta).
+    return cellWeight / (integral * 2f * PI * PI * sinTheta);
 }
 
+// Inverts the piecewise-linear CDF of `segmentCount` segments at `cdfOffset`.
+@must_use
+fn sampleSkyDistributionCdf(cdfOffset: u32, segmentCount: u32, u: f32) -> CdfSample {
+    // Binary search for the last entry which is less than or equal to `u`.
+    var lo = 0u;
+    var hi = segmentCount;
+    while lo + )"
+R"(1u < hi {
+        let mid = (lo + hi) / 2u;
+        if skyState.skyDistribution[cdfOffset + mid] <= u {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    let cdf0 = skyState.skyDistribution[cdfOffset + lo];
+    let cdf1 = skyState.skyDistribution[cdfOffset + lo + 1u];
+    let width = cdf1 - cdf0;
+    let du = select(0f, (u - cdf0) / width, width > 0f);
+    return CdfSample(min((f32(lo) + du) / f32(segmentCount), ONE_MINUS_EPSILON), lo);
+}
+
+@must_use
+fn sampleSolarDiskDirection(u: vec2f, cosThetaMax: f32, sunDirection: vec3f) -> vec3f {
+    let v = directionInCone(u, cosThetaMax);
+    let onb = pixarOnb(sunDirection);
+    return onb * v;
+}
+
+// Texture lookups from the texture pages. The including shader declares the `textures` and
+// `texturePage0` to `texturePage3` bindings, and defines `textureLookup`.
+
 struct TextureDescriptor {
     width: u32,
     height: u32,
+    page: u32,
     offset: u32,
+    layout: u32,
+    format: u32,
 }
 
-struct Ray {
-    origin: vec3f,
-    direction: vec3f
+// Matches the texture descriptor buffer written by the renderer.
+struct TextureTable {
+    srgbToLinear: array<f32, 256>,
+    descriptors: array<TextureDescriptor>,
 }
 
-struct BlueNoise {
-    width: u32,
-    height: u32,
-    data: array<vec2f>,
+const TEXTURE_FORMAT_BGRA8_SRGB = 0u;
+const TEXTURE_FORMAT_RGBA16_FLOAT = 2u;
+
+const TEXTURE_LAYOUT_TILED = 1u;
+const TEXTURE_TILE_SIZE = 8u;
+
+@must_use
+fn evalTexture(textureDescriptorIdx: u32, uv: vec2f) -> vec3f {
+    let textureDesc = textures.descriptors[textureDescriptorIdx];
+    return textureLookup(textureDesc, uv);
 }
 
-const CHANNEL_R = 0u;
-const CHANNEL_G = 1u;
-const CHANNEL_B = 2u;
+// Matches `decodeTexel` in common/texture.hpp. `word1` is only used by two-word formats.
+@must_use
+fn decodeTexel(format: u32, word0: u32, word1: u32) -> vec3f {
+    if format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        return vec3(unpack2x16float(word0), unpack2x16float(word1).x);
+    }
+    if format == TEXTURE_FORMAT_BGRA8_SRGB {
+        return vec3(
+            textures.srgbToLinear[(word0 >> 16u) & 0xffu],
+            textures.srgbToLinear[(word0 >> 8u) & 0xffu],
+            textures.srgbToLinear[word0 & 0xffu]
+        );
+    }
+    return unpack4x8unorm(word0).zyx;
+}
 
-const EPSILON = 0.00001f;
-const PI = 3.1415927f;
-const FRAC_1_PI = 0.31830987f;
-const FRAC_PI_2 = 1.5707964f;
-const DEGREES_TO_RADIANS = PI / 180f;
+@must_use
+fn texelWordCount(format: u32) -> u32 {
+    return select(1u, 2u, format == TEXTURE_FORMAT_RGBA16_FLOAT);
+}
 
-const TERRESTRIAL_SOLAR_RADIUS = 0.255f * DEGREES_TO_RADIANS;
-const SOLAR_COS_THETA_MAX = cos(TERRESTRIAL_SOLAR_RADIUS);
-const SOLAR_INV_PDF = 2f * PI * (1f - SOLAR_COS_THETA_MAX);
+@must_use
+fn textureTexel(page: u32, idx: u32) -> u32 {
+    // Storage buffers can't be indexed dynamically, so the page is selected by branching.
+    switch page {
+        case 0u: { return texturePage0[idx]; }
+        case 1u: { return texturePage1[idx]; }
+        case 2u: { return texturePage2[idx]; }
+        default: { return texturePage3[idx]; }
+    }
+}
 
-const T_MIN = 0.001f;
-const T_MAX = 10000f;
+// Matches `texelIndex` in common/texture_layout.hpp.
+@must_use
+fn texelIndex(desc: TextureDescriptor, x: u32, y: u32) -> u32 {
+    if desc.layout == TEXTURE_LAYOUT_TILED {
+        let tilesX = (desc.width + TEXTURE_TILE_SIZE - 1u) / TEXTURE_TILE_SIZE;
+        let tileIdx = (y / TEXTURE_TILE_SIZE) * tilesX + (x / TEXTURE_TILE_SIZE);
+        let tileTexelIdx = part1By1(x) | (part1By1(y) << 1u);
+        return tileIdx * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + tileTexelIdx;
+    }
+
+    return y * desc.width + x;
+}
+
+// Spread the lower three bits of `v` so that there is a zero bit between each bit.
+@must_use
+fn part1By1(v: u32) -> u32 {
+    var x = v & 0x7u;
+    x = (x | (x << 2u)) & 0x33u;
+    x = (x | (x << 1u)) & 0x55u;
+    return x;
+}
+
+
+struct Uniforms {
+    inverseViewReverseZProjectionMat: mat4x4f,
+    cameraEye: vec4f,
+    framebufferSize: vec2f,
+    frameCount: u32,
+    lightingResolution: u32,
+}
+
+const TEXTURE_LAYOUT_VIRTUAL = 2u;
+
+// Matches `LightingResolution` in deferred_renderer.hpp.
+const LIGHTING_RESOLUTION_HALF = 1u;
+const LIGHTING_RESOLUTION_CHECKERBOARD = 2u;
+
+// Reconstruction weights of the traced pixels, see `reconstruct`.
+const RECONSTRUCTION_RELATIVE_DEPTH_SIGMA = 0.05f;
+const RECONSTRUCTION_NORMAL_EXPONENT = 32f;
+
+const VIRTUAL_TILE_SIZE = 64u;
+const INVALID_PHYSICAL_TILE = 0xffffffffu;
+// Returned while the virtual tile is being streamed in.
+const VIRTUAL_TILE_FALLBACK_TEXEL = 0xff808080u;
 
 @group(0) @binding(0) var<storage, read_write> sampleBuffer: array<array<f32, 3>>;
+@group(0) @binding(1) var<storage, read_write> virtualTileFeedback: array<atomic<u32>>;
+@group(0) @binding(2) var<storage, read> virtualTileIndirection: array<u32>;
+@group(0) @binding(3) var<storage, read> virtualTilePool: array<u32>;
 
 @group(1) @binding(0) var<uniform> uniforms: Uniforms;
 
@@ -801,46 +3371,143 @@ const T_MAX = 10000f;
 @group(3) @binding(1) var<storage, read> bvhNodes: array<BvhNode>;
 @group(3) @binding(2) var<storage, read> positionAttributes: array<Positions>;
 @group(3) @binding(3) var<storage, read> vertexAttributes: array<VertexAttributes>;
-@group(3) @binding(4) var<storage, read> textureDescriptors: array<TextureDescriptor>;
-@group(3) @binding(5) var<storage, read> textures: array<u32>;
-@group(3) @binding(6) var<storage, read> blueNoise: BlueNoise;
+@group(3) @binding(4) var<storage, read> textures: TextureTable;
+@group(3) @binding(5) var<storage, read> blueNoise: BlueNoise;
+@group(3) @binding(6) var<storage, read> texturePage0: array<u32>;
+@group(3) @binding(7) var<storage, read> texturePage1: array<u32>;
+@group(3) @binding(8) var<storage, read> texturePage2: array<u32>;
+@group(3) @binding(9) var<storage, read> texturePage3: array<u32>;
 
 @compute @workgroup_size(8, 8)
 fn main(@builtin(global_invocation_id) globalInvocationId: vec3<u32>) {
-    if globalInvocationId.x >= u32(uniforms.framebufferSize.x) || globalInvocationId.y >= u32(uniforms.framebufferSize.y) {
+    let textureIdx = tracedPixel(globalInvocationId.xy);
+    if textureIdx.x >= u32(uniforms.framebufferSize.x) || textureIdx.y >= u32(uniforms.framebufferSize.y) {
         return;
     }
 
-    let textureIdx = globalInvocationId.xy;
-    let uv = (vec2f(globalInvocationId.xy) + vec2f(0.5)) / uniforms.framebufferSize;
+    let uv = (vec2f(textureIdx) + vec2f(0.5)) / uniforms.framebufferSize;
 
     var color = vec3f(0.0, 0.0, 0.0);
     let depthSample = textureLoad(gbufferDepth, textureIdx, 0);
     if depthSample == 0.0 {
         let world = worldFromUv(uv, depthSample);
         let v = normalize(world - uniforms.cameraEye.xyz);
-        let s = skyState.sunDirection;
-
-        let theta = acos(v.y);
-        let gamma = acos(clamp(dot(v, s), -1f, 1f));
-        color = vec3f(
-            skyRadiance(theta, gamma, CHANNEL_R),
-            skyRadiance(theta, gamma, CHANNEL_G),
-            skyRadiance(theta, gamma, CHANNEL_B)
-        );
+        color = skyAndSunRadiance(v);
     } else {
         let coord = vec2u(uv * uniforms.framebufferSize);
         let position = worldFromUv(uv, depthSample);
         let encodedNormal = textureLoad(gbufferNormal, textureIdx, 0).rgb;
         let decodedNormal = 2f * encodedNormal - vec3(1f);
         let albedo = textureLoad(gbufferAlbedo, textureIdx, 0).rgb;
-        color = surfaceColor(coord, offsetPosition(position, decodedNormal), decodedNormal, albedo);
+        color = surfaceColor(coord, offsetRay(position, decodedNormal), decodedNormal, albedo);
+    }
+
+    let sampleBufferIdx = textureIdx.y * u32(uniforms.framebufferSize.x) + textureIdx.x;
+    sampleBuffer[sampleBufferIdx] = array<f32, 3>(color.r, color.g, color.b);
+}
+
+// Fills in the pixels which were not traced this frame from the traced pixels around them. Each
+// untraced pixel has at least one traced pixel in its 3x3 neighbourhood, and the traced pixels are
+// weighted by how closely their depth and normal match the pixel's. The sky is evaluated directly.
+@compute @workgroup_size(8, 8)
+fn reconstruct(@builtin(global_invocation_id) globalInvocationId: vec3<u32>) {
+    let textureIdx = globalInvocationId.xy;
+    if any(textureIdx >= vec2u(uniforms.framebufferSize)) || isTracedPixel(textureIdx) {
+        return;
     }
 
+    let uv = (vec2f(textureIdx) + vec2f(0.5)) / uniforms.framebufferSize;
     let sampleBufferIdx = textureIdx.y * u32(uniforms.framebufferSize.x) + textureIdx.x;
+    let depthSample = textureLoad(gbufferDepth, textureIdx, 0);
+    if depthSample == 0.0 {
+        let world = worldFromUv(uv, depthSample);
+        let color = skyAndSunRadiance(normalize(world - uniforms.cameraEye.xyz));
+        sampleBuffer[sampleBufferIdx] = array<f32, 3>(color.r, color.g, color.b);
+        return;
+    }
+    let normal = normalize(2f * textureLoad(gbufferNormal, textureIdx, 0).rgb - vec3(1f));
+
+    // The nearest traced pixel is the fallback, if no traced pixel is on the same surface.
+    var colorSum = vec3f(0f);
+    var weightSum = 0f;
+    var nearestColor = vec3f(0f);
+    var nearestDistance = 3f;
+    for (var y = -1; y <= 1; y++) {
+        for (var x = -1; x <= 1; x++) {
+            let tapIdx = vec2i(textureIdx) + vec2i(x, y);
+            if any(tapIdx < vec2i(0)) || any(tapIdx >= vec2i(uniforms.framebufferSize)) ||
+                !isTracedPixel(vec2u(tapIdx)) {
+                continue;
+            }
+            let tapSample = sampleBuffer[u32(tapIdx.y) * u32(uniforms.framebufferSize.x) + u32(tapIdx.x)];
+            let tapColor = vec3f(tapSample[0], tapSample[1], tapSample[2]);
+            let distance = length(vec2f(f32(x), f32(y)));
+            if distance < nearestDistance {
+                nearestColor = tapColor;
+                nearestDistance = distance;
+            }
+
+            let tapDepth = textureLoad(gbufferDepth, tapIdx, 0);
+            if tapDepth == 0f {
+                continue;
+            }
+            let tapNormal = normalize(2f * textureLoad(gbufferNormal, tapIdx, 0).rgb - vec3(1f));
+            let relativeDepthDifference = abs(depthSample - tapDepth) / max(depthSample, tapDepth);
+            let weight = exp2(-relativeDepthDifference / (RECONSTRUCTION_RELATIVE_DEPTH_SIGMA * distance)) *
+                pow(max(dot(normal, tapNormal), 0f), RECONSTRUCTION_NORMAL_EXPONENT) / distance;
+            colorSum += weight * tapColor;
+            weightSum += weight;
+        }
+    }
+
+    var color = nearestColor;
+    if weightSum > 1e-4f {
+        color = colorSum / weightSum;
+    }
     sampleBuffer[sampleBufferIdx] = array<f32, 3>(color.r, color.g, color.b);
 }
 
+// Maps the invocation to the pixel which it traces. At half resolution, each invocation traces one
+// pixel of a 2x2 block, and the traced pixel cycles through the block over four frames. In the
+// checkerboard pattern, each invocation traces one pixel of a horizontal pair of pixels, and the
+// traced pixels alternate every frame.
+@must_use
+fn tracedPixel(invocationId: vec2u) -> vec2u {
+    switch uniforms.lightingResolution {
+        case LIGHTING_RESOLUTION_HALF: {
+            return 2u * invocationId + halfResolutionOffset();
+        }
+        case LIGHTING_RESOLUTION_CHECKERBOARD: {
+            return vec2u(2u * invocationId.x + ((invocationId.y + uniforms.frameCount) & 1u), invocationId.y);
+        }
+        default: {
+            return invocationId;
+        }
+    }
+}
+
+@must_use
+fn isTracedPixel(textureIdx: vec2u) -> bool {
+    switch uniforms.lightingResolution {
+        case LIGHTING_RESOLUTION_HALF: {
+            return all(textureIdx % 2u == halfResolutionOffset());
+        }
+        case LIGHTING_RESOLUTION_CHECKERBOARD: {
+            return ((textureIdx.x + textureIdx.y + uniforms.frameCount) & 1u) == 0u;
+        }
+        default: {
+            return true;
+        }
+    }
+}
+
+// The traced pixel's offset within its 2x2 block. The diagonal pixels are traced first.
+@must_use
+fn halfResolutionOffset() -> vec2u {
+    let i = uniforms.frameCount % 4u;
+    return vec2u(i & 1u, (i >> 1u) ^ (i & 1u));
+}
+
 @must_use
 fn worldFromUv(uv: vec2f, depthSample: f32) -> vec3f {
     let ndc = vec4(2.0 * vec2(uv.x, 1.0 - uv.y) - vec2(1.0), depthSample, 1.0);
@@ -849,7 +3516,8 @@ fn worldFromUv(uv: vec2f, depthSample: f32) -> vec3f {
     return world.xyz;
 }
 
-const NUM_BOUNCES = 2;
+// The number of bounces, overridden by the renderer.
+override NUM_BOUNCES: u32 = 2u;
 
 @must_use
 fn surfaceColor(coord: vec2u, primaryPos: vec3f, primaryNormal: vec3f, primaryAlbedo: vec3f) -> vec3f {
@@ -860,9 +3528,9 @@ fn surfaceColor(coord: vec2u, primaryPos: vec3f, primaryNormal: vec3f, primaryAl
     var throughput = vec3(1f);
     let blueNoise = animatedBlueNoise(coord, uniforms.frameCount, 1 << 20);
 
-    radiance += throughput * lightSample(blueNoise, position, normal, albedo);
+    radiance += throughput * lightSample(blueNoise, position, normal, albedo, NUM_BOUNCES > 1u);
 
-    for (var bounce = 1; bounce < NUM_BOUNCES; bounce += 1) {
+    for (var bounce = 1u; bounce < NUM_BOUNCES; bounce += 1u) {
         let wi = evalImplicitLambertian(blueNoise, normal);
         let ray = Ray(position, wi);
         throughput *= albedo;
@@ -875,30 +3543,24 @@ fn surfaceColor(coord: vec2u, primaryPos: vec3f, primaryNormal: vec3f, primaryAl
             let textureDescriptorIdx = hit.textureDescriptorIdx;
             albedo = evalTexture(textureDescriptorIdx, uv);
         } else {
-            let v = ray.direction;
-            let s = skyState.sunDirection;
-
-            let theta = acos(v.y);
-            let gamma = acos(clamp(dot(v, s), -1f, 1f));
-
-            let skyRadiance = vec3f(
-                skyRadiance(theta, gamma, CHANNEL_R),
-                skyRadiance(theta, gamma, CHANNEL_G),
-                skyRadiance(theta, gamma, CHANNEL_B)
-            );
-
-            radiance += throughput * skyRadiance;
+            // The solar disk is sampled explicitly by `lightSample`, only the sky dome is weighted
+            // against the sky light samples.
+            let bsdfPdf = dot(normal, wi) * FRAC_1_PI;
+            let misWeight = powerHeuristic(bsdfPdf, skyDistributionPdf(wi));
+            radiance += throughput * skyDomeRadiance(wi.y, dot(wi, skyState.sunDirection)) * misWeight;
             break;
         }
 
-        radiance += throughput * lightSample(blueNoise, position, normal, albedo);
+        radiance += throughput * lightSample(blueNoise, position, normal, albedo, bounce + 1u < NUM_BOUNCES);
     }
 
     return radiance;
 }
 
+// Samples the sun and the sky dome. If `hasBsdfSample` is true, a BSDF sample follows, and the sky
+// sample is weighted against it with MIS.
 @must_use
-fn lightSample(u: vec2f, position: vec3f, normal: vec3f, albedo: vec3f) -> vec3f {
+fn lightSample(u: vec2f, position: vec3f, normal: vec3f, albedo: vec3f, hasBsdfSample: bool) -> vec3f {
     let lightDirection = sampleSolarDiskDirection(u, SOLAR_COS_THETA_MAX, skyState.sunDirection);
     let lightIntensity = vec3(
         skyState.solarRadiances[CHANNEL_R],
@@ -908,50 +3570,36 @@ fn lightSample(u: vec2f, position: vec3f, normal: vec3f, albedo: vec3f) -> vec3f
     let brdf = albedo * FRAC_1_PI;
     let reflectance = brdf * dot(normal, lightDirection);
     let lightVisibility = shadowRay(Ray(position, lightDirection), T_MAX);
-    return lightIntensity * reflectance * lightVisibility * SOLAR_INV_PDF;
+    var radiance = lightIntensity * reflectance * lightVisibility * SOLAR_INV_PDF;
+
+    let skySample = sampleSkyDistribution(fract(u + SKY_SAMPLE_NOISE_OFFSET));
+    let skyCosTheta = dot(normal, skySample.direction);
+    if skyCosTheta > 0f && skySample.pdf > 0f {
+        let skyVisibility = shadowRay(Ray(position, skySample.direction), T_MAX);
+        let misWeight = select(1f, powerHeuristic(skySample.pdf, skyCosTheta * FRAC_1_PI), hasBsdfSample);
+        let skyDirection = skySample.direction;
+        let skyDome = skyDomeRadiance(skyDirection.y, dot(skyDirection, skyState.sunDirection));
+        radiance += skyDome * brdf * skyCosTheta * skyVisibility * misWeight / skySample.pdf;
+    }
+
+    return radiance;
 }
 
 @must_use
-fn skyRadiance(theta: f32, gamma: f32, channel: u32) -> f32 {
+fn skyAndSunRadiance(v: vec3f) -> vec3f {
+    let cosGamma = dot(v, skyState.sunDirection);
+
     // Sky dome radiance
-    let r = skyState.skyRadiances[channel];
-    let idx = 9u * channel;
-    let p0 = skyState.params[idx + 0u];
-    let p1 = skyState.params[idx + 1u];
-    let p2 = skyState.params[idx + 2u];
-    let p3 = skyState.params[idx + 3u];
-    let p4 = skyState.params[idx + 4u];
-    let p5 = skyState.params[idx + 5u];
-    let p6 = skyState.params[idx + 6u];
-    let p7 = skyState.params[idx + 7u];
-    let p8 = skyState.params[idx + 8u];
-
-    let cosGamma = cos(gamma);
-    let cosGamma2 = cosGamma * cosGamma;
-    let cosTheta = abs(cos(theta));
-
-    let expM = exp(p4 * gamma);
-    let rayM = cosGamma2;
-    let mieMLhs = 1.0 + cosGamma2;
-    let mieMRhs = pow(1.0 + p8 * p8 - 2.0 * p8 * cosGamma, 1.5f);
-    let mieM = mieMLhs / mieMRhs;
-    let zenith = sqrt(cosTheta);
-    let radianceLhs = 1.0 + p0 * exp(p1 / (cosTheta + 0.01));
-    let radianceRhs = p2 + p3 * expM + p5 * rayM + p6 * mieM + p7 * zenith;
-    let radianceDist = radianceLhs * radianceRhs;
+    let domeRadiance = skyDomeRadiance(v.y, cosGamma);
 
     // Solar radiance
-    let solarDiskRadius = gamma / TERRESTRIAL_SOLAR_RADIUS;
-    let solarRadiance = select(0f, skyState.solarRadiances[channel], solarDiskRadius <= 1f);
-
-    return r * radianceDist + solarRadiance;
-}
+    let solarRadiance = vec3(
+        skyState.solarRadiances[CHANNEL_R],
+        skyState.solarRadiances[CHANNEL_G],
+        skyState.solarRadiances[CHANNEL_B]
+    );
 
-@must_use
-fn sampleSolarDiskDirection(u: vec2f, cosThetaMax: f32, direction: vec3f) -> vec3f {
-    let v = directionInCone(u, cosThetaMax);
-    let onb = pixarOnb(direction);
-    return onb * v;
+    return domeRadiance + select(vec3(0f), solarRadiance, cosGamma >= SOLAR_COS_THETA_MAX);
 }
 
 @must_use
@@ -961,327 +3609,521 @@ fn evalImplicitLambertian(u: vec2f, n: vec3f) -> vec3f {
     return onb * v;
 }
 
-@must_use
-fn evalTexture(textureDescriptorIdx: u32, uv: vec2f) -> vec3f {
-    let textureDesc = textureDescriptors[textureDescriptorIdx];
-    return textureLookup(textureDesc, uv);
-}
-
 @must_use
 fn textureLookup(desc: TextureDescriptor, uv: vec2f) -> vec3f {
     let u = fract(uv.x);
     let v = fract(uv.y);
 
-    let j = u32(u * f32(desc.width));
-    let i = u32(v * f32(desc.height));
-    let idx = i * desc.width + j;
-
-    let bgra = textures[desc.offset + idx];
-    let srgb = vec3(f32((bgra >> 16u) & 0xffu), f32((bgra >> 8u) & 0xffu), f32(bgra & 0xffu)) / 255f;
-    let linearRgb = pow(srgb, vec3(2.2f));
-    return linearRgb;
-}
-
-@must_use
-fn pixarOnb(n: vec3f) -> mat3x3f {
-    // https://www.jcgt.org/published/0006/01/01/paper-lowres.pdf
-    let s = select(-1f, 1f, n.z >= 0f);
-    let a = -1f / (s + n.z);
-    let b = n.x * n.y * a;
-    let u = vec3(1f + s * n.x * n.x * a, s * b, -s * n.x);
-    let v = vec3(b, s + n.y * n.y * a, -n.y);
+    let x = min(u32(u * f32(desc.width)), desc.width - 1u);
+    let y = min(u32(v * f32(desc.height)), desc.height - 1u);
 
-    return mat3x3(u, v, n);
-}
+    if desc.layout == TEXTURE_LAYOUT_VIRTUAL {
+        // Virtual textures only support 8-bit formats.
+        return decodeTexel(desc.format, virtualTexel(desc, x, y), 0u);
+    }
 
-struct Intersection {
-    p: vec3f,
-    n: vec3f,
-    uv: vec2f,
-    textureDescriptorIdx: u32,
+    let idx = desc.offset + texelIndex(desc, x, y) * texelWordCount(desc.format);
+    let word0 = textureTexel(desc.page, idx);
+    var word1 = 0u;
+    if desc.format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        word1 = textureTexel(desc.page, idx + 1u);
+    }
+    return decodeTexel(desc.format, word0, word1);
 }
 
-@must_use
-fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, Intersection>) -> bool {
-    let intersector = rayAabbIntersector(ray);
-    var toVisitOffset = 0u;
-    var currentNodeIdx = 0u;
-    var nodesToVisit: array<u32, 32u>;
-    var didIntersect: bool = false;
-    var tmax = rayTMax;
-
-    loop {
-        let node: BvhNode = bvhNodes[currentNodeIdx];
-
-        if rayIntersectAabb(intersector, node.aabb, tmax) {
-            if node.triangleCount > 0u {
-                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
-                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
-                    var trihit: TriangleHit;
-                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
-                        tmax = trihit.t;
-                        didIntersect = true;
+// Matches `VirtualTextureTable::virtualTileIndex` in common/virtual_texture.hpp. The texture's
+// first virtual tile is stored in `desc.offset`.
+fn virtualTexel(desc: TextureDescriptor, x: u32, y: u32) -> u32 {
+    let tilesX = (desc.width + VIRTUAL_TILE_SIZE - 1u) / VIRTUAL_TILE_SIZE;
+    let virtualTile = desc.offset + (y / VIRTUAL_TILE_SIZE) * tilesX + (x / VIRTUAL_TILE_SIZE);
+    atomicStore(&virtualTileFeedback[virtualTile], 1u);
 
-                        let b = trihit.b;
-                        let triangleIdx = node.trianglesOffset + idx;
-                        let vert = vertexAttributes[triangleIdx];
+    let physicalTile = virtualTileIndirection[virtualTile];
+    if physicalTile == INVALID_PHYSICAL_TILE {
+        return VIRTUAL_TILE_FALLBACK_TEXEL;
+    }
 
-                        let p = trihit.p;
-                        let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
-                        let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
-                        let textureDescriptorIdx = vertexAttributes[triangleIdx].textureDescriptorIdx;
+    let tileTexelIdx = (y % VIRTUAL_TILE_SIZE) * VIRTUAL_TILE_SIZE + (x % VIRTUAL_TILE_SIZE);
+    return virtualTilePool[physicalTile * VIRTUAL_TILE_SIZE * VIRTUAL_TILE_SIZE + tileTexelIdx];
+}
+)";
 
-                        *hit = Intersection(p, n, uv, textureDescriptorIdx);
-                    }
-                }
-                if toVisitOffset == 0u {
-                    break;
-                }
-                toVisitOffset -= 1u;
-                currentNodeIdx = nodesToVisit[toVisitOffset];
-            } else {
-                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
-                if intersector.dirNeg[node.splitAxis] == 1u {
-                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
-                    currentNodeIdx = node.secondChildOffset;
-                } else {
-                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
-                    currentNodeIdx = currentNodeIdx + 1u;
-                }
-                toVisitOffset += 1u;
-            }
-        } else {
-            if toVisitOffset == 0u {
-                break;
-            }
-            toVisitOffset -= 1u;
-            currentNodeIdx = nodesToVisit[toVisitOffset];
-        }
-    }
+const char* const DEFERRED_RENDERER_DENOISE_PASS_SOURCE = R"(// Reprojection of the current frame's surfaces into the previous frame, and the surface comparisons
+// used to reject mismatching history.
 
-    return didIntersect;
+// History is rejected if the reprojected depth differs by more than this fraction, or if the
+// cosine of the angle between the normals is below the normal tolerance.
+const DEPTH_TOLERANCE = 0.1f;
+const NORMAL_TOLERANCE = 0.9f;
+
+// Reprojects the surface at the uv and reverse-z depth of the current frame into the previous
+// frame. Returns the previous frame's uv and reverse-z depth, and a w of zero if the surface was
+// behind the previous frame's camera.
+@must_use
+fn reprojectToPreviousFrame(
+    uv: vec2f,
+    depth: f32,
+    inverseViewProjectionMat: mat4x4f,
+    previousViewProjectionMat: mat4x4f
+) -> vec4f {
+    // The homogeneous position is reprojected without dividing by w, so that the sky's points at
+    // infinity reproject as directions.
+    let ndc = vec4f(2f * vec2f(uv.x, 1f - uv.y) - vec2f(1f), depth, 1f);
+    let world = inverseViewProjectionMat * ndc;
+    let previousClip = previousViewProjectionMat * world;
+    if previousClip.w <= 0f {
+        return vec4f(0f);
+    }
+    let previousNdc = previousClip.xyz / previousClip.w;
+    let previousUv = vec2f(0.5f * previousNdc.x + 0.5f, 0.5f - 0.5f * previousNdc.y);
+    return vec4f(previousUv, previousNdc.z, 1f);
 }
 
-// Returns 1.0 if no forward intersections, 0.0 otherwise.
+// Compares the history with the surface, given the surface's depth in the current frame and its
+// reprojected depth in the previous frame. The relative difference of reverse-z depths equals the
+// relative difference of view depths.
 @must_use
-fn shadowRay(ray: Ray, rayTMax: f32) -> f32 {
-    let intersector = rayAabbIntersector(ray);
-    var toVisitOffset = 0u;
-    var currentNodeIdx = 0u;
-    var nodesToVisit: array<u32, 32u>;
+fn isSameSurface(
+    depth: f32,
+    reprojectedDepth: f32,
+    normal: vec3f,
+    historyDepth: f32,
+    historyNormal: vec3f
+) -> bool {
+    if depth == 0f || historyDepth == 0f {
+        return depth == historyDepth;
+    }
+    let depthDifference = abs(reprojectedDepth - historyDepth);
+    return depthDifference <= DEPTH_TOLERANCE * max(reprojectedDepth, historyDepth) &&
+        dot(normal, historyNormal) >= NORMAL_TOLERANCE;
+}
 
-    loop {
-        let node: BvhNode = bvhNodes[currentNodeIdx];
+@must_use
+fn octEncode(n: vec3f) -> vec2f {
+    let p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    if n.z >= 0f {
+        return p;
+    }
+    return (vec2f(1f) - abs(p.yx)) * signNotZero(p);
+}
 
-        if rayIntersectAabb(intersector, node.aabb, rayTMax) {
-            if node.triangleCount > 0u {
-                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
-                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
-                    // TODO: trihit not actually used. A different code path could be used?
-                    var trihit: TriangleHit;
-                    if rayIntersectTriangle(ray, triangle, rayTMax, &trihit) {
-                        return 0f;
-                    }
-                }
-                if toVisitOffset == 0u {
-                    break;
-                }
-                toVisitOffset -= 1u;
-                currentNodeIdx = nodesToVisit[toVisitOffset];
-            } else {
-                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
-                if intersector.dirNeg[node.splitAxis] == 1u {
-                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
-                    currentNodeIdx = node.secondChildOffset;
-                } else {
-                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
-                    currentNodeIdx = currentNodeIdx + 1u;
-                }
-                toVisitOffset += 1u;
-            }
-        } else {
-            if toVisitOffset == 0u {
-                break;
-            }
-            toVisitOffset -= 1u;
-            currentNodeIdx = nodesToVisit[toVisitOffset];
-        }
+@must_use
+fn octDecode(e: vec2f) -> vec3f {
+    var n = vec3f(e, 1f - abs(e.x) - abs(e.y));
+    if n.z < 0f {
+        n = vec3f((vec2f(1f) - abs(n.yx)) * signNotZero(n.xy), n.z);
     }
+    return normalize(n);
+}
 
-    return 1f;
+@must_use
+fn signNotZero(v: vec2f) -> vec2f {
+    return select(vec2f(-1f), vec2f(1f), v >= vec2f(0f));
 }
 
-struct RayAabbIntersector {
-    origin: vec3f,
-    invDir: vec3f,
-    dirNeg: vec3u,
+
+// Spatiotemporal variance-guided filtering (SVGF) of the lighting pass samples. The kernels are
+// dispatched in order: `temporalAccumulation`, `estimateVariance`, and one `atrous` iteration per
+// step size. The last iteration writes the filtered samples back to the sample buffer.
+
+struct Uniforms {
+    inverseViewReverseZProjectionMat: mat4x4f,
+    previousViewReverseZProjectionMat: mat4x4f,
+    framebufferSize: vec2f,
+    frameCount: u32,
+    _padding: u32,
 }
 
-@must_use
-fn rayAabbIntersector(ray: Ray) -> RayAabbIntersector {
-    let invDirection = vec3f(1f / ray.direction.x, 1f / ray.direction.y, 1f / ray.direction.z);
-    return RayAabbIntersector(
-        ray.origin,
-        invDirection,
-        vec3u(select(0u, 1u, (invDirection.x < 0f)), select(0u, 1u, (invDirection.y < 0f)), select(0u, 1u, (invDirection.z < 0f)))
-    );
+struct MomentsHistory {
+    // The first and second moments of the illumination's luminance.
+    moments: vec2f,
+    depth: f32,
+    // The octahedral-encoded normal.
+    normal: u32,
 }
 
-@must_use
-fn rayIntersectAabb(intersector: RayAabbIntersector, aabb: Aabb, rayTMax: f32) -> bool {
-    let bounds: array<vec3f, 2> = array(aabb.min, aabb.max);
+// The illumination is blended with its history by the inverse of the history length, until the
+// blend factor reaches this minimum. The short history keeps the filtered illumination responsive
+// to lighting changes, since the resolve pass accumulates the denoised samples further.
+const MIN_BLEND_FACTOR = 0.2f;
+const MAX_HISTORY_LENGTH = 32f;
+// The variance is estimated spatially until the moments have been accumulated for this many
+// frames.
+const MIN_MOMENTS_HISTORY_LENGTH = 4f;
+// Edge-stopping function parameters. The depth weight halves at a relative depth difference of
+// this fraction per pixel of distance, and the luminance weight is scaled by the standard
+// deviation of the luminance.
+const RELATIVE_DEPTH_SIGMA = 0.05f;
+const NORMAL_EXPONENT = 128f;
+const LUMINANCE_SIGMA = 4f;
+// Albedo is clamped when demodulating, so that black surfaces don't divide by zero.
+const MIN_ALBEDO = 0.001f;
+
+// The distance between the taps of the à-trous iteration, which doubles every iteration.
+override STEP_SIZE: u32 = 1u;
+override IS_LAST_ITERATION: bool = false;
 
-    var tmin: f32 = (bounds[intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
-    var tmax: f32 = (bounds[1u - intersector.dirNeg[0u]].x - intersector.origin.x) * intersector.invDir.x;
+@group(0) @binding(0) var<uniform> uniforms: Uniforms;
 
-    let tymin: f32 = (bounds[intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
-    let tymax: f32 = (bounds[1 - intersector.dirNeg[1u]].y - intersector.origin.y) * intersector.invDir.y;
+// The history buffers are swapped every frame. The illumination history contains the demodulated
+// illumination and the history length in frames.
+@group(1) @binding(0) var<storage, read_write> sampleBuffer: array<array<f32, 3>>;
+@group(1) @binding(1) var<storage, read_write> previousIlluminationHistory: array<vec4f>;
+@group(1) @binding(2) var<storage, read_write> previousMomentsHistory: array<MomentsHistory>;
+@group(1) @binding(3) var<storage, read_write> illuminationHistory: array<vec4f>;
+@group(1) @binding(4) var<storage, read_write> momentsHistory: array<MomentsHistory>;
 
-    if (tmin > tymax) || (tymin > tmax) {
-        return false;
-    }
+// The filter buffers contain the illumination and its variance. The à-trous iterations swap them.
+@group(2) @binding(0) var<storage, read_write> filterInput: array<vec4f>;
+@group(2) @binding(1) var<storage, read_write> filterOutput: array<vec4f>;
 
-    tmin = max(tymin, tmin);
-    tmax = min(tymax, tmax);
+@group(3) @binding(0) var gbufferAlbedo: texture_2d<f32>;
+@group(3) @binding(1) var gbufferNormal: texture_2d<f32>;
+@group(3) @binding(2) var gbufferDepth: texture_depth_2d;
 
-    let tzmin: f32 = (bounds[intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
-    let tzmax: f32 = (bounds[1 - intersector.dirNeg[2u]].z - intersector.origin.z) * intersector.invDir.z;
+@compute @workgroup_size(8, 8)
+fn temporalAccumulation(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let pos = globalInvocationId.xy;
+    if any(pos >= vec2u(uniforms.framebufferSize)) {
+        return;
+    }
 
-    if (tmin > tzmax) || (tzmin > tmax) {
-        return false;
+    let idx = pixelIdx(vec2i(pos));
+    let sample: array<f32, 3> = sampleBuffer[idx];
+    let color = vec3f(sample[0], sample[1], sample[2]);
+    let depth = textureLoad(gbufferDepth, pos, 0);
+    let normal = loadNormal(vec2i(pos), depth);
+
+    // The sky is not filtered, and is passed through as is.
+    var illumination = color;
+    if depth > 0f {
+        illumination = color / max(textureLoad(gbufferAlbedo, pos, 0).rgb, vec3f(MIN_ALBEDO));
     }
+    let sampleLuminance = luminance(illumination);
+
+    // The history is ignored in the first frame of the accumulation sequence.
+    var history = vec4f(0f);
+    var historyMoments = vec2f(0f);
+    if uniforms.frameCount > 0u && depth > 0f {
+        let uv = (vec2f(pos) + vec2f(0.5f)) / uniforms.framebufferSize;
+        let previous = reprojectToPreviousFrame(
+            uv,
+            depth,
+            uniforms.inverseViewReverseZProjectionMat,
+            uniforms.previousViewReverseZProjectionMat
+        );
+        if previous.w > 0f {
+            let samplePos = previous.xy * uniforms.framebufferSize - vec2f(0.5f);
+            let basePos = floor(samplePos);
+            let f = samplePos - basePos;
+
+            var weightSum = 0f;
+            for (var i = 0u; i < 4u; i++) {
+                let offset = vec2f(f32(i & 1u), f32(i >> 1u));
+                let tapPos = vec2i(basePos + offset);
+                if !isInside(tapPos) {
+                    continue;
+                }
+                let tapIdx = pixelIdx(tapPos);
+                let tapMoments = previousMomentsHistory[tapIdx];
+                let tapNormal = octDecode(unpack2x16snorm(tapMoments.normal));
+                if !isSameSurface(depth, previous.z, normal, tapMoments.depth, tapNormal) {
+                    continue;
+                }
+                let weight = mix(1f - f.x, f.x, offset.x) * mix(1f - f.y, f.y, offset.y);
+                history += weight * previousIlluminationHistory[tapIdx];
+                historyMoments += weight * tapMoments.moments;
+                weightSum += weight;
+            }
 
-    tmin = max(tzmin, tmin);
-    tmax = min(tzmax, tmax);
+            // The history length is scaled down by the weight of the rejected taps.
+            if weightSum >= 0.01f {
+                history = vec4f(history.rgb / weightSum, history.w);
+                historyMoments /= weightSum;
+            } else {
+                history = vec4f(0f);
+                historyMoments = vec2f(0f);
+            }
+        }
+    }
 
-    return (tmin < rayTMax) && (tmax > 0.0);
-}
+    let historyLength = min(history.w + 1f, MAX_HISTORY_LENGTH);
+    let blendFactor = max(1f / historyLength, MIN_BLEND_FACTOR);
+    let moments = vec2f(sampleLuminance, sampleLuminance * sampleLuminance);
 
-struct TriangleHit {
-    p: vec3f,
-    b: vec3f,
-    t: f32,
+    illuminationHistory[idx] = vec4f(mix(history.rgb, illumination, blendFactor), historyLength);
+    momentsHistory[idx] = MomentsHistory(
+        mix(historyMoments, moments, blendFactor),
+        depth,
+        pack2x16snorm(octEncode(normal))
+    );
 }
 
-@must_use
-fn rayIntersectTriangle(ray: Ray, tri: Positions, tmax: f32, hit: ptr<function, TriangleHit>) -> bool {
-    // Mäller-Trumbore algorithm
-    // https://en.wikipedia.org/wiki/Möller–Trumbore_intersection_algorithm
-    let e1 = tri.p1 - tri.p0;
-    let e2 = tri.p2 - tri.p0;
+@compute @workgroup_size(8, 8)
+fn estimateVariance(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let pos = vec2i(globalInvocationId.xy);
+    if !isInside(pos) {
+        return;
+    }
 
-    let h = cross(ray.direction, e2);
-    let det = dot(e1, h);
+    let idx = pixelIdx(pos);
+    let illumination = illuminationHistory[idx];
+    let center = momentsHistory[idx];
+    if center.depth == 0f || illumination.w >= MIN_MOMENTS_HISTORY_LENGTH {
+        let variance = max(center.moments.y - center.moments.x * center.moments.x, 0f);
+        filterOutput[idx] = vec4f(illumination.rgb, variance);
+        return;
+    }
 
-    if det > -EPSILON && det < EPSILON {
-        return false;
+    // Too few moments have been accumulated to estimate the variance temporally, e.g. where
+    // surfaces were disoccluded. The moments are estimated from the surrounding 7x7 pixels instead.
+    let normal = octDecode(unpack2x16snorm(center.normal));
+    var illuminationSum = vec3f(0f);
+    var momentsSum = vec2f(0f);
+    var weightSum = 0f;
+    for (var y = -3; y <= 3; y++) {
+        for (var x = -3; x <= 3; x++) {
+            let tapPos = pos + vec2i(x, y);
+            if !isInside(tapPos) {
+                continue;
+            }
+            let tapIdx = pixelIdx(tapPos);
+            let tap = momentsHistory[tapIdx];
+            let weight = geometryWeight(
+                center.depth,
+                normal,
+                tap.depth,
+                octDecode(unpack2x16snorm(tap.normal)),
+                length(vec2f(f32(x), f32(y)))
+            );
+            illuminationSum += weight * illuminationHistory[tapIdx].rgb;
+            momentsSum += weight * tap.moments;
+            weightSum += weight;
+        }
     }
 
-    let invDet = 1.0f / det;
-    let s = ray.origin - tri.p0;
-    let u = invDet * dot(s, h);
+    // The center pixel's weight is one, so the weight sum is never zero. The variance is boosted
+    // while the history is short, so that the à-trous iterations filter more aggressively.
+    let moments = momentsSum / weightSum;
+    let variance = max(moments.y - moments.x * moments.x, 0f) *
+        (MIN_MOMENTS_HISTORY_LENGTH / illumination.w);
+    filterOutput[idx] = vec4f(illuminationSum / weightSum, variance);
+}
 
-    if u < 0.0f || u > 1.0f {
-        return false;
+@compute @workgroup_size(8, 8)
+fn atrous(@builtin(global_invocation_id) globalInvocationId: vec3u) {
+    let pos = vec2i(globalInvocationId.xy);
+    if !isInside(pos) {
+        return;
     }
 
-    let q = cross(s, e1);
-    let v = invDet * dot(ray.direction, q);
+    let idx = pixelIdx(pos);
+    let center = filterInput[idx];
+    let depth = textureLoad(gbufferDepth, pos, 0);
+    if depth == 0f {
+        // The sky's sample is left untouched.
+        filterOutput[idx] = center;
+        return;
+    }
 
-    if v < 0.0f || u + v > 1.0f {
-        return false;
+    let normal = loadNormal(pos, depth);
+    let centerLuminance = luminance(center.rgb);
+    let luminanceDenominator = LUMINANCE_SIGMA * sqrt(prefilteredVariance(pos)) + 1e-6f;
+
+    var illuminationSum = vec3f(0f);
+    var varianceSum = 0f;
+    var weightSum = 0f;
+    for (var y = -2; y <= 2; y++) {
+        for (var x = -2; x <= 2; x++) {
+            let offset = vec2i(x, y) * i32(STEP_SIZE);
+            let tapPos = pos + offset;
+            if !isInside(tapPos) {
+                continue;
+            }
+            let tap = filterInput[pixelIdx(tapPos)];
+            let tapDepth = textureLoad(gbufferDepth, tapPos, 0);
+            let tapNormal = loadNormal(tapPos, tapDepth);
+            let weight = b3SplineWeight(x) * b3SplineWeight(y) *
+                geometryWeight(depth, normal, tapDepth, tapNormal, length(vec2f(offset))) *
+                exp(-abs(centerLuminance - luminance(tap.rgb)) / luminanceDenominator);
+            illuminationSum += weight * tap.rgb;
+            varianceSum += weight * weight * tap.a;
+            weightSum += weight;
+        }
     }
 
-    let t = invDet * dot(e2, q);
+    // The center tap's weight is never zero.
+    let filtered = vec4f(illuminationSum / weightSum, varianceSum / (weightSum * weightSum));
+    filterOutput[idx] = filtered;
 
-    if t > EPSILON && t < tmax {
-        // https://www.scratchapixel.com/lessons/3d-basic-rendering/ray-tracing-rendering-a-triangle/moller-trumbore-ray-triangle-intersection.html
-        // e1 = v1 - v0
-        // e2 = v2 - v0
-        // -> p = v0 + u * e1 + v * e2
-        let p = tri.p0 + u * e1 + v * e2;
-        let n = normalize(cross(e1, e2));
-        let b = vec3f(1f - u - v, u, v);
-        *hit = TriangleHit(offsetPosition(p, n), b, t);
-        return true;
-    } else {
-        return false;
+    // The first iteration's output is fed back to the history, so that the next frame accumulates
+    // filtered illumination.
+    if STEP_SIZE == 1u {
+        illuminationHistory[idx] = vec4f(filtered.rgb, illuminationHistory[idx].w);
+    }
+
+    if IS_LAST_ITERATION {
+        let albedo = max(textureLoad(gbufferAlbedo, pos, 0).rgb, vec3f(MIN_ALBEDO));
+        let color = filtered.rgb * albedo;
+        sampleBuffer[idx] = array<f32, 3>(color.r, color.g, color.b);
     }
 }
 
-const ORIGIN = 1f / 32f;
-const FLOAT_SCALE = 1f / 16384f;
-const INT_SCALE = 1024;
+// Blurs the variance with a 3x3 Gaussian kernel, which makes the luminance weights of the à-trous
+// iteration robust to the noise in the variance estimate.
+@must_use
+fn prefilteredVariance(pos: vec2i) -> f32 {
+    var varianceSum = 0f;
+    var weightSum = 0f;
+    for (var y = -1; y <= 1; y++) {
+        for (var x = -1; x <= 1; x++) {
+            let tapPos = pos + vec2i(x, y);
+            if !isInside(tapPos) {
+                continue;
+            }
+            let weight = select(0.25f, 0.5f, x == 0) * select(0.25f, 0.5f, y == 0);
+            varianceSum += weight * filterInput[pixelIdx(tapPos)].a;
+            weightSum += weight;
+        }
+    }
+    return varianceSum / weightSum;
+}
 
+// The edge-stopping weight of a tap at the given distance in pixels, based on its depth and normal.
+// The sky doesn't contribute to surfaces.
 @must_use
-fn offsetPosition(p: vec3f, n: vec3f) -> vec3f {
-    // Source: A Fast and Robust Method for Avoiding Self-Intersection, Ray Tracing Gems
-    let offset = vec3i(i32(INT_SCALE * n.x), i32(INT_SCALE * n.y), i32(INT_SCALE * n.z));
-    // Offset added straight into the mantissa bits to ensure the offset is scale-invariant,
-    // )"
-R"(except for when close to the origin, where we use FLOAT_SCALE as a small epsilon.
-    let po = vec3f(
-        bitcast<f32>(bitcast<i32>(p.x) + select(offset.x, -offset.x, (p.x < 0))),
-        bitcast<f32>(bitcast<i32>(p.y) + select(offset.y, -offset.y, (p.y < 0))),
-        bitcast<f32>(bitcast<i32>(p.z) + select(offset.z, -offset.z, (p.z < 0)))
-    );
+fn geometryWeight(
+    depth: f32,
+    normal: vec3f,
+    tapDepth: f32,
+    tapNormal: vec3f,
+    distance: f32
+) -> f32 {
+    if tapDepth == 0f {
+        return 0f;
+    }
+    let relativeDepthDifference = abs(depth - tapDepth) / max(depth, tapDepth);
+    let depthWeight = exp2(-relativeDepthDifference / (RELATIVE_DEPTH_SIGMA * distance + 1e-6f));
+    let normalWeight = pow(max(dot(normal, tapNormal), 0f), NORMAL_EXPONENT);
+    return depthWeight * normalWeight;
+}
 
-    return vec3f(
-        select(po.x, p.x + FLOAT_SCALE * n.x, (abs(p.x) < ORIGIN)),
-        select(po.y, p.y + FLOAT_SCALE * n.y, (abs(p.y) < ORIGIN)),
-        select(po.z, p.z + FLOAT_SCALE * n.z, (abs(p.z) < ORIGIN))
-    );
+// The 1D weights of the 5-tap B3 spline kernel.
+@must_use
+fn b3SplineWeight(offset: i32) -> f32 {
+    switch abs(offset) {
+        case 0: {
+            return 3f / 8f;
+        }
+        case 1: {
+            return 1f / 4f;
+        }
+        default: {
+            return 1f / 16f;
+        }
+    }
 }
 
-// `u` is a random number in [0, 1].
+// A depth of zero is the sky, which has no normal.
 @must_use
-fn directionInCone(u: vec2f, cosThetaMax: f32) -> vec3f {
-    let cosTheta = 1f - u.x * (1f - cosThetaMax);
-    let sinTheta = sqrt(1f - cosTheta * cosTheta);
-    let phi = 2f * PI * u.y;
+fn loadNormal(pos: vec2i, depth: f32) -> vec3f {
+    if depth == 0f {
+        return vec3f(0f, 0f, 1f);
+    }
+    return normalize(2f * textureLoad(gbufferNormal, pos, 0).xyz - vec3f(1f));
+}
 
-    let x = cos(phi) * sinTheta;
-    let y = sin(phi) * sinTheta;
-    let z = cosTheta;
+@must_use
+fn luminance(color: vec3f) -> f32 {
+    return dot(color, vec3f(0.2126f, 0.7152f, 0.0722f));
+}
 
-    return vec3(x, y, z);
+@must_use
+fn isInside(pos: vec2i) -> bool {
+    return all(pos >= vec2i(0)) && all(pos < vec2i(uniforms.framebufferSize));
 }
 
-// `u` is a random number in [0, 1].
 @must_use
-fn directionInCosineWeightedHemisphere(u: vec2f) -> vec3f {
-    let phi = 2f * PI * u.y;
-    let sinTheta = sqrt(1f - u.x);
+fn pixelIdx(pos: vec2i) -> u32 {
+    return u32(pos.y) * u32(uniforms.framebufferSize.x) + u32(pos.x);
+}
+)";
 
-    let x = cos(phi) * sinTheta;
-    let y = sin(phi) * sinTheta;
-    let z = sqrt(u.x);
+const char* const DEFERRED_RENDERER_RESOLVE_PASS_SOURCE = R"(// Reprojection of the current frame's surfaces into the previous frame, and the surface comparisons
+// used to reject mismatching history.
 
-    return vec3(x, y, z);
+// History is rejected if the reprojected depth differs by more than this fraction, or if the
+// cosine of the angle between the normals is below the normal tolerance.
+const DEPTH_TOLERANCE = 0.1f;
+const NORMAL_TOLERANCE = 0.9f;
+
+// Reprojects the surface at the uv and reverse-z depth of the current frame into the previous
+// frame. Returns the previous frame's uv and reverse-z depth, and a w of zero if the surface was
+// behind the previous frame's camera.
+@must_use
+fn reprojectToPreviousFrame(
+    uv: vec2f,
+    depth: f32,
+    inverseViewProjectionMat: mat4x4f,
+    previousViewProjectionMat: mat4x4f
+) -> vec4f {
+    // The homogeneous position is reprojected without dividing by w, so that the sky's points at
+    // infinity reproject as directions.
+    let ndc = vec4f(2f * vec2f(uv.x, 1f - uv.y) - vec2f(1f), depth, 1f);
+    let world = inverseViewProjectionMat * ndc;
+    let previousClip = previousViewProjectionMat * world;
+    if previousClip.w <= 0f {
+        return vec4f(0f);
+    }
+    let previousNdc = previousClip.xyz / previousClip.w;
+    let previousUv = vec2f(0.5f * previousNdc.x + 0.5f, 0.5f - 0.5f * previousNdc.y);
+    return vec4f(previousUv, previousNdc.z, 1f);
 }
 
+// Compares the history with the surface, given the surface's depth in the current frame and its
+// reprojected depth in the previous frame. The relative difference of reverse-z depths equals the
+// relative difference of view depths.
 @must_use
-fn animatedBlueNoise(coord: vec2u, frameCount: u32, frameCountCycle: u32) -> vec2f {
-    // Spatial component
-    let idx = (coord.y % blueNoise.height) * blueNoise.width + (coord.x % blueNoise.width);
-    let blueNoise = blueNoise.data[idx];
+fn isSameSurface(
+    depth: f32,
+    reprojectedDepth: f32,
+    normal: vec3f,
+    historyDepth: f32,
+    historyNormal: vec3f
+) -> bool {
+    if depth == 0f || historyDepth == 0f {
+        return depth == historyDepth;
+    }
+    let depthDifference = abs(reprojectedDepth - historyDepth);
+    return depthDifference <= DEPTH_TOLERANCE * max(reprojectedDepth, historyDepth) &&
+        dot(normal, historyNormal) >= NORMAL_TOLERANCE;
+}
 
-    // Temporal component
-    // 2-dimensional golden ratio additive recurrence sequence
-    // https://extremelearning.com.au/unreasonable-effectiveness-of-quasirandom-sequences/
-    let n = frameCount % frameCountCycle;
-    let a1 = 0.7548776662466927f;
-    let a2 = 0.5698402909980532f;
-    let r2Seq = fract(vec2(
-        a1 * f32(n),
-        a2 * f32(n)
-    ));
+@must_use
+fn octEncode(n: vec3f) -> vec2f {
+    let p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    if n.z >= 0f {
+        return p;
+    }
+    return (vec2f(1f) - abs(p.yx)) * signNotZero(p);
+}
 
-    return fract(blueNoise + r2Seq);
+@must_use
+fn octDecode(e: vec2f) -> vec3f {
+    var n = vec3f(e, 1f - abs(e.x) - abs(e.y));
+    if n.z < 0f {
+        n = vec3f((vec2f(1f) - abs(n.yx)) * signNotZero(n.xy), n.z);
+    }
+    return normalize(n);
+}
+
+@must_use
+fn signNotZero(v: vec2f) -> vec2f {
+    return select(vec2f(-1f), vec2f(1f), v >= vec2f(0f));
 }
-)";
 
-const char* const DEFERRED_RENDERER_RESOLVE_PASS_SOURCE = R"(struct VertexInput {
+
+struct VertexInput {
     @location(0) position: vec2f,
 }
 
@@ -1301,17 +4143,30 @@ fn vsMain(in: VertexInput) -> VertexOutput {
 }
 
 struct Uniforms {
+    inverseViewReverseZProjectionMat: mat4x4f,
+    previousViewReverseZProjectionMat: mat4x4f,
     framebufferSize: vec2f,
     exposure: f32,
     frameCount: u32,
 }
 
-// TODO: consider merging these into one bind group
+// The blend factor of the current sample is the inverse of the history length, until the history
+// reaches this length. Bounds the blur accumulated by resampling the history under motion.
+const MAX_HISTORY_LENGTH = 64f;
 
 @group(0) @binding(0) var<uniform> uniforms: Uniforms;
 
+// The history buffers are swapped every frame. The color history contains the accumulated color
+// and the history length in frames, and the geometry history contains the reverse-z depth and the
+// octahedral-encoded normal of the pixel.
 @group(1) @binding(0) var<storage, read_write> sampleBuffer: array<array<f32, 3>>;
-@group(1) @binding(1) var<storage, read_write> accumulationBuffer: array<array<f32, 3>>;
+@group(1) @binding(1) var<storage, read_write> previousColorHistory: array<vec4f>;
+@group(1) @binding(2) var<storage, read_write> previousGeometryHistory: array<vec2u>;
+@group(1) @binding(3) var<storage, read_write> colorHistory: array<vec4f>;
+@group(1) @binding(4) var<storage, read_write> geometryHistory: array<vec2u>;
+
+@group(2) @binding(0) var gbufferNormal: texture_2d<f32>;
+@group(2) @binding(1) var gbufferDepth: texture_depth_2d;
 
 @fragment
 fn fsMain(in: VertexOutput) -> @location(0) vec4f {
@@ -1320,22 +4175,75 @@ fn fsMain(in: VertexOutput) -> @location(0) vec4f {
     let sampleBufferIdx = textureIdx.y * u32(uniforms.framebufferSize.x) + textureIdx.x;
     let sample: array<f32, 3> = sampleBuffer[sampleBufferIdx];
     let currentColor = vec3f(sample[0], sample[1], sample[2]);
-    var color = vec3f(0f);
-    if uniforms.frameCount == 0u {
-        accumulationBuffer[sampleBufferIdx] = sample;
-        color = currentColor;
-    } else {
-        let previousSample: array<f32, 3> = accumulationBuffer[sampleBufferIdx];
-        let previousColor = vec3f(previousSample[0], previousSample[1], previousSample[2]);
-        color = 0.1 * currentColor + 0.9 * previousColor;
-        accumulationBuffer[sampleBufferIdx] = array<f32, 3>(color.r, color.g, color.b);
+
+    // A depth of zero is the sky, which has no normal.
+    let depth = textureLoad(gbufferDepth, textureIdx, 0);
+    var normal = vec3f(0f, 0f, 1f);
+    if depth > 0f {
+        normal = normalize(2f * textureLoad(gbufferNormal, textureIdx, 0).xyz - vec3f(1f));
+    }
+
+    // The history is ignored in the first frame of the accumulation sequence.
+    var history = vec4f(0f);
+    if uniforms.frameCount > 0u {
+        history = reprojectHistory(uv, depth, normal);
     }
+    let historyLength = min(history.w + 1f, MAX_HISTORY_LENGTH);
+    let color = mix(history.rgb, currentColor, 1f / historyLength);
+
+    colorHistory[sampleBufferIdx] = vec4f(color, historyLength);
+    geometryHistory[sampleBufferIdx] = vec2u(bitcast<u32>(depth), pack2x16snorm(octEncode(normal)));
 
     let rgb = acesFilmic(uniforms.exposure * color);
     let srgb = pow(rgb, vec3(1f / 2.2f));
     return vec4(srgb, 1f);
 }
 
+// Resamples the previous frame's color history where the pixel's surface was in the previous
+// frame. The bilinear taps which belong to a different surface are rejected, and the history
+// length is scaled down by the weight of the rejected taps. Returns zero if all taps are rejected.
+@must_use
+fn reprojectHistory(uv: vec2f, depth: f32, normal: vec3f) -> vec4f {
+    let previous = reprojectToPreviousFrame(
+        uv,
+        depth,
+        uniforms.inverseViewReverseZProjectionMat,
+        uniforms.previousViewReverseZProjectionMat
+    );
+    if previous.w == 0f {
+        return vec4f(0f);
+    }
+
+    let samplePos = previous.xy * uniforms.framebufferSize - vec2f(0.5f);
+    let basePos = floor(samplePos);
+    let f = samplePos - basePos;
+
+    var colorSum = vec4f(0f);
+    var weightSum = 0f;
+    for (var i = 0u; i < 4u; i++) {
+        let offset = vec2f(f32(i & 1u), f32(i >> 1u));
+        let pos = basePos + offset;
+        if any(pos < vec2f(0f)) || any(pos >= uniforms.framebufferSize) {
+            continue;
+        }
+        let idx = u32(pos.y) * u32(uniforms.framebufferSize.x) + u32(pos.x);
+        let geometry = previousGeometryHistory[idx];
+        let historyDepth = bitcast<f32>(geometry.x);
+        let historyNormal = octDecode(unpack2x16snorm(geometry.y));
+        if !isSameSurface(depth, previous.z, normal, historyDepth, historyNormal) {
+            continue;
+        }
+        let weight = mix(1f - f.x, f.x, offset.x) * mix(1f - f.y, f.y, offset.y);
+        colorSum += weight * previousColorHistory[idx];
+        weightSum += weight;
+    }
+
+    if weightSum < 0.01f {
+        return vec4f(0f);
+    }
+    return vec4f(colorSum.rgb / weightSum, colorSum.w);
+}
+
 @must_use
 fn acesFilmic(x: vec3f) -> vec3f {
     let a = 2.51f;
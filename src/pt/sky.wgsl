@@ -0,0 +1,153 @@
+// The sky model: the radiance LUT, the sky sampling distribution, and the solar disk. The including
+// shader declares the `skyState` binding.
+
+#include "sampling.wgsl"
+
+const CHANNEL_R = 0u;
+const CHANNEL_G = 1u;
+const CHANNEL_B = 2u;
+
+const DEGREES_TO_RADIANS = PI / 180f;
+const TERRESTRIAL_SOLAR_RADIUS = 0.255f * DEGREES_TO_RADIANS;
+
+const SOLAR_COS_THETA_MAX = cos(TERRESTRIAL_SOLAR_RADIUS);
+const SOLAR_INV_PDF = 2f * PI * (1f - SOLAR_COS_THETA_MAX);
+
+const SKY_RADIANCE_LUT_SIZE = 64u;
+const SKY_RADIANCE_LUT_FLOAT_COUNT = 3u * SKY_RADIANCE_LUT_SIZE * SKY_RADIANCE_LUT_SIZE;
+
+const SKY_DISTRIBUTION_WIDTH = 128u;
+const SKY_DISTRIBUTION_HEIGHT = 64u;
+const SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET = SKY_DISTRIBUTION_WIDTH * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + (SKY_DISTRIBUTION_WIDTH + 1u) * SKY_DISTRIBUTION_HEIGHT;
+const SKY_DISTRIBUTION_INTEGRAL_OFFSET = SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET + SKY_DISTRIBUTION_HEIGHT + 1u;
+const SKY_DISTRIBUTION_FLOAT_COUNT = SKY_DISTRIBUTION_INTEGRAL_OFFSET + 1u;
+
+// Rotates the blue noise used for the sun and BSDF samples, so that sky samples are decorrelated
+// from them.
+const SKY_SAMPLE_NOISE_OFFSET = vec2f(0.5f, 0.5f);
+
+struct SkyState {
+    params: array<f32, 27>,
+    skyRadiances: array<f32, 3>,
+    solarRadiances: array<f32, 3>,
+    sunDirection: vec3<f32>,
+    @align(16) radianceLut: array<f32, SKY_RADIANCE_LUT_FLOAT_COUNT>,
+    skyDistribution: array<f32, SKY_DISTRIBUTION_FLOAT_COUNT>,
+};
+
+// The sky dome radiance in direction `v`, without the solar disk.
+@must_use
+fn skyRadiance(v: vec3f) -> vec3f {
+    return skyDomeRadiance(v.y, dot(v, skyState.sunDirection));
+}
+
+// Bilinearly interpolates the sky radiance LUT. Matches `sampleSkyRadianceLut` in
+// sky_radiance_lut.cpp.
+@must_use
+fn skyDomeRadiance(cosTheta: f32, cosGamma: f32) -> vec3f {
+    let maxCoord = f32(SKY_RADIANCE_LUT_SIZE - 1u);
+    let s = sqrt(sqrt(abs(cosTheta)));
+    let t = sqrt(clamp(0.5f * (1f - cosGamma), 0f, 1f));
+    let x = min(s, 1f) * maxCoord;
+    let y = t * maxCoord;
+
+    let x0 = min(u32(x), SKY_RADIANCE_LUT_SIZE - 2u);
+    let y0 = min(u32(y), SKY_RADIANCE_LUT_SIZE - 2u);
+    let fx = x - f32(x0);
+    let fy = y - f32(y0);
+
+    let r0 = mix(skyRadianceLutEntry(x0, y0), skyRadianceLutEntry(x0 + 1u, y0), fx);
+    let r1 = mix(skyRadianceLutEntry(x0, y0 + 1u), skyRadianceLutEntry(x0 + 1u, y0 + 1u), fx);
+    return mix(r0, r1, fy);
+}
+
+@must_use
+fn skyRadianceLutEntry(col: u32, row: u32) -> vec3f {
+    let idx = 3u * (row * SKY_RADIANCE_LUT_SIZE + col);
+    return vec3(skyState.radianceLut[idx], skyState.radianceLut[idx + 1u], skyState.radianceLut[idx + 2u]);
+}
+
+struct SkySample {
+    direction: vec3f,
+    pdf: f32,
+}
+
+struct CdfSample {
+    x: f32,
+    offset: u32,
+}
+
+// Matches `sampleSkyDistribution` in common/sky_distribution.cpp.
+@must_use
+fn sampleSkyDistribution(u: vec2f) -> SkySample {
+    let row = sampleSkyDistributionCdf(SKY_DISTRIBUTION_MARGINAL_CDF_OFFSET, SKY_DISTRIBUTION_HEIGHT, u.y);
+    let conditionalCdfOffset = SKY_DISTRIBUTION_CONDITIONAL_CDF_OFFSET + row.offset * (SKY_DISTRIBUTION_WIDTH + 1u);
+    let col = sampleSkyDistributionCdf(conditionalCdfOffset, SKY_DISTRIBUTION_WIDTH, u.x);
+
+    let theta = PI * row.x;
+    let phi = 2f * PI * col.x;
+    let sinTheta = sin(theta);
+    let direction = vec3(sinTheta * cos(phi), cos(theta), sinTheta * sin(phi));
+
+    return SkySample(direction, skyDistributionCellPdf(row.offset, col.offset, sinTheta));
+}
+
+// Matches `skyDistributionPdf` in common/sky_distribution.cpp.
+@must_use
+fn skyDistributionPdf(direction: vec3f) -> f32 {
+    let cosTheta = clamp(direction.y, -1f, 1f);
+    let sinTheta = sqrt(max(1f - cosTheta * cosTheta, 0f));
+
+    var phi = atan2(direction.z, direction.x);
+    if phi < 0f {
+        phi += 2f * PI;
+    }
+    let u = phi / (2f * PI);
+    let v = acos(cosTheta) / PI;
+
+    let col = min(u32(u * f32(SKY_DISTRIBUTION_WIDTH)), SKY_DISTRIBUTION_WIDTH - 1u);
+    let row = min(u32(v * f32(SKY_DISTRIBUTION_HEIGHT)), SKY_DISTRIBUTION_HEIGHT - 1u);
+
+    return skyDistributionCellPdf(row, col, sinTheta);
+}
+
+@must_use
+fn skyDistributionCellPdf(row: u32, col: u32, sinTheta: f32) -> f32 {
+    if sinTheta <= 0f {
+        return 0f;
+    }
+    let cellWeight = skyState.skyDistribution[row * SKY_DISTRIBUTION_WIDTH + col];
+    let integral = skyState.skyDistribution[SKY_DISTRIBUTION_INTEGRAL_OFFSET];
+    // The Jacobian of the mapping from (u, v) to the sphere is 2 * pi^2 * sin(theta).
+    return cellWeight / (integral * 2f * PI * PI * sinTheta);
+}
+
+// Inverts the piecewise-linear CDF of `segmentCount` segments at `cdfOffset`.
+@must_use
+fn sampleSkyDistributionCdf(cdfOffset: u32, segmentCount: u32, u: f32) -> CdfSample {
+    // Binary search for the last entry which is less than or equal to `u`.
+    var lo = 0u;
+    var hi = segmentCount;
+    while lo + 1u < hi {
+        let mid = (lo + hi) / 2u;
+        if skyState.skyDistribution[cdfOffset + mid] <= u {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    let cdf0 = skyState.skyDistribution[cdfOffset + lo];
+    let cdf1 = skyState.skyDistribution[cdfOffset + lo + 1u];
+    let width = cdf1 - cdf0;
+    let du = select(0f, (u - cdf0) / width, width > 0f);
+    return CdfSample(min((f32(lo) + du) / f32(segmentCount), ONE_MINUS_EPSILON), lo);
+}
+
+@must_use
+fn sampleSolarDiskDirection(u: vec2f, cosThetaMax: f32, sunDirection: vec3f) -> vec3f {
+    let v = directionInCone(u, cosThetaMax);
+    let onb = pixarOnb(sunDirection);
+    return onb * v;
+}
@@ -0,0 +1,83 @@
+// Texture lookups from the texture pages. The including shader declares the `textures` and
+// `texturePage0` to `texturePage3` bindings, and defines `textureLookup`.
+
+struct TextureDescriptor {
+    width: u32,
+    height: u32,
+    page: u32,
+    offset: u32,
+    layout: u32,
+    format: u32,
+}
+
+// Matches the texture descriptor buffer written by the renderer.
+struct TextureTable {
+    srgbToLinear: array<f32, 256>,
+    descriptors: array<TextureDescriptor>,
+}
+
+const TEXTURE_FORMAT_BGRA8_SRGB = 0u;
+const TEXTURE_FORMAT_RGBA16_FLOAT = 2u;
+
+const TEXTURE_LAYOUT_TILED = 1u;
+const TEXTURE_TILE_SIZE = 8u;
+
+@must_use
+fn evalTexture(textureDescriptorIdx: u32, uv: vec2f) -> vec3f {
+    let textureDesc = textures.descriptors[textureDescriptorIdx];
+    return textureLookup(textureDesc, uv);
+}
+
+// Matches `decodeTexel` in common/texture.hpp. `word1` is only used by two-word formats.
+@must_use
+fn decodeTexel(format: u32, word0: u32, word1: u32) -> vec3f {
+    if format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        return vec3(unpack2x16float(word0), unpack2x16float(word1).x);
+    }
+    if format == TEXTURE_FORMAT_BGRA8_SRGB {
+        return vec3(
+            textures.srgbToLinear[(word0 >> 16u) & 0xffu],
+            textures.srgbToLinear[(word0 >> 8u) & 0xffu],
+            textures.srgbToLinear[word0 & 0xffu]
+        );
+    }
+    return unpack4x8unorm(word0).zyx;
+}
+
+@must_use
+fn texelWordCount(format: u32) -> u32 {
+    return select(1u, 2u, format == TEXTURE_FORMAT_RGBA16_FLOAT);
+}
+
+@must_use
+fn textureTexel(page: u32, idx: u32) -> u32 {
+    // Storage buffers can't be indexed dynamically, so the page is selected by branching.
+    switch page {
+        case 0u: { return texturePage0[idx]; }
+        case 1u: { return texturePage1[idx]; }
+        case 2u: { return texturePage2[idx]; }
+        default: { return texturePage3[idx]; }
+    }
+}
+
+// Matches `texelIndex` in common/texture_layout.hpp.
+@must_use
+fn texelIndex(desc: TextureDescriptor, x: u32, y: u32) -> u32 {
+    if desc.layout == TEXTURE_LAYOUT_TILED {
+        let tilesX = (desc.width + TEXTURE_TILE_SIZE - 1u) / TEXTURE_TILE_SIZE;
+        let tileIdx = (y / TEXTURE_TILE_SIZE) * tilesX + (x / TEXTURE_TILE_SIZE);
+        let tileTexelIdx = part1By1(x) | (part1By1(y) << 1u);
+        return tileIdx * TEXTURE_TILE_SIZE * TEXTURE_TILE_SIZE + tileTexelIdx;
+    }
+
+    return y * desc.width + x;
+}
+
+// Spread the lower three bits of `v` so that there is a zero bit between each bit.
+@must_use
+fn part1By1(v: u32) -> u32 {
+    var x = v & 0x7u;
+    x = (x | (x << 2u)) & 0x33u;
+    x = (x | (x << 1u)) & 0x55u;
+    return x;
+}
@@ -0,0 +1,670 @@
+#include "ray_intersection.wgsl"
+#include "sky.wgsl"
+#include "texture.wgsl"
+
+// render params bind group
+@group(0) @binding(0) var<uniform> renderParams: RenderParams;
+@group(0) @binding(1) var<storage, read> skyState: SkyState;
+
+// scene bind group
+@group(1) @binding(0) var<storage, read> bvhNodes: array<BvhNode>;
+@group(1) @binding(1) var<storage, read> positionAttributes: array<Positions>;
+@group(1) @binding(2) var<storage, read> vertexAttributes: array<VertexAttributes>;
+@group(1) @binding(3) var<storage, read> textures: TextureTable;
+@group(1) @binding(4) var<storage, read> blueNoise: BlueNoise;
+@group(1) @binding(5) var<storage, read> texturePage0: array<u32>;
+@group(1) @binding(6) var<storage, read> texturePage1: array<u32>;
+@group(1) @binding(7) var<storage, read> texturePage2: array<u32>;
+@group(1) @binding(8) var<storage, read> texturePage3: array<u32>;
+
+// image bind group
+@group(2) @binding(0) var<storage, read_write> imageBuffer: array<vec3f>;
+
+// wavefront bind group
+@group(3) @binding(0) var<storage, read_write> queueState: QueueState;
+@group(3) @binding(1) var<storage, read_write> queues: array<u32>;
+@group(3) @binding(2) var<storage, read_write> pathState: array<vec4f>;
+
+// The wavefront integrator traces one path per pixel. The path index is the pixel index, so each
+// path owns its path state and the per-pixel blue noise can be recomputed in any kernel. A bounce
+// runs the `extend`, `miss`, `shade` and `shadow` kernels over compacted queues of path indices,
+// which are dispatched indirectly from the queue counts, see wavefront_queue.wgsl.
+//
+// The `extendPersistent` and `shadowPersistent` kernels are the persistent-threads variants of
+// `extend` and `shadow`, which the renderer uses with the short-stack traversal instead.
+
+// The workgroup size of the kernels, overridden by the renderer.
+override WORKGROUP_SIZE: u32 = 64u;
+
+// Matches the C++ `QueueStateLayout`. `bounce` and `extendCount` are only written by the queue
+// kernels, in between the dispatches which read them.
+struct QueueState {
+    bounce: u32,
+    extendCount: u32,
+    shadeCount: atomic<u32>,
+    missCount: atomic<u32>,
+    nextExtendCount: atomic<u32>,
+    extendFetchCount: atomic<u32>,
+    shadowFetchCount: atomic<u32>,
+}
+
+// The path state is stored as a structure of arrays, with one region of `pathCount()` entries per
+// member.
+const PATH_ORIGIN = 0u;        // xyz: ray origin, w: pdf of the BSDF sample which generated the ray
+const PATH_DIRECTION = 1u;     // xyz: ray direction
+const PATH_THROUGHPUT = 2u;    // xyz: path throughput
+const PATH_RADIANCE = 3u;      // xyz: radiance accumulated by the path
+const PATH_HIT = 4u;           // xy: barycentrics, z: ray t, w: triangle index bits
+const PATH_SUN_RADIANCE = 5u;  // xyz: the sun sample's contribution, if unoccluded
+const PATH_SKY_RADIANCE = 6u;  // xyz: the sky sample's contribution, if unoccluded
+
+// The queues are stored back to back. The extend queue is double-buffered, since `shade` writes
+// the next bounce's queue while the current one is being read.
+const QUEUE_EXTEND_EVEN = 0u;
+const QUEUE_EXTEND_ODD = 1u;
+const QUEUE_SHADE = 2u;
+const QUEUE_MISS = 3u;
+
+// Matches `BVH_SHORT_STACK_SIZE` in common/ray_intersection.hpp.
+const SHORT_STACK_SIZE = 4u;
+// The level of the root node in the restart trail, see `rayIntersectBvhShortStack`.
+const ROOT_LEVEL = 0x80000000u;
+const NO_BATCH = 0xffffffffu;
+
+// The short stacks of the invocations are interleaved, so that neighbouring invocations access
+// neighbouring words.
+var<workgroup> shortStacks: array<u32, SHORT_STACK_SIZE * WORKGROUP_SIZE>;
+var<workgroup> workgroupBatchBegin: u32;
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn generate(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let pathIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    let numPaths = pathCount();
+    if pathIdx == 0u {
+        // Every path is extended on the first bounce.
+        queueState.bounce = 0u;
+        atomicStore(&queueState.nextExtendCount, numPaths);
+    }
+    if pathIdx >= numPaths {
+        return;
+    }
+
+    let dimensions = renderParams.frameData.dimensions;
+    let coord = pathCoord(pathIdx);
+    let u = (f32(coord.x) + 0.5f) / f32(dimensions.x);
+    let v = (f32(coord.y) + 0.5f) / f32(dimensions.y);
+    let blueNoise = pathBlueNoise(pathIdx);
+    let jitter = blueNoise / vec2f(dimensions);
+    let primaryRay = generateCameraRay(blueNoise, renderParams.camera, u + jitter.x, (1.0 - v) + jitter.y);
+
+    pathState[pathStateIdx(PATH_ORIGIN, pathIdx)] = vec4(primaryRay.origin, 0f);
+    pathState[pathStateIdx(PATH_DIRECTION, pathIdx)] = vec4(primaryRay.direction, 0f);
+    pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)] = vec4(1f);
+    pathState[pathStateIdx(PATH_RADIANCE, pathIdx)] = vec4(0f);
+    queues[extendQueueOffset(1u) + pathIdx] = pathIdx;
+}
+
+// Finds the closest hit of each path in the extend queue, and sorts the paths into the shade and
+// miss queues.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn extend(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= queueState.extendCount {
+        return;
+    }
+
+    let pathIdx = queues[extendQueueOffset(queueState.bounce) + queueIdx];
+    var hit: PathHit;
+    let didIntersect = rayIntersectBvh(pathRay(pathIdx), T_MAX, &hit);
+    queueExtendedPath(pathIdx, didIntersect, hit);
+}
+
+// A fixed number of workgroups is dispatched, which fetch batches of paths from the extend queue
+// until it is empty. The paths are traced with the short-stack traversal.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn extendPersistent(@builtin(local_invocation_index) localIdx: u32) {
+    loop {
+        // The previous batch begin must have been read by every invocation before it is replaced.
+        workgroupBarrier();
+        if localIdx == 0u {
+            let batchBegin = atomicAdd(&queueState.extendFetchCount, WORKGROUP_SIZE);
+            workgroupBatchBegin = select(NO_BATCH, batchBegin, batchBegin < queueState.extendCount);
+        }
+        let batchBegin = workgroupUniformLoad(&workgroupBatchBegin);
+        if batchBegin == NO_BATCH {
+            break;
+        }
+
+        let queueIdx = batchBegin + localIdx;
+        if queueIdx < queueState.extendCount {
+            let pathIdx = queues[extendQueueOffset(queueState.bounce) + queueIdx];
+            var hit: PathHit;
+            let didIntersect = rayIntersectBvhShortStack(pathRay(pathIdx), T_MAX, localIdx, &hit);
+            queueExtendedPath(pathIdx, didIntersect, hit);
+        }
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn miss(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= atomicLoad(&queueState.missCount) {
+        return;
+    }
+
+    let pathIdx = queues[queueOffset(QUEUE_MISS) + queueIdx];
+    let bsdfPdf = pathState[pathStateIdx(PATH_ORIGIN, pathIdx)].w;
+    let direction = pathState[pathStateIdx(PATH_DIRECTION, pathIdx)].xyz;
+    let throughput = pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)].xyz;
+
+    // Camera rays which miss the scene see the sky directly, and are not weighted.
+    let misWeight = select(powerHeuristic(bsdfPdf, skyDistributionPdf(direction)), 1f, queueState.bounce == 1u);
+    addPathRadiance(pathIdx, throughput * skyRadiance(direction) * misWeight);
+}
+
+// Samples the sun and the sky at each hit, leaving the visibility tests to `shadow`, and scatters
+// the paths which have bounces left into the next extend queue.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn shade(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= atomicLoad(&queueState.shadeCount) {
+        return;
+    }
+
+    let pathIdx = queues[queueOffset(QUEUE_SHADE) + queueIdx];
+    let bounce = queueState.bounce;
+    let numBounces = renderParams.samplingState.numBounces;
+    let hit = pathIntersection(pathState[pathStateIdx(PATH_HIT, pathIdx)]);
+    let throughput = pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)].xyz;
+    let blueNoise = pathBlueNoise(pathIdx);
+    let albedo = evalTexture(hit.textureDescriptorIdx, hit.uv);
+    let brdf = albedo * FRAC_1_PI;
+
+    let lightDirection = sampleSolarDiskDirection(blueNoise, SOLAR_COS_THETA_MAX, skyState.sunDirection);
+    let lightIntensity = vec3(
+        skyState.solarRadiances[CHANNEL_R],
+        skyState.solarRadiances[CHANNEL_G],
+        skyState.solarRadiances[CHANNEL_B]
+    );
+    let reflectance = brdf * dot(hit.n, lightDirection);
+    let sunRadiance = throughput * lightIntensity * reflectance * SOLAR_INV_PDF;
+    pathState[pathStateIdx(PATH_SUN_RADIANCE, pathIdx)] = vec4(sunRadiance, 0f);
+
+    // Sky light sample. On the last bounce, there is no BSDF sample to share the sky with.
+    var skySampleRadiance = vec3(0f);
+    let skySample = sampleSkyDistribution(fract(blueNoise + SKY_SAMPLE_NOISE_OFFSET));
+    let skyCosTheta = dot(hit.n, skySample.direction);
+    if skyCosTheta > 0f && skySample.pdf > 0f {
+        let misWeight = select(powerHeuristic(skySample.pdf, skyCosTheta * FRAC_1_PI), 1f, bounce == numBounces);
+        let skyReflectance = brdf * skyCosTheta;
+        skySampleRadiance = throughput * skyRadiance(skySample.direction) * skyReflectance * misWeight / skySample.pdf;
+    }
+    pathState[pathStateIdx(PATH_SKY_RADIANCE, pathIdx)] = vec4(skySampleRadiance, 0f);
+
+    // The shadow rays start from the path origin, so it is moved to the hit even on the last bounce.
+    if bounce == numBounces {
+        pathState[pathStateIdx(PATH_ORIGIN, pathIdx)] = vec4(hit.p, 0f);
+        return;
+    }
+
+    let scatter = evalImplicitLambertian(blueNoise, hit.n, albedo);
+    let bsdfPdf = dot(hit.n, scatter.wi) * FRAC_1_PI;
+    pathState[pathStateIdx(PATH_ORIGIN, pathIdx)] = vec4(hit.p, bsdfPdf);
+    pathState[pathStateIdx(PATH_DIRECTION, pathIdx)] = vec4(scatter.wi, 0f);
+    pathState[pathStateIdx(PATH_THROUGHPUT, pathIdx)] = vec4(throughput * scatter.throughput, 0f);
+
+    let extendIdx = atomicAdd(&queueState.nextExtendCount, 1u);
+    queues[extendQueueOffset(bounce + 1u) + extendIdx] = pathIdx;
+}
+
+// Traces the shadow rays of the paths shaded this bounce. The light sample directions are
+// recomputed from the path's blue noise instead of being stored in the path state.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn shadow(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let queueIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if queueIdx >= atomicLoad(&queueState.shadeCount) {
+        return;
+    }
+
+    let pathIdx = queues[queueOffset(QUEUE_SHADE) + queueIdx];
+    traceShadowRays(pathIdx, false, localIdx);
+}
+
+// The persistent-threads variant of `shadow`, see `extendPersistent`.
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn shadowPersistent(@builtin(local_invocation_index) localIdx: u32) {
+    loop {
+        workgroupBarrier();
+        if localIdx == 0u {
+            let batchBegin = atomicAdd(&queueState.shadowFetchCount, WORKGROUP_SIZE);
+            let shadeCount = atomicLoad(&queueState.shadeCount);
+            workgroupBatchBegin = select(NO_BATCH, batchBegin, batchBegin < shadeCount);
+        }
+        let batchBegin = workgroupUniformLoad(&workgroupBatchBegin);
+        if batchBegin == NO_BATCH {
+            break;
+        }
+
+        let queueIdx = batchBegin + localIdx;
+        if queueIdx < atomicLoad(&queueState.shadeCount) {
+            let pathIdx = queues[queueOffset(QUEUE_SHADE) + queueIdx];
+            traceShadowRays(pathIdx, true, localIdx);
+        }
+    }
+}
+
+@compute @workgroup_size(WORKGROUP_SIZE)
+fn accumulate(
+    @builtin(workgroup_id) workgroupId: vec3u,
+    @builtin(num_workgroups) numWorkgroups: vec3u,
+    @builtin(local_invocation_index) localIdx: u32
+) {
+    let pathIdx = invocationIdx(workgroupId, numWorkgroups, localIdx);
+    if pathIdx >= pathCount() {
+        return;
+    }
+
+    let radiance = pathState[pathStateIdx(PATH_RADIANCE, pathIdx)].xyz;
+    if renderParams.samplingState.accumulatedSampleCount == 0u {
+        imageBuffer[pathIdx] = radiance;
+    } else {
+        imageBuffer[pathIdx] += radiance;
+    }
+}
+
+// Large queues are dispatched as a 2D grid of workgroups, see `dispatchSize` in
+// wavefront_queue.wgsl.
+@must_use
+fn invocationIdx(workgroupId: vec3u, numWorkgroups: vec3u, localIdx: u32) -> u32 {
+    return (workgroupId.y * numWorkgroups.x + workgroupId.x) * WORKGROUP_SIZE + localIdx;
+}
+
+@must_use
+fn pathCount() -> u32 {
+    let dimensions = renderParams.frameData.dimensions;
+    return dimensions.x * dimensions.y;
+}
+
+@must_use
+fn pathStateIdx(region: u32, pathIdx: u32) -> u32 {
+    return region * pathCount() + pathIdx;
+}
+
+@must_use
+fn queueOffset(queue: u32) -> u32 {
+    return queue * pathCount();
+}
+
+// The queue of paths which are extended on `bounce`.
+@must_use
+fn extendQueueOffset(bounce: u32) -> u32 {
+    return queueOffset(select(QUEUE_EXTEND_EVEN, QUEUE_EXTEND_ODD, bounce % 2u == 1u));
+}
+
+@must_use
+fn pathCoord(pathIdx: u32) -> vec2u {
+    let width = renderParams.frameData.dimensions.x;
+    return vec2u(pathIdx % width, pathIdx / width);
+}
+
+@must_use
+fn pathBlueNoise(pathIdx: u32) -> vec2f {
+    let samplingState = renderParams.samplingState;
+    return animatedBlueNoise(pathCoord(pathIdx), renderParams.frameData.frameCount, samplingState.numSamplesPerPixel);
+}
+
+@must_use
+fn pathRay(pathIdx: u32) -> Ray {
+    let origin = pathState[pathStateIdx(PATH_ORIGIN, pathIdx)];
+    let direction = pathState[pathStateIdx(PATH_DIRECTION, pathIdx)];
+    return Ray(origin.xyz, direction.xyz);
+}
+
+// Sorts an extended path into the shade or miss queue.
+fn queueExtendedPath(pathIdx: u32, didIntersect: bool, hit: PathHit) {
+    if didIntersect {
+        pathState[pathStateIdx(PATH_HIT, pathIdx)] = vec4(hit.b, hit.t, bitcast<f32>(hit.triangleIdx));
+        let shadeIdx = atomicAdd(&queueState.shadeCount, 1u);
+        queues[queueOffset(QUEUE_SHADE) + shadeIdx] = pathIdx;
+    } else {
+        let missIdx = atomicAdd(&queueState.missCount, 1u);
+        queues[queueOffset(QUEUE_MISS) + missIdx] = pathIdx;
+    }
+}
+
+fn traceShadowRays(pathIdx: u32, useShortStack: bool, localIdx: u32) {
+    let p = pathState[pathStateIdx(PATH_ORIGIN, pathIdx)].xyz;
+    let blueNoise = pathBlueNoise(pathIdx);
+
+    let lightDirection = sampleSolarDiskDirection(blueNoise, SOLAR_COS_THETA_MAX, skyState.sunDirection);
+    let sunRadiance = pathState[pathStateIdx(PATH_SUN_RADIANCE, pathIdx)].xyz;
+    var radiance = sunRadiance * visibility(Ray(p, lightDirection), useShortStack, localIdx);
+
+    let skySampleRadiance = pathState[pathStateIdx(PATH_SKY_RADIANCE, pathIdx)].xyz;
+    if any(skySampleRadiance != vec3(0f)) {
+        let skySample = sampleSkyDistribution(fract(blueNoise + SKY_SAMPLE_NOISE_OFFSET));
+        radiance += skySampleRadiance * visibility(Ray(p, skySample.direction), useShortStack, localIdx);
+    }
+
+    addPathRadiance(pathIdx, radiance);
+}
+
+@must_use
+fn visibility(ray: Ray, useShortStack: bool, localIdx: u32) -> f32 {
+    if useShortStack {
+        return shadowRayShortStack(ray, T_MAX, localIdx);
+    }
+    return shadowRay(ray, T_MAX);
+}
+
+fn addPathRadiance(pathIdx: u32, radiance: vec3f) {
+    let idx = pathStateIdx(PATH_RADIANCE, pathIdx);
+    pathState[idx] = vec4(pathState[idx].xyz + radiance, 0f);
+}
+
+// Reconstructs the surface intersection from the barycentrics and triangle index stored by `extend`.
+@must_use
+fn pathIntersection(hit: vec4f) -> Intersection {
+    let triangleIdx = bitcast<u32>(hit.w);
+    let b = vec3f(1f - hit.x - hit.y, hit.x, hit.y);
+    let tri = positionAttributes[triangleIdx];
+    let e1 = tri.p1 - tri.p0;
+    let e2 = tri.p2 - tri.p0;
+    let p = tri.p0 + b[1] * e1 + b[2] * e2;
+    let faceNormal = normalize(cross(e1, e2));
+
+    let vert = vertexAttributes[triangleIdx];
+    let n = b[0] * vert.n0 + b[1] * vert.n1 + b[2] * vert.n2;
+    let uv = b[0] * vert.uv0 + b[1] * vert.uv1 + b[2] * vert.uv2;
+
+    return Intersection(offsetRay(p, faceNormal), n, uv, vert.textureDescriptorIdx);
+}
+
+struct RenderParams {
+  frameData: FrameData,
+  camera: Camera,
+  samplingState: SamplingState,
+  @align(16) exposure: f32,
+}
+
+struct FrameData {
+    dimensions: vec2u,
+    frameCount: u32,
+}
+
+struct Camera {
+    origin: vec3f,
+    lowerLeftCorner: vec3f,
+    horizontal: vec3f,
+    vertical: vec3f,
+    up: vec3f,
+    right: vec3f,
+    lensRadius: f32,
+}
+
+struct SamplingState {
+    numSamplesPerPixel: u32,
+    numBounces: u32,
+    accumulatedSampleCount: u32,
+}
+
+struct PathHit {
+    b: vec2f,
+    t: f32,
+    triangleIdx: u32,
+}
+
+struct Scatter {
+    wi: vec3f,
+    throughput: vec3f,
+}
+
+@must_use
+fn generateCameraRay(noise: vec2f, camera: Camera, u: f32, v: f32) -> Ray {
+    let randomPointInLens = camera.lensRadius * pointInUnitDisk(noise);
+    let lensOffset = randomPointInLens.x * camera.right + randomPointInLens.y * camera.up;
+
+    let origin = camera.origin + lensOffset;
+    let direction = normalize(camera.lowerLeftCorner + u * camera.horizontal + v * camera.vertical - origin);
+
+    return Ray(origin, direction);
+}
+
+@must_use
+fn evalImplicitLambertian(blueNoise: vec2f, n: vec3f, albedo: vec3f) -> Scatter {
+    let v = directionInCosineWeightedHemisphere(blueNoise);
+    let onb = pixarOnb(n);
+    let wi = onb * v;
+
+    return Scatter(wi, albedo);
+}
+
+// The closest hit of a path, stored in the path state for `shade`.
+@must_use
+fn rayIntersectBvh(ray: Ray, rayTMax: f32, hit: ptr<function, PathHit>) -> bool {
+    let intersector = rayAabbIntersector(ray);
+    var toVisitOffset = 0u;
+    var currentNodeIdx = 0u;
+    var nodesToVisit: array<u32, 32u>;
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+
+    loop {
+        let node: BvhNode = bvhNodes[currentNodeIdx];
+
+        if rayIntersectAabb(intersector, node.aabb, tmax) {
+            if node.triangleCount > 0u {
+                for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                    let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                    var trihit: TriangleHit;
+                    if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                        tmax = trihit.t;
+                        didIntersect = true;
+                        *hit = PathHit(trihit.b.yz, trihit.t, node.trianglesOffset + idx);
+                    }
+                }
+                if toVisitOffset == 0u {
+                    break;
+                }
+                toVisitOffset -= 1u;
+                currentNodeIdx = nodesToVisit[toVisitOffset];
+            } else {
+                // Is intersector.invDir[node.splitAxis] < 0f? If so, visit second child first.
+                if intersector.dirNeg[node.splitAxis] == 1u {
+                    nodesToVisit[toVisitOffset] = currentNodeIdx + 1u;
+                    currentNodeIdx = node.secondChildOffset;
+                } else {
+                    nodesToVisit[toVisitOffset] = node.secondChildOffset;
+                    currentNodeIdx = currentNodeIdx + 1u;
+                }
+                toVisitOffset += 1u;
+            }
+        } else {
+            if toVisitOffset == 0u {
+                break;
+            }
+            toVisitOffset -= 1u;
+            currentNodeIdx = nodesToVisit[toVisitOffset];
+        }
+    }
+
+    return didIntersect;
+}
+
+// The short-stack traversal with a restart trail, see `rayIntersectBvhShortStack` in
+// common/ray_intersection.cpp for the CPU reference. The children are tested before they are
+// visited, so that the trail can record whether both children of a node need to be visited.
+struct ShortStackTraversal {
+    intersector: RayAabbIntersector,
+    localIdx: u32,
+    stackTop: u32,
+    stackSize: u32,
+    trail: u32,
+    level: u32,
+    nodeIdx: u32,
+}
+
+@must_use
+fn shortStackTraversal(ray: Ray, localIdx: u32) -> ShortStackTraversal {
+    return ShortStackTraversal(rayAabbIntersector(ray), localIdx, 0u, 0u, 0u, ROOT_LEVEL, 0u);
+}
+
+// Moves to the child nodes of the current interior node which intersect the ray. Returns false if
+// neither child intersects the ray.
+@must_use
+fn shortStackDescend(traversal: ptr<function, ShortStackTraversal>, node: BvhNode, rayTMax: f32) -> bool {
+    let secondChildFirst = (*traversal).intersector.dirNeg[node.splitAxis] == 1u;
+    let firstIdx = select((*traversal).nodeIdx + 1u, node.secondChildOffset, secondChildFirst);
+    let secondIdx = select(node.secondChildOffset, (*traversal).nodeIdx + 1u, secondChildFirst);
+    let hitFirst = rayIntersectAabb((*traversal).intersector, bvhNodes[firstIdx].aabb, rayTMax);
+    let hitSecond = rayIntersectAabb((*traversal).intersector, bvhNodes[secondIdx].aabb, rayTMax);
+    // The trail can't represent deeper trees. Skipping the children terminates the traversal
+    // instead of looping forever.
+    if !(hitFirst || hitSecond) || (*traversal).level == 1u {
+        return false;
+    }
+
+    (*traversal).level >>= 1u;
+    if hitFirst && hitSecond {
+        if ((*traversal).trail & (*traversal).level) != 0u {
+            // The first child was visited before the restart.
+            (*traversal).nodeIdx = secondIdx;
+        } else {
+            // The oldest entry is overwritten when the short stack is full.
+            (*traversal).nodeIdx = firstIdx;
+            shortStacks[(*traversal).stackTop * WORKGROUP_SIZE + (*traversal).localIdx] = secondIdx;
+            (*traversal).stackTop = ((*traversal).stackTop + 1u) % SHORT_STACK_SIZE;
+            (*traversal).stackSize = min((*traversal).stackSize + 1u, SHORT_STACK_SIZE);
+        }
+    } else {
+        (*traversal).nodeIdx = select(secondIdx, firstIdx, hitFirst);
+        (*traversal).trail |= (*traversal).level;
+    }
+    return true;
+}
+
+// Moves to the next node after the current subtree, popping it from the short stack or restarting
+// from the root. Returns false once the traversal is done.
+@must_use
+fn shortStackPop(traversal: ptr<function, ShortStackTraversal>) -> bool {
+    // Adding the level to the trail moves to the next sibling on the deepest level which still has
+    // one, clearing the bits of the levels below it.
+    let trail = ((*traversal).trail & ~((*traversal).level - 1u)) + (*traversal).level;
+    if (trail & ROOT_LEVEL) != 0u {
+        return false;
+    }
+    (*traversal).trail = trail;
+    (*traversal).level = trail & (~trail + 1u);
+
+    if (*traversal).stackSize > 0u {
+        (*traversal).stackTop = ((*traversal).stackTop + SHORT_STACK_SIZE - 1u) % SHORT_STACK_SIZE;
+        (*traversal).stackSize -= 1u;
+        (*traversal).nodeIdx = shortStacks[(*traversal).stackTop * WORKGROUP_SIZE + (*traversal).localIdx];
+    } else {
+        (*traversal).nodeIdx = 0u;
+        (*traversal).level = ROOT_LEVEL;
+    }
+    return true;
+}
+
+// Returns 1.0 if no forward intersections, 0.0 otherwise.
+@must_use
+fn shadowRayShortStack(ray: Ray, rayTMax: f32, localIdx: u32) -> f32 {
+    var traversal = shortStackTraversal(ray, localIdx);
+    if !rayIntersectAabb(traversal.intersector, bvhNodes[0].aabb, rayTMax) {
+        return 1f;
+    }
+
+    loop {
+        let node: BvhNode = bvhNodes[traversal.nodeIdx];
+
+        if node.triangleCount > 0u {
+            for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                var trihit: TriangleHit;
+                if rayIntersectTriangle(ray, triangle, rayTMax, &trihit) {
+                    return 0f;
+                }
+            }
+        } else if shortStackDescend(&traversal, node, rayTMax) {
+            continue;
+        }
+
+        if !shortStackPop(&traversal) {
+            break;
+        }
+    }
+
+    return 1f;
+}
+
+@must_use
+fn rayIntersectBvhShortStack(ray: Ray, rayTMax: f32, localIdx: u32, hit: ptr<function, PathHit>) -> bool {
+    var traversal = shortStackTraversal(ray, localIdx);
+    var didIntersect: bool = false;
+    var tmax = rayTMax;
+    if !rayIntersectAabb(traversal.intersector, bvhNodes[0].aabb, tmax) {
+        return false;
+    }
+
+    loop {
+        let node: BvhNode = bvhNodes[traversal.nodeIdx];
+
+        if node.triangleCount > 0u {
+            for (var idx = 0u; idx < node.triangleCount; idx = idx + 1u) {
+                let triangle: Positions = positionAttributes[node.trianglesOffset + idx];
+                var trihit: TriangleHit;
+                if rayIntersectTriangle(ray, triangle, tmax, &trihit) {
+                    tmax = trihit.t;
+                    didIntersect = true;
+                    *hit = PathHit(trihit.b.yz, trihit.t, node.trianglesOffset + idx);
+                }
+            }
+        } else if shortStackDescend(&traversal, node, tmax) {
+            continue;
+        }
+
+        if !shortStackPop(&traversal) {
+            break;
+        }
+    }
+
+    return didIntersect;
+}
+
+@must_use
+fn textureLookup(desc: TextureDescriptor, uv: vec2f) -> vec3f {
+    let u = fract(uv.x);
+    let v = fract(uv.y);
+
+    let x = min(u32(u * f32(desc.width)), desc.width - 1u);
+    let y = min(u32(v * f32(desc.height)), desc.height - 1u);
+
+    let idx = desc.offset + texelIndex(desc, x, y) * texelWordCount(desc.format);
+    let word0 = textureTexel(desc.page, idx);
+    var word1 = 0u;
+    if desc.format == TEXTURE_FORMAT_RGBA16_FLOAT {
+        word1 = textureTexel(desc.page, idx + 1u);
+    }
+    return decodeTexel(desc.format, word0, word1);
+}
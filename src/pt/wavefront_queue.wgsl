@@ -0,0 +1,67 @@
+// queue bind group
+@group(0) @binding(0) var<storage, read_write> queueState: QueueState;
+@group(0) @binding(1) var<storage, read_write> dispatchArgs: array<DispatchArgs>;
+
+// The bookkeeping kernels of the wavefront integrator. They run as a single invocation in between
+// the kernels in wavefront_path_tracer.wgsl, turning the queue counts into indirect dispatch
+// arguments. The dispatch arguments live in a separate buffer, since a buffer can't be used both as
+// a writable storage buffer and as an indirect buffer by the same dispatch.
+
+// The workgroup size of the kernels in wavefront_path_tracer.wgsl, overridden by the renderer.
+override WORKGROUP_SIZE: u32 = 64u;
+
+// Matches `maxComputeWorkgroupsPerDimension` in the WebGPU default limits.
+const MAX_WORKGROUPS_PER_DIMENSION = 65535u;
+
+// Matches `WavefrontDispatch` in reference_path_tracer.cpp.
+const DISPATCH_EXTEND = 0u;
+const DISPATCH_SHADE = 1u;
+const DISPATCH_MISS = 2u;
+
+// The atomic counters of `QueueState` in wavefront_path_tracer.wgsl are plain integers here, since
+// the kernels run as a single invocation.
+struct QueueState {
+    bounce: u32,
+    extendCount: u32,
+    shadeCount: u32,
+    missCount: u32,
+    nextExtendCount: u32,
+    extendFetchCount: u32,
+    shadowFetchCount: u32,
+}
+
+struct DispatchArgs {
+    x: u32,
+    y: u32,
+    z: u32,
+}
+
+// Makes the paths scattered by the previous bounce the current extend queue, and clears the
+// queues which the bounce fills.
+@compute @workgroup_size(1)
+fn beginBounce() {
+    queueState.bounce += 1u;
+    queueState.extendCount = queueState.nextExtendCount;
+    queueState.shadeCount = 0u;
+    queueState.missCount = 0u;
+    queueState.nextExtendCount = 0u;
+    queueState.extendFetchCount = 0u;
+    queueState.shadowFetchCount = 0u;
+    dispatchArgs[DISPATCH_EXTEND] = dispatchSize(queueState.extendCount);
+}
+
+// Runs after `extend` has filled the shade and miss queues.
+@compute @workgroup_size(1)
+fn prepareShade() {
+    dispatchArgs[DISPATCH_SHADE] = dispatchSize(queueState.shadeCount);
+    dispatchArgs[DISPATCH_MISS] = dispatchSize(queueState.missCount);
+}
+
+// Matches `wavefrontDispatchSize` in reference_path_tracer.cpp.
+@must_use
+fn dispatchSize(invocationCount: u32) -> DispatchArgs {
+    let workgroupCount = (invocationCount + WORKGROUP_SIZE - 1u) / WORKGROUP_SIZE;
+    let x = min(workgroupCount, MAX_WORKGROUPS_PER_DIMENSION);
+    let y = (workgroupCount + MAX_WORKGROUPS_PER_DIMENSION - 1u) / MAX_WORKGROUPS_PER_DIMENSION;
+    return DispatchArgs(x, y, 1u);
+}
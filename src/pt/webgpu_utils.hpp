@@ -29,6 +29,15 @@ inline void bindGroupLayoutSafeRelease(const WGPUBindGroupLayout bindGroupLayout
     }
 }
 
+inline void bufferSafeRelease(const WGPUBuffer buffer) noexcept
+{
+    if (buffer)
+    {
+        wgpuBufferDestroy(buffer);
+        wgpuBufferRelease(buffer);
+    }
+}
+
 inline void querySetSafeRelease(const WGPUQuerySet querySet) noexcept
 {
     if (querySet)
@@ -54,6 +63,22 @@ inline void computePipelineSafeRelease(const WGPUComputePipeline pipeline) noexc
     }
 }
 
+inline void pipelineLayoutSafeRelease(const WGPUPipelineLayout pipelineLayout) noexcept
+{
+    if (pipelineLayout)
+    {
+        wgpuPipelineLayoutRelease(pipelineLayout);
+    }
+}
+
+inline void shaderModuleSafeRelease(const WGPUShaderModule shaderModule) noexcept
+{
+    if (shaderModule)
+    {
+        wgpuShaderModuleRelease(shaderModule);
+    }
+}
+
 inline void samplerSafeRelease(const WGPUSampler sampler) noexcept
 {
     if (sampler)
@@ -31,17 +31,19 @@ bool bruteForceRayIntersectModel(
     return didIntersect;
 }
 
-TEST_CASE("Bvh intersection matches brute-force intersection", "[bvh]")
-{
-    const GltfModel      model{"Duck.glb"};
-    const FlattenedModel flattenedModel{model};
-
-    const Bvh  bvh = buildBvh(flattenedModel.positions);
-    const auto triangles =
-        reorderAttributes(std::span(flattenedModel.positions), bvh.triangleIndices);
-    REQUIRE_FALSE(bvh.nodes.empty());
-    REQUIRE_FALSE(bvh.triangleIndices.empty());
+using BvhIntersector = bool (*)(
+    const Ray&,
+    std::span<const BvhNode>,
+    std::span<const Positions>,
+    float,
+    Intersection&,
+    BvhStats*);
 
+void requireBvhMatchesBruteForce(
+    const std::span<const BvhNode>   bvhNodes,
+    const std::span<const Positions> triangles,
+    const BvhIntersector             intersectBvh = rayIntersectBvh)
+{
     const Camera camera = [&triangles]() -> Camera {
         const Aabb modelAabb = [&triangles]() -> Aabb {
             Aabb aabb;
@@ -89,7 +91,7 @@ TEST_CASE("Bvh intersection matches brute-force intersection", "[bvh]")
                 bruteForceRayIntersectModel(ray, triangles, rayTMax, bruteForceIntersection);
             Intersection bvhIntersection;
             const bool   bvhDidIntersect =
-                rayIntersectBvh(ray, bvh.nodes, triangles, rayTMax, bvhIntersection);
+                intersectBvh(ray, bvhNodes, triangles, rayTMax, bvhIntersection, nullptr);
 
             REQUIRE(bvhDidIntersect == didIntersect);
 
@@ -100,3 +102,102 @@ TEST_CASE("Bvh intersection matches brute-force intersection", "[bvh]")
         }
     }
 }
+
+TEST_CASE("Bvh intersection matches brute-force intersection", "[bvh]")
+{
+    const GltfModel      model{"Duck.glb"};
+    const FlattenedModel flattenedModel{model};
+
+    const Bvh  bvh = buildBvh(flattenedModel.positions);
+    const auto triangles =
+        reorderAttributes(std::span(flattenedModel.positions), bvh.triangleIndices);
+    REQUIRE_FALSE(bvh.nodes.empty());
+    REQUIRE_FALSE(bvh.triangleIndices.empty());
+
+    requireBvhMatchesBruteForce(bvh.nodes, triangles);
+}
+
+TEST_CASE("Short-stack Bvh intersection matches brute-force intersection", "[bvh]")
+{
+    const GltfModel      model{"Duck.glb"};
+    const FlattenedModel flattenedModel{model};
+
+    const Bvh  bvh = buildBvh(flattenedModel.positions);
+    const auto triangles =
+        reorderAttributes(std::span(flattenedModel.positions), bvh.triangleIndices);
+    // The tree is deep enough for the short stack to overflow, so the traversal restarts.
+    REQUIRE(bvhDepth(bvh.nodes) > BVH_SHORT_STACK_SIZE);
+    REQUIRE(bvhDepth(bvh.nodes) <= BVH_SHORT_STACK_MAX_DEPTH);
+
+    requireBvhMatchesBruteForce(bvh.nodes, triangles, rayIntersectBvhShortStack);
+}
+
+TEST_CASE("Lbvh intersection matches brute-force intersection", "[bvh]")
+{
+    const GltfModel      model{"Duck.glb"};
+    const FlattenedModel flattenedModel{model};
+
+    const Bvh lbvh = buildLbvh(flattenedModel.positions);
+    REQUIRE(lbvh.nodes.size() == 2 * flattenedModel.positions.size() - 1);
+
+    requireBvhMatchesBruteForce(lbvh.nodes, flattenedModel.positions);
+}
+
+TEST_CASE("Lbvh is valid and its SAH cost is comparable to the SAH builder", "[bvh]")
+{
+    const GltfModel      model{"Duck.glb"};
+    const FlattenedModel flattenedModel{model};
+    const std::size_t    triangleCount = flattenedModel.positions.size();
+
+    const Bvh bvh = buildBvh(flattenedModel.positions);
+    const Bvh lbvh = buildLbvh(flattenedModel.positions);
+
+    REQUIRE(isValidBvh(bvh.nodes, triangleCount));
+    REQUIRE(isValidBvh(lbvh.nodes, triangleCount));
+
+    const float bvhCost = sahCost(bvh.nodes);
+    const float lbvhCost = sahCost(lbvh.nodes);
+    REQUIRE(bvhCost > 0.0f);
+    // The LBVH splits at the Morton code's spatial median instead of minimizing the SAH.
+    REQUIRE(lbvhCost >= bvhCost);
+    REQUIRE(lbvhCost < 2.0f * bvhCost);
+}
+
+TEST_CASE("Bvh validation rejects broken trees", "[bvh]")
+{
+    const GltfModel      model{"Duck.glb"};
+    const FlattenedModel flattenedModel{model};
+    const std::size_t    triangleCount = flattenedModel.positions.size();
+
+    const Bvh lbvh = buildLbvh(flattenedModel.positions);
+
+    SECTION("Missing triangle")
+    {
+        REQUIRE_FALSE(isValidBvh(lbvh.nodes, triangleCount + 1));
+    }
+
+    SECTION("Misplaced second child")
+    {
+        std::vector<BvhNode> nodes = lbvh.nodes;
+        nodes[0].secondChildOffset += 1;
+        REQUIRE_FALSE(isValidBvh(nodes, triangleCount));
+    }
+
+    SECTION("Child outside of parent bounds")
+    {
+        std::vector<BvhNode> nodes = lbvh.nodes;
+        nodes[1].aabb.max.x = nodes[0].aabb.max.x + 1.0f;
+        REQUIRE_FALSE(isValidBvh(nodes, triangleCount));
+    }
+}
+
+TEST_CASE("Morton codes interleave the axes", "[bvh]")
+{
+    REQUIRE(mortonCode(glm::vec3(0.0f)) == 0);
+    REQUIRE(mortonCode(glm::vec3(1.0f, 0.0f, 0.0f)) == 0x24924924u);
+    REQUIRE(mortonCode(glm::vec3(0.0f, 1.0f, 0.0f)) == 0x12492492u);
+    REQUIRE(mortonCode(glm::vec3(0.0f, 0.0f, 1.0f)) == 0x09249249u);
+    REQUIRE(mortonCode(glm::vec3(1.0f)) == 0x3fffffffu);
+    // The lowest bits encode the finest subdivision.
+    REQUIRE(mortonCode(glm::vec3(1.0f / 1024.0f, 0.0f, 0.0f)) == 0b100u);
+}
@@ -0,0 +1,65 @@
+#include <common/duration_histogram.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+
+using namespace nlrs;
+
+SCENARIO("Duration histogram", "[duration_histogram]")
+{
+    GIVEN("an empty histogram")
+    {
+        DurationHistogram histogram;
+
+        THEN("the summary is zero")
+        {
+            const auto summary = histogram.summary();
+            REQUIRE(histogram.count() == 0);
+            REQUIRE(summary.minMs == 0.0f);
+            REQUIRE(summary.averageMs == 0.0f);
+            REQUIRE(summary.p95Ms == 0.0f);
+            REQUIRE(summary.maxMs == 0.0f);
+        }
+    }
+
+    GIVEN("a histogram with durations from 1 to 100 ms")
+    {
+        DurationHistogram histogram;
+        for (std::uint64_t ms = 100; ms > 0; --ms)
+        {
+            histogram.record(ms * 1'000'000);
+        }
+
+        THEN("the summary describes the distribution")
+        {
+            const auto summary = histogram.summary();
+            REQUIRE(histogram.count() == 100);
+            REQUIRE(summary.minMs == 1.0f);
+            REQUIRE(summary.averageMs == 50.5f);
+            REQUIRE(summary.p95Ms == 95.0f);
+            REQUIRE(summary.maxMs == 100.0f);
+        }
+    }
+
+    GIVEN("a histogram which has been filled past its capacity")
+    {
+        DurationHistogram histogram;
+        for (std::size_t i = 0; i < DurationHistogram::CAPACITY; ++i)
+        {
+            histogram.record(1'000'000'000);
+        }
+        for (std::size_t i = 0; i < DurationHistogram::CAPACITY; ++i)
+        {
+            histogram.record(2'000'000);
+        }
+
+        THEN("only the most recent durations remain")
+        {
+            const auto summary = histogram.summary();
+            REQUIRE(histogram.count() == DurationHistogram::CAPACITY);
+            REQUIRE(summary.minMs == 2.0f);
+            REQUIRE(summary.maxMs == 2.0f);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include <common/dynamic_resolution.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+using namespace nlrs;
+
+namespace
+{
+constexpr std::array<float, 3> LEVEL_COSTS{1.0f, 0.5f, 0.25f};
+constexpr float                TARGET_FRAME_MS = 10.0f;
+
+// Records enough frames of the given duration for the controller to make a decision.
+std::optional<DynamicResolutionController::Decision> recordWindow(
+    DynamicResolutionController& controller,
+    const float                  frameMs)
+{
+    const auto          frameNs = static_cast<std::uint64_t>(frameMs * 1000000.0f);
+    const std::uint32_t frameCount = DynamicResolutionController::SETTLE_FRAME_COUNT +
+                                     DynamicResolutionController::WINDOW_FRAME_COUNT;
+    for (std::uint32_t i = 0; i < frameCount; ++i)
+    {
+        if (const auto decision = controller.record(frameNs))
+        {
+            REQUIRE(i + 1 == frameCount);
+            return decision;
+        }
+    }
+    return std::nullopt;
+}
+} // namespace
+
+SCENARIO("Dynamic resolution controller", "[dynamic_resolution]")
+{
+    GIVEN("a disabled controller")
+    {
+        DynamicResolutionController controller;
+
+        THEN("it stays at the first level")
+        {
+            REQUIRE(!controller.isEnabled());
+            REQUIRE(!recordWindow(controller, 100.0f).has_value());
+            REQUIRE(controller.level() == 0);
+        }
+    }
+
+    GIVEN("a controller at the first level")
+    {
+        DynamicResolutionController controller(TARGET_FRAME_MS, LEVEL_COSTS);
+
+        WHEN("frames exceed the budget")
+        {
+            const auto decision = recordWindow(controller, 15.0f);
+
+            THEN("the resolution is lowered by one level")
+            {
+                REQUIRE(decision.has_value());
+                REQUIRE(decision->previousLevel == 0);
+                REQUIRE(decision->level == 1);
+                REQUIRE(decision->averageMs > 14.9f);
+                REQUIRE(decision->averageMs < 15.1f);
+                REQUIRE(controller.level() == 1);
+            }
+        }
+
+        WHEN("frames are within the budget")
+        {
+            const auto decision = recordWindow(controller, 5.0f);
+
+            THEN("the resolution is unchanged")
+            {
+                REQUIRE(!decision.has_value());
+                REQUIRE(controller.level() == 0);
+            }
+        }
+    }
+
+    GIVEN("a controller at the lowest level")
+    {
+        DynamicResolutionController controller(TARGET_FRAME_MS, LEVEL_COSTS);
+        REQUIRE(recordWindow(controller, 20.0f).has_value());
+        REQUIRE(recordWindow(controller, 20.0f).has_value());
+        REQUIRE(controller.level() == 2);
+
+        WHEN("frames still exceed the budget")
+        {
+            THEN("the resolution stays at the lowest level")
+            {
+                REQUIRE(!recordWindow(controller, 20.0f).has_value());
+                REQUIRE(controller.level() == 2);
+            }
+        }
+
+        WHEN("the higher level's predicted duration is within the hysteresis margin")
+        {
+            // 4.5 ms at a quarter of the pixels predicts 9 ms at half of the pixels, which is above
+            // the raise threshold.
+            THEN("the resolution is unchanged")
+            {
+                REQUIRE(!recordWindow(controller, 4.5f).has_value());
+                REQUIRE(controller.level() == 2);
+            }
+        }
+
+        WHEN("the higher level's predicted duration is well within the budget")
+        {
+            const auto decision = recordWindow(controller, 3.0f);
+
+            THEN("the resolution is raised by one level")
+            {
+                REQUIRE(decision.has_value());
+                REQUIRE(decision->previousLevel == 2);
+                REQUIRE(decision->level == 1);
+                REQUIRE(controller.level() == 1);
+            }
+        }
+    }
+}
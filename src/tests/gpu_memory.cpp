@@ -0,0 +1,135 @@
+#include <common/gpu_memory.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+using namespace nlrs;
+
+SCENARIO("GPU memory tracker", "[gpu_memory]")
+{
+    GIVEN("a tracker without a budget")
+    {
+        GpuMemoryTracker tracker;
+
+        WHEN("allocations are made in different categories")
+        {
+            const auto vertexId = tracker.allocate("vertices", GpuMemoryCategory::Geometry, 1024);
+            const auto indexId = tracker.allocate("indices", GpuMemoryCategory::Geometry, 512);
+            const auto nodeId = tracker.allocate("bvh nodes", GpuMemoryCategory::Bvh, 4096);
+
+            THEN("the usage is aggregated by category and in total")
+            {
+                REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Geometry).byteSize == 1536);
+                REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Geometry).allocationCount == 2);
+                REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Bvh).byteSize == 4096);
+                REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Textures).byteSize == 0);
+                REQUIRE(tracker.totalUsage().byteSize == 5632);
+                REQUIRE(tracker.totalUsage().allocationCount == 3);
+            }
+
+            THEN("the largest allocations are listed first")
+            {
+                const auto largest = tracker.largestAllocations(2);
+                REQUIRE(largest.size() == 2);
+                REQUIRE(largest[0].label == "bvh nodes");
+                REQUIRE(largest[0].category == GpuMemoryCategory::Bvh);
+                REQUIRE(largest[1].label == "vertices");
+                REQUIRE(tracker.largestAllocations(10).size() == 3);
+            }
+
+            AND_WHEN("allocations are released")
+            {
+                tracker.release(nodeId);
+                tracker.release(indexId);
+
+                THEN("the usage drops, but the high-water marks remain")
+                {
+                    REQUIRE(tracker.totalUsage().byteSize == 1024);
+                    REQUIRE(tracker.totalUsage().peakByteSize == 5632);
+                    REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Bvh).byteSize == 0);
+                    REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Bvh).peakByteSize == 4096);
+                    REQUIRE(
+                        tracker.categoryUsage(GpuMemoryCategory::Geometry).allocationCount == 1);
+                }
+            }
+
+            tracker.release(vertexId);
+        }
+
+        THEN("releasing the invalid allocation id does nothing")
+        {
+            tracker.release(GpuMemoryTracker::INVALID_ALLOCATION_ID);
+            REQUIRE(tracker.totalUsage().byteSize == 0);
+        }
+    }
+
+    GIVEN("a tracker with a budget")
+    {
+        GpuMemoryTracker tracker;
+        tracker.setBudget(4096);
+        const auto id = tracker.allocate("g-buffer", GpuMemoryCategory::Gbuffer, 3072);
+
+        THEN("allocations within the budget succeed")
+        {
+            tracker.allocate("uniforms", GpuMemoryCategory::Other, 1024);
+            REQUIRE(tracker.totalUsage().byteSize == 4096);
+        }
+
+        THEN("allocations exceeding the budget throw without being recorded")
+        {
+            REQUIRE_THROWS_AS(
+                tracker.allocate("accumulation", GpuMemoryCategory::Accumulation, 2048),
+                std::runtime_error);
+            REQUIRE(tracker.totalUsage().byteSize == 3072);
+            REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Accumulation).allocationCount == 0);
+        }
+
+        THEN("released memory is available again")
+        {
+            tracker.release(id);
+            tracker.allocate("accumulation", GpuMemoryCategory::Accumulation, 4096);
+            REQUIRE(tracker.totalUsage().byteSize == 4096);
+        }
+    }
+}
+
+SCENARIO("GPU memory allocation handle", "[gpu_memory]")
+{
+    GpuMemoryTracker&   tracker = GpuMemoryTracker::global();
+    const std::uint64_t baseByteSize = tracker.totalUsage().byteSize;
+
+    GIVEN("an allocation in the global tracker")
+    {
+        GpuMemoryAllocation allocation("texture", GpuMemoryCategory::Textures, 256);
+        REQUIRE(tracker.totalUsage().byteSize == baseByteSize + 256);
+
+        WHEN("the allocation is moved")
+        {
+            GpuMemoryAllocation moved(std::move(allocation));
+
+            THEN("it is recorded once")
+            {
+                REQUIRE(tracker.totalUsage().byteSize == baseByteSize + 256);
+            }
+        }
+
+        WHEN("another allocation is move assigned to it")
+        {
+            allocation = GpuMemoryAllocation("staging", GpuMemoryCategory::Staging, 64);
+
+            THEN("the previous allocation is released")
+            {
+                REQUIRE(tracker.totalUsage().byteSize == baseByteSize + 64);
+                REQUIRE(tracker.categoryUsage(GpuMemoryCategory::Textures).byteSize == 0);
+            }
+        }
+    }
+
+    THEN("the allocations are released when the handles are destroyed")
+    {
+        REQUIRE(tracker.totalUsage().byteSize == baseByteSize);
+    }
+}
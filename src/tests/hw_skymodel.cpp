@@ -0,0 +1,131 @@
+#include <hw-skymodel/hw_skymodel.h>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace
+{
+sky_state makeSkyState(const float sunElevation, const float turbidity)
+{
+    const sky_params params{
+        .elevation = sunElevation,
+        .turbidity = turbidity,
+        .albedo = {0.3f, 0.3f, 0.3f},
+    };
+    sky_state state;
+    REQUIRE(sky_state_new(&params, &state) == sky_state_result_success);
+    return state;
+}
+
+struct Directions
+{
+    std::vector<float> thetas;
+    std::vector<float> gammas;
+};
+
+Directions makeRandomDirections(const std::size_t count)
+{
+    constexpr float                       pi = std::numbers::pi_v<float>;
+    std::mt19937                          rng(1234);
+    std::uniform_real_distribution<float> thetaDist(0.0f, 0.5f * pi);
+    std::uniform_real_distribution<float> gammaDist(0.0f, pi);
+
+    Directions directions;
+    directions.thetas.resize(count);
+    directions.gammas.resize(count);
+    std::generate(directions.thetas.begin(), directions.thetas.end(), [&]() -> float {
+        return thetaDist(rng);
+    });
+    std::generate(directions.gammas.begin(), directions.gammas.end(), [&]() -> float {
+        return gammaDist(rng);
+    });
+    return directions;
+}
+} // namespace
+
+TEST_CASE("Batch sky radiance matches the scalar model", "[sky]")
+{
+    // Not a multiple of the batch block size, so that the last block is partial.
+    constexpr std::size_t count = 10007;
+    const Directions      directions = makeRandomDirections(count);
+
+    for (const float sunElevation : {0.1f, 0.5f, 1.2f})
+    {
+        for (const float turbidity : {1.0f, 2.0f, 6.0f, 10.0f})
+        {
+            const sky_state state = makeSkyState(sunElevation, turbidity);
+
+            std::vector<float> rgb(3 * count);
+            sky_state_radiance_batch(
+                &state, directions.thetas.data(), directions.gammas.data(), count, rgb.data());
+
+            float maxError = 0.0f;
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                for (int channel = 0; channel < 3; ++channel)
+                {
+                    const float expected = sky_state_radiance(
+                        &state,
+                        directions.thetas[i],
+                        directions.gammas[i],
+                        static_cast<enum channel>(channel));
+                    const float actual = rgb[3 * i + channel];
+                    maxError =
+                        std::max(maxError, std::abs(actual - expected) / std::abs(expected));
+                }
+            }
+
+            REQUIRE(maxError < 1e-5f);
+        }
+    }
+}
+
+TEST_CASE("Batch sky radiance includes the solar disk", "[sky]")
+{
+    const sky_state state = makeSkyState(0.5f, 3.0f);
+    const float     theta = 0.5f * std::numbers::pi_v<float> - 0.5f;
+    const float     gammas[2] = {0.0f, 0.1f};
+    const float     thetas[2] = {theta, theta};
+    float           rgb[6];
+    sky_state_radiance_batch(&state, thetas, gammas, 2, rgb);
+
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        REQUIRE(rgb[channel] > state.solar_radiances[channel]);
+        REQUIRE(rgb[3 + channel] < state.solar_radiances[channel]);
+    }
+}
+
+TEST_CASE("Sky radiance benchmark", "[sky][!benchmark]")
+{
+    constexpr std::size_t count = 1 << 16;
+    const Directions      directions = makeRandomDirections(count);
+    const sky_state       state = makeSkyState(0.5f, 3.0f);
+    std::vector<float>    rgb(3 * count);
+
+    BENCHMARK("scalar")
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const float theta = directions.thetas[i];
+            const float gamma = directions.gammas[i];
+            rgb[3 * i + 0] = sky_state_radiance(&state, theta, gamma, channel_r);
+            rgb[3 * i + 1] = sky_state_radiance(&state, theta, gamma, channel_g);
+            rgb[3 * i + 2] = sky_state_radiance(&state, theta, gamma, channel_b);
+        }
+        return rgb[0];
+    };
+    BENCHMARK("batch")
+    {
+        sky_state_radiance_batch(
+            &state, directions.thetas.data(), directions.gammas.data(), count, rgb.data());
+        return rgb[0];
+    };
+}
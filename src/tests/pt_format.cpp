@@ -164,8 +164,9 @@ SCENARIO("Serialize and deserialize PtFormat", "[pt-format]")
                     const auto& destTexture = deserializedPtFormat.baseColorTextures[i];
                     REQUIRE(sourceTexture.dimensions().width == destTexture.dimensions().width);
                     REQUIRE(sourceTexture.dimensions().height == destTexture.dimensions().height);
+                    REQUIRE(sourceTexture.format() == destTexture.format());
                     const std::size_t pixelBytes =
-                        sourceTexture.pixels().size() * sizeof(Texture::BgraPixel);
+                        sourceTexture.pixels().size() * sizeof(std::uint32_t);
                     REQUIRE(
                         std::memcmp(
                             sourceTexture.pixels().data(),
@@ -192,7 +193,7 @@ SCENARIO("invalid magic bytes", "[pt-format]")
             REQUIRE_THROWS_WITH(
                 deserialize(stream, format),
                 "Mismatching PtFormat file version. Invalid version in magic bytes: expected "
-                "'PTFORMAT3', got 'PTFORMAT0'.");
+                "'PTFORMAT4', got 'PTFORMAT0'.");
         }
     }
 
@@ -0,0 +1,147 @@
+#include <common/sky_distribution.hpp>
+#include <common/sky_radiance_lut.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <random>
+#include <vector>
+
+using namespace nlrs;
+
+namespace
+{
+constexpr float PI = std::numbers::pi_v<float>;
+
+struct SkyFixture
+{
+    std::vector<float> lut;
+    glm::vec3          sunDirection;
+    std::vector<float> distribution;
+
+    SkyFixture(const float sunElevation, const float turbidity)
+    {
+        const sky_params params{
+            .elevation = sunElevation,
+            .turbidity = turbidity,
+            .albedo = {0.3f, 0.3f, 0.3f},
+        };
+        sky_state state;
+        REQUIRE(sky_state_new(&params, &state) == sky_state_result_success);
+
+        lut = bakeSkyRadianceLut(state);
+        sunDirection = glm::vec3(std::cos(sunElevation), std::sin(sunElevation), 0.0f);
+        distribution = buildSkyDistribution(lut, sunDirection);
+    }
+
+    float luminance(const glm::vec3& direction) const
+    {
+        const glm::vec3 radiance =
+            sampleSkyRadianceLut(lut, direction.y, glm::dot(direction, sunDirection));
+        return 0.2126f * radiance.x + 0.7152f * radiance.y + 0.0722f * radiance.z;
+    }
+};
+
+glm::vec3 sphericalDirection(const float theta, const float phi)
+{
+    return glm::vec3(
+        std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+}
+} // namespace
+
+TEST_CASE("Sky distribution pdf integrates to one", "[sky]")
+{
+    const SkyFixture sky(0.3f, 4.0f);
+
+    constexpr int thetaSteps = 512;
+    constexpr int phiSteps = 1024;
+    const float   dTheta = PI / thetaSteps;
+    const float   dPhi = 2.0f * PI / phiSteps;
+
+    double integral = 0.0;
+    for (int i = 0; i < thetaSteps; ++i)
+    {
+        const float theta = (i + 0.5f) * dTheta;
+        for (int j = 0; j < phiSteps; ++j)
+        {
+            const float phi = (j + 0.5f) * dPhi;
+            const float pdf = skyDistributionPdf(sky.distribution, sphericalDirection(theta, phi));
+            integral += pdf * std::sin(theta) * dTheta * dPhi;
+        }
+    }
+
+    REQUIRE(std::abs(integral - 1.0) < 1e-3);
+}
+
+TEST_CASE("Sky distribution sample pdf matches evaluated pdf", "[sky]")
+{
+    const SkyFixture                      sky(0.8f, 2.0f);
+    std::mt19937                          rng(1234);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+    constexpr int sampleCount = 10000;
+    int           mismatchCount = 0;
+    for (int i = 0; i < sampleCount; ++i)
+    {
+        const SkyDirectionSample sample =
+            sampleSkyDistribution(sky.distribution, glm::vec2(dist(rng), dist(rng)));
+        REQUIRE(std::abs(glm::dot(sample.direction, sample.direction) - 1.0f) < 1e-4f);
+        REQUIRE(sample.pdf > 0.0f);
+
+        // Samples right on a cell boundary may map back to the neighbouring cell.
+        const float pdf = skyDistributionPdf(sky.distribution, sample.direction);
+        if (std::abs(pdf - sample.pdf) > 1e-3f * sample.pdf)
+        {
+            ++mismatchCount;
+        }
+    }
+
+    REQUIRE(mismatchCount < sampleCount / 1000);
+}
+
+TEST_CASE("Sky distribution reduces variance over uniform sampling", "[sky]")
+{
+    for (const float sunElevation : {0.05f, 0.5f, 1.2f})
+    {
+        for (const float turbidity : {2.0f, 10.0f})
+        {
+            const SkyFixture sky(sunElevation, turbidity);
+
+            constexpr int sampleCount = 1 << 16;
+            std::mt19937  rng(1234);
+            std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+            double importanceSum = 0.0;
+            double importanceSqrSum = 0.0;
+            double uniformSum = 0.0;
+            double uniformSqrSum = 0.0;
+            for (int i = 0; i < sampleCount; ++i)
+            {
+                const glm::vec2 u(dist(rng), dist(rng));
+
+                const SkyDirectionSample sample = sampleSkyDistribution(sky.distribution, u);
+                const double importance = sky.luminance(sample.direction) / sample.pdf;
+                importanceSum += importance;
+                importanceSqrSum += importance * importance;
+
+                const float  cosTheta = 1.0f - 2.0f * u.x;
+                const float  theta = std::acos(cosTheta);
+                const double uniform =
+                    sky.luminance(sphericalDirection(theta, 2.0f * PI * u.y)) * 4.0f * PI;
+                uniformSum += uniform;
+                uniformSqrSum += uniform * uniform;
+            }
+
+            const double importanceMean = importanceSum / sampleCount;
+            const double uniformMean = uniformSum / sampleCount;
+            const double importanceVariance =
+                importanceSqrSum / sampleCount - importanceMean * importanceMean;
+            const double uniformVariance = uniformSqrSum / sampleCount - uniformMean * uniformMean;
+
+            REQUIRE(std::abs(importanceMean - uniformMean) < 0.01 * uniformMean);
+            REQUIRE(importanceVariance < 0.5 * uniformVariance);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include <common/sky_radiance_lut.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+using namespace nlrs;
+
+namespace
+{
+sky_state makeSkyState(const float sunElevation, const float turbidity)
+{
+    const sky_params params{
+        .elevation = sunElevation,
+        .turbidity = turbidity,
+        .albedo = {0.3f, 0.3f, 0.3f},
+    };
+    sky_state state;
+    REQUIRE(sky_state_new(&params, &state) == sky_state_result_success);
+    return state;
+}
+} // namespace
+
+TEST_CASE("Sky radiance LUT matches the analytic model", "[sky]")
+{
+    constexpr float pi = std::numbers::pi_v<float>;
+    // Matches `SOLAR_RADIUS_RADIANS` in hw_skymodel.c.
+    constexpr float solarRadius = 0.004450589f;
+    constexpr int   stepCount = 128;
+
+    for (const float sunElevation : {0.1f, 0.5f, 1.2f})
+    {
+        for (const float turbidity : {2.0f, 6.0f, 10.0f})
+        {
+            const sky_state state = makeSkyState(sunElevation, turbidity);
+            const auto      lut = bakeSkyRadianceLut(state);
+            REQUIRE(lut.size() == SKY_RADIANCE_LUT_FLOAT_COUNT);
+
+            const glm::vec3 sunDirection(std::cos(sunElevation), std::sin(sunElevation), 0.0f);
+            const float     zenithGamma = 0.5f * pi - sunElevation;
+            const glm::vec3 zenithRadiance(
+                sky_state_radiance(&state, 0.0f, zenithGamma, channel_r),
+                sky_state_radiance(&state, 0.0f, zenithGamma, channel_g),
+                sky_state_radiance(&state, 0.0f, zenithGamma, channel_b));
+
+            // The error is relative to the reference radiance, with a small fraction of the zenith
+            // radiance added to avoid dividing by zero where the radiance vanishes.
+            float maxError = 0.0f;
+            for (int i = 0; i < stepCount; ++i)
+            {
+                const float theta = 0.5f * pi * (i + 0.5f) / stepCount;
+                for (int j = 0; j < stepCount; ++j)
+                {
+                    const float     phi = 2.0f * pi * (j + 0.5f) / stepCount;
+                    const glm::vec3 v(
+                        std::sin(theta) * std::cos(phi),
+                        std::cos(theta),
+                        std::sin(theta) * std::sin(phi));
+                    const float     cosGamma = std::clamp(glm::dot(v, sunDirection), -1.0f, 1.0f);
+                    const float     gamma = std::acos(cosGamma);
+                    if (gamma <= solarRadius)
+                    {
+                        continue;
+                    }
+
+                    const glm::vec3 expected(
+                        sky_state_radiance(&state, theta, gamma, channel_r),
+                        sky_state_radiance(&state, theta, gamma, channel_g),
+                        sky_state_radiance(&state, theta, gamma, channel_b));
+                    const glm::vec3 actual = sampleSkyRadianceLut(lut, v.y, cosGamma);
+                    const glm::vec3 error =
+                        glm::abs(actual - expected) / (glm::abs(expected) + 0.01f * zenithRadiance);
+                    maxError = std::max({maxError, error.x, error.y, error.z});
+                }
+            }
+
+            REQUIRE(maxError < 0.1f);
+        }
+    }
+}
+
+TEST_CASE("Sky radiance LUT excludes the solar disk", "[sky]")
+{
+    const sky_state state = makeSkyState(0.5f, 3.0f);
+    const auto      lut = bakeSkyRadianceLut(state);
+
+    const glm::vec3 radiance = sampleSkyRadianceLut(lut, std::sin(0.5f), 1.0f);
+    REQUIRE(radiance.x > 0.0f);
+    REQUIRE(radiance.x < 0.01f * state.solar_radiances[0]);
+    REQUIRE(radiance.y < 0.01f * state.solar_radiances[1]);
+    REQUIRE(radiance.z < 0.01f * state.solar_radiances[2]);
+}
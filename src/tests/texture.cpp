@@ -0,0 +1,125 @@
+#include <common/texture.hpp>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+using namespace nlrs;
+
+namespace
+{
+std::vector<std::uint32_t> makePixels(const std::size_t count)
+{
+    std::vector<std::uint32_t> pixels(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        pixels[i] = static_cast<std::uint32_t>(i * 2654435761u);
+    }
+    return pixels;
+}
+
+std::uint32_t swapRedBlue(const std::uint32_t px)
+{
+    const std::uint32_t c0 = px & 0xffu;
+    const std::uint32_t c1 = (px >> 8) & 0xffu;
+    const std::uint32_t c2 = (px >> 16) & 0xffu;
+    const std::uint32_t c3 = (px >> 24) & 0xffu;
+    return c2 | (c1 << 8) | (c0 << 16) | (c3 << 24);
+}
+} // namespace
+
+TEST_CASE("Swizzling red and blue swaps the first and third byte", "[texture]")
+{
+    // Covers the vector kernels' remainder handling, as well as the parallel path.
+    const std::size_t count = GENERATE(0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, (1 << 20) + 5);
+
+    const std::vector<std::uint32_t> src = makePixels(count);
+    std::vector<std::uint32_t>       dst(count);
+    swizzleRedBlue(src, dst);
+
+    std::vector<std::uint32_t> expected(count);
+    std::transform(src.begin(), src.end(), expected.begin(), swapRedBlue);
+    REQUIRE(dst == expected);
+
+    WHEN("swizzling in place")
+    {
+        std::vector<std::uint32_t> pixels = src;
+        swizzleRedBlue(pixels, pixels);
+
+        THEN("the result is the same") { REQUIRE(pixels == dst); }
+    }
+
+    WHEN("swizzling twice")
+    {
+        swizzleRedBlue(dst, dst);
+
+        THEN("the original pixels are restored") { REQUIRE(dst == src); }
+    }
+}
+
+TEST_CASE("Swizzle benchmark", "[texture][!benchmark]")
+{
+    const std::vector<std::uint32_t> src = makePixels(4096 * 4096);
+    std::vector<std::uint32_t>       dst(src.size());
+
+    BENCHMARK("4096x4096 pixels")
+    {
+        swizzleRedBlue(src, dst);
+        return dst[0];
+    };
+}
+
+TEST_CASE("sRGB lookup table", "[texture]")
+{
+    const auto& lut = srgbToLinearLut();
+    REQUIRE(lut[0] == 0.0f);
+    REQUIRE(lut[255] == 1.0f);
+    REQUIRE(std::is_sorted(lut.begin(), lut.end()));
+    REQUIRE(std::adjacent_find(lut.begin(), lut.end()) == lut.end());
+}
+
+TEST_CASE("Decoding texels", "[texture]")
+{
+    const std::array<std::uint32_t, 1> bgra{0xff4080c0u};
+
+    SECTION("sRGB texels are decoded with the lookup table")
+    {
+        const auto& lut = srgbToLinearLut();
+        REQUIRE(
+            decodeTexel(TextureFormat::Bgra8Srgb, bgra) ==
+            glm::vec3(lut[0x40], lut[0x80], lut[0xc0]));
+    }
+
+    SECTION("unorm texels are already linear")
+    {
+        REQUIRE(
+            decodeTexel(TextureFormat::Bgra8Unorm, bgra) ==
+            glm::vec3(64.0f, 128.0f, 192.0f) / 255.0f);
+    }
+
+    SECTION("half-precision float texels keep values outside of [0, 1]")
+    {
+        const std::array<float, 8> rgba{0.5f, 2.0f, 1024.0f, 1.0f, 0.0f, 0.25f, 16.0f, 0.0f};
+        const Texture              texture = Texture::fromRgbaFloat(rgba, {2, 1});
+        REQUIRE(texture.format() == TextureFormat::Rgba16Float);
+        REQUIRE(texture.pixels().size() == 4);
+        REQUIRE(
+            decodeTexel(texture.format(), texture.pixels().subspan(0, 2)) ==
+            glm::vec3(0.5f, 2.0f, 1024.0f));
+        REQUIRE(
+            decodeTexel(texture.format(), texture.pixels().subspan(2, 2)) ==
+            glm::vec3(0.0f, 0.25f, 16.0f));
+    }
+}
+
+TEST_CASE("Single pixel textures are linear", "[texture]")
+{
+    const Texture texture = Texture::fromPixel(1.0f, 0.0f, 0.0f, 1.0f);
+    REQUIRE(texture.format() == TextureFormat::Bgra8Unorm);
+    REQUIRE(decodeTexel(texture.format(), texture.pixels()) == glm::vec3(1.0f, 0.0f, 0.0f));
+}
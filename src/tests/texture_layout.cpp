@@ -0,0 +1,323 @@
+#include <common/texture_layout.hpp>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace nlrs;
+
+namespace
+{
+constexpr std::size_t MAX_PAGE_WORD_COUNT = (1 << 28) / sizeof(std::uint32_t);
+
+Texture makeTexture(const std::uint32_t width, const std::uint32_t height)
+{
+    std::vector<Texture::BgraPixel> pixels(static_cast<std::size_t>(width) * height);
+    for (std::uint32_t y = 0; y < height; ++y)
+    {
+        for (std::uint32_t x = 0; x < width; ++x)
+        {
+            pixels[y * width + x] = (y << 16) | x;
+        }
+    }
+    return Texture(std::move(pixels), Texture::Dimensions{width, height});
+}
+
+Texture makeFloatTexture(const std::uint32_t width, const std::uint32_t height)
+{
+    std::vector<float> rgba;
+    for (std::uint32_t y = 0; y < height; ++y)
+    {
+        for (std::uint32_t x = 0; x < width; ++x)
+        {
+            // Integers below 2048 are exactly representable as half-precision floats.
+            rgba.insert(
+                rgba.end(),
+                {static_cast<float>(x), static_cast<float>(y), static_cast<float>(x + y), 1.0f});
+        }
+    }
+    return Texture::fromRgbaFloat(rgba, Texture::Dimensions{width, height});
+}
+
+glm::vec3 decodeBgra8Srgb(const std::uint32_t bgra)
+{
+    return decodeTexel(TextureFormat::Bgra8Srgb, std::array<std::uint32_t, 1>{bgra});
+}
+} // namespace
+
+TEST_CASE("Packed texel count", "[texture_layout]")
+{
+    REQUIRE(packedTexelCount({16, 8}, TextureLayout::RowMajor) == 128);
+    REQUIRE(packedTexelCount({16, 8}, TextureLayout::Tiled) == 128);
+    REQUIRE(packedTexelCount({17, 9}, TextureLayout::RowMajor) == 153);
+    REQUIRE(packedTexelCount({17, 9}, TextureLayout::Tiled) == 3 * 2 * 64);
+    REQUIRE(packedTexelCount({1, 1}, TextureLayout::Tiled) == 64);
+}
+
+TEST_CASE("Texel index within a tile is in Morton order", "[texture_layout]")
+{
+    const TextureDescriptor desc{16, 16, 0, 0, TextureLayout::Tiled, TextureFormat::Bgra8Srgb};
+    REQUIRE(texelIndex(desc, 0, 0) == 0);
+    REQUIRE(texelIndex(desc, 1, 0) == 1);
+    REQUIRE(texelIndex(desc, 0, 1) == 2);
+    REQUIRE(texelIndex(desc, 1, 1) == 3);
+    REQUIRE(texelIndex(desc, 2, 0) == 4);
+    REQUIRE(texelIndex(desc, 7, 7) == 63);
+    REQUIRE(texelIndex(desc, 8, 0) == 64);
+    REQUIRE(texelIndex(desc, 0, 8) == 128);
+    REQUIRE(texelIndex(desc, 15, 15) == 255);
+}
+
+SCENARIO("Packing textures", "[texture_layout]")
+{
+    GIVEN("textures which are not a multiple of the tile size")
+    {
+        std::array<Texture, 3> textures{makeTexture(13, 7), makeTexture(1, 1), makeTexture(32, 9)};
+
+        const TextureLayout layout = GENERATE(TextureLayout::RowMajor, TextureLayout::Tiled);
+
+        WHEN("packing the textures")
+        {
+            const PackedTextures packed = packTextures(textures, layout, MAX_PAGE_WORD_COUNT);
+
+            THEN("there is a descriptor per texture, in order")
+            {
+                REQUIRE(packed.descriptors.size() == textures.size());
+                std::size_t offset = 0;
+                for (std::size_t i = 0; i < textures.size(); ++i)
+                {
+                    const TextureDescriptor& desc = packed.descriptors[i];
+                    REQUIRE(desc.width == textures[i].dimensions().width);
+                    REQUIRE(desc.height == textures[i].dimensions().height);
+                    REQUIRE(desc.page == 0);
+                    REQUIRE(desc.layout == layout);
+                    offset += packedTexelCount(textures[i].dimensions(), layout);
+                }
+                REQUIRE(packed.pages.size() == 1);
+                REQUIRE(packed.pages[0].size() == offset);
+            }
+
+            THEN("every texel can be found via the texel index")
+            {
+                for (std::size_t i = 0; i < textures.size(); ++i)
+                {
+                    const TextureDescriptor& desc = packed.descriptors[i];
+                    const auto               pixels = textures[i].pixels();
+                    for (std::uint32_t y = 0; y < desc.height; ++y)
+                    {
+                        for (std::uint32_t x = 0; x < desc.width; ++x)
+                        {
+                            REQUIRE(
+                                packed.pages[desc.page][desc.offset + texelIndex(desc, x, y)] ==
+                                pixels[y * desc.width + x]);
+                        }
+                    }
+                }
+            }
+
+            THEN("texture lookups return the same texel regardless of layout")
+            {
+                const PackedTextures rowMajor =
+                    packTextures(textures, TextureLayout::RowMajor, MAX_PAGE_WORD_COUNT);
+                const std::array<float, 7> coords{-1.25f, -0.5f, 0.0f, 0.3f, 0.99f, 1.0f, 2.7f};
+                for (std::size_t i = 0; i < textures.size(); ++i)
+                {
+                    for (const float u : coords)
+                    {
+                        for (const float v : coords)
+                        {
+                            REQUIRE(
+                                textureLookup(packed.descriptors[i], packed.pages, u, v) ==
+                                textureLookup(rowMajor.descriptors[i], rowMajor.pages, u, v));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Packing textures into multiple pages", "[texture_layout]")
+{
+    GIVEN("textures which do not all fit into one page")
+    {
+        std::array<Texture, 5> textures{
+            makeTexture(8, 8),
+            makeTexture(16, 16),
+            makeTexture(8, 8),
+            makeTexture(16, 8),
+            makeTexture(8, 16)};
+        const std::size_t maxPageTexelCount = 256 + 64;
+
+        WHEN("packing the textures")
+        {
+            const PackedTextures packed =
+                packTextures(textures, TextureLayout::Tiled, maxPageTexelCount);
+
+            THEN("the largest textures are placed first, into the first page with room")
+            {
+                REQUIRE(packed.pages.size() == 2);
+                REQUIRE(packed.descriptors[1].page == 0);
+                REQUIRE(packed.descriptors[1].offset == 0);
+                REQUIRE(packed.descriptors[3].page == 1);
+                REQUIRE(packed.descriptors[3].offset == 0);
+                REQUIRE(packed.descriptors[4].page == 1);
+                REQUIRE(packed.descriptors[4].offset == 128);
+                REQUIRE(packed.descriptors[0].page == 0);
+                REQUIRE(packed.descriptors[0].offset == 256);
+                REQUIRE(packed.descriptors[2].page == 1);
+                REQUIRE(packed.descriptors[2].offset == 256);
+            }
+
+            THEN("each page is sized exactly to its textures")
+            {
+                REQUIRE(packed.pages[0].size() == 256 + 64);
+                REQUIRE(packed.pages[1].size() == 128 + 128 + 64);
+            }
+
+            THEN("every texel can be looked up")
+            {
+                for (std::size_t i = 0; i < textures.size(); ++i)
+                {
+                    const TextureDescriptor& desc = packed.descriptors[i];
+                    const float              du = 1.0f / static_cast<float>(desc.width);
+                    const float              dv = 1.0f / static_cast<float>(desc.height);
+                    for (std::uint32_t y = 0; y < desc.height; ++y)
+                    {
+                        for (std::uint32_t x = 0; x < desc.width; ++x)
+                        {
+                            const float u = (static_cast<float>(x) + 0.5f) * du;
+                            const float v = (static_cast<float>(y) + 0.5f) * dv;
+                            REQUIRE(
+                                textureLookup(desc, packed.pages, u, v) ==
+                                decodeBgra8Srgb(textures[i].pixels()[y * desc.width + x]));
+                        }
+                    }
+                }
+            }
+        }
+
+        WHEN("a texture is larger than a page")
+        {
+            THEN("packing throws")
+            {
+                REQUIRE_THROWS_AS(
+                    packTextures(textures, TextureLayout::Tiled, 128), std::runtime_error);
+            }
+        }
+    }
+}
+
+SCENARIO("Packing textures of different formats", "[texture_layout]")
+{
+    GIVEN("8-bit and half-precision float textures")
+    {
+        std::array<Texture, 3> textures{
+            makeTexture(5, 3), makeFloatTexture(9, 7), makeFloatTexture(1, 1)};
+
+        const TextureLayout layout = GENERATE(TextureLayout::RowMajor, TextureLayout::Tiled);
+
+        WHEN("packing the textures")
+        {
+            const PackedTextures packed = packTextures(textures, layout, MAX_PAGE_WORD_COUNT);
+
+            THEN("float textures occupy two words per texel")
+            {
+                std::size_t wordCount = 0;
+                for (std::size_t i = 0; i < textures.size(); ++i)
+                {
+                    REQUIRE(packed.descriptors[i].format == textures[i].format());
+                    wordCount += packedTexelCount(textures[i].dimensions(), layout) *
+                                 texelWordCount(textures[i].format());
+                }
+                REQUIRE(packed.pages.size() == 1);
+                REQUIRE(packed.pages[0].size() == wordCount);
+            }
+
+            THEN("every texel decodes to its source value")
+            {
+                for (std::size_t i = 0; i < textures.size(); ++i)
+                {
+                    const TextureDescriptor& desc = packed.descriptors[i];
+                    const std::uint32_t      wordsPerTexel = texelWordCount(desc.format);
+                    const float              du = 1.0f / static_cast<float>(desc.width);
+                    const float              dv = 1.0f / static_cast<float>(desc.height);
+                    for (std::uint32_t y = 0; y < desc.height; ++y)
+                    {
+                        for (std::uint32_t x = 0; x < desc.width; ++x)
+                        {
+                            const float u = (static_cast<float>(x) + 0.5f) * du;
+                            const float v = (static_cast<float>(y) + 0.5f) * dv;
+                            const auto  sourceWords = textures[i].pixels().subspan(
+                                (y * desc.width + x) * wordsPerTexel, wordsPerTexel);
+                            REQUIRE(
+                                textureLookup(desc, packed.pages, u, v) ==
+                                decodeTexel(desc.format, sourceWords));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Texture lookup wraps uv coordinates", "[texture_layout]")
+{
+    std::array<Texture, 1> textures{makeTexture(4, 4)};
+    const PackedTextures   packed =
+        packTextures(textures, TextureLayout::Tiled, MAX_PAGE_WORD_COUNT);
+    const auto&            desc = packed.descriptors[0];
+
+    REQUIRE(textureLookup(desc, packed.pages, 0.0f, 0.0f) == decodeBgra8Srgb(0));
+    REQUIRE(textureLookup(desc, packed.pages, 0.26f, 0.51f) == decodeBgra8Srgb((2u << 16) | 1u));
+    REQUIRE(textureLookup(desc, packed.pages, 1.26f, 1.51f) == decodeBgra8Srgb((2u << 16) | 1u));
+    REQUIRE(
+        textureLookup(desc, packed.pages, -0.01f, -0.01f) == decodeBgra8Srgb((3u << 16) | 3u));
+}
+
+TEST_CASE("Texture lookup benchmark", "[texture_layout][!benchmark]")
+{
+    std::array<Texture, 1> textures{makeTexture(2048, 2048)};
+    const PackedTextures   rowMajor =
+        packTextures(textures, TextureLayout::RowMajor, MAX_PAGE_WORD_COUNT);
+    const PackedTextures   tiled =
+        packTextures(textures, TextureLayout::Tiled, MAX_PAGE_WORD_COUNT);
+
+    // Incoherent secondary rays sample textures at effectively random uv coordinates. Nearby
+    // samples are modelled by small random steps from the previous uv.
+    std::mt19937                          rng(1234);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    std::uniform_real_distribution<float> stepDist(-0.01f, 0.01f);
+    std::vector<std::array<float, 2>>     randomUvs(1 << 16);
+    std::generate(randomUvs.begin(), randomUvs.end(), [&]() -> std::array<float, 2> {
+        return {dist(rng), dist(rng)};
+    });
+    std::vector<std::array<float, 2>> localUvs(1 << 16);
+    std::array<float, 2>              uv{0.5f, 0.5f};
+    std::generate(localUvs.begin(), localUvs.end(), [&]() -> std::array<float, 2> {
+        uv = {uv[0] + stepDist(rng), uv[1] + stepDist(rng)};
+        return uv;
+    });
+
+    const auto sampleAll = [](const PackedTextures&                    packed,
+                              const std::vector<std::array<float, 2>>& uvs) -> glm::vec3 {
+        glm::vec3 sum(0.0f);
+        for (const auto& [u, v] : uvs)
+        {
+            sum += textureLookup(packed.descriptors[0], packed.pages, u, v);
+        }
+        return sum;
+    };
+
+    BENCHMARK("row-major layout, random uv") { return sampleAll(rowMajor, randomUvs); };
+    BENCHMARK("tiled layout, random uv") { return sampleAll(tiled, randomUvs); };
+    BENCHMARK("row-major layout, local random uv") { return sampleAll(rowMajor, localUvs); };
+    BENCHMARK("tiled layout, local random uv") { return sampleAll(tiled, localUvs); };
+}
@@ -0,0 +1,200 @@
+#include <common/virtual_texture.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+using namespace nlrs;
+
+namespace
+{
+Texture makeTexture(const std::uint32_t width, const std::uint32_t height)
+{
+    std::vector<Texture::BgraPixel> pixels(static_cast<std::size_t>(width) * height);
+    for (std::uint32_t y = 0; y < height; ++y)
+    {
+        for (std::uint32_t x = 0; x < width; ++x)
+        {
+            pixels[y * width + x] = (y << 16) | x;
+        }
+    }
+    return Texture(std::move(pixels), Texture::Dimensions{width, height});
+}
+} // namespace
+
+SCENARIO("Virtual texture table", "[virtual_texture]")
+{
+    GIVEN("textures of different sizes")
+    {
+        std::array<Texture, 3> textures{
+            makeTexture(128, 64), makeTexture(1, 1), makeTexture(130, 129)};
+        const VirtualTextureTable table(textures);
+
+        THEN("each texture gets a contiguous range of virtual tiles")
+        {
+            REQUIRE(table.virtualTileCount() == 2 + 1 + 9);
+            REQUIRE(table.descriptors().size() == 3);
+            REQUIRE(table.descriptors()[0].offset == 0);
+            REQUIRE(table.descriptors()[1].offset == 2);
+            REQUIRE(table.descriptors()[2].offset == 3);
+            for (const TextureDescriptor& desc : table.descriptors())
+            {
+                REQUIRE(desc.layout == TextureLayout::Virtual);
+            }
+        }
+
+        THEN("texels map to the virtual tile containing them")
+        {
+            REQUIRE(table.virtualTileIndex(0, 0, 0) == 0);
+            REQUIRE(table.virtualTileIndex(0, 64, 63) == 1);
+            REQUIRE(table.virtualTileIndex(1, 0, 0) == 2);
+            REQUIRE(table.virtualTileIndex(2, 129, 0) == 5);
+            REQUIRE(table.virtualTileIndex(2, 0, 64) == 6);
+            REQUIRE(table.virtualTileIndex(2, 129, 128) == 11);
+        }
+
+        THEN("the tile location of every virtual tile round-trips")
+        {
+            for (std::uint32_t textureIdx = 0; textureIdx < textures.size(); ++textureIdx)
+            {
+                const auto dimensions = textures[textureIdx].dimensions();
+                for (std::uint32_t y = 0; y < dimensions.height; y += VIRTUAL_TILE_SIZE)
+                {
+                    for (std::uint32_t x = 0; x < dimensions.width; x += VIRTUAL_TILE_SIZE)
+                    {
+                        const std::uint32_t virtualTile = table.virtualTileIndex(textureIdx, x, y);
+                        REQUIRE(
+                            table.tileLocation(virtualTile) ==
+                            VirtualTileLocation{
+                                textureIdx, x / VIRTUAL_TILE_SIZE, y / VIRTUAL_TILE_SIZE});
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Copying virtual tile texels clamps to the texture edge", "[virtual_texture]")
+{
+    const Texture                   texture = makeTexture(70, 3);
+    std::vector<Texture::BgraPixel> tile(VIRTUAL_TILE_TEXEL_COUNT);
+
+    copyVirtualTileTexels(texture, 1, 0, tile);
+
+    REQUIRE(tile[0] == 64);
+    REQUIRE(tile[5] == 69);
+    REQUIRE(tile[6] == 69);
+    REQUIRE(tile[2 * VIRTUAL_TILE_SIZE + 1] == ((2u << 16) | 65u));
+    REQUIRE(tile[63 * VIRTUAL_TILE_SIZE + 63] == ((2u << 16) | 69u));
+}
+
+TEST_CASE("Aggregating tile requests", "[virtual_texture]")
+{
+    const std::array<std::uint32_t, 6> feedback{0, 1, 0, 0, 1, 1};
+    REQUIRE(aggregateTileRequests(feedback) == std::vector<std::uint32_t>{1, 4, 5});
+    REQUIRE(aggregateTileRequests(std::array<std::uint32_t, 3>{}).empty());
+}
+
+SCENARIO("Virtual tile cache", "[virtual_texture]")
+{
+    GIVEN("a cache with fewer physical tiles than virtual tiles")
+    {
+        VirtualTileCache cache(16, 3);
+
+        THEN("no tiles are resident")
+        {
+            REQUIRE(cache.residentTileCount() == 0);
+            for (const std::uint32_t physicalTile : cache.indirectionTable())
+            {
+                REQUIRE(physicalTile == INVALID_PHYSICAL_TILE);
+            }
+        }
+
+        WHEN("requesting tiles")
+        {
+            const std::vector<std::uint32_t> requests{2, 7};
+            const auto                       uploads = cache.update(requests, 8);
+
+            THEN("each requested tile is uploaded to a distinct physical tile")
+            {
+                REQUIRE(uploads.size() == 2);
+                REQUIRE(uploads[0].virtualTile == 2);
+                REQUIRE(uploads[1].virtualTile == 7);
+                REQUIRE(uploads[0].physicalTile != uploads[1].physicalTile);
+                REQUIRE(cache.indirectionTable()[2] == uploads[0].physicalTile);
+                REQUIRE(cache.indirectionTable()[7] == uploads[1].physicalTile);
+                REQUIRE(cache.residentTileCount() == 2);
+            }
+
+            AND_WHEN("requesting the same tiles again")
+            {
+                const auto secondUploads = cache.update(requests, 8);
+
+                THEN("nothing is uploaded") { REQUIRE(secondUploads.empty()); }
+            }
+        }
+
+        WHEN("requesting more tiles than fit")
+        {
+            REQUIRE(cache.update(std::vector<std::uint32_t>{0, 1, 2}, 8).size() == 3);
+            cache.update(std::vector<std::uint32_t>{0}, 8);
+            const auto uploads = cache.update(std::vector<std::uint32_t>{3}, 8);
+
+            THEN("the least recently used tile is evicted")
+            {
+                REQUIRE(uploads.size() == 1);
+                REQUIRE(uploads[0].virtualTile == 3);
+                REQUIRE(cache.isResident(0));
+                REQUIRE_FALSE(cache.isResident(1));
+                REQUIRE(cache.isResident(2));
+                REQUIRE(cache.isResident(3));
+                REQUIRE(cache.residentTileCount() == 3);
+            }
+        }
+
+        WHEN("a single update requests more tiles than there are physical tiles")
+        {
+            const auto uploads = cache.update(std::vector<std::uint32_t>{0, 1, 2, 3, 4}, 8);
+
+            THEN("only as many tiles as fit are uploaded, without evicting each other")
+            {
+                REQUIRE(uploads.size() == 3);
+                REQUIRE(cache.isResident(0));
+                REQUIRE(cache.isResident(1));
+                REQUIRE(cache.isResident(2));
+                REQUIRE_FALSE(cache.isResident(3));
+                REQUIRE_FALSE(cache.isResident(4));
+            }
+        }
+
+        WHEN("resident tiles are requested alongside new tiles")
+        {
+            cache.update(std::vector<std::uint32_t>{0, 1, 2}, 8);
+            const auto uploads = cache.update(std::vector<std::uint32_t>{5, 1}, 8);
+
+            THEN("the requested resident tile is not evicted")
+            {
+                REQUIRE(uploads.size() == 1);
+                REQUIRE(uploads[0].virtualTile == 5);
+                REQUIRE(cache.isResident(1));
+                REQUIRE(cache.isResident(5));
+                REQUIRE_FALSE(cache.isResident(0));
+            }
+        }
+
+        WHEN("the upload count is limited")
+        {
+            const auto uploads = cache.update(std::vector<std::uint32_t>{4, 5, 6}, 2);
+
+            THEN("the remaining requests are not served")
+            {
+                REQUIRE(uploads.size() == 2);
+                REQUIRE_FALSE(cache.isResident(6));
+                REQUIRE(cache.update(std::vector<std::uint32_t>{4, 5, 6}, 2).size() == 1);
+                REQUIRE(cache.isResident(6));
+            }
+        }
+    }
+}
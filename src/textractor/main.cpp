@@ -5,10 +5,8 @@
 #include <fmt/core.h>
 #include <stb_image_write.h>
 
-#include <algorithm>
 #include <cstdio>
 #include <cstdint>
-#include <iterator>
 #include <vector>
 
 void printHelp() { std::printf("Usage: textractor <input_gltf_file>\n"); }
@@ -35,19 +33,8 @@ int main(int argc, char** argv)
 
         static_assert(sizeof(nlrs::Texture::BgraPixel) == sizeof(std::uint32_t));
 
-        std::vector<std::uint32_t> pixelsRgba;
-        pixelsRgba.reserve(dimensions.width * dimensions.height);
-        std::transform(
-            pixelsBgra.begin(),
-            pixelsBgra.end(),
-            std::back_inserter(pixelsRgba),
-            [](const auto& bgra) {
-                const std::uint32_t b = bgra & 0xffu;
-                const std::uint32_t g = (bgra >> 8) & 0xffu;
-                const std::uint32_t r = (bgra >> 16) & 0xffu;
-                const std::uint32_t a = (bgra >> 24) & 0xffu;
-                return r | (g << 8) | (b << 16) | (a << 24);
-            });
+        std::vector<std::uint32_t> pixelsRgba(pixelsBgra.size());
+        nlrs::swizzleRedBlue(pixelsBgra, pixelsRgba);
 
         NLRS_ASSERT(
             stbi_write_png(